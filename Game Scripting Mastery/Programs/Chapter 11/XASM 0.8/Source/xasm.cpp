@@ -2,13 +2,14 @@
 
     Project.
 
-        XASM - The XtremeScript Assembler Version 0.8
+        XASM - The XtremeScript Assembler Version 0.9
 
     Abstract.
 
         Assembles XVM Assembly scripts to .XSE executables for use with the XtremeScript
 		Virtual Machine (XVM). This updated version 0.8 also preserves script-defined function
-        names for late binding and stores thread priority.
+        names for late binding and stores thread priority. Version 0.9 writes a compact,
+        variable-length instruction encoding, but can still write 0.8 executables.
 
     Date Created.
 
@@ -57,7 +58,12 @@
                                                         // validity
 
         #define VERSION_MAJOR               0           // Major version number
-        #define VERSION_MINOR               8           // Minor version number
+        #define VERSION_MINOR               9           // Minor version number
+
+        #define LEGACY_VERSION_MINOR        8           // Minor version number of the older,
+                                                        // fixed-size executable format
+        #define LEGACY_XSE_SWITCH           "-XSE0.8"   // Requests the older format on the
+                                                        // command line
 
     // ---- Lexer -----------------------------------------------------------------------------
 
@@ -89,9 +95,12 @@
         #define TOKEN_TYPE_FUNC             16          // The Func directives
         #define TOKEN_TYPE_PARAM            17          // The Param directives
         #define TOKEN_TYPE_REG_RETVAL       18          // The _RetVal directives
+        #define TOKEN_TYPE_JUMPTABLE        19          // The JumpTable directives
+        #define TOKEN_TYPE_SETSOURCEFILE    20          // The SetSourceFile directive
+        #define TOKEN_TYPE_SOURCELINE       21          // The SourceLine directives
 
-        #define TOKEN_TYPE_INVALID          19          // Error code for invalid tokens
-        #define END_OF_TOKEN_STREAM         20          // The end of the stream has been
+        #define TOKEN_TYPE_INVALID          22          // Error code for invalid tokens
+        #define END_OF_TOKEN_STREAM         23          // The end of the stream has been
                                                         // reached
 
         #define MAX_IDENT_SIZE              256        // Maximum identifier size
@@ -146,6 +155,43 @@
             #define INSTR_PAUSE             31
             #define INSTR_EXIT              32
 
+            #define INSTR_IADD              33
+            #define INSTR_ISUB              34
+            #define INSTR_IMUL              35
+            #define INSTR_IDIV              36
+            #define INSTR_IMOD              37
+            #define INSTR_IINC              38
+            #define INSTR_IDEC              39
+
+            #define INSTR_FADD              40
+            #define INSTR_FSUB              41
+            #define INSTR_FMUL              42
+            #define INSTR_FDIV              43
+
+            #define INSTR_IJE               44
+            #define INSTR_IJNE              45
+            #define INSTR_IJG               46
+            #define INSTR_IJL               47
+            #define INSTR_IJGE              48
+            #define INSTR_IJLE              49
+
+            #define INSTR_JTAB              50
+
+            #define INSTR_SQRT              51
+            #define INSTR_SIN               52
+            #define INSTR_COS               53
+            #define INSTR_ATAN2             54
+            #define INSTR_ABS               55
+            #define INSTR_MIN               56
+            #define INSTR_MAX               57
+
+            #define INSTR_VADD              58
+            #define INSTR_VSUB              59
+            #define INSTR_VSCALE            60
+            #define INSTR_VDOT              61
+
+            #define INSTR_YIELD             62
+
         // ---- Operand Type Bitfield Flags ---------------------------------------------------
 
             // The following constants are used as flags into an operand type bit field, hence
@@ -161,6 +207,7 @@
             #define OP_FLAG_TYPE_HOST_API_CALL  64      // Host API Call table index (used for
                                                         // CallHost)
             #define OP_FLAG_TYPE_REG        128         // Register
+            #define OP_FLAG_TYPE_JUMP_TABLE 256         // Jump table index (used for JTab)
 
     // ---- Assembled Instruction Stream ------------------------------------------------------
 
@@ -173,6 +220,45 @@
         #define OP_TYPE_FUNC_INDEX          6           // Function index
         #define OP_TYPE_HOST_API_CALL_INDEX 7           // Host API call index
         #define OP_TYPE_REG                 8           // Register
+        #define OP_TYPE_JUMP_TABLE_INDEX    9           // Jump table index
+
+        #define OP_TYPE_COUNT               10          // The number of operand types
+
+        #define MIN_INSTR_STREAM_SIZE       1024        // Initial size of the instruction
+                                                        // stream, which doubles as it fills
+
+    // ---- Line Table ------------------------------------------------------------------------
+
+        #define LINE_TABLE_ID_STRING        "XLN0"      // Marks the start of the line table
+        #define MIN_LINE_TABLE_SIZE         256         // Initial size of the line table,
+                                                        // which doubles as it fills
+
+    // ---- Hash Tables -----------------------------------------------------------------------
+
+        #define INSTR_HASH_TABLE_SIZE       64          // Number of buckets in the instruction
+                                                        // lookup hash table
+        #define MIN_HASH_TABLE_SIZE         256         // Minimum number of buckets in the
+                                                        // function, label, symbol, string and
+                                                        // host API call hash tables
+
+        #define GLOBAL_SCOPE                -1          // Hash scope of entries that don't
+                                                        // belong to a function
+
+    // ---- Fixups ----------------------------------------------------------------------------
+
+        #define FIXUP_TYPE_LINE_LABEL       0           // A forward line label reference
+        #define FIXUP_TYPE_FUNC             1           // A forward function reference
+        #define FIXUP_TYPE_MEM_REF          2           // A reference to a variable or
+                                                        // parameter whose stack index isn't
+                                                        // known yet
+        #define FIXUP_TYPE_JUMP_TABLE       3           // A forward jump table reference
+        #define FIXUP_TYPE_JUMP_TABLE_ENTRY 4           // A forward line label reference from
+                                                        // a jump table entry
+
+        #define MEM_REF_VAR                 0           // A single variable
+        #define MEM_REF_ARRAY_ABS           1           // An array indexed by an integer
+        #define MEM_REF_ARRAY_REL           2           // An array indexed by a variable
+        #define MEM_REF_ARRAY_INDEX         3           // The variable indexing an array
 
     // ---- Priority Types --------------------------------------------------------------------
 
@@ -271,6 +357,36 @@
 		#define ERROR_MSSG_INVALID_ARRAY_INDEX	\
 			"Invalid array index"
 
+		#define ERROR_MSSG_GLOBAL_JUMP_TABLE	\
+			"Jump tables can only appear inside functions"
+
+		#define ERROR_MSSG_JUMP_TABLE_REDEFINITION	\
+			"Jump table redefinition"
+
+		#define ERROR_MSSG_UNDEFINED_JUMP_TABLE	\
+			"Undefined jump table"
+
+		#define ERROR_MSSG_INVALID_JUMP_TABLE_BASE	\
+			"Invalid jump table base"
+
+		#define ERROR_MSSG_LEGACY_JUMP_TABLE	\
+			"Jump tables can't be written to older executables"
+
+		#define ERROR_MSSG_LEGACY_INSTR	\
+			"Instruction can't be written to older executables"
+
+		#define ERROR_MSSG_LOCAL_SETSOURCEFILE	\
+			"SetSourceFile can only appear in the global scope"
+
+		#define ERROR_MSSG_MULTIPLE_SETSOURCEFILES	\
+			"Multiple instances of SetSourceFile illegal"
+
+		#define ERROR_MSSG_GLOBAL_SOURCE_LINE	\
+			"Source lines can only appear inside functions"
+
+		#define ERROR_MSSG_INVALID_SOURCE_LINE	\
+			"Invalid source line"
+
 // ---- Data Structures -----------------------------------------------------------------------
 
     // ---- Linked Lists ----------------------------------------------------------------------
@@ -292,6 +408,16 @@
         }
             LinkedList;
 
+    // ---- Hash Tables -----------------------------------------------------------------------
+
+        typedef struct _HashTable                       // A hash table
+        {
+            LinkedList * pBucketList;                   // Pointer to the array of buckets, each
+                                                        // of which is a list of data pointers
+            int iBucketCount;                           // The number of buckets
+        }
+            HashTable;
+
     // ---- Lexical Analysis ------------------------------------------------------------------
 
         typedef int Token;                              // Tokenizer alias type
@@ -353,6 +479,7 @@
                 int iFuncIndex;                         // Function index
                 int iHostAPICallIndex;                  // Host API Call index
                 int iReg;                               // Register code
+                int iJumpTableIndex;                    // Jump table index
             };
             int iOffsetIndex;                           // Index of the offset
         }
@@ -389,6 +516,29 @@
         }
             LabelNode;
 
+    // ---- Jump Table Table ------------------------------------------------------------------
+
+        typedef struct _JumpTableNode                   // A jump table node
+        {
+			int iIndex;									// Index
+            char pstrIdent [ MAX_IDENT_SIZE ];          // Identifier
+            int iFuncIndex;                             // Function in which the table resides
+            int iBase;                                  // The value of the first entry
+            int iSize;                                  // The number of entries
+            int * piTargets;                            // The target instruction of each entry
+        }
+            JumpTableNode;
+
+    // ---- Line Table ------------------------------------------------------------------------
+
+        typedef struct _LineNode                        // A line table entry
+        {
+            int iInstrIndex;                            // The first instruction of the run
+            int iSourceLine;                            // The source line the run came from,
+                                                        // or zero if it's unknown
+        }
+            LineNode;
+
     // ---- Symbol Table ----------------------------------------------------------------------
 
         typedef struct _SymbolNode                      // A symbol table node
@@ -399,9 +549,36 @@
             int iStackIndex;                            // The stack index to which the symbol
                                                         // points
             int iFuncIndex;                             // Function in which the symbol resides
+            int iIsParam;                               // Is the symbol a parameter?
         }
             SymbolNode;
 
+    // ---- String Table ----------------------------------------------------------------------
+
+        typedef struct _StringNode                      // A string or host API call table node
+        {
+            int iIndex;                                 // Index
+            char pstrString [ MAX_LEXEME_SIZE ];        // String
+        }
+            StringNode;
+
+    // ---- Fixups ----------------------------------------------------------------------------
+
+        typedef struct _Fixup                           // An unresolved operand reference
+        {
+            int iType;                                  // Fixup type
+            char pstrIdent [ MAX_IDENT_SIZE ];          // Identifier being referenced
+            int iFuncIndex;                             // Function in which the reference
+                                                        // appears
+            int iInstrIndex;                            // Instruction to patch
+            int iOpIndex;                               // Operand to patch
+            int iMemRefType;                            // Memory reference type (if any)
+            int iOffsetIndex;                           // Integer array index (if any)
+            int iSourceLine;                            // Source line of the reference
+            unsigned int iLexemeIndex;                  // Index of the reference on the line
+        }
+            Fixup;
+
 // ---- Global Variables ----------------------------------------------------------------------
 
     // ---- Lexer -----------------------------------------------------------------------------
@@ -439,27 +616,88 @@
                                                         // instruction stream
         int g_iInstrStreamSize;                         // The number of instructions
 
+        int g_iInstrStreamCapacity;                     // The number of allocated instructions
+
         int g_iCurrInstrIndex;                          // The current instruction's index
 
+    // ---- Executable Format -----------------------------------------------------------------
+
+        int g_iIsLegacyXSE = FALSE;                     // Should the older, fixed-size .XSE
+                                                        // format be written?
+
+        // The operand type flag that accepts each operand type, indexed by operand type. The
+        // compact .XSE format encodes each operand's type as its position among the types its
+        // instruction accepts, so the order here must match the XVM's.
+
+        OpTypes g_OpTypeFlagTable [ OP_TYPE_COUNT ] =
+        {
+            OP_FLAG_TYPE_INT,                           // Integer literal value
+            OP_FLAG_TYPE_FLOAT,                         // Floating-point literal value
+            OP_FLAG_TYPE_STRING,                        // String literal value
+            OP_FLAG_TYPE_MEM_REF,                       // Absolute array index
+            OP_FLAG_TYPE_MEM_REF,                       // Relative array index
+            OP_FLAG_TYPE_LINE_LABEL,                    // Instruction index
+            OP_FLAG_TYPE_FUNC_NAME,                     // Function index
+            OP_FLAG_TYPE_HOST_API_CALL,                 // Host API call index
+            OP_FLAG_TYPE_REG,                           // Register
+            OP_FLAG_TYPE_JUMP_TABLE                     // Jump table index
+        };
+
+    // ---- Instruction Lookup Hash Table -----------------------------------------------------
+
+        HashTable g_InstrHashTable;                     // Mnemonic lookup into g_InstrTable
+
     // ---- Function Table --------------------------------------------------------------------
 
         LinkedList g_FuncTable;                         // The function table
+        HashTable g_FuncHashTable;                      // Name lookup into the function table
 
     // ---- Label Table -----------------------------------------------------------------------
 
         LinkedList g_LabelTable;                        // The label table
+        HashTable g_LabelHashTable;                     // Identifier lookup into the label
+                                                        // table
+
+    // ---- Jump Table Table ------------------------------------------------------------------
+
+        LinkedList g_JumpTableTable;                    // The jump table table
+        HashTable g_JumpTableHashTable;                 // Identifier lookup into the jump
+                                                        // table table
+
+    // ---- Line Table ------------------------------------------------------------------------
+
+        LineNode * g_pLineTable = NULL;                 // Each run of instructions assembled
+                                                        // from the same source line
+        int g_iLineTableSize;                           // The number of runs
+        int g_iLineTableCapacity;                       // The number of allocated runs
+
+        char g_pstrLineSourceFilename [ MAX_FILENAME_SIZE ];    // The source file the lines
+                                                                // refer to
+        int g_iIsSetSourceFileFound;                    // Has the SetSourceFile directive been
+                                                        // found?
 
     // ---- Symbol Table ----------------------------------------------------------------------
 
         LinkedList g_SymbolTable;                       // The symbol table
+        HashTable g_SymbolHashTable;                    // Identifier lookup into the symbol
+                                                        // table
 
 	// ---- String Table ----------------------------------------------------------------------
 
 		LinkedList g_StringTable;						// The string table
+        HashTable g_StringHashTable;                    // Lookup into the string table
 
 	// ---- Host API Call Table ---------------------------------------------------------------
 
 		LinkedList g_HostAPICallTable;					// The host API call table
+        HashTable g_HostAPICallHashTable;               // Lookup into the host API call table
+
+    // ---- Fixups ----------------------------------------------------------------------------
+
+        LinkedList g_FuncFixupList;                     // References awaiting the end of the
+                                                        // current function
+        LinkedList g_GlobalFixupList;                   // References awaiting the end of the
+                                                        // source
 
 // ---- Function Prototypes -------------------------------------------------------------------
 
@@ -470,6 +708,14 @@
         int AddNode ( LinkedList * pList, void * pData );
         void StripComments ( char * pstrSourceLine );
 
+    // ---- Hash Tables -----------------------------------------------------------------------
+
+        void InitHashTable ( HashTable * pTable, int iBucketCount );
+        void FreeHashTable ( HashTable * pTable );
+        unsigned int HashString ( char * pstrString, int iScope );
+        LinkedList * GetHashBucket ( HashTable * pTable, unsigned int iHash );
+        void AddHashNode ( HashTable * pTable, unsigned int iHash, void * pData );
+
     // ---- String Processing -----------------------------------------------------------------
 
         int IsCharWhitespace ( char cChar );
@@ -496,6 +742,8 @@
         void AssmblSourceFile ();
         void PrintAssmblStats ();
         void BuildXSE ();
+        void WriteInstr ( FILE * pExecFile, Instr * pInstr );
+        void WriteCompactInstr ( FILE * pExecFile, InstrLookup ** ppInstrByOpcode, int iInstrIndex );
 
         void Exit ();
         void ExitOnError ( char * pstrErrorMssg );
@@ -513,13 +761,16 @@
     // ---- Instructions ----------------------------------------------------------------------
 
         int GetInstrByMnemonic ( char * pstrMnemonic, InstrLookup * pInstr );
+        int GetLegacyOpcode ( int iOpcode );
         void InitInstrTable ();
         int AddInstrLookup ( char * pstrMnemonic, int iOpcode, int iOpCount );
         void SetOpType ( int iInstrIndex, int iOpIndex, OpTypes iOpType );
 
     // ---- Tables ----------------------------------------------------------------------------
 
-        int AddString ( LinkedList * pList, char * pstrString );
+        int GetHashTableSize ();
+
+        int AddString ( LinkedList * pList, HashTable * pTable, char * pstrString );
 
         int AddFunc ( char * pstrName, int iEntryPoint );
         FuncNode * GetFuncByName ( char * pstrName );
@@ -528,11 +779,34 @@
         int AddLabel ( char * pstrIdent, int iTargetIndex, int iFuncIndex );
         LabelNode * GetLabelByIdent ( char * pstrIdent, int iFuncIndex );
 
-        int AddSymbol ( char * pstrIdent, int iSize, int iStackIndex, int iFuncIndex );
+        int AddJumpTable ( char * pstrIdent, int iBase, int iFuncIndex );
+        JumpTableNode * GetJumpTableByIdent ( char * pstrIdent, int iFuncIndex );
+
+        void AddSourceLine ( int iInstrIndex, int iSourceLine );
+
+        int AddSymbol ( char * pstrIdent, int iSize, int iStackIndex, int iFuncIndex, int iIsParam );
         SymbolNode * GetSymbolByIdent ( char * pstrIdent, int iFuncIndex );
         int GetStackIndexByIdent ( char * pstrIdent, int iFuncIndex );
         int GetSizeByIdent ( char * pstrIdent, int iFuncIndex );
 
+    // ---- Assembly --------------------------------------------------------------------------
+
+        void GrowInstrStream ();
+        void SetMemRefOp ( Op * pOp, SymbolNode * pSymbol, int iMemRefType, int iOffsetIndex );
+
+        Fixup * AddFixup ( LinkedList * pList, int iType, char * pstrIdent, int iFuncIndex, int iOpIndex, int iMemRefType );
+        int ResolveFixup ( Fixup * pFixup );
+        void ResolveFuncFixups ();
+        void ResolveGlobalFixups ();
+
+    // ---- Executable Format -----------------------------------------------------------------
+
+        void WriteVarInt ( FILE * pExecFile, unsigned int iValue );
+        void WriteSignedVarInt ( FILE * pExecFile, int iValue );
+        void WriteXSEInt ( FILE * pExecFile, int iValue, int iLegacySize );
+        int GetOpShapeBitCount ( OpTypes iOpTypes );
+        int GetOpShape ( OpTypes iOpTypes, int iOpType );
+
 // ---- Functions -----------------------------------------------------------------------------
 
     /******************************************************************************************
@@ -662,6 +936,114 @@
         return pList->iNodeCount - 1;
     }
 
+    /******************************************************************************************
+    *
+    *   InitHashTable ()
+    *
+    *   Initializes a hash table with the specified number of empty buckets.
+    */
+
+    void InitHashTable ( HashTable * pTable, int iBucketCount )
+    {
+        // Allocate the bucket array
+
+        if ( ! ( pTable->pBucketList = ( LinkedList * ) malloc ( iBucketCount * sizeof ( LinkedList ) ) ) )
+            ExitOnError ( "Could not allocate hash table" );
+
+        pTable->iBucketCount = iBucketCount;
+
+        // Initialize each bucket to an empty list
+
+        for ( int iCurrBucketIndex = 0; iCurrBucketIndex < iBucketCount; ++ iCurrBucketIndex )
+            InitLinkedList ( & pTable->pBucketList [ iCurrBucketIndex ] );
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeHashTable ()
+    *
+    *   Frees a hash table. The data the buckets point to belongs to the table's linked list
+    *   and is left alone.
+    */
+
+    void FreeHashTable ( HashTable * pTable )
+    {
+        // If the table was never initialized, exit
+
+        if ( ! pTable->pBucketList )
+            return;
+
+        // Free each bucket's nodes, but not the data they point to
+
+        for ( int iCurrBucketIndex = 0; iCurrBucketIndex < pTable->iBucketCount; ++ iCurrBucketIndex )
+        {
+            LinkedListNode * pCurrNode = pTable->pBucketList [ iCurrBucketIndex ].pHead;
+
+            while ( pCurrNode )
+            {
+                LinkedListNode * pNextNode = pCurrNode->pNext;
+                free ( pCurrNode );
+                pCurrNode = pNextNode;
+            }
+        }
+
+        // Free the bucket array itself
+
+        free ( pTable->pBucketList );
+        pTable->pBucketList = NULL;
+    }
+
+    /******************************************************************************************
+    *
+    *   HashString ()
+    *
+    *   Hashes a string and the scope it was declared in (a function index or GLOBAL_SCOPE)
+    *   using FNV-1a.
+    */
+
+    unsigned int HashString ( char * pstrString, int iScope )
+    {
+        // Start with the FNV offset basis and fold in the scope, so identically named
+        // labels and locals in different functions land in different buckets
+
+        unsigned int iHash = 2166136261U ^ ( unsigned int ) iScope;
+
+        // Fold in each character of the string
+
+        while ( * pstrString )
+        {
+            iHash ^= ( unsigned char ) * pstrString;
+            iHash *= 16777619U;
+            ++ pstrString;
+        }
+
+        return iHash;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetHashBucket ()
+    *
+    *   Returns the bucket a hash value maps to.
+    */
+
+    LinkedList * GetHashBucket ( HashTable * pTable, unsigned int iHash )
+    {
+        return & pTable->pBucketList [ iHash % pTable->iBucketCount ];
+    }
+
+    /******************************************************************************************
+    *
+    *   AddHashNode ()
+    *
+    *   Adds a data pointer to the bucket its hash value maps to.
+    */
+
+    void AddHashNode ( HashTable * pTable, unsigned int iHash, void * pData )
+    {
+        AddNode ( GetHashBucket ( pTable, iHash ), pData );
+    }
+
 	/******************************************************************************************
 	*
 	*	StripComments ()
@@ -1002,10 +1384,11 @@
 
     void PrintUsage ()
     {
-        printf ( "Usage:\tXASM Source.XASM [Executable.XSE]\n" );
+        printf ( "Usage:\tXASM Source.XASM [Executable.XSE] [%s]\n", LEGACY_XSE_SWITCH );
         printf ( "\n" );
         printf ( "\t- File extensions are not required.\n" );
         printf ( "\t- Executable name is optional; source name is used by default.\n" );
+        printf ( "\t- %s writes a version 0.%d executable for older XVMs.\n", LEGACY_XSE_SWITCH, LEGACY_VERSION_MINOR );
     }
 
     /******************************************************************************************
@@ -1043,23 +1426,26 @@
         if ( ! ( g_ppstrSourceCode = ( char ** ) malloc ( g_iSourceCodeSize * sizeof ( char * ) ) ) )
             ExitOnError ( "Could not allocate space for source code" );
 
-        // Read the source code in from the file
+        // Read the source code in from the file. Each line is read into a single fixed-size
+        // buffer and then copied to a block of its exact size, since allocating the maximum
+        // line size for every line adds up quickly on large sources.
+
+        char pstrSourceLine [ MAX_SOURCE_LINE_SIZE + 1 ];
 
         for ( int iCurrLineIndex = 0; iCurrLineIndex < g_iSourceCodeSize; ++ iCurrLineIndex )
         {
-            // Allocate space for the line
-
-            if ( ! ( g_ppstrSourceCode [ iCurrLineIndex ] = ( char * ) malloc ( MAX_SOURCE_LINE_SIZE + 1 ) ) )
-                ExitOnError ( "Could not allocate space for source line" );
-
-            // Read in the current line
+            // Read in the current line, and strip comments and trim whitespace. The final line
+            // may be empty if the file ends with a newline.
 
-            fgets ( g_ppstrSourceCode [ iCurrLineIndex ], MAX_SOURCE_LINE_SIZE, g_pSourceFile );
-
-            // Strip comments and trim whitespace
-
-            StripComments ( g_ppstrSourceCode [ iCurrLineIndex ] );
-            TrimWhitespace ( g_ppstrSourceCode [ iCurrLineIndex ] );
+            if ( fgets ( pstrSourceLine, MAX_SOURCE_LINE_SIZE, g_pSourceFile ) )
+            {
+                StripComments ( pstrSourceLine );
+                TrimWhitespace ( pstrSourceLine );
+            }
+            else
+            {
+                pstrSourceLine [ 0 ] = '\0';
+            }
 
             // Make sure to add a new newline if it was removed by the stripping of the
             // comments and whitespace. We do this by checking the character right before
@@ -1067,12 +1453,19 @@
             // by one and add it. We use strlen () to find the position of the newline
             // easily.
 
-            int iNewLineIndex = strlen ( g_ppstrSourceCode [ iCurrLineIndex ] ) - 1;
-            if ( g_ppstrSourceCode [ iCurrLineIndex ] [ iNewLineIndex ] != '\n' )
+            int iNewLineIndex = strlen ( pstrSourceLine ) - 1;
+            if ( iNewLineIndex < 0 || pstrSourceLine [ iNewLineIndex ] != '\n' )
             {
-                g_ppstrSourceCode [ iCurrLineIndex ] [ iNewLineIndex + 1 ] = '\n';
-                g_ppstrSourceCode [ iCurrLineIndex ] [ iNewLineIndex + 2 ] = '\0';
+                pstrSourceLine [ iNewLineIndex + 1 ] = '\n';
+                pstrSourceLine [ iNewLineIndex + 2 ] = '\0';
             }
+
+            // Allocate space for the line and copy it in
+
+            if ( ! ( g_ppstrSourceCode [ iCurrLineIndex ] = ( char * ) malloc ( strlen ( pstrSourceLine ) + 1 ) ) )
+                ExitOnError ( "Could not allocate space for source line" );
+
+            strcpy ( g_ppstrSourceCode [ iCurrLineIndex ], pstrSourceLine );
         }
 
         // Close the source file
@@ -1436,6 +1829,10 @@
                                     OP_FLAG_TYPE_MEM_REF |
                                     OP_FLAG_TYPE_REG );
 
+        // Yield
+
+        iInstrIndex = AddInstrLookup ( "Yield", INSTR_YIELD, 0 );
+
         // Exit         Code
 
         iInstrIndex = AddInstrLookup ( "Exit", INSTR_EXIT, 1 );
@@ -1444,102 +1841,445 @@
                                     OP_FLAG_TYPE_STRING |
                                     OP_FLAG_TYPE_MEM_REF |
                                     OP_FLAG_TYPE_REG );
-    }
 
-    /******************************************************************************************
-    *
-    *   AddInstrLookup ()
-    *
-    *   Adds an instruction to the instruction lookup table.
-    */
+        // ---- Typed Arithmetic
 
-    int AddInstrLookup ( char * pstrMnemonic, int iOpcode, int iOpCount )
-    {
-        // Just use a simple static int to keep track of the next instruction index in the
-        // table.
+        // These are emitted by the compiler in place of the generic instructions when it can
+        // prove that both operands are integers or both are floats. Their sources only accept
+        // literals of the matching type.
 
-        static int iInstrIndex = 0;
+        // IAdd         Destination, Source
 
-        // Make sure we haven't run out of instruction indices
+        iInstrIndex = AddInstrLookup ( "IAdd", INSTR_IADD, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        if ( iInstrIndex >= MAX_INSTR_LOOKUP_COUNT )
-            return -1;
+        // ISub         Destination, Source
 
-        // Set the mnemonic, opcode and operand count fields
+        iInstrIndex = AddInstrLookup ( "ISub", INSTR_ISUB, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        strcpy ( g_InstrTable [ iInstrIndex ].pstrMnemonic, pstrMnemonic );
-        strupr ( g_InstrTable [ iInstrIndex ].pstrMnemonic );
-        g_InstrTable [ iInstrIndex ].iOpcode = iOpcode;
-        g_InstrTable [ iInstrIndex ].iOpCount = iOpCount;
+        // IMul         Destination, Source
 
-        // Allocate space for the operand list
+        iInstrIndex = AddInstrLookup ( "IMul", INSTR_IMUL, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        g_InstrTable [ iInstrIndex ].OpList = ( OpTypes * ) malloc ( iOpCount * sizeof ( OpTypes ) );
+        // IDiv         Destination, Source
 
-        // Copy the instruction index into another variable so it can be returned to the caller
+        iInstrIndex = AddInstrLookup ( "IDiv", INSTR_IDIV, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        int iReturnInstrIndex = iInstrIndex;
+        // IMod         Destination, Source
 
-        // Increment the index for the next instruction
+        iInstrIndex = AddInstrLookup ( "IMod", INSTR_IMOD, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        ++ iInstrIndex;
+        // IInc         Destination
 
-        // Return the used index to the caller
+        iInstrIndex = AddInstrLookup ( "IInc", INSTR_IINC, 1 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-        return iReturnInstrIndex;
-    }
+        // IDec         Destination
 
-	/******************************************************************************************
-	*
-	*	AddString ()
-	*
-	*	Adds a string to a linked list, blocking duplicate entries
-	*/
+        iInstrIndex = AddInstrLookup ( "IDec", INSTR_IDEC, 1 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-	int AddString ( LinkedList * pList, char * pstrString )
-	{
-		// ---- First check to see if the string is already in the list
+        // FAdd         Destination, Source
 
-		// Create a node to traverse the list
+        iInstrIndex = AddInstrLookup ( "FAdd", INSTR_FADD, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-		LinkedListNode * pNode = pList->pHead;
+        // FSub         Destination, Source
 
-		// Loop through each node in the list
+        iInstrIndex = AddInstrLookup ( "FSub", INSTR_FSUB, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-		for ( int iCurrNode = 0; iCurrNode < pList->iNodeCount; ++ iCurrNode )
-		{
-			// If the current node's string equals the specified string, return its index
+        // FMul         Destination, Source
 
-			if ( strcmp ( ( char * ) pNode->pData, pstrString ) == 0 )
-				return iCurrNode;
+        iInstrIndex = AddInstrLookup ( "FMul", INSTR_FMUL, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-			// Otherwise move along to the next node
+        // FDiv         Destination, Source
 
-			pNode = pNode->pNext;
-		}
+        iInstrIndex = AddInstrLookup ( "FDiv", INSTR_FDIV, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
 
-		// ---- Add the new string, since it wasn't added
+        // ---- Typed Conditional Branching
 
-		// Create space on the heap for the specified string
+        // IJE          Op0, Op1, Label
 
-		char * pstrStringNode = ( char * ) malloc ( strlen ( pstrString ) + 1 );
-		strcpy ( pstrStringNode, pstrString );
+        iInstrIndex = AddInstrLookup ( "IJE", INSTR_IJE, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
 
-		// Add the string to the list and return its index
+        // IJNE         Op0, Op1, Label
 
-		return AddNode ( pList, pstrStringNode );
-	}
+        iInstrIndex = AddInstrLookup ( "IJNE", INSTR_IJNE, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
 
-    /******************************************************************************************
-    *
-    *   SetOpType ()
-    *
-    *   Sets the operand type for the specified operand in the specified instruction.
-    */
+        // IJG          Op0, Op1, Label
 
-    void SetOpType ( int iInstrIndex, int iOpIndex, OpTypes iOpType )
-    {
-        g_InstrTable [ iInstrIndex ].OpList [ iOpIndex ] = iOpType;
+        iInstrIndex = AddInstrLookup ( "IJG", INSTR_IJG, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
+
+        // IJL          Op0, Op1, Label
+
+        iInstrIndex = AddInstrLookup ( "IJL", INSTR_IJL, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
+
+        // IJGE         Op0, Op1, Label
+
+        iInstrIndex = AddInstrLookup ( "IJGE", INSTR_IJGE, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
+
+        // IJLE         Op0, Op1, Label
+
+        iInstrIndex = AddInstrLookup ( "IJLE", INSTR_IJLE, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
+
+        // ---- Indexed Branching
+
+        // JTab         Value, JumpTable, DefaultLabel
+
+        iInstrIndex = AddInstrLookup ( "JTab", INSTR_JTAB, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_JUMP_TABLE );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_LINE_LABEL );
+
+        // ---- Math Intrinsics
+
+        // Sqrt         Destination, Source
+
+        iInstrIndex = AddInstrLookup ( "Sqrt", INSTR_SQRT, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // Sin          Destination, Source
+
+        iInstrIndex = AddInstrLookup ( "Sin", INSTR_SIN, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // Cos          Destination, Source
+
+        iInstrIndex = AddInstrLookup ( "Cos", INSTR_COS, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // ATan2        Destination, Y, X
+
+        iInstrIndex = AddInstrLookup ( "ATan2", INSTR_ATAN2, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // Abs          Destination, Source
+
+        iInstrIndex = AddInstrLookup ( "Abs", INSTR_ABS, 2 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // Min          Destination, Source, Source
+
+        iInstrIndex = AddInstrLookup ( "Min", INSTR_MIN, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // Max          Destination, Source, Source
+
+        iInstrIndex = AddInstrLookup ( "Max", INSTR_MAX, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+
+        // ---- Vector Intrinsics
+
+        // Vectors are runs of consecutive stack elements, addressed by their first element,
+        // so they have to be memory references. The element count is always a literal.
+
+        // VAdd         Destination, Source, Count
+
+        iInstrIndex = AddInstrLookup ( "VAdd", INSTR_VADD, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT );
+
+        // VSub         Destination, Source, Count
+
+        iInstrIndex = AddInstrLookup ( "VSub", INSTR_VSUB, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT );
+
+        // VScale       Destination, Scalar, Count
+
+        iInstrIndex = AddInstrLookup ( "VScale", INSTR_VSCALE, 3 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_INT |
+                                    OP_FLAG_TYPE_FLOAT |
+                                    OP_FLAG_TYPE_STRING |
+                                    OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_INT );
+
+        // VDot         Destination, Source, Source, Count
+
+        iInstrIndex = AddInstrLookup ( "VDot", INSTR_VDOT, 4 );
+        SetOpType ( iInstrIndex, 0, OP_FLAG_TYPE_MEM_REF |
+                                    OP_FLAG_TYPE_REG );
+        SetOpType ( iInstrIndex, 1, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 2, OP_FLAG_TYPE_MEM_REF );
+        SetOpType ( iInstrIndex, 3, OP_FLAG_TYPE_INT );
+    }
+
+    /******************************************************************************************
+    *
+    *   AddInstrLookup ()
+    *
+    *   Adds an instruction to the instruction lookup table.
+    */
+
+    int AddInstrLookup ( char * pstrMnemonic, int iOpcode, int iOpCount )
+    {
+        // Just use a simple static int to keep track of the next instruction index in the
+        // table.
+
+        static int iInstrIndex = 0;
+
+        // Make sure we haven't run out of instruction indices
+
+        if ( iInstrIndex >= MAX_INSTR_LOOKUP_COUNT )
+            return -1;
+
+        // Set the mnemonic, opcode and operand count fields
+
+        strcpy ( g_InstrTable [ iInstrIndex ].pstrMnemonic, pstrMnemonic );
+        strupr ( g_InstrTable [ iInstrIndex ].pstrMnemonic );
+        g_InstrTable [ iInstrIndex ].iOpcode = iOpcode;
+        g_InstrTable [ iInstrIndex ].iOpCount = iOpCount;
+
+        // Add the instruction to the mnemonic hash table
+
+        AddHashNode ( & g_InstrHashTable, HashString ( g_InstrTable [ iInstrIndex ].pstrMnemonic, GLOBAL_SCOPE ), & g_InstrTable [ iInstrIndex ] );
+
+        // Allocate space for the operand list
+
+        g_InstrTable [ iInstrIndex ].OpList = ( OpTypes * ) malloc ( iOpCount * sizeof ( OpTypes ) );
+
+        // Copy the instruction index into another variable so it can be returned to the caller
+
+        int iReturnInstrIndex = iInstrIndex;
+
+        // Increment the index for the next instruction
+
+        ++ iInstrIndex;
+
+        // Return the used index to the caller
+
+        return iReturnInstrIndex;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetHashTableSize ()
+    *
+    *   Returns the bucket count for the function, label, symbol, string and host API call
+    *   hash tables. Every entry in those tables takes at least one line of source, so sizing
+    *   them to the line count keeps the buckets short without ever having to rehash.
+    */
+
+    int GetHashTableSize ()
+    {
+        // Find the smallest power of two that covers the source
+
+        int iSize = MIN_HASH_TABLE_SIZE;
+        while ( iSize < g_iSourceCodeSize )
+            iSize *= 2;
+
+        return iSize;
+    }
+
+	/******************************************************************************************
+	*
+	*	AddString ()
+	*
+	*	Adds a string to a linked list, blocking duplicate entries. The list's hash table is
+	*	used to find duplicates without walking the list.
+	*/
+
+	int AddString ( LinkedList * pList, HashTable * pTable, char * pstrString )
+	{
+		// ---- First check to see if the string is already in the list
+
+		// Hash the string and traverse its bucket
+
+		unsigned int iHash = HashString ( pstrString, GLOBAL_SCOPE );
+		LinkedListNode * pNode = GetHashBucket ( pTable, iHash )->pHead;
+
+		while ( pNode )
+		{
+			// If the current node's string equals the specified string, return its index
+
+			StringNode * pCurrString = ( StringNode * ) pNode->pData;
+
+			if ( strcmp ( pCurrString->pstrString, pstrString ) == 0 )
+				return pCurrString->iIndex;
+
+			// Otherwise move along to the next node
+
+			pNode = pNode->pNext;
+		}
+
+		// ---- Add the new string, since it wasn't added
+
+		// Create a new string node
+
+		StringNode * pNewString = ( StringNode * ) malloc ( sizeof ( StringNode ) );
+		strcpy ( pNewString->pstrString, pstrString );
+
+		// Add the string to the list and the hash table, and return its index
+
+		int iIndex = AddNode ( pList, pNewString );
+		pNewString->iIndex = iIndex;
+		AddHashNode ( pTable, iHash, pNewString );
+
+		return iIndex;
+	}
+
+    /******************************************************************************************
+    *
+    *   SetOpType ()
+    *
+    *   Sets the operand type for the specified operand in the specified instruction.
+    */
+
+    void SetOpType ( int iInstrIndex, int iOpIndex, OpTypes iOpType )
+    {
+        g_InstrTable [ iInstrIndex ].OpList [ iOpIndex ] = iOpType;
     }
 
 	/******************************************************************************************
@@ -1551,17 +2291,35 @@
 
 	void Init ()
 	{
-        // Initialize the master instruction lookup table
+        // Initialize the master instruction lookup table and its hash table
 
+        InitHashTable ( & g_InstrHashTable, INSTR_HASH_TABLE_SIZE );
         InitInstrTable ();
 
         // Initialize tables
 
         InitLinkedList ( & g_SymbolTable );
         InitLinkedList ( & g_LabelTable );
+        InitLinkedList ( & g_JumpTableTable );
         InitLinkedList ( & g_FuncTable );
 		InitLinkedList ( & g_StringTable );
         InitLinkedList ( & g_HostAPICallTable );
+
+        // Initialize the tables' hash tables, which are sized to the source file
+
+        int iHashTableSize = GetHashTableSize ();
+
+        InitHashTable ( & g_SymbolHashTable, iHashTableSize );
+        InitHashTable ( & g_LabelHashTable, iHashTableSize );
+        InitHashTable ( & g_JumpTableHashTable, iHashTableSize );
+        InitHashTable ( & g_FuncHashTable, iHashTableSize );
+        InitHashTable ( & g_StringHashTable, iHashTableSize );
+        InitHashTable ( & g_HostAPICallHashTable, iHashTableSize );
+
+        // Initialize the fixup lists
+
+        InitLinkedList ( & g_FuncFixupList );
+        InitLinkedList ( & g_GlobalFixupList );
 	}
 
     /******************************************************************************************
@@ -1590,7 +2348,7 @@
 		{
 			// Free each instruction's operand list
 
-			for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_iInstrStreamSize; ++ iCurrInstrIndex )
+			for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_iInstrStreamCapacity; ++ iCurrInstrIndex )
 				if ( g_pInstrStream [ iCurrInstrIndex ].pOpList )
 					free ( g_pInstrStream [ iCurrInstrIndex ].pOpList );
 
@@ -1601,11 +2359,37 @@
 
 		// ---- Free the tables
 
+        // Each jump table's entries were allocated separately
+
+        LinkedListNode * pCurrNode = g_JumpTableTable.pHead;
+
+        while ( pCurrNode )
+        {
+            free ( ( ( JumpTableNode * ) pCurrNode->pData )->piTargets );
+            pCurrNode = pCurrNode->pNext;
+        }
+
 		FreeLinkedList ( & g_SymbolTable );
 		FreeLinkedList ( & g_LabelTable );
+		FreeLinkedList ( & g_JumpTableTable );
 		FreeLinkedList ( & g_FuncTable );
 		FreeLinkedList ( & g_StringTable );
 		FreeLinkedList ( & g_HostAPICallTable );
+
+		FreeHashTable ( & g_InstrHashTable );
+		FreeHashTable ( & g_SymbolHashTable );
+		FreeHashTable ( & g_LabelHashTable );
+		FreeHashTable ( & g_JumpTableHashTable );
+		FreeHashTable ( & g_FuncHashTable );
+		FreeHashTable ( & g_StringHashTable );
+		FreeHashTable ( & g_HostAPICallHashTable );
+
+		FreeLinkedList ( & g_FuncFixupList );
+		FreeLinkedList ( & g_GlobalFixupList );
+
+        // ---- Free the line table
+
+        free ( g_pLineTable );
     }
 
     /******************************************************************************************
@@ -1938,6 +2722,21 @@
         if ( strcmp ( g_Lexer.pstrCurrLexeme, "_RETVAL" ) == 0 )
             g_Lexer.CurrToken = TOKEN_TYPE_REG_RETVAL;
 
+        // Is it JumpTable?
+
+        if ( strcmp ( g_Lexer.pstrCurrLexeme, "JUMPTABLE" ) == 0 )
+            g_Lexer.CurrToken = TOKEN_TYPE_JUMPTABLE;
+
+        // Is it SetSourceFile?
+
+        if ( strcmp ( g_Lexer.pstrCurrLexeme, "SETSOURCEFILE" ) == 0 )
+            g_Lexer.CurrToken = TOKEN_TYPE_SETSOURCEFILE;
+
+        // Is it SourceLine?
+
+        if ( strcmp ( g_Lexer.pstrCurrLexeme, "SOURCELINE" ) == 0 )
+            g_Lexer.CurrToken = TOKEN_TYPE_SOURCELINE;
+
 		// Is it an instruction?
 
 		InstrLookup Instr;
@@ -2062,28 +2861,118 @@
 
     int GetInstrByMnemonic ( char * pstrMnemonic, InstrLookup * pInstr )
     {
-        // Loop through each instruction in the lookup table
+        // Traverse the mnemonic's bucket in the instruction hash table
 
-        for ( int iCurrInstrIndex = 0; iCurrInstrIndex < MAX_INSTR_LOOKUP_COUNT; ++ iCurrInstrIndex )
+        LinkedListNode * pCurrNode = GetHashBucket ( & g_InstrHashTable, HashString ( pstrMnemonic, GLOBAL_SCOPE ) )->pHead;
+
+        while ( pCurrNode )
+        {
+            InstrLookup * pCurrInstr = ( InstrLookup * ) pCurrNode->pData;
 
             // Compare the instruction's mnemonic to the specified one
 
-            if ( strcmp ( g_InstrTable [ iCurrInstrIndex ].pstrMnemonic, pstrMnemonic ) == 0 )
+            if ( strcmp ( pCurrInstr->pstrMnemonic, pstrMnemonic ) == 0 )
             {
                 // Set the instruction definition to the user-specified pointer
 
-                * pInstr = g_InstrTable [ iCurrInstrIndex ];
+                * pInstr = * pCurrInstr;
 
                 // Return TRUE to signify success
 
                 return TRUE;
             }
 
+            pCurrNode = pCurrNode->pNext;
+        }
+
         // A match was not found, so return FALSE
 
         return FALSE;
     }
 
+    /******************************************************************************************
+    *
+    *   GetLegacyOpcode ()
+    *
+    *   Returns the opcode an instruction is written with in an older executable, whose XVM
+    *   only knows the original instruction set. Typed instructions become the generic
+    *   instructions they stand in for, which give the same results when the operands have
+    *   the types the typed instruction assumes. Returns -1 if an older XVM has nothing that
+    *   does the same thing.
+    */
+
+    int GetLegacyOpcode ( int iOpcode )
+    {
+        switch ( iOpcode )
+        {
+            case INSTR_IADD:
+            case INSTR_FADD:
+                return INSTR_ADD;
+
+            case INSTR_ISUB:
+            case INSTR_FSUB:
+                return INSTR_SUB;
+
+            case INSTR_IMUL:
+            case INSTR_FMUL:
+                return INSTR_MUL;
+
+            case INSTR_IDIV:
+            case INSTR_FDIV:
+                return INSTR_DIV;
+
+            case INSTR_IMOD:
+                return INSTR_MOD;
+
+            case INSTR_IINC:
+                return INSTR_INC;
+
+            case INSTR_IDEC:
+                return INSTR_DEC;
+
+            case INSTR_IJE:
+                return INSTR_JE;
+
+            case INSTR_IJNE:
+                return INSTR_JNE;
+
+            case INSTR_IJG:
+                return INSTR_JG;
+
+            case INSTR_IJL:
+                return INSTR_JL;
+
+            case INSTR_IJGE:
+                return INSTR_JGE;
+
+            case INSTR_IJLE:
+                return INSTR_JLE;
+
+            // The math intrinsics would have to become host API calls, which the script
+            // would need the host to provide
+
+            case INSTR_SQRT:
+            case INSTR_SIN:
+            case INSTR_COS:
+            case INSTR_ATAN2:
+            case INSTR_ABS:
+            case INSTR_MIN:
+            case INSTR_MAX:
+            case INSTR_VADD:
+            case INSTR_VSUB:
+            case INSTR_VSCALE:
+            case INSTR_VDOT:
+                return -1;
+
+            // Older XVMs have no coroutines to suspend
+
+            case INSTR_YIELD:
+                return -1;
+        }
+
+        return iOpcode;
+    }
+
     /******************************************************************************************
     *
     *   GetFuncByName ()
@@ -2093,18 +2982,13 @@
 
     FuncNode * GetFuncByName ( char * pstrName )
     {
-        // If the table is empty, return a NULL pointer
+        // Create a pointer to traverse the name's bucket in the function hash table
 
-        if ( ! g_FuncTable.iNodeCount )
-            return NULL;
+        LinkedListNode * pCurrNode = GetHashBucket ( & g_FuncHashTable, HashString ( pstrName, GLOBAL_SCOPE ) )->pHead;
 
-        // Create a pointer to traverse the list
-
-        LinkedListNode * pCurrNode = g_FuncTable.pHead;
+        // Traverse the bucket until the matching structure is found
 
-        // Traverse the list until the matching structure is found
-
-        for ( int iCurrNode = 0; iCurrNode < g_FuncTable.iNodeCount; ++ iCurrNode )
+        while ( pCurrNode )
         {
             // Create a pointer to the current function structure
 
@@ -2149,9 +3033,10 @@
         strcpy ( pNewFunc->pstrName, pstrName );
         pNewFunc->iEntryPoint = iEntryPoint;
 
-        // Add the function to the list and get its index
+        // Add the function to the list and get its index, then add it to the hash table
 
         int iIndex = AddNode ( & g_FuncTable, pNewFunc );
+        AddHashNode ( & g_FuncHashTable, HashString ( pstrName, GLOBAL_SCOPE ), pNewFunc );
 
 		// Set the function node's index
 
@@ -2191,18 +3076,15 @@
 
     LabelNode * GetLabelByIdent ( char * pstrIdent, int iFuncIndex )
     {
-        // If the table is empty, return a NULL pointer
+        // Create a pointer to traverse the identifier's bucket in the label hash table.
+        // Labels are hashed along with their function index, since each function has its
+        // own label namespace.
 
-        if ( ! g_LabelTable.iNodeCount )
-            return NULL;
+        LinkedListNode * pCurrNode = GetHashBucket ( & g_LabelHashTable, HashString ( pstrIdent, iFuncIndex ) )->pHead;
 
-        // Create a pointer to traverse the list
+        // Traverse the bucket until the matching structure is found
 
-        LinkedListNode * pCurrNode = g_LabelTable.pHead;
-
-        // Traverse the list until the matching structure is found
-
-        for ( int iCurrNode = 0; iCurrNode < g_LabelTable.iNodeCount; ++ iCurrNode )
+        while ( pCurrNode )
         {
             // Create a pointer to the current label structure
 
@@ -2247,9 +3129,10 @@
         pNewLabel->iTargetIndex = iTargetIndex;
         pNewLabel->iFuncIndex = iFuncIndex;
 
-        // Add the label to the list and get its index
+        // Add the label to the list and get its index, then add it to the hash table
 
         int iIndex = AddNode ( & g_LabelTable, pNewLabel );
+        AddHashNode ( & g_LabelHashTable, HashString ( pstrIdent, iFuncIndex ), pNewLabel );
 
 		// Set the index of the label node
 
@@ -2260,6 +3143,118 @@
 		return iIndex;
     }
 
+    /******************************************************************************************
+    *
+    *   GetJumpTableByIdent ()
+    *
+    *   Returns a pointer to the jump table structure corresponding to the identifier and
+    *   function index.
+    */
+
+    JumpTableNode * GetJumpTableByIdent ( char * pstrIdent, int iFuncIndex )
+    {
+        // Like labels, jump tables are hashed along with their function index
+
+        LinkedListNode * pCurrNode = GetHashBucket ( & g_JumpTableHashTable, HashString ( pstrIdent, iFuncIndex ) )->pHead;
+
+        // Traverse the bucket until the matching structure is found
+
+        while ( pCurrNode )
+        {
+            JumpTableNode * pCurrJumpTable = ( JumpTableNode * ) pCurrNode->pData;
+
+            if ( strcmp ( pCurrJumpTable->pstrIdent, pstrIdent ) == 0 && pCurrJumpTable->iFuncIndex == iFuncIndex )
+                return pCurrJumpTable;
+
+            pCurrNode = pCurrNode->pNext;
+        }
+
+        // The structure was not found, so return a NULL pointer
+
+        return NULL;
+    }
+
+    /******************************************************************************************
+    *
+    *   AddSourceLine ()
+    *
+    *   Starts a new run of instructions in the line table. Instructions are attributed to the
+    *   source line of the run they fall in, so only changes of line need an entry.
+    */
+
+    void AddSourceLine ( int iInstrIndex, int iSourceLine )
+    {
+        // If no instructions were assembled since the last run started, the new run
+        // replaces it
+
+        if ( g_iLineTableSize && g_pLineTable [ g_iLineTableSize - 1 ].iInstrIndex == iInstrIndex )
+            -- g_iLineTableSize;
+
+        // If the line hasn't changed, the current run just continues. Instructions ahead of
+        // the first run have no line either.
+
+        int iPrevSourceLine = g_iLineTableSize ? g_pLineTable [ g_iLineTableSize - 1 ].iSourceLine : 0;
+        if ( iSourceLine == iPrevSourceLine )
+            return;
+
+        // Make room for the run, doubling the table's size if it's full
+
+        if ( g_iLineTableSize == g_iLineTableCapacity )
+        {
+            int iNewCapacity = g_iLineTableCapacity * 2;
+            if ( iNewCapacity < MIN_LINE_TABLE_SIZE )
+                iNewCapacity = MIN_LINE_TABLE_SIZE;
+
+            LineNode * pNewLineTable = ( LineNode * ) realloc ( g_pLineTable, iNewCapacity * sizeof ( LineNode ) );
+            if ( ! pNewLineTable )
+                ExitOnError ( "Could not allocate line table" );
+
+            g_pLineTable = pNewLineTable;
+            g_iLineTableCapacity = iNewCapacity;
+        }
+
+        g_pLineTable [ g_iLineTableSize ].iInstrIndex = iInstrIndex;
+        g_pLineTable [ g_iLineTableSize ].iSourceLine = iSourceLine;
+        ++ g_iLineTableSize;
+    }
+
+    /******************************************************************************************
+    *
+    *   AddJumpTable ()
+    *
+    *   Adds an empty jump table to the jump table table. Its entries are added as they're
+    *   read.
+    */
+
+    int AddJumpTable ( char * pstrIdent, int iBase, int iFuncIndex )
+    {
+        // If a jump table already exists, return -1
+
+        if ( GetJumpTableByIdent ( pstrIdent, iFuncIndex ) )
+            return -1;
+
+        // Create a new jump table node
+
+        JumpTableNode * pNewJumpTable = ( JumpTableNode * ) malloc ( sizeof ( JumpTableNode ) );
+
+        // Initialize the new jump table
+
+        strcpy ( pNewJumpTable->pstrIdent, pstrIdent );
+        pNewJumpTable->iFuncIndex = iFuncIndex;
+        pNewJumpTable->iBase = iBase;
+        pNewJumpTable->iSize = 0;
+        pNewJumpTable->piTargets = NULL;
+
+        // Add the jump table to the list and get its index, then add it to the hash table
+
+        int iIndex = AddNode ( & g_JumpTableTable, pNewJumpTable );
+        AddHashNode ( & g_JumpTableHashTable, HashString ( pstrIdent, iFuncIndex ), pNewJumpTable );
+
+        pNewJumpTable->iIndex = iIndex;
+
+        return iIndex;
+    }
+
     /******************************************************************************************
     *
     *   GetSymbolByIdent ()
@@ -2270,36 +3265,39 @@
 
     SymbolNode * GetSymbolByIdent ( char * pstrIdent, int iFuncIndex )
     {
-        // If the table is empty, return a NULL pointer
+        // Locals and parameters are hashed along with their function index, and globals
+        // with GLOBAL_SCOPE, so check the function's scope first and then the global scope
 
-        if ( ! g_SymbolTable.iNodeCount )
-            return NULL;
+        int pScopeList [ 2 ] = { iFuncIndex, GLOBAL_SCOPE };
 
-        // Create a pointer to traverse the list
+        for ( int iCurrScopeIndex = 0; iCurrScopeIndex < 2; ++ iCurrScopeIndex )
+        {
+            // Create a pointer to traverse the identifier's bucket in the symbol hash table
 
-        LinkedListNode * pCurrNode = g_SymbolTable.pHead;
+            LinkedListNode * pCurrNode = GetHashBucket ( & g_SymbolHashTable, HashString ( pstrIdent, pScopeList [ iCurrScopeIndex ] ) )->pHead;
 
-        // Traverse the list until the matching structure is found
+            // Traverse the bucket until the matching structure is found
 
-        for ( int iCurrNode = 0; iCurrNode < g_SymbolTable.iNodeCount; ++ iCurrNode )
-        {
-            // Create a pointer to the current symbol structure
+            while ( pCurrNode )
+            {
+                // Create a pointer to the current symbol structure
 
-            SymbolNode * pCurrSymbol = ( SymbolNode * ) pCurrNode->pData;
+                SymbolNode * pCurrSymbol = ( SymbolNode * ) pCurrNode->pData;
 
-            // See if the names match
+                // See if the names match
 
-            if ( strcmp ( pCurrSymbol->pstrIdent, pstrIdent ) == 0 )
+                if ( strcmp ( pCurrSymbol->pstrIdent, pstrIdent ) == 0 )
 
-                // If the functions match, or if the existing symbol is global, they match.
-                // Return the symbol.
+                    // If the functions match, or if the existing symbol is global, they match.
+                    // Return the symbol.
 
-                if ( pCurrSymbol->iFuncIndex == iFuncIndex || pCurrSymbol->iStackIndex >= 0 )
-                    return pCurrSymbol;
+                    if ( pCurrSymbol->iFuncIndex == iFuncIndex || pCurrSymbol->iStackIndex >= 0 )
+                        return pCurrSymbol;
 
-            // Otherwise move to the next node
+                // Otherwise move to the next node
 
-            pCurrNode = pCurrNode->pNext;
+                pCurrNode = pCurrNode->pNext;
+            }
         }
 
         // The structure was not found, so return a NULL pointer
@@ -2350,7 +3348,7 @@
     *   Adds a symbol to the symbol table.
     */
 
-    int AddSymbol ( char * pstrIdent, int iSize, int iStackIndex, int iFuncIndex )
+    int AddSymbol ( char * pstrIdent, int iSize, int iStackIndex, int iFuncIndex, int iIsParam )
     {
         // If a label already exists
 
@@ -2367,11 +3365,19 @@
         pNewSymbol->iSize = iSize;
         pNewSymbol->iStackIndex = iStackIndex;
         pNewSymbol->iFuncIndex = iFuncIndex;
+        pNewSymbol->iIsParam = iIsParam;
 
-        // Add the symbol to the list and get its index
+        // Add the symbol to the list and get its index, then add it to the hash table under
+        // its scope. Globals are the symbols with nonnegative stack indices.
 
         int iIndex = AddNode ( & g_SymbolTable, pNewSymbol );
 
+        int iScope = iFuncIndex;
+        if ( iStackIndex >= 0 )
+            iScope = GLOBAL_SCOPE;
+
+        AddHashNode ( & g_SymbolHashTable, HashString ( pstrIdent, iScope ), pNewSymbol );
+
 		// Set the symbol node's index
 
 		pNewSymbol->iIndex = iIndex;
@@ -2381,11 +3387,313 @@
 		return iIndex;
     }
 
+    /******************************************************************************************
+    *
+    *   GrowInstrStream ()
+    *
+    *   Makes sure the instruction stream has room for the current instruction, doubling its
+    *   size if it's full.
+    */
+
+    void GrowInstrStream ()
+    {
+        // If there's still room, there's nothing to do
+
+        if ( g_iCurrInstrIndex < g_iInstrStreamCapacity )
+            return;
+
+        // Double the stream's size, or start it at the minimum size
+
+        int iNewCapacity = g_iInstrStreamCapacity * 2;
+        if ( iNewCapacity < MIN_INSTR_STREAM_SIZE )
+            iNewCapacity = MIN_INSTR_STREAM_SIZE;
+
+        Instr * pNewInstrStream = ( Instr * ) realloc ( g_pInstrStream, iNewCapacity * sizeof ( Instr ) );
+        if ( ! pNewInstrStream )
+            ExitOnError ( "Could not allocate instruction stream" );
+
+        g_pInstrStream = pNewInstrStream;
+
+        // Initialize every new operand list pointer to NULL
+
+        for ( int iCurrInstrIndex = g_iInstrStreamCapacity; iCurrInstrIndex < iNewCapacity; ++ iCurrInstrIndex )
+            g_pInstrStream [ iCurrInstrIndex ].pOpList = NULL;
+
+        g_iInstrStreamCapacity = iNewCapacity;
+    }
+
+    /******************************************************************************************
+    *
+    *   SetMemRefOp ()
+    *
+    *   Sets an operand's stack index from the symbol it references, after making sure the
+    *   symbol is used properly: single variables can't be indexed, arrays must be, and arrays
+    *   can only be indexed by single variables. Array references indexed by a variable set
+    *   only the base index, and the index variable sets the offset index.
+    */
+
+    void SetMemRefOp ( Op * pOp, SymbolNode * pSymbol, int iMemRefType, int iOffsetIndex )
+    {
+        switch ( iMemRefType )
+        {
+            // A single variable
+
+            case MEM_REF_VAR:
+
+                // Make sure the variable isn't an array
+
+                if ( pSymbol->iSize > 1 )
+                    ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY_NOT_INDEXED );
+
+                pOp->iStackIndex = pSymbol->iStackIndex;
+                break;
+
+            // An array indexed by an integer or a variable
+
+            case MEM_REF_ARRAY_ABS:
+            case MEM_REF_ARRAY_REL:
+
+                // Make sure the identifier is an actual array
+
+                if ( pSymbol->iSize == 1 )
+                    ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY );
+
+                pOp->iStackIndex = pSymbol->iStackIndex + iOffsetIndex;
+                break;
+
+            // The variable indexing an array
+
+            case MEM_REF_ARRAY_INDEX:
+
+                // Make sure the index is a single variable as opposed to another array
+
+                if ( pSymbol->iSize > 1 )
+                    ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY_INDEX );
+
+                pOp->iOffsetIndex = pSymbol->iStackIndex;
+                break;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   AddFixup ()
+    *
+    *   Records an unresolved reference from an operand of the current instruction, along
+    *   with the lexer's current position for error reporting, and returns it.
+    */
+
+    Fixup * AddFixup ( LinkedList * pList, int iType, char * pstrIdent, int iFuncIndex, int iOpIndex, int iMemRefType )
+    {
+        // Create a new fixup
+
+        Fixup * pNewFixup = ( Fixup * ) malloc ( sizeof ( Fixup ) );
+
+        // Initialize it
+
+        pNewFixup->iType = iType;
+        strcpy ( pNewFixup->pstrIdent, pstrIdent );
+        pNewFixup->iFuncIndex = iFuncIndex;
+        pNewFixup->iInstrIndex = g_iCurrInstrIndex;
+        pNewFixup->iOpIndex = iOpIndex;
+        pNewFixup->iMemRefType = iMemRefType;
+        pNewFixup->iOffsetIndex = 0;
+        pNewFixup->iSourceLine = g_Lexer.iCurrSourceLine;
+        pNewFixup->iLexemeIndex = g_Lexer.iIndex0;
+
+        // Add it to the list
+
+        AddNode ( pList, pNewFixup );
+
+        return pNewFixup;
+    }
+
+    /******************************************************************************************
+    *
+    *   ResolveFixup ()
+    *
+    *   Backpatches the operand a fixup refers to. Undefined line labels and functions are
+    *   errors, but a memory reference that can't be resolved yet may still be to a global
+    *   declared further down, so FALSE is returned instead. The lexer is moved to the
+    *   reference so errors are reported at the right place.
+    *
+    *   Jump table entries aren't operands, so their fixups use the instruction and operand
+    *   indices to store the table and entry indices instead.
+    */
+
+    int ResolveFixup ( Fixup * pFixup )
+    {
+        // Move the lexer to the reference
+
+        g_Lexer.iCurrSourceLine = pFixup->iSourceLine;
+        g_Lexer.iIndex0 = pFixup->iLexemeIndex;
+
+        // Get a pointer to the operand being patched
+
+        Op * pOp = NULL;
+        if ( pFixup->iType != FIXUP_TYPE_JUMP_TABLE_ENTRY )
+            pOp = & g_pInstrStream [ pFixup->iInstrIndex ].pOpList [ pFixup->iOpIndex ];
+
+        // Patch the operand based on the fixup's type
+
+        switch ( pFixup->iType )
+        {
+            // Line labels
+
+            case FIXUP_TYPE_LINE_LABEL:
+            {
+                LabelNode * pLabel = GetLabelByIdent ( pFixup->pstrIdent, pFixup->iFuncIndex );
+
+                if ( ! pLabel )
+                    ExitOnCodeError ( ERROR_MSSG_UNDEFINED_LINE_LABEL );
+
+                pOp->iInstrIndex = pLabel->iTargetIndex;
+                break;
+            }
+
+            // Function names
+
+            case FIXUP_TYPE_FUNC:
+            {
+                FuncNode * pFunc = GetFuncByName ( pFixup->pstrIdent );
+
+                if ( ! pFunc )
+                    ExitOnCodeError ( ERROR_MSSG_UNDEFINED_FUNC );
+
+                pOp->iFuncIndex = pFunc->iIndex;
+                break;
+            }
+
+            // Variables, arrays and parameters
+
+            case FIXUP_TYPE_MEM_REF:
+            {
+                SymbolNode * pSymbol = GetSymbolByIdent ( pFixup->pstrIdent, pFixup->iFuncIndex );
+
+                if ( ! pSymbol )
+                    return FALSE;
+
+                SetMemRefOp ( pOp, pSymbol, pFixup->iMemRefType, pFixup->iOffsetIndex );
+                break;
+            }
+
+            // Jump tables
+
+            case FIXUP_TYPE_JUMP_TABLE:
+            {
+                JumpTableNode * pJumpTable = GetJumpTableByIdent ( pFixup->pstrIdent, pFixup->iFuncIndex );
+
+                if ( ! pJumpTable )
+                    ExitOnCodeError ( ERROR_MSSG_UNDEFINED_JUMP_TABLE );
+
+                pOp->iJumpTableIndex = pJumpTable->iIndex;
+                break;
+            }
+
+            // Jump table entries
+
+            case FIXUP_TYPE_JUMP_TABLE_ENTRY:
+            {
+                LabelNode * pLabel = GetLabelByIdent ( pFixup->pstrIdent, pFixup->iFuncIndex );
+
+                if ( ! pLabel )
+                    ExitOnCodeError ( ERROR_MSSG_UNDEFINED_LINE_LABEL );
+
+                // Find the table by its index, which is also its position in the list
+
+                LinkedListNode * pCurrNode = g_JumpTableTable.pHead;
+                for ( int iCurrNode = 0; iCurrNode < pFixup->iInstrIndex; ++ iCurrNode )
+                    pCurrNode = pCurrNode->pNext;
+
+                JumpTableNode * pJumpTable = ( JumpTableNode * ) pCurrNode->pData;
+                pJumpTable->piTargets [ pFixup->iOpIndex ] = pLabel->iTargetIndex;
+                break;
+            }
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   ResolveFuncFixups ()
+    *
+    *   Backpatches the current function's forward references when it closes. Memory
+    *   references that still can't be resolved are passed on to the global fixup list.
+    */
+
+    void ResolveFuncFixups ()
+    {
+        // Save the lexer's position, since ResolveFixup () moves it
+
+        int iCurrSourceLine = g_Lexer.iCurrSourceLine;
+        unsigned int iIndex0 = g_Lexer.iIndex0;
+
+        // Resolve each fixup in the list
+
+        LinkedListNode * pCurrNode = g_FuncFixupList.pHead;
+
+        while ( pCurrNode )
+        {
+            // If the fixup can't be resolved yet, move it to the global list. Clearing the
+            // node's data keeps it from being freed along with the function's list.
+
+            if ( ! ResolveFixup ( ( Fixup * ) pCurrNode->pData ) )
+            {
+                AddNode ( & g_GlobalFixupList, pCurrNode->pData );
+                pCurrNode->pData = NULL;
+            }
+
+            pCurrNode = pCurrNode->pNext;
+        }
+
+        // Restore the lexer's position
+
+        g_Lexer.iCurrSourceLine = iCurrSourceLine;
+        g_Lexer.iIndex0 = iIndex0;
+
+        // Empty the list for the next function
+
+        FreeLinkedList ( & g_FuncFixupList );
+        InitLinkedList ( & g_FuncFixupList );
+    }
+
+    /******************************************************************************************
+    *
+    *   ResolveGlobalFixups ()
+    *
+    *   Backpatches the remaining forward references once the entire source has been read.
+    */
+
+    void ResolveGlobalFixups ()
+    {
+        // Resolve each fixup in the list, at which point any unresolved memory reference is
+        // to an undefined identifier
+
+        LinkedListNode * pCurrNode = g_GlobalFixupList.pHead;
+
+        while ( pCurrNode )
+        {
+            if ( ! ResolveFixup ( ( Fixup * ) pCurrNode->pData ) )
+                ExitOnCodeError ( ERROR_MSSG_UNDEFINED_IDENT );
+
+            pCurrNode = pCurrNode->pNext;
+        }
+
+        // Free the list
+
+        FreeLinkedList ( & g_GlobalFixupList );
+        InitLinkedList ( & g_GlobalFixupList );
+    }
+
     /******************************************************************************************
     *
     *   AssmblSourceFile ()
     *
-    *   Initializes the master instruction lookup table.
+    *   Assembles the source file into the instruction stream in a single pass. References
+    *   that can't be resolved when they're read, such as forward line labels and calls to
+    *   functions defined further down, are recorded as fixups and backpatched once their
+    *   targets are known.
     */
 
     void AssmblSourceFile ()
@@ -2400,8 +3708,12 @@
         g_iInstrStreamSize = 0;
         g_iIsSetStackSizeFound = FALSE;
         g_iIsSetPriorityFound = FALSE;
+        g_iIsSetSourceFileFound = FALSE;
         g_ScriptHeader.iGlobalDataSize = 0;
 
+        g_pstrLineSourceFilename [ 0 ] = '\0';
+        g_iLineTableSize = 0;
+
         // Set the current function's flags and variables
 
         int iIsFuncActive = FALSE;
@@ -2411,12 +3723,29 @@
         int iCurrFuncParamCount = 0;
         int iCurrFuncLocalDataSize = 0;
 
+        // Keep track of the last symbol declared before the current function, so the
+        // function's own symbols can be found when it closes
+
+        LinkedListNode * pPrevFuncSymbolNode = NULL;
+
         // Create an instruction definition structure to hold instruction information when
         // dealing with instructions.
 
         InstrLookup CurrInstr;
 
-        // ---- Perform first pass over the source
+        // ---- Allocate the instruction stream
+
+        // The stream starts small and grows as instructions are assembled
+
+        g_pInstrStream = NULL;
+        g_iInstrStreamCapacity = 0;
+        GrowInstrStream ();
+
+        // Set the current instruction index to zero
+
+        g_iCurrInstrIndex = 0;
+
+        // ---- Assemble the source
 
         // Reset the lexer
 
@@ -2583,13 +3912,15 @@
 
                     // Determine the variable's index into the stack
 
-                    // If the variable is local, then its stack index is always the local data
-                    // size + 2 subtracted from zero
+                    // If the variable is local, then its stack index is the local data size
+                    // + 1 + its own size subtracted from zero. Array elements are addressed
+                    // upwards from this base index, so the whole array has to sit below the
+                    // locals declared before it.
 
                     int iStackIndex;
 
                     if ( iIsFuncActive )
-                        iStackIndex = -( iCurrFuncLocalDataSize + 2 );
+                        iStackIndex = -( iCurrFuncLocalDataSize + 1 + iSize );
 
                     // Otherwise it's global, so it's equal to the current global data size
 
@@ -2598,7 +3929,7 @@
 
                     // Attempt to add the symbol to the table
 
-                    if ( AddSymbol ( pstrIdent, iSize, iStackIndex, iCurrFuncIndex ) == -1 )
+                    if ( AddSymbol ( pstrIdent, iSize, iStackIndex, iCurrFuncIndex, FALSE ) == -1 )
                         ExitOnCodeError ( ERROR_MSSG_IDENT_REDEFINITION );
 
                     // Depending on the scope, increment either the local or global data size
@@ -2629,11 +3960,10 @@
 
                     char * pstrFuncName = GetCurrLexeme ();
 
-                    // Calculate the function's entry point, which is the instruction immediately
-                    // following the current one, which is in turn equal to the instruction stream
-                    // size
+                    // Calculate the function's entry point, which is the next instruction to be
+                    // assembled
 
-                    int iEntryPoint = g_iInstrStreamSize;
+                    int iEntryPoint = g_iCurrInstrIndex;
 
                     // Try adding it to the function table, and print an error if it's already
                     // been declared
@@ -2655,9 +3985,11 @@
 
                     iIsFuncActive = TRUE;
                     strcpy ( pstrCurrFuncName, pstrFuncName );
+                    pCurrFunc = GetFuncByName ( pstrCurrFuncName );
                     iCurrFuncIndex = iFuncIndex;
                     iCurrFuncParamCount = 0;
                     iCurrFuncLocalDataSize = 0;
+                    pPrevFuncSymbolNode = g_SymbolTable.pTail;
 
                     // Read any number of line breaks until the opening brace is found
 
@@ -2668,18 +4000,13 @@
                     if ( g_Lexer.CurrToken != TOKEN_TYPE_OPEN_BRACE )
                         ExitOnCharExpectedError ( '{' );
 
-                    // All functions are automatically appended with Ret, so increment the
-                    // required size of the instruction stream
-
-                    ++ g_iInstrStreamSize;
-
                     break;
                 }
 
                 // Closing bracket
 
                 case TOKEN_TYPE_CLOSE_BRACE:
-
+                {
                     // This should be closing a function, so make sure we're in one
 
                     if ( ! iIsFuncActive )
@@ -2689,258 +4016,267 @@
 
                     SetFuncInfo ( pstrCurrFuncName, iCurrFuncParamCount, iCurrFuncLocalDataSize );
 
-                    // Close the function
-
-                    iIsFuncActive = FALSE;
-
-                    break;
-
-                // Param
-
-                case TOKEN_TYPE_PARAM:
-                {
-                    // If we aren't currently in a function, print an error
-
-                    if ( ! iIsFuncActive )
-                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_PARAM );
-
-					// _Main () can't accept parameters, so make sure we aren't in it
+                    // Now that the local data size is known, move each of the function's
+                    // parameters below its local data. Parameters were given stack indices of
+                    // -( N + 1 ) when they were declared, so they end up at
+                    // -( LocalDataSize + 2 + ( N + 1 ) ).
 
-					if ( strcmp ( pstrCurrFuncName, MAIN_FUNC_NAME ) == 0 )
-						ExitOnCodeError ( ERROR_MSSG_MAIN_PARAM );
+                    LinkedListNode * pCurrNode;
+                    if ( pPrevFuncSymbolNode )
+                        pCurrNode = pPrevFuncSymbolNode->pNext;
+                    else
+                        pCurrNode = g_SymbolTable.pHead;
 
-                    // The parameter's identifier should follow
+                    while ( pCurrNode )
+                    {
+                        SymbolNode * pCurrSymbol = ( SymbolNode * ) pCurrNode->pData;
 
-                    if ( GetNextToken () != TOKEN_TYPE_IDENT )
-                        ExitOnCodeError ( ERROR_MSSG_IDENT_EXPECTED );
+                        if ( pCurrSymbol->iIsParam )
+                            pCurrSymbol->iStackIndex -= iCurrFuncLocalDataSize + 2;
 
-                    // Increment the current function's local data size
+                        pCurrNode = pCurrNode->pNext;
+                    }
 
-                    ++ iCurrFuncParamCount;
+                    // Backpatch the function's forward line label and parameter references
 
-                    break;
-                }
+                    ResolveFuncFixups ();
 
-				// ---- Instructions
+                    // Make room for the closing instruction
 
-				case TOKEN_TYPE_INSTR:
-				{
-                    // Make sure we aren't in the global scope, since instructions
-                    // can only appear in functions
+                    GrowInstrStream ();
 
-                    if ( ! iIsFuncActive )
-                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_INSTR );
+                    // If the ending function is _Main (), append an Exit instruction
 
-                    // Increment the instruction stream size
+                    if ( strcmp ( pCurrFunc->pstrName, MAIN_FUNC_NAME ) == 0 )
+                    {
+                        // First set the opcode
 
-                    ++ g_iInstrStreamSize;
+                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = INSTR_EXIT;
 
-					break;
-				}
+                        // Now set the operand count
 
-                // ---- Identifiers (line labels)
+                        g_pInstrStream [ g_iCurrInstrIndex ].iOpCount = 1;
 
-                case TOKEN_TYPE_IDENT:
-                {
-                    // Make sure it's a line label
+                        // Now set the return code by allocating space for a single operand and
+                        // setting it to zero
 
-                    if ( GetLookAheadChar () != ':' )
-                        ExitOnCodeError ( ERROR_MSSG_INVALID_INSTR );
+                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList = ( Op * ) malloc ( sizeof ( Op ) );
+                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList [ 0 ].iType = OP_TYPE_INT;
+                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList [ 0 ].iIntLiteral = 0;
+                    }
 
-                    // Make sure we're in a function, since labels can only appear there
+                    // Otherwise append a Ret instruction and make sure to NULLify the operand
+                    // list pointer
 
-                    if ( ! iIsFuncActive )
-                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_LINE_LABEL );
+                    else
+                    {
+                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = INSTR_RET;
+						g_pInstrStream [ g_iCurrInstrIndex ].iOpCount = 0;
+                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList = NULL;
+                    }
 
-                    // The current lexeme is the label's identifier
+                    ++ g_iCurrInstrIndex;
 
-                    char * pstrIdent = GetCurrLexeme ();
+                    // End the function's last run of source lines, so it doesn't carry over
+                    // into the next function
 
-                    // The target instruction is always the value of the current
-                    // instruction count, which is the current size - 1
+                    AddSourceLine ( g_iCurrInstrIndex, 0 );
 
-                    int iTargetIndex = g_iInstrStreamSize - 1;
+                    // Close the function
 
-                    // Save the label's function index as well
+                    iIsFuncActive = FALSE;
 
-                    int iFuncIndex = iCurrFuncIndex;
+                    break;
+                }
 
-                    // Try adding the label to the label table, and print an error if it
-                    // already exists
+                // Param
 
-                    if ( AddLabel ( pstrIdent, iTargetIndex, iFuncIndex ) == -1 )
-                        ExitOnCodeError ( ERROR_MSSG_LINE_LABEL_REDEFINITION );
+                case TOKEN_TYPE_PARAM:
+                {
+                    // If we aren't currently in a function, print an error
 
-                    break;
-                }
+                    if ( ! iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_PARAM );
 
-                default:
+					// _Main () can't accept parameters, so make sure we aren't in it
 
-                    // Anything else should cause an error, minus line breaks
+					if ( strcmp ( pstrCurrFuncName, MAIN_FUNC_NAME ) == 0 )
+						ExitOnCodeError ( ERROR_MSSG_MAIN_PARAM );
 
-                    if ( g_Lexer.CurrToken != TOKEN_TYPE_NEWLINE )
-                        ExitOnCodeError ( ERROR_MSSG_INVALID_INPUT );
-            }
+                    // The parameter's identifier should follow
 
-            // Skip to the next line, since the initial tokens are all we're really worrid
-            // about in this phase
+                    if ( GetNextToken () != TOKEN_TYPE_IDENT )
+                        ExitOnCodeError ( ERROR_MSSG_IDENT_EXPECTED );
 
-            if ( ! SkipToNextLine () )
-                break;
-        }
+					// Add the parameter to the symbol table. Its stack index depends on the
+					// function's local data size, which isn't known until the function
+					// closes, so only its position in the parameter list is stored for now.
 
-        // We counted the instructions, so allocate the assembled instruction stream array
-        // so the next phase can begin
+					if ( AddSymbol ( GetCurrLexeme (), 1, -( iCurrFuncParamCount + 1 ), iCurrFuncIndex, TRUE ) == -1 )
+						ExitOnCodeError ( ERROR_MSSG_IDENT_REDEFINITION );
 
-        g_pInstrStream = ( Instr * ) malloc ( g_iInstrStreamSize * sizeof ( Instr ) );
+                    // Increment the current parameter count
 
-        // Initialize every operand list pointer to NULL
+                    ++ iCurrFuncParamCount;
 
-        for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_iInstrStreamSize; ++ iCurrInstrIndex )
-            g_pInstrStream [ iCurrInstrIndex ].pOpList = NULL;
+                    break;
+                }
 
-        // Set the current instruction index to zero
+                // JumpTable
 
-        g_iCurrInstrIndex = 0;
+                case TOKEN_TYPE_JUMPTABLE:
+                {
+                    // Jump tables map values to line labels, so like labels they can only
+                    // appear in functions
 
-        // ---- Perform the second pass over the source
+                    if ( ! iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_JUMP_TABLE );
 
-        // Reset the lexer so we begin at the top of the source again
+                    // Get the table's identifier
 
-        ResetLexer ();
+                    if ( GetNextToken () != TOKEN_TYPE_IDENT )
+                        ExitOnCodeError ( ERROR_MSSG_IDENT_EXPECTED );
 
-        // Loop through each line of code
+                    char pstrIdent [ MAX_IDENT_SIZE ];
+                    strcpy ( pstrIdent, GetCurrLexeme () );
 
-        while ( TRUE )
-        {
-            // Get the next token and make sure we aren't at the end of the stream
+                    if ( GetNextToken () != TOKEN_TYPE_COMMA )
+                        ExitOnCharExpectedError ( ',' );
 
-            if ( GetNextToken () == END_OF_TOKEN_STREAM )
-                break;
+                    // Read the value of the first entry
 
-            // Check the initial token
+                    if ( GetNextToken () != TOKEN_TYPE_INT )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_JUMP_TABLE_BASE );
 
-            switch ( g_Lexer.CurrToken )
-            {
-                // Func
+                    int iBase = atoi ( GetCurrLexeme () );
 
-                case TOKEN_TYPE_FUNC:
-                {
-                    // We've encountered a Func directive, but since we validated the syntax
-                    // of all functions in the previous phase, we don't need to perform any
-                    // error handling here and can assume the syntax is perfect.
+                    // Add the table
 
-                    // Read the identifier
+                    int iJumpTableIndex = AddJumpTable ( pstrIdent, iBase, iCurrFuncIndex );
+                    if ( iJumpTableIndex == -1 )
+                        ExitOnCodeError ( ERROR_MSSG_JUMP_TABLE_REDEFINITION );
 
-                    GetNextToken ();
+                    JumpTableNode * pJumpTable = GetJumpTableByIdent ( pstrIdent, iCurrFuncIndex );
 
-                    // Use the identifier (the current lexeme) to get it's corresponding function
-                    // from the table
+                    // Read each entry's line label until the end of the line
 
-                    pCurrFunc = GetFuncByName ( GetCurrLexeme () );
+                    while ( GetNextToken () == TOKEN_TYPE_COMMA )
+                    {
+                        if ( GetNextToken () != TOKEN_TYPE_IDENT )
+                            ExitOnCodeError ( ERROR_MSSG_IDENT_EXPECTED );
 
-                    // Set the active function flag
+                        char * pstrLabelIdent = GetCurrLexeme ();
 
-                    iIsFuncActive = TRUE;
+                        // Make room for the entry
 
-					// Set the parameter count to zero, since we'll need to count parameters as
-					// we parse Param directives
+                        int iEntryIndex = pJumpTable->iSize;
+                        ++ pJumpTable->iSize;
+                        pJumpTable->piTargets = ( int * ) realloc ( pJumpTable->piTargets, pJumpTable->iSize * sizeof ( int ) );
 
-					iCurrFuncParamCount = 0;
+                        // Set the entry's target now, or backpatch it when the function
+                        // closes if the label hasn't been reached yet
 
-					// Save the function's index
+                        LabelNode * pLabel = GetLabelByIdent ( pstrLabelIdent, iCurrFuncIndex );
 
-					iCurrFuncIndex = pCurrFunc->iIndex;
+                        if ( pLabel )
+                        {
+                            pJumpTable->piTargets [ iEntryIndex ] = pLabel->iTargetIndex;
+                        }
+                        else
+                        {
+                            Fixup * pFixup = AddFixup ( & g_FuncFixupList, FIXUP_TYPE_JUMP_TABLE_ENTRY, pstrLabelIdent, iCurrFuncIndex, iEntryIndex, 0 );
+                            pFixup->iInstrIndex = iJumpTableIndex;
+                        }
+                    }
 
-                    // Read any number of line breaks until the opening brace is found
+                    // Make sure the table has at least one entry and nothing else follows it
 
-                    while ( GetNextToken () == TOKEN_TYPE_NEWLINE );
+                    if ( g_Lexer.CurrToken != TOKEN_TYPE_NEWLINE || pJumpTable->iSize == 0 )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_INPUT );
 
                     break;
                 }
 
-                // Closing brace
+                // SetSourceFile
 
-                case TOKEN_TYPE_CLOSE_BRACE:
+                case TOKEN_TYPE_SETSOURCEFILE:
                 {
-                    // Clear the active function flag
-
-                    iIsFuncActive = FALSE;
-
-                    // If the ending function is _Main (), append an Exit instruction
-
-                    if ( strcmp ( pCurrFunc->pstrName, MAIN_FUNC_NAME ) == 0 )
-                    {
-                        // First set the opcode
+                    // Like the other header directives, SetSourceFile can only be found once
+                    // in the global scope
 
-                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = INSTR_EXIT;
+                    if ( iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_LOCAL_SETSOURCEFILE );
 
-                        // Now set the operand count
+                    if ( g_iIsSetSourceFileFound )
+                        ExitOnCodeError ( ERROR_MSSG_MULTIPLE_SETSOURCEFILES );
 
-                        g_pInstrStream [ g_iCurrInstrIndex ].iOpCount = 1;
+                    // Read the filename, which is a non-empty string
 
-                        // Now set the return code by allocating space for a single operand and
-                        // setting it to zero
+                    if ( GetNextToken () != TOKEN_TYPE_QUOTE )
+                        ExitOnCharExpectedError ( '"' );
 
-                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList = ( Op * ) malloc ( sizeof ( Op ) );
-                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList [ 0 ].iType = OP_TYPE_INT;
-                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList [ 0 ].iIntLiteral = 0;
-                    }
+                    if ( GetNextToken () != TOKEN_TYPE_STRING || strlen ( GetCurrLexeme () ) >= MAX_FILENAME_SIZE )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_STRING );
 
-                    // Otherwise append a Ret instruction and make sure to NULLify the operand
-                    // list pointer
+                    strcpy ( g_pstrLineSourceFilename, GetCurrLexeme () );
 
-                    else
-                    {
-                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = INSTR_RET;
-						g_pInstrStream [ g_iCurrInstrIndex ].iOpCount = 0;
-                        g_pInstrStream [ g_iCurrInstrIndex ].pOpList = NULL;
-                    }
+                    if ( GetNextToken () != TOKEN_TYPE_QUOTE )
+                        ExitOnCharExpectedError ( '"' );
 
-                    ++ g_iCurrInstrIndex;
+                    g_iIsSetSourceFileFound = TRUE;
 
                     break;
                 }
 
-                // Param
+                // SourceLine
 
-                case TOKEN_TYPE_PARAM:
+                case TOKEN_TYPE_SOURCELINE:
                 {
-					// Read the next token to get the identifier
+                    // Source lines annotate the instructions that follow them, so they can
+                    // only appear in functions
 
-					if ( GetNextToken () != TOKEN_TYPE_IDENT )
-						ExitOnCodeError ( ERROR_MSSG_IDENT_EXPECTED );
+                    if ( ! iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_SOURCE_LINE );
 
-					// Read the identifier, which is the current lexeme
+                    // Read the line number and start a new run with it
 
-					char * pstrIdent = GetCurrLexeme ();
+                    if ( GetNextToken () != TOKEN_TYPE_INT || atoi ( GetCurrLexeme () ) < 0 )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_SOURCE_LINE );
 
-					// Calculate the parameter's stack index
+                    AddSourceLine ( g_iCurrInstrIndex, atoi ( GetCurrLexeme () ) );
 
-					int iStackIndex = -( pCurrFunc->iLocalDataSize + 2 + ( iCurrFuncParamCount + 1 ) );
+                    break;
+                }
 
-					// Add the parameter to the symbol table
+				// ---- Instructions
 
-					if ( AddSymbol ( pstrIdent, 1, iStackIndex, iCurrFuncIndex ) == -1 )
-						ExitOnCodeError ( ERROR_MSSG_IDENT_REDEFINITION );
+				case TOKEN_TYPE_INSTR:
+				{
+                    // Make sure we aren't in the global scope, since instructions
+                    // can only appear in functions
 
-                    // Increment the current parameter count
-					++ iCurrFuncParamCount;
+                    if ( ! iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_INSTR );
 
-                    break;
-                }
+                    // Make room for the instruction in the stream
 
-                // Instructions
+                    GrowInstrStream ();
 
-                case TOKEN_TYPE_INSTR:
-                {
 	                // Get the instruction's info using the current lexeme (the mnemonic )
 
                     GetInstrByMnemonic ( GetCurrLexeme (), & CurrInstr );
 
-                    // Write the opcode to the stream
+                    // Write the opcode to the stream, as it appears in older executables
+                    // if that's what is being built
 
-                    g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = CurrInstr.iOpcode;
+                    if ( g_iIsLegacyXSE )
+                    {
+                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = GetLegacyOpcode ( CurrInstr.iOpcode );
+                        if ( g_pInstrStream [ g_iCurrInstrIndex ].iOpcode == -1 )
+                            ExitOnCodeError ( ERROR_MSSG_LEGACY_INSTR );
+                    }
+                    else
+                        g_pInstrStream [ g_iCurrInstrIndex ].iOpcode = CurrInstr.iOpcode;
 
                     // Write the operand count to the stream
 
@@ -3043,7 +4379,7 @@
 								            // Add the string to the table, or get the index of
                                             // the existing copy
 
-								            int iStringIndex = AddString ( & g_StringTable, pstrString );
+								            int iStringIndex = AddString ( & g_StringTable, & g_StringHashTable, pstrString );
 
 								            // Make sure the closing double-quote is present
 
@@ -3115,43 +4451,39 @@
 									char pstrIdent [ MAX_IDENT_SIZE ];
 									strcpy ( pstrIdent, GetCurrLexeme () );
 
-									// Make sure the variable/array has been defined
-
-									if ( ! GetSymbolByIdent ( pstrIdent, iCurrFuncIndex ) )
-										ExitOnCodeError ( ERROR_MSSG_UNDEFINED_IDENT );
-
-									// Get the identifier's index as well; it may either be
-									// an absolute index or a base index
+									// Look up the variable/array. If it hasn't been declared
+									// yet, or if it's a parameter, its stack index isn't known
+									// yet either, so the reference is recorded as a fixup and
+									// patched when the function closes.
 
-									int iBaseIndex = GetStackIndexByIdent ( pstrIdent, iCurrFuncIndex );
+									SymbolNode * pSymbol = GetSymbolByIdent ( pstrIdent, iCurrFuncIndex );
+									Fixup * pFixup = NULL;
 
 									// Use the lookahead character to find out whether or not
 									// we're parsing an array
 
-									if ( GetLookAheadChar () != '[' )
-									{
-										// It's just a single identifier so the base index we
-										// already saved is the variable's stack index
+									int iMemRefType = MEM_REF_VAR;
+									if ( GetLookAheadChar () == '[' )
+										iMemRefType = MEM_REF_ARRAY_REL;
 
-										// Make sure the variable isn't an array
+									// Set the operand's base index, which also makes sure the
+									// identifier is or isn't an array as appropriate
 
-										if ( GetSizeByIdent ( pstrIdent, iCurrFuncIndex ) > 1 )
-											ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY_NOT_INDEXED );
+									if ( ! pSymbol || pSymbol->iIsParam )
+										pFixup = AddFixup ( & g_FuncFixupList, FIXUP_TYPE_MEM_REF, pstrIdent, iCurrFuncIndex, iCurrOpIndex, iMemRefType );
+									else
+										SetMemRefOp ( & pOpList [ iCurrOpIndex ], pSymbol, iMemRefType, 0 );
 
-										// Set the operand type to stack index and set the data
-										// field
+									if ( iMemRefType == MEM_REF_VAR )
+									{
+										// It's just a single identifier so the base index is the
+										// variable's stack index. Set the operand type to stack
+										// index.
 
 										pOpList [ iCurrOpIndex ].iType = OP_TYPE_ABS_STACK_INDEX;
-										pOpList [ iCurrOpIndex ].iIntLiteral = iBaseIndex;
 									}
 									else
 									{
-										// It's an array, so lets verify that the identifier is
-										// an actual array
-
-										if ( GetSizeByIdent ( pstrIdent, iCurrFuncIndex ) == 1 )
-											ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY );
-
 										// First make sure the open brace is valid
 
 										if ( GetNextToken () != TOKEN_TYPE_OPEN_BRACKET )
@@ -3174,7 +4506,16 @@
 											// index
 
 											pOpList [ iCurrOpIndex ].iType = OP_TYPE_ABS_STACK_INDEX;
-											pOpList [ iCurrOpIndex ].iStackIndex = iBaseIndex + iOffsetIndex;
+
+											if ( pFixup )
+											{
+												pFixup->iMemRefType = MEM_REF_ARRAY_ABS;
+												pFixup->iOffsetIndex = iOffsetIndex;
+											}
+											else
+											{
+												pOpList [ iCurrOpIndex ].iStackIndex += iOffsetIndex;
+											}
 										}
 										else if ( IndexToken == TOKEN_TYPE_IDENT )
 										{
@@ -3182,24 +4523,21 @@
 
 											char * pstrIndexIdent = GetCurrLexeme ();
 
-											// Make sure the index is a valid array index, in
-											// that the identifier represents a single variable
-											// as opposed to another array
+											// Set the operand type to relative stack index
 
-											if ( ! GetSymbolByIdent ( pstrIndexIdent, iCurrFuncIndex ) )
-												ExitOnCodeError ( ERROR_MSSG_UNDEFINED_IDENT );
-
-											if ( GetSizeByIdent ( pstrIndexIdent, iCurrFuncIndex ) > 1 )
-												ExitOnCodeError ( ERROR_MSSG_INVALID_ARRAY_INDEX );
+											pOpList [ iCurrOpIndex ].iType = OP_TYPE_REL_STACK_INDEX;
 
-											// Get the variable's stack index and set the operand
-											// type to relative stack index
+											// Set the index variable's stack index, which also
+											// makes sure the identifier represents a single
+											// variable as opposed to another array. It may need
+											// a fixup of its own.
 
-											int iOffsetIndex = GetStackIndexByIdent ( pstrIndexIdent, iCurrFuncIndex );
+											SymbolNode * pIndexSymbol = GetSymbolByIdent ( pstrIndexIdent, iCurrFuncIndex );
 
-											pOpList [ iCurrOpIndex ].iType = OP_TYPE_REL_STACK_INDEX;
-											pOpList [ iCurrOpIndex ].iStackIndex = iBaseIndex;
-											pOpList [ iCurrOpIndex ].iOffsetIndex = iOffsetIndex;
+											if ( ! pIndexSymbol || pIndexSymbol->iIsParam )
+												AddFixup ( & g_FuncFixupList, FIXUP_TYPE_MEM_REF, pstrIndexIdent, iCurrFuncIndex, iCurrOpIndex, MEM_REF_ARRAY_INDEX );
+											else
+												SetMemRefOp ( & pOpList [ iCurrOpIndex ], pIndexSymbol, MEM_REF_ARRAY_INDEX, 0 );
 										}
 										else
 										{
@@ -3227,16 +4565,17 @@
 
 									LabelNode * pLabel = GetLabelByIdent ( pstrLabelIdent, iCurrFuncIndex );
 
-									// Make sure the label exists
-
-									if ( ! pLabel )
-										ExitOnCodeError ( ERROR_MSSG_UNDEFINED_LINE_LABEL );
-
 									// Set the operand type to instruction index and set the
-									// data field
+									// data field. If the label hasn't been reached yet, it's a
+									// forward reference that will be backpatched when the
+									// function closes.
 
 									pOpList [ iCurrOpIndex ].iType = OP_TYPE_INSTR_INDEX;
-									pOpList [ iCurrOpIndex ].iInstrIndex = pLabel->iTargetIndex;
+
+									if ( pLabel )
+										pOpList [ iCurrOpIndex ].iInstrIndex = pLabel->iTargetIndex;
+									else
+										AddFixup ( & g_FuncFixupList, FIXUP_TYPE_LINE_LABEL, pstrLabelIdent, iCurrFuncIndex, iCurrOpIndex, 0 );
 								}
 
 								// Parse a function name
@@ -3251,16 +4590,40 @@
 
 									FuncNode * pFunc = GetFuncByName ( pstrFuncName );
 
-									// Make sure the function exists
-
-									if ( ! pFunc )
-										ExitOnCodeError ( ERROR_MSSG_UNDEFINED_FUNC );
-
 									// Set the operand type to function index and set its data
-									// field
+									// field. If the function hasn't been defined yet, it's a
+									// forward reference that will be backpatched at the end of
+									// the source.
 
 									pOpList [ iCurrOpIndex ].iType = OP_TYPE_FUNC_INDEX;
-									pOpList [ iCurrOpIndex ].iFuncIndex = pFunc->iIndex;
+
+									if ( pFunc )
+										pOpList [ iCurrOpIndex ].iFuncIndex = pFunc->iIndex;
+									else
+										AddFixup ( & g_GlobalFixupList, FIXUP_TYPE_FUNC, pstrFuncName, iCurrFuncIndex, iCurrOpIndex, 0 );
+								}
+
+								// Parse a jump table
+
+								if ( CurrOpTypes & OP_FLAG_TYPE_JUMP_TABLE )
+								{
+									// Get the current lexeme, which is the table's
+									// identifier
+
+									char * pstrJumpTableIdent = GetCurrLexeme ();
+
+									// Tables are usually defined ahead of their JTab, but
+									// a forward reference is backpatched when the function
+									// closes
+
+									JumpTableNode * pJumpTable = GetJumpTableByIdent ( pstrJumpTableIdent, iCurrFuncIndex );
+
+									pOpList [ iCurrOpIndex ].iType = OP_TYPE_JUMP_TABLE_INDEX;
+
+									if ( pJumpTable )
+										pOpList [ iCurrOpIndex ].iJumpTableIndex = pJumpTable->iIndex;
+									else
+										AddFixup ( & g_FuncFixupList, FIXUP_TYPE_JUMP_TABLE, pstrJumpTableIdent, iCurrFuncIndex, iCurrOpIndex, 0 );
 								}
 
 								// Parse a host API call
@@ -3274,7 +4637,7 @@
 									// Add the call to the table, or get the index of the
 									// existing copy
 
-									int iIndex = AddString ( & g_HostAPICallTable, pstrHostAPICall );
+									int iIndex = AddString ( & g_HostAPICallTable, & g_HostAPICallHashTable, pstrHostAPICall );
 
 									// Set the operand type to host API call index and set its
 									// data field
@@ -3294,28 +4657,71 @@
                                 break;
                         }
 
-                        // Make sure a comma follows the operand, unless it's the last one
+                        // Make sure a comma follows the operand, unless it's the last one
+
+                        if ( iCurrOpIndex < CurrInstr.iOpCount - 1 )
+                            if ( GetNextToken () != TOKEN_TYPE_COMMA )
+								ExitOnCharExpectedError ( ',' );
+                    }
+
+					// Make sure there's no extranous stuff ahead
+
+					if ( GetNextToken () != TOKEN_TYPE_NEWLINE )
+						ExitOnCodeError ( ERROR_MSSG_INVALID_INPUT );
+
+                    // Copy the operand list pointer into the assembled stream
+
+                    g_pInstrStream [ g_iCurrInstrIndex ].pOpList = pOpList;
+
+                    // Move along to the next instruction in the stream
+
+                    ++ g_iCurrInstrIndex;
+
+                    break;
+                }
+
+                // ---- Identifiers (line labels)
+
+                case TOKEN_TYPE_IDENT:
+                {
+                    // Make sure it's a line label
+
+                    if ( GetLookAheadChar () != ':' )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_INSTR );
+
+                    // Make sure we're in a function, since labels can only appear there
+
+                    if ( ! iIsFuncActive )
+                        ExitOnCodeError ( ERROR_MSSG_GLOBAL_LINE_LABEL );
+
+                    // The current lexeme is the label's identifier
 
-                        if ( iCurrOpIndex < CurrInstr.iOpCount - 1 )
-                            if ( GetNextToken () != TOKEN_TYPE_COMMA )
-								ExitOnCharExpectedError ( ',' );
-                    }
+                    char * pstrIdent = GetCurrLexeme ();
 
-					// Make sure there's no extranous stuff ahead
+                    // The target instruction is always the next instruction to be
+                    // assembled
 
-					if ( GetNextToken () != TOKEN_TYPE_NEWLINE )
-						ExitOnCodeError ( ERROR_MSSG_INVALID_INPUT );
+                    int iTargetIndex = g_iCurrInstrIndex;
 
-                    // Copy the operand list pointer into the assembled stream
+                    // Save the label's function index as well
 
-                    g_pInstrStream [ g_iCurrInstrIndex ].pOpList = pOpList;
+                    int iFuncIndex = iCurrFuncIndex;
 
-                    // Move along to the next instruction in the stream
+                    // Try adding the label to the label table, and print an error if it
+                    // already exists
 
-                    ++ g_iCurrInstrIndex;
+                    if ( AddLabel ( pstrIdent, iTargetIndex, iFuncIndex ) == -1 )
+                        ExitOnCodeError ( ERROR_MSSG_LINE_LABEL_REDEFINITION );
 
                     break;
                 }
+
+                default:
+
+                    // Anything else should cause an error, minus line breaks
+
+                    if ( g_Lexer.CurrToken != TOKEN_TYPE_NEWLINE )
+                        ExitOnCodeError ( ERROR_MSSG_INVALID_INPUT );
             }
 
             // Skip to the next line
@@ -3323,8 +4729,19 @@
             if ( ! SkipToNextLine () )
                 break;
         }
+
+        // Backpatch the remaining forward references, which are function calls and globals
+        // declared after their first use
+
+        ResolveGlobalFixups ();
+
+        // Every instruction has been assembled, so the stream's size is the final index
+
+        g_iInstrStreamSize = g_iCurrInstrIndex;
     }
 
+
+
     /******************************************************************************************
     *
     *   PrintAssmblStats ()
@@ -3416,6 +4833,8 @@
         printf ( "               Globals: %d\n", iGlobalCount );
         printf ( "       String Literals: %d\n", g_StringTable.iNodeCount );
         printf ( "                Labels: %d\n", g_LabelTable.iNodeCount );
+        printf ( "           Jump Tables: %d\n", g_JumpTableTable.iNodeCount );
+        printf ( "      Source Line Runs: %d\n", g_iLineTableSize );
         printf ( "        Host API Calls: %d\n", g_HostAPICallTable.iNodeCount );
         printf ( "             Functions: %d\n", g_FuncTable.iNodeCount );
 
@@ -3427,15 +4846,322 @@
         printf ( "\n" );
     }
 
+    /******************************************************************************************
+    *
+    *   WriteVarInt ()
+    *
+    *   Writes an unsigned integer as a variable-length integer: seven bits per byte, least
+    *   significant bits first, with the high bit of each byte set if another byte follows.
+    *   Values under 128 take a single byte.
+    */
+
+    void WriteVarInt ( FILE * pExecFile, unsigned int iValue )
+    {
+        while ( iValue >= 0x80 )
+        {
+            fputc ( ( int ) ( iValue & 0x7F ) | 0x80, pExecFile );
+            iValue >>= 7;
+        }
+        fputc ( ( int ) iValue, pExecFile );
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteSignedVarInt ()
+    *
+    *   Writes a signed integer as a variable-length integer. The sign is moved into the
+    *   lowest bit first ( 0, -1, 1, -2, 2... becomes 0, 1, 2, 3, 4... ), so small negative
+    *   values like stack indices and backward jumps stay small as well.
+    */
+
+    void WriteSignedVarInt ( FILE * pExecFile, int iValue )
+    {
+        WriteVarInt ( pExecFile, ( ( unsigned int ) iValue << 1 ) ^ ( unsigned int ) ( iValue >> 31 ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteXSEInt ()
+    *
+    *   Writes a header or table field, either as a variable-length integer or, if the older
+    *   format was requested, in the specified number of bytes.
+    */
+
+    void WriteXSEInt ( FILE * pExecFile, int iValue, int iLegacySize )
+    {
+        if ( g_iIsLegacyXSE )
+            fwrite ( & iValue, iLegacySize, 1, pExecFile );
+        else
+            WriteVarInt ( pExecFile, ( unsigned int ) iValue );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetOpShapeBitCount ()
+    *
+    *   Returns the number of bits needed to tell apart each operand type an operand with the
+    *   specified type flags accepts. Operands that only accept one type need no bits at all.
+    */
+
+    int GetOpShapeBitCount ( OpTypes iOpTypes )
+    {
+        // Count the types the operand accepts
+
+        int iTypeCount = 0;
+        for ( int iCurrOpType = 0; iCurrOpType < OP_TYPE_COUNT; ++ iCurrOpType )
+            if ( iOpTypes & g_OpTypeFlagTable [ iCurrOpType ] )
+                ++ iTypeCount;
+
+        // Find the smallest number of bits that can hold that many values
+
+        int iBitCount = 0;
+        while ( ( 1 << iBitCount ) < iTypeCount )
+            ++ iBitCount;
+
+        return iBitCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetOpShape ()
+    *
+    *   Returns the position of an operand type among the types an operand accepts.
+    */
+
+    int GetOpShape ( OpTypes iOpTypes, int iOpType )
+    {
+        int iShape = 0;
+        for ( int iCurrOpType = 0; iCurrOpType < iOpType; ++ iCurrOpType )
+            if ( iOpTypes & g_OpTypeFlagTable [ iCurrOpType ] )
+                ++ iShape;
+
+        return iShape;
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteInstr ()
+    *
+    *   Writes an instruction in the older format, which uses a fixed number of bytes for the
+    *   opcode, operand count, and each operand's type and value.
+    */
+
+    void WriteInstr ( FILE * pExecFile, Instr * pInstr )
+    {
+		// Write the opcode (2 bytes)
+
+		short sOpcode = pInstr->iOpcode;
+		fwrite ( & sOpcode, 2, 1, pExecFile );
+
+		// Write the operand count (1 byte)
+
+		char iOpCount = pInstr->iOpCount;
+		fwrite ( & iOpCount, 1, 1, pExecFile );
+
+		// Loop through the operand list and print each one out
+
+		for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
+		{
+			// Make a copy of the operand pointer for convinience
+
+			Op CurrOp = pInstr->pOpList [ iCurrOpIndex ];
+
+			// Create a character for holding operand types (1 byte)
+
+			char cOpType = CurrOp.iType;
+			fwrite ( & cOpType, 1, 1, pExecFile );
+
+			// Write the operand depending on its type
+
+			switch ( CurrOp.iType )
+			{
+				// Integer literal
+
+				case OP_TYPE_INT:
+					fwrite ( & CurrOp.iIntLiteral, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Floating-point literal
+
+				case OP_TYPE_FLOAT:
+					fwrite ( & CurrOp.fFloatLiteral, sizeof ( float ), 1, pExecFile );
+					break;
+
+				// String index
+
+				case OP_TYPE_STRING_INDEX:
+					fwrite ( & CurrOp.iStringTableIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Instruction index
+
+				case OP_TYPE_INSTR_INDEX:
+					fwrite ( & CurrOp.iInstrIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Absolute stack index
+
+				case OP_TYPE_ABS_STACK_INDEX:
+					fwrite ( & CurrOp.iStackIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Relative stack index
+
+				case OP_TYPE_REL_STACK_INDEX:
+					fwrite ( & CurrOp.iStackIndex, sizeof ( int ), 1, pExecFile );
+					fwrite ( & CurrOp.iOffsetIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Function index
+
+				case OP_TYPE_FUNC_INDEX:
+					fwrite ( & CurrOp.iFuncIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Host API call index
+
+				case OP_TYPE_HOST_API_CALL_INDEX:
+					fwrite ( & CurrOp.iHostAPICallIndex, sizeof ( int ), 1, pExecFile );
+					break;
+
+				// Register
+
+				case OP_TYPE_REG:
+					fwrite ( & CurrOp.iReg, sizeof ( int ), 1, pExecFile );
+					break;
+			}
+		}
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteCompactInstr ()
+    *
+    *   Writes an instruction in the compact format. The first byte holds the opcode in its
+    *   low six bits; the operand count is implied by the opcode. Each operand's type is
+    *   stored as its position among the types the instruction accepts for that operand
+    *   (its "shape"), and all of the shapes are packed together, lowest operand first. The
+    *   first two shape bits go in the top of the opcode byte, and the rest, if any, in a
+    *   second byte. Operand values follow as variable-length integers, except for floats,
+    *   which are written as-is, and _RetVal, which needs no value at all. Jump targets are
+    *   written relative to the jumping instruction, since most jumps are short.
+    */
+
+    void WriteCompactInstr ( FILE * pExecFile, InstrLookup ** ppInstrByOpcode, int iInstrIndex )
+    {
+        Instr * pInstr = & g_pInstrStream [ iInstrIndex ];
+        InstrLookup * pLookup = ppInstrByOpcode [ pInstr->iOpcode ];
+
+        // Pack the operand shapes together
+
+        int iShapes = 0;
+        int iShapeBitCount = 0;
+        int iCurrOpIndex;
+
+        for ( iCurrOpIndex = 0; iCurrOpIndex < pInstr->iOpCount; ++ iCurrOpIndex )
+        {
+            OpTypes iOpTypes = pLookup->OpList [ iCurrOpIndex ];
+            iShapes |= GetOpShape ( iOpTypes, pInstr->pOpList [ iCurrOpIndex ].iType ) << iShapeBitCount;
+            iShapeBitCount += GetOpShapeBitCount ( iOpTypes );
+        }
+
+        // Write the opcode and first two shape bits (1 byte), then the rest of the shape
+        // bits if there are any (1 byte)
+
+        fputc ( pInstr->iOpcode | ( ( iShapes & 0x03 ) << 6 ), pExecFile );
+        if ( iShapeBitCount > 2 )
+            fputc ( iShapes >> 2, pExecFile );
+
+        // Write each operand's value
+
+        for ( iCurrOpIndex = 0; iCurrOpIndex < pInstr->iOpCount; ++ iCurrOpIndex )
+        {
+            Op * pOp = & pInstr->pOpList [ iCurrOpIndex ];
+
+            switch ( pOp->iType )
+            {
+                // Integer literal
+
+                case OP_TYPE_INT:
+                    WriteSignedVarInt ( pExecFile, pOp->iIntLiteral );
+                    break;
+
+                // Floating-point literal (4 bytes)
+
+                case OP_TYPE_FLOAT:
+                    fwrite ( & pOp->fFloatLiteral, sizeof ( float ), 1, pExecFile );
+                    break;
+
+                // String index
+
+                case OP_TYPE_STRING_INDEX:
+                    WriteVarInt ( pExecFile, pOp->iStringTableIndex );
+                    break;
+
+                // Instruction index, relative to this instruction
+
+                case OP_TYPE_INSTR_INDEX:
+                    WriteSignedVarInt ( pExecFile, pOp->iInstrIndex - iInstrIndex );
+                    break;
+
+                // Absolute stack index
+
+                case OP_TYPE_ABS_STACK_INDEX:
+                    WriteSignedVarInt ( pExecFile, pOp->iStackIndex );
+                    break;
+
+                // Relative stack index
+
+                case OP_TYPE_REL_STACK_INDEX:
+                    WriteSignedVarInt ( pExecFile, pOp->iStackIndex );
+                    WriteSignedVarInt ( pExecFile, pOp->iOffsetIndex );
+                    break;
+
+                // Function index
+
+                case OP_TYPE_FUNC_INDEX:
+                    WriteVarInt ( pExecFile, pOp->iFuncIndex );
+                    break;
+
+                // Host API call index
+
+                case OP_TYPE_HOST_API_CALL_INDEX:
+                    WriteVarInt ( pExecFile, pOp->iHostAPICallIndex );
+                    break;
+
+                // Jump table index
+
+                case OP_TYPE_JUMP_TABLE_INDEX:
+                    WriteVarInt ( pExecFile, pOp->iJumpTableIndex );
+                    break;
+
+                // _RetVal is the only register, so nothing needs to be written
+            }
+        }
+    }
+
     /******************************************************************************************
     *
     *   BuildXSE ()
     *
-    *   Dumps the assembled executable to an .XSE file.
+    *   Dumps the assembled executable to an .XSE file. Version 0.9 executables store the
+    *   instruction stream in a compact, variable-length encoding, and every count, size and
+    *   index in the header and tables as a variable-length integer. Version 0.8 executables
+    *   are written instead if they were requested on the command line. Jump tables only
+    *   exist in version 0.9, and follow the host API call table.
+    *
+    *   If any source lines were found, a line table follows the jump tables. It's only read
+    *   when the host asks which line an instruction came from, so it's left out of older
+    *   executables rather than treated as an error.
     */
 
     void BuildXSE ()
     {
+        // Older executables have no jump table section
+
+        if ( g_iIsLegacyXSE && g_JumpTableTable.iNodeCount )
+            ExitOnError ( ERROR_MSSG_LEGACY_JUMP_TABLE );
+
         // ---- Open the output file
 
         FILE * pExecFile;
@@ -3452,16 +5178,18 @@
 
         char cVersionMajor = VERSION_MAJOR,
              cVersionMinor = VERSION_MINOR;
+        if ( g_iIsLegacyXSE )
+            cVersionMinor = LEGACY_VERSION_MINOR;
         fwrite ( & cVersionMajor, 1, 1, pExecFile );
         fwrite ( & cVersionMinor, 1, 1, pExecFile );
 
         // Write the stack size (4 bytes)
 
-        fwrite ( & g_ScriptHeader.iStackSize, 4, 1, pExecFile );
+        WriteXSEInt ( pExecFile, g_ScriptHeader.iStackSize, 4 );
 
 		// Write the global data size (4 bytes )
 
-		fwrite ( & g_ScriptHeader.iGlobalDataSize, 4, 1, pExecFile );
+		WriteXSEInt ( pExecFile, g_ScriptHeader.iGlobalDataSize, 4 );
 
 		// Write the _Main () flag (1 byte)
 
@@ -3472,7 +5200,7 @@
 
 		// Write the _Main () function index (4 bytes)
 
-		fwrite ( & g_ScriptHeader.iMainFuncIndex, 4, 1, pExecFile );
+		WriteXSEInt ( pExecFile, g_ScriptHeader.iMainFuncIndex, 4 );
 
         // Write the priority type (1 byte)
 
@@ -3481,101 +5209,37 @@
 
         // Write the user-defined priority (4 bytes)
 
-        fwrite ( & g_ScriptHeader.iUserPriority, 4, 1, pExecFile );
+        WriteXSEInt ( pExecFile, g_ScriptHeader.iUserPriority, 4 );
 
 		// ---- Write the instruction stream
 
 		// Output the instruction count (4 bytes)
 
-		fwrite ( & g_iInstrStreamSize, 4, 1, pExecFile );
-
-		// Loop through each instruction and write its data out
-
-		for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_iInstrStreamSize; ++ iCurrInstrIndex )
-		{
-			// Write the opcode (2 bytes)
-
-			short sOpcode = g_pInstrStream [ iCurrInstrIndex ].iOpcode;
-			fwrite ( & sOpcode, 2, 1, pExecFile );
-
-			// Write the operand count (1 byte)
-
-			char iOpCount = g_pInstrStream [ iCurrInstrIndex ].iOpCount;
-			fwrite ( & iOpCount, 1, 1, pExecFile );
-
-			// Loop through the operand list and print each one out
-
-			for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
-			{
-				// Make a copy of the operand pointer for convinience
-
-				Op CurrOp = g_pInstrStream [ iCurrInstrIndex ].pOpList [ iCurrOpIndex ];
-
-				// Create a character for holding operand types (1 byte)
-
-				char cOpType = CurrOp.iType;
-				fwrite ( & cOpType, 1, 1, pExecFile );
-
-				// Write the operand depending on its type
-
-				switch ( CurrOp.iType )
-				{
-					// Integer literal
-
-					case OP_TYPE_INT:
-						fwrite ( & CurrOp.iIntLiteral, sizeof ( int ), 1, pExecFile );
-						break;
-
-					// Floating-point literal
-
-					case OP_TYPE_FLOAT:
-						fwrite ( & CurrOp.fFloatLiteral, sizeof ( float ), 1, pExecFile );
-						break;
-
-					// String index
-
-					case OP_TYPE_STRING_INDEX:
-						fwrite ( & CurrOp.iStringTableIndex, sizeof ( int ), 1, pExecFile );
-						break;
-
-					// Instruction index
-
-					case OP_TYPE_INSTR_INDEX:
-						fwrite ( & CurrOp.iInstrIndex, sizeof ( int ), 1, pExecFile );
-						break;
-
-					// Absolute stack index
-
-					case OP_TYPE_ABS_STACK_INDEX:
-						fwrite ( & CurrOp.iStackIndex, sizeof ( int ), 1, pExecFile );
-						break;
+		WriteXSEInt ( pExecFile, g_iInstrStreamSize, 4 );
 
-					// Relative stack index
+        // The compact format needs each instruction's operand types, so map each opcode to
+        // its entry in the instruction lookup table
 
-					case OP_TYPE_REL_STACK_INDEX:
-						fwrite ( & CurrOp.iStackIndex, sizeof ( int ), 1, pExecFile );
-						fwrite ( & CurrOp.iOffsetIndex, sizeof ( int ), 1, pExecFile );
-						break;
+        InstrLookup * ppInstrByOpcode [ MAX_INSTR_LOOKUP_COUNT ];
+        int iCurrLookupIndex;
 
-					// Function index
+        for ( iCurrLookupIndex = 0; iCurrLookupIndex < MAX_INSTR_LOOKUP_COUNT; ++ iCurrLookupIndex )
+            ppInstrByOpcode [ iCurrLookupIndex ] = NULL;
 
-					case OP_TYPE_FUNC_INDEX:
-						fwrite ( & CurrOp.iFuncIndex, sizeof ( int ), 1, pExecFile );
-						break;
+        // Unused entries in the lookup table have no mnemonic
 
-					// Host API call index
+        for ( iCurrLookupIndex = 0; iCurrLookupIndex < MAX_INSTR_LOOKUP_COUNT; ++ iCurrLookupIndex )
+            if ( g_InstrTable [ iCurrLookupIndex ].pstrMnemonic [ 0 ] )
+                ppInstrByOpcode [ g_InstrTable [ iCurrLookupIndex ].iOpcode ] = & g_InstrTable [ iCurrLookupIndex ];
 
-					case OP_TYPE_HOST_API_CALL_INDEX:
-						fwrite ( & CurrOp.iHostAPICallIndex, sizeof ( int ), 1, pExecFile );
-						break;
-
-					// Register
+		// Loop through each instruction and write its data out
 
-					case OP_TYPE_REG:
-						fwrite ( & CurrOp.iReg, sizeof ( int ), 1, pExecFile );
-						break;
-				}
-			}
+		for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_iInstrStreamSize; ++ iCurrInstrIndex )
+		{
+            if ( g_iIsLegacyXSE )
+                WriteInstr ( pExecFile, & g_pInstrStream [ iCurrInstrIndex ] );
+            else
+                WriteCompactInstr ( pExecFile, ppInstrByOpcode, iCurrInstrIndex );
 		}
 
 		// Create a node pointer for traversing the lists
@@ -3587,28 +5251,24 @@
 
 		// Write out the string count (4 bytes)
 
-		fwrite ( & g_StringTable.iNodeCount, 4, 1, pExecFile );
+		WriteXSEInt ( pExecFile, g_StringTable.iNodeCount, 4 );
 
 		// Set the pointer to the head of the list
 
 		pNode = g_StringTable.pHead;
 
-		// Create a character for writing parameter counts
-
-		char cParamCount;
-
 		// Loop through each node in the list and write out its string
 
 		for ( iCurrNode = 0; iCurrNode < g_StringTable.iNodeCount; ++ iCurrNode )
 		{
 			// Copy the string and calculate its length
 
-			char * pstrCurrString = ( char * ) pNode->pData;
+			char * pstrCurrString = ( ( StringNode * ) pNode->pData )->pstrString;
 			int iCurrStringLength = strlen ( pstrCurrString );
 
 			// Write the length (4 bytes), followed by the string data (N bytes)
 
-			fwrite ( & iCurrStringLength, 4, 1, pExecFile );
+			WriteXSEInt ( pExecFile, iCurrStringLength, 4 );
 			fwrite ( pstrCurrString, strlen ( pstrCurrString ), 1, pExecFile );
 
 			// Move to the next node
@@ -3620,7 +5280,7 @@
 
 		// Write out the function count (4 bytes)
 
-		fwrite ( & g_FuncTable.iNodeCount, 4, 1, pExecFile );
+		WriteXSEInt ( pExecFile, g_FuncTable.iNodeCount, 4 );
 
 		// Set the pointer to the head of the list
 
@@ -3636,21 +5296,19 @@
 
 			// Write the entry point (4 bytes)
 
-			fwrite ( & pFunc->iEntryPoint, sizeof ( int ), 1, pExecFile );
+			WriteXSEInt ( pExecFile, pFunc->iEntryPoint, 4 );
 
 			// Write the parameter count (1 byte)
 
-			cParamCount = pFunc->iParamCount;
-			fwrite ( & cParamCount, 1, 1, pExecFile );
+			WriteXSEInt ( pExecFile, pFunc->iParamCount, 1 );
 
 			// Write the local data size (4 bytes)
 
-			fwrite ( & pFunc->iLocalDataSize, sizeof ( int ), 1, pExecFile );
+			WriteXSEInt ( pExecFile, pFunc->iLocalDataSize, 4 );
 
             // Write the function name length (1 byte)
 
-            char cFuncNameLength = strlen ( pFunc->pstrName );
-            fwrite ( & cFuncNameLength, 1, 1, pExecFile );
+            WriteXSEInt ( pExecFile, strlen ( pFunc->pstrName ), 1 );
 
             // Write the function name (N bytes)
 
@@ -3665,7 +5323,7 @@
 
 		// Write out the call count (4 bytes)
 
-		fwrite ( & g_HostAPICallTable.iNodeCount, 4, 1, pExecFile );
+		WriteXSEInt ( pExecFile, g_HostAPICallTable.iNodeCount, 4 );
 
 		// Set the pointer to the head of the list
 
@@ -3677,12 +5335,11 @@
 		{
 			// Copy the string pointer and calculate its length
 
-			char * pstrCurrHostAPICall = ( char * ) pNode->pData;
-			char cCurrHostAPICallLength = strlen ( pstrCurrHostAPICall );
+			char * pstrCurrHostAPICall = ( ( StringNode * ) pNode->pData )->pstrString;
 
 			// Write the length (1 byte), followed by the string data (N bytes)
 
-			fwrite ( & cCurrHostAPICallLength, 1, 1, pExecFile );
+			WriteXSEInt ( pExecFile, strlen ( pstrCurrHostAPICall ), 1 );
 			fwrite ( pstrCurrHostAPICall, strlen ( pstrCurrHostAPICall ), 1, pExecFile );
 
 			// Move to the next node
@@ -3690,6 +5347,61 @@
 			pNode = pNode->pNext;
 		}
 
+        // ---- Write the jump table table
+
+        if ( ! g_iIsLegacyXSE )
+        {
+            // Write out the table count
+
+            WriteVarInt ( pExecFile, g_JumpTableTable.iNodeCount );
+
+            // Write out each table's base and size, followed by its target instructions
+
+            pNode = g_JumpTableTable.pHead;
+
+            for ( iCurrNode = 0; iCurrNode < g_JumpTableTable.iNodeCount; ++ iCurrNode )
+            {
+                JumpTableNode * pJumpTable = ( JumpTableNode * ) pNode->pData;
+
+                WriteSignedVarInt ( pExecFile, pJumpTable->iBase );
+                WriteVarInt ( pExecFile, pJumpTable->iSize );
+
+                for ( int iCurrEntry = 0; iCurrEntry < pJumpTable->iSize; ++ iCurrEntry )
+                    WriteVarInt ( pExecFile, pJumpTable->piTargets [ iCurrEntry ] );
+
+                pNode = pNode->pNext;
+            }
+        }
+
+        // ---- Write the line table
+
+        if ( ! g_iIsLegacyXSE && g_iLineTableSize )
+        {
+            // Write the ID string and the name of the source file
+
+            fwrite ( LINE_TABLE_ID_STRING, 4, 1, pExecFile );
+
+            WriteVarInt ( pExecFile, strlen ( g_pstrLineSourceFilename ) );
+            fwrite ( g_pstrLineSourceFilename, strlen ( g_pstrLineSourceFilename ), 1, pExecFile );
+
+            // Write each run as the distance from the previous run's first instruction and
+            // the change in line, both of which are usually small
+
+            WriteVarInt ( pExecFile, g_iLineTableSize );
+
+            int iPrevInstrIndex = 0,
+                iPrevSourceLine = 0;
+
+            for ( int iCurrRun = 0; iCurrRun < g_iLineTableSize; ++ iCurrRun )
+            {
+                WriteVarInt ( pExecFile, g_pLineTable [ iCurrRun ].iInstrIndex - iPrevInstrIndex );
+                WriteSignedVarInt ( pExecFile, g_pLineTable [ iCurrRun ].iSourceLine - iPrevSourceLine );
+
+                iPrevInstrIndex = g_pLineTable [ iCurrRun ].iInstrIndex;
+                iPrevSourceLine = g_pLineTable [ iCurrRun ].iSourceLine;
+            }
+        }
+
         // ---- Close the output file
 
         fclose ( pExecFile );
@@ -3803,6 +5515,23 @@
 
         PrintLogo ();
 
+        // Check for the switch that requests the older executable format, and remove it from
+        // the argument list so the filenames can be found as usual
+
+        int iCurrArgIndex = 1;
+        while ( iCurrArgIndex < argc )
+        {
+            if ( stricmp ( argv [ iCurrArgIndex ], LEGACY_XSE_SWITCH ) == 0 )
+            {
+                g_iIsLegacyXSE = TRUE;
+                for ( int iNextArgIndex = iCurrArgIndex; iNextArgIndex < argc; ++ iNextArgIndex )
+                    argv [ iNextArgIndex ] = argv [ iNextArgIndex + 1 ];
+                -- argc;
+            }
+            else
+                ++ iCurrArgIndex;
+        }
+
         // Validate the command line argument count
 
         if ( argc < 2 )
@@ -3867,14 +5596,14 @@
 		    strcat ( g_pstrExecFilename, EXEC_FILE_EXT );
         }
 
-		// Initialize the assembler
-
-		Init ();
-
         // Load the source file into memory
 
         LoadSourceFile ();
 
+		// Initialize the assembler, now that the size of the source is known
+
+		Init ();
+
         // Assemble the source file
 
         printf ( "Assembling %s...\n\n", g_pstrSourceFilename );
@@ -0,0 +1,325 @@
+/*
+
+    Project.
+
+        XASM Benchmark
+
+    Abstract.
+
+        Generates large XVM assembly scripts and times how long XASM takes to assemble them.
+        The scripts are built from many functions full of forward and backward line label
+        references, forward function calls, locals, parameters, globals, string literals and
+        host API calls, so the assembler's tables and fixups are all put under load.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <stdlib.h>
+    #include <stdio.h>
+    #include <string.h>
+    #include <process.h>
+    #include <windows.h>
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- General ---------------------------------------------------------------------------
+
+        #ifndef TRUE
+            #define TRUE                    1           // True
+        #endif
+
+        #ifndef FALSE
+            #define FALSE                   0           // False
+        #endif
+
+    // ---- Benchmark -------------------------------------------------------------------------
+
+        #define MAX_FILENAME_SIZE           2048        // Maximum filename length
+
+        #define DEFAULT_ASSEMBLER           "XASM.exe"  // Assembler to run by default
+
+        #define BENCH_FILENAME              "BENCH_%dMB.XASM"   // Generated script filename
+        #define BENCH_EXEC_FILENAME         "BENCH_%dMB.XSE"    // Assembled executable filename
+
+        #define DEFAULT_SIZE_COUNT          3           // Number of default script sizes
+
+        #define BYTES_PER_MB                1048576     // Bytes in a megabyte
+
+        #define STRING_LITERAL_COUNT        512         // Number of distinct string literals
+        #define HOST_API_CALL_COUNT         64          // Number of distinct host API calls
+        #define SWITCH_CASE_COUNT           8           // Number of forward jumps per function
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    int g_pDefaultSizeList [ DEFAULT_SIZE_COUNT ] = { 1, 4, 16 };  // Default script sizes, in MB
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    int GenerateFunc ( FILE * pFile, int iFuncIndex );
+    int GenerateScript ( char * pstrFilename, int iSize, int * piLineCount );
+    int RunBenchmark ( char * pstrAssembler, int iSize );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "XASM Benchmark\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tXASMBENCH [Size] [Assembler]\n" );
+        printf ( "\n" );
+        printf ( "\t- Size is the size of the generated script in MB. Scripts of 1, 4 and 16 MB\n" );
+        printf ( "\t  are generated and assembled by default.\n" );
+        printf ( "\t- Assembler is the assembler to run (%s by default).\n", DEFAULT_ASSEMBLER );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   GenerateFunc ()
+    *
+    *   Writes a single function, preceded by a global variable, and returns the number of
+    *   lines written.
+    */
+
+    int GenerateFunc ( FILE * pFile, int iFuncIndex )
+    {
+        int iLineCount = 0;
+        int iCurrCaseIndex;
+
+        // Declare a global for the function to use
+
+        fprintf ( pFile, "Var G%d\n", iFuncIndex );
+        ++ iLineCount;
+
+        // Write the function's header, parameters and locals
+
+        fprintf ( pFile, "Func F%d\n{\n", iFuncIndex );
+        fprintf ( pFile, "    Param P0\n" );
+        fprintf ( pFile, "    Param P1\n" );
+        fprintf ( pFile, "    Var Count\n" );
+        fprintf ( pFile, "    Var Sum\n" );
+        fprintf ( pFile, "    Var Name\n" );
+        fprintf ( pFile, "    Var Values [ 8 ]\n" );
+        iLineCount += 8;
+
+        // Jump forward to one of several labels, like a switch would
+
+        for ( iCurrCaseIndex = 0; iCurrCaseIndex < SWITCH_CASE_COUNT; ++ iCurrCaseIndex )
+            fprintf ( pFile, "    JE P0, %d, Case%d\n", iCurrCaseIndex, iCurrCaseIndex );
+        fprintf ( pFile, "    Jmp Loop\n" );
+        iLineCount += SWITCH_CASE_COUNT + 1;
+
+        for ( iCurrCaseIndex = 0; iCurrCaseIndex < SWITCH_CASE_COUNT; ++ iCurrCaseIndex )
+        {
+            fprintf ( pFile, "Case%d:\n", iCurrCaseIndex );
+            fprintf ( pFile, "    Mov Values [ %d ], P1\n", iCurrCaseIndex );
+            fprintf ( pFile, "    Mov Name, \"String %d\"\n", ( iFuncIndex + iCurrCaseIndex ) % STRING_LITERAL_COUNT );
+            fprintf ( pFile, "    Jmp Loop\n" );
+            iLineCount += 4;
+        }
+
+        // Loop over the array, jumping backward
+
+        fprintf ( pFile, "Loop:\n" );
+        fprintf ( pFile, "    Mov Count, 0\n" );
+        fprintf ( pFile, "    Mov Sum, 0\n" );
+        fprintf ( pFile, "Next:\n" );
+        fprintf ( pFile, "    Add Sum, Values [ Count ]\n" );
+        fprintf ( pFile, "    Inc Count\n" );
+        fprintf ( pFile, "    JL Count, 8, Next\n" );
+        iLineCount += 7;
+
+        // Call the next function, which hasn't been defined yet, and a host API function
+
+        fprintf ( pFile, "    Mov G%d, Sum\n", iFuncIndex );
+        fprintf ( pFile, "    Push Sum\n" );
+        fprintf ( pFile, "    Push Name\n" );
+        fprintf ( pFile, "    Call F%d\n", iFuncIndex + 1 );
+        fprintf ( pFile, "    Push Name\n" );
+        fprintf ( pFile, "    CallHost Host%d\n", iFuncIndex % HOST_API_CALL_COUNT );
+        fprintf ( pFile, "    Mov _RetVal, Sum\n" );
+        fprintf ( pFile, "}\n" );
+        iLineCount += 8;
+
+        return iLineCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   GenerateScript ()
+    *
+    *   Writes a script of roughly the specified size in MB, returning FALSE if the file
+    *   couldn't be written.
+    */
+
+    int GenerateScript ( char * pstrFilename, int iSize, int * piLineCount )
+    {
+        // Open the script
+
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "w" ) ) )
+            return FALSE;
+
+        // Write functions until the script reaches the requested size
+
+        long lTargetSize = ( long ) iSize * BYTES_PER_MB;
+        int iFuncIndex = 0;
+        int iLineCount = 0;
+
+        fprintf ( pFile, "; Generated by XASMBENCH\n" );
+        fprintf ( pFile, "SetStackSize 1024\n" );
+        iLineCount += 2;
+
+        while ( ftell ( pFile ) < lTargetSize )
+        {
+            iLineCount += GenerateFunc ( pFile, iFuncIndex );
+            ++ iFuncIndex;
+        }
+
+        // Each function calls the one after it, so end the chain with an empty function
+
+        fprintf ( pFile, "Func F%d\n{\n}\n", iFuncIndex );
+        iLineCount += 3;
+
+        // Finish with _Main (), which starts the chain of calls
+
+        fprintf ( pFile, "Func _Main\n{\n" );
+        fprintf ( pFile, "    Push 0\n" );
+        fprintf ( pFile, "    Push 1\n" );
+        fprintf ( pFile, "    Call F0\n" );
+        fprintf ( pFile, "}" );
+        iLineCount += 6;
+
+        fclose ( pFile );
+
+        * piLineCount = iLineCount;
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBenchmark ()
+    *
+    *   Generates a script of the specified size, assembles it and prints the time taken.
+    *   Returns FALSE if the benchmark couldn't be run.
+    */
+
+    int RunBenchmark ( char * pstrAssembler, int iSize )
+    {
+        char pstrSourceFilename [ MAX_FILENAME_SIZE ],
+             pstrExecFilename [ MAX_FILENAME_SIZE ];
+
+        sprintf ( pstrSourceFilename, BENCH_FILENAME, iSize );
+        sprintf ( pstrExecFilename, BENCH_EXEC_FILENAME, iSize );
+
+        // Generate the script
+
+        int iLineCount;
+        if ( ! GenerateScript ( pstrSourceFilename, iSize, & iLineCount ) )
+        {
+            printf ( "Could not write %s.\n", pstrSourceFilename );
+            return FALSE;
+        }
+
+        // Remove the old executable, so a failed assembly can be told apart
+
+        remove ( pstrExecFilename );
+
+        // Run the assembler and time it
+
+        char * ppstrCmmndLineParams [ 4 ];
+        ppstrCmmndLineParams [ 0 ] = pstrAssembler;
+        ppstrCmmndLineParams [ 1 ] = pstrSourceFilename;
+        ppstrCmmndLineParams [ 2 ] = pstrExecFilename;
+        ppstrCmmndLineParams [ 3 ] = NULL;
+
+        fflush ( stdout );
+
+        DWORD iStartTime = GetTickCount ();
+        spawnv ( P_WAIT, pstrAssembler, ppstrCmmndLineParams );
+        DWORD iTime = GetTickCount () - iStartTime;
+
+        // Make sure the executable was written
+
+        FILE * pExecFile;
+        if ( ! ( pExecFile = fopen ( pstrExecFilename, "rb" ) ) )
+        {
+            printf ( "Could not assemble %s.\n", pstrSourceFilename );
+            return FALSE;
+        }
+        fclose ( pExecFile );
+
+        // Print the results
+
+        printf ( "Benchmark: %dMB, %d lines, %lums", iSize, iLineCount, iTime );
+        if ( iTime )
+            printf ( " (%.2fMB/s)", ( float ) iSize * 1000 / iTime );
+        printf ( "\n\n" );
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the size and assembler, if they were specified
+
+        int iSize = 0;
+        char pstrAssembler [ MAX_FILENAME_SIZE ];
+        strcpy ( pstrAssembler, DEFAULT_ASSEMBLER );
+
+        if ( argc > 1 )
+        {
+            iSize = atoi ( argv [ 1 ] );
+            if ( iSize <= 0 )
+            {
+                PrintUsage ();
+                return 0;
+            }
+        }
+
+        if ( argc > 2 )
+            strcpy ( pstrAssembler, argv [ 2 ] );
+
+        // Run a single benchmark if a size was given, or the default set otherwise
+
+        if ( iSize )
+            return ! RunBenchmark ( pstrAssembler, iSize );
+
+        for ( int iCurrSizeIndex = 0; iCurrSizeIndex < DEFAULT_SIZE_COUNT; ++ iCurrSizeIndex )
+            if ( ! RunBenchmark ( pstrAssembler, g_pDefaultSizeList [ iCurrSizeIndex ] ) )
+                return 1;
+
+        return 0;
+    }
@@ -42,7 +42,7 @@ RSC=rc.exe
 # PROP Ignore_Export_Lib 0
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /c
-# ADD CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /c
+# ADD CPP /nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /c
 # ADD BASE RSC /l 0x409 /d "NDEBUG"
 # ADD RSC /l 0x409 /d "NDEBUG"
 BSC32=bscmake.exe
@@ -66,7 +66,7 @@ LINK32=link.exe
 # PROP Ignore_Export_Lib 0
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /GZ  /c
-# ADD CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /GZ  /c
+# ADD CPP /nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /GZ  /c
 # ADD BASE RSC /l 0x409 /d "_DEBUG"
 # ADD RSC /l 0x409 /d "_DEBUG"
 BSC32=bscmake.exe
@@ -87,6 +87,14 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\batch.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\cache.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\code_emit.cpp
 # End Source File
 # Begin Source File
@@ -127,6 +135,10 @@ SOURCE=.\symbol_table.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\type_infer.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\xsc.cpp
 # End Source File
 # End Group
@@ -135,10 +147,22 @@ SOURCE=.\xsc.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\batch.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\cache.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\code_emit.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\context.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\error.h
 # End Source File
 # Begin Source File
@@ -183,6 +207,10 @@ SOURCE=.\symbol_table.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\type_infer.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\xsc.h
 # End Source File
 # End Group
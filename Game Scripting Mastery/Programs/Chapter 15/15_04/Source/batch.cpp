@@ -0,0 +1,502 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Batch compilation module
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <windows.h>
+    #include <io.h>
+
+    #include "batch.h"
+    #include "error.h"
+    #include "preprocessor.h"
+    #include "parser.h"
+    #include "code_emit.h"
+    #include "cache.h"
+
+// ---- Globals -------------------------------------------------------------------------------
+
+    // ---- Jobs ------------------------------------------------------------------------------
+
+        BatchJob * g_pBatchJobs = NULL;                 // The files to compile
+        int g_iBatchJobCount = 0;                       // The number of files
+        int g_iBatchJobCapacity = 0;                    // The allocated size of the job array
+
+        volatile long g_lNextBatchJob = 0;              // The next job to hand to a worker
+
+    // ---- Workers ---------------------------------------------------------------------------
+
+        int g_iBatchWorkerCount = 0;                    // The number of worker threads, or zero
+                                                        // for one per processor
+
+        CompilerContext * g_pBatchOptions;              // Context holding the command-line
+                                                        // options for every file
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   IsBatchInput ()
+    *
+    *   Determines whether the first command-line argument names a file list or a directory
+    *   rather than a single source file.
+    */
+
+    int IsBatchInput ( char * pstrInput )
+    {
+        // File lists are prefixed
+
+        if ( pstrInput [ 0 ] == BATCH_LIST_PREFIX )
+            return TRUE;
+
+        // Otherwise check for a directory
+
+        DWORD dwAttribs = GetFileAttributes ( pstrInput );
+        if ( dwAttribs != 0xFFFFFFFF && ( dwAttribs & FILE_ATTRIBUTE_DIRECTORY ) )
+            return TRUE;
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   AddBatchJob ()
+    *
+    *   Adds a source file to the batch.
+    */
+
+    void AddBatchJob ( char * pstrSourceFilename )
+    {
+        // Grow the job array if it's full
+
+        if ( g_iBatchJobCount == g_iBatchJobCapacity )
+        {
+            g_iBatchJobCapacity = g_iBatchJobCapacity ? g_iBatchJobCapacity * 2 : 64;
+            g_pBatchJobs = ( BatchJob * ) realloc ( g_pBatchJobs, g_iBatchJobCapacity * sizeof ( BatchJob ) );
+        }
+
+        // Initialize the job
+
+        BatchJob * pJob = & g_pBatchJobs [ g_iBatchJobCount ++ ];
+
+        pJob->pstrSourceFilename = ( char * ) malloc ( strlen ( pstrSourceFilename ) + 1 );
+        strcpy ( pJob->pstrSourceFilename, pstrSourceFilename );
+        pJob->lStatus = BATCH_JOB_PENDING;
+        pJob->pstrDiag = NULL;
+        pJob->iSourceLineCount = 0;
+        pJob->iIsCached = FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadBatchFileList ()
+    *
+    *   Adds each filename in a file list to the batch, one per line.
+    */
+
+    void LoadBatchFileList ( char * pstrListFilename )
+    {
+        // Open the list
+
+        FILE * pListFile;
+
+        if ( ! ( pListFile = fopen ( pstrListFilename, "r" ) ) )
+            ExitOnError ( "Could not open file list for input" );
+
+        // Read each line
+
+        char pstrLine [ MAX_FILENAME_SIZE ];
+
+        while ( fgets ( pstrLine, MAX_FILENAME_SIZE, pListFile ) )
+        {
+            // Trim whitespace from both ends of the line
+
+            char * pstrFilename = pstrLine;
+            while ( * pstrFilename == ' ' || * pstrFilename == '\t' )
+                ++ pstrFilename;
+
+            int iLastCharIndex = strlen ( pstrFilename ) - 1;
+            while ( iLastCharIndex >= 0 &&
+                    ( pstrFilename [ iLastCharIndex ] == '\n' ||
+                      pstrFilename [ iLastCharIndex ] == '\r' ||
+                      pstrFilename [ iLastCharIndex ] == ' ' ||
+                      pstrFilename [ iLastCharIndex ] == '\t' ) )
+                pstrFilename [ iLastCharIndex -- ] = '\0';
+
+            // Skip blank lines
+
+            if ( ! pstrFilename [ 0 ] )
+                continue;
+
+            AddBatchJob ( pstrFilename );
+        }
+
+        fclose ( pListFile );
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareBatchJobs ()
+    *
+    *   qsort () callback for ordering jobs by filename.
+    */
+
+    int CompareBatchJobs ( const void * pJob0, const void * pJob1 )
+    {
+        return stricmp ( ( ( BatchJob * ) pJob0 )->pstrSourceFilename,
+                         ( ( BatchJob * ) pJob1 )->pstrSourceFilename );
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadBatchDirectory ()
+    *
+    *   Adds each source file in a directory to the batch.
+    */
+
+    void LoadBatchDirectory ( char * pstrDirName )
+    {
+        // Build the search pattern
+
+        char pstrPattern [ MAX_FILENAME_SIZE ];
+        sprintf ( pstrPattern, "%s\\*%s", pstrDirName, SOURCE_FILE_EXT );
+
+        // Add each matching file
+
+        struct _finddata_t FileInfo;
+        long lFindHandle = _findfirst ( pstrPattern, & FileInfo );
+
+        if ( lFindHandle == -1 )
+            return;
+
+        do
+        {
+            if ( FileInfo.attrib & _A_SUBDIR )
+                continue;
+
+            char pstrFilename [ MAX_FILENAME_SIZE ];
+            sprintf ( pstrFilename, "%s\\%s", pstrDirName, FileInfo.name );
+            AddBatchJob ( pstrFilename );
+        }
+        while ( _findnext ( lFindHandle, & FileInfo ) == 0 );
+
+        _findclose ( lFindHandle );
+
+        // The search order depends on the file system, so sort the files to keep the output
+        // order the same from run to run
+
+        qsort ( g_pBatchJobs, g_iBatchJobCount, sizeof ( BatchJob ), CompareBatchJobs );
+    }
+
+    /******************************************************************************************
+    *
+    *   AssmblBatchOutputFile ()
+    *
+    *   Invokes XASM on the current context's output file. XASM writes to the console, so its
+    *   output is captured in a log file and only kept if the .XSE wasn't created. Returns
+    *   TRUE on success.
+    */
+
+    int AssmblBatchOutputFile ( BatchJob * pJob )
+    {
+        // Work out the executable and log filenames
+
+        char pstrExecFilename [ MAX_FILENAME_SIZE ];
+        GetExecFilename ( pstrExecFilename );
+
+        char pstrLogFilename [ MAX_FILENAME_SIZE + 8 ];
+        sprintf ( pstrLogFilename, "%s.LOG", g_pContext->pstrOutputFilename );
+
+        // Remove any stale executable so we can tell whether XASM succeeded
+
+        remove ( pstrExecFilename );
+
+        // Invoke the assembler
+
+        char pstrCmmnd [ MAX_FILENAME_SIZE * 2 + 64 ];
+        sprintf ( pstrCmmnd, "%s \"%s\" %s > \"%s\"", ASSMBL_FILENAME, g_pContext->pstrOutputFilename,
+                  g_iIsLegacyXSE ? LEGACY_XSE_SWITCH : "", pstrLogFilename );
+        system ( pstrCmmnd );
+
+        // If the executable exists, assembly succeeded
+
+        int iSucceeded = FALSE;
+
+        FILE * pFile;
+        if ( pFile = fopen ( pstrExecFilename, "rb" ) )
+        {
+            fclose ( pFile );
+            iSucceeded = TRUE;
+        }
+        else
+        {
+            // Keep XASM's output as the diagnostic
+
+            pJob->pstrDiag = ( char * ) malloc ( MAX_DIAG_SIZE );
+            pJob->pstrDiag [ 0 ] = '\0';
+
+            if ( pFile = fopen ( pstrLogFilename, "rb" ) )
+            {
+                int iSize = fread ( pJob->pstrDiag, 1, MAX_DIAG_SIZE - 1, pFile );
+                pJob->pstrDiag [ iSize ] = '\0';
+                fclose ( pFile );
+            }
+        }
+
+        remove ( pstrLogFilename );
+
+        return iSucceeded;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompileBatchJob ()
+    *
+    *   Compiles a single file of the batch with the calling thread's context.
+    */
+
+    void CompileBatchJob ( BatchJob * pJob )
+    {
+        // Reset the context and apply the command-line options
+
+        Init ();
+
+        g_pContext->ScriptHeader = g_pBatchOptions->ScriptHeader;
+        g_pContext->iPreserveOutputFile = g_pBatchOptions->iPreserveOutputFile;
+        g_pContext->iGenerateXSE = g_pBatchOptions->iGenerateXSE;
+
+        SetFilenames ( pJob->pstrSourceFilename, NULL );
+
+        // Errors return here rather than exiting
+
+        g_pContext->iCanRecover = TRUE;
+
+        char pstrCacheKey [ CACHE_KEY_SIZE ];
+
+        if ( setjmp ( g_pContext->ErrorJump ) == 0 )
+        {
+            // Run the front end
+
+            LoadSourceFile ();
+            PreprocessSourceFile ();
+
+            pJob->iSourceLineCount = g_pContext->SourceCode.iNodeCount;
+
+            // Reuse the cached output if there is any, otherwise run the back end
+
+            if ( g_iIsCacheEnabled )
+            {
+                GetCacheKey ( pstrCacheKey );
+                pJob->iIsCached = FetchFromCache ( pstrCacheKey );
+            }
+
+            if ( ! pJob->iIsCached )
+            {
+                CompileSourceFile ();
+                EmitCode ();
+            }
+        }
+        else
+        {
+            // Save the diagnostic output
+
+            pJob->pstrDiag = ( char * ) malloc ( strlen ( g_pContext->pstrDiag ) + 1 );
+            strcpy ( pJob->pstrDiag, g_pContext->pstrDiag );
+        }
+
+        // Free the file's resources
+
+        ShutDown ();
+
+        // Assemble the output file unless compilation failed or the user requests otherwise
+
+        if ( ! pJob->pstrDiag && ! pJob->iIsCached )
+        {
+            // Store the output in the cache if it assembled successfully
+
+            if ( ! g_pContext->iGenerateXSE || AssmblBatchOutputFile ( pJob ) )
+                if ( g_iIsCacheEnabled )
+                    StoreInCache ( pstrCacheKey );
+
+            if ( ! g_pContext->iPreserveOutputFile )
+                remove ( g_pContext->pstrOutputFilename );
+        }
+
+        // Publish the result only once everything else is in place
+
+        InterlockedExchange ( ( long * ) & pJob->lStatus, pJob->pstrDiag ? BATCH_JOB_FAILED : BATCH_JOB_SUCCEEDED );
+    }
+
+    /******************************************************************************************
+    *
+    *   BatchWorker ()
+    *
+    *   Worker thread entry point. Each worker takes the next uncompiled file until none are
+    *   left.
+    */
+
+    unsigned __stdcall BatchWorker ( void * pParam )
+    {
+        // Give the thread its own context
+
+        CompilerContext * pContext = ( CompilerContext * ) malloc ( sizeof ( CompilerContext ) );
+        g_pContext = pContext;
+
+        // Compile jobs until they run out
+
+        while ( TRUE )
+        {
+            long lJobIndex = InterlockedIncrement ( ( long * ) & g_lNextBatchJob ) - 1;
+            if ( lJobIndex >= g_iBatchJobCount )
+                break;
+
+            CompileBatchJob ( & g_pBatchJobs [ lJobIndex ] );
+        }
+
+        free ( pContext );
+
+        return 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompileBatch ()
+    *
+    *   Compiles each file named by a file list or found in a directory on a pool of worker
+    *   threads, and prints the results in order followed by a summary. The current context
+    *   supplies the command-line options. Returns the number of files that failed.
+    */
+
+    int CompileBatch ( char * pstrInput )
+    {
+        // ---- Gather the files
+
+        if ( pstrInput [ 0 ] == BATCH_LIST_PREFIX )
+            LoadBatchFileList ( pstrInput + 1 );
+        else
+            LoadBatchDirectory ( pstrInput );
+
+        if ( ! g_iBatchJobCount )
+            ExitOnError ( "No source files to compile" );
+
+        // ---- Size the worker pool
+
+        // Default to one worker per processor
+
+        if ( ! g_iBatchWorkerCount )
+        {
+            SYSTEM_INFO SysInfo;
+            GetSystemInfo ( & SysInfo );
+            g_iBatchWorkerCount = SysInfo.dwNumberOfProcessors;
+        }
+
+        if ( g_iBatchWorkerCount > MAX_BATCH_WORKER_COUNT )
+            g_iBatchWorkerCount = MAX_BATCH_WORKER_COUNT;
+        if ( g_iBatchWorkerCount > g_iBatchJobCount )
+            g_iBatchWorkerCount = g_iBatchJobCount;
+
+        // ---- Start the workers
+
+        printf ( "Compiling %d files with %d worker threads...\n\n", g_iBatchJobCount, g_iBatchWorkerCount );
+
+        g_pBatchOptions = g_pContext;
+
+        if ( g_iIsCacheEnabled )
+            InitCache ();
+
+        unsigned int iStartTime = GetTickCount ();
+
+        HANDLE phWorkers [ MAX_BATCH_WORKER_COUNT ];
+        int iCurrWorker;
+
+        for ( iCurrWorker = 0; iCurrWorker < g_iBatchWorkerCount; ++ iCurrWorker )
+            if ( ! ( phWorkers [ iCurrWorker ] = ( HANDLE ) _beginthreadex ( NULL, 0, BatchWorker, NULL, 0, NULL ) ) )
+                ExitOnError ( "Could not create worker thread" );
+
+        // ---- Report each file in list order as soon as it's done, so the output doesn't
+        //      depend on how the workers were scheduled
+
+        int iSucceededCount = 0,
+            iSourceLineCount = 0;
+        int iCurrJob;
+
+        for ( iCurrJob = 0; iCurrJob < g_iBatchJobCount; ++ iCurrJob )
+        {
+            BatchJob * pJob = & g_pBatchJobs [ iCurrJob ];
+
+            while ( pJob->lStatus == BATCH_JOB_PENDING )
+                Sleep ( 1 );
+
+            if ( pJob->lStatus == BATCH_JOB_SUCCEEDED )
+            {
+                if ( pJob->iIsCached )
+                    printf ( "%s: OK (cached)\n", pJob->pstrSourceFilename );
+                else
+                    printf ( "%s: OK\n", pJob->pstrSourceFilename );
+
+                ++ iSucceededCount;
+                iSourceLineCount += pJob->iSourceLineCount;
+            }
+            else
+            {
+                printf ( "%s: Failed\n\n%s\n\n", pJob->pstrSourceFilename, pJob->pstrDiag );
+            }
+        }
+
+        // ---- Wait for the workers to exit
+
+        for ( iCurrWorker = 0; iCurrWorker < g_iBatchWorkerCount; ++ iCurrWorker )
+        {
+            WaitForSingleObject ( phWorkers [ iCurrWorker ], INFINITE );
+            CloseHandle ( phWorkers [ iCurrWorker ] );
+        }
+
+        unsigned int iElapsedTime = GetTickCount () - iStartTime;
+
+        // ---- Print the summary
+
+        float fElapsedSecs = iElapsedTime / 1000.0f;
+        if ( fElapsedSecs <= 0 )
+            fElapsedSecs = 0.001f;
+
+        printf ( "\n" );
+        printf ( "         Files Compiled: %d\n", g_iBatchJobCount );
+        printf ( "              Succeeded: %d\n", iSucceededCount );
+        printf ( "                 Failed: %d\n", g_iBatchJobCount - iSucceededCount );
+        printf ( " Source Lines Processed: %d\n", iSourceLineCount );
+        printf ( "         Worker Threads: %d\n", g_iBatchWorkerCount );
+        printf ( "           Elapsed Time: %.3fs\n", fElapsedSecs );
+        printf ( "             Throughput: %.1f files/s, %.0f lines/s\n",
+                 g_iBatchJobCount / fElapsedSecs, iSourceLineCount / fElapsedSecs );
+        printf ( "\n" );
+
+        if ( g_iIsCacheEnabled )
+        {
+            PrintCacheStats ();
+            ShutDownCache ();
+        }
+
+        // ---- Free the jobs
+
+        for ( iCurrJob = 0; iCurrJob < g_iBatchJobCount; ++ iCurrJob )
+        {
+            free ( g_pBatchJobs [ iCurrJob ].pstrSourceFilename );
+            if ( g_pBatchJobs [ iCurrJob ].pstrDiag )
+                free ( g_pBatchJobs [ iCurrJob ].pstrDiag );
+        }
+        free ( g_pBatchJobs );
+
+        return g_iBatchJobCount - iSucceededCount;
+    }
@@ -0,0 +1,69 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Batch compilation module header
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+#ifndef XSC_BATCH
+#define XSC_BATCH
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xsc.h"
+    #include "context.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #define BATCH_LIST_PREFIX           '@'             // Marks a file list on the command line
+
+    #define MAX_BATCH_WORKER_COUNT      64              // Maximum number of worker threads
+
+    // ---- Job Status ------------------------------------------------------------------------
+
+        #define BATCH_JOB_PENDING       0               // Not compiled yet
+        #define BATCH_JOB_SUCCEEDED     1               // Compiled successfully
+        #define BATCH_JOB_FAILED        2               // Compilation failed
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _BatchJob                            // A single file in a batch
+    {
+        char * pstrSourceFilename;                      // The source filename
+        volatile long lStatus;                          // The job status
+        char * pstrDiag;                                // Diagnostic output from a failed
+                                                        // compile
+        int iSourceLineCount;                           // Number of source lines processed
+        int iIsCached;                                  // Was the output fetched from the
+                                                        // compilation cache?
+    }
+        BatchJob;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    extern int g_iBatchWorkerCount;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    int IsBatchInput ( char * pstrInput );
+
+    void LoadBatchFileList ( char * pstrListFilename );
+    void LoadBatchDirectory ( char * pstrDirName );
+    void AddBatchJob ( char * pstrSourceFilename );
+
+    void CompileBatchJob ( BatchJob * pJob );
+    int AssmblBatchOutputFile ( BatchJob * pJob );
+    unsigned __stdcall BatchWorker ( void * pParam );
+
+    int CompileBatch ( char * pstrInput );
+
+#endif
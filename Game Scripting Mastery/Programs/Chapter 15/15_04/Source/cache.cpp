@@ -0,0 +1,526 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Compilation cache module
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <windows.h>
+    #include <io.h>
+    #include <direct.h>
+    #include <sys/utime.h>
+    #include <sys/types.h>
+    #include <sys/stat.h>
+
+    #include "cache.h"
+    #include "context.h"
+    #include "error.h"
+    #include "parser.h"
+    #include "type_infer.h"
+    #include "code_emit.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #define COPY_BUFFER_SIZE            8192            // Size of the file copying buffer
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _CacheEntry                          // A cache entry found during eviction
+    {
+        char pstrName [ MAX_FILENAME_SIZE ];            // Filename within the cache directory
+        unsigned int iSize;                             // Size in bytes
+        time_t LastUseTime;                             // Time of the last store or hit
+    }
+        CacheEntry;
+
+// ---- Globals -------------------------------------------------------------------------------
+
+    // ---- Settings --------------------------------------------------------------------------
+
+        int g_iIsCacheEnabled = FALSE;                  // Is the cache enabled?
+        char g_pstrCacheDirName [ MAX_FILENAME_SIZE ];  // The cache directory
+        unsigned int g_iMaxCacheSize = DEFAULT_MAX_CACHE_SIZE;
+                                                        // The size limit, in KB
+
+        char g_pstrAssmblStamp [ 64 ];                  // Tells one build of XASM from another
+
+    // ---- Contents --------------------------------------------------------------------------
+
+        CRITICAL_SECTION g_CacheLock;                   // Guards the size and entry count
+
+        unsigned int g_iCacheSize;                      // Total size of the entries in bytes
+        int g_iCacheEntryCount;                         // Number of entries
+
+    // ---- Statistics ------------------------------------------------------------------------
+
+        long g_lCacheHitCount = 0;                      // Files fetched from the cache
+        long g_lCacheMissCount = 0;                     // Files that had to be compiled
+        long g_lCacheEvictionCount = 0;                 // Entries evicted to make room
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   IsCacheEntryFilename ()
+    *
+    *   Determines if a file in the cache directory is a cache entry.
+    */
+
+    int IsCacheEntryFilename ( char * pstrFilename )
+    {
+        char * pstrExt = strrchr ( pstrFilename, '.' );
+        if ( ! pstrExt )
+            return FALSE;
+
+        return stricmp ( pstrExt, CACHE_EXEC_EXT ) == 0 || stricmp ( pstrExt, CACHE_ASSMBL_EXT ) == 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   InitCache ()
+    *
+    *   Creates the cache directory if necessary and totals up the size of its entries.
+    */
+
+    void InitCache ()
+    {
+        InitializeCriticalSection ( & g_CacheLock );
+
+        // Create the directory; this fails harmlessly if it already exists
+
+        _mkdir ( g_pstrCacheDirName );
+
+        // XASM can't be asked which version it is, so its size and modification time stand
+        // in for one. A rebuilt assembler then can't be handed executables the old one wrote.
+
+        struct _stat AssmblInfo;
+
+        if ( _stat ( ASSMBL_FILENAME, & AssmblInfo ) == 0 )
+            sprintf ( g_pstrAssmblStamp, "%lu:%lu", ( unsigned long ) AssmblInfo.st_size, ( unsigned long ) AssmblInfo.st_mtime );
+        else
+            strcpy ( g_pstrAssmblStamp, "None" );
+
+        // Total up the existing entries
+
+        g_iCacheSize = 0;
+        g_iCacheEntryCount = 0;
+
+        char pstrPattern [ MAX_FILENAME_SIZE ];
+        sprintf ( pstrPattern, "%s\\*.*", g_pstrCacheDirName );
+
+        struct _finddata_t FileInfo;
+        long lFindHandle = _findfirst ( pstrPattern, & FileInfo );
+
+        if ( lFindHandle == -1 )
+            return;
+
+        do
+        {
+            if ( IsCacheEntryFilename ( FileInfo.name ) )
+            {
+                g_iCacheSize += FileInfo.size;
+                ++ g_iCacheEntryCount;
+            }
+        }
+        while ( _findnext ( lFindHandle, & FileInfo ) == 0 );
+
+        _findclose ( lFindHandle );
+    }
+
+    /******************************************************************************************
+    *
+    *   ShutDownCache ()
+    *
+    *   Shuts down the cache.
+    */
+
+    void ShutDownCache ()
+    {
+        DeleteCriticalSection ( & g_CacheLock );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetCacheKey ()
+    *
+    *   Hashes the current context's preprocessed source code, along with the compiler's
+    *   version and code generation revision, the assembler and the executable format it's
+    *   asked for, and every other option that affects the output, into a string of hex
+    *   digits. The hash is 64-bit FNV-1a.
+    */
+
+    void GetCacheKey ( char * pstrKey )
+    {
+        // Start with the FNV offset basis
+
+        unsigned __int64 iHash = ( ( unsigned __int64 ) 0xCBF29CE4 << 32 ) | 0x84222325;
+        unsigned __int64 iPrime = ( ( unsigned __int64 ) 0x00000100 << 32 ) | 0x000001B3;
+
+        // Build a string from the version and options
+
+        char pstrOptions [ 256 ];
+        sprintf ( pstrOptions, "XSC %d.%d R%d XASM %s X%d S%d P%d:%d N%d I%d T%d L%d\n",
+                  VERSION_MAJOR, VERSION_MINOR, CODEGEN_REVISION,
+                  g_pstrAssmblStamp,
+                  g_iIsLegacyXSE,
+                  g_pContext->ScriptHeader.iStackSize,
+                  g_pContext->ScriptHeader.iPriorityType,
+                  g_pContext->ScriptHeader.iUserPriority,
+                  g_pContext->iGenerateXSE,
+                  g_iInlineThreshold,
+                  g_iIsTypeInferenceEnabled,
+                  g_iIsLineInfoEnabled );
+
+        // Hash the options, then each line of source
+
+        char * pstrCurrChar;
+
+        for ( pstrCurrChar = pstrOptions; * pstrCurrChar; ++ pstrCurrChar )
+            iHash = ( iHash ^ ( unsigned char ) * pstrCurrChar ) * iPrime;
+
+        // Line numbers are emitted along with the name of the source file, so the name
+        // matters too
+
+        if ( g_iIsLineInfoEnabled )
+            for ( pstrCurrChar = g_pContext->pstrSourceFilename; * pstrCurrChar; ++ pstrCurrChar )
+                iHash = ( iHash ^ ( unsigned char ) * pstrCurrChar ) * iPrime;
+
+        LinkedListNode * pNode = g_pContext->SourceCode.pHead;
+
+        for ( int iCurrLine = 0; iCurrLine < g_pContext->SourceCode.iNodeCount; ++ iCurrLine )
+        {
+            for ( pstrCurrChar = ( char * ) pNode->pData; * pstrCurrChar; ++ pstrCurrChar )
+                iHash = ( iHash ^ ( unsigned char ) * pstrCurrChar ) * iPrime;
+
+            // Hash a terminator too, so that line boundaries count
+
+            iHash = ( iHash ^ 0xFF ) * iPrime;
+
+            pNode = pNode->pNext;
+        }
+
+        // Convert the hash to a string
+
+        sprintf ( pstrKey, "%08X%08X", ( unsigned int ) ( iHash >> 32 ), ( unsigned int ) iHash );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetCacheEntryFilename ()
+    *
+    *   Builds the filename of a cache entry.
+    */
+
+    void GetCacheEntryFilename ( char * pstrKey, char * pstrExt, char * pstrFilename )
+    {
+        sprintf ( pstrFilename, "%s\\%s%s", g_pstrCacheDirName, pstrKey, pstrExt );
+    }
+
+    /******************************************************************************************
+    *
+    *   CopyCacheFile ()
+    *
+    *   Copies a file. Returns the number of bytes copied, or -1 on failure.
+    */
+
+    int CopyCacheFile ( char * pstrSourceFilename, char * pstrDestFilename )
+    {
+        // Open both files
+
+        FILE * pSourceFile,
+             * pDestFile;
+
+        if ( ! ( pSourceFile = fopen ( pstrSourceFilename, "rb" ) ) )
+            return -1;
+
+        if ( ! ( pDestFile = fopen ( pstrDestFilename, "wb" ) ) )
+        {
+            fclose ( pSourceFile );
+            return -1;
+        }
+
+        // Copy the contents a block at a time
+
+        char pBuffer [ COPY_BUFFER_SIZE ];
+        int iSize = 0;
+        int iBlockSize;
+
+        while ( ( iBlockSize = fread ( pBuffer, 1, COPY_BUFFER_SIZE, pSourceFile ) ) > 0 )
+        {
+            if ( fwrite ( pBuffer, 1, iBlockSize, pDestFile ) != ( size_t ) iBlockSize )
+            {
+                iSize = -1;
+                break;
+            }
+
+            iSize += iBlockSize;
+        }
+
+        fclose ( pSourceFile );
+        fclose ( pDestFile );
+
+        return iSize;
+    }
+
+    /******************************************************************************************
+    *
+    *   FetchFromCache ()
+    *
+    *   Looks up the current context's output in the cache and, if every requested file is
+    *   present, copies it into place. Returns TRUE on a hit.
+    */
+
+    int FetchFromCache ( char * pstrKey )
+    {
+        char pstrExecEntry [ MAX_FILENAME_SIZE ],
+             pstrAssmblEntry [ MAX_FILENAME_SIZE ];
+
+        GetCacheEntryFilename ( pstrKey, CACHE_EXEC_EXT, pstrExecEntry );
+        GetCacheEntryFilename ( pstrKey, CACHE_ASSMBL_EXT, pstrAssmblEntry );
+
+        // It's only a hit if every file the options call for is cached
+
+        int iIsHit = TRUE;
+
+        if ( g_pContext->iGenerateXSE && _access ( pstrExecEntry, 0 ) != 0 )
+            iIsHit = FALSE;
+
+        if ( g_pContext->iPreserveOutputFile && _access ( pstrAssmblEntry, 0 ) != 0 )
+            iIsHit = FALSE;
+
+        // Copy the entries into place, marking each one as recently used
+
+        if ( iIsHit && g_pContext->iGenerateXSE )
+        {
+            char pstrExecFilename [ MAX_FILENAME_SIZE ];
+            GetExecFilename ( pstrExecFilename );
+
+            if ( CopyCacheFile ( pstrExecEntry, pstrExecFilename ) == -1 )
+                iIsHit = FALSE;
+            else
+                _utime ( pstrExecEntry, NULL );
+        }
+
+        if ( iIsHit && g_pContext->iPreserveOutputFile )
+        {
+            if ( CopyCacheFile ( pstrAssmblEntry, g_pContext->pstrOutputFilename ) == -1 )
+                iIsHit = FALSE;
+            else
+                _utime ( pstrAssmblEntry, NULL );
+        }
+
+        // Update the statistics
+
+        if ( iIsHit )
+            InterlockedIncrement ( & g_lCacheHitCount );
+        else
+            InterlockedIncrement ( & g_lCacheMissCount );
+
+        return iIsHit;
+    }
+
+    /******************************************************************************************
+    *
+    *   StoreCacheEntry ()
+    *
+    *   Copies a single output file into the cache. The copy is made under a temporary name
+    *   first so other threads and processes never see a partial entry.
+    */
+
+    void StoreCacheEntry ( char * pstrFilename, char * pstrEntry )
+    {
+        // The entry may already be cached from a run with different options
+
+        if ( _access ( pstrEntry, 0 ) == 0 )
+            return;
+
+        char pstrTempEntry [ MAX_FILENAME_SIZE + 16 ];
+        sprintf ( pstrTempEntry, "%s.%lu", pstrEntry, GetCurrentThreadId () );
+
+        int iSize = CopyCacheFile ( pstrFilename, pstrTempEntry );
+
+        // If the copy failed or another thread stored the entry first, discard it
+
+        if ( iSize == -1 || rename ( pstrTempEntry, pstrEntry ) != 0 )
+        {
+            remove ( pstrTempEntry );
+            return;
+        }
+
+        EnterCriticalSection ( & g_CacheLock );
+        g_iCacheSize += iSize;
+        ++ g_iCacheEntryCount;
+        LeaveCriticalSection ( & g_CacheLock );
+    }
+
+    /******************************************************************************************
+    *
+    *   StoreInCache ()
+    *
+    *   Stores the current context's output files in the cache, then evicts old entries if
+    *   the cache has grown past its limit.
+    */
+
+    void StoreInCache ( char * pstrKey )
+    {
+        char pstrEntry [ MAX_FILENAME_SIZE ];
+
+        // Store the executable
+
+        if ( g_pContext->iGenerateXSE )
+        {
+            char pstrExecFilename [ MAX_FILENAME_SIZE ];
+            GetExecFilename ( pstrExecFilename );
+
+            GetCacheEntryFilename ( pstrKey, CACHE_EXEC_EXT, pstrEntry );
+            StoreCacheEntry ( pstrExecFilename, pstrEntry );
+        }
+
+        // Store the assembly file if it's being kept
+
+        if ( g_pContext->iPreserveOutputFile )
+        {
+            GetCacheEntryFilename ( pstrKey, CACHE_ASSMBL_EXT, pstrEntry );
+            StoreCacheEntry ( g_pContext->pstrOutputFilename, pstrEntry );
+        }
+
+        // Make room if necessary
+
+        if ( g_iCacheSize > g_iMaxCacheSize * 1024 )
+            EvictFromCache ();
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareCacheEntries ()
+    *
+    *   qsort () callback for ordering cache entries from least to most recently used.
+    */
+
+    int CompareCacheEntries ( const void * pEntry0, const void * pEntry1 )
+    {
+        time_t Time0 = ( ( CacheEntry * ) pEntry0 )->LastUseTime,
+               Time1 = ( ( CacheEntry * ) pEntry1 )->LastUseTime;
+
+        if ( Time0 < Time1 )
+            return -1;
+        if ( Time0 > Time1 )
+            return 1;
+        return 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   EvictFromCache ()
+    *
+    *   Deletes the least recently used entries until the cache is down to three quarters of
+    *   its limit, so eviction doesn't have to run again on every store.
+    */
+
+    void EvictFromCache ()
+    {
+        EnterCriticalSection ( & g_CacheLock );
+
+        // Other threads may have evicted while we waited for the lock
+
+        if ( g_iCacheSize <= g_iMaxCacheSize * 1024 )
+        {
+            LeaveCriticalSection ( & g_CacheLock );
+            return;
+        }
+
+        // ---- Gather the entries and re-total the cache, since other processes may share it
+
+        CacheEntry * pEntries = NULL;
+        int iEntryCount = 0,
+            iEntryCapacity = 0;
+
+        g_iCacheSize = 0;
+
+        char pstrPattern [ MAX_FILENAME_SIZE ];
+        sprintf ( pstrPattern, "%s\\*.*", g_pstrCacheDirName );
+
+        struct _finddata_t FileInfo;
+        long lFindHandle = _findfirst ( pstrPattern, & FileInfo );
+
+        if ( lFindHandle != -1 )
+        {
+            do
+            {
+                if ( ! IsCacheEntryFilename ( FileInfo.name ) )
+                    continue;
+
+                // Grow the entry array if it's full
+
+                if ( iEntryCount == iEntryCapacity )
+                {
+                    iEntryCapacity = iEntryCapacity ? iEntryCapacity * 2 : 256;
+                    pEntries = ( CacheEntry * ) realloc ( pEntries, iEntryCapacity * sizeof ( CacheEntry ) );
+                }
+
+                CacheEntry * pEntry = & pEntries [ iEntryCount ++ ];
+                strcpy ( pEntry->pstrName, FileInfo.name );
+                pEntry->iSize = FileInfo.size;
+                pEntry->LastUseTime = FileInfo.time_write;
+
+                g_iCacheSize += FileInfo.size;
+            }
+            while ( _findnext ( lFindHandle, & FileInfo ) == 0 );
+
+            _findclose ( lFindHandle );
+        }
+
+        g_iCacheEntryCount = iEntryCount;
+
+        // ---- Delete the oldest entries until the cache is under the low-water mark
+
+        qsort ( pEntries, iEntryCount, sizeof ( CacheEntry ), CompareCacheEntries );
+
+        unsigned int iTargetSize = g_iMaxCacheSize * 1024 / 4 * 3;
+
+        for ( int iCurrEntry = 0; iCurrEntry < iEntryCount && g_iCacheSize > iTargetSize; ++ iCurrEntry )
+        {
+            char pstrEntry [ MAX_FILENAME_SIZE ];
+            sprintf ( pstrEntry, "%s\\%s", g_pstrCacheDirName, pEntries [ iCurrEntry ].pstrName );
+
+            if ( remove ( pstrEntry ) == 0 )
+            {
+                g_iCacheSize -= pEntries [ iCurrEntry ].iSize;
+                -- g_iCacheEntryCount;
+                ++ g_lCacheEvictionCount;
+            }
+        }
+
+        if ( pEntries )
+            free ( pEntries );
+
+        LeaveCriticalSection ( & g_CacheLock );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintCacheStats ()
+    *
+    *   Prints the cache statistics for this run.
+    */
+
+    void PrintCacheStats ()
+    {
+        printf ( "            Cache Hits: %ld\n", g_lCacheHitCount );
+        printf ( "          Cache Misses: %ld\n", g_lCacheMissCount );
+        printf ( "       Cache Evictions: %ld\n", g_lCacheEvictionCount );
+        printf ( "         Cache Entries: %d\n", g_iCacheEntryCount );
+        printf ( "            Cache Size: %dKB of %dKB\n", ( g_iCacheSize + 1023 ) / 1024, g_iMaxCacheSize );
+        printf ( "\n" );
+    }
@@ -0,0 +1,56 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Compilation cache module header
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+#ifndef XSC_CACHE
+#define XSC_CACHE
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xsc.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #define CACHE_KEY_SIZE              17              // Size of a cache key string (16 hex
+                                                        // digits and a null terminator)
+
+    #define DEFAULT_MAX_CACHE_SIZE      65536           // Default cache size limit, in KB
+
+    #define CACHE_EXEC_EXT              ".XSE"          // Extension of a cached executable
+    #define CACHE_ASSMBL_EXT            ".XAS"          // Extension of a cached assembly file
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    extern int g_iIsCacheEnabled;
+    extern char g_pstrCacheDirName [ MAX_FILENAME_SIZE ];
+    extern unsigned int g_iMaxCacheSize;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void InitCache ();
+    void ShutDownCache ();
+
+    void GetCacheKey ( char * pstrKey );
+    void GetCacheEntryFilename ( char * pstrKey, char * pstrExt, char * pstrFilename );
+
+    int CopyCacheFile ( char * pstrSourceFilename, char * pstrDestFilename );
+
+    int FetchFromCache ( char * pstrKey );
+    void StoreInCache ( char * pstrKey );
+    void EvictFromCache ();
+
+    void PrintCacheStats ();
+
+#endif
@@ -21,10 +21,12 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "code_emit.h"
+    #include "context.h"
 
 // ---- Globals -------------------------------------------------------------------------------
 
-    FILE * g_pOutputFile = NULL;                        // Pointer to the output file
+    int g_iIsLineInfoEnabled = TRUE;                    // Should source line numbers be
+                                                        // emitted for the debug info table?
 
     // ---- Instruction Mnemonics -------------------------------------------------------------
 
@@ -40,7 +42,14 @@
             "Jmp", "JE", "JNE", "JG", "JL", "JGE", "JLE",
             "Push", "Pop",
             "Call", "Ret", "CallHost",
-            "Pause", "Exit"
+            "Pause", "Exit",
+            "IAdd", "ISub", "IMul", "IDiv", "IMod", "IInc", "IDec",
+            "FAdd", "FSub", "FMul", "FDiv",
+            "IJE", "IJNE", "IJG", "IJL", "IJGE", "IJLE",
+            "JTab",
+            "Sqrt", "Sin", "Cos", "ATan2", "Abs", "Min", "Max",
+            "VAdd", "VSub", "VScale", "VDot",
+            "Yield"
         };
 
 // ---- Functions -----------------------------------------------------------------------------
@@ -63,13 +72,13 @@
 
         // Emit the filename
 
-        fprintf ( g_pOutputFile, "; %s\n\n", g_pstrOutputFilename );
+        fprintf ( g_pContext->pOutputFile, "; %s\n\n", g_pContext->pstrOutputFilename );
 
         // Emit the rest of the header
 
-        fprintf ( g_pOutputFile, "; Source File: %s\n", g_pstrSourceFilename );
-        fprintf ( g_pOutputFile, "; XSC Version: %d.%d\n", VERSION_MAJOR, VERSION_MINOR );
-        fprintf ( g_pOutputFile, ";   Timestamp: %s\n", asctime ( pCurrTime ) );
+        fprintf ( g_pContext->pOutputFile, "; Source File: %s\n", g_pContext->pstrSourceFilename );
+        fprintf ( g_pContext->pOutputFile, "; XSC Version: %d.%d\n", VERSION_MAJOR, VERSION_MINOR );
+        fprintf ( g_pContext->pOutputFile, ";   Timestamp: %s\n", asctime ( pCurrTime ) );
     }
 
     /******************************************************************************************
@@ -86,46 +95,62 @@
 
         int iAddNewline = FALSE;
 
+        // If line numbers are being emitted, name the source file they refer to. Backslashes
+        // in the path have to be escaped, since it's emitted as a string.
+
+        if ( g_iIsLineInfoEnabled )
+        {
+            fprintf ( g_pContext->pOutputFile, "\tSetSourceFile \"" );
+            for ( char * pstrCurrChar = g_pContext->pstrSourceFilename; * pstrCurrChar; ++ pstrCurrChar )
+            {
+                if ( * pstrCurrChar == '\\' || * pstrCurrChar == '"' )
+                    fputc ( '\\', g_pContext->pOutputFile );
+                fputc ( * pstrCurrChar, g_pContext->pOutputFile );
+            }
+            fprintf ( g_pContext->pOutputFile, "\"\n" );
+            iAddNewline = TRUE;
+        }
+
         // If the stack size has been set, emit a SetStackSize directive
 
-        if ( g_ScriptHeader.iStackSize )
+        if ( g_pContext->ScriptHeader.iStackSize )
         {
-            fprintf ( g_pOutputFile, "\tSetStackSize %d\n", g_ScriptHeader.iStackSize );
+            fprintf ( g_pContext->pOutputFile, "\tSetStackSize %d\n", g_pContext->ScriptHeader.iStackSize );
             iAddNewline = TRUE;
         }
 
         // If the priority has been set, emit a SetPriority directive
 
-        if ( g_ScriptHeader.iPriorityType != PRIORITY_NONE )
+        if ( g_pContext->ScriptHeader.iPriorityType != PRIORITY_NONE )
         {
-            fprintf ( g_pOutputFile, "\tSetPriority " );
-            switch ( g_ScriptHeader.iPriorityType )
+            fprintf ( g_pContext->pOutputFile, "\tSetPriority " );
+            switch ( g_pContext->ScriptHeader.iPriorityType )
             {
                 // Low rank
 
                 case PRIORITY_LOW:
-                    fprintf ( g_pOutputFile, PRIORITY_LOW_KEYWORD );
+                    fprintf ( g_pContext->pOutputFile, PRIORITY_LOW_KEYWORD );
                     break;
 
                 // Medium rank
 
                 case PRIORITY_MED:
-                    fprintf ( g_pOutputFile, PRIORITY_MED_KEYWORD );
+                    fprintf ( g_pContext->pOutputFile, PRIORITY_MED_KEYWORD );
                     break;
 
                 // High rank
 
                 case PRIORITY_HIGH:
-                    fprintf ( g_pOutputFile, PRIORITY_HIGH_KEYWORD );
+                    fprintf ( g_pContext->pOutputFile, PRIORITY_HIGH_KEYWORD );
                     break;
 
                 // User-defined timeslice
 
                 case PRIORITY_USER:
-                    fprintf ( g_pOutputFile, "%d", g_ScriptHeader.iUserPriority );
+                    fprintf ( g_pContext->pOutputFile, "%d", g_pContext->ScriptHeader.iUserPriority );
                     break;
             }
-            fprintf ( g_pOutputFile, "\n" );
+            fprintf ( g_pContext->pOutputFile, "\n" );
 
             iAddNewline = TRUE;
         }
@@ -133,7 +158,7 @@
         // If necessary, insert an extra line break
 
         if ( iAddNewline )
-            fprintf ( g_pOutputFile, "\n" );
+            fprintf ( g_pContext->pOutputFile, "\n" );
     }
 
     /******************************************************************************************
@@ -156,7 +181,7 @@
 
         // Loop through each symbol in the table to find the match
 
-        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
+        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_pContext->SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
         {
             // Get the current symbol structure
 
@@ -168,28 +193,28 @@
             {
                 // Print one tab stop for global declarations, and two for locals
 
-                fprintf ( g_pOutputFile, "\t" );
+                fprintf ( g_pContext->pOutputFile, "\t" );
                 if ( iScope != SCOPE_GLOBAL )
-                    fprintf ( g_pOutputFile, "\t" );
+                    fprintf ( g_pContext->pOutputFile, "\t" );
 
                 // Is the symbol a parameter?
 
                 if ( pCurrSymbol->iType == SYMBOL_TYPE_PARAM )
-                    fprintf ( g_pOutputFile, "Param %s", pCurrSymbol->pstrIdent );
+                    fprintf ( g_pContext->pOutputFile, "Param %s", pCurrSymbol->pstrIdent );
 
                 // Is the symbol a variable?
 
                 if ( pCurrSymbol->iType == SYMBOL_TYPE_VAR )
                 {
-                    fprintf ( g_pOutputFile, "Var %s", pCurrSymbol->pstrIdent );
+                    fprintf ( g_pContext->pOutputFile, "Var %s", pCurrSymbol->pstrIdent );
 
                     // If the variable is an array, add the size declaration
 
                     if ( pCurrSymbol->iSize > 1 )
-                        fprintf ( g_pOutputFile, " [ %d ]", pCurrSymbol->iSize );
+                        fprintf ( g_pContext->pOutputFile, " [ %d ]", pCurrSymbol->iSize );
                 }
 
-                fprintf ( g_pOutputFile, "\n" );
+                fprintf ( g_pContext->pOutputFile, "\n" );
                 iAddNewline = TRUE;
             }
         }
@@ -197,7 +222,78 @@
         // If necessary, insert an extra line break
 
         if ( iAddNewline )
-            fprintf ( g_pOutputFile, "\n" );
+            fprintf ( g_pContext->pOutputFile, "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitOp ()
+    *
+    *   Emits a single instruction operand.
+    */
+
+    void EmitOp ( Op * pOp )
+    {
+        // Emit the operand based on its type
+
+        switch ( pOp->iType )
+        {
+            // Integer literal
+
+            case OP_TYPE_INT:
+                fprintf ( g_pContext->pOutputFile, "%d", pOp->iIntLiteral );
+                break;
+
+            // Float literal
+
+            case OP_TYPE_FLOAT:
+                fprintf ( g_pContext->pOutputFile, "%f", pOp->fFloatLiteral );
+                break;
+
+            // String literal
+
+            case OP_TYPE_STRING_INDEX:
+                fprintf ( g_pContext->pOutputFile, "\"%s\"", GetStringByIndex ( & g_pContext->StringTable, pOp->iStringIndex ) );
+                break;
+
+            // Variable
+
+            case OP_TYPE_VAR:
+                fprintf ( g_pContext->pOutputFile, "%s", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent );
+                break;
+
+            // Array index absolute
+
+            case OP_TYPE_ARRAY_INDEX_ABS:
+                fprintf ( g_pContext->pOutputFile, "%s [ %d ]", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent,
+                                                      pOp->iOffset );
+                break;
+
+            // Array index variable
+
+            case OP_TYPE_ARRAY_INDEX_VAR:
+                fprintf ( g_pContext->pOutputFile, "%s [ %s ]", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent,
+                                                      GetSymbolByIndex ( pOp->iOffsetSymbolIndex )->pstrIdent );
+                break;
+
+            // Function
+
+            case OP_TYPE_FUNC_INDEX:
+                fprintf ( g_pContext->pOutputFile, "%s", GetFuncByIndex ( pOp->iSymbolIndex )->pstrName );
+                break;
+
+            // Register (just _RetVal for now)
+
+            case OP_TYPE_REG:
+                fprintf ( g_pContext->pOutputFile, "_RetVal" );
+                break;
+
+            // Jump target index
+
+            case OP_TYPE_JUMP_TARGET_INDEX:
+                fprintf ( g_pContext->pOutputFile, "_L%d", pOp->iJumpTargetIndex );
+                break;
+        }
     }
 
     /******************************************************************************************
@@ -211,8 +307,8 @@
     {
         // Emit the function declaration name and opening brace
 
-        fprintf ( g_pOutputFile, "\tFunc %s\n", pFunc->pstrName );
-        fprintf ( g_pOutputFile, "\t{\n" );
+        fprintf ( g_pContext->pOutputFile, "\tFunc %s\n", pFunc->pstrName );
+        fprintf ( g_pContext->pOutputFile, "\t{\n" );
 
         // Emit parameter declarations
 
@@ -260,9 +356,14 @@
                         // first one
 
                         if ( ! iIsFirstSourceLine )
-                            fprintf ( g_pOutputFile, "\n" );
+                            fprintf ( g_pContext->pOutputFile, "\n" );
+
+                        fprintf ( g_pContext->pOutputFile, "\t\t; %s\n\n", pstrSourceLine );
+
+                        // Tell the assembler which line the following instructions came from
 
-                        fprintf ( g_pOutputFile, "\t\t; %s\n\n", pstrSourceLine );
+                        if ( g_iIsLineInfoEnabled )
+                            fprintf ( g_pContext->pOutputFile, "\t\tSourceLine\t%d\n", pCurrNode->iSourceLine );
                         
                         break;
                     }
@@ -271,9 +372,33 @@
 
                     case ICODE_NODE_INSTR:
                     {
+                        // A jump table's entries are declared with a JumpTable directive just
+                        // ahead of the JTab that uses them. The table is named after the
+                        // instruction's index, which is unique within the function.
+
+                        if ( pCurrNode->Instr.iOpcode == INSTR_JTAB )
+                        {
+                            int iEntryCount = pCurrNode->Instr.OpList.iNodeCount - 3;
+
+                            fprintf ( g_pContext->pOutputFile, "\t\tJumpTable\t_JT%d, %d", iCurrInstrIndex, GetICodeOpByIndex ( pCurrNode, 1 )->iIntLiteral );
+                            for ( int iCurrEntryIndex = 0; iCurrEntryIndex < iEntryCount; ++ iCurrEntryIndex )
+                                fprintf ( g_pContext->pOutputFile, ", _L%d", GetICodeOpByIndex ( pCurrNode, 3 + iCurrEntryIndex )->iJumpTargetIndex );
+                            fprintf ( g_pContext->pOutputFile, "\n" );
+
+                            // JTab Value, Table, Default
+
+                            fprintf ( g_pContext->pOutputFile, "\t\t%s\t\t", ppstrMnemonics [ INSTR_JTAB ] );
+                            EmitOp ( GetICodeOpByIndex ( pCurrNode, 0 ) );
+                            fprintf ( g_pContext->pOutputFile, ", _JT%d, ", iCurrInstrIndex );
+                            EmitOp ( GetICodeOpByIndex ( pCurrNode, 2 ) );
+                            fprintf ( g_pContext->pOutputFile, "\n" );
+
+                            break;
+                        }
+
                         // Emit the opcode
 
-                        fprintf ( g_pOutputFile, "\t\t%s", ppstrMnemonics [ pCurrNode->Instr.iOpcode ] );
+                        fprintf ( g_pContext->pOutputFile, "\t\t%s", ppstrMnemonics [ pCurrNode->Instr.iOpcode ] );
 
                         // Determine the number of operands
 
@@ -285,93 +410,30 @@
                         {
                             // All instructions get at least one tab
 
-                            fprintf ( g_pOutputFile, "\t" );
+                            fprintf ( g_pContext->pOutputFile, "\t" );
 
                             // If it's less than a tab stop's width in characters, however, they get a
                             // second
 
                             if ( strlen ( ppstrMnemonics [ pCurrNode->Instr.iOpcode ] ) < TAB_STOP_WIDTH )
-                                fprintf ( g_pOutputFile, "\t" );
+                                fprintf ( g_pContext->pOutputFile, "\t" );
                         }
 
                         // Emit each operand
 
                         for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
                         {
-                            // Get a pointer to the operand structure
-
-                            Op * pOp = GetICodeOpByIndex ( pCurrNode, iCurrOpIndex );
-
-                            // Emit the operand based on its type
-
-                            switch ( pOp->iType )
-                            {
-                                // Integer literal
-
-                                case OP_TYPE_INT:
-                                    fprintf ( g_pOutputFile, "%d", pOp->iIntLiteral );
-                                    break;
-
-                                // Float literal
-
-                                case OP_TYPE_FLOAT:
-                                    fprintf ( g_pOutputFile, "%f", pOp->fFloatLiteral );
-                                    break;
-
-                                // String literal
-
-                                case OP_TYPE_STRING_INDEX:
-                                    fprintf ( g_pOutputFile, "\"%s\"", GetStringByIndex ( & g_StringTable, pOp->iStringIndex ) );
-                                    break;
-
-                                // Variable
-
-                                case OP_TYPE_VAR:
-                                    fprintf ( g_pOutputFile, "%s", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent );
-                                    break;
-
-                                // Array index absolute
-
-                                case OP_TYPE_ARRAY_INDEX_ABS:
-                                    fprintf ( g_pOutputFile, "%s [ %d ]", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent,
-                                                                          pOp->iOffset );
-                                    break;
-
-                                // Array index variable
-
-                                case OP_TYPE_ARRAY_INDEX_VAR:
-                                    fprintf ( g_pOutputFile, "%s [ %s ]", GetSymbolByIndex ( pOp->iSymbolIndex )->pstrIdent,
-                                                                          GetSymbolByIndex ( pOp->iOffsetSymbolIndex )->pstrIdent );
-                                    break;
-
-                                // Function
-
-                                case OP_TYPE_FUNC_INDEX:
-                                    fprintf ( g_pOutputFile, "%s", GetFuncByIndex ( pOp->iSymbolIndex )->pstrName );
-                                    break;
-
-                                // Register (just _RetVal for now)
-
-                                case OP_TYPE_REG:
-                                    fprintf ( g_pOutputFile, "_RetVal" );
-                                    break;
-
-                                // Jump target index
-
-                                case OP_TYPE_JUMP_TARGET_INDEX:
-                                    fprintf ( g_pOutputFile, "_L%d", pOp->iJumpTargetIndex );
-                                    break;
-                            }
+                            EmitOp ( GetICodeOpByIndex ( pCurrNode, iCurrOpIndex ) );
 
                             // If the operand isn't the last one, append it with a comma and space
 
                             if ( iCurrOpIndex != iOpCount - 1 )
-                                fprintf ( g_pOutputFile, ", " );
+                                fprintf ( g_pContext->pOutputFile, ", " );
                         }
 
                         // Finish the line
 
-                        fprintf ( g_pOutputFile, "\n" );
+                        fprintf ( g_pContext->pOutputFile, "\n" );
 
                         break;
                     }
@@ -382,7 +444,7 @@
                     {
                         // Emit a label in the format _LX, where X is the jump target
 
-                        fprintf ( g_pOutputFile, "\t_L%d:\n", pCurrNode->iJumpTargetIndex );
+                        fprintf ( g_pContext->pOutputFile, "\t_L%d:\n", pCurrNode->iJumpTargetIndex );
                     }
                 }
 
@@ -396,12 +458,12 @@
         {
             // No, so emit a comment saying so
 
-            fprintf ( g_pOutputFile, "\t\t; (No code)\n" );
+            fprintf ( g_pContext->pOutputFile, "\t\t; (No code)\n" );
         }
 
         // Emit the closing brace
 
-        fprintf ( g_pOutputFile, "\t}" );
+        fprintf ( g_pContext->pOutputFile, "\t}" );
     }
 
     /******************************************************************************************
@@ -416,7 +478,7 @@
     {
         // ---- Open the output file
 
-        if ( ! ( g_pOutputFile = fopen ( g_pstrOutputFilename, "wb" ) ) )
+        if ( ! ( g_pContext->pOutputFile = fopen ( g_pContext->pstrOutputFilename, "wb" ) ) )
             ExitOnError ( "Could not open output file for output" );
 
         // ---- Emit the header
@@ -425,13 +487,13 @@
 
         // ---- Emit directives
 
-        fprintf ( g_pOutputFile, "; ---- Directives -----------------------------------------------------------------------------\n\n" );
+        fprintf ( g_pContext->pOutputFile, "; ---- Directives -----------------------------------------------------------------------------\n\n" );
 
         EmitDirectives ();
 
         // ---- Emit global variable declarations
 
-        fprintf ( g_pOutputFile, "; ---- Global Variables -----------------------------------------------------------------------\n\n" );
+        fprintf ( g_pContext->pOutputFile, "; ---- Global Variables -----------------------------------------------------------------------\n\n" );
 
         // Emit the globals by printing all non-parameter symbols in the global scope
 
@@ -439,11 +501,11 @@
 
         // ---- Emit functions
 
-        fprintf ( g_pOutputFile, "; ---- Functions ------------------------------------------------------------------------------\n\n" );
+        fprintf ( g_pContext->pOutputFile, "; ---- Functions ------------------------------------------------------------------------------\n\n" );
 
         // Local node for traversing lists
 
-        LinkedListNode * pNode = g_FuncTable.pHead;
+        LinkedListNode * pNode = g_pContext->FuncTable.pHead;
 
         // Local function node pointer
 
@@ -455,7 +517,7 @@
 
         // Loop through each function and emit its declaration and code, if functions exist
 
-        if ( g_FuncTable.iNodeCount > 0 )
+        if ( g_pContext->FuncTable.iNodeCount > 0 )
         {
             while ( TRUE )
             {
@@ -480,7 +542,7 @@
                         // No, so emit it
 
                         EmitFunc ( pCurrFunc );
-                        fprintf ( g_pOutputFile, "\n\n" );
+                        fprintf ( g_pContext->pOutputFile, "\n\n" );
                     }
                 }
 
@@ -494,17 +556,17 @@
 
         // ---- Emit _Main ()
     
-        fprintf ( g_pOutputFile, "; ---- Main -----------------------------------------------------------------------------------" );
+        fprintf ( g_pContext->pOutputFile, "; ---- Main -----------------------------------------------------------------------------------" );
 
         // If the last pass over the functions found a _Main () function. emit it
 
         if ( pMainFunc )
         {
-            fprintf ( g_pOutputFile, "\n\n" );
+            fprintf ( g_pContext->pOutputFile, "\n\n" );
             EmitFunc ( pMainFunc );
         }
 
         // ---- Close output file
 
-        fclose ( g_pOutputFile );
+        fclose ( g_pContext->pOutputFile );
     }
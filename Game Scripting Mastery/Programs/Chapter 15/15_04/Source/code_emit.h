@@ -34,11 +34,16 @@
     #define TAB_STOP_WIDTH                      8       // The width of a tab stop in
                                                         // characters
 
+// ---- Global Variables ----------------------------------------------------------------------
+
+    extern int g_iIsLineInfoEnabled;
+
 // ---- Function Prototypes -------------------------------------------------------------------
 
     void EmitHeader ();
     void EmitDirectives ();
     void EmitScopeSymbols ( int iScope, int iType );
+    void EmitOp ( Op * pOp );
     void EmitFunc ( FuncNode * pFunc );
     void EmitCode ();
 
@@ -0,0 +1,100 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Compiler context header
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+#ifndef XSC_CONTEXT
+#define XSC_CONTEXT
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <setjmp.h>
+
+    #include "xsc.h"
+    #include "lexer.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #define MAX_DIAG_SIZE               ( MAX_SOURCE_LINE_SIZE * 2 + MAX_FILENAME_SIZE + 512 )
+                                                        // Maximum size of a file's diagnostic
+                                                        // output
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _CompilerContext                     // The state of a single compilation
+    {
+        // ---- Source Code -------------------------------------------------------------------
+
+        char pstrSourceFilename [ MAX_FILENAME_SIZE ];  // Source code filename
+        char pstrOutputFilename [ MAX_FILENAME_SIZE ];  // Executable filename
+
+        LinkedList SourceCode;                          // Source code linked list
+
+        // ---- Script ------------------------------------------------------------------------
+
+        ScriptHeader ScriptHeader;                      // Script header data
+
+        // ---- Tables ------------------------------------------------------------------------
+
+        LinkedList FuncTable;                           // The function table
+        LinkedList SymbolTable;                         // The symbol table
+        LinkedList StringTable;                         // The string table
+
+        // ---- XASM Invocation ---------------------------------------------------------------
+
+        int iPreserveOutputFile;                        // Preserve the assembly file?
+        int iGenerateXSE;                               // Generate an .XSE executable?
+
+        // ---- Lexer -------------------------------------------------------------------------
+
+        LexerState CurrLexerState;                      // The current lexer state
+        LexerState PrevLexerState;                      // The previous lexer state (used for
+                                                        // rewinding the token stream)
+
+        // ---- Parser ------------------------------------------------------------------------
+
+        int iCurrScope;                                 // The current scope
+        Stack LoopStack;                                // Loop handling stack
+
+        int iTempVar0SymbolIndex,                       // Temporary variable symbol indices
+            iTempVar1SymbolIndex;
+
+        int iInlinedCallCount;                          // The number of calls inlined
+        int iTypedInstrCount;                           // The number of typed instructions
+                                                        // emitted
+
+        // ---- I-Code ------------------------------------------------------------------------
+
+        int iCurrJumpTargetIndex;                       // The current target index
+
+        // ---- Code Emission -----------------------------------------------------------------
+
+        FILE * pOutputFile;                             // Pointer to the output file
+
+        // ---- Error Handling ----------------------------------------------------------------
+
+        int iCanRecover;                                // Should errors return to ErrorJump
+                                                        // rather than exit?
+        jmp_buf ErrorJump;                              // Where to return on error
+        char pstrDiag [ MAX_DIAG_SIZE ];                // The last error's diagnostic output
+    }
+        CompilerContext;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    // Each thread compiles with its own context, so the pointer is thread-local
+
+    extern __declspec ( thread ) CompilerContext * g_pContext;
+
+#endif
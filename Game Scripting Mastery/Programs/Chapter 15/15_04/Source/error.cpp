@@ -22,9 +22,40 @@
 
     #include "error.h"
     #include "lexer.h"
+    #include "context.h"
 
 // ---- Functions -----------------------------------------------------------------------------
 
+    /******************************************************************************************
+    *
+    *   AbortCompile ()
+    *
+    *   Stops compiling the current file after an error. Batch workers record the diagnostic
+    *   output and return to their error handler; otherwise it's printed and the program
+    *   exits.
+    */
+
+    void AbortCompile ( char * pstrDiag )
+    {
+        // If the context can recover, save the output and jump back to the handler
+
+        if ( g_pContext->iCanRecover )
+        {
+            strncpy ( g_pContext->pstrDiag, pstrDiag, MAX_DIAG_SIZE - 1 );
+            g_pContext->pstrDiag [ MAX_DIAG_SIZE - 1 ] = '\0';
+
+            longjmp ( g_pContext->ErrorJump, 1 );
+        }
+
+        // Print the output
+
+        printf ( "%s", pstrDiag );
+
+        // Exit the program
+
+        Exit ();
+    }
+
     /******************************************************************************************
     *
     *   ExitOnError ()
@@ -34,13 +65,14 @@
 
     void ExitOnError ( char * pstrErrorMssg )
     {
-        // Print the message
+        // Format the message
 
-        printf ( "Fatal Error: %s.\n", pstrErrorMssg );
+        char pstrDiag [ MAX_DIAG_SIZE ];
+        sprintf ( pstrDiag, "Fatal Error: %s.\n", pstrErrorMssg );
 
-        // Exit the program
+        // Stop compiling
 
-        Exit ();
+        AbortCompile ( pstrDiag );
     }
 
     /******************************************************************************************
@@ -52,10 +84,15 @@
 
     void ExitOnCodeError ( char * pstrErrorMssg )
     {
-        // Print the message
+        // The diagnostic output is built up in this buffer
+
+        char pstrDiag [ MAX_DIAG_SIZE ];
+        char * pstrDiagEnd = pstrDiag;
+
+        // Format the message
 
-        printf ( "Error: %s.\n\n", pstrErrorMssg );
-        printf ( "Line %d\n", GetCurrSourceLineIndex () );
+        pstrDiagEnd += sprintf ( pstrDiagEnd, "Error: %s.\n\n", pstrErrorMssg );
+        pstrDiagEnd += sprintf ( pstrDiagEnd, "Line %d\n", GetCurrSourceLineIndex () );
 
 		// Reduce all of the source line's spaces to tabs so it takes less space and so the
 		// karet lines up with the current token properly
@@ -82,21 +119,21 @@
 			if ( pstrSourceLine [ iCurrCharIndex ] == '\t' )
 				pstrSourceLine [ iCurrCharIndex ] = ' ';
 
-		// Print the offending source line
+		// Add the offending source line
 
-        printf ( "%s\n", pstrSourceLine );
+        pstrDiagEnd += sprintf ( pstrDiagEnd, "%s\n", pstrSourceLine );
 
-        // Print a karet at the start of the (presumably) offending lexeme
+        // Add a karet at the start of the (presumably) offending lexeme
 
         for ( int iCurrSpace = 0; iCurrSpace < GetLexemeStartIndex (); ++ iCurrSpace )
-            printf ( " " );
-        printf ( "^\n" );
+            * pstrDiagEnd ++ = ' ';
+        pstrDiagEnd += sprintf ( pstrDiagEnd, "^\n" );
 
-        // Print message indicating that the script could not be assembled
+        // Add a message indicating that the script could not be assembled
 
-        printf ( "Could not compile %s.", g_pstrSourceFilename );
+        sprintf ( pstrDiagEnd, "Could not compile %s.", g_pContext->pstrSourceFilename );
 
-        // Exit the program
+        // Stop compiling
 
-        Exit ();
+        AbortCompile ( pstrDiag );
     }
\ No newline at end of file
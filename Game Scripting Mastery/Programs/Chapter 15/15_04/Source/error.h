@@ -27,6 +27,7 @@
 
 // ---- Function Prototypes -------------------------------------------------------------------
 
+    void AbortCompile ( char * pstrDiag );
     void ExitOnError ( char * pstrErrorMssg );
     void ExitOnCodeError ( char * pstrErrorMssg );
 
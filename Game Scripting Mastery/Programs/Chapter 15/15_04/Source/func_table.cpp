@@ -21,6 +21,7 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "func_table.h"
+    #include "context.h"
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -35,16 +36,16 @@
     {
         // If the table is empty, return a NULL pointer
 
-        if ( ! g_FuncTable.iNodeCount )
+        if ( ! g_pContext->FuncTable.iNodeCount )
             return NULL;
 
         // Create a pointer to traverse the list
 
-        LinkedListNode * pCurrNode = g_FuncTable.pHead;
+        LinkedListNode * pCurrNode = g_pContext->FuncTable.pHead;
 
         // Traverse the list until the matching structure is found
 
-        for ( int iCurrNode = 1; iCurrNode <= g_FuncTable.iNodeCount; ++ iCurrNode )
+        for ( int iCurrNode = 1; iCurrNode <= g_pContext->FuncTable.iNodeCount; ++ iCurrNode )
         {
             // Create a pointer to the current function structure
 
@@ -80,7 +81,7 @@
 
         // Loop through each function in the table to find the match
 
-        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_FuncTable.iNodeCount; ++ iCurrFuncIndex )
+        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_pContext->FuncTable.iNodeCount; ++ iCurrFuncIndex )
         {
             // Get the current function structure
 
@@ -123,7 +124,7 @@
         // Add the function to the list and get its index, but add one since the zero index is
         // reserved for the global scope
 
-        int iIndex = AddNode ( & g_FuncTable, pNewFunc ) + 1;
+        int iIndex = AddNode ( & g_pContext->FuncTable, pNewFunc ) + 1;
 
 		// Set the function node's index
 
@@ -141,12 +142,17 @@
 
         pNewFunc->ICodeStream.iNodeCount = 0;
 
+        // Allow its calls to be inlined unless it's declared otherwise
+
+        pNewFunc->iIsInlineable = TRUE;
+        pNewFunc->iInlineDepth = 0;
+
         // If the function was _Main (), set its flag and index in the header
 
         if ( stricmp ( pstrName, MAIN_FUNC_NAME ) == 0 )
         {
-            g_ScriptHeader.iIsMainFuncPresent = TRUE;
-            g_ScriptHeader.iMainFuncIndex = iIndex;
+            g_pContext->ScriptHeader.iIsMainFuncPresent = TRUE;
+            g_pContext->ScriptHeader.iMainFuncIndex = iIndex;
         }
 
 		// Return the new function's index
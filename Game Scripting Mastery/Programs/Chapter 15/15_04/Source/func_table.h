@@ -34,6 +34,9 @@
         int iIsHostAPI;                                 // Is this a host API function?
         int iParamCount;                                // The number of accepted parameters
         LinkedList ICodeStream;                         // Local I-code stream
+        int iIsInlineable;                              // Can calls to it be inlined?
+        int iInlineDepth;                               // The number of its inlined calls
+                                                        // currently being generated
     }
         FuncNode;
 
@@ -21,11 +21,8 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "i_code.h"
+    #include "context.h"
 
-// ---- Global Variables ----------------------------------------------------------------------
-
-    int g_iCurrJumpTargetIndex = 0;                     // The current target index
-    
 // ---- Functions -----------------------------------------------------------------------------
 
     /******************************************************************************************
@@ -94,6 +91,10 @@
 
         pSourceLineNode->pstrSourceLine = pstrSourceLine;
 
+        // Set the line number, counting from one like a text editor does
+
+        pSourceLineNode->iSourceLine = GetCurrSourceLineIndex () + 1;
+
         // Add the instruction node to the list and get the index
 
         AddNode ( & pFunc->ICodeStream, pSourceLineNode );
@@ -419,7 +420,7 @@
     {
         // Return and increment the current target index
 
-        return g_iCurrJumpTargetIndex ++;
+        return g_pContext->iCurrJumpTargetIndex ++;
     }
 
     /******************************************************************************************
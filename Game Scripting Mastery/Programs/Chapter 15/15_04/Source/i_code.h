@@ -77,6 +77,59 @@
         #define INSTR_PAUSE             31
         #define INSTR_EXIT              32
 
+        // Typed instructions, which replace the generic ones above when type inference can
+        // prove what both operands hold
+
+        #define INSTR_IADD              33
+        #define INSTR_ISUB              34
+        #define INSTR_IMUL              35
+        #define INSTR_IDIV              36
+        #define INSTR_IMOD              37
+        #define INSTR_IINC              38
+        #define INSTR_IDEC              39
+
+        #define INSTR_FADD              40
+        #define INSTR_FSUB              41
+        #define INSTR_FMUL              42
+        #define INSTR_FDIV              43
+
+        #define INSTR_IJE               44
+        #define INSTR_IJNE              45
+        #define INSTR_IJG               46
+        #define INSTR_IJL               47
+        #define INSTR_IJGE              48
+        #define INSTR_IJLE              49
+
+        // Indexed branching, which switch statements use for dense case labels. Its operands
+        // are the value, the value of the first entry, the default target and then each
+        // entry's target.
+
+        #define INSTR_JTAB              50
+
+        // Math intrinsics, which the XVM implements itself. Each writes its result to its
+        // first operand.
+
+        #define INSTR_SQRT              51
+        #define INSTR_SIN               52
+        #define INSTR_COS               53
+        #define INSTR_ATAN2             54
+        #define INSTR_ABS               55
+        #define INSTR_MIN               56
+        #define INSTR_MAX               57
+
+        // Vector intrinsics, whose operands are array elements that start runs of elements,
+        // followed by the number of elements. VDot writes a scalar to its first operand
+        // instead.
+
+        #define INSTR_VADD              58
+        #define INSTR_VSUB              59
+        #define INSTR_VSCALE            60
+        #define INSTR_VDOT              61
+
+        // Suspends the running coroutine until the host resumes it
+
+        #define INSTR_YIELD             62
+
     // ---- Operand Types ---------------------------------------------------------------------
 
         #define OP_TYPE_INT                 0           // Integer literal value
@@ -119,6 +172,8 @@
     typedef struct _ICodeNode                           // An I-code node
     {
         int iType;                                      // The node type
+        int iSourceLine;                                // The source line number, if this is
+                                                        // a source code annotation
         union
         {
             ICodeInstr Instr;                           // The I-code instruction
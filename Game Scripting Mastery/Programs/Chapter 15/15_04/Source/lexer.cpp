@@ -21,14 +21,10 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "lexer.h"
+    #include "context.h"
 
 // ---- Globals -------------------------------------------------------------------------------
 
-    // ---- Lexer -----------------------------------------------------------------------------
-
-        LexerState g_CurrLexerState;                    // The current lexer state
-        LexerState g_PrevLexerState;                    // The previous lexer state (used for
-                                                        // rewinding the token stream)
     // ---- Operators -------------------------------------------------------------------------
 
         // ---- First operator characters
@@ -61,7 +57,7 @@
 
     // ---- Delimiters ------------------------------------------------------------------------
 
-        char cDelims [ MAX_DELIM_COUNT ] = { ',', '(', ')', '[', ']', '{', '}', ';' };
+        char cDelims [ MAX_DELIM_COUNT ] = { ',', '(', ')', '[', ']', '{', '}', ';', ':' };
 
 // ---- Function Prototypes -------------------------------------------------------------------
     
@@ -88,17 +84,17 @@
     {
         // Set the current line of code to the new line
 
-        g_CurrLexerState.iCurrLineIndex = 0;
-        g_CurrLexerState.pCurrLine = g_SourceCode.pHead;
+        g_pContext->CurrLexerState.iCurrLineIndex = 0;
+        g_pContext->CurrLexerState.pCurrLine = g_pContext->SourceCode.pHead;
 
         // Reset the start and end of the current lexeme to the beginning of the source
 
-        g_CurrLexerState.iCurrLexemeStart = 0;
-        g_CurrLexerState.iCurrLexemeEnd = 0;
+        g_pContext->CurrLexerState.iCurrLexemeStart = 0;
+        g_pContext->CurrLexerState.iCurrLexemeEnd = 0;
 
         // Reset the current operator
 
-        g_CurrLexerState.iCurrOp = 0;
+        g_pContext->CurrLexerState.iCurrOp = 0;
     }
 
     /******************************************************************************************
@@ -349,31 +345,31 @@
         // Make a local copy of the string pointer, unless we're at the end of the source code
 
         char * pstrCurrLine;
-        if ( g_CurrLexerState.pCurrLine )
-            pstrCurrLine = ( char * ) g_CurrLexerState.pCurrLine->pData;
+        if ( g_pContext->CurrLexerState.pCurrLine )
+            pstrCurrLine = ( char * ) g_pContext->CurrLexerState.pCurrLine->pData;
         else
             return '\0';
 
         // If the current lexeme end index is beyond the length of the string, we're past the
         // end of the line
 
-        if ( g_CurrLexerState.iCurrLexemeEnd >= ( int ) strlen ( pstrCurrLine ) )
+        if ( g_pContext->CurrLexerState.iCurrLexemeEnd >= ( int ) strlen ( pstrCurrLine ) )
         {
             // Move to the next node in the source code list
 
-            g_CurrLexerState.pCurrLine = g_CurrLexerState.pCurrLine->pNext;
+            g_pContext->CurrLexerState.pCurrLine = g_pContext->CurrLexerState.pCurrLine->pNext;
 
             // Is the line valid?
 
-            if ( g_CurrLexerState.pCurrLine )
+            if ( g_pContext->CurrLexerState.pCurrLine )
             {
                 // Yes, so move to the next line of code and reset the lexeme pointers
 
-                pstrCurrLine = ( char * ) g_CurrLexerState.pCurrLine->pData;
+                pstrCurrLine = ( char * ) g_pContext->CurrLexerState.pCurrLine->pData;
 
-                ++ g_CurrLexerState.iCurrLineIndex;
-                g_CurrLexerState.iCurrLexemeStart = 0;
-                g_CurrLexerState.iCurrLexemeEnd = 0;
+                ++ g_pContext->CurrLexerState.iCurrLineIndex;
+                g_pContext->CurrLexerState.iCurrLexemeStart = 0;
+                g_pContext->CurrLexerState.iCurrLexemeEnd = 0;
             }
             else
             {
@@ -387,7 +383,7 @@
 
         // Return the character and increment the pointer
 
-        return pstrCurrLine [ g_CurrLexerState.iCurrLexemeEnd ++ ];
+        return pstrCurrLine [ g_pContext->CurrLexerState.iCurrLexemeEnd ++ ];
     }
 
     /******************************************************************************************
@@ -401,11 +397,11 @@
     {
         // Save the current lexer state for future rewinding
 
-        CopyLexerState ( g_PrevLexerState, g_CurrLexerState );
+        CopyLexerState ( g_pContext->PrevLexerState, g_pContext->CurrLexerState );
 
         // Start the new lexeme at the end of the last one
 
-        g_CurrLexerState.iCurrLexemeStart = g_CurrLexerState.iCurrLexemeEnd;
+        g_pContext->CurrLexerState.iCurrLexemeStart = g_pContext->CurrLexerState.iCurrLexemeEnd;
 
         // Set the initial state to the start state
 
@@ -469,7 +465,7 @@
 
                     if ( IsCharWhitespace ( cCurrChar ) )
                     {
-                        ++ g_CurrLexerState.iCurrLexemeStart;
+                        ++ g_pContext->CurrLexerState.iCurrLexemeStart;
                         iAddCurrChar = FALSE;
                     }
 
@@ -521,7 +517,7 @@
 
                         // Set the current operator
 
-                        g_CurrLexerState.iCurrOp = CurrOpState.iIndex;
+                        g_pContext->CurrLexerState.iCurrOp = CurrOpState.iIndex;
 
                         iCurrLexState = LEX_STATE_OP;
                     }
@@ -662,7 +658,7 @@
 
                             // Set the current operator
 
-                            g_CurrLexerState.iCurrOp = CurrOpState.iIndex;
+                            g_pContext->CurrLexerState.iCurrOp = CurrOpState.iIndex;
                         }
                     }
 
@@ -748,7 +744,7 @@
 
             if ( iAddCurrChar )
             {
-                g_CurrLexerState.pstrCurrLexeme [ iNextLexemeCharIndex ] = cCurrChar;
+                g_pContext->CurrLexerState.pstrCurrLexeme [ iNextLexemeCharIndex ] = cCurrChar;
                 ++ iNextLexemeCharIndex;
             }
 
@@ -760,11 +756,11 @@
 
         // Complete the lexeme string
 
-        g_CurrLexerState.pstrCurrLexeme [ iNextLexemeCharIndex ] = '\0';
+        g_pContext->CurrLexerState.pstrCurrLexeme [ iNextLexemeCharIndex ] = '\0';
 
         // Retract the lexeme end index by one
 
-        -- g_CurrLexerState.iCurrLexemeEnd;
+        -- g_pContext->CurrLexerState.iCurrLexemeEnd;
 
         // Determine the token type
 
@@ -801,64 +797,89 @@
 
                 // var/var []
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "var" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "var" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_VAR;
 
                 // true
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "true" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "true" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_TRUE;
 
                 // false
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "false" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "false" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_FALSE;
 
                 // if
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "if" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "if" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_IF;
 
                 // else
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "else" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "else" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_ELSE;
 
                 // break
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "break" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "break" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_BREAK;
 
                 // continue
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "continue" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "continue" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_CONTINUE;
 
                 // for
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "for" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "for" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_FOR;
 
                 // while
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "while" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "while" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_WHILE;
 
                 // func
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "func" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "func" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_FUNC;
 
                 // return
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "return" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "return" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_RETURN;
 
                 // host
 
-                if ( stricmp ( g_CurrLexerState.pstrCurrLexeme, "host" ) == 0 )
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "host" ) == 0 )
                     TokenType = TOKEN_TYPE_RSRVD_HOST;
 
+                // noinline
+
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "noinline" ) == 0 )
+                    TokenType = TOKEN_TYPE_RSRVD_NOINLINE;
+
+                // switch
+
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "switch" ) == 0 )
+                    TokenType = TOKEN_TYPE_RSRVD_SWITCH;
+
+                // case
+
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "case" ) == 0 )
+                    TokenType = TOKEN_TYPE_RSRVD_CASE;
+
+                // default
+
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "default" ) == 0 )
+                    TokenType = TOKEN_TYPE_RSRVD_DEFAULT;
+
+                // yield
+
+                if ( stricmp ( g_pContext->CurrLexerState.pstrCurrLexeme, "yield" ) == 0 )
+                    TokenType = TOKEN_TYPE_RSRVD_YIELD;
+
                 break;
 
             // Delimiter
@@ -867,7 +888,7 @@
 
                 // Determine which delimiter was found
 
-                switch ( g_CurrLexerState.pstrCurrLexeme [ 0 ] )
+                switch ( g_pContext->CurrLexerState.pstrCurrLexeme [ 0 ] )
                 {
                     case ',':
                         TokenType = TOKEN_TYPE_DELIM_COMMA;
@@ -900,6 +921,10 @@
                     case ';':
                         TokenType = TOKEN_TYPE_DELIM_SEMICOLON;
                         break;
+
+                    case ':':
+                        TokenType = TOKEN_TYPE_DELIM_COLON;
+                        break;
                 }
                 
                 break;
@@ -924,7 +949,7 @@
 
         // Return the token type and set the global copy
 
-        g_CurrLexerState.CurrToken = TokenType;
+        g_pContext->CurrLexerState.CurrToken = TokenType;
         return TokenType;
     }
 
@@ -937,7 +962,7 @@
 
     void RewindTokenStream ()
     {
-        CopyLexerState ( g_CurrLexerState, g_PrevLexerState );
+        CopyLexerState ( g_pContext->CurrLexerState, g_pContext->PrevLexerState );
     }
 
     /******************************************************************************************
@@ -949,7 +974,7 @@
 
     Token GetCurrToken ()
     {
-        return g_CurrLexerState.CurrToken;
+        return g_pContext->CurrLexerState.CurrToken;
     }
 
     /******************************************************************************************
@@ -961,7 +986,7 @@
 
     char * GetCurrLexeme ()
     {
-        return g_CurrLexerState.pstrCurrLexeme;
+        return g_pContext->CurrLexerState.pstrCurrLexeme;
     }
 
     /******************************************************************************************
@@ -973,7 +998,7 @@
 
     void CopyCurrLexeme ( char * pstrBuffer )
     {
-        strcpy ( pstrBuffer, g_CurrLexerState.pstrCurrLexeme );
+        strcpy ( pstrBuffer, g_pContext->CurrLexerState.pstrCurrLexeme );
     }
 
     /******************************************************************************************
@@ -985,7 +1010,7 @@
 
     int GetCurrOp ()
     {
-        return g_CurrLexerState.iCurrOp;
+        return g_pContext->CurrLexerState.iCurrOp;
     }
 
     /******************************************************************************************
@@ -1000,7 +1025,7 @@
         // Save the current lexer state
 
         LexerState PrevLexerState;
-        CopyLexerState ( PrevLexerState, g_CurrLexerState );
+        CopyLexerState ( PrevLexerState, g_pContext->CurrLexerState );
 
         // Skip any whitespace that may exist and return the first non-whitespace character
 
@@ -1014,7 +1039,7 @@
 
         // Restore the lexer state
 
-        CopyLexerState ( g_CurrLexerState, PrevLexerState );
+        CopyLexerState ( g_pContext->CurrLexerState, PrevLexerState );
 
         // Return the look-ahead character
 
@@ -1030,8 +1055,8 @@
 
     char * GetCurrSourceLine ()
     {
-        if ( g_CurrLexerState.pCurrLine )
-            return ( char * ) g_CurrLexerState.pCurrLine->pData;
+        if ( g_pContext->CurrLexerState.pCurrLine )
+            return ( char * ) g_pContext->CurrLexerState.pCurrLine->pData;
         else
             return NULL;
     }
@@ -1045,7 +1070,7 @@
 
     int GetCurrSourceLineIndex ()
     {
-        return g_CurrLexerState.iCurrLineIndex;
+        return g_pContext->CurrLexerState.iCurrLineIndex;
     }
 
     /******************************************************************************************
@@ -1057,5 +1082,5 @@
 
     int GetLexemeStartIndex ()
     {
-        return g_CurrLexerState.iCurrLexemeStart;
+        return g_pContext->CurrLexerState.iCurrLexemeStart;
     }
@@ -81,19 +81,25 @@
         #define TOKEN_TYPE_RSRVD_FUNC           14      // func
         #define TOKEN_TYPE_RSRVD_RETURN         15      // return
         #define TOKEN_TYPE_RSRVD_HOST           16      // host
-
-        #define TOKEN_TYPE_OP                   18      // Operator
-
-        #define TOKEN_TYPE_DELIM_COMMA          19      // ,
-        #define TOKEN_TYPE_DELIM_OPEN_PAREN     20      // (
-        #define TOKEN_TYPE_DELIM_CLOSE_PAREN    21      // )
-        #define TOKEN_TYPE_DELIM_OPEN_BRACE     22      // [
-        #define TOKEN_TYPE_DELIM_CLOSE_BRACE    23      // ]
-        #define TOKEN_TYPE_DELIM_OPEN_CURLY_BRACE   24  // {
-        #define TOKEN_TYPE_DELIM_CLOSE_CURLY_BRACE  25  // }
-        #define TOKEN_TYPE_DELIM_SEMICOLON      26      // ;
-
-        #define TOKEN_TYPE_STRING               27      // String
+        #define TOKEN_TYPE_RSRVD_NOINLINE       17      // noinline
+        #define TOKEN_TYPE_RSRVD_SWITCH         18      // switch
+        #define TOKEN_TYPE_RSRVD_CASE           19      // case
+        #define TOKEN_TYPE_RSRVD_DEFAULT        20      // default
+        #define TOKEN_TYPE_RSRVD_YIELD          21      // yield
+
+        #define TOKEN_TYPE_OP                   22      // Operator
+
+        #define TOKEN_TYPE_DELIM_COMMA          23      // ,
+        #define TOKEN_TYPE_DELIM_OPEN_PAREN     24      // (
+        #define TOKEN_TYPE_DELIM_CLOSE_PAREN    25      // )
+        #define TOKEN_TYPE_DELIM_OPEN_BRACE     26      // [
+        #define TOKEN_TYPE_DELIM_CLOSE_BRACE    27      // ]
+        #define TOKEN_TYPE_DELIM_OPEN_CURLY_BRACE   28  // {
+        #define TOKEN_TYPE_DELIM_CLOSE_CURLY_BRACE  29  // }
+        #define TOKEN_TYPE_DELIM_SEMICOLON      30      // ;
+        #define TOKEN_TYPE_DELIM_COLON          31      // :
+
+        #define TOKEN_TYPE_STRING               32      // String
 
     // ---- Operators -------------------------------------------------------------------------
 
@@ -26,16 +26,30 @@
     #include "symbol_table.h"
     #include "func_table.h"
     #include "i_code.h"
+    #include "context.h"
 
 // ---- Globals -------------------------------------------------------------------------------
 
-    // ---- Functions -------------------------------------------------------------------------
-
-        int g_iCurrScope;                               // The current scope
-
-    // ---- Loops -----------------------------------------------------------------------------
-
-        Stack g_LoopStack;                              // Loop handling stack
+    int g_iInlineThreshold = DEFAULT_INLINE_THRESHOLD;
+                                                        // Functions with at most this many
+                                                        // I-code instructions are inlined
+
+    Intrinsic g_Intrinsics [] =                         // The builtin math functions, which
+    {                                                   // are used when no variable or
+        { "sqrt",   INSTR_SQRT,     "s",    TRUE },     // function has the same name
+        { "sin",    INSTR_SIN,      "s",    TRUE },
+        { "cos",    INSTR_COS,      "s",    TRUE },
+        { "atan2",  INSTR_ATAN2,    "ss",   TRUE },
+        { "abs",    INSTR_ABS,      "s",    TRUE },
+        { "min",    INSTR_MIN,      "ss",   TRUE },
+        { "max",    INSTR_MAX,      "ss",   TRUE },
+
+        { "vadd",   INSTR_VADD,     "vvn",  FALSE },
+        { "vsub",   INSTR_VSUB,     "vvn",  FALSE },
+        { "vscale", INSTR_VSCALE,   "vsn",  FALSE },
+        { "vdot",   INSTR_VDOT,     "vvn",  TRUE },
+        { "vlen",   INSTR_VDOT,     "vn",   TRUE }
+    };
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -147,6 +161,36 @@
                     strcpy ( pstrErrorMssg, "host" );
                     break;
 
+                // noinline
+
+                case TOKEN_TYPE_RSRVD_NOINLINE:
+                    strcpy ( pstrErrorMssg, "noinline" );
+                    break;
+
+                // switch
+
+                case TOKEN_TYPE_RSRVD_SWITCH:
+                    strcpy ( pstrErrorMssg, "switch" );
+                    break;
+
+                // case
+
+                case TOKEN_TYPE_RSRVD_CASE:
+                    strcpy ( pstrErrorMssg, "case" );
+                    break;
+
+                // default
+
+                case TOKEN_TYPE_RSRVD_DEFAULT:
+                    strcpy ( pstrErrorMssg, "default" );
+                    break;
+
+                // yield
+
+                case TOKEN_TYPE_RSRVD_YIELD:
+                    strcpy ( pstrErrorMssg, "yield" );
+                    break;
+
                 // Operator
 
                 case TOKEN_TYPE_OP:
@@ -201,6 +245,12 @@
                     strcpy ( pstrErrorMssg, ";" );
                     break;
 
+                // Colon
+
+                case TOKEN_TYPE_DELIM_COLON:
+                    strcpy ( pstrErrorMssg, ":" );
+                    break;
+
                 // String
 
                 case TOKEN_TYPE_STRING:
@@ -271,11 +321,11 @@
 
         // Initialize the loop stack
 
-        InitStack ( & g_LoopStack );
+        InitStack ( & g_pContext->LoopStack );
 
         // Set the current scope to global
 
-        g_iCurrScope = SCOPE_GLOBAL;
+        g_pContext->iCurrScope = SCOPE_GLOBAL;
 
         // Parse each line of code
 
@@ -295,7 +345,7 @@
 
         // Free the loop stack
 
-        FreeStack ( & g_LoopStack );
+        FreeStack ( & g_pContext->LoopStack );
     }
 
     /******************************************************************************************
@@ -350,7 +400,14 @@
             // Function definition
 
             case TOKEN_TYPE_RSRVD_FUNC:
-                ParseFunc ();
+                ParseFunc ( TRUE );
+                break;
+
+            // Function definition that's never inlined
+
+            case TOKEN_TYPE_RSRVD_NOINLINE:
+                ReadToken ( TOKEN_TYPE_RSRVD_FUNC );
+                ParseFunc ( FALSE );
                 break;
 
             // if block
@@ -371,6 +428,12 @@
                 ParseFor ();
                 break;
 
+            // switch block
+
+            case TOKEN_TYPE_RSRVD_SWITCH:
+                ParseSwitch ();
+                break;
+
             // break
 
             case TOKEN_TYPE_RSRVD_BREAK:
@@ -389,13 +452,19 @@
                 ParseReturn ();
                 break;
 
+            // yield
+
+            case TOKEN_TYPE_RSRVD_YIELD:
+                ParseYield ();
+                break;
+
             // Assignment or Function Call
 
             case TOKEN_TYPE_IDENT:
             {
                 // What kind of identifier is it?
 
-                if ( GetSymbolByIdent ( GetCurrLexeme (), g_iCurrScope ) )
+                if ( GetSymbolByIdent ( GetCurrLexeme (), g_pContext->iCurrScope ) )
                 {
                     // It's an identifier, so treat the statement as an assignment
 
@@ -407,8 +476,27 @@
 
                     // Annotate the line and parse the call
 
-                    AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
-                    ParseFuncCall ();
+                    AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
+
+                    ExprNode * pCall = ParseFuncCall ();
+                    EmitFuncCall ( pCall );
+                    FreeExpr ( pCall );
+
+                    // Verify the presence of the semicolon
+
+                    ReadToken ( TOKEN_TYPE_DELIM_SEMICOLON );
+                }
+                else if ( GetIntrinsicByName ( GetCurrLexeme () ) != -1 )
+                {
+                    // It's an intrinsic
+
+                    // Annotate the line and parse the call
+
+                    AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
+
+                    ExprNode * pCall = ParseIntrinsicCall ();
+                    EmitIntrinsicCall ( pCall );
+                    FreeExpr ( pCall );
 
                     // Verify the presence of the semicolon
 
@@ -445,7 +533,7 @@
     {
         // Make sure we're not in the global scope
 
-        if ( g_iCurrScope == SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
             ExitOnCodeError ( "Code blocks illegal in global scope" );
 
         // Read each statement until the end of the block
@@ -506,7 +594,7 @@
 
         // Add the identifier and size to the symbol table
 
-        if ( AddSymbol ( pstrIdent, iSize, g_iCurrScope, SYMBOL_TYPE_VAR ) == -1 )
+        if ( AddSymbol ( pstrIdent, iSize, g_pContext->iCurrScope, SYMBOL_TYPE_VAR ) == -1 )
             ExitOnCodeError ( "Identifier redefinition" );
 
         // Read the semicolon
@@ -548,16 +636,17 @@
     *
     *   ParseFunc ()
     *
-    *   Parses a function.
+    *   Parses a function. Functions declared with noinline are never inlined at their call
+    *   sites.
     *
-    *       func <Identifier> ( <Parameter-List> ) <Statement>
+    *       [noinline] func <Identifier> ( <Parameter-List> ) <Statement>
     */
 
-    void ParseFunc ()
+    void ParseFunc ( int iIsInlineable )
     {
         // Make sure we're not already in a function
 
-        if ( g_iCurrScope != SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope != SCOPE_GLOBAL )
             ExitOnCodeError ( "Nested functions illegal" );
 
         // Read the function name
@@ -573,9 +662,13 @@
         if ( iFuncIndex == -1 )
             ExitOnCodeError ( "Function redefinition" );
 
+        // Mark whether or not its calls may be inlined
+
+        GetFuncByIndex ( iFuncIndex )->iIsInlineable = iIsInlineable;
+
         // Set the scope to the function
 
-        g_iCurrScope = iFuncIndex;
+        g_pContext->iCurrScope = iFuncIndex;
 
         // Read the opening parenthesis
 
@@ -588,8 +681,8 @@
             // If the function being defined is _Main (), flag an error since _Main ()
             // cannot accept paraemters
 
-            if ( g_ScriptHeader.iIsMainFuncPresent &&
-                 g_ScriptHeader.iMainFuncIndex == iFuncIndex )
+            if ( g_pContext->ScriptHeader.iIsMainFuncPresent &&
+                 g_pContext->ScriptHeader.iMainFuncIndex == iFuncIndex )
             {
                 ExitOnCodeError ( "_Main () cannot accept parameters" );
             }
@@ -630,7 +723,7 @@
 
             // Set the final parameter count
 
-            SetFuncParamCount ( g_iCurrScope, iParamCount );
+            SetFuncParamCount ( g_pContext->iCurrScope, iParamCount );
 
             // Write the parameters to the function's symbol table in reverse order, so they'll
             // be emitted from right-to-left
@@ -641,7 +734,7 @@
 
                 // Add the parameter to the symbol table
 
-                AddSymbol ( ppstrParamList [ iParamCount ], 1, g_iCurrScope, SYMBOL_TYPE_PARAM );
+                AddSymbol ( ppstrParamList [ iParamCount ], 1, g_pContext->iCurrScope, SYMBOL_TYPE_PARAM );
             }
         }
 
@@ -659,27 +752,25 @@
 
         // Return to the global scope
 
-        g_iCurrScope = SCOPE_GLOBAL;
+        g_pContext->iCurrScope = SCOPE_GLOBAL;
     }
 
     /******************************************************************************************
     *
     *   ParseExpr ()
     *
-    *   Parses an expression.
+    *   Parses an expression and returns its expression tree.
     */
 
-    void ParseExpr ()
+    ExprNode * ParseExpr ()
     {
-        int iInstrIndex;
-
         // The current operator type
 
         int iOpType;
 
         // Parse the subexpression
 
-        ParseSubExpr ();
+        ExprNode * pExpr = ParseSubExpr ();
 
         // Parse any subsequent relational or logical operators
 
@@ -689,7 +780,8 @@
 
             if ( GetNextToken () != TOKEN_TYPE_OP ||
                  ( ! IsOpRelational ( GetCurrOp () ) &&
-                   ! IsOpLogical ( GetCurrOp () ) ) )
+                   GetCurrOp () != OP_TYPE_LOGICAL_AND &&
+                   GetCurrOp () != OP_TYPE_LOGICAL_OR ) )
             {
                 RewindTokenStream ();
                 break;
@@ -699,251 +791,31 @@
 
             iOpType = GetCurrOp ();
 
-            // Parse the second term
-
-            ParseSubExpr ();
-
-            // Pop the first operand into _T1
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-
-            // Pop the second operand into _T0
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-            // ---- Perform the binary operation associated with the specified operator
-
-            // Determine the operator type
-
-            if ( IsOpRelational ( iOpType ) )
-            {
-                // Get a pair of free jump target indices
-
-                int iTrueJumpTargetIndex = GetNextJumpTargetIndex (),
-                    iExitJumpTargetIndex = GetNextJumpTargetIndex ();
-
-                // It's a relational operator
-
-                switch ( iOpType )
-                {
-                    // Equal
-
-                    case OP_TYPE_EQUAL:
-                    {
-                        // Generate a JE instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-                        break;
-                    }
-
-                    // Not Equal
-
-                    case OP_TYPE_NOT_EQUAL:
-                    {
-                        // Generate a JNE instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JNE );
-                        break;
-                    }
-
-                    // Greater
-
-                    case OP_TYPE_GREATER:
-                    {
-                        // Generate a JG instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JG );
-                        break;
-                    }
-
-                    // Less
-
-                    case OP_TYPE_LESS:
-                    {
-                        // Generate a JL instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JL );
-                        break;
-                    }
-
-                    // Greater or Equal
-
-                    case OP_TYPE_GREATER_EQUAL:
-                    {
-                        // Generate a JGE instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JGE );
-                        break;
-                    }
-
-                    // Less Than or Equal
-
-                    case OP_TYPE_LESS_EQUAL:
-                    {
-                        // Generate a JLE instruction
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JLE );
-                        break;
-                    }
-                }
-
-                // Add the jump instruction's operands (_T0 and _T1)
-
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-                AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
-
-                // Generate the outcome for falsehood
-
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-
-                // Generate a jump past the true outcome
-
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-                AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iExitJumpTargetIndex );
-
-                // Set the jump target for the true outcome
-
-                AddICodeJumpTarget ( g_iCurrScope, iTrueJumpTargetIndex );
-
-                // Generate the outcome for truth
-
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 1 );
-
-                // Set the jump target for exiting the operand evaluation
-
-                AddICodeJumpTarget ( g_iCurrScope, iExitJumpTargetIndex );
-            }
-            else
-            {
-                // It must be a logical operator
-
-                switch ( iOpType )
-                {
-                    // And
-
-                    case OP_TYPE_LOGICAL_AND:
-                    {
-                        // Get a pair of free jump target indices
-
-                        int iFalseJumpTargetIndex = GetNextJumpTargetIndex (),
-                            iExitJumpTargetIndex = GetNextJumpTargetIndex ();
-
-                        // JE _T0, 0, True
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-                        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iFalseJumpTargetIndex );
-
-                        // JE _T1, 0, True
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-                        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iFalseJumpTargetIndex );
-
-                        // Push 1
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 1 );
-
-                        // Jmp Exit
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iExitJumpTargetIndex );
-
-                        // L0: (False)
-
-                        AddICodeJumpTarget ( g_iCurrScope, iFalseJumpTargetIndex );
-
-                        // Push 0
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-
-                        // L1: (Exit)
+            // Parse the second subexpression and join the two under the operator
 
-                        AddICodeJumpTarget ( g_iCurrScope, iExitJumpTargetIndex );
-
-                        break;
-                    }
-
-                    // Or
-
-                    case OP_TYPE_LOGICAL_OR:
-                    {
-                        // Get a pair of free jump target indices
-
-                        int iTrueJumpTargetIndex = GetNextJumpTargetIndex (),
-                            iExitJumpTargetIndex = GetNextJumpTargetIndex ();
-
-                        // JNE _T0, 0, True
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JNE );
-                        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
-
-                        // JNE _T1, 0, True
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JNE );
-                        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
-
-                        // Push 0
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-
-                        // Jmp Exit
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-                        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iExitJumpTargetIndex );
-
-                        // L0: (True)
-
-                        AddICodeJumpTarget ( g_iCurrScope, iTrueJumpTargetIndex );
-
-                        // Push 1
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 1 );
-
-                        // L1: (Exit)
-
-                        AddICodeJumpTarget ( g_iCurrScope, iExitJumpTargetIndex );
-
-                        break;
-                    }
-                }
-            }
+            ExprNode * pRight = ParseSubExpr ();
+            pExpr = NewBinaryExprNode ( iOpType, pExpr, pRight );
         }
+
+        return pExpr;
     }
 
     /******************************************************************************************
     *
     *   ParseSubExpr ()
     *
-    *   Parses a sub expression.
+    *   Parses a sub expression and returns its expression tree.
     */
 
-    void ParseSubExpr ()
+    ExprNode * ParseSubExpr ()
     {
-        int iInstrIndex;
-
         // The current operator type
 
         int iOpType;
 
         // Parse the first term
 
-        ParseTerm ();
+        ExprNode * pExpr = ParseTerm ();
 
         // Parse any subsequent +, - or $ operators
 
@@ -964,72 +836,31 @@
 
             iOpType = GetCurrOp ();
 
-            // Parse the second term
-
-            ParseTerm ();
-
-            // Pop the first operand into _T1
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
+            // Parse the second term and join the two under the operator
 
-            // Pop the second operand into _T0
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-            // Perform the binary operation associated with the specified operator
-
-            int iOpInstr;
-            switch ( iOpType )
-            {
-                // Binary addition
-
-                case OP_TYPE_ADD:
-                    iOpInstr = INSTR_ADD;
-                    break;
-
-                // Binary subtraction
-
-                case OP_TYPE_SUB:
-                    iOpInstr = INSTR_SUB;
-                    break;
-
-                // Binary string concatenation
-
-                case OP_TYPE_CONCAT:
-                    iOpInstr = INSTR_CONCAT;
-                    break;
-            }
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, iOpInstr );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-
-            // Push the result (stored in _T0)
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+            ExprNode * pRight = ParseTerm ();
+            pExpr = NewBinaryExprNode ( iOpType, pExpr, pRight );
         }
+
+        return pExpr;
     }
 
     /******************************************************************************************
     *
     *   ParseTerm ()
     *
-    *   Parses a term.
+    *   Parses a term and returns its expression tree.
     */
 
-    void ParseTerm ()
+    ExprNode * ParseTerm ()
     {
-        int iInstrIndex;
-
         // The current operator type
 
         int iOpType;
 
         // Parse the first factor
 
-        ParseFactor ();
+        ExprNode * pExpr = ParseFactor ();
 
         // Parse any subsequent *, /, %, ^, &, |, #, << and >> operators
 
@@ -1056,100 +887,25 @@
 
             iOpType = GetCurrOp ();
 
-            // Parse the second factor
-
-            ParseFactor ();
-
-            // Pop the first operand into _T1
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-
-            // Pop the second operand into _T0
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-            // Perform the binary operation associated with the specified operator
-
-            int iOpInstr;
-            switch ( iOpType )
-            {
-                // Binary multiplication
-
-                case OP_TYPE_MUL:
-                    iOpInstr = INSTR_MUL;
-                    break;
-
-                // Binary division
-
-                case OP_TYPE_DIV:
-                    iOpInstr = INSTR_DIV;
-                    break;
-
-                // Binary modulus
+            // Parse the second factor and join the two under the operator
 
-                case OP_TYPE_MOD:
-                    iOpInstr = INSTR_MOD;
-                    break;
-
-                // Binary exponentiation
-
-                case OP_TYPE_EXP:
-                    iOpInstr = INSTR_EXP;
-                    break;
-
-                // Binary bitwise AND
-
-                case OP_TYPE_BITWISE_AND:
-                    iOpInstr = INSTR_AND;
-                    break;
-
-                // Binary bitwise OR
-
-                case OP_TYPE_BITWISE_OR:
-                    iOpInstr = INSTR_OR;
-                    break;
-
-                // Binary bitwise XOR
-
-                case OP_TYPE_BITWISE_XOR:
-                    iOpInstr = INSTR_XOR;
-                    break;
-
-                // Binary bitwise shift left
-
-                case OP_TYPE_BITWISE_SHIFT_LEFT:
-                    iOpInstr = INSTR_SHL;
-                    break;
-
-                // Binary bitwise shift left
-
-                case OP_TYPE_BITWISE_SHIFT_RIGHT:
-                    iOpInstr = INSTR_SHR;
-                    break;
-            }
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, iOpInstr );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
-
-            // Push the result (stored in _T0)
-
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+            ExprNode * pRight = ParseFactor ();
+            pExpr = NewBinaryExprNode ( iOpType, pExpr, pRight );
         }
+
+        return pExpr;
     }
 
     /******************************************************************************************
     *
     *   ParseFactor ()
     *
-    *   Parses a factor.
+    *   Parses a factor and returns its expression tree.
     */
 
-    void ParseFactor ()
+    ExprNode * ParseFactor ()
     {
-        int iInstrIndex;
+        ExprNode * pExpr;
         int iUnaryOpPending = FALSE;
         int iOpType;
 
@@ -1177,38 +933,35 @@
 
         switch ( GetNextToken () )
         {
-            // It's a true or false constant, so push either 0 and 1 onto the stack
+            // It's a true or false constant, so represent it as either 0 or 1
 
             case TOKEN_TYPE_RSRVD_TRUE:
             case TOKEN_TYPE_RSRVD_FALSE:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, GetCurrToken () == TOKEN_TYPE_RSRVD_TRUE ? 1 : 0 );
+                pExpr = NewExprNode ( EXPR_NODE_INT );
+                pExpr->iIntLiteral = GetCurrToken () == TOKEN_TYPE_RSRVD_TRUE ? 1 : 0;
                 break;
 
-            // It's an integer literal, so push it onto the stack
+            // It's an integer literal
 
             case TOKEN_TYPE_INT:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, atoi ( GetCurrLexeme () ) );
+                pExpr = NewExprNode ( EXPR_NODE_INT );
+                pExpr->iIntLiteral = atoi ( GetCurrLexeme () );
                 break;
 
-            // It's a float literal, so push it onto the stack
+            // It's a float literal
 
             case TOKEN_TYPE_FLOAT:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddFloatICodeOp ( g_iCurrScope, iInstrIndex, ( float ) atof ( GetCurrLexeme () ) );
+                pExpr = NewExprNode ( EXPR_NODE_FLOAT );
+                pExpr->fFloatLiteral = ( float ) atof ( GetCurrLexeme () );
                 break;
 
-            // It's a string literal, so add it to the string table and push the resulting
-            // string index onto the stack
+            // It's a string literal, so add it to the string table and save the resulting
+            // string index
 
             case TOKEN_TYPE_STRING:
-            {
-                int iStringIndex = AddString ( & g_StringTable, GetCurrLexeme () );
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddStringICodeOp ( g_iCurrScope, iInstrIndex, iStringIndex );
+                pExpr = NewExprNode ( EXPR_NODE_STRING );
+                pExpr->iStringIndex = AddString ( & g_pContext->StringTable, GetCurrLexeme () );
                 break;
-            }
 
             // It's an identifier
 
@@ -1216,7 +969,7 @@
             {
                 // First find out if the identifier is a variable or array
 
-                SymbolNode * pSymbol = GetSymbolByIdent ( GetCurrLexeme (), g_iCurrScope );
+                SymbolNode * pSymbol = GetSymbolByIdent ( GetCurrLexeme (), g_pContext->iCurrScope );
                 if ( pSymbol )
                 {
                     // Does an array index follow the identifier?
@@ -1237,34 +990,26 @@
                         if ( GetLookAheadChar () == ']' )
                             ExitOnCodeError ( "Invalid expression" );
 
-                        // Parse the index as an expression recursively
+                        // Parse the index as an expression recursively and hang it off the
+                        // array node
 
-                        ParseExpr ();
+                        pExpr = NewExprNode ( EXPR_NODE_ARRAY );
+                        pExpr->iSymbolIndex = pSymbol->iIndex;
+                        pExpr->pLeft = ParseExpr ();
+                        pExpr->iContainsCall = pExpr->pLeft->iContainsCall;
 
                         // Make sure the index is closed
 
                         ReadToken ( TOKEN_TYPE_DELIM_CLOSE_BRACE );
-
-                        // Pop the resulting value into _T0 and use it as the index variable
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-                        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-                        // Push the original identifier onto the stack as an array, indexed
-                        // with _T0
-
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddArrayIndexVarICodeOp ( g_iCurrScope, iInstrIndex, pSymbol->iIndex, g_iTempVar0SymbolIndex );
                     }
                     else
                     {
-                        // If not, make sure the identifier is not an array, and push it onto
-                        // the stack
+                        // If not, make sure the identifier is not an array
 
                         if ( pSymbol->iSize == 1 )
                         {
-                            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                            AddVarICodeOp ( g_iCurrScope, iInstrIndex, pSymbol->iIndex );
+                            pExpr = NewExprNode ( EXPR_NODE_VAR );
+                            pExpr->iSymbolIndex = pSymbol->iIndex;
                         }
                         else
                         {
@@ -1281,12 +1026,23 @@
                     {
                         // It is, so parse the call
 
-                        ParseFuncCall ();
+                        pExpr = ParseFuncCall ();
+                    }
+                    else if ( GetIntrinsicByName ( GetCurrLexeme () ) != -1 )
+                    {
+                        // It's an intrinsic, which can only be used in an expression if it
+                        // produces a value
+
+                        if ( ! g_Intrinsics [ GetIntrinsicByName ( GetCurrLexeme () ) ].iHasResult )
+                            ExitOnCodeError ( "Intrinsic doesn't return a value" );
 
-                        // Push the return value
+                        pExpr = ParseIntrinsicCall ();
+                    }
+                    else
+                    {
+                        // It's invalid
 
-                        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                        AddRegICodeOp ( g_iCurrScope, iInstrIndex, REG_CODE_RETVAL );
+                        ExitOnCodeError ( "Invalid identifier" );
                     }
                 }
 
@@ -1297,7 +1053,7 @@
             // presence of the closing parenthesis
 
             case TOKEN_TYPE_DELIM_OPEN_PAREN:
-                ParseExpr ();
+                pExpr = ParseExpr ();
                 ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
                 break;
 
@@ -1311,131 +1067,63 @@
 
         if ( iUnaryOpPending )
         {
-            // If so, pop the result of the factor off the top of the stack
+            // Negated literals are folded directly into the literal, and unary plus leaves the
+            // factor as it is
+
+            if ( iOpType == OP_TYPE_SUB && pExpr->iType == EXPR_NODE_INT )
+                pExpr->iIntLiteral = - pExpr->iIntLiteral;
+            else if ( iOpType == OP_TYPE_SUB && pExpr->iType == EXPR_NODE_FLOAT )
+                pExpr->fFloatLiteral = - pExpr->fFloatLiteral;
+            else if ( iOpType != OP_TYPE_ADD )
+                pExpr = NewUnaryExprNode ( iOpType, pExpr );
+        }
 
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+        return pExpr;
+    }
 
-            // Perform the unary operation
+    /******************************************************************************************
+    *
+    *   ParseIf ()
+    *
+    *   Parses an if block.
+    *
+    *       if ( <Expression> ) <Statement>
+    *       if ( <Expression> ) <Statement> else <Statement>
+    */
 
-            if ( iOpType == OP_TYPE_LOGICAL_NOT )
-            {
-                // Get a pair of free jump target indices
+    void ParseIf ()
+    {
+        int iInstrIndex;
 
-                int iTrueJumpTargetIndex = GetNextJumpTargetIndex (),
-                    iExitJumpTargetIndex = GetNextJumpTargetIndex ();
+        // Make sure we're inside a function
 
-                // JE _T0, 0, True
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
+            ExitOnCodeError ( "if illegal in global scope" );
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-                AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
+        // Annotate the line
 
-                // Push 0
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
+        // Create a jump target to mark the beginning of the false block
 
-                // Jmp L1
+        int iFalseJumpTargetIndex = GetNextJumpTargetIndex ();
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-                AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iExitJumpTargetIndex );
+        // Read the opening parenthesis
 
-                // L0: (True)
+        ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
 
-                AddICodeJumpTarget ( g_iCurrScope, iTrueJumpTargetIndex );
+        // Parse the expression
 
-                // Push 1
+        ExprNode * pExpr = ParseExpr ();
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 1 );
+        // Read the closing parenthesis
 
-                // L1: (Exit)
+        ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
 
-                AddICodeJumpTarget ( g_iCurrScope, iExitJumpTargetIndex );
-            }
-            else
-            {
-                int iOpIndex;
-                switch ( iOpType )
-                {
-                    // Negation
+        // If the expression is false, jump to the false target
 
-                    case OP_TYPE_SUB:
-                        iOpIndex = INSTR_NEG;
-                        break;
-
-                    // Bitwise not
-
-                    case OP_TYPE_BITWISE_NOT:
-                        iOpIndex = INSTR_NOT;
-                        break;
-                }
-
-                // Add the instruction's operand
-
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, iOpIndex );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-                // Push the result onto the stack
-
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_PUSH );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-            }
-        }
-    }
-
-    /******************************************************************************************
-    *
-    *   ParseIf ()
-    *
-    *   Parses an if block.
-    *
-    *       if ( <Expression> ) <Statement>
-    *       if ( <Expression> ) <Statement> else <Statement>
-    */
-
-    void ParseIf ()
-    {
-        int iInstrIndex;
-
-        // Make sure we're inside a function
-
-        if ( g_iCurrScope == SCOPE_GLOBAL )
-            ExitOnCodeError ( "if illegal in global scope" );
-
-        // Annotate the line
-
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
-
-        // Create a jump target to mark the beginning of the false block
-
-        int iFalseJumpTargetIndex = GetNextJumpTargetIndex ();
-
-        // Read the opening parenthesis
-
-        ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
-
-        // Parse the expression and leave the result on the stack
-
-        ParseExpr ();
-
-        // Read the closing parenthesis
-
-        ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
-
-        // Pop the result into _T0 and compare it to zero
-
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-
-        // If the result is zero, jump to the false target
-
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iFalseJumpTargetIndex );
+        EmitCondJump ( pExpr, iFalseJumpTargetIndex );
+        FreeExpr ( pExpr );
 
         // Parse the true block
 
@@ -1449,12 +1137,12 @@
             // block
 
             int iSkipFalseJumpTargetIndex = GetNextJumpTargetIndex ();
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-            AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iSkipFalseJumpTargetIndex );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iSkipFalseJumpTargetIndex );
 
             // Place the false target just before the false block
 
-            AddICodeJumpTarget ( g_iCurrScope, iFalseJumpTargetIndex );
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iFalseJumpTargetIndex );
 
             // Parse the false block
 
@@ -1462,7 +1150,7 @@
 
             // Set a jump target beyond the false block
 
-            AddICodeJumpTarget ( g_iCurrScope, iSkipFalseJumpTargetIndex );
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iSkipFalseJumpTargetIndex );
         }
         else
         {
@@ -1472,7 +1160,7 @@
 
             // Place the false target after the true block
 
-            AddICodeJumpTarget ( g_iCurrScope, iFalseJumpTargetIndex );
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iFalseJumpTargetIndex );
         }
     }
 
@@ -1491,12 +1179,12 @@
 
         // Make sure we're inside a function
 
-        if ( g_iCurrScope == SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
             ExitOnCodeError ( "Statement illegal in global scope" );
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         // Get two jump targets; for the top and bottom of the loop
 
@@ -1505,29 +1193,24 @@
 
         // Set a jump target at the top of the loop
 
-        AddICodeJumpTarget ( g_iCurrScope, iStartTargetIndex );
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iStartTargetIndex );
 
         // Read the opening parenthesis
 
         ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
 
-        // Parse the expression and leave the result on the stack
+        // Parse the expression
 
-        ParseExpr ();
+        ExprNode * pExpr = ParseExpr ();
 
         // Read the closing parenthesis
 
         ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
 
-        // Pop the result into _T0 and jump out of the loop if it's nonzero
-
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+        // Jump out of the loop if the expression is false
 
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JE );
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-        AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
-        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iEndTargetIndex );
+        EmitCondJump ( pExpr, iEndTargetIndex );
+        FreeExpr ( pExpr );
 
         // Create a new loop instance structure
 
@@ -1540,7 +1223,7 @@
 
         // Push the loop structure onto the stack
 
-        Push ( & g_LoopStack, pLoop );
+        Push ( & g_pContext->LoopStack, pLoop );
 
         // Parse the loop body
 
@@ -1548,16 +1231,16 @@
 
         // Pop the loop instance off the stack
 
-        Pop ( & g_LoopStack );
+        Pop ( & g_pContext->LoopStack );
 
         // Unconditionally jump back to the start of the loop
 
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iStartTargetIndex );
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iStartTargetIndex );
 
         // Set a jump target for the end of the loop
 
-        AddICodeJumpTarget ( g_iCurrScope, iEndTargetIndex );
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iEndTargetIndex );
     }
 
     /******************************************************************************************
@@ -1571,18 +1254,188 @@
 
     void ParseFor ()
     {
-        if ( g_iCurrScope == SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
             ExitOnCodeError ( "for illegal in global scope" );
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         /*
             A for loop parser implementation could go here
         */
     }
 
+    /******************************************************************************************
+    *
+    *   ParseSwitch ()
+    *
+    *   Parses a switch block. Case values must be integer literals, and control falls through
+    *   from one case to the next unless it breaks out.
+    *
+    *       switch ( <Expression> ) { <Case-List> }
+    *
+    *   The value is evaluated once, then control jumps past the cases' code to the dispatch
+    *   code, which is emitted once every case is known. Values without a case go to the
+    *   default case, or past the block if there isn't one.
+    */
+
+    void ParseSwitch ()
+    {
+        int iInstrIndex;
+
+        // Make sure we're inside a function
+
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
+            ExitOnCodeError ( "switch illegal in global scope" );
+
+        // Annotate the line
+
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
+
+        // Get two jump targets; for the dispatch code and the end of the block
+
+        int iDispatchTargetIndex = GetNextJumpTargetIndex (),
+            iEndTargetIndex = GetNextJumpTargetIndex ();
+
+        // Read the value
+
+        ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
+        ExprNode * pExpr = ParseExpr ();
+        ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
+
+        // Evaluate it, then jump to the dispatch code. Nothing runs between the two, so even
+        // a value left in _T0 is still there when the dispatch code reads it.
+
+        Op Value = EmitExprAsOp ( pExpr );
+        FreeExpr ( pExpr );
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iDispatchTargetIndex );
+
+        // break leaves the block, but continue still applies to the enclosing loop, if any
+
+        Loop * pLoop = ( Loop * ) malloc ( sizeof ( Loop ) );
+
+        pLoop->iStartTargetIndex = -1;
+        if ( ! IsStackEmpty ( & g_pContext->LoopStack ) )
+            pLoop->iStartTargetIndex = ( ( Loop * ) Peek ( & g_pContext->LoopStack ) )->iStartTargetIndex;
+        pLoop->iEndTargetIndex = iEndTargetIndex;
+
+        Push ( & g_pContext->LoopStack, pLoop );
+
+        // ---- Parse the cases
+
+        SwitchCase * pCases = NULL;
+        int iCaseCount = 0,
+            iCaseCapacity = 0;
+
+        int iDefaultTargetIndex = -1;
+        int iIsLabelFound = FALSE;
+
+        ReadToken ( TOKEN_TYPE_DELIM_OPEN_CURLY_BRACE );
+
+        while ( GetNextToken () != TOKEN_TYPE_DELIM_CLOSE_CURLY_BRACE )
+        {
+            switch ( GetCurrToken () )
+            {
+                // case <Integer>:
+
+                case TOKEN_TYPE_RSRVD_CASE:
+                {
+                    // Read the value, which may be negated
+
+                    int iSign = 1;
+
+                    if ( GetNextToken () == TOKEN_TYPE_OP && GetCurrOp () == OP_TYPE_SUB )
+                        iSign = -1;
+                    else
+                        RewindTokenStream ();
+
+                    if ( GetNextToken () != TOKEN_TYPE_INT )
+                        ExitOnCodeError ( "Case values must be integer literals" );
+
+                    int iValue = iSign * atoi ( GetCurrLexeme () );
+
+                    ReadToken ( TOKEN_TYPE_DELIM_COLON );
+
+                    // Add the case and mark where its code starts
+
+                    if ( iCaseCount == iCaseCapacity )
+                    {
+                        iCaseCapacity = iCaseCapacity ? iCaseCapacity * 2 : 8;
+                        pCases = ( SwitchCase * ) realloc ( pCases, iCaseCapacity * sizeof ( SwitchCase ) );
+                    }
+
+                    pCases [ iCaseCount ].iValue = iValue;
+                    pCases [ iCaseCount ].iJumpTargetIndex = GetNextJumpTargetIndex ();
+                    AddICodeJumpTarget ( g_pContext->iCurrScope, pCases [ iCaseCount ].iJumpTargetIndex );
+                    ++ iCaseCount;
+
+                    iIsLabelFound = TRUE;
+                    break;
+                }
+
+                // default:
+
+                case TOKEN_TYPE_RSRVD_DEFAULT:
+
+                    if ( iDefaultTargetIndex != -1 )
+                        ExitOnCodeError ( "Multiple default cases" );
+
+                    ReadToken ( TOKEN_TYPE_DELIM_COLON );
+
+                    iDefaultTargetIndex = GetNextJumpTargetIndex ();
+                    AddICodeJumpTarget ( g_pContext->iCurrScope, iDefaultTargetIndex );
+
+                    iIsLabelFound = TRUE;
+                    break;
+
+                // Anything else is a statement belonging to the most recent label
+
+                default:
+
+                    if ( ! iIsLabelFound )
+                        ExitOnCodeError ( "Statement outside of case" );
+
+                    RewindTokenStream ();
+                    ParseStatement ();
+                    break;
+            }
+        }
+
+        Pop ( & g_pContext->LoopStack );
+
+        // The last case's code skips the dispatch code
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iEndTargetIndex );
+
+        // ---- Emit the dispatch code
+
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iDispatchTargetIndex );
+
+        if ( iDefaultTargetIndex == -1 )
+            iDefaultTargetIndex = iEndTargetIndex;
+
+        // Sort the cases by value, which also brings any duplicates together
+
+        if ( iCaseCount )
+            qsort ( pCases, iCaseCount, sizeof ( SwitchCase ), CompareSwitchCases );
+
+        for ( int iCurrCaseIndex = 1; iCurrCaseIndex < iCaseCount; ++ iCurrCaseIndex )
+            if ( pCases [ iCurrCaseIndex ].iValue == pCases [ iCurrCaseIndex - 1 ].iValue )
+                ExitOnCodeError ( "Duplicate case value" );
+
+        EmitSwitchSearch ( Value, pCases, iCaseCount, iDefaultTargetIndex );
+
+        free ( pCases );
+
+        // Set a jump target for the end of the block
+
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iEndTargetIndex );
+    }
+
     /******************************************************************************************
     *
     *   ParseBreak ()
@@ -1594,12 +1447,12 @@
     {
         // Make sure we're in a loop
 
-        if ( IsStackEmpty ( & g_LoopStack ) )
+        if ( IsStackEmpty ( & g_pContext->LoopStack ) )
             ExitOnCodeError ( "break illegal outside loops" );
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         // Attempt to read the semicolon
 
@@ -1607,12 +1460,12 @@
 
         // Get the jump target index for the end of the loop
 
-        int iTargetIndex = ( ( Loop * ) Peek ( & g_LoopStack ) )->iEndTargetIndex;
+        int iTargetIndex = ( ( Loop * ) Peek ( & g_pContext->LoopStack ) )->iEndTargetIndex;
 
         // Unconditionally jump to the end of the loop
 
-        int iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTargetIndex );
+        int iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTargetIndex );
     }
 
     /******************************************************************************************
@@ -1626,25 +1479,29 @@
     {
         // Make sure we're inside a function
 
-        if ( IsStackEmpty ( & g_LoopStack ) )
+        if ( IsStackEmpty ( & g_pContext->LoopStack ) )
             ExitOnCodeError ( "continue illegal outside loops" );
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         // Attempt to read the semicolon
 
         ReadToken ( TOKEN_TYPE_DELIM_SEMICOLON );
 
-        // Get the jump target index for the start of the loop
+        // Get the jump target index for the start of the loop. A switch outside of any loop
+        // doesn't have one.
 
-        int iTargetIndex = ( ( Loop * ) Peek ( & g_LoopStack ) )->iStartTargetIndex;
+        int iTargetIndex = ( ( Loop * ) Peek ( & g_pContext->LoopStack ) )->iStartTargetIndex;
+
+        if ( iTargetIndex == -1 )
+            ExitOnCodeError ( "continue illegal outside loops" );
 
         // Unconditionally jump to the end of the loop
 
-        int iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_JMP );
-        AddJumpTargetICodeOp ( g_iCurrScope, iInstrIndex, iTargetIndex );
+        int iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTargetIndex );
     }
 
     /******************************************************************************************
@@ -1663,69 +1520,120 @@
 
         // Make sure we're inside a function
 
-        if ( g_iCurrScope == SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
             ExitOnCodeError ( "return illegal in global scope" );
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         // If a semicolon doesn't appear to follow, parse the expression and place it in
         // _RetVal
 
         if ( GetLookAheadChar () != ';' )
         {
-            // Parse the expression to calculate the return value and leave the result on the stack.
+            // Parse the expression to calculate the return value
 
-            ParseExpr ();
+            ExprNode * pExpr = ParseExpr ();
 
             // Determine which function we're returning from
 
-            if ( g_ScriptHeader.iIsMainFuncPresent &&
-                 g_ScriptHeader.iMainFuncIndex == g_iCurrScope )
+            if ( g_pContext->ScriptHeader.iIsMainFuncPresent &&
+                 g_pContext->ScriptHeader.iMainFuncIndex == g_pContext->iCurrScope )
             {
-                // It is _Main (), so pop the result into _T0
+                // It is _Main (), so evaluate the result into _T0
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+                EmitExpr ( pExpr );
             }
             else
             {
-                // It's not _Main, so pop the result into the _RetVal register
+                // It's not _Main, so move the result into the _RetVal register
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-                AddRegICodeOp ( g_iCurrScope, iInstrIndex, REG_CODE_RETVAL );
+                Op Value = EmitExprAsOp ( pExpr );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddRegICodeOp ( g_pContext->iCurrScope, iInstrIndex, REG_CODE_RETVAL );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
             }
+
+            FreeExpr ( pExpr );
         }
         else
         {
             // Clear _T0 in case we're exiting _Main ()
 
-            if ( g_ScriptHeader.iIsMainFuncPresent &&
-                 g_ScriptHeader.iMainFuncIndex == g_iCurrScope )
+            if ( g_pContext->ScriptHeader.iIsMainFuncPresent &&
+                 g_pContext->ScriptHeader.iMainFuncIndex == g_pContext->iCurrScope )
             {
 
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_MOV );
-                AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
-                AddIntICodeOp ( g_iCurrScope, iInstrIndex, 0 );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
             }
         }
 
-        if ( g_ScriptHeader.iIsMainFuncPresent &&
-             g_ScriptHeader.iMainFuncIndex == g_iCurrScope )
+        if ( g_pContext->ScriptHeader.iIsMainFuncPresent &&
+             g_pContext->ScriptHeader.iMainFuncIndex == g_pContext->iCurrScope )
         {
             // It's _Main, so exit the script with _T0 as the exit code
 
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_EXIT );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_EXIT );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
         }
         else
         {
             // It's not _Main, so return from the function
 
-            AddICodeInstr ( g_iCurrScope, INSTR_RET );
+            AddICodeInstr ( g_pContext->iCurrScope, INSTR_RET );
+        }
+
+		// Validate the presence of the semicolon
+
+		ReadToken ( TOKEN_TYPE_DELIM_SEMICOLON );
+    }
+
+    /******************************************************************************************
+    *
+    *   ParseYield ()
+    *
+    *   Parses a yield statement, which suspends the coroutine running the current function
+    *   and hands the optional expression to the host through _RetVal.
+    *
+    *   yield;
+    *   yield <expr>;
+    */
+
+    void ParseYield ()
+    {
+        int iInstrIndex;
+
+        // Make sure we're inside a function
+
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
+            ExitOnCodeError ( "yield illegal in global scope" );
+
+        // Annotate the line
+
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
+
+        // If a semicolon doesn't appear to follow, parse the expression and place it in
+        // _RetVal
+
+        if ( GetLookAheadChar () != ';' )
+        {
+            ExprNode * pExpr = ParseExpr ();
+
+            Op Value = EmitExprAsOp ( pExpr );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+            AddRegICodeOp ( g_pContext->iCurrScope, iInstrIndex, REG_CODE_RETVAL );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+
+            FreeExpr ( pExpr );
         }
 
+        // Suspend the coroutine
+
+        AddICodeInstr ( g_pContext->iCurrScope, INSTR_YIELD );
+
 		// Validate the presence of the semicolon
 
 		ReadToken ( TOKEN_TYPE_DELIM_SEMICOLON );
@@ -1744,7 +1652,7 @@
     {
         // Make sure we're inside a function
 
-        if ( g_iCurrScope == SCOPE_GLOBAL )
+        if ( g_pContext->iCurrScope == SCOPE_GLOBAL )
             ExitOnCodeError ( "Assignment illegal in global scope" );
 
         int iInstrIndex;
@@ -1755,15 +1663,15 @@
 
         // Annotate the line
 
-        AddICodeSourceLine ( g_iCurrScope, GetCurrSourceLine () );
+        AddICodeSourceLine ( g_pContext->iCurrScope, GetCurrSourceLine () );
 
         // ---- Parse the variable or array
 
-        SymbolNode * pSymbol = GetSymbolByIdent ( GetCurrLexeme (), g_iCurrScope );
+        SymbolNode * pSymbol = GetSymbolByIdent ( GetCurrLexeme (), g_pContext->iCurrScope );
 
         // Does an array index follow the identifier?
 
-        int iIsArray = FALSE;
+        ExprNode * pIndex = NULL;
         if ( GetLookAheadChar () == '[' )
         {
             // Ensure the variable is an array
@@ -1782,15 +1690,11 @@
 
             // Parse the index as an expression
 
-            ParseExpr ();
+            pIndex = ParseExpr ();
 
             // Make sure the index is closed
 
             ReadToken ( TOKEN_TYPE_DELIM_CLOSE_BRACE );
-
-            // Set the array flag
-
-            iIsArray = TRUE;
         }
         else
         {
@@ -1822,25 +1726,63 @@
 
         // ---- Parse the value expression
 
-        ParseExpr ();
+        ExprNode * pValue = ParseExpr ();
 
         // Validate the presence of the semicolon
 
         ReadToken ( TOKEN_TYPE_DELIM_SEMICOLON );
 
-        // Pop the value into _T0
+        // ---- Generate the code for the destination and source operands
 
-        iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+        Op Dest,
+           Source;
+
+        if ( ! pIndex )
+        {
+            // A plain variable is always a direct destination
+
+            Dest = GetVarOp ( pSymbol->iIndex );
+            Source = EmitExprAsOp ( pValue );
+        }
+        else if ( IsExprDirectIndex ( pIndex ) && ! pValue->iContainsCall )
+        {
+            // The index can be used directly since the value can't change it
 
-        // If the variable was an array, pop the top of the stack into _T1 for use as the index
+            Source = EmitExprAsOp ( pValue );
+            Dest = GetArrayOp ( pSymbol->iIndex, pIndex, -1 );
+        }
+        else if ( IsExprDirectOp ( pValue ) )
+        {
+            // The value is direct, so only the index needs to be evaluated into _T0
 
-        if ( iIsArray )
+            EmitExpr ( pIndex );
+            Dest = GetArrayOp ( pSymbol->iIndex, NULL, g_pContext->iTempVar0SymbolIndex );
+            Source = GetExprDirectOp ( pValue );
+        }
+        else
         {
-            iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_POP );
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar1SymbolIndex );
+            // Both need evaluating, so keep the index on the stack while the value is
+            // evaluated into _T0, then pop the index into _T1
+
+            Op Value = EmitExprAsOp ( pIndex );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_PUSH );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+
+            EmitExpr ( pValue );
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_POP );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar1SymbolIndex );
+
+            Dest = GetArrayOp ( pSymbol->iIndex, NULL, g_pContext->iTempVar1SymbolIndex );
+            Source = GetVarOp ( g_pContext->iTempVar0SymbolIndex );
         }
 
+        FreeExpr ( pIndex );
+        FreeExpr ( pValue );
+
+        if ( iAssignOp == OP_TYPE_ASSIGN_CONCAT )
+            Source = EmitConcatSourceOp ( Source );
+
         // ---- Generate the I-code for the assignment instruction
 
         switch ( iAssignOp )
@@ -1848,109 +1790,110 @@
             // =
 
             case OP_TYPE_ASSIGN:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_MOV );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
                 break;
 
             // +=
 
             case OP_TYPE_ASSIGN_ADD:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_ADD );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_ADD );
                 break;
 
             // -=
 
             case OP_TYPE_ASSIGN_SUB:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_SUB );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_SUB );
                 break;
 
             // *=
 
             case OP_TYPE_ASSIGN_MUL:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_MUL );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MUL );
                 break;
 
             // /=
 
             case OP_TYPE_ASSIGN_DIV:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_DIV );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_DIV );
                 break;
 
             // %=
 
             case OP_TYPE_ASSIGN_MOD:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_MOD );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOD );
                 break;
 
             // ^=
 
             case OP_TYPE_ASSIGN_EXP:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_EXP );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_EXP );
                 break;
 
             // $=
 
             case OP_TYPE_ASSIGN_CONCAT:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_CONCAT );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_CONCAT );
                 break;
 
             // &=
 
             case OP_TYPE_ASSIGN_AND:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_AND );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_AND );
                 break;
 
             // |=
 
             case OP_TYPE_ASSIGN_OR:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_OR );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_OR );
                 break;
 
             // #=
 
             case OP_TYPE_ASSIGN_XOR:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_XOR );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_XOR );
                 break;
 
             // <<=
 
             case OP_TYPE_ASSIGN_SHIFT_LEFT:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_SHL );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_SHL );
                 break;
 
             // >>=
 
             case OP_TYPE_ASSIGN_SHIFT_RIGHT:
-                iInstrIndex = AddICodeInstr ( g_iCurrScope, INSTR_SHR );
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_SHR );
                 break;
         }
 
-        // Generate the destination operand
-
-        if ( iIsArray )
-            AddArrayIndexVarICodeOp ( g_iCurrScope, iInstrIndex, pSymbol->iIndex, g_iTempVar1SymbolIndex );
-        else
-            AddVarICodeOp ( g_iCurrScope, iInstrIndex, pSymbol->iIndex );
-
-        // Generate the source
+        // Add the destination and source operands
 
-        AddVarICodeOp ( g_iCurrScope, iInstrIndex, g_iTempVar0SymbolIndex );
+        AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Dest );
+        AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Source );
     }
 
     /******************************************************************************************
     *
     *   ParseFuncCall ()
     *
-    *   Parses a function call
+    *   Parses a function call and returns its expression tree. The code for the call is
+    *   generated later by EmitFuncCall ().
     *
     *   <Ident> ( <Expr>, <Expr> );
     */
 
-    void ParseFuncCall ()
+    ExprNode * ParseFuncCall ()
     {
         // Get the function by it's identifier
 
         FuncNode * pFunc = GetFuncByName ( GetCurrLexeme () );
 
+        // Create the call node
+
+        ExprNode * pCall = NewExprNode ( EXPR_NODE_FUNC_CALL );
+        pCall->iFuncIndex = pFunc->iIndex;
+        pCall->iContainsCall = TRUE;
+
         // It is, so start the parameter count at zero
 
         int iParamCount = 0;
@@ -1959,7 +1902,7 @@
 
         ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
 
-        // Parse each parameter and push it onto the stack
+        // Parse each parameter and add it to the call's parameter list
 
         while ( TRUE )
         {
@@ -1969,7 +1912,7 @@
             {
                 // There is, so parse it as an expression
 
-                ParseExpr ();
+                AddNode ( & pCall->ParamList, ParseExpr () );
 
                 // Increment the parameter count and make sure it's not greater than the amount
                 // accepted by the function (unless it's a host API function
@@ -2001,12 +1944,1632 @@
         if ( ! pFunc->iIsHostAPI && iParamCount < pFunc->iParamCount )
             ExitOnCodeError ( "Too few parameters" );
 
-        // Call the function, but make sure the right call instruction is used
+        return pCall;
+    }
 
-        int iCallInstr = INSTR_CALL;
-        if ( pFunc->iIsHostAPI )
-            iCallInstr = INSTR_CALLHOST;
+    /******************************************************************************************
+    *
+    *   GetIntrinsicByName ()
+    *
+    *   Returns the index of the intrinsic with the specified name, or -1 if there isn't one.
+    */
+
+    int GetIntrinsicByName ( char * pstrName )
+    {
+        int iIntrinsicCount = sizeof ( g_Intrinsics ) / sizeof ( Intrinsic );
+
+        for ( int iCurrIntrinsicIndex = 0; iCurrIntrinsicIndex < iIntrinsicCount; ++ iCurrIntrinsicIndex )
+            if ( stricmp ( g_Intrinsics [ iCurrIntrinsicIndex ].pstrName, pstrName ) == 0 )
+                return iCurrIntrinsicIndex;
+
+        return -1;
+    }
+
+    /******************************************************************************************
+    *
+    *   ParseIntrinsicCall ()
+    *
+    *   Parses a call to an intrinsic and returns its expression tree. Scalar parameters are
+    *   expressions, vectors are arrays that can be indexed with a literal or a variable to
+    *   start at that element, and the vector size is an integer literal. The code for the
+    *   call is generated later by EmitIntrinsicCall ().
+    *
+    *   <Ident> ( <Expr>, <Expr> );
+    *   <Ident> ( <Ident> [ <Index> ], <Ident>, <Size> );
+    */
+
+    ExprNode * ParseIntrinsicCall ()
+    {
+        // Get the intrinsic by its name
+
+        int iIntrinsicIndex = GetIntrinsicByName ( GetCurrLexeme () );
+        Intrinsic * pIntrinsic = & g_Intrinsics [ iIntrinsicIndex ];
+
+        // Create the call node
+
+        ExprNode * pCall = NewExprNode ( EXPR_NODE_INTRINSIC );
+        pCall->iIntrinsicIndex = iIntrinsicIndex;
+
+        int iSize = 0;
+
+        // Attempt to read the opening parenthesis
+
+        ReadToken ( TOKEN_TYPE_DELIM_OPEN_PAREN );
+
+        // Parse each parameter according to its kind and add it to the parameter list
+
+        for ( char * pstrParam = pIntrinsic->pstrParams; * pstrParam; ++ pstrParam )
+        {
+            // Every parameter after the first follows a comma
+
+            if ( pstrParam != pIntrinsic->pstrParams )
+                ReadToken ( TOKEN_TYPE_DELIM_COMMA );
+
+            ExprNode * pParam;
+
+            switch ( * pstrParam )
+            {
+                // A scalar is any expression
+
+                case INTRINSIC_PARAM_SCALAR:
+                    pParam = ParseExpr ();
+                    break;
+
+                // A vector is an array
+
+                case INTRINSIC_PARAM_VECTOR:
+                {
+                    ReadToken ( TOKEN_TYPE_IDENT );
+
+                    SymbolNode * pSymbol = GetSymbolByIdent ( GetCurrLexeme (), g_pContext->iCurrScope );
+                    if ( ! pSymbol || pSymbol->iSize == 1 )
+                        ExitOnCodeError ( "Vectors must be arrays" );
+
+                    pParam = NewExprNode ( EXPR_NODE_ARRAY );
+                    pParam->iSymbolIndex = pSymbol->iIndex;
+
+                    // An index starts the vector at that element, otherwise it starts at the
+                    // first one. The index has to be usable directly, since the vector is
+                    // passed as an array operand.
+
+                    if ( GetLookAheadChar () == '[' )
+                    {
+                        ReadToken ( TOKEN_TYPE_DELIM_OPEN_BRACE );
+                        pParam->pLeft = ParseExpr ();
+                        ReadToken ( TOKEN_TYPE_DELIM_CLOSE_BRACE );
+
+                        if ( ! IsExprDirectIndex ( pParam->pLeft ) )
+                            ExitOnCodeError ( "Vector indices must be integer literals or variables" );
+                    }
+                    else
+                    {
+                        pParam->pLeft = NewExprNode ( EXPR_NODE_INT );
+                    }
+
+                    break;
+                }
+
+                // The vector size has to be known at compile time
+
+                case INTRINSIC_PARAM_SIZE:
+                {
+                    if ( GetNextToken () != TOKEN_TYPE_INT )
+                        ExitOnCodeError ( "Vector sizes must be integer literals" );
+
+                    iSize = atoi ( GetCurrLexeme () );
+                    if ( iSize < 1 || iSize > MAX_VECTOR_SIZE )
+                        ExitOnCodeError ( "Invalid vector size" );
 
-        int iInstrIndex = AddICodeInstr ( g_iCurrScope, iCallInstr );
-        AddFuncICodeOp ( g_iCurrScope, iInstrIndex, pFunc->iIndex );
+                    pParam = NewExprNode ( EXPR_NODE_INT );
+                    pParam->iIntLiteral = iSize;
+                    break;
+                }
+            }
+
+            AddNode ( & pCall->ParamList, pParam );
+
+            // Intrinsics don't call anything themselves, but their parameters might
+
+            if ( pParam->iContainsCall )
+                pCall->iContainsCall = TRUE;
+        }
+
+        // Attempt to read the closing parenthesis
+
+        ReadToken ( TOKEN_TYPE_DELIM_CLOSE_PAREN );
+
+        // Make sure vectors that start at literal indices fit in their arrays
+
+        for ( LinkedListNode * pNode = pCall->ParamList.pHead; pNode; pNode = pNode->pNext )
+        {
+            ExprNode * pParam = ( ExprNode * ) pNode->pData;
+
+            if ( pParam->iType == EXPR_NODE_ARRAY && pParam->pLeft->iType == EXPR_NODE_INT &&
+                 pParam->pLeft->iIntLiteral + iSize > GetSymbolByIndex ( pParam->iSymbolIndex )->iSize )
+                ExitOnCodeError ( "Vector exceeds array bounds" );
+        }
+
+        return pCall;
+    }
+
+    /******************************************************************************************
+    *
+    *   NewExprNode ()
+    *
+    *   Allocates and initializes an expression tree node of the specified type.
+    */
+
+    ExprNode * NewExprNode ( int iType )
+    {
+        // Allocate the node
+
+        ExprNode * pNode = ( ExprNode * ) malloc ( sizeof ( ExprNode ) );
+
+        // Set the type and clear everything else
+
+        pNode->iType = iType;
+        pNode->iIntLiteral = 0;
+        pNode->pLeft = NULL;
+        pNode->pRight = NULL;
+        InitLinkedList ( & pNode->ParamList );
+        pNode->iContainsCall = FALSE;
+
+        return pNode;
+    }
+
+    /******************************************************************************************
+    *
+    *   NewUnaryExprNode ()
+    *
+    *   Creates a unary operator node over the specified operand.
+    */
+
+    ExprNode * NewUnaryExprNode ( int iOpType, ExprNode * pOperand )
+    {
+        ExprNode * pNode = NewExprNode ( EXPR_NODE_UNARY_OP );
+        pNode->iOpType = iOpType;
+        pNode->pLeft = pOperand;
+        pNode->iContainsCall = pOperand->iContainsCall;
+
+        return pNode;
+    }
+
+    /******************************************************************************************
+    *
+    *   NewBinaryExprNode ()
+    *
+    *   Creates a binary operator node over the specified operands.
+    */
+
+    ExprNode * NewBinaryExprNode ( int iOpType, ExprNode * pLeft, ExprNode * pRight )
+    {
+        ExprNode * pNode = NewExprNode ( EXPR_NODE_BINARY_OP );
+        pNode->iOpType = iOpType;
+        pNode->pLeft = pLeft;
+        pNode->pRight = pRight;
+        pNode->iContainsCall = pLeft->iContainsCall || pRight->iContainsCall;
+
+        return pNode;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeExpr ()
+    *
+    *   Frees an expression tree.
+    */
+
+    void FreeExpr ( ExprNode * pExpr )
+    {
+        if ( ! pExpr )
+            return;
+
+        // Free the operands
+
+        FreeExpr ( pExpr->pLeft );
+        FreeExpr ( pExpr->pRight );
+
+        // Free each parameter's tree and detach it from the list so the list can be freed
+
+        for ( LinkedListNode * pNode = pExpr->ParamList.pHead; pNode; pNode = pNode->pNext )
+        {
+            FreeExpr ( ( ExprNode * ) pNode->pData );
+            pNode->pData = NULL;
+        }
+        FreeLinkedList ( & pExpr->ParamList );
+
+        // Free the node itself
+
+        free ( pExpr );
+    }
+
+    /******************************************************************************************
+    *
+    *   IsExprDirectIndex ()
+    *
+    *   Determines if an array index expression can be encoded directly in an array operand,
+    *   which is the case for nonnegative integer literals and variables.
+    */
+
+    int IsExprDirectIndex ( ExprNode * pIndex )
+    {
+        if ( pIndex->iType == EXPR_NODE_INT && pIndex->iIntLiteral >= 0 )
+            return TRUE;
+
+        if ( pIndex->iType == EXPR_NODE_VAR )
+            return TRUE;
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   IsExprDirectOp ()
+    *
+    *   Determines if an expression can be used directly as an instruction operand, without
+    *   evaluating it into a temporary variable first.
+    */
+
+    int IsExprDirectOp ( ExprNode * pExpr )
+    {
+        switch ( pExpr->iType )
+        {
+            // Literals and variables are always valid operands
+
+            case EXPR_NODE_INT:
+            case EXPR_NODE_FLOAT:
+            case EXPR_NODE_STRING:
+            case EXPR_NODE_VAR:
+                return TRUE;
+
+            // Arrays are only valid if they're indexed with a literal or variable
+
+            case EXPR_NODE_ARRAY:
+                return IsExprDirectIndex ( pExpr->pLeft );
+
+            // Everything else has to be evaluated
+
+            default:
+                return FALSE;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GetVarOp ()
+    *
+    *   Returns a variable operand for the specified symbol.
+    */
+
+    Op GetVarOp ( int iSymbolIndex )
+    {
+        Op Value;
+        Value.iType = OP_TYPE_VAR;
+        Value.iSymbolIndex = iSymbolIndex;
+
+        return Value;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetArrayOp ()
+    *
+    *   Returns an array operand indexed either by a direct index expression, or by the
+    *   specified variable if the index isn't direct.
+    */
+
+    Op GetArrayOp ( int iArraySymbolIndex, ExprNode * pIndex, int iIndexSymbolIndex )
+    {
+        Op Value;
+        Value.iSymbolIndex = iArraySymbolIndex;
+
+        if ( pIndex && pIndex->iType == EXPR_NODE_INT )
+        {
+            Value.iType = OP_TYPE_ARRAY_INDEX_ABS;
+            Value.iOffset = pIndex->iIntLiteral;
+        }
+        else
+        {
+            Value.iType = OP_TYPE_ARRAY_INDEX_VAR;
+            Value.iOffsetSymbolIndex = pIndex ? pIndex->iSymbolIndex : iIndexSymbolIndex;
+        }
+
+        return Value;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetExprDirectOp ()
+    *
+    *   Returns the operand for an expression that passes IsExprDirectOp ().
+    */
+
+    Op GetExprDirectOp ( ExprNode * pExpr )
+    {
+        Op Value;
+
+        switch ( pExpr->iType )
+        {
+            case EXPR_NODE_INT:
+                Value.iType = OP_TYPE_INT;
+                Value.iIntLiteral = pExpr->iIntLiteral;
+                break;
+
+            case EXPR_NODE_FLOAT:
+                Value.iType = OP_TYPE_FLOAT;
+                Value.fFloatLiteral = pExpr->fFloatLiteral;
+                break;
+
+            case EXPR_NODE_STRING:
+                Value.iType = OP_TYPE_STRING_INDEX;
+                Value.iStringIndex = pExpr->iStringIndex;
+                break;
+
+            case EXPR_NODE_VAR:
+                Value = GetVarOp ( pExpr->iSymbolIndex );
+                break;
+
+            case EXPR_NODE_ARRAY:
+                Value = GetArrayOp ( pExpr->iSymbolIndex, pExpr->pLeft, -1 );
+                break;
+        }
+
+        return Value;
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitExprAsOp ()
+    *
+    *   Returns an operand holding the value of an expression. Direct expressions are returned
+    *   as-is; anything else is evaluated into _T0.
+    */
+
+    Op EmitExprAsOp ( ExprNode * pExpr )
+    {
+        if ( IsExprDirectOp ( pExpr ) )
+            return GetExprDirectOp ( pExpr );
+
+        EmitExpr ( pExpr );
+        return GetVarOp ( g_pContext->iTempVar0SymbolIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitConcatSourceOp ()
+    *
+    *   Returns an operand Concat will accept as its source in place of the specified one.
+    *   Concat only takes a string or a variable, so a numeric literal is moved into _T1
+    *   first; _T1 never holds anything else once Concat's operands are ready.
+    */
+
+    Op EmitConcatSourceOp ( Op Source )
+    {
+        if ( Source.iType != OP_TYPE_INT && Source.iType != OP_TYPE_FLOAT )
+            return Source;
+
+        // Mov _T1, Source
+
+        int iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+        AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar1SymbolIndex );
+        AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Source );
+
+        return GetVarOp ( g_pContext->iTempVar1SymbolIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitBinaryOperands ()
+    *
+    *   Generates the code needed to make both operands of a binary operator available as
+    *   instruction operands. If iLeftInTemp is set, the left operand always ends up in _T0 so
+    *   it can be used as the destination.
+    *
+    *   Operands are evaluated left-to-right. The left operand is only spilled to the stack
+    *   when the right operand needs both temporaries to evaluate, or could change the left
+    *   operand's value by calling a function.
+    */
+
+    void EmitBinaryOperands ( ExprNode * pExpr, int iLeftInTemp, Op * pLeftOp, Op * pRightOp )
+    {
+        int iInstrIndex;
+
+        ExprNode * pLeft = pExpr->pLeft,
+                 * pRight = pExpr->pRight;
+
+        if ( IsExprDirectOp ( pRight ) )
+        {
+            // The right operand is direct, so only the left one needs any code
+
+            if ( iLeftInTemp )
+            {
+                EmitExpr ( pLeft );
+                * pLeftOp = GetVarOp ( g_pContext->iTempVar0SymbolIndex );
+            }
+            else
+            {
+                * pLeftOp = EmitExprAsOp ( pLeft );
+            }
+
+            * pRightOp = GetExprDirectOp ( pRight );
+        }
+        else if ( IsExprDirectOp ( pLeft ) && ! pRight->iContainsCall )
+        {
+            // The left operand is direct and can't be changed by the right one, so evaluate
+            // the right operand first
+
+            EmitExpr ( pRight );
+
+            if ( iLeftInTemp )
+            {
+                // Mov _T1, _T0
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar1SymbolIndex );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+
+                // Mov _T0, Left
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, GetExprDirectOp ( pLeft ) );
+
+                * pLeftOp = GetVarOp ( g_pContext->iTempVar0SymbolIndex );
+                * pRightOp = GetVarOp ( g_pContext->iTempVar1SymbolIndex );
+            }
+            else
+            {
+                * pLeftOp = GetExprDirectOp ( pLeft );
+                * pRightOp = GetVarOp ( g_pContext->iTempVar0SymbolIndex );
+            }
+        }
+        else
+        {
+            // Both operands need the temporaries, so spill the left operand to the stack
+            // while the right one is evaluated
+
+            Op Value = EmitExprAsOp ( pLeft );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_PUSH );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+
+            EmitExpr ( pRight );
+
+            // Mov _T1, _T0
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar1SymbolIndex );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+
+            // Pop _T0
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_POP );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+
+            * pLeftOp = GetVarOp ( g_pContext->iTempVar0SymbolIndex );
+            * pRightOp = GetVarOp ( g_pContext->iTempVar1SymbolIndex );
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitBoolResult ()
+    *
+    *   Finishes a conditional jump to the specified true target by setting _T0 to 0 if the
+    *   jump wasn't taken and 1 if it was.
+    */
+
+    void EmitBoolResult ( int iTrueJumpTargetIndex )
+    {
+        int iInstrIndex;
+        int iExitJumpTargetIndex = GetNextJumpTargetIndex ();
+
+        // Mov _T0, 0
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+        AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+        AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
+
+        // Jmp Exit
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iExitJumpTargetIndex );
+
+        // L0: (True)
+
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iTrueJumpTargetIndex );
+
+        // Mov _T0, 1
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+        AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+        AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 1 );
+
+        // L1: (Exit)
+
+        AddICodeJumpTarget ( g_pContext->iCurrScope, iExitJumpTargetIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetRelationalInstr ()
+    *
+    *   Returns the conditional jump instruction that implements a relational operator.
+    */
+
+    int GetRelationalInstr ( int iOpType )
+    {
+        switch ( iOpType )
+        {
+            case OP_TYPE_EQUAL:
+                return INSTR_JE;
+
+            case OP_TYPE_NOT_EQUAL:
+                return INSTR_JNE;
+
+            case OP_TYPE_GREATER:
+                return INSTR_JG;
+
+            case OP_TYPE_LESS:
+                return INSTR_JL;
+
+            case OP_TYPE_GREATER_EQUAL:
+                return INSTR_JGE;
+
+            default:
+                return INSTR_JLE;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GetArithmeticInstr ()
+    *
+    *   Returns the instruction that implements an arithmetic, bitwise or string operator.
+    */
+
+    int GetArithmeticInstr ( int iOpType )
+    {
+        switch ( iOpType )
+        {
+            case OP_TYPE_ADD:
+                return INSTR_ADD;
+
+            case OP_TYPE_SUB:
+                return INSTR_SUB;
+
+            case OP_TYPE_CONCAT:
+                return INSTR_CONCAT;
+
+            case OP_TYPE_MUL:
+                return INSTR_MUL;
+
+            case OP_TYPE_DIV:
+                return INSTR_DIV;
+
+            case OP_TYPE_MOD:
+                return INSTR_MOD;
+
+            case OP_TYPE_EXP:
+                return INSTR_EXP;
+
+            case OP_TYPE_BITWISE_AND:
+                return INSTR_AND;
+
+            case OP_TYPE_BITWISE_OR:
+                return INSTR_OR;
+
+            case OP_TYPE_BITWISE_XOR:
+                return INSTR_XOR;
+
+            case OP_TYPE_BITWISE_SHIFT_LEFT:
+                return INSTR_SHL;
+
+            default:
+                return INSTR_SHR;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitExpr ()
+    *
+    *   Generates the code for an expression tree, leaving the result in _T0.
+    */
+
+    void EmitExpr ( ExprNode * pExpr )
+    {
+        int iInstrIndex;
+        Op LeftOp,
+           RightOp;
+
+        // Direct expressions just need to be moved into _T0
+
+        if ( IsExprDirectOp ( pExpr ) )
+        {
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+            AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, GetExprDirectOp ( pExpr ) );
+            return;
+        }
+
+        switch ( pExpr->iType )
+        {
+            // An array with a computed index
+
+            case EXPR_NODE_ARRAY:
+            {
+                // Evaluate the index into _T0 and use it to index the array
+
+                EmitExpr ( pExpr->pLeft );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddArrayIndexVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, pExpr->iSymbolIndex, g_pContext->iTempVar0SymbolIndex );
+                break;
+            }
+
+            // A function call
+
+            case EXPR_NODE_FUNC_CALL:
+            {
+                // Make the call and move the return value into _T0
+
+                EmitFuncCall ( pExpr );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddRegICodeOp ( g_pContext->iCurrScope, iInstrIndex, REG_CODE_RETVAL );
+                break;
+            }
+
+            // An intrinsic call, which leaves its result in _T0 itself
+
+            case EXPR_NODE_INTRINSIC:
+                EmitIntrinsicCall ( pExpr );
+                break;
+
+            // A unary operator
+
+            case EXPR_NODE_UNARY_OP:
+            {
+                if ( pExpr->iOpType == OP_TYPE_LOGICAL_NOT )
+                {
+                    // JE Operand, 0, True
+
+                    int iTrueJumpTargetIndex = GetNextJumpTargetIndex ();
+
+                    Op Value = EmitExprAsOp ( pExpr->pLeft );
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JE );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+                    AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
+
+                    EmitBoolResult ( iTrueJumpTargetIndex );
+                }
+                else
+                {
+                    // Evaluate the operand into _T0 and negate or bitwise-not it in place
+
+                    EmitExpr ( pExpr->pLeft );
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, pExpr->iOpType == OP_TYPE_SUB ? INSTR_NEG : INSTR_NOT );
+                    AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                }
+
+                break;
+            }
+
+            // A binary operator
+
+            case EXPR_NODE_BINARY_OP:
+            {
+                if ( IsOpRelational ( pExpr->iOpType ) )
+                {
+                    // Jxx Left, Right, True
+
+                    int iTrueJumpTargetIndex = GetNextJumpTargetIndex ();
+
+                    EmitBinaryOperands ( pExpr, FALSE, & LeftOp, & RightOp );
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, GetRelationalInstr ( pExpr->iOpType ) );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, LeftOp );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, RightOp );
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
+
+                    EmitBoolResult ( iTrueJumpTargetIndex );
+                }
+                else if ( IsOpLogical ( pExpr->iOpType ) )
+                {
+                    // Both operands are always evaluated, and each is compared against zero
+
+                    int iFalseJumpTargetIndex = GetNextJumpTargetIndex (),
+                        iTrueJumpTargetIndex = GetNextJumpTargetIndex ();
+
+                    EmitBinaryOperands ( pExpr, FALSE, & LeftOp, & RightOp );
+
+                    // And jumps to the false outcome if either operand is zero, and Or jumps
+                    // to the true outcome if either is nonzero
+
+                    int iJumpInstr,
+                        iJumpTargetIndex;
+
+                    if ( pExpr->iOpType == OP_TYPE_LOGICAL_AND )
+                    {
+                        iJumpInstr = INSTR_JE;
+                        iJumpTargetIndex = iFalseJumpTargetIndex;
+                    }
+                    else
+                    {
+                        iJumpInstr = INSTR_JNE;
+                        iJumpTargetIndex = iTrueJumpTargetIndex;
+                    }
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, iJumpInstr );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, LeftOp );
+                    AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iJumpTargetIndex );
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, iJumpInstr );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, RightOp );
+                    AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iJumpTargetIndex );
+
+                    // For And, falling through means true; for Or, it means false
+
+                    if ( pExpr->iOpType == OP_TYPE_LOGICAL_AND )
+                    {
+                        // Jmp True
+
+                        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+                        AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
+
+                        // L0: (False)
+
+                        AddICodeJumpTarget ( g_pContext->iCurrScope, iFalseJumpTargetIndex );
+                    }
+
+                    EmitBoolResult ( iTrueJumpTargetIndex );
+                }
+                else
+                {
+                    // Evaluate the left operand into _T0 and apply the operator in place
+
+                    EmitBinaryOperands ( pExpr, TRUE, & LeftOp, & RightOp );
+
+                    if ( pExpr->iOpType == OP_TYPE_CONCAT )
+                        RightOp = EmitConcatSourceOp ( RightOp );
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, GetArithmeticInstr ( pExpr->iOpType ) );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, LeftOp );
+                    AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, RightOp );
+                }
+
+                break;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitFuncCall ()
+    *
+    *   Generates the code for a function call node, leaving the return value in _RetVal.
+    */
+
+    void EmitFuncCall ( ExprNode * pCall )
+    {
+        int iInstrIndex;
+
+        // Small functions are copied into the caller rather than called
+
+        FuncNode * pFunc = GetFuncByIndex ( pCall->iFuncIndex );
+
+        if ( IsFuncInlineable ( pFunc ) )
+        {
+            EmitInlineFuncCall ( pCall );
+            return;
+        }
+
+        // Push each parameter from left to right
+
+        for ( LinkedListNode * pNode = pCall->ParamList.pHead; pNode; pNode = pNode->pNext )
+        {
+            ExprNode * pParam = ( ExprNode * ) pNode->pData;
+
+            Op Value = EmitExprAsOp ( pParam );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_PUSH );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+        }
+
+        // Call the function, but make sure the right call instruction is used
+
+        int iCallInstr = INSTR_CALL;
+        if ( pFunc->iIsHostAPI )
+            iCallInstr = INSTR_CALLHOST;
+
+        iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, iCallInstr );
+        AddFuncICodeOp ( g_pContext->iCurrScope, iInstrIndex, pFunc->iIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitIntrinsicCall ()
+    *
+    *   Generates the code for an intrinsic call node, leaving the result, if there is one, in
+    *   _T0. Each intrinsic is a single instruction, except for vlen (), which is the square
+    *   root of a vector's dot product with itself.
+    */
+
+    void EmitIntrinsicCall ( ExprNode * pCall )
+    {
+        int iInstrIndex;
+
+        Intrinsic * pIntrinsic = & g_Intrinsics [ pCall->iIntrinsicIndex ];
+
+        // Gather the parameters
+
+        ExprNode * ppParams [ MAX_INTRINSIC_PARAM_COUNT ];
+        int iParamCount = 0;
+
+        for ( LinkedListNode * pNode = pCall->ParamList.pHead; pNode; pNode = pNode->pNext )
+            ppParams [ iParamCount ++ ] = ( ExprNode * ) pNode->pData;
+
+        switch ( pIntrinsic->iOpcode )
+        {
+            // Functions of one scalar
+
+            case INSTR_SQRT:
+            case INSTR_SIN:
+            case INSTR_COS:
+            case INSTR_ABS:
+            {
+                // Op _T0, Value
+
+                Op Value = EmitExprAsOp ( ppParams [ 0 ] );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, pIntrinsic->iOpcode );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+                break;
+            }
+
+            // Functions of two scalars, which are evaluated just like a binary operator's
+            // operands
+
+            case INSTR_ATAN2:
+            case INSTR_MIN:
+            case INSTR_MAX:
+            {
+                // Op _T0, Left, Right
+
+                ExprNode Operands;
+                Operands.pLeft = ppParams [ 0 ];
+                Operands.pRight = ppParams [ 1 ];
+
+                Op LeftOp,
+                   RightOp;
+                EmitBinaryOperands ( & Operands, FALSE, & LeftOp, & RightOp );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, pIntrinsic->iOpcode );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, LeftOp );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, RightOp );
+                break;
+            }
+
+            // Vector arithmetic, whose vectors are always direct
+
+            case INSTR_VADD:
+            case INSTR_VSUB:
+            case INSTR_VSCALE:
+            {
+                // Op Dest, Source, Size
+
+                Op Source;
+                if ( pIntrinsic->iOpcode == INSTR_VSCALE )
+                    Source = EmitExprAsOp ( ppParams [ 1 ] );
+                else
+                    Source = GetExprDirectOp ( ppParams [ 1 ] );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, pIntrinsic->iOpcode );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, GetExprDirectOp ( ppParams [ 0 ] ) );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Source );
+                AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, ppParams [ 2 ]->iIntLiteral );
+                break;
+            }
+
+            // Dot products and lengths
+
+            case INSTR_VDOT:
+            {
+                // VDot _T0, Source0, Source1, Size
+
+                ExprNode * pSource1 = iParamCount == 3 ? ppParams [ 1 ] : ppParams [ 0 ];
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_VDOT );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, GetExprDirectOp ( ppParams [ 0 ] ) );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, GetExprDirectOp ( pSource1 ) );
+                AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, ppParams [ iParamCount - 1 ]->iIntLiteral );
+
+                // Sqrt _T0, _T0 (vlen () only)
+
+                if ( iParamCount == 2 )
+                {
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_SQRT );
+                    AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                    AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, g_pContext->iTempVar0SymbolIndex );
+                }
+
+                break;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   IsFuncInlineable ()
+    *
+    *   Determines whether calls to a function can be replaced with a copy of its body. It has
+    *   to be a completely parsed script function other than _Main () that doesn't call itself,
+    *   has no local arrays, isn't declared noinline, and is within the inlining threshold.
+    */
+
+    int IsFuncInlineable ( FuncNode * pFunc )
+    {
+        // Make sure inlining is enabled and we're inside a function to inline into
+
+        if ( ! g_iInlineThreshold || g_pContext->iCurrScope == SCOPE_GLOBAL )
+            return FALSE;
+
+        // Host API functions, functions declared noinline and the function currently being
+        // parsed can't be inlined
+
+        if ( pFunc->iIsHostAPI || ! pFunc->iIsInlineable || pFunc->iIndex == g_pContext->iCurrScope )
+            return FALSE;
+
+        // Neither can _Main (), since its returns exit the script
+
+        if ( g_pContext->ScriptHeader.iIsMainFuncPresent &&
+             g_pContext->ScriptHeader.iMainFuncIndex == pFunc->iIndex )
+            return FALSE;
+
+        // Rule out functions with local arrays, since every call site would grow the
+        // caller's stack frame by the array's size
+
+        LinkedListNode * pNode = g_pContext->SymbolTable.pHead;
+
+        int iCurrNode;
+
+        for ( iCurrNode = 0; iCurrNode < g_pContext->SymbolTable.iNodeCount; ++ iCurrNode )
+        {
+            SymbolNode * pSymbol = ( SymbolNode * ) pNode->pData;
+
+            if ( pSymbol->iScope == pFunc->iIndex && pSymbol->iSize > 1 )
+                return FALSE;
+
+            pNode = pNode->pNext;
+        }
+
+        // Count the function's instructions, ruling it out if it's recursive
+
+        int iInstrCount = 0;
+
+        pNode = pFunc->ICodeStream.pHead;
+
+        for ( iCurrNode = 0; iCurrNode < pFunc->ICodeStream.iNodeCount; ++ iCurrNode )
+        {
+            ICodeNode * pICodeNode = ( ICodeNode * ) pNode->pData;
+
+            if ( pICodeNode->iType == ICODE_NODE_INSTR )
+            {
+                ++ iInstrCount;
+
+                if ( pICodeNode->Instr.iOpcode == INSTR_CALL &&
+                     GetICodeOpByIndex ( pICodeNode, 0 )->iFuncIndex == pFunc->iIndex )
+                    return FALSE;
+            }
+
+            pNode = pNode->pNext;
+        }
+
+        return iInstrCount <= g_iInlineThreshold;
+    }
+
+    /******************************************************************************************
+    *
+    *   IsInstrDestWritten ()
+    *
+    *   Determines whether an instruction writes to its first operand.
+    */
+
+    int IsInstrDestWritten ( int iOpcode )
+    {
+        switch ( iOpcode )
+        {
+            case INSTR_JMP:
+            case INSTR_JE:
+            case INSTR_JNE:
+            case INSTR_JG:
+            case INSTR_JL:
+            case INSTR_JGE:
+            case INSTR_JLE:
+            case INSTR_JTAB:
+            case INSTR_PUSH:
+            case INSTR_CALL:
+            case INSTR_RET:
+            case INSTR_CALLHOST:
+            case INSTR_PAUSE:
+            case INSTR_YIELD:
+            case INSTR_EXIT:
+                return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetInlineSymbol ()
+    *
+    *   Returns the index of the variable in the current scope that stands in for one of an
+    *   inlined function's parameters or locals, creating it if necessary. It's named
+    *   _I<Depth>_<Function>_<Identifier>, where the depth counts the calls to the same
+    *   function currently being inlined, so that a call nested in another's parameters gets
+    *   its own copies while sequential calls share them.
+    */
+
+    int GetInlineSymbol ( FuncNode * pFunc, int iDepth, SymbolNode * pSymbol )
+    {
+        // Build the identifier, falling back to indices if the names are too long
+
+        char pstrIdent [ MAX_IDENT_SIZE * 2 + 32 ];
+        sprintf ( pstrIdent, "_I%d_%s_%s", iDepth, pFunc->pstrName, pSymbol->pstrIdent );
+
+        if ( strlen ( pstrIdent ) >= MAX_IDENT_SIZE )
+            sprintf ( pstrIdent, "_I%d_%d_%d", iDepth, pFunc->iIndex, pSymbol->iIndex );
+
+        // Reuse the variable if an earlier call already created it
+
+        SymbolNode * pInlineSymbol = GetSymbolByIdent ( pstrIdent, g_pContext->iCurrScope );
+
+        if ( pInlineSymbol )
+            return pInlineSymbol->iIndex;
+
+        return AddSymbol ( pstrIdent, pSymbol->iSize, g_pContext->iCurrScope, SYMBOL_TYPE_VAR );
+    }
+
+    /******************************************************************************************
+    *
+    *   IsInlineParamSubst ()
+    *
+    *   Determines whether a parameter's value can be substituted directly for the parameter
+    *   throughout an inlined function's code, rather than being moved into a variable. That's
+    *   only safe if the function never assigns to the parameter and nothing it does can change
+    *   the value, so it has to be a literal or one of the caller's own variables. Parameters
+    *   used as array indices can only be replaced with integers or variables, and those used
+    *   as the source of Concat only with strings or variables.
+    */
+
+    int IsInlineParamSubst ( Op Value, int iParamUsage )
+    {
+        if ( iParamUsage & INLINE_PARAM_WRITTEN )
+            return FALSE;
+
+        switch ( Value.iType )
+        {
+            case OP_TYPE_INT:
+                return ! ( iParamUsage & INLINE_PARAM_CONCAT );
+
+            case OP_TYPE_FLOAT:
+                return ! ( iParamUsage & ( INLINE_PARAM_INDEX | INLINE_PARAM_CONCAT ) );
+
+            case OP_TYPE_STRING_INDEX:
+                return ! ( iParamUsage & INLINE_PARAM_INDEX );
+
+            case OP_TYPE_VAR:
+                return GetSymbolByIndex ( Value.iSymbolIndex )->iScope == g_pContext->iCurrScope;
+        }
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitInlineFuncCall ()
+    *
+    *   Generates the code for a function call node by copying the function's I-code into the
+    *   current function, leaving the return value in _RetVal just like a real call would.
+    *   The function's locals and parameters are renamed into the caller's scope, its jump
+    *   targets are renumbered, and its returns become jumps past the end of the copy.
+    */
+
+    void EmitInlineFuncCall ( ExprNode * pCall )
+    {
+        int iInstrIndex;
+
+        FuncNode * pFunc = GetFuncByIndex ( pCall->iFuncIndex );
+
+        int iDepth = pFunc->iInlineDepth ++;
+
+        // ---- Map the function's locals to variables in the current scope, and find its
+        //      parameters
+
+        // Only the symbols that exist now can appear in the function's code
+
+        int iSymbolCount = g_pContext->SymbolTable.iNodeCount;
+
+        int * piSymbolMap = ( int * ) malloc ( iSymbolCount * sizeof ( int ) );
+        int * piParamIndices = ( int * ) malloc ( iSymbolCount * sizeof ( int ) );
+
+        // The parameters were added to the symbol table in reverse order
+
+        int piParamSymbols [ MAX_FUNC_DECLARE_PARAM_COUNT ];
+        int iParamIndex = pFunc->iParamCount;
+
+        LinkedListNode * pNode = g_pContext->SymbolTable.pHead;
+
+        int iCurrSymbol;
+
+        for ( iCurrSymbol = 0; iCurrSymbol < iSymbolCount; ++ iCurrSymbol )
+        {
+            SymbolNode * pSymbol = ( SymbolNode * ) pNode->pData;
+
+            // Symbols outside the function's scope map to themselves
+
+            piSymbolMap [ iCurrSymbol ] = iCurrSymbol;
+            piParamIndices [ iCurrSymbol ] = -1;
+
+            if ( pSymbol->iScope == pFunc->iIndex )
+            {
+                if ( pSymbol->iType == SYMBOL_TYPE_PARAM )
+                {
+                    -- iParamIndex;
+                    piParamSymbols [ iParamIndex ] = iCurrSymbol;
+                    piParamIndices [ iCurrSymbol ] = iParamIndex;
+                }
+                else
+                {
+                    piSymbolMap [ iCurrSymbol ] = GetInlineSymbol ( pFunc, iDepth, pSymbol );
+                }
+            }
+
+            pNode = pNode->pNext;
+        }
+
+        // ---- Find the range of the function's jump targets and its last instruction, and
+        //      see how it uses its parameters
+
+        int piParamUsage [ MAX_FUNC_DECLARE_PARAM_COUNT ];
+
+        for ( iParamIndex = 0; iParamIndex < pFunc->iParamCount; ++ iParamIndex )
+            piParamUsage [ iParamIndex ] = 0;
+
+        int iMinJumpTargetIndex = -1,
+            iMaxJumpTargetIndex = -1;
+        int iLastInstrNode = -1;
+
+        int iCurrNode;
+        int iCurrOpIndex;
+
+        pNode = pFunc->ICodeStream.pHead;
+
+        for ( iCurrNode = 0; iCurrNode < pFunc->ICodeStream.iNodeCount; ++ iCurrNode )
+        {
+            ICodeNode * pICodeNode = ( ICodeNode * ) pNode->pData;
+
+            if ( pICodeNode->iType == ICODE_NODE_JUMP_TARGET )
+            {
+                if ( iMinJumpTargetIndex == -1 || pICodeNode->iJumpTargetIndex < iMinJumpTargetIndex )
+                    iMinJumpTargetIndex = pICodeNode->iJumpTargetIndex;
+                if ( pICodeNode->iJumpTargetIndex > iMaxJumpTargetIndex )
+                    iMaxJumpTargetIndex = pICodeNode->iJumpTargetIndex;
+            }
+            else if ( pICodeNode->iType == ICODE_NODE_INSTR )
+            {
+                iLastInstrNode = iCurrNode;
+
+                for ( iCurrOpIndex = 0; iCurrOpIndex < pICodeNode->Instr.OpList.iNodeCount; ++ iCurrOpIndex )
+                {
+                    Op * pOp = GetICodeOpByIndex ( pICodeNode, iCurrOpIndex );
+
+                    // Every instruction that writes to an operand writes to the first one
+
+                    if ( iCurrOpIndex == 0 && pOp->iType == OP_TYPE_VAR &&
+                         piParamIndices [ pOp->iSymbolIndex ] != -1 &&
+                         IsInstrDestWritten ( pICodeNode->Instr.iOpcode ) )
+                        piParamUsage [ piParamIndices [ pOp->iSymbolIndex ] ] |= INLINE_PARAM_WRITTEN;
+
+                    if ( pOp->iType == OP_TYPE_ARRAY_INDEX_VAR &&
+                         piParamIndices [ pOp->iOffsetSymbolIndex ] != -1 )
+                        piParamUsage [ piParamIndices [ pOp->iOffsetSymbolIndex ] ] |= INLINE_PARAM_INDEX;
+
+                    if ( iCurrOpIndex == 1 && pOp->iType == OP_TYPE_VAR &&
+                         piParamIndices [ pOp->iSymbolIndex ] != -1 &&
+                         pICodeNode->Instr.iOpcode == INSTR_CONCAT )
+                        piParamUsage [ piParamIndices [ pOp->iSymbolIndex ] ] |= INLINE_PARAM_CONCAT;
+                }
+            }
+
+            pNode = pNode->pNext;
+        }
+
+        // ---- Evaluate each parameter from left to right, in the same order a real call would
+        //      push them, and either substitute it or move it into its variable
+
+        Op pParamOps [ MAX_FUNC_DECLARE_PARAM_COUNT ];
+        int piIsParamSubst [ MAX_FUNC_DECLARE_PARAM_COUNT ];
+
+        iParamIndex = 0;
+
+        for ( pNode = pCall->ParamList.pHead; pNode; pNode = pNode->pNext )
+        {
+            ExprNode * pParam = ( ExprNode * ) pNode->pData;
+
+            Op Value = EmitExprAsOp ( pParam );
+
+            piIsParamSubst [ iParamIndex ] = IsInlineParamSubst ( Value, piParamUsage [ iParamIndex ] );
+
+            if ( piIsParamSubst [ iParamIndex ] )
+            {
+                pParamOps [ iParamIndex ] = Value;
+            }
+            else
+            {
+                int iParamSymbol = piParamSymbols [ iParamIndex ];
+                piSymbolMap [ iParamSymbol ] = GetInlineSymbol ( pFunc, iDepth, GetSymbolByIndex ( iParamSymbol ) );
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_MOV );
+                AddVarICodeOp ( g_pContext->iCurrScope, iInstrIndex, piSymbolMap [ iParamSymbol ] );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+            }
+
+            ++ iParamIndex;
+        }
+
+        // ---- Allocate a block of new jump targets to renumber the function's into
+
+        int iJumpTargetBase = 0;
+
+        if ( iMinJumpTargetIndex != -1 )
+        {
+            iJumpTargetBase = GetNextJumpTargetIndex ();
+            for ( int iCurrTarget = iMinJumpTargetIndex; iCurrTarget < iMaxJumpTargetIndex; ++ iCurrTarget )
+                GetNextJumpTargetIndex ();
+        }
+
+        int iEndJumpTargetIndex = -1;
+
+        // ---- Copy the function's code
+
+        pNode = pFunc->ICodeStream.pHead;
+
+        for ( iCurrNode = 0; iCurrNode < pFunc->ICodeStream.iNodeCount; ++ iCurrNode )
+        {
+            ICodeNode * pICodeNode = ( ICodeNode * ) pNode->pData;
+
+            switch ( pICodeNode->iType )
+            {
+                // Renumber jump targets
+
+                case ICODE_NODE_JUMP_TARGET:
+                    AddICodeJumpTarget ( g_pContext->iCurrScope, iJumpTargetBase + pICodeNode->iJumpTargetIndex - iMinJumpTargetIndex );
+                    break;
+
+                // Copy instructions
+
+                case ICODE_NODE_INSTR:
+                {
+                    // A return becomes a jump to the end of the copy, unless it's the last
+                    // instruction and control would get there anyway
+
+                    if ( pICodeNode->Instr.iOpcode == INSTR_RET )
+                    {
+                        if ( iCurrNode != iLastInstrNode )
+                        {
+                            if ( iEndJumpTargetIndex == -1 )
+                                iEndJumpTargetIndex = GetNextJumpTargetIndex ();
+
+                            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+                            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iEndJumpTargetIndex );
+                        }
+                        break;
+                    }
+
+                    iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, pICodeNode->Instr.iOpcode );
+
+                    // Copy each operand, renaming its variables and jump targets
+
+                    for ( iCurrOpIndex = 0; iCurrOpIndex < pICodeNode->Instr.OpList.iNodeCount; ++ iCurrOpIndex )
+                    {
+                        Op Value = * GetICodeOpByIndex ( pICodeNode, iCurrOpIndex );
+
+                        switch ( Value.iType )
+                        {
+                            case OP_TYPE_VAR:
+                                iParamIndex = piParamIndices [ Value.iSymbolIndex ];
+                                if ( iParamIndex != -1 && piIsParamSubst [ iParamIndex ] )
+                                    Value = pParamOps [ iParamIndex ];
+                                else
+                                    Value.iSymbolIndex = piSymbolMap [ Value.iSymbolIndex ];
+                                break;
+
+                            case OP_TYPE_ARRAY_INDEX_ABS:
+                                Value.iSymbolIndex = piSymbolMap [ Value.iSymbolIndex ];
+                                break;
+
+                            case OP_TYPE_ARRAY_INDEX_VAR:
+                            {
+                                Value.iSymbolIndex = piSymbolMap [ Value.iSymbolIndex ];
+
+                                // A substituted integer index makes the index absolute
+
+                                iParamIndex = piParamIndices [ Value.iOffsetSymbolIndex ];
+                                if ( iParamIndex != -1 && piIsParamSubst [ iParamIndex ] )
+                                {
+                                    if ( pParamOps [ iParamIndex ].iType == OP_TYPE_INT )
+                                    {
+                                        Value.iType = OP_TYPE_ARRAY_INDEX_ABS;
+                                        Value.iOffset = pParamOps [ iParamIndex ].iIntLiteral;
+                                    }
+                                    else
+                                    {
+                                        Value.iOffsetSymbolIndex = pParamOps [ iParamIndex ].iSymbolIndex;
+                                    }
+                                }
+                                else
+                                {
+                                    Value.iOffsetSymbolIndex = piSymbolMap [ Value.iOffsetSymbolIndex ];
+                                }
+                                break;
+                            }
+
+                            case OP_TYPE_JUMP_TARGET_INDEX:
+                                Value.iJumpTargetIndex = iJumpTargetBase + Value.iJumpTargetIndex - iMinJumpTargetIndex;
+                                break;
+                        }
+
+                        AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+                    }
+
+                    break;
+                }
+
+                // Source line annotations are left behind, since the call site's line is
+                // already annotated
+            }
+
+            pNode = pNode->pNext;
+        }
+
+        // Mark the end of the copy if any returns jump to it
+
+        if ( iEndJumpTargetIndex != -1 )
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iEndJumpTargetIndex );
+
+        ++ g_pContext->iInlinedCallCount;
+
+        // Free the maps and allow this depth to be used again
+
+        free ( piSymbolMap );
+        free ( piParamIndices );
+
+        -- pFunc->iInlineDepth;
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitCondJump ()
+    *
+    *   Generates a jump to the specified target that's taken when an expression evaluates to
+    *   false.
+    */
+
+    void EmitCondJump ( ExprNode * pExpr, int iFalseJumpTargetIndex )
+    {
+        int iInstrIndex;
+
+        if ( pExpr->iType == EXPR_NODE_BINARY_OP && IsOpRelational ( pExpr->iOpType ) )
+        {
+            // Relational conditions jump on the comparison itself rather than materializing
+            // its 0 or 1 first
+
+            Op LeftOp,
+               RightOp;
+
+            int iTrueJumpTargetIndex = GetNextJumpTargetIndex ();
+
+            EmitBinaryOperands ( pExpr, FALSE, & LeftOp, & RightOp );
+
+            // Jxx Left, Right, True
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, GetRelationalInstr ( pExpr->iOpType ) );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, LeftOp );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, RightOp );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iTrueJumpTargetIndex );
+
+            // Jmp False
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iFalseJumpTargetIndex );
+
+            // L0: (True)
+
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iTrueJumpTargetIndex );
+        }
+        else
+        {
+            // JE Expr, 0, False
+
+            Op Value = EmitExprAsOp ( pExpr );
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JE );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+            AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, 0 );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iFalseJumpTargetIndex );
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareSwitchCases ()
+    *
+    *   Orders two switch cases by value, for qsort ().
+    */
+
+    int CompareSwitchCases ( const void * pCase0, const void * pCase1 )
+    {
+        int iValue0 = ( ( SwitchCase * ) pCase0 )->iValue,
+            iValue1 = ( ( SwitchCase * ) pCase1 )->iValue;
+
+        if ( iValue0 < iValue1 )
+            return -1;
+        if ( iValue0 > iValue1 )
+            return 1;
+        return 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   IsSwitchRangeDense ()
+    *
+    *   Determines whether a run of sorted cases is worth a jump table: there have to be
+    *   enough of them, the table can't be too big, and enough of its entries have to be
+    *   cases rather than gaps. Older executables can't hold jump tables at all.
+    */
+
+    int IsSwitchRangeDense ( SwitchCase * pCases, int iCaseCount )
+    {
+        if ( g_iIsLegacyXSE || iCaseCount < MIN_JUMP_TABLE_CASE_COUNT )
+            return FALSE;
+
+        // The span is computed unsigned so values at opposite ends of the integer range
+        // can't overflow it
+
+        unsigned int iSpan = ( unsigned int ) pCases [ iCaseCount - 1 ].iValue - ( unsigned int ) pCases [ 0 ].iValue;
+
+        if ( iSpan >= MAX_JUMP_TABLE_SIZE )
+            return FALSE;
+
+        return iCaseCount * 100 >= ( int ) ( iSpan + 1 ) * MIN_JUMP_TABLE_DENSITY;
+    }
+
+    /******************************************************************************************
+    *
+    *   EmitSwitchSearch ()
+    *
+    *   Emits the code that sends a switch statement's value to the matching case in a run of
+    *   sorted cases, or to the default target if none of them match. Dense runs use a jump
+    *   table and short runs are tested one case at a time. Anything else is split in two,
+    *   at the widest gap between cases if that separates a dense cluster from the rest, or
+    *   around the middle case otherwise, so that each cluster gets its own jump table while
+    *   sparse cases are still found by binary search.
+    */
+
+    void EmitSwitchSearch ( Op Value, SwitchCase * pCases, int iCaseCount, int iDefaultTargetIndex )
+    {
+        int iInstrIndex;
+        int iCurrCaseIndex;
+
+        if ( IsSwitchRangeDense ( pCases, iCaseCount ) )
+        {
+            // JTab Value, Base, Default, Entries...
+
+            int iBase = pCases [ 0 ].iValue;
+            int iSize = pCases [ iCaseCount - 1 ].iValue - iBase + 1;
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JTAB );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+            AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, iBase );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iDefaultTargetIndex );
+
+            // Values between the cases go to the default target
+
+            iCurrCaseIndex = 0;
+            for ( int iCurrEntryIndex = 0; iCurrEntryIndex < iSize; ++ iCurrEntryIndex )
+            {
+                if ( pCases [ iCurrCaseIndex ].iValue == iBase + iCurrEntryIndex )
+                {
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iCurrCaseIndex ].iJumpTargetIndex );
+                    ++ iCurrCaseIndex;
+                }
+                else
+                {
+                    AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iDefaultTargetIndex );
+                }
+            }
+        }
+        else if ( iCaseCount <= MAX_LINEAR_CASE_COUNT )
+        {
+            // JE Value, Case, Target for each case
+
+            for ( iCurrCaseIndex = 0; iCurrCaseIndex < iCaseCount; ++ iCurrCaseIndex )
+            {
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JE );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+                AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iCurrCaseIndex ].iValue );
+                AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iCurrCaseIndex ].iJumpTargetIndex );
+            }
+
+            // Jmp Default
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JMP );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iDefaultTargetIndex );
+        }
+        else
+        {
+            int iLowerTargetIndex = GetNextJumpTargetIndex ();
+
+            // Find the widest gap between two cases
+
+            int iGapCaseIndex = 1;
+            for ( iCurrCaseIndex = 2; iCurrCaseIndex < iCaseCount; ++ iCurrCaseIndex )
+                if ( ( unsigned int ) pCases [ iCurrCaseIndex ].iValue - ( unsigned int ) pCases [ iCurrCaseIndex - 1 ].iValue >
+                     ( unsigned int ) pCases [ iGapCaseIndex ].iValue - ( unsigned int ) pCases [ iGapCaseIndex - 1 ].iValue )
+                    iGapCaseIndex = iCurrCaseIndex;
+
+            if ( IsSwitchRangeDense ( pCases, iGapCaseIndex ) ||
+                 IsSwitchRangeDense ( & pCases [ iGapCaseIndex ], iCaseCount - iGapCaseIndex ) )
+            {
+                // JL Value, Upper, Lower
+
+                iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JL );
+                AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+                AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iGapCaseIndex ].iValue );
+                AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iLowerTargetIndex );
+
+                // Search the cases above the gap, then the ones below it
+
+                EmitSwitchSearch ( Value, & pCases [ iGapCaseIndex ], iCaseCount - iGapCaseIndex, iDefaultTargetIndex );
+
+                AddICodeJumpTarget ( g_pContext->iCurrScope, iLowerTargetIndex );
+
+                EmitSwitchSearch ( Value, pCases, iGapCaseIndex, iDefaultTargetIndex );
+
+                return;
+            }
+
+            int iMidCaseIndex = iCaseCount / 2;
+
+            // JE Value, Middle, Target
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JE );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+            AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iMidCaseIndex ].iValue );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iMidCaseIndex ].iJumpTargetIndex );
+
+            // JL Value, Middle, Lower
+
+            iInstrIndex = AddICodeInstr ( g_pContext->iCurrScope, INSTR_JL );
+            AddICodeOp ( g_pContext->iCurrScope, iInstrIndex, Value );
+            AddIntICodeOp ( g_pContext->iCurrScope, iInstrIndex, pCases [ iMidCaseIndex ].iValue );
+            AddJumpTargetICodeOp ( g_pContext->iCurrScope, iInstrIndex, iLowerTargetIndex );
+
+            // Search the upper half, then the lower half. Neither falls through.
+
+            EmitSwitchSearch ( Value, & pCases [ iMidCaseIndex + 1 ], iCaseCount - iMidCaseIndex - 1, iDefaultTargetIndex );
+
+            AddICodeJumpTarget ( g_pContext->iCurrScope, iLowerTargetIndex );
+
+            EmitSwitchSearch ( Value, pCases, iMidCaseIndex, iDefaultTargetIndex );
+        }
     }
\ No newline at end of file
@@ -25,6 +25,8 @@
 
     #include "xsc.h"
     #include "lexer.h"
+    #include "i_code.h"
+    #include "symbol_table.h"
     
 // ---- Constants -----------------------------------------------------------------------------
 
@@ -32,13 +34,85 @@
                                                         // that can appear in a function
                                                         // declaration.
 
+    #define DEFAULT_INLINE_THRESHOLD            40      // The default size limit, in I-code
+                                                        // instructions, of inlined functions
+
+    // ---- Switch Lowering -------------------------------------------------------------------
+
+        #define MIN_JUMP_TABLE_CASE_COUNT   4           // The fewest cases worth a jump table
+        #define MAX_JUMP_TABLE_SIZE         256         // The most entries in a jump table
+        #define MIN_JUMP_TABLE_DENSITY      50          // The lowest percentage of a jump
+                                                        // table's entries that must be cases
+
+        #define MAX_LINEAR_CASE_COUNT       3           // The most cases tested one by one
+                                                        // rather than by binary search
+
+    // ---- Intrinsics ------------------------------------------------------------------------
+
+        #define MAX_VECTOR_SIZE             16          // The most elements a vector
+                                                        // intrinsic can work on
+
+        #define MAX_INTRINSIC_PARAM_COUNT   3           // The most parameters an intrinsic
+                                                        // accepts
+
+        #define INTRINSIC_PARAM_SCALAR      's'         // An expression
+        #define INTRINSIC_PARAM_VECTOR      'v'         // An array, optionally indexed to
+                                                        // start the vector at an element
+        #define INTRINSIC_PARAM_SIZE        'n'         // The vector's element count, as an
+                                                        // integer literal
+
+    // ---- Inlined Parameter Usage -----------------------------------------------------------
+
+        #define INLINE_PARAM_WRITTEN    1               // The function assigns to it
+        #define INLINE_PARAM_INDEX      2               // The function uses it as an array
+                                                        // index
+        #define INLINE_PARAM_CONCAT     4               // The function uses it as the source
+                                                        // of Concat
+
+    // ---- Expression Tree Node Types --------------------------------------------------------
+
+        #define EXPR_NODE_INT           0               // Integer literal
+        #define EXPR_NODE_FLOAT         1               // Float literal
+        #define EXPR_NODE_STRING        2               // String literal
+        #define EXPR_NODE_VAR           3               // Variable
+        #define EXPR_NODE_ARRAY         4               // Array element
+        #define EXPR_NODE_FUNC_CALL     5               // Function call
+        #define EXPR_NODE_UNARY_OP      6               // Unary operator
+        #define EXPR_NODE_BINARY_OP     7               // Binary operator
+        #define EXPR_NODE_INTRINSIC     8               // Intrinsic call
+
 // ---- Data Structures -----------------------------------------------------------------------
 
-    typedef struct _Expr                                // Expression instance
+    typedef struct _ExprNode                            // An expression tree node
+    {
+        int iType;                                      // The node type
+        union                                           // The value
+        {
+            int iIntLiteral;                            // Integer literal
+            float fFloatLiteral;                        // Float literal
+            int iStringIndex;                           // String table index
+            int iSymbolIndex;                           // Variable or array symbol index
+            int iFuncIndex;                             // Called function index
+            int iIntrinsicIndex;                        // Called intrinsic index
+            int iOpType;                                // Operator type
+        };
+        _ExprNode * pLeft;                              // Left operand, unary operand or
+                                                        // array index
+        _ExprNode * pRight;                             // Right operand
+        LinkedList ParamList;                           // Function and intrinsic call
+                                                        // parameters
+        int iContainsCall;                              // Does the subtree call a function?
+    }
+        ExprNode;
+
+    typedef struct _Intrinsic                           // A builtin math function
     {
-        int iStackOffset;                               // The current offset of the stack
+        char * pstrName;                                // The name scripts call it by
+        int iOpcode;                                    // The instruction that implements it
+        char * pstrParams;                              // The kind of each parameter
+        int iHasResult;                                 // Does it produce a value?
     }
-        Expr;
+        Intrinsic;
 
     typedef struct Loop                                 // Loop instance
     {
@@ -47,6 +121,17 @@
     }
         Loop;
 
+    typedef struct _SwitchCase                          // A switch statement's case label
+    {
+        int iValue;                                     // The case value
+        int iJumpTargetIndex;                           // The jump target of its code
+    }
+        SwitchCase;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    extern int g_iInlineThreshold;
+
 // ---- Function Prototypes -------------------------------------------------------------------
 
     void ReadToken ( Token ReqToken );
@@ -61,21 +146,55 @@
 
     void ParseVar ();
     void ParseHost ();
-    void ParseFunc ();
+    void ParseFunc ( int iIsInlineable );
 
-    void ParseExpr ();
-    void ParseSubExpr ();
-    void ParseTerm ();
-    void ParseFactor ();
+    ExprNode * ParseExpr ();
+    ExprNode * ParseSubExpr ();
+    ExprNode * ParseTerm ();
+    ExprNode * ParseFactor ();
 
     void ParseIf ();
     void ParseWhile ();
     void ParseFor ();
+    void ParseSwitch ();
     void ParseBreak ();
     void ParseContinue ();
     void ParseReturn ();
+    void ParseYield ();
 
     void ParseAssign ();
-    void ParseFuncCall ();
+    ExprNode * ParseFuncCall ();
+    int GetIntrinsicByName ( char * pstrName );
+    ExprNode * ParseIntrinsicCall ();
+
+    ExprNode * NewExprNode ( int iType );
+    ExprNode * NewUnaryExprNode ( int iOpType, ExprNode * pOperand );
+    ExprNode * NewBinaryExprNode ( int iOpType, ExprNode * pLeft, ExprNode * pRight );
+    void FreeExpr ( ExprNode * pExpr );
+
+    int IsExprDirectIndex ( ExprNode * pIndex );
+    int IsExprDirectOp ( ExprNode * pExpr );
+    Op GetVarOp ( int iSymbolIndex );
+    Op GetArrayOp ( int iArraySymbolIndex, ExprNode * pIndex, int iIndexSymbolIndex );
+    Op GetExprDirectOp ( ExprNode * pExpr );
+
+    void EmitExpr ( ExprNode * pExpr );
+    Op EmitExprAsOp ( ExprNode * pExpr );
+    Op EmitConcatSourceOp ( Op Source );
+    void EmitBinaryOperands ( ExprNode * pExpr, int iLeftInTemp, Op * pLeftOp, Op * pRightOp );
+    void EmitBoolResult ( int iTrueJumpTargetIndex );
+    int GetRelationalInstr ( int iOpType );
+    int GetArithmeticInstr ( int iOpType );
+    void EmitFuncCall ( ExprNode * pCall );
+    void EmitIntrinsicCall ( ExprNode * pCall );
+    int IsFuncInlineable ( FuncNode * pFunc );
+    int IsInstrDestWritten ( int iOpcode );
+    int GetInlineSymbol ( FuncNode * pFunc, int iDepth, SymbolNode * pSymbol );
+    int IsInlineParamSubst ( Op Value, int iParamUsage );
+    void EmitInlineFuncCall ( ExprNode * pCall );
+    void EmitCondJump ( ExprNode * pExpr, int iFalseJumpTargetIndex );
+    int CompareSwitchCases ( const void * pCase0, const void * pCase1 );
+    int IsSwitchRangeDense ( SwitchCase * pCases, int iCaseCount );
+    void EmitSwitchSearch ( Op Value, SwitchCase * pCases, int iCaseCount, int iDefaultTargetIndex );
 
 #endif
\ No newline at end of file
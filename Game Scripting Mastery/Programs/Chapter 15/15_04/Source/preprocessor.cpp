@@ -21,6 +21,7 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "preprocessor.h"
+    #include "context.h"
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -44,7 +45,7 @@
         // Node to traverse list
 
         LinkedListNode * pNode;
-        pNode = g_SourceCode.pHead;
+        pNode = g_pContext->SourceCode.pHead;
 
         // Traverse the source code
 
@@ -21,6 +21,7 @@
 // ---- Include Files -------------------------------------------------------------------------
 
     #include "symbol_table.h"
+    #include "context.h"
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -35,16 +36,16 @@
     {
         // If the table is empty, return a NULL pointer
 
-        if ( ! g_SymbolTable.iNodeCount )
+        if ( ! g_pContext->SymbolTable.iNodeCount )
             return NULL;
 
         // Create a pointer to traverse the list
 
-        LinkedListNode * pCurrNode = g_SymbolTable.pHead;
+        LinkedListNode * pCurrNode = g_pContext->SymbolTable.pHead;
 
         // Traverse the list until the matching structure is found
 
-        for ( int iCurrNode = 0; iCurrNode < g_SymbolTable.iNodeCount; ++ iCurrNode )
+        for ( int iCurrNode = 0; iCurrNode < g_pContext->SymbolTable.iNodeCount; ++ iCurrNode )
         {
             // Create a pointer to the current symbol structure
 
@@ -80,7 +81,7 @@
 
         // Loop through each symbol in the table to find the match
 
-        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
+        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_pContext->SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
         {
             // Get the current symbol structure
 
@@ -143,7 +144,7 @@
 
         // Add the symbol to the list and get its index
 
-        int iIndex = AddNode ( & g_SymbolTable, pNewSymbol );
+        int iIndex = AddNode ( & g_pContext->SymbolTable, pNewSymbol );
 
 		// Set the symbol node's index
 
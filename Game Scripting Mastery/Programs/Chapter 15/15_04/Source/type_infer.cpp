@@ -0,0 +1,576 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Type inference module
+
+        Works out which types each function's variables hold at each instruction, following
+        the I-code's jumps, and replaces arithmetic and comparisons whose operand types are
+        proven with typed instructions the XVM can run without checking or coercing types.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "type_infer.h"
+    #include "symbol_table.h"
+    #include "func_table.h"
+    #include "context.h"
+
+// ---- Globals -------------------------------------------------------------------------------
+
+    int g_iIsTypeInferenceEnabled = TRUE;               // Should typed instructions be
+                                                        // emitted?
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   GetInferredOpType ()
+    *
+    *   Returns the type an operand is known to hold in the specified state. Only literals
+    *   and tracked variables can be known; array elements and _RetVal could be anything.
+    */
+
+    int GetInferredOpType ( TypeInferFunc * pFunc, TypeState * pState, Op * pOp )
+    {
+        switch ( pOp->iType )
+        {
+            case OP_TYPE_INT:
+                return INFER_TYPE_INT;
+
+            case OP_TYPE_FLOAT:
+                return INFER_TYPE_FLOAT;
+
+            case OP_TYPE_STRING_INDEX:
+                return INFER_TYPE_STRING;
+
+            case OP_TYPE_VAR:
+                return pState->pVarTypes [ pFunc->piVarSlots [ pOp->iSymbolIndex ] ];
+
+            default:
+                return INFER_TYPE_ANY;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   SetInferredOpType ()
+    *
+    *   Records the type written to an operand. Writes to array elements and _RetVal aren't
+    *   tracked.
+    */
+
+    void SetInferredOpType ( TypeInferFunc * pFunc, TypeState * pState, Op * pOp, int iType )
+    {
+        if ( pOp->iType == OP_TYPE_VAR )
+            pState->pVarTypes [ pFunc->piVarSlots [ pOp->iSymbolIndex ] ] = iType;
+    }
+
+    /******************************************************************************************
+    *
+    *   PushInferredType ()
+    *
+    *   Pushes a type onto a state's stack. Once the stack is too deep to track, or its depth
+    *   is unknown, its contents are forgotten.
+    */
+
+    void PushInferredType ( TypeState * pState, int iType )
+    {
+        if ( pState->iStackDepth == INFER_STACK_DEPTH_UNKNOWN )
+            return;
+
+        if ( pState->iStackDepth >= MAX_INFER_STACK_DEPTH )
+        {
+            pState->iStackDepth = INFER_STACK_DEPTH_UNKNOWN;
+            return;
+        }
+
+        pState->pStackTypes [ pState->iStackDepth ] = iType;
+        ++ pState->iStackDepth;
+    }
+
+    /******************************************************************************************
+    *
+    *   PopInferredType ()
+    *
+    *   Pops a type off of a state's stack, returning INFER_TYPE_ANY if it isn't known.
+    */
+
+    int PopInferredType ( TypeState * pState )
+    {
+        if ( pState->iStackDepth <= 0 )
+        {
+            pState->iStackDepth = INFER_STACK_DEPTH_UNKNOWN;
+            return INFER_TYPE_ANY;
+        }
+
+        -- pState->iStackDepth;
+        return pState->pStackTypes [ pState->iStackDepth ];
+    }
+
+    /******************************************************************************************
+    *
+    *   ApplyInstrTypes ()
+    *
+    *   Updates a state with the effects of executing an I-code node.
+    *
+    *   The XVM's arithmetic, bitwise and string instructions never change the type of their
+    *   destination, so only moves, pops, GetChar and the math intrinsics write new types.
+    *   Calls can change any global, as can other coroutines that run while one is suspended
+    *   at a yield, and host API functions pop an unknown number of parameters.
+    */
+
+    void ApplyInstrTypes ( TypeInferFunc * pFunc, ICodeNode * pNode, TypeState * pState )
+    {
+        // Only instructions have any effect
+
+        if ( pNode->iType != ICODE_NODE_INSTR )
+            return;
+
+        int iCurrVarIndex;
+
+        switch ( pNode->Instr.iOpcode )
+        {
+            // The destination takes on the source's type
+
+            case INSTR_MOV:
+                SetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ),
+                                    GetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 1 ) ) );
+                break;
+
+            // The destination always becomes a string
+
+            case INSTR_GETCHAR:
+                SetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ), INFER_TYPE_STRING );
+                break;
+
+            // These intrinsics always produce floats
+
+            case INSTR_SQRT:
+            case INSTR_SIN:
+            case INSTR_COS:
+            case INSTR_ATAN2:
+            case INSTR_VDOT:
+                SetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ), INFER_TYPE_FLOAT );
+                break;
+
+            // Abs produces an integer from an integer and a float from anything else, and so
+            // do Min and Max from their pair of sources
+
+            case INSTR_ABS:
+            case INSTR_MIN:
+            case INSTR_MAX:
+            {
+                int iType = GetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 1 ) );
+
+                if ( pNode->Instr.iOpcode != INSTR_ABS )
+                {
+                    int iOpType2 = GetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 2 ) );
+
+                    if ( iType == INFER_TYPE_INT || iType == INFER_TYPE_ANY )
+                        iType = iOpType2 == INFER_TYPE_INT ? iType : iOpType2;
+                }
+
+                if ( iType == INFER_TYPE_STRING )
+                    iType = INFER_TYPE_FLOAT;
+
+                SetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ), iType );
+                break;
+            }
+
+            // The stack interface
+
+            case INSTR_PUSH:
+                PushInferredType ( pState, GetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ) ) );
+                break;
+
+            case INSTR_POP:
+            {
+                int iType = PopInferredType ( pState );
+                SetInferredOpType ( pFunc, pState, GetICodeOpByIndex ( pNode, 0 ), iType );
+                break;
+            }
+
+            // The function call interface
+
+            case INSTR_CALL:
+            case INSTR_CALLHOST:
+            case INSTR_YIELD:
+            {
+                // Forget the type of every global
+
+                for ( iCurrVarIndex = 0; iCurrVarIndex < pFunc->iVarCount; ++ iCurrVarIndex )
+                    if ( pFunc->piIsVarGlobal [ iCurrVarIndex ] )
+                        pState->pVarTypes [ iCurrVarIndex ] = INFER_TYPE_ANY;
+
+                // Script functions pop their parameters when they return
+
+                if ( pNode->Instr.iOpcode == INSTR_CALL )
+                {
+                    FuncNode * pCallee = GetFuncByIndex ( GetICodeOpByIndex ( pNode, 0 )->iFuncIndex );
+                    for ( int iCurrParamIndex = 0; iCurrParamIndex < pCallee->iParamCount; ++ iCurrParamIndex )
+                        PopInferredType ( pState );
+                }
+                else if ( pNode->Instr.iOpcode == INSTR_CALLHOST )
+                {
+                    pState->iStackDepth = INFER_STACK_DEPTH_UNKNOWN;
+                }
+
+                break;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   MergeTypeState ()
+    *
+    *   Merges a state into the state on entry to another node, where control from more than
+    *   one place can meet. A type that differs between the two becomes INFER_TYPE_ANY.
+    *   Returns TRUE if the destination changed.
+    */
+
+    int MergeTypeState ( TypeInferFunc * pFunc, TypeState * pDest, TypeState * pSource )
+    {
+        int iCurrIndex;
+
+        // If the destination hasn't been reached yet, just copy the source
+
+        if ( ! pDest->iIsReached )
+        {
+            pDest->iIsReached = TRUE;
+            memcpy ( pDest->pVarTypes, pSource->pVarTypes, pFunc->iVarCount );
+            pDest->iStackDepth = pSource->iStackDepth;
+            memcpy ( pDest->pStackTypes, pSource->pStackTypes, MAX_INFER_STACK_DEPTH );
+            return TRUE;
+        }
+
+        int iIsChanged = FALSE;
+
+        // Merge the variables
+
+        for ( iCurrIndex = 0; iCurrIndex < pFunc->iVarCount; ++ iCurrIndex )
+        {
+            if ( pDest->pVarTypes [ iCurrIndex ] != pSource->pVarTypes [ iCurrIndex ] &&
+                 pDest->pVarTypes [ iCurrIndex ] != INFER_TYPE_ANY )
+            {
+                pDest->pVarTypes [ iCurrIndex ] = INFER_TYPE_ANY;
+                iIsChanged = TRUE;
+            }
+        }
+
+        // Merge the stacks, which can only be done element by element if they're the same
+        // depth
+
+        if ( pDest->iStackDepth == INFER_STACK_DEPTH_UNKNOWN )
+            return iIsChanged;
+
+        if ( pDest->iStackDepth != pSource->iStackDepth )
+        {
+            pDest->iStackDepth = INFER_STACK_DEPTH_UNKNOWN;
+            return TRUE;
+        }
+
+        for ( iCurrIndex = 0; iCurrIndex < pDest->iStackDepth; ++ iCurrIndex )
+        {
+            if ( pDest->pStackTypes [ iCurrIndex ] != pSource->pStackTypes [ iCurrIndex ] &&
+                 pDest->pStackTypes [ iCurrIndex ] != INFER_TYPE_ANY )
+            {
+                pDest->pStackTypes [ iCurrIndex ] = INFER_TYPE_ANY;
+                iIsChanged = TRUE;
+            }
+        }
+
+        return iIsChanged;
+    }
+
+    /******************************************************************************************
+    *
+    *   InferFuncTypes ()
+    *
+    *   Infers the types in a single function and replaces the instructions it can with
+    *   typed ones.
+    */
+
+    void InferFuncTypes ( int iFuncIndex )
+    {
+        FuncNode * pFuncNode = GetFuncByIndex ( iFuncIndex );
+
+        if ( pFuncNode->iIsHostAPI || ! pFuncNode->ICodeStream.iNodeCount )
+            return;
+
+        TypeInferFunc Func;
+        int iCurrNodeIndex;
+        int iCurrOpIndex;
+
+        // ---- Index the function's nodes and jump targets
+
+        Func.iNodeCount = pFuncNode->ICodeStream.iNodeCount;
+        Func.ppNodes = ( ICodeNode ** ) malloc ( Func.iNodeCount * sizeof ( ICodeNode * ) );
+        Func.piTargetNodes = ( int * ) malloc ( ( g_pContext->iCurrJumpTargetIndex + 1 ) * sizeof ( int ) );
+
+        LinkedListNode * pCurrNode = pFuncNode->ICodeStream.pHead;
+        for ( iCurrNodeIndex = 0; iCurrNodeIndex < Func.iNodeCount; ++ iCurrNodeIndex )
+        {
+            Func.ppNodes [ iCurrNodeIndex ] = ( ICodeNode * ) pCurrNode->pData;
+
+            if ( Func.ppNodes [ iCurrNodeIndex ]->iType == ICODE_NODE_JUMP_TARGET )
+                Func.piTargetNodes [ Func.ppNodes [ iCurrNodeIndex ]->iJumpTargetIndex ] = iCurrNodeIndex;
+
+            pCurrNode = pCurrNode->pNext;
+        }
+
+        // ---- Give each variable the function uses a slot in the states
+
+        int iSymbolCount = g_pContext->SymbolTable.iNodeCount;
+        Func.piVarSlots = ( int * ) malloc ( ( iSymbolCount + 1 ) * sizeof ( int ) );
+        Func.piIsVarGlobal = ( int * ) malloc ( ( iSymbolCount + 1 ) * sizeof ( int ) );
+        Func.iVarCount = 0;
+
+        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex <= iSymbolCount; ++ iCurrSymbolIndex )
+            Func.piVarSlots [ iCurrSymbolIndex ] = -1;
+
+        for ( iCurrNodeIndex = 0; iCurrNodeIndex < Func.iNodeCount; ++ iCurrNodeIndex )
+        {
+            ICodeNode * pNode = Func.ppNodes [ iCurrNodeIndex ];
+            if ( pNode->iType != ICODE_NODE_INSTR )
+                continue;
+
+            for ( iCurrOpIndex = 0; iCurrOpIndex < pNode->Instr.OpList.iNodeCount; ++ iCurrOpIndex )
+            {
+                Op * pOp = GetICodeOpByIndex ( pNode, iCurrOpIndex );
+                if ( pOp->iType == OP_TYPE_VAR && Func.piVarSlots [ pOp->iSymbolIndex ] == -1 )
+                {
+                    Func.piVarSlots [ pOp->iSymbolIndex ] = Func.iVarCount;
+                    Func.piIsVarGlobal [ Func.iVarCount ] = GetSymbolByIndex ( pOp->iSymbolIndex )->iScope == SCOPE_GLOBAL;
+                    ++ Func.iVarCount;
+                }
+            }
+        }
+
+        // ---- Allocate the states
+
+        Func.pStates = ( TypeState * ) malloc ( Func.iNodeCount * sizeof ( TypeState ) );
+        char * pVarTypes = ( char * ) malloc ( ( Func.iNodeCount + 1 ) * Func.iVarCount + 1 );
+
+        for ( iCurrNodeIndex = 0; iCurrNodeIndex < Func.iNodeCount; ++ iCurrNodeIndex )
+        {
+            Func.pStates [ iCurrNodeIndex ].iIsReached = FALSE;
+            Func.pStates [ iCurrNodeIndex ].pVarTypes = & pVarTypes [ iCurrNodeIndex * Func.iVarCount ];
+        }
+
+        // The last block of variable types is scratch space
+
+        TypeState CurrState;
+        CurrState.pVarTypes = & pVarTypes [ Func.iNodeCount * Func.iVarCount ];
+
+        // Nothing is known on entry, since the function's parameters, locals and globals can
+        // all hold anything
+
+        CurrState.iIsReached = TRUE;
+        memset ( CurrState.pVarTypes, INFER_TYPE_ANY, Func.iVarCount );
+        CurrState.iStackDepth = 0;
+        MergeTypeState ( & Func, & Func.pStates [ 0 ], & CurrState );
+
+        // ---- Propagate the states through the function until they stop changing
+
+        int iIsChanged;
+        do
+        {
+            iIsChanged = FALSE;
+
+            for ( iCurrNodeIndex = 0; iCurrNodeIndex < Func.iNodeCount; ++ iCurrNodeIndex )
+            {
+                if ( ! Func.pStates [ iCurrNodeIndex ].iIsReached )
+                    continue;
+
+                // Apply the node to a copy of its entry state
+
+                ICodeNode * pNode = Func.ppNodes [ iCurrNodeIndex ];
+
+                memcpy ( CurrState.pVarTypes, Func.pStates [ iCurrNodeIndex ].pVarTypes, Func.iVarCount );
+                CurrState.iStackDepth = Func.pStates [ iCurrNodeIndex ].iStackDepth;
+                memcpy ( CurrState.pStackTypes, Func.pStates [ iCurrNodeIndex ].pStackTypes, MAX_INFER_STACK_DEPTH );
+
+                ApplyInstrTypes ( & Func, pNode, & CurrState );
+
+                // Determine where control can go next
+
+                int iIsFallThrough = TRUE;
+                int iTargetNodeIndex = -1;
+
+                if ( pNode->iType == ICODE_NODE_INSTR )
+                {
+                    switch ( pNode->Instr.iOpcode )
+                    {
+                        case INSTR_JMP:
+                            iIsFallThrough = FALSE;
+                            iTargetNodeIndex = Func.piTargetNodes [ GetICodeOpByIndex ( pNode, 0 )->iJumpTargetIndex ];
+                            break;
+
+                        case INSTR_JE:
+                        case INSTR_JNE:
+                        case INSTR_JG:
+                        case INSTR_JL:
+                        case INSTR_JGE:
+                        case INSTR_JLE:
+                            iTargetNodeIndex = Func.piTargetNodes [ GetICodeOpByIndex ( pNode, 2 )->iJumpTargetIndex ];
+                            break;
+
+                        case INSTR_RET:
+                        case INSTR_EXIT:
+                            iIsFallThrough = FALSE;
+                            break;
+
+                        // A jump table can go to its default target (operand 2) or any of its
+                        // entries, which all follow the base
+
+                        case INSTR_JTAB:
+                        {
+                            iIsFallThrough = FALSE;
+
+                            for ( int iCurrOpIndex = 2; iCurrOpIndex < pNode->Instr.OpList.iNodeCount; ++ iCurrOpIndex )
+                            {
+                                int iEntryNodeIndex = Func.piTargetNodes [ GetICodeOpByIndex ( pNode, iCurrOpIndex )->iJumpTargetIndex ];
+                                if ( MergeTypeState ( & Func, & Func.pStates [ iEntryNodeIndex ], & CurrState ) )
+                                    iIsChanged = TRUE;
+                            }
+
+                            break;
+                        }
+                    }
+                }
+
+                // Merge the result into the entry states of the nodes that follow
+
+                if ( iIsFallThrough && iCurrNodeIndex + 1 < Func.iNodeCount )
+                    if ( MergeTypeState ( & Func, & Func.pStates [ iCurrNodeIndex + 1 ], & CurrState ) )
+                        iIsChanged = TRUE;
+
+                if ( iTargetNodeIndex != -1 )
+                    if ( MergeTypeState ( & Func, & Func.pStates [ iTargetNodeIndex ], & CurrState ) )
+                        iIsChanged = TRUE;
+            }
+        }
+        while ( iIsChanged );
+
+        // ---- Replace the instructions whose operand types are proven
+
+        for ( iCurrNodeIndex = 0; iCurrNodeIndex < Func.iNodeCount; ++ iCurrNodeIndex )
+        {
+            ICodeNode * pNode = Func.ppNodes [ iCurrNodeIndex ];
+            TypeState * pState = & Func.pStates [ iCurrNodeIndex ];
+
+            if ( pNode->iType != ICODE_NODE_INSTR || ! pState->iIsReached )
+                continue;
+
+            // Get the types of the first two operands
+
+            int iOpType0 = INFER_TYPE_ANY,
+                iOpType1 = INFER_TYPE_ANY;
+
+            if ( pNode->Instr.OpList.iNodeCount > 0 )
+                iOpType0 = GetInferredOpType ( & Func, pState, GetICodeOpByIndex ( pNode, 0 ) );
+            if ( pNode->Instr.OpList.iNodeCount > 1 )
+                iOpType1 = GetInferredOpType ( & Func, pState, GetICodeOpByIndex ( pNode, 1 ) );
+
+            int iIsInt = iOpType0 == INFER_TYPE_INT && iOpType1 == INFER_TYPE_INT;
+            int iIsFloat = iOpType0 == INFER_TYPE_FLOAT && iOpType1 == INFER_TYPE_FLOAT;
+
+            // Pick the typed instruction, if there is one
+
+            int iTypedOpcode = -1;
+
+            switch ( pNode->Instr.iOpcode )
+            {
+                case INSTR_ADD:
+                    iTypedOpcode = iIsInt ? INSTR_IADD : iIsFloat ? INSTR_FADD : -1;
+                    break;
+
+                case INSTR_SUB:
+                    iTypedOpcode = iIsInt ? INSTR_ISUB : iIsFloat ? INSTR_FSUB : -1;
+                    break;
+
+                case INSTR_MUL:
+                    iTypedOpcode = iIsInt ? INSTR_IMUL : iIsFloat ? INSTR_FMUL : -1;
+                    break;
+
+                case INSTR_DIV:
+                    iTypedOpcode = iIsInt ? INSTR_IDIV : iIsFloat ? INSTR_FDIV : -1;
+                    break;
+
+                case INSTR_MOD:
+                    iTypedOpcode = iIsInt ? INSTR_IMOD : -1;
+                    break;
+
+                case INSTR_INC:
+                    iTypedOpcode = iOpType0 == INFER_TYPE_INT ? INSTR_IINC : -1;
+                    break;
+
+                case INSTR_DEC:
+                    iTypedOpcode = iOpType0 == INFER_TYPE_INT ? INSTR_IDEC : -1;
+                    break;
+
+                case INSTR_JE:
+                    iTypedOpcode = iIsInt ? INSTR_IJE : -1;
+                    break;
+
+                case INSTR_JNE:
+                    iTypedOpcode = iIsInt ? INSTR_IJNE : -1;
+                    break;
+
+                case INSTR_JG:
+                    iTypedOpcode = iIsInt ? INSTR_IJG : -1;
+                    break;
+
+                case INSTR_JL:
+                    iTypedOpcode = iIsInt ? INSTR_IJL : -1;
+                    break;
+
+                case INSTR_JGE:
+                    iTypedOpcode = iIsInt ? INSTR_IJGE : -1;
+                    break;
+
+                case INSTR_JLE:
+                    iTypedOpcode = iIsInt ? INSTR_IJLE : -1;
+                    break;
+            }
+
+            if ( iTypedOpcode != -1 )
+            {
+                pNode->Instr.iOpcode = iTypedOpcode;
+                ++ g_pContext->iTypedInstrCount;
+            }
+        }
+
+        // ---- Free the analysis
+
+        free ( pVarTypes );
+        free ( Func.pStates );
+        free ( Func.piIsVarGlobal );
+        free ( Func.piVarSlots );
+        free ( Func.piTargetNodes );
+        free ( Func.ppNodes );
+    }
+
+    /******************************************************************************************
+    *
+    *   InferTypes ()
+    *
+    *   Runs type inference over every function in the script.
+    */
+
+    void InferTypes ()
+    {
+        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_pContext->FuncTable.iNodeCount; ++ iCurrFuncIndex )
+            InferFuncTypes ( iCurrFuncIndex );
+    }
@@ -0,0 +1,82 @@
+/*
+
+    Project.
+
+        XSC - The XtremeScript Compiler Version 0.8
+
+    Abstract.
+
+        Type inference module header
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+#ifndef XSC_TYPE_INFER
+#define XSC_TYPE_INFER
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xsc.h"
+    #include "i_code.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Inferred Types --------------------------------------------------------------------
+
+        #define INFER_TYPE_NONE         0               // The instruction hasn't been reached
+        #define INFER_TYPE_INT          1               // Always an integer
+        #define INFER_TYPE_FLOAT        2               // Always a float
+        #define INFER_TYPE_STRING       3               // Always a string
+        #define INFER_TYPE_ANY          4               // Could be anything
+
+    #define MAX_INFER_STACK_DEPTH       32              // The most stack elements tracked
+
+    #define INFER_STACK_DEPTH_UNKNOWN   -1              // The stack's contents can't be known
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _TypeState                           // What's known at an instruction
+    {
+        int iIsReached;                                 // Can execution reach it?
+        char * pVarTypes;                               // The type of each tracked variable
+        int iStackDepth;                                // The number of tracked stack elements
+        char pStackTypes [ MAX_INFER_STACK_DEPTH ];     // The type of each stack element
+    }
+        TypeState;
+
+    typedef struct _TypeInferFunc                       // The function being analyzed
+    {
+        int iNodeCount;                                 // The number of I-code nodes
+        ICodeNode ** ppNodes;                           // The I-code nodes, by index
+        int * piTargetNodes;                            // The node of each jump target
+
+        int iVarCount;                                  // The number of tracked variables
+        int * piVarSlots;                               // The slot of each symbol, or -1
+        int * piIsVarGlobal;                            // Is each slot a global?
+
+        TypeState * pStates;                            // The state on entry to each node
+    }
+        TypeInferFunc;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    extern int g_iIsTypeInferenceEnabled;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    int GetInferredOpType ( TypeInferFunc * pFunc, TypeState * pState, Op * pOp );
+    void SetInferredOpType ( TypeInferFunc * pFunc, TypeState * pState, Op * pOp, int iType );
+
+    void PushInferredType ( TypeState * pState, int iType );
+    int PopInferredType ( TypeState * pState );
+
+    void ApplyInstrTypes ( TypeInferFunc * pFunc, ICodeNode * pNode, TypeState * pState );
+    int MergeTypeState ( TypeInferFunc * pFunc, TypeState * pDest, TypeState * pSource );
+
+    void InferFuncTypes ( int iFuncIndex );
+    void InferTypes ();
+
+#endif
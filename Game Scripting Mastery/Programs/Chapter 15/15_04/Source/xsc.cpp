@@ -31,46 +31,22 @@
     #include "lexer.h"
     #include "parser.h"
     #include "i_code.h"
+    #include "type_infer.h"
     #include "code_emit.h"
+    #include "context.h"
+    #include "batch.h"
+    #include "cache.h"
 
 // ---- Globals -------------------------------------------------------------------------------
 
-    // ---- Source Code -----------------------------------------------------------------------
+    // ---- Compiler Context ------------------------------------------------------------------
 
-		char g_pstrSourceFilename [ MAX_FILENAME_SIZE ],	// Source code filename
-		     g_pstrOutputFilename [ MAX_FILENAME_SIZE ];	// Executable filename
-
-        LinkedList g_SourceCode;                        // Source code linked list
-
-    // ---- Script ----------------------------------------------------------------------------
-
-        ScriptHeader g_ScriptHeader;                    // Script header data
-        
-    // ---- I-Code Stream ---------------------------------------------------------------------
-
-        LinkedList g_ICodeStream;                       // I-code stream
-
-    // ---- Function Table --------------------------------------------------------------------
-
-        LinkedList g_FuncTable;                         // The function table
-
-    // ---- Symbol Table ----------------------------------------------------------------------
-
-        LinkedList g_SymbolTable;                       // The symbol table
-
-	// ---- String Table ----------------------------------------------------------------------
-
-		LinkedList g_StringTable;						// The string table
+        __declspec ( thread ) CompilerContext * g_pContext;   // The calling thread's context
 
     // ---- XASM Invocation -------------------------------------------------------------------
 
-        int g_iPreserveOutputFile;                      // Preserve the assembly file?
-        int g_iGenerateXSE;                             // Generate an .XSE executable?
-
-    // ---- Expression Evaluation -------------------------------------------------------------
-
-        int g_iTempVar0SymbolIndex,                     // Temporary variable symbol indices
-            g_iTempVar1SymbolIndex;
+        int g_iIsLegacyXSE = FALSE;                     // Should XASM write version 0.8
+                                                        // executables?
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -99,16 +75,34 @@
     void PrintUsage ()
     {
         printf ( "Usage:\tXSC Source.XSS [Output.XASM] [Options]\n" );
+        printf ( "\tXSC @FileList.txt [Options]\n" );
+        printf ( "\tXSC Directory [Options]\n" );
         printf ( "\n" );
         printf ( "\t-S:Size      Sets the stack size (must be decimal integer value)\n" );
         printf ( "\t-P:Priority  Sets the thread priority: Low, Med, High or timeslice\n" );
         printf ( "\t             duration (must be decimal integer value)\n" );
         printf ( "\t-A           Preserve assembly output file\n" );
         printf ( "\t-N           Don't generate .XSE (preserves assembly output file)\n" );
+        printf ( "\t-J:Count     Sets the number of batch worker threads (one per processor\n" );
+        printf ( "\t             by default)\n" );
+        printf ( "\t-C:Dir       Caches compiled output in the specified directory and reuses\n" );
+        printf ( "\t             it when the preprocessed source, options and tools are\n" );
+        printf ( "\t             unchanged\n" );
+        printf ( "\t-CMAX:Size   Sets the cache size limit in KB (65536 by default)\n" );
+        printf ( "\t-I:Size      Inlines functions of up to this many instructions (40 by\n" );
+        printf ( "\t             default, 0 disables inlining)\n" );
+        printf ( "\t-NT          Don't replace instructions with typed ones where the types\n" );
+        printf ( "\t             of their operands can be inferred\n" );
+        printf ( "\t-NL          Don't emit source line numbers for error reports and\n" );
+        printf ( "\t             profilers\n" );
+        printf ( "\t-XSE0.8      Generate version 0.8 .XSE files, which older XVMs such as\n" );
+        printf ( "\t             Lockdown's can load (switches don't use jump tables)\n" );
         printf ( "\n" );
         printf ( "Notes:\n" );
         printf ( "\t- File extensions are not required.\n" );
         printf ( "\t- Executable name is optional; source name is used by default.\n" );
+        printf ( "\t- A file list names one source file per line. A directory compiles every\n" );
+        printf ( "\t  .XSS file in it. Either one compiles the files in parallel.\n" );
         printf ( "\n" );
     }
 
@@ -121,36 +115,54 @@
 
     void VerifyFilenames ( int argc, char * argv [] )
     {
-        // First make a global copy of the source filename and convert it to uppercase
+        // Was an executable filename specified?
 
-        strcpy ( g_pstrSourceFilename, argv [ 1 ] );
-        strupr ( g_pstrSourceFilename );
+        if ( argv [ 2 ] && argv [ 2 ][ 0 ] != '-' )
+            SetFilenames ( argv [ 1 ], argv [ 2 ] );
+        else
+            SetFilenames ( argv [ 1 ], NULL );
+    }
+
+    /******************************************************************************************
+    *
+    *   SetFilenames ()
+    *
+    *   Sets the current context's source and output filenames, adding extensions where
+    *   they're missing. If no output filename is given, it's based on the source filename.
+    */
+
+    void SetFilenames ( char * pstrSourceFilename, char * pstrOutputFilename )
+    {
+        // First make a copy of the source filename and convert it to uppercase
+
+        strcpy ( g_pContext->pstrSourceFilename, pstrSourceFilename );
+        strupr ( g_pContext->pstrSourceFilename );
 
         // Check for the presence of the .XASM extension and add it if it's not there
 
-	    if ( ! strstr ( g_pstrSourceFilename, SOURCE_FILE_EXT ) )
+	    if ( ! strstr ( g_pContext->pstrSourceFilename, SOURCE_FILE_EXT ) )
         {
 			// The extension was not found, so add it to string
 
-			strcat ( g_pstrSourceFilename, SOURCE_FILE_EXT );
+			strcat ( g_pContext->pstrSourceFilename, SOURCE_FILE_EXT );
         }
 
         // Was an executable filename specified?
 
-        if ( argv [ 2 ] && argv [ 2 ][ 0 ] != '-' )
+        if ( pstrOutputFilename )
         {
             // Yes, so repeat the validation process
 
-            strcpy ( g_pstrOutputFilename, argv [ 2 ] );
-            strupr ( g_pstrOutputFilename );
+            strcpy ( g_pContext->pstrOutputFilename, pstrOutputFilename );
+            strupr ( g_pContext->pstrOutputFilename );
 
             // Check for the presence of the .XSE extension and add it if it's not there
 
-	        if ( ! strstr ( g_pstrOutputFilename, OUTPUT_FILE_EXT ) )
+	        if ( ! strstr ( g_pContext->pstrOutputFilename, OUTPUT_FILE_EXT ) )
             {
 			    // The extension was not found, so add it to string
 
-			    strcat ( g_pstrOutputFilename, OUTPUT_FILE_EXT );
+			    strcat ( g_pContext->pstrOutputFilename, OUTPUT_FILE_EXT );
             }
         }
         else
@@ -159,19 +171,34 @@
 
             // First locate the start of the extension, and use pointer subtraction to find the index
 
-            int ExtOffset = strrchr ( g_pstrSourceFilename, '.' ) - g_pstrSourceFilename;
-            strncpy ( g_pstrOutputFilename, g_pstrSourceFilename, ExtOffset );
+            int ExtOffset = strrchr ( g_pContext->pstrSourceFilename, '.' ) - g_pContext->pstrSourceFilename;
+            strncpy ( g_pContext->pstrOutputFilename, g_pContext->pstrSourceFilename, ExtOffset );
 
             // Append null terminator
 
-            g_pstrOutputFilename [ ExtOffset ] = '\0';
+            g_pContext->pstrOutputFilename [ ExtOffset ] = '\0';
 
             // Append executable extension
 
-		    strcat ( g_pstrOutputFilename, OUTPUT_FILE_EXT );
+		    strcat ( g_pContext->pstrOutputFilename, OUTPUT_FILE_EXT );
         }
     }
 
+    /******************************************************************************************
+    *
+    *   GetExecFilename ()
+    *
+    *   Builds the name of the .XSE executable XASM will create from the current context's
+    *   output file.
+    */
+
+    void GetExecFilename ( char * pstrExecFilename )
+    {
+        strcpy ( pstrExecFilename, g_pContext->pstrOutputFilename );
+        * strrchr ( pstrExecFilename, '.' ) = '\0';
+        strcat ( pstrExecFilename, ".XSE" );
+    }
+
     /******************************************************************************************
     *
     *   ReadCmmndLineParams ()
@@ -182,7 +209,7 @@
     void ReadCmmndLineParams ( int argc, char * argv [] )
     {
         char pstrCurrOption [ 32 ];
-        char pstrCurrValue [ 32 ];
+        char pstrCurrValue [ MAX_FILENAME_SIZE ];
         char pstrErrorMssg [ 256 ];
 
         for ( int iCurrOptionIndex = 0; iCurrOptionIndex < argc; ++ iCurrOptionIndex )
@@ -253,7 +280,7 @@
                 {
                     // Convert the value to an integer stack size
 
-                    g_ScriptHeader.iStackSize = atoi ( pstrCurrValue );
+                    g_pContext->ScriptHeader.iStackSize = atoi ( pstrCurrValue );
                 }
 
                 // Set the priority
@@ -266,29 +293,29 @@
 
                     if ( stricmp ( pstrCurrValue, PRIORITY_LOW_KEYWORD ) == 0 )
                     {
-                        g_ScriptHeader.iPriorityType = PRIORITY_LOW;
+                        g_pContext->ScriptHeader.iPriorityType = PRIORITY_LOW;
                     }
 
                     // Medium rank
 
                     else if ( stricmp ( pstrCurrValue, PRIORITY_MED_KEYWORD ) == 0 )
                     {
-                        g_ScriptHeader.iPriorityType = PRIORITY_MED;
+                        g_pContext->ScriptHeader.iPriorityType = PRIORITY_MED;
                     }
 
                     // High rank
 
                     else if ( stricmp ( pstrCurrValue, PRIORITY_HIGH_KEYWORD ) == 0 )
                     {
-                        g_ScriptHeader.iPriorityType = PRIORITY_HIGH;
+                        g_pContext->ScriptHeader.iPriorityType = PRIORITY_HIGH;
                     }
 
                     // User-defined timeslice
 
                     else
                     {
-                        g_ScriptHeader.iPriorityType = PRIORITY_USER;
-                        g_ScriptHeader.iUserPriority = atoi ( pstrCurrValue );
+                        g_pContext->ScriptHeader.iPriorityType = PRIORITY_USER;
+                        g_pContext->ScriptHeader.iUserPriority = atoi ( pstrCurrValue );
                     }
                 }
 
@@ -296,15 +323,71 @@
 
                 else if ( stricmp ( pstrCurrOption, "A" ) == 0 )
                 {
-                    g_iPreserveOutputFile = TRUE;
+                    g_pContext->iPreserveOutputFile = TRUE;
                 }
 
                 // Don't generate an .XSE executable
 
                 else if ( stricmp ( pstrCurrOption, "N" ) == 0 )
                 {
-                    g_iGenerateXSE = FALSE;
-                    g_iPreserveOutputFile = TRUE;
+                    g_pContext->iGenerateXSE = FALSE;
+                    g_pContext->iPreserveOutputFile = TRUE;
+                }
+
+                // Set the number of batch worker threads
+
+                else if ( stricmp ( pstrCurrOption, "J" ) == 0 )
+                {
+                    g_iBatchWorkerCount = atoi ( pstrCurrValue );
+                    if ( g_iBatchWorkerCount < 1 )
+                        ExitOnError ( "Invalid value for -J option" );
+                }
+
+                // Set the inlining threshold
+
+                else if ( stricmp ( pstrCurrOption, "I" ) == 0 )
+                {
+                    if ( atoi ( pstrCurrValue ) < 0 )
+                        ExitOnError ( "Invalid value for -I option" );
+                    g_iInlineThreshold = atoi ( pstrCurrValue );
+                }
+
+                // Don't emit typed instructions
+
+                else if ( stricmp ( pstrCurrOption, "NT" ) == 0 )
+                {
+                    g_iIsTypeInferenceEnabled = FALSE;
+                }
+
+                // Don't emit source line numbers
+
+                else if ( stricmp ( pstrCurrOption, "NL" ) == 0 )
+                {
+                    g_iIsLineInfoEnabled = FALSE;
+                }
+
+                // Generate older executables
+
+                else if ( stricmp ( pstrCurrOption, & LEGACY_XSE_SWITCH [ 1 ] ) == 0 )
+                {
+                    g_iIsLegacyXSE = TRUE;
+                }
+
+                // Enable the compilation cache
+
+                else if ( stricmp ( pstrCurrOption, "C" ) == 0 )
+                {
+                    g_iIsCacheEnabled = TRUE;
+                    strcpy ( g_pstrCacheDirName, pstrCurrValue );
+                }
+
+                // Set the cache size limit
+
+                else if ( stricmp ( pstrCurrOption, "CMAX" ) == 0 )
+                {
+                    if ( atoi ( pstrCurrValue ) < 1 )
+                        ExitOnError ( "Invalid value for -CMAX option" );
+                    g_iMaxCacheSize = atoi ( pstrCurrValue );
                 }
                 
                 // Anything else is invalid
@@ -329,29 +412,40 @@
 	{
         // ---- Initialize the script header
 
-        g_ScriptHeader.iIsMainFuncPresent = FALSE;
-        g_ScriptHeader.iStackSize = 0;
-        g_ScriptHeader.iPriorityType = PRIORITY_NONE;
+        g_pContext->ScriptHeader.iIsMainFuncPresent = FALSE;
+        g_pContext->ScriptHeader.iStackSize = 0;
+        g_pContext->ScriptHeader.iPriorityType = PRIORITY_NONE;
 
         // ---- Initialize the main settings
 
         // Mark the assembly file for deletion
 
-        g_iPreserveOutputFile = FALSE;
+        g_pContext->iPreserveOutputFile = FALSE;
 
         // Generate an .XSE executable
 
-        g_iGenerateXSE = TRUE;
+        g_pContext->iGenerateXSE = TRUE;
 
         // Initialize the source code list
 
-        InitLinkedList ( & g_SourceCode );
+        InitLinkedList ( & g_pContext->SourceCode );
 
         // Initialize the tables
 
-        InitLinkedList ( & g_FuncTable );
-        InitLinkedList ( & g_SymbolTable );
-        InitLinkedList ( & g_StringTable );
+        InitLinkedList ( & g_pContext->FuncTable );
+        InitLinkedList ( & g_pContext->SymbolTable );
+        InitLinkedList ( & g_pContext->StringTable );
+
+        // Initialize the remaining compiler state
+
+        g_pContext->iCurrJumpTargetIndex = 0;
+        g_pContext->iInlinedCallCount = 0;
+        g_pContext->iTypedInstrCount = 0;
+        g_pContext->pOutputFile = NULL;
+
+        // Errors exit the program unless a batch worker says otherwise
+
+        g_pContext->iCanRecover = FALSE;
     }
 
 	/******************************************************************************************
@@ -365,13 +459,32 @@
 	{
         // Free the source code
 
-        FreeLinkedList ( & g_SourceCode );
+        FreeLinkedList ( & g_pContext->SourceCode );
+
+        // Free each function's I-code stream, along with each instruction's operand list
+
+        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_pContext->FuncTable.iNodeCount; ++ iCurrFuncIndex )
+        {
+            FuncNode * pFunc = GetFuncByIndex ( iCurrFuncIndex );
+
+            LinkedListNode * pNode = pFunc->ICodeStream.pHead;
+            for ( int iCurrNode = 0; iCurrNode < pFunc->ICodeStream.iNodeCount; ++ iCurrNode )
+            {
+                ICodeNode * pICodeNode = ( ICodeNode * ) pNode->pData;
+                if ( pICodeNode->iType == ICODE_NODE_INSTR )
+                    FreeLinkedList ( & pICodeNode->Instr.OpList );
+
+                pNode = pNode->pNext;
+            }
+
+            FreeLinkedList ( & pFunc->ICodeStream );
+        }
 
         // Free the tables
 
-        FreeLinkedList ( & g_FuncTable );
-        FreeLinkedList ( & g_SymbolTable );
-        FreeLinkedList ( & g_StringTable );
+        FreeLinkedList ( & g_pContext->FuncTable );
+        FreeLinkedList ( & g_pContext->SymbolTable );
+        FreeLinkedList ( & g_pContext->StringTable );
 	}
 
     /******************************************************************************************
@@ -387,7 +500,7 @@
 
         FILE * pSourceFile;
 
-        if ( ! ( pSourceFile = fopen ( g_pstrSourceFilename, "r" ) ) )
+        if ( ! ( pSourceFile = fopen ( g_pContext->pstrSourceFilename, "r" ) ) )
             ExitOnError ( "Could not open source file for input" );
 
         // ---- Load the source code
@@ -410,7 +523,7 @@
 
             // Add it to the source code linked list
 
-            AddNode ( & g_SourceCode, pstrCurrLine );
+            AddNode ( & g_pContext->SourceCode, pstrCurrLine );
         }
 
         // ---- Close the file
@@ -429,12 +542,17 @@
     {
         // Add two temporary variables for evaluating expressions
 
-        g_iTempVar0SymbolIndex = AddSymbol ( TEMP_VAR_0, 1, SCOPE_GLOBAL, SYMBOL_TYPE_VAR );
-        g_iTempVar1SymbolIndex = AddSymbol ( TEMP_VAR_1, 1, SCOPE_GLOBAL, SYMBOL_TYPE_VAR );
+        g_pContext->iTempVar0SymbolIndex = AddSymbol ( TEMP_VAR_0, 1, SCOPE_GLOBAL, SYMBOL_TYPE_VAR );
+        g_pContext->iTempVar1SymbolIndex = AddSymbol ( TEMP_VAR_1, 1, SCOPE_GLOBAL, SYMBOL_TYPE_VAR );
         
         // Parse the source file to create an I-code representation
 
         ParseSourceCode ();
+
+        // Replace generic instructions with typed ones wherever the types can be proven
+
+        if ( g_iIsTypeInferenceEnabled )
+            InferTypes ();
     }
 
     /******************************************************************************************
@@ -456,7 +574,7 @@
 
         // Traverse the list to count each symbol type
 
-        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
+        for ( int iCurrSymbolIndex = 0; iCurrSymbolIndex < g_pContext->SymbolTable.iNodeCount; ++ iCurrSymbolIndex )
         {
             // Create a pointer to the current symbol structure
 
@@ -488,7 +606,7 @@
 
         // Traverse the list to count each symbol type
 
-        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_FuncTable.iNodeCount; ++ iCurrFuncIndex )
+        for ( int iCurrFuncIndex = 1; iCurrFuncIndex <= g_pContext->FuncTable.iNodeCount; ++ iCurrFuncIndex )
         {
             // Create a pointer to the current function structure
 
@@ -505,21 +623,21 @@
 
         // Print out final calculations
 
-        printf ( "%s created successfully!\n\n", g_pstrOutputFilename );
-        printf ( "Source Lines Processed: %d\n", g_SourceCode.iNodeCount );
+        printf ( "%s created successfully!\n\n", g_pContext->pstrOutputFilename );
+        printf ( "Source Lines Processed: %d\n", g_pContext->SourceCode.iNodeCount );
         printf ( "            Stack Size: " );
-        if ( g_ScriptHeader.iStackSize )
-            printf ( "%d", g_ScriptHeader.iStackSize );
+        if ( g_pContext->ScriptHeader.iStackSize )
+            printf ( "%d", g_pContext->ScriptHeader.iStackSize );
         else
             printf ( "Default" );
 
         printf ( "\n" );
 
         printf ( "              Priority: " );
-        switch ( g_ScriptHeader.iPriorityType )
+        switch ( g_pContext->ScriptHeader.iPriorityType )
         {
             case PRIORITY_USER:
-                printf ( "%dms Timeslice", g_ScriptHeader.iUserPriority );
+                printf ( "%dms Timeslice", g_pContext->ScriptHeader.iUserPriority );
                 break;
 
             case PRIORITY_LOW:
@@ -544,13 +662,15 @@
         printf ( "             Variables: %d\n", iVarCount );
         printf ( "                Arrays: %d\n", iArrayCount );
         printf ( "               Globals: %d\n", iGlobalCount);
-        printf ( "       String Literals: %d\n", g_StringTable.iNodeCount );
+        printf ( "       String Literals: %d\n", g_pContext->StringTable.iNodeCount );
         printf ( "        Host API Calls: %d\n", iHostAPICallCount );
-        printf ( "             Functions: %d\n", g_FuncTable.iNodeCount );
+        printf ( "             Functions: %d\n", g_pContext->FuncTable.iNodeCount );
+        printf ( "         Calls Inlined: %d\n", g_pContext->iInlinedCallCount );
+        printf ( "    Typed Instructions: %d\n", g_pContext->iTypedInstrCount );
 
         printf ( "      _Main () Present: " );
-        if ( g_ScriptHeader.iIsMainFuncPresent )
-            printf ( "Yes (Index %d)\n", g_ScriptHeader.iMainFuncIndex );
+        if ( g_pContext->ScriptHeader.iIsMainFuncPresent )
+            printf ( "Yes (Index %d)\n", g_pContext->ScriptHeader.iMainFuncIndex );
         else
             printf ( "No\n" );
         printf ( "\n" );
@@ -568,7 +688,7 @@
     {
         // Command-line parameters to pass to XASM
 
-        char * ppstrCmmndLineParams [ 3 ];
+        char * ppstrCmmndLineParams [ 4 ];
 
         // Set the first parameter to "XASM" (not that it really matters)
 
@@ -577,16 +697,20 @@
 
         // Copy the .XASM filename into the second parameter
 
-        ppstrCmmndLineParams [ 1 ] = ( char * ) malloc ( strlen ( g_pstrOutputFilename ) + 1 );
-        strcpy ( ppstrCmmndLineParams [ 1 ], g_pstrOutputFilename );
+        ppstrCmmndLineParams [ 1 ] = ( char * ) malloc ( strlen ( g_pContext->pstrOutputFilename ) + 1 );
+        strcpy ( ppstrCmmndLineParams [ 1 ], g_pContext->pstrOutputFilename );
 
-        // Set the third parameter to NULL
+        // Ask for the older format if it was requested, and end the list with NULL
 
         ppstrCmmndLineParams [ 2 ] = NULL;
+        ppstrCmmndLineParams [ 3 ] = NULL;
+
+        if ( g_iIsLegacyXSE )
+            ppstrCmmndLineParams [ 2 ] = LEGACY_XSE_SWITCH;
 
         // Invoke the assembler
 
-        spawnv ( P_WAIT, "XASM.exe", ppstrCmmndLineParams );
+        spawnv ( P_WAIT, ASSMBL_FILENAME, ppstrCmmndLineParams );
 
         // Free the command-line parameters
 
@@ -630,6 +754,28 @@
             return 0;
         }
 
+        // Create the main thread's context
+
+        CompilerContext MainContext;
+        g_pContext = & MainContext;
+
+        // If a file list or directory was given, compile it as a batch
+
+        if ( IsBatchInput ( argv [ 1 ] ) )
+        {
+            // Read the command line parameters into the main context, which supplies them to
+            // each file
+
+            Init ();
+            ReadCmmndLineParams ( argc, argv );
+
+            int iFailedCount = CompileBatch ( argv [ 1 ] );
+
+            ShutDown ();
+
+            return iFailedCount ? 1 : 0;
+        }
+
         // Verify the filenames
 
         VerifyFilenames ( argc, argv );
@@ -652,9 +798,30 @@
 
         PreprocessSourceFile ();
 
+        // ---- If the same source was compiled with the same options before, reuse the output
+
+        char pstrCacheKey [ CACHE_KEY_SIZE ];
+
+        if ( g_iIsCacheEnabled )
+        {
+            InitCache ();
+            GetCacheKey ( pstrCacheKey );
+
+            if ( FetchFromCache ( pstrCacheKey ) )
+            {
+                printf ( "%s is unchanged; output restored from cache.\n\n", g_pContext->pstrSourceFilename );
+                PrintCacheStats ();
+
+                ShutDown ();
+                ShutDownCache ();
+
+                return 0;
+            }
+        }
+
         // ---- Compile the source code to I-code
 
-        printf ( "Compiling %s...\n\n", g_pstrSourceFilename );
+        printf ( "Compiling %s...\n\n", g_pContext->pstrSourceFilename );
         CompileSourceFile ();
 
         // ---- Emit XVM assembly from the I-code representation (back end)
@@ -672,13 +839,34 @@
         // Invoke XASM to assemble the output file to create the .XSE, unless the user requests
         // otherwise
 
-        if ( g_iGenerateXSE )
+        if ( g_pContext->iGenerateXSE )
+        {
+            // When caching, remove any stale executable first so a failed assembly can't be
+            // stored
+
+            if ( g_iIsCacheEnabled )
+            {
+                char pstrExecFilename [ MAX_FILENAME_SIZE ];
+                GetExecFilename ( pstrExecFilename );
+                remove ( pstrExecFilename );
+            }
+
             AssmblOutputFile ();
+        }
+
+        // Store the output in the cache
+
+        if ( g_iIsCacheEnabled )
+        {
+            StoreInCache ( pstrCacheKey );
+            PrintCacheStats ();
+            ShutDownCache ();
+        }
 
         // Delete the output (assembly) file unless the user requested it to be preserved
 
-        if ( ! g_iPreserveOutputFile )
-            remove ( g_pstrOutputFilename );
+        if ( ! g_pContext->iPreserveOutputFile )
+            remove ( g_pContext->pstrOutputFilename );
 
         return 0;
     }
@@ -44,6 +44,16 @@
         #define VERSION_MAJOR               0           // Major version number
         #define VERSION_MINOR               8           // Minor version number
 
+        #define CODEGEN_REVISION            1           // Raise this whenever a change to XSC
+                                                        // alters the code it emits for the
+                                                        // same source and options
+
+    // ---- XASM Invocation -------------------------------------------------------------------
+
+        #define ASSMBL_FILENAME             "XASM.exe"  // The assembler's executable
+        #define LEGACY_XSE_SWITCH           "-XSE0.8"   // Asks XASM for the older, fixed-size
+                                                        // executable format
+
     // ---- Filename --------------------------------------------------------------------------
 
         #define MAX_FILENAME_SIZE           2048        // Maximum filename length
@@ -100,33 +110,7 @@
 
 // ---- Global Variables ----------------------------------------------------------------------
 
-    // ---- Source Code -----------------------------------------------------------------------
-
-		extern char g_pstrSourceFilename [ MAX_FILENAME_SIZE ],
-		            g_pstrOutputFilename [ MAX_FILENAME_SIZE ];
-
-        extern LinkedList g_SourceCode;
-
-    // ---- Script ----------------------------------------------------------------------------
-
-        extern ScriptHeader g_ScriptHeader;
-
-    // ---- Function Table --------------------------------------------------------------------
-
-        extern LinkedList g_FuncTable;
-
-    // ---- Symbol Table ----------------------------------------------------------------------
-
-        extern LinkedList g_SymbolTable;
-
-	// ---- String Table ----------------------------------------------------------------------
-
-		extern LinkedList g_StringTable;
-
-    // ---- Expression Evaluation -------------------------------------------------------------
-
-        extern int g_iTempVar0SymbolIndex,
-                   g_iTempVar1SymbolIndex;
+        extern int g_iIsLegacyXSE;
 
 // ---- Function Prototypes -------------------------------------------------------------------
 
@@ -134,6 +118,8 @@
         void PrintUsage ();
 
         void VerifyFilenames ( int argc, char * argv [] );
+        void SetFilenames ( char * pstrSourceFilename, char * pstrOutputFilename );
+        void GetExecFilename ( char * pstrExecFilename );
         void ReadCmmndLineParams ( int argc, char * argv [] );
 
         void Init ();
@@ -23,6 +23,8 @@
 
 // ---- Includes ------------------------------------------------------------------------------
 
+    #ifndef WRAPPUH_HEADLESS
+
 	// ---- Language --------------------------------------------------------------------------
 
         #include <direct.h>
@@ -56,6 +58,34 @@
 		#include <dinput.h>
 		#include <dmusici.h>
 
+    #else
+
+	// ---- Language --------------------------------------------------------------------------
+
+        // The headless backend (wrappuh_soft.cpp) builds on machines with no Windows or
+        // DirectX headers, so it only uses the standard library
+
+		#include <stdlib.h>
+		#include <string.h>
+		#include <stdarg.h>
+		#include <stdio.h>
+		#include <math.h>
+		#include <time.h>
+        #include <limits.h>
+
+	// ---- Win32 -----------------------------------------------------------------------------
+
+        // Headless builds on Windows still take the basic types from windows.h, so they agree
+        // with any other header that includes it. Nothing in it is called.
+
+    #ifdef _WIN32
+		#define WIN32_LEAN_AND_MEAN
+
+		#include <windows.h>
+    #endif
+
+    #endif
+
 	// ---- Wrappuh ---------------------------------------------------------------------------
 
 		#include "keymap.h"
@@ -82,12 +112,98 @@
     #define SOUND_PLAYING                       2
     #define SOUND_STOPPED                       3
 
+    #define W_MAX_ATLAS_NAME_SIZE               128     // Longest atlas image name, including
+                                                        // the null terminator
+    #define W_MAX_BATCH_SPRITE_COUNT            4096    // Sprites a batch holds before it's
+                                                        // drawn early
+
+    #ifndef WRAPPUH_HEADLESS
     #ifndef DSBCAPS_CTRLDEFAULT
     #define DSBCAPS_CTRLDEFAULT ( DSBCAPS_CTRLFREQUENCY | DSBCAPS_CTRLPAN | DSBCAPS_CTRLVOLUME )
     #endif
+    #endif
+
+    // ---- Headless --------------------------------------------------------------------------
+
+    #ifdef WRAPPUH_HEADLESS
+
+        #define W_BLIT_KERNEL_SCALAR            0   // Plain C++, for any CPU
+        #define W_BLIT_KERNEL_SSE2              1   // 128-bit SSE2
+        #define W_BLIT_KERNEL_AVX2              2   // 256-bit AVX2
+        #define W_BLIT_KERNEL_COUNT             3
+
+        #define W_MIXER_RATE                    11025   // Mixer output rate, in frames per second
+        #define W_MAX_VOICE_COUNT               1024    // Sounds that can play at once
+
+        // ---- Win32 Stand-Ins ---------------------------------------------------------------
+
+        // DirectInput scancodes used by keymap.h
+
+        #define DIK_ESCAPE                      0x01
+        #define DIK_RETURN                      0x1C
+        #define DIK_SPACE                       0x39
+        #define DIK_UP                          0xC8
+        #define DIK_LEFT                        0xCB
+        #define DIK_RIGHT                       0xCD
+        #define DIK_DOWN                        0xD0
+
+    #ifndef _WIN32
+
+        #ifndef TRUE
+        #define TRUE                            1
+        #endif
+        #ifndef FALSE
+        #define FALSE                           0
+        #endif
+
+        #define WM_QUIT                         0x0012
+
+        // Virtual keys used by keymap.h
+
+        #define VK_SHIFT                        0x10
+        #define VK_MENU                         0x12
+        #define VK_F1                           0x70
+        #define VK_F2                           0x71
+        #define VK_F3                           0x72
+        #define VK_F4                           0x73
+        #define VK_F5                           0x74
+        #define VK_F6                           0x75
+        #define VK_F7                           0x76
+        #define VK_F8                           0x77
+        #define VK_F9                           0x78
+        #define VK_F10                          0x79
+        #define VK_F11                          0x7A
+        #define VK_F12                          0x7B
+
+    #endif
+
+    #endif
 
 // ---- Data Types ----------------------------------------------------------------------------
 
+    // ---- Win32 Stand-Ins -------------------------------------------------------------------
+
+    #if defined ( WRAPPUH_HEADLESS ) && ! defined ( _WIN32 )
+
+        typedef unsigned char UCHAR;
+        typedef unsigned char BYTE;
+        typedef unsigned short WORD;
+        typedef unsigned int DWORD;
+        typedef unsigned int UINT;
+        typedef void * HINSTANCE;
+        typedef char * LPSTR;
+        typedef unsigned int WPARAM;
+        typedef long long INT64;
+
+        typedef struct
+        {
+            UINT message;
+            WPARAM wParam;
+        }
+            MSG;
+
+    #endif
+
 	// ---- Video -----------------------------------------------------------------------------
 
         typedef struct
@@ -108,16 +224,47 @@
 
 		typedef struct
 		{
+        #ifndef WRAPPUH_HEADLESS
 			LPDIRECTDRAWSURFACE4 pDDSrfc;
+        #else
+            void * pPixels;
+        #endif
 			int iXRes,
 				iYRes;
 			int iXMax,
 				iYMax;
             W_Rect ClipRect;
 			int iPitch;
+            int iSourceX,                       // Where the image starts on its surface, which
+                iSourceY;                       // it shares with others if it's from an atlas
+            bool bIsAtlasImage;                 // Atlas images are freed with their atlas
 		}
 			W_Image;
 
+        typedef struct
+        {
+            char pstrName [ W_MAX_ATLAS_NAME_SIZE ];
+            W_Image Image;
+        }
+            W_AtlasImage;
+
+        typedef struct
+        {
+            W_Image Image;                      // The whole atlas
+            W_AtlasImage * pImages;
+            int iImageCount;
+        }
+            W_Atlas;
+
+        typedef struct                                  // Dirty rectangle statistics
+        {
+            int iFrameCount;                            // Batched frames the statistics cover
+            int iFullRedrawCount;                       // Frames that were redrawn in full
+            float fMeanCoverage;                        // Mean share of the screen redrawn
+            float fLastCoverage;                        // Share redrawn in the last frame
+        }
+            W_DirtyRectStats;
+
 	// ---- Audio -----------------------------------------------------------------------------
 
 		typedef struct
@@ -127,6 +274,8 @@
 		}
 			W_Sound;
 
+    #ifndef WRAPPUH_HEADLESS
+
         typedef struct pcm_sound_typ
 	    {
 	        LPDIRECTSOUNDBUFFER dsbuffer;
@@ -146,19 +295,52 @@
         }
             DMUSIC_MIDI, *DMUSIC_MIDI_PTR;
 
+    #endif
+
 	// ---- Timers ----------------------------------------------------------------------------
 
 		typedef int W_TimerHandle;
         typedef INT64 W_Int64;
 
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        typedef struct                                  // Frame time statistics
+        {
+            int iFrameCount;                            // Frames the statistics cover
+            float fMeanTime;                            // Mean frame time (in milliseconds)
+            float fP99Time;                             // 99th percentile frame time
+            float fJitter;                              // Standard deviation of the frame time
+        }
+            W_FrameStats;
+
 // ---- Macros --------------------------------------------------------------------------------
 
 	// ---- Win32 Abstraction -----------------------------------------------------------------
 
+    #ifndef WRAPPUH_HEADLESS
+
 		#define Main																							\
 																												\
 			int WINAPI WinMain ( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int iCmdShow )
 
+    #else
+
+        // Headless programs start in main () like any console program, which hands the
+        // command line on to the same WinMain ()-style entry point
+
+		#define Main																							\
+																												\
+            int W_Main ( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int iCmdShow );     \
+                                                                                                                \
+            int main ( int argc, char * argv [] )                                                               \
+            {                                                                                                   \
+                return W_Main ( NULL, NULL, W_GetCmdLine ( argc, argv ), 0 );                                   \
+            }                                                                                                   \
+                                                                                                                \
+            int W_Main ( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int iCmdShow )
+
+    #endif
+
 		#define MainLoop	\
 							\
 			MSG CurrMssg;	\
@@ -179,9 +361,11 @@
 
     // ---- Audio -----------------------------------------------------------------------------
 
+    #ifndef WRAPPUH_HEADLESS
         #define DSVOLUME_TO_DB(volume) ((DWORD)(-30*(100 - volume)))
         #define MULTI_TO_WIDE( x,y )  MultiByteToWideChar( CP_ACP,MB_PRECOMPOSED, y,-1,x,_MAX_PATH);
         #define DD_INIT_STRUCT(ddstruct) { memset(&ddstruct,0,sizeof(ddstruct)); ddstruct.dwSize=sizeof(ddstruct); }
+    #endif
 
 // ---- Public Interface ----------------------------------------------------------------------
 
@@ -195,7 +379,9 @@
 		bool W_InitWrappuh ( char * pstrAppName, HINSTANCE hInstance, int iCmdShow );
 		void W_ShutDownWrappuh ();
 
+    #ifndef WRAPPUH_HEADLESS
 		LRESULT CALLBACK W_MainWindowHndlr ( HWND hWindow, UINT uMessage, WPARAM wParam, LPARAM lParam );
+    #endif
 		MSG W_HandleWin32MssgLoop ();
 
 	// ---- Video -----------------------------------------------------------------------------
@@ -216,6 +402,24 @@
 
 		bool W_BlitImage ( W_Image Image, int iX, int iY );
 
+        bool W_LoadAtlas ( char * pstrAtlasFilename, W_Atlas * Atlas );
+        void W_FreeAtlas ( W_Atlas * Atlas );
+        bool W_GetAtlasImage ( W_Atlas * Atlas, char * pstrName, W_Image * Image );
+
+        bool W_OpenImagePack ( char * pstrPackFilename );
+        void W_CloseImagePack ();
+
+        void W_BeginSpriteBatch ();
+        bool W_BatchImage ( W_Image & Image, int iX, int iY, int iLayer );
+        void W_EndSpriteBatch ();
+        void W_SetBatchBackground ( W_Image & Image );
+
+        void W_EnableDirtyRects ();
+        void W_DisableDirtyRects ();
+        void W_InvalidateFrame ();
+        void W_GetDirtyRectStats ( W_DirtyRectStats * pStats );
+        void W_ResetDirtyRectStats ();
+
 		void W_DrawPoint ( UCHAR iR, UCHAR iG, UCHAR iB, int iX, int iY );
 
 		bool W_LoadFont ( char * pstrBMPFilename, int iCellXRes, int iCellYRes );
@@ -244,9 +448,12 @@
 		void W_FreeSound ( W_Sound * Sound );
 
 		bool W_PlaySound ( W_Sound & Sound );
+        bool W_PlaySoundEx ( W_Sound & Sound, int iVolume, int iPan );
 		bool W_StopSound ( W_Sound Sound );
         void W_StopAllSounds ();
 
+    #ifndef WRAPPUH_HEADLESS
+
         int DSound_Load_WAV(char *filename, int control_flags = DSBCAPS_CTRLDEFAULT);
         int DSound_Replicate_Sound(int source_id);
         int DSound_Play(int id, int flags=0, int volume=0, int rate=0, int pan=0);
@@ -270,6 +477,8 @@
         int DMusic_Status_MIDI(int id);
         int DMusic_Init(void);
 
+    #endif
+
 	// ---- Timer -----------------------------------------------------------------------------
 
 		DWORD W_GetTickCount ();
@@ -281,6 +490,52 @@
         void W_Delay ( unsigned int iLength );
 
         W_Int64 W_GetHighPerformanceTickCount ();
+        W_Int64 W_GetMicroTickCount ();
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        void W_SetFrameRate ( int iFramesPerSec );
+        void W_WaitForNextFrame ();
+        void W_GetFrameStats ( W_FrameStats * pStats );
+        void W_ResetFrameStats ();
+
+    // ---- Headless --------------------------------------------------------------------------
+
+    #ifdef WRAPPUH_HEADLESS
+
+        LPSTR W_GetCmdLine ( int argc, char * argv [] );
+
+        void W_SetKeyState ( int iScanCode, int iIsDown );
+
+        void W_EnableDrawing ();
+        void W_DisableDrawing ();
+
+        void W_EnableVirtualClock ();
+        void W_DisableVirtualClock ();
+        void W_AdvanceVirtualClock ( unsigned int iLength );
+
+        unsigned int W_GetFrameChecksum ();
+        bool W_SaveFrame ( char * pstrBMPFilename );
+
+        int W_GetBlitKernel ();
+        bool W_SetBlitKernel ( int iKernel );
+        bool W_IsBlitKernelSupported ( int iKernel );
+        char * W_GetBlitKernelName ( int iKernel );
+
+        int W_GetMixKernel ();
+        bool W_SetMixKernel ( int iKernel );
+
+        void W_UpdateSound ();
+        int W_GetVoiceCount ();
+
+        void W_EnableSoundOutput ();
+        void W_DisableSoundOutput ();
+        int W_ReadSoundFrames ( short * psFrames, int iFrameCount );
+
+        bool W_StartSoundRecording ( char * pstrWAVFilename );
+        void W_StopSoundRecording ();
+
+    #endif
 
 #endif
 
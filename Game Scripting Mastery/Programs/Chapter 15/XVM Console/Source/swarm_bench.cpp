@@ -0,0 +1,342 @@
+/*
+
+    Project.
+
+        XVM Swarm Benchmark
+
+    Abstract.
+
+        Runs a swarm of entities, each driven by its own instance of SWARM.XSE, and times how
+        long the XVM takes to update them. The swarm is run once with every entity loaded as
+        a separate script and called with XS_CallScriptFunc (), and once as the lanes of a
+        single batch called with XS_CallBatchFunc (). Both runs should produce the same
+        checksum.
+
+        Only this file and the XVM are needed, so it also builds outside of Windows (g++ -O2
+        xvm.cpp swarm_bench.cpp, for instance). It's run from the directory SWARM.XSE is in.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xvm.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Benchmark -------------------------------------------------------------------------
+
+        #define SWARM_FILENAME              "SWARM.XSE" // The entity script
+
+        #define MAX_ENTITY_COUNT            1024        // The most entities, which is limited by
+                                                        // the number of scripts the XVM can
+                                                        // load at once
+        #define DEFAULT_ENTITY_COUNT        1024        // Entities in the swarm by default
+        #define DEFAULT_FRAME_COUNT         500         // Frames to run by default
+
+        #define ARENA_WIDTH                 640         // The size of the area the entities
+        #define ARENA_HEIGHT                480         // start out in
+
+        #define ENTITY_ACCEL                0.2f        // How fast the entities accelerate
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    int g_iEntityCount;                                 // The number of entities
+    int g_iFrameCount;                                  // The number of frames to run
+
+    float g_pfStartX [ MAX_ENTITY_COUNT ];              // Each entity's starting position
+    float g_pfStartY [ MAX_ENTITY_COUNT ];
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    unsigned int GetBenchTime ();
+    void GetTarget ( int iFrame, float * pfTargetX, float * pfTargetY );
+    int RunScripts ( char * pstrFuncName, unsigned int * piTime, double * pdChecksum );
+    int RunBatch ( char * pstrFuncName, unsigned int * piTime, double * pdChecksum );
+    int RunBenchmark ( char * pstrFuncName );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "XVM Swarm Benchmark\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tSWARMBENCH [Entities] [Frames]\n" );
+        printf ( "\n" );
+        printf ( "\t- Entities is the size of the swarm, up to %d (%d by default).\n", MAX_ENTITY_COUNT, DEFAULT_ENTITY_COUNT );
+        printf ( "\t- Frames is the number of frames to run (%d by default).\n", DEFAULT_FRAME_COUNT );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetBenchTime ()
+    *
+    *   Returns the current time in milliseconds, from GetTickCount () on Windows and the
+    *   POSIX monotonic clock elsewhere.
+    */
+
+    unsigned int GetBenchTime ()
+    {
+        #ifdef _WIN32
+            return GetTickCount ();
+        #else
+            struct timespec Time;
+            clock_gettime ( CLOCK_MONOTONIC, & Time );
+            return ( unsigned int ) ( Time.tv_sec * 1000 + Time.tv_nsec / 1000000 );
+        #endif
+    }
+
+    /******************************************************************************************
+    *
+    *   GetTarget ()
+    *
+    *   Returns the position of the target the swarm chases during the specified frame.
+    */
+
+    void GetTarget ( int iFrame, float * pfTargetX, float * pfTargetY )
+    {
+        * pfTargetX = ( float ) ( ARENA_WIDTH / 2 + 200 * cos ( iFrame * 0.05 ) );
+        * pfTargetY = ( float ) ( ARENA_HEIGHT / 2 + 150 * sin ( iFrame * 0.03 ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   RunScripts ()
+    *
+    *   Runs the swarm with a separate script for each entity, calling the specified function
+    *   in each one every frame. Returns FALSE if the scripts couldn't be loaded.
+    */
+
+    int RunScripts ( char * pstrFuncName, unsigned int * piTime, double * pdChecksum )
+    {
+        XS_Init ();
+
+        // Load a script for each entity and put it at its starting position. The scripts
+        // have to be running for the host to call their functions.
+
+        int piThreads [ MAX_ENTITY_COUNT ];
+        int iCurrEntity;
+
+        for ( iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+        {
+            if ( XS_LoadScript ( SWARM_FILENAME, piThreads [ iCurrEntity ], XS_THREAD_PRIORITY_USER ) != XS_LOAD_OK )
+            {
+                XS_ShutDown ();
+                return FALSE;
+            }
+
+            XS_StartScript ( piThreads [ iCurrEntity ] );
+
+            XS_PassFloatParam ( piThreads [ iCurrEntity ], g_pfStartX [ iCurrEntity ] );
+            XS_PassFloatParam ( piThreads [ iCurrEntity ], g_pfStartY [ iCurrEntity ] );
+            XS_CallScriptFunc ( piThreads [ iCurrEntity ], "Init" );
+        }
+
+        // Update every entity each frame
+
+        double dChecksum = 0;
+        unsigned int iStartTime = GetBenchTime ();
+
+        for ( int iCurrFrame = 0; iCurrFrame < g_iFrameCount; ++ iCurrFrame )
+        {
+            float fTargetX, fTargetY;
+            GetTarget ( iCurrFrame, & fTargetX, & fTargetY );
+
+            for ( iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+            {
+                int iThread = piThreads [ iCurrEntity ];
+
+                XS_PassFloatParam ( iThread, fTargetX );
+                XS_PassFloatParam ( iThread, fTargetY );
+                XS_PassFloatParam ( iThread, ENTITY_ACCEL );
+                XS_CallScriptFunc ( iThread, pstrFuncName );
+
+                dChecksum += XS_GetReturnValueAsFloat ( iThread );
+            }
+        }
+
+        * piTime = GetBenchTime () - iStartTime;
+        * pdChecksum = dChecksum;
+
+        XS_ShutDown ();
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBatch ()
+    *
+    *   Runs the swarm as a single batch with a lane for each entity, calling the specified
+    *   function in every lane each frame. Returns FALSE if the batch couldn't be created.
+    */
+
+    int RunBatch ( char * pstrFuncName, unsigned int * piTime, double * pdChecksum )
+    {
+        XS_Init ();
+
+        // Load the script once and create the batch
+
+        int iThread;
+        if ( XS_LoadScript ( SWARM_FILENAME, iThread, XS_THREAD_PRIORITY_USER ) != XS_LOAD_OK )
+        {
+            XS_ShutDown ();
+            return FALSE;
+        }
+
+        int iBatch = XS_CreateBatch ( iThread, g_iEntityCount, 0 );
+        if ( iBatch == XS_INVALID_BATCH )
+        {
+            XS_ShutDown ();
+            return FALSE;
+        }
+
+        // Put every entity at its starting position
+
+        XS_PassBatchFloatParams ( iBatch, g_pfStartX );
+        XS_PassBatchFloatParams ( iBatch, g_pfStartY );
+        XS_CallBatchFunc ( iBatch, "Init" );
+
+        // Update every entity each frame. The target and acceleration are the same for every
+        // lane, so they're only filled in once per frame.
+
+        float pfTargetX [ MAX_ENTITY_COUNT ],
+              pfTargetY [ MAX_ENTITY_COUNT ],
+              pfAccel [ MAX_ENTITY_COUNT ];
+
+        int iCurrEntity;
+        for ( iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+            pfAccel [ iCurrEntity ] = ENTITY_ACCEL;
+
+        double dChecksum = 0;
+        unsigned int iStartTime = GetBenchTime ();
+
+        for ( int iCurrFrame = 0; iCurrFrame < g_iFrameCount; ++ iCurrFrame )
+        {
+            float fTargetX, fTargetY;
+            GetTarget ( iCurrFrame, & fTargetX, & fTargetY );
+
+            for ( iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+            {
+                pfTargetX [ iCurrEntity ] = fTargetX;
+                pfTargetY [ iCurrEntity ] = fTargetY;
+            }
+
+            XS_PassBatchFloatParams ( iBatch, pfTargetX );
+            XS_PassBatchFloatParams ( iBatch, pfTargetY );
+            XS_PassBatchFloatParams ( iBatch, pfAccel );
+            XS_CallBatchFunc ( iBatch, pstrFuncName );
+
+            for ( iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+                dChecksum += XS_GetBatchReturnValueAsFloat ( iBatch, iCurrEntity );
+        }
+
+        * piTime = GetBenchTime () - iStartTime;
+        * pdChecksum = dChecksum;
+
+        XS_ShutDown ();
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBenchmark ()
+    *
+    *   Runs the swarm both ways with the specified update function and prints the times.
+    *   Returns FALSE if the benchmark couldn't be run or the checksums don't match.
+    */
+
+    int RunBenchmark ( char * pstrFuncName )
+    {
+        unsigned int iScriptsTime, iBatchTime;
+        double dScriptsChecksum, dBatchChecksum;
+
+        if ( ! RunScripts ( pstrFuncName, & iScriptsTime, & dScriptsChecksum ) ||
+             ! RunBatch ( pstrFuncName, & iBatchTime, & dBatchChecksum ) )
+        {
+            printf ( "Could not load %s.\n", SWARM_FILENAME );
+            return FALSE;
+        }
+
+        printf ( "%s (): %d entities, %d frames\n", pstrFuncName, g_iEntityCount, g_iFrameCount );
+        printf ( "\tScripts: %ums, checksum %.3f\n", iScriptsTime, dScriptsChecksum );
+        printf ( "\tBatch:   %ums, checksum %.3f", iBatchTime, dBatchChecksum );
+        if ( iBatchTime )
+            printf ( " (%.2fx)", ( float ) iScriptsTime / iBatchTime );
+        printf ( "\n\n" );
+
+        if ( dScriptsChecksum != dBatchChecksum )
+        {
+            printf ( "Checksums don't match.\n" );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the entity and frame counts, if they were specified
+
+        g_iEntityCount = DEFAULT_ENTITY_COUNT;
+        g_iFrameCount = DEFAULT_FRAME_COUNT;
+
+        if ( argc > 1 )
+            g_iEntityCount = atoi ( argv [ 1 ] );
+
+        if ( argc > 2 )
+            g_iFrameCount = atoi ( argv [ 2 ] );
+
+        if ( g_iEntityCount <= 0 || g_iEntityCount > MAX_ENTITY_COUNT || g_iFrameCount <= 0 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        // Scatter the entities with a fixed seed, so every run starts the same way
+
+        srand ( 1 );
+        for ( int iCurrEntity = 0; iCurrEntity < g_iEntityCount; ++ iCurrEntity )
+        {
+            g_pfStartX [ iCurrEntity ] = ( float ) ( rand () % ARENA_WIDTH );
+            g_pfStartY [ iCurrEntity ] = ( float ) ( rand () % ARENA_HEIGHT );
+        }
+
+        // Update () runs the same code for every entity, while Wander () branches differently
+        // for entities near the target
+
+        if ( ! RunBenchmark ( "Update" ) || ! RunBenchmark ( "Wander" ) )
+            return 1;
+
+        return 0;
+    }
@@ -0,0 +1,686 @@
+/*
+
+    Project.
+
+        XtremeScript Benchmark Suite
+
+    Abstract.
+
+        Runs a suite of benchmark scripts through the whole XtremeScript toolchain without any
+        console or graphics. Each script is compiled with XSC, assembled with XASM, loaded
+        with XS_LoadScript () and run with XS_RunScripts (), and the time each step takes is
+        measured along with how many instructions per second the XVM executes.
+
+        The host API the scripts need is registered as stubs. The host call benchmark uses
+        the same functions as Lockdown's droid scripts, backed by a room of droids that only
+        exists as numbers.
+
+        Results are printed as a table and written to a comma-separated file with one line
+        per benchmark, which can be kept and compared to track regressions. Every benchmark
+        also reports a checksum of the values its script passed to Report (), so a change
+        that makes a script compute something else shows up too.
+
+        The tools are started through system () with whatever commands -XSC and -XASM give,
+        so the suite is built from just this file and the XVM, on Windows or elsewhere (g++
+        -O2 xvm.cpp xs_bench.cpp, for instance).
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xvm.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Benchmark -------------------------------------------------------------------------
+
+        #define DEFAULT_RUN_COUNT           3           // Times each step is run by default
+        #define DEFAULT_RESULTS_FILENAME    "XSBENCH.CSV"   // Where results go by default
+
+        #define LOAD_COUNT                  1000        // Loads timed per run, since a single
+                                                        // load is too quick to time
+
+        #define MAX_COMMAND_SIZE            1024        // Maximum tool command line size
+        #define MAX_SCRIPT_COUNT            64          // Most copies of a script run at once
+
+        #define BENCH_COUNT                 5           // The number of benchmarks
+
+    // ---- Host API --------------------------------------------------------------------------
+
+        #define DROID_COUNT                 8           // Droids in the stub room
+        #define ROOM_WIDTH                  640         // The size of the room
+        #define ROOM_HEIGHT                 480
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _Bench                               // A benchmark
+    {
+        char * pstrName;                                // The benchmark's name
+        char * pstrSourceFilename;                      // The script's source file
+        char * pstrAsmFilename;                         // Its compiled assembly
+        char * pstrExecFilename;                        // Its executable
+        char * pstrOptions;                             // Extra compiler options
+        int iScriptCount;                               // Copies of it to run at once
+    }
+        Bench;
+
+    typedef struct _BenchResult                         // The result of a benchmark
+    {
+        unsigned int iCompileTime;                      // Milliseconds to compile
+        unsigned int iAssembleTime;                     // Milliseconds to assemble
+        unsigned int iLoadTime;                         // Microseconds to load once
+        unsigned int iRunTime;                          // Milliseconds to run
+        unsigned int iInstrCount;                       // Instructions executed by the run
+        unsigned int iChecksum;                         // Checksum of the reported values
+    }
+        BenchResult;
+
+    typedef struct _Droid                               // A droid in the stub room
+    {
+        int iX;                                         // Its position
+        int iY;
+        int iIsActive;                                  // Is it alive?
+    }
+        Droid;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    // ---- Benchmarks ------------------------------------------------------------------------
+
+    Bench g_Benches [ BENCH_COUNT ] =
+    {
+        { "Fib",        "bench_fib.xss",        "BENCH_FIB.XASM",       "BENCH_FIB.XSE",        "",         1 },
+        { "Concat",     "bench_concat.xss",     "BENCH_CONCAT.XASM",    "BENCH_CONCAT.XSE",     "",         1 },
+        { "Array",      "bench_array.xss",      "BENCH_ARRAY.XASM",     "BENCH_ARRAY.XSE",      "-S:8192",  1 },
+        { "Host",       "bench_host.xss",       "BENCH_HOST.XASM",      "BENCH_HOST.XSE",       "",         1 },
+        { "Threads",    "bench_threads.xss",    "BENCH_THREADS.XASM",   "BENCH_THREADS.XSE",    "",         MAX_SCRIPT_COUNT }
+    };
+
+    // ---- Options ---------------------------------------------------------------------------
+
+    char * g_pstrXSC = "XSC";                           // The compiler's command
+    char * g_pstrXASM = "XASM";                         // The assembler's command
+    char * g_pstrResultsFilename = DEFAULT_RESULTS_FILENAME;
+    int g_iRunCount = DEFAULT_RUN_COUNT;                // Times each step is run
+
+    // ---- Host API --------------------------------------------------------------------------
+
+    unsigned int g_iChecksum;                           // Checksum of the reported values
+    unsigned int g_iRandState;                          // GetRandInRange ()'s generator state
+
+    Droid g_Droids [ DROID_COUNT ];                     // The stub room's droids
+    int g_iPlayerX;                                     // The player's position
+    int g_iPlayerY;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    void HAPI_Report ( int iThreadIndex );
+    void HAPI_PauseThread ( int iThreadIndex );
+    void HAPI_GetRandInRange ( int iThreadIndex );
+    void HAPI_MoveEnemyDroid ( int iThreadIndex );
+    void HAPI_GetEnemyDroidX ( int iThreadIndex );
+    void HAPI_GetEnemyDroidY ( int iThreadIndex );
+    void HAPI_IsEnemyDroidAlive ( int iThreadIndex );
+    void HAPI_FireEnemyDroidGun ( int iThreadIndex );
+    void HAPI_GetPlayerDroidX ( int iThreadIndex );
+    void HAPI_GetPlayerDroidY ( int iThreadIndex );
+
+    void InitHostAPI ();
+    int FileExists ( char * pstrFilename );
+    unsigned int GetBenchTime ();
+    int RunTool ( char * pstrCommand, char * pstrOutputFilename, unsigned int * piTime );
+    int RunBench ( Bench * pBench, BenchResult * pResult );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "XtremeScript Benchmark Suite\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tXSBENCH [Benchmark] [Options]\n" );
+        printf ( "\n" );
+        printf ( "\t-R:Runs         Runs each step this many times and keeps the fastest (%d by\n", DEFAULT_RUN_COUNT );
+        printf ( "\t                default)\n" );
+        printf ( "\t-O:File         Writes the results to this file (%s by default)\n", DEFAULT_RESULTS_FILENAME );
+        printf ( "\t-XSC:Command    Runs the compiler with this command (XSC by default)\n" );
+        printf ( "\t-XASM:Command   Runs the assembler with this command (XASM by default)\n" );
+        printf ( "\n" );
+        printf ( "Notes:\n" );
+        printf ( "\t- Benchmark runs a single benchmark: Fib, Concat, Array, Host or Threads.\n" );
+        printf ( "\t  Every benchmark is run by default.\n" );
+        printf ( "\t- The compile and assembly times include starting the tools.\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_Report ()
+    *
+    *       void Report ( Value )
+    *
+    *   Adds a value to the checksum. The checksum is a sum, so threads can report in any
+    *   order.
+    */
+
+    void HAPI_Report ( int iThreadIndex )
+    {
+        char * pstrValue = XS_GetParamAsString ( iThreadIndex, 0 );
+
+        unsigned int iHash = 5381;
+        while ( * pstrValue )
+            iHash = iHash * 33 + * pstrValue ++;
+
+        g_iChecksum += iHash;
+
+        XS_Return ( iThreadIndex, 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_PauseThread ()
+    *
+    *       void PauseThread ( int Dur )
+    *
+    *   Pauses the calling thread for the specified number of milliseconds.
+    */
+
+    void HAPI_PauseThread ( int iThreadIndex )
+    {
+        XS_PauseScript ( iThreadIndex, XS_GetParamAsInt ( iThreadIndex, 0 ) );
+
+        XS_Return ( iThreadIndex, 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_GetRandInRange ()
+    *
+    *       int GetRandInRange ( int Min, int Max )
+    *
+    *   Returns a random integer within the specified range. The generator is implemented
+    *   here so every run produces the same numbers.
+    */
+
+    void HAPI_GetRandInRange ( int iThreadIndex )
+    {
+        int iMin,
+            iMax;
+
+        // Read the min and max parameters in, backwards
+
+        iMin = XS_GetParamAsInt ( iThreadIndex, 1 );
+        iMax = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        g_iRandState = g_iRandState * 1103515245 + 12345;
+
+        XS_ReturnInt ( iThreadIndex, 2, iMin + ( int ) ( ( g_iRandState >> 16 ) % ( iMax - iMin + 1 ) ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_MoveEnemyDroid ()
+    *
+    *       void MoveEnemyDroid ( int DroidIndex, int Dir, int Dist )
+    *
+    *   Moves an enemy droid in one of eight directions, keeping it inside the room.
+    */
+
+    void HAPI_MoveEnemyDroid ( int iThreadIndex )
+    {
+        static int piDirX [] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+        static int piDirY [] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+        int iDroidIndex = XS_GetParamAsInt ( iThreadIndex, 2 );
+        int iDir = XS_GetParamAsInt ( iThreadIndex, 1 ) & 7;
+        int iDist = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        Droid * pDroid = & g_Droids [ iDroidIndex % DROID_COUNT ];
+
+        pDroid->iX += piDirX [ iDir ] * iDist;
+        pDroid->iY += piDirY [ iDir ] * iDist;
+
+        if ( pDroid->iX < 0 )
+            pDroid->iX = 0;
+        if ( pDroid->iX >= ROOM_WIDTH )
+            pDroid->iX = ROOM_WIDTH - 1;
+        if ( pDroid->iY < 0 )
+            pDroid->iY = 0;
+        if ( pDroid->iY >= ROOM_HEIGHT )
+            pDroid->iY = ROOM_HEIGHT - 1;
+
+        XS_Return ( iThreadIndex, 3 );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_GetEnemyDroidX ()
+    *
+    *       int GetEnemyDroidX ( int DroidIndex )
+    *
+    *   Returns the X coordinate of an enemy droid.
+    */
+
+    void HAPI_GetEnemyDroidX ( int iThreadIndex )
+    {
+        int iDroidIndex = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        XS_ReturnInt ( iThreadIndex, 1, g_Droids [ iDroidIndex % DROID_COUNT ].iX );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_GetEnemyDroidY ()
+    *
+    *       int GetEnemyDroidY ( int DroidIndex )
+    *
+    *   Returns the Y coordinate of an enemy droid.
+    */
+
+    void HAPI_GetEnemyDroidY ( int iThreadIndex )
+    {
+        int iDroidIndex = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        XS_ReturnInt ( iThreadIndex, 1, g_Droids [ iDroidIndex % DROID_COUNT ].iY );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_IsEnemyDroidAlive ()
+    *
+    *       int IsEnemyDroidAlive ( int DroidIndex )
+    *
+    *   Determines whether or not an enemy droid is alive.
+    */
+
+    void HAPI_IsEnemyDroidAlive ( int iThreadIndex )
+    {
+        int iDroidIndex = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        XS_ReturnInt ( iThreadIndex, 1, g_Droids [ iDroidIndex % DROID_COUNT ].iIsActive );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_FireEnemyDroidGun ()
+    *
+    *       void FireEnemyDroidGun ( int DroidIndex )
+    *
+    *   Fires an enemy droid's gun, which in the stub room can only hit the player by
+    *   pushing it aside.
+    */
+
+    void HAPI_FireEnemyDroidGun ( int iThreadIndex )
+    {
+        int iDroidIndex = XS_GetParamAsInt ( iThreadIndex, 0 );
+
+        g_iPlayerX = ( g_iPlayerX + g_Droids [ iDroidIndex % DROID_COUNT ].iX ) % ROOM_WIDTH;
+
+        XS_Return ( iThreadIndex, 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_GetPlayerDroidX ()
+    *
+    *       int GetPlayerDroidX ()
+    *
+    *   Returns the X coordinate of the player droid.
+    */
+
+    void HAPI_GetPlayerDroidX ( int iThreadIndex )
+    {
+        XS_ReturnInt ( iThreadIndex, 0, g_iPlayerX );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_GetPlayerDroidY ()
+    *
+    *       int GetPlayerDroidY ()
+    *
+    *   Returns the Y coordinate of the player droid.
+    */
+
+    void HAPI_GetPlayerDroidY ( int iThreadIndex )
+    {
+        XS_ReturnInt ( iThreadIndex, 0, g_iPlayerY );
+    }
+
+    /******************************************************************************************
+    *
+    *   InitHostAPI ()
+    *
+    *   Registers the stub host API and puts the stub room and checksum in their starting
+    *   state. Called after XS_Init (), before every run.
+    */
+
+    void InitHostAPI ()
+    {
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "Report", HAPI_Report );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "PauseThread", HAPI_PauseThread );
+
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "GetRandInRange", HAPI_GetRandInRange );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "MoveEnemyDroid", HAPI_MoveEnemyDroid );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "GetEnemyDroidX", HAPI_GetEnemyDroidX );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "GetEnemyDroidY", HAPI_GetEnemyDroidY );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "IsEnemyDroidAlive", HAPI_IsEnemyDroidAlive );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "FireEnemyDroidGun", HAPI_FireEnemyDroidGun );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "GetPlayerDroidX", HAPI_GetPlayerDroidX );
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "GetPlayerDroidY", HAPI_GetPlayerDroidY );
+
+        // Spread the droids across the room, with every fourth one dead
+
+        for ( int iCurrDroid = 0; iCurrDroid < DROID_COUNT; ++ iCurrDroid )
+        {
+            g_Droids [ iCurrDroid ].iX = ( iCurrDroid * 97 ) % ROOM_WIDTH;
+            g_Droids [ iCurrDroid ].iY = ( iCurrDroid * 61 ) % ROOM_HEIGHT;
+            g_Droids [ iCurrDroid ].iIsActive = ( iCurrDroid % 4 != 3 );
+        }
+
+        g_iPlayerX = ROOM_WIDTH / 2;
+        g_iPlayerY = ROOM_HEIGHT / 2;
+
+        g_iRandState = 1;
+        g_iChecksum = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   FileExists ()
+    *
+    *   Returns TRUE if the specified file can be opened.
+    */
+
+    int FileExists ( char * pstrFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "rb" ) ) )
+            return FALSE;
+
+        fclose ( pFile );
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetBenchTime ()
+    *
+    *   Returns the current time in milliseconds. Like the XVM's own clock, it's read with
+    *   GetTickCount () on Windows and from the POSIX monotonic clock elsewhere.
+    */
+
+    unsigned int GetBenchTime ()
+    {
+        #ifdef _WIN32
+            return GetTickCount ();
+        #else
+            struct timespec Time;
+            clock_gettime ( CLOCK_MONOTONIC, & Time );
+            return ( unsigned int ) ( Time.tv_sec * 1000 + Time.tv_nsec / 1000000 );
+        #endif
+    }
+
+    /******************************************************************************************
+    *
+    *   RunTool ()
+    *
+    *   Runs a tool the specified number of times and returns the fastest time. The tools
+    *   don't report failure through their exit codes, so the output file is removed first
+    *   and checked for afterwards.
+    */
+
+    int RunTool ( char * pstrCommand, char * pstrOutputFilename, unsigned int * piTime )
+    {
+        * piTime = 0;
+
+        for ( int iCurrRun = 0; iCurrRun < g_iRunCount; ++ iCurrRun )
+        {
+            remove ( pstrOutputFilename );
+
+            unsigned int iStartTime = GetBenchTime ();
+            system ( pstrCommand );
+            unsigned int iTime = GetBenchTime () - iStartTime;
+
+            if ( ! FileExists ( pstrOutputFilename ) )
+                return FALSE;
+
+            if ( iCurrRun == 0 || iTime < * piTime )
+                * piTime = iTime;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBench ()
+    *
+    *   Compiles, assembles, loads and runs a benchmark, and fills in its result. Returns
+    *   FALSE if any step failed.
+    */
+
+    int RunBench ( Bench * pBench, BenchResult * pResult )
+    {
+        char pstrCommand [ MAX_COMMAND_SIZE ];
+
+        // Compile and assemble the script, sending the tools' output to a log
+
+        sprintf ( pstrCommand, "%s %s %s -N %s > XSBENCH.LOG", g_pstrXSC, pBench->pstrSourceFilename, pBench->pstrAsmFilename, pBench->pstrOptions );
+        if ( ! RunTool ( pstrCommand, pBench->pstrAsmFilename, & pResult->iCompileTime ) )
+        {
+            printf ( "%s: Could not compile %s; see XSBENCH.LOG.\n", pBench->pstrName, pBench->pstrSourceFilename );
+            return FALSE;
+        }
+
+        sprintf ( pstrCommand, "%s %s %s > XSBENCH.LOG", g_pstrXASM, pBench->pstrAsmFilename, pBench->pstrExecFilename );
+        if ( ! RunTool ( pstrCommand, pBench->pstrExecFilename, & pResult->iAssembleTime ) )
+        {
+            printf ( "%s: Could not assemble %s; see XSBENCH.LOG.\n", pBench->pstrName, pBench->pstrAsmFilename );
+            return FALSE;
+        }
+
+        int piThreads [ MAX_SCRIPT_COUNT ];
+        int iCurrRun,
+            iCurrScript;
+
+        // Time loading and unloading the script, which is too quick to time once
+
+        XS_Init ();
+        InitHostAPI ();
+
+        pResult->iLoadTime = 0;
+        for ( iCurrRun = 0; iCurrRun < g_iRunCount; ++ iCurrRun )
+        {
+            unsigned int iStartTime = GetBenchTime ();
+
+            for ( int iCurrLoad = 0; iCurrLoad < LOAD_COUNT; ++ iCurrLoad )
+            {
+                if ( XS_LoadScript ( pBench->pstrExecFilename, piThreads [ 0 ], XS_THREAD_PRIORITY_USER ) != XS_LOAD_OK )
+                {
+                    printf ( "%s: Could not load %s.\n", pBench->pstrName, pBench->pstrExecFilename );
+                    XS_ShutDown ();
+                    return FALSE;
+                }
+
+                XS_UnloadScript ( piThreads [ 0 ] );
+            }
+
+            unsigned int iTime = ( GetBenchTime () - iStartTime ) * 1000 / LOAD_COUNT;
+            if ( iCurrRun == 0 || iTime < pResult->iLoadTime )
+                pResult->iLoadTime = iTime;
+        }
+
+        XS_ShutDown ();
+
+        // Run the script, loading a copy for each thread. Multiple copies rotate through the
+        // priorities so the scheduler has timeslices of every length to deal with.
+
+        static int piPriorities [] = { XS_THREAD_PRIORITY_LOW, XS_THREAD_PRIORITY_MED, XS_THREAD_PRIORITY_HIGH };
+
+        for ( iCurrRun = 0; iCurrRun < g_iRunCount; ++ iCurrRun )
+        {
+            XS_Init ();
+            InitHostAPI ();
+
+            for ( iCurrScript = 0; iCurrScript < pBench->iScriptCount; ++ iCurrScript )
+            {
+                int iPriority = pBench->iScriptCount > 1 ? piPriorities [ iCurrScript % 3 ] : XS_THREAD_PRIORITY_USER;
+                if ( XS_LoadScript ( pBench->pstrExecFilename, piThreads [ iCurrScript ], iPriority ) != XS_LOAD_OK )
+                {
+                    printf ( "%s: Could not load %s.\n", pBench->pstrName, pBench->pstrExecFilename );
+                    XS_ShutDown ();
+                    return FALSE;
+                }
+
+                XS_StartScript ( piThreads [ iCurrScript ] );
+            }
+
+            unsigned int iStartTime = GetBenchTime ();
+            XS_RunScripts ( XS_INFINITE_TIMESLICE );
+            unsigned int iTime = GetBenchTime () - iStartTime;
+
+            // Keep the fastest run. Every run executes the same instructions.
+
+            if ( iCurrRun == 0 || iTime < pResult->iRunTime )
+                pResult->iRunTime = iTime;
+
+            pResult->iInstrCount = 0;
+            for ( iCurrScript = 0; iCurrScript < pBench->iScriptCount; ++ iCurrScript )
+                pResult->iInstrCount += XS_GetInstrCount ( piThreads [ iCurrScript ] );
+
+            pResult->iChecksum = g_iChecksum;
+
+            XS_ShutDown ();
+        }
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the command line
+
+        char * pstrBenchName = NULL;
+        int iIsValid = TRUE;
+
+        for ( int iCurrArg = 1; iCurrArg < argc; ++ iCurrArg )
+        {
+            char * pstrArg = argv [ iCurrArg ];
+
+            if ( strnicmp ( pstrArg, "-R:", 3 ) == 0 )
+                g_iRunCount = atoi ( & pstrArg [ 3 ] );
+            else if ( strnicmp ( pstrArg, "-O:", 3 ) == 0 )
+                g_pstrResultsFilename = & pstrArg [ 3 ];
+            else if ( strnicmp ( pstrArg, "-XSC:", 5 ) == 0 )
+                g_pstrXSC = & pstrArg [ 5 ];
+            else if ( strnicmp ( pstrArg, "-XASM:", 6 ) == 0 )
+                g_pstrXASM = & pstrArg [ 6 ];
+            else if ( pstrArg [ 0 ] != '-' && ! pstrBenchName )
+                pstrBenchName = pstrArg;
+            else
+                iIsValid = FALSE;
+        }
+
+        int iCurrBench;
+        if ( pstrBenchName )
+        {
+            for ( iCurrBench = 0; iCurrBench < BENCH_COUNT; ++ iCurrBench )
+                if ( stricmp ( pstrBenchName, g_Benches [ iCurrBench ].pstrName ) == 0 )
+                    break;
+
+            if ( iCurrBench == BENCH_COUNT )
+                iIsValid = FALSE;
+        }
+
+        if ( ! iIsValid || g_iRunCount <= 0 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        // Open the results file and write its header
+
+        FILE * pResultsFile;
+        if ( ! ( pResultsFile = fopen ( g_pstrResultsFilename, "w" ) ) )
+        {
+            printf ( "Could not open %s.\n", g_pstrResultsFilename );
+            return 1;
+        }
+
+        fprintf ( pResultsFile, "Benchmark,Threads,CompileMs,AssembleMs,LoadUs,RunMs,Instrs,InstrsPerSec,Checksum\n" );
+
+        printf ( "Benchmark  Threads  Compile  Assemble     Load      Run       Instrs   Instrs/Sec  Checksum\n" );
+        printf ( "---------  -------  -------  --------  -------  -------  -----------  -----------  --------\n" );
+
+        // Run each benchmark
+
+        int iIsFailed = FALSE;
+
+        for ( iCurrBench = 0; iCurrBench < BENCH_COUNT; ++ iCurrBench )
+        {
+            Bench * pBench = & g_Benches [ iCurrBench ];
+
+            if ( pstrBenchName && stricmp ( pstrBenchName, pBench->pstrName ) != 0 )
+                continue;
+
+            BenchResult Result;
+            if ( ! RunBench ( pBench, & Result ) )
+            {
+                iIsFailed = TRUE;
+                continue;
+            }
+
+            // A run too quick to time is counted as a millisecond
+
+            double dInstrsPerSec = ( double ) Result.iInstrCount * 1000 / ( Result.iRunTime ? Result.iRunTime : 1 );
+
+            fprintf ( pResultsFile, "%s,%d,%u,%u,%u,%u,%u,%.0f,%08x\n",
+                      pBench->pstrName, pBench->iScriptCount, Result.iCompileTime, Result.iAssembleTime,
+                      Result.iLoadTime, Result.iRunTime, Result.iInstrCount, dInstrsPerSec, Result.iChecksum );
+
+            printf ( "%-9s  %7d  %5ums  %6ums  %5uus  %5ums  %11u  %11.0f  %08x\n",
+                     pBench->pstrName, pBench->iScriptCount, Result.iCompileTime, Result.iAssembleTime,
+                     Result.iLoadTime, Result.iRunTime, Result.iInstrCount, dInstrsPerSec, Result.iChecksum );
+        }
+
+        fclose ( pResultsFile );
+
+        printf ( "\n" );
+        printf ( "Results written to %s.\n", g_pstrResultsFilename );
+
+        if ( iIsFailed )
+            return 1;
+
+        return 0;
+    }
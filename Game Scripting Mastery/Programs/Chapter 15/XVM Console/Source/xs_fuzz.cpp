@@ -0,0 +1,1668 @@
+/*
+
+    Project.
+
+        XtremeScript Differential Fuzzer
+
+    Abstract.
+
+        Generates random, well-formed XtremeScript programs, compiles each one with XSC and
+        XASM, and runs it through the XVM in several different ways. The reference run is the
+        unoptimized compiler output (-NT -I:0) executed by XS_RunScripts (); every other run
+        uses optimized compiler output, a different way of dispatching the script, or both,
+        and has to produce the same output and _RetVal. The output includes the final value of
+        every global, so a run that leaves the script in a different state is caught too.
+
+        When a program fails, it's minimized by removing and unwrapping statements for as long
+        as the same run keeps failing, and both the original and the minimized source are
+        saved.
+
+        Since the reference is built with the current tools, it can't catch a change that
+        breaks code generation for every run at once. With -Baseline, programs are limited
+        to what the original XSC and XASM handle correctly (no yield, switch, intrinsics or
+        local arrays), and the reference is also checked against XSFUZZ.REF, which holds the
+        results of the same programs built by the original tools. -Record writes that file,
+        given the original tools' commands. The original executables are run by this XVM,
+        since the original XVM ends XS_RunScripts () and XS_CallScriptFunc () at the first
+        Ret and so can't run the reference at all.
+
+        XSC and XASM are run as separate processes, so they can be given as any command line
+        that runs them on the host platform. The fuzzer itself only needs this file and the
+        XVM, so it also builds outside of Windows (g++ xvm.cpp xs_fuzz.cpp, for instance).
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "xvm.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Files -----------------------------------------------------------------------------
+
+        #define SOURCE_FILENAME             "XSFUZZ.XSS"        // The program being tested
+        #define REF_ASM_FILENAME            "XSFUZZ_R.XASM"     // Unoptimized compiler output
+        #define REF_EXEC_FILENAME           "XSFUZZ_R.XSE"
+        #define OPT_ASM_FILENAME            "XSFUZZ_O.XASM"     // Optimized compiler output
+        #define OPT_EXEC_FILENAME           "XSFUZZ_O.XSE"
+        #define LOG_FILENAME                "XSFUZZ.LOG"        // Tool output is sent here
+        #define BASELINE_FILENAME           "XSFUZZ.REF"        // The original tools' results
+
+        #define REF_COMPILE_OPTIONS         "-NT -I:0"          // Reference compiler options
+        #define OPT_COMPILE_OPTIONS         ""                  // Optimized compiler options
+        #define BASELINE_COMPILE_OPTIONS    ""                  // The original compiler's options
+
+    // ---- Fuzzing ---------------------------------------------------------------------------
+
+        #define DEFAULT_ITERATION_COUNT     100         // Programs to test by default
+        #define DEFAULT_SEED                1           // First program's seed by default
+
+        #define MAX_COMMAND_SIZE            1024        // Maximum tool command line size
+
+    // ---- Programs --------------------------------------------------------------------------
+
+        #define MAX_LINE_COUNT              4096        // Maximum lines in a program
+        #define MAX_STMT_COUNT              4096        // Maximum statements in a program
+        #define MAX_LINE_SIZE               1024        // Maximum size of a single line
+
+        #define MAX_HELPER_COUNT            3           // Maximum helper functions
+        #define MAX_EXPR_DEPTH              3           // Maximum expression nesting
+        #define MAX_STMT_DEPTH              3           // Maximum statement nesting
+        #define MAX_LOOP_DEPTH              2           // Maximum loop nesting, which is the
+                                                        // number of loop counters declared
+        #define MAX_LOOP_COUNT              4           // Maximum iterations of a loop, which
+                                                        // keeps loop counters valid as
+                                                        // array indices
+        #define ARRAY_SIZE                  4           // Size of each array
+
+        #define RUN_PARAM                   7           // Passed to Run ()
+
+    // ---- Runs ------------------------------------------------------------------------------
+
+        #define DISPATCH_RUN                0           // _Main () run by XS_RunScripts ()
+        #define DISPATCH_CALL               1           // Run () called with XS_CallScriptFunc ()
+        #define DISPATCH_COROUTINE          2           // Run () resumed as a coroutine
+        #define DISPATCH_BATCH              3           // Run () called in every lane of a batch
+
+        #define MODE_COUNT                  7           // The number of runs per program
+        #define MODE_REF_RUN                0           // The run whose output is expected
+        #define MODE_REF_CALL               1           // The run whose _RetVal is expected
+
+        #define BATCH_LANE_COUNT            4           // Lanes in a batch run
+
+        #define MAX_OUTPUT_SIZE             65536       // Output past this size is dropped
+
+        #define TEST_PASSED                 -1          // Every run matched the reference
+        #define TEST_INVALID                -2          // The reference couldn't be run
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct _Line                                // A line of a generated program
+    {
+        char pstrText [ MAX_LINE_SIZE ];                // The line's text
+        int iIndent;                                    // Its indentation level
+        int iIsDeleted;                                 // Has the minimizer removed it?
+    }
+        Line;
+
+    typedef struct _Stmt                                // A statement of a generated program
+    {
+        int iFirstLine;                                 // The lines it spans, inclusive
+        int iLastLine;
+        int iBodyFirstLine;                             // The lines kept when it's unwrapped,
+        int iBodyLastLine;                              // or -1 if it can't be
+        int iIsFixed;                                   // Set if the minimizer can't remove it,
+                                                        // usually because the program could
+                                                        // hang or read uninitialized data
+                                                        // without it
+    }
+        Stmt;
+
+    typedef struct _Mode                                // A way of running a program
+    {
+        char * pstrName;                                // The mode's name
+        int iIsOptimized;                               // Does it use optimized output?
+        int iDispatch;                                  // How is the script run?
+    }
+        Mode;
+
+    typedef struct _Result                              // The result of a single run
+    {
+        char * pstrOutput;                              // Everything passed to Out ()
+        int iOutputSize;                                // The output's size
+        int iRetInt;                                    // _RetVal as an integer
+        float fRetFloat;                                // _RetVal as a float
+    }
+        Result;
+
+    typedef struct _Baseline                            // A program's results with the
+    {                                                   // original tools
+        unsigned int iSeed;                             // The program's seed
+        int iOutputSize;                                // The output's size
+        unsigned int iOutputHash;                       // The output's hash
+        int iRetInt;                                    // _RetVal as an integer
+        unsigned int iRetFloatBits;                     // _RetVal as a float, by its bits
+    }
+        Baseline;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    // ---- Tools -----------------------------------------------------------------------------
+
+    char * g_pstrXSC = "XSC";                           // The compiler's command
+    char * g_pstrXASM = "XASM";                         // The assembler's command
+
+    // ---- Program ---------------------------------------------------------------------------
+
+    Line g_Lines [ MAX_LINE_COUNT ];                    // The program's lines
+    int g_iLineCount;
+
+    Stmt g_Stmts [ MAX_STMT_COUNT ];                    // The program's statements
+    int g_iStmtCount;
+
+    // ---- Generator -------------------------------------------------------------------------
+
+    unsigned int g_iRandState;                          // The random number generator's state
+
+    int g_iHelperCount;                                 // The number of helper functions
+    int g_iCurrFunc;                                    // The function being generated, which
+                                                        // can only call helpers before it
+    int g_iCurrLoopDepth;                               // Loops around the current statement
+
+    int g_iIsBaselineLang;                              // Only generate what the original
+                                                        // tools handle?
+
+    // ---- Runs ------------------------------------------------------------------------------
+
+    Mode g_Modes [ MODE_COUNT ] =
+    {
+        { "Reference, XS_RunScripts ()",        FALSE,  DISPATCH_RUN },
+        { "Reference, XS_CallScriptFunc ()",    FALSE,  DISPATCH_CALL },
+        { "Reference, batch",                   FALSE,  DISPATCH_BATCH },
+        { "Optimized, XS_RunScripts ()",        TRUE,   DISPATCH_RUN },
+        { "Optimized, XS_CallScriptFunc ()",    TRUE,   DISPATCH_CALL },
+        { "Optimized, coroutine",               TRUE,   DISPATCH_COROUTINE },
+        { "Optimized, batch",                   TRUE,   DISPATCH_BATCH }
+    };
+
+    Result g_Results [ MODE_COUNT ][ BATCH_LANE_COUNT ]; // Each run's results, by lane
+    Result * g_pCurrResults;                            // The run in progress
+
+    char g_pstrMismatch [ MAX_LINE_SIZE ];              // Describes the last failure
+
+    // ---- Baseline --------------------------------------------------------------------------
+
+    int g_iIsRecording;                                 // Are the tools the original ones,
+                                                        // and their results being recorded?
+
+    Baseline * g_pBaselines;                            // The original tools' results
+    int g_iBaselineCount;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    int Rand ( int iRange );
+
+    int AddLine ( int iIndent, char * pstrText );
+    int BeginStmt ();
+    void EndStmt ( int iStmt );
+    int AddStmt ( int iIndent, char * pstrText, int iIsFixed );
+
+    char * GetNumVar ();
+    void GenArrayElmnt ( char * pstrElmnt );
+    void GenNumExpr ( char * pstrExpr, int iDepth );
+    void GenCond ( char * pstrCond, int iDepth );
+    void GenBlock ( int iIndent, int iDepth, int iStmtCount );
+    void GenStmt ( int iIndent, int iDepth );
+    void GenFunc ( int iFunc );
+    void GenProgram ( unsigned int iSeed );
+
+    int WriteProgram ( char * pstrFilename );
+    int FileExists ( char * pstrFilename );
+    int Compile ( int iIsOptimized );
+
+    void HAPI_Out ( int iThreadIndex );
+    void ResetResults ();
+    int RunMode ( int iMode );
+    int CompareResults ( int iMode );
+    int TestProgram ();
+
+    void Minimize ( int iFailedMode );
+
+    unsigned int HashOutput ( Result * pResult );
+    int ReadBaselines ();
+    int WriteBaseline ( FILE * pFile, unsigned int iSeed );
+    Baseline * GetBaseline ( unsigned int iSeed );
+    int CompareBaseline ( unsigned int iSeed );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "XtremeScript Differential Fuzzer\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tXSFUZZ [Iterations] [Seed] [Options]\n" );
+        printf ( "\n" );
+        printf ( "\t-XSC:Command    Runs the compiler with this command (XSC by default)\n" );
+        printf ( "\t-XASM:Command   Runs the assembler with this command (XASM by default)\n" );
+        printf ( "\t-Baseline       Only tests what the original tools handle, and checks the\n" );
+        printf ( "\t                reference against their results in %s\n", BASELINE_FILENAME );
+        printf ( "\t-Record         Writes %s, with the original tools given as the\n", BASELINE_FILENAME );
+        printf ( "\t                compiler and assembler\n" );
+        printf ( "\n" );
+        printf ( "Notes:\n" );
+        printf ( "\t- Iterations is the number of programs to test (%d by default).\n", DEFAULT_ITERATION_COUNT );
+        printf ( "\t- Each program is generated from its own seed, starting at Seed (%d by\n", DEFAULT_SEED );
+        printf ( "\t  default), so a failure can be reproduced by running from its seed.\n" );
+        printf ( "\t- Failing programs are saved as XSFUZZ_Seed.XSS and minimized to\n" );
+        printf ( "\t  XSFUZZ_Seed_MIN.XSS. If the fuzzer itself crashes, the program that\n" );
+        printf ( "\t  caused it is left in %s.\n", SOURCE_FILENAME );
+        printf ( "\t- %s is read from the current directory, and only covers the seeds\n", BASELINE_FILENAME );
+        printf ( "\t  that were recorded (1 to 1000 in the one that ships with this file).\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   Rand ()
+    *
+    *   Returns a random number from zero to one less than the specified range. The generator
+    *   is implemented here, rather than with rand (), so a seed produces the same program on
+    *   every platform.
+    */
+
+    int Rand ( int iRange )
+    {
+        g_iRandState = g_iRandState * 1103515245 + 12345;
+        return ( g_iRandState >> 16 ) % iRange;
+    }
+
+    /******************************************************************************************
+    *
+    *   AddLine ()
+    *
+    *   Adds a line to the program and returns its index.
+    */
+
+    int AddLine ( int iIndent, char * pstrText )
+    {
+        if ( g_iLineCount >= MAX_LINE_COUNT )
+            return g_iLineCount - 1;
+
+        Line * pLine = & g_Lines [ g_iLineCount ];
+        strcpy ( pLine->pstrText, pstrText );
+        pLine->iIndent = iIndent;
+        pLine->iIsDeleted = FALSE;
+
+        return g_iLineCount ++;
+    }
+
+    /******************************************************************************************
+    *
+    *   BeginStmt ()
+    *
+    *   Starts a statement at the next line and returns its index. The statement spans every
+    *   line added until it's ended with EndStmt ().
+    */
+
+    int BeginStmt ()
+    {
+        if ( g_iStmtCount >= MAX_STMT_COUNT )
+            return -1;
+
+        Stmt * pStmt = & g_Stmts [ g_iStmtCount ];
+        pStmt->iFirstLine = g_iLineCount;
+        pStmt->iLastLine = g_iLineCount - 1;
+        pStmt->iBodyFirstLine = -1;
+        pStmt->iBodyLastLine = -1;
+        pStmt->iIsFixed = FALSE;
+
+        return g_iStmtCount ++;
+    }
+
+    /******************************************************************************************
+    *
+    *   EndStmt ()
+    *
+    *   Ends a statement at the last line added.
+    */
+
+    void EndStmt ( int iStmt )
+    {
+        if ( iStmt != -1 )
+            g_Stmts [ iStmt ].iLastLine = g_iLineCount - 1;
+    }
+
+    /******************************************************************************************
+    *
+    *   AddStmt ()
+    *
+    *   Adds a single-line statement and returns its index.
+    */
+
+    int AddStmt ( int iIndent, char * pstrText, int iIsFixed )
+    {
+        int iStmt = BeginStmt ();
+        AddLine ( iIndent, pstrText );
+        EndStmt ( iStmt );
+
+        if ( iStmt != -1 )
+            g_Stmts [ iStmt ].iIsFixed = iIsFixed;
+
+        return iStmt;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetNumVar ()
+    *
+    *   Returns the name of a random numeric variable that the current function can assign.
+    *   Helpers take the parameters a and b, while Test () takes p.
+    */
+
+    char * GetNumVar ()
+    {
+        static char * ppstrHelperVars [] = { "g0", "g1", "g2", "a", "b", "l0", "l1" };
+        static char * ppstrTestVars [] = { "g0", "g1", "g2", "p", "l0", "l1" };
+
+        if ( g_iCurrFunc < g_iHelperCount )
+            return ppstrHelperVars [ Rand ( 7 ) ];
+        else
+            return ppstrTestVars [ Rand ( 6 ) ];
+    }
+
+    /******************************************************************************************
+    *
+    *   GenArrayElmnt ()
+    *
+    *   Generates a reference to an array element. The index is either a literal or the
+    *   counter of a loop around the statement, both of which are always in range. The
+    *   original XASM laid a local array over the locals declared before it, so only the
+    *   global array is used when generating for the original tools.
+    */
+
+    void GenArrayElmnt ( char * pstrElmnt )
+    {
+        char * pstrArray = ( char * ) ( Rand ( 2 ) || g_iIsBaselineLang ? "gArr" : "la" );
+
+        if ( g_iCurrLoopDepth && Rand ( 2 ) )
+            sprintf ( pstrElmnt, "%s [ i%d ]", pstrArray, Rand ( g_iCurrLoopDepth ) );
+        else
+            sprintf ( pstrElmnt, "%s [ %d ]", pstrArray, Rand ( ARRAY_SIZE ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   GenNumExpr ()
+    *
+    *   Generates a numeric expression. Strings are kept out of arithmetic entirely, since an
+    *   arithmetic instruction with a string destination is undefined, and divisors are
+    *   non-zero literals.
+    */
+
+    void GenNumExpr ( char * pstrExpr, int iDepth )
+    {
+        static char * ppstrOps [] = { "+", "-", "*" };
+        static char * ppstrRelOps [] = { "==", "!=", "<", ">", "<=", ">=" };
+
+        char pstrExpr0 [ MAX_LINE_SIZE ],
+             pstrExpr1 [ MAX_LINE_SIZE ];
+
+        int iChoice = Rand ( iDepth < MAX_EXPR_DEPTH ? 10 : 4 );
+        if ( iChoice == 9 && g_iCurrFunc == 0 )
+            iChoice = 4;
+        if ( iChoice == 8 && g_iIsBaselineLang )
+            iChoice = 5;
+
+        switch ( iChoice )
+        {
+            case 0:
+                sprintf ( pstrExpr, "%d", Rand ( 20 ) );
+                break;
+
+            case 1:
+                sprintf ( pstrExpr, "%d.%d", Rand ( 10 ), Rand ( 10 ) );
+                break;
+
+            case 2:
+                if ( g_iCurrLoopDepth && Rand ( 3 ) == 0 )
+                    sprintf ( pstrExpr, "i%d", Rand ( g_iCurrLoopDepth ) );
+                else
+                    strcpy ( pstrExpr, GetNumVar () );
+                break;
+
+            case 3:
+                GenArrayElmnt ( pstrExpr );
+                break;
+
+            case 4:
+            case 5:
+                GenNumExpr ( pstrExpr0, iDepth + 1 );
+                GenNumExpr ( pstrExpr1, iDepth + 1 );
+                sprintf ( pstrExpr, "( %s %s %s )", pstrExpr0, ppstrOps [ Rand ( 3 ) ], pstrExpr1 );
+                break;
+
+            case 6:
+                GenNumExpr ( pstrExpr0, iDepth + 1 );
+                sprintf ( pstrExpr, "( %s %s %d )", pstrExpr0, Rand ( 2 ) ? "/" : "%", 1 + Rand ( 7 ) );
+                break;
+
+            case 7:
+                GenNumExpr ( pstrExpr0, iDepth + 1 );
+                if ( Rand ( 3 ) == 0 )
+                {
+                    sprintf ( pstrExpr, "- ( %s )", pstrExpr0 );
+                }
+                else
+                {
+                    GenNumExpr ( pstrExpr1, iDepth + 1 );
+                    sprintf ( pstrExpr, "( %s %s %s )", pstrExpr0, ppstrRelOps [ Rand ( 6 ) ], pstrExpr1 );
+                }
+                break;
+
+            case 8:
+                GenNumExpr ( pstrExpr0, iDepth + 1 );
+                switch ( Rand ( 4 ) )
+                {
+                    case 0:
+                        sprintf ( pstrExpr, "abs ( %s )", pstrExpr0 );
+                        break;
+
+                    case 1:
+                        sprintf ( pstrExpr, "sqrt ( abs ( %s ) )", pstrExpr0 );
+                        break;
+
+                    default:
+                        GenNumExpr ( pstrExpr1, iDepth + 1 );
+                        sprintf ( pstrExpr, "%s ( %s, %s )", Rand ( 2 ) ? "min" : "max", pstrExpr0, pstrExpr1 );
+                }
+                break;
+
+            case 9:
+                GenNumExpr ( pstrExpr0, iDepth + 1 );
+                GenNumExpr ( pstrExpr1, iDepth + 1 );
+                sprintf ( pstrExpr, "f%d ( %s, %s )", Rand ( g_iCurrFunc ), pstrExpr0, pstrExpr1 );
+                break;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GenCond ()
+    *
+    *   Generates the condition of an if or while statement.
+    */
+
+    void GenCond ( char * pstrCond, int iDepth )
+    {
+        static char * ppstrRelOps [] = { "==", "!=", "<", ">", "<=", ">=" };
+
+        char pstrCond0 [ MAX_LINE_SIZE ],
+             pstrCond1 [ MAX_LINE_SIZE ];
+
+        switch ( Rand ( iDepth < MAX_EXPR_DEPTH - 1 ? 6 : 3 ) )
+        {
+            case 3:
+                GenCond ( pstrCond0, iDepth + 1 );
+                GenCond ( pstrCond1, iDepth + 1 );
+                sprintf ( pstrCond, "( %s ) && ( %s )", pstrCond0, pstrCond1 );
+                break;
+
+            case 4:
+                GenCond ( pstrCond0, iDepth + 1 );
+                GenCond ( pstrCond1, iDepth + 1 );
+                sprintf ( pstrCond, "( %s ) || ( %s )", pstrCond0, pstrCond1 );
+                break;
+
+            case 5:
+                GenCond ( pstrCond0, iDepth + 1 );
+                sprintf ( pstrCond, "! ( %s )", pstrCond0 );
+                break;
+
+            default:
+                GenNumExpr ( pstrCond0, iDepth + 1 );
+                GenNumExpr ( pstrCond1, iDepth + 1 );
+                sprintf ( pstrCond, "%s %s %s", pstrCond0, ppstrRelOps [ Rand ( 6 ) ], pstrCond1 );
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GenBlock ()
+    *
+    *   Generates a block of statements at the specified indentation level.
+    */
+
+    void GenBlock ( int iIndent, int iDepth, int iStmtCount )
+    {
+        for ( int iCurrStmt = 0; iCurrStmt < iStmtCount; ++ iCurrStmt )
+            GenStmt ( iIndent, iDepth );
+    }
+
+    /******************************************************************************************
+    *
+    *   GenStmt ()
+    *
+    *   Generates a random statement. Loops always count up from zero to a small literal with
+    *   a counter that nothing else assigns, and functions only call helpers defined before
+    *   them, so every program terminates.
+    */
+
+    void GenStmt ( int iIndent, int iDepth )
+    {
+        char pstrLine [ MAX_LINE_SIZE ],
+             pstrExpr0 [ MAX_LINE_SIZE ],
+             pstrExpr1 [ MAX_LINE_SIZE ];
+
+        int iStmt;
+
+        int iChoice = Rand ( iDepth < MAX_STMT_DEPTH ? 10 : 6 );
+        if ( iChoice == 8 && g_iCurrLoopDepth >= MAX_LOOP_DEPTH )
+            iChoice = 6;
+        if ( iChoice == 9 && g_iIsBaselineLang )
+            iChoice = 7;
+
+        switch ( iChoice )
+        {
+            // Assignment
+
+            case 0:
+            case 1:
+                GenNumExpr ( pstrExpr0, 0 );
+                if ( Rand ( 3 ) == 0 )
+                {
+                    GenArrayElmnt ( pstrExpr1 );
+                    sprintf ( pstrLine, "%s = %s;", pstrExpr1, pstrExpr0 );
+                }
+                else
+                {
+                    sprintf ( pstrLine, "%s = %s;", GetNumVar (), pstrExpr0 );
+                }
+                AddStmt ( iIndent, pstrLine, FALSE );
+                break;
+
+            // String concatenation. XASM only accepts a string or a variable as the source
+            // of Concat, so a number is always appended through a variable, which also
+            // keeps XSC from folding it into a literal.
+
+            case 2:
+            {
+                char * pstrString = ( char * ) ( Rand ( 2 ) ? "gS" : "ls" );
+                if ( Rand ( 3 ) == 0 )
+                {
+                    sprintf ( pstrLine, "%s = %s $ \"%c\";", pstrString, pstrString, 'a' + Rand ( 26 ) );
+                }
+                else
+                {
+                    if ( Rand ( 2 ) )
+                        GenArrayElmnt ( pstrExpr1 );
+                    else
+                        strcpy ( pstrExpr1, GetNumVar () );
+
+                    if ( Rand ( 2 ) )
+                    {
+                        GenNumExpr ( pstrExpr0, 1 );
+                        sprintf ( pstrLine, "%s = %s $ ( %s + %s );", pstrString, pstrString, pstrExpr1, pstrExpr0 );
+                    }
+                    else
+                    {
+                        sprintf ( pstrLine, "%s = %s $ %s;", pstrString, pstrString, pstrExpr1 );
+                    }
+                }
+                AddStmt ( iIndent, pstrLine, FALSE );
+                break;
+            }
+
+            // Output
+
+            case 3:
+                if ( Rand ( 3 ) == 0 )
+                {
+                    sprintf ( pstrLine, "Out ( %s );", Rand ( 2 ) ? "gS" : "ls" );
+                }
+                else
+                {
+                    GenNumExpr ( pstrExpr0, 0 );
+                    sprintf ( pstrLine, "Out ( %s );", pstrExpr0 );
+                }
+                AddStmt ( iIndent, pstrLine, FALSE );
+                break;
+
+            // A call, yield or break. The original language has no yield, so there's an
+            // extra output instead.
+
+            case 4:
+            case 5:
+                if ( g_iCurrLoopDepth && Rand ( 4 ) == 0 )
+                {
+                    AddStmt ( iIndent, "break;", FALSE );
+                }
+                else if ( g_iCurrFunc && Rand ( 2 ) )
+                {
+                    GenNumExpr ( pstrExpr0, 1 );
+                    GenNumExpr ( pstrExpr1, 1 );
+                    sprintf ( pstrLine, "f%d ( %s, %s );", Rand ( g_iCurrFunc ), pstrExpr0, pstrExpr1 );
+                    AddStmt ( iIndent, pstrLine, FALSE );
+                }
+                else if ( g_iIsBaselineLang )
+                {
+                    GenNumExpr ( pstrExpr0, 1 );
+                    sprintf ( pstrLine, "Out ( %s );", pstrExpr0 );
+                    AddStmt ( iIndent, pstrLine, FALSE );
+                }
+                else if ( Rand ( 2 ) )
+                {
+                    GenNumExpr ( pstrExpr0, 1 );
+                    sprintf ( pstrLine, "yield %s;", pstrExpr0 );
+                    AddStmt ( iIndent, pstrLine, FALSE );
+                }
+                else
+                {
+                    AddStmt ( iIndent, "yield;", FALSE );
+                }
+                break;
+
+            // if and if/else
+
+            case 6:
+            case 7:
+            {
+                iStmt = BeginStmt ();
+
+                GenCond ( pstrExpr0, 0 );
+                sprintf ( pstrLine, "if ( %s )", pstrExpr0 );
+                AddLine ( iIndent, pstrLine );
+                AddLine ( iIndent, "{" );
+
+                int iBodyFirstLine = g_iLineCount;
+                GenBlock ( iIndent + 1, iDepth + 1, 1 + Rand ( 3 ) );
+                int iBodyLastLine = g_iLineCount - 1;
+
+                AddLine ( iIndent, "}" );
+
+                if ( iChoice == 7 )
+                {
+                    AddLine ( iIndent, "else" );
+                    AddLine ( iIndent, "{" );
+                    GenBlock ( iIndent + 1, iDepth + 1, 1 + Rand ( 3 ) );
+                    AddLine ( iIndent, "}" );
+                }
+
+                EndStmt ( iStmt );
+                if ( iStmt != -1 )
+                {
+                    g_Stmts [ iStmt ].iBodyFirstLine = iBodyFirstLine;
+                    g_Stmts [ iStmt ].iBodyLastLine = iBodyLastLine;
+                }
+                break;
+            }
+
+            // while
+
+            case 8:
+            {
+                int iCounter = g_iCurrLoopDepth;
+
+                sprintf ( pstrLine, "i%d = 0;", iCounter );
+                AddStmt ( iIndent, pstrLine, TRUE );
+
+                iStmt = BeginStmt ();
+
+                sprintf ( pstrLine, "while ( i%d < %d )", iCounter, 1 + Rand ( MAX_LOOP_COUNT ) );
+                AddLine ( iIndent, pstrLine );
+                AddLine ( iIndent, "{" );
+
+                int iBodyFirstLine = g_iLineCount;
+                ++ g_iCurrLoopDepth;
+                GenBlock ( iIndent + 1, iDepth + 1, 1 + Rand ( 3 ) );
+                -- g_iCurrLoopDepth;
+
+                sprintf ( pstrLine, "i%d = i%d + 1;", iCounter, iCounter );
+                AddStmt ( iIndent + 1, pstrLine, TRUE );
+                int iBodyLastLine = g_iLineCount - 1;
+
+                AddLine ( iIndent, "}" );
+
+                EndStmt ( iStmt );
+                if ( iStmt != -1 )
+                {
+                    g_Stmts [ iStmt ].iBodyFirstLine = iBodyFirstLine;
+                    g_Stmts [ iStmt ].iBodyLastLine = iBodyLastLine;
+                }
+                break;
+            }
+
+            // switch, with each case as a statement of its own
+
+            case 9:
+            {
+                iStmt = BeginStmt ();
+
+                if ( g_iCurrLoopDepth && Rand ( 2 ) )
+                {
+                    sprintf ( pstrLine, "switch ( i%d )", Rand ( g_iCurrLoopDepth ) );
+                }
+                else
+                {
+                    GenNumExpr ( pstrExpr0, 1 );
+                    sprintf ( pstrLine, "switch ( %s )", pstrExpr0 );
+                }
+                AddLine ( iIndent, pstrLine );
+                AddLine ( iIndent, "{" );
+
+                int iCaseValue = Rand ( 3 ) - 1;
+                int iCaseCount = 1 + Rand ( 3 );
+                for ( int iCurrCase = 0; iCurrCase <= iCaseCount; ++ iCurrCase )
+                {
+                    // The last case is the default, if there is one
+
+                    if ( iCurrCase == iCaseCount && Rand ( 2 ) )
+                        break;
+
+                    int iCaseStmt = BeginStmt ();
+
+                    if ( iCurrCase == iCaseCount )
+                    {
+                        AddLine ( iIndent + 1, "default:" );
+                    }
+                    else
+                    {
+                        sprintf ( pstrLine, "case %d:", iCaseValue );
+                        AddLine ( iIndent + 1, pstrLine );
+                        iCaseValue += 1 + Rand ( 3 );
+                    }
+
+                    GenBlock ( iIndent + 2, iDepth + 1, 1 + Rand ( 2 ) );
+                    if ( Rand ( 3 ) )
+                        AddStmt ( iIndent + 2, "break;", FALSE );
+
+                    EndStmt ( iCaseStmt );
+                }
+
+                AddLine ( iIndent, "}" );
+
+                EndStmt ( iStmt );
+                break;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GenFunc ()
+    *
+    *   Generates a helper function, or Test () if the index is past the last helper. Every
+    *   local is given a value before the function's body runs, since an uninitialized local
+    *   can legitimately differ between runs.
+    */
+
+    void GenFunc ( int iFunc )
+    {
+        char pstrLine [ MAX_LINE_SIZE ];
+
+        g_iCurrFunc = iFunc;
+        g_iCurrLoopDepth = 0;
+
+        int iFuncStmt = BeginStmt ();
+
+        if ( iFunc < g_iHelperCount )
+            sprintf ( pstrLine, "func f%d ( a, b )", iFunc );
+        else
+            strcpy ( pstrLine, "func Test ( p )" );
+        AddLine ( 0, pstrLine );
+        AddLine ( 0, "{" );
+
+        // Declare the locals
+
+        AddStmt ( 1, "var l0;", FALSE );
+        AddStmt ( 1, "var l1;", FALSE );
+        AddStmt ( 1, "var ls;", FALSE );
+        if ( ! g_iIsBaselineLang )
+        {
+            sprintf ( pstrLine, "var la [ %d ];", ARRAY_SIZE );
+            AddStmt ( 1, pstrLine, FALSE );
+        }
+        for ( int iCurrCounter = 0; iCurrCounter < MAX_LOOP_DEPTH; ++ iCurrCounter )
+        {
+            sprintf ( pstrLine, "var i%d;", iCurrCounter );
+            AddStmt ( 1, pstrLine, FALSE );
+        }
+        AddLine ( 0, "" );
+
+        // Initialize them
+
+        sprintf ( pstrLine, "l0 = %d;", Rand ( 20 ) );
+        AddStmt ( 1, pstrLine, TRUE );
+        sprintf ( pstrLine, "l1 = %d.%d;", Rand ( 10 ), Rand ( 10 ) );
+        AddStmt ( 1, pstrLine, TRUE );
+        sprintf ( pstrLine, "ls = \"%c\";", 'a' + Rand ( 26 ) );
+        AddStmt ( 1, pstrLine, TRUE );
+        for ( int iCurrElmnt = 0; iCurrElmnt < ARRAY_SIZE && ! g_iIsBaselineLang; ++ iCurrElmnt )
+        {
+            sprintf ( pstrLine, "la [ %d ] = %d;", iCurrElmnt, Rand ( 20 ) );
+            AddStmt ( 1, pstrLine, TRUE );
+        }
+        AddLine ( 0, "" );
+
+        // Generate the body
+
+        GenBlock ( 1, 0, 3 + Rand ( 5 ) );
+
+        // Return a value
+
+        char pstrExpr [ MAX_LINE_SIZE ];
+        GenNumExpr ( pstrExpr, 1 );
+        sprintf ( pstrLine, "return %s;", pstrExpr );
+        AddLine ( 0, "" );
+        AddStmt ( 1, pstrLine, TRUE );
+
+        AddLine ( 0, "}" );
+        AddLine ( 0, "" );
+
+        EndStmt ( iFuncStmt );
+        if ( iFuncStmt != -1 && iFunc == g_iHelperCount )
+            g_Stmts [ iFuncStmt ].iIsFixed = TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   GenProgram ()
+    *
+    *   Generates a program from the specified seed. Besides the helpers and Test (), every
+    *   program has the same frame: Run () gives the globals their starting values, calls
+    *   Test (), and then outputs the globals with Dump () and Test ()'s return value, which
+    *   it also returns. _Main () just calls Run ().
+    */
+
+    void GenProgram ( unsigned int iSeed )
+    {
+        char pstrLine [ MAX_LINE_SIZE ];
+        int iStmt;
+        int iCurrElmnt;
+
+        g_iRandState = iSeed;
+        g_iLineCount = 0;
+        g_iStmtCount = 0;
+
+        // Globals and the host API
+
+        AddLine ( 0, "host Out ();" );
+        AddLine ( 0, "" );
+        AddLine ( 0, "var g0;" );
+        AddLine ( 0, "var g1;" );
+        AddLine ( 0, "var g2;" );
+        AddLine ( 0, "var gS;" );
+        sprintf ( pstrLine, "var gArr [ %d ];", ARRAY_SIZE );
+        AddLine ( 0, pstrLine );
+        AddLine ( 0, "" );
+
+        // Helpers and Test ()
+
+        g_iHelperCount = Rand ( MAX_HELPER_COUNT + 1 );
+        for ( int iCurrFunc = 0; iCurrFunc <= g_iHelperCount; ++ iCurrFunc )
+            GenFunc ( iCurrFunc );
+
+        // Dump ()
+
+        iStmt = BeginStmt ();
+        AddLine ( 0, "func Dump ()" );
+        AddLine ( 0, "{" );
+        AddStmt ( 1, "Out ( g0 );", FALSE );
+        AddStmt ( 1, "Out ( g1 );", FALSE );
+        AddStmt ( 1, "Out ( g2 );", FALSE );
+        AddStmt ( 1, "Out ( gS );", FALSE );
+        for ( iCurrElmnt = 0; iCurrElmnt < ARRAY_SIZE; ++ iCurrElmnt )
+        {
+            sprintf ( pstrLine, "Out ( gArr [ %d ] );", iCurrElmnt );
+            AddStmt ( 1, pstrLine, FALSE );
+        }
+        AddLine ( 0, "}" );
+        AddLine ( 0, "" );
+        EndStmt ( iStmt );
+        if ( iStmt != -1 )
+            g_Stmts [ iStmt ].iIsFixed = TRUE;
+
+        // Run ()
+
+        AddLine ( 0, "func Run ( p )" );
+        AddLine ( 0, "{" );
+        AddLine ( 1, "var r;" );
+        AddLine ( 0, "" );
+        sprintf ( pstrLine, "g0 = %d;", Rand ( 20 ) );
+        AddLine ( 1, pstrLine );
+        sprintf ( pstrLine, "g1 = %d.%d;", Rand ( 10 ), Rand ( 10 ) );
+        AddLine ( 1, pstrLine );
+        sprintf ( pstrLine, "g2 = %d;", Rand ( 20 ) );
+        AddLine ( 1, pstrLine );
+        AddLine ( 1, "gS = \"g\";" );
+        for ( iCurrElmnt = 0; iCurrElmnt < ARRAY_SIZE; ++ iCurrElmnt )
+        {
+            sprintf ( pstrLine, "gArr [ %d ] = %d;", iCurrElmnt, Rand ( 20 ) );
+            AddLine ( 1, pstrLine );
+        }
+        AddLine ( 0, "" );
+        AddLine ( 1, "r = Test ( p );" );
+        AddLine ( 1, "Dump ();" );
+        AddLine ( 1, "Out ( r );" );
+        AddLine ( 1, "return r;" );
+        AddLine ( 0, "}" );
+        AddLine ( 0, "" );
+
+        // _Main ()
+
+        AddLine ( 0, "func _Main ()" );
+        AddLine ( 0, "{" );
+        sprintf ( pstrLine, "Run ( %d );", RUN_PARAM );
+        AddLine ( 1, pstrLine );
+        AddLine ( 0, "}" );
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteProgram ()
+    *
+    *   Writes the lines of the program the minimizer hasn't removed to the specified file.
+    */
+
+    int WriteProgram ( char * pstrFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "wb" ) ) )
+            return FALSE;
+
+        for ( int iCurrLine = 0; iCurrLine < g_iLineCount; ++ iCurrLine )
+        {
+            Line * pLine = & g_Lines [ iCurrLine ];
+            if ( pLine->iIsDeleted )
+                continue;
+
+            if ( pLine->pstrText [ 0 ] )
+                for ( int iCurrIndent = 0; iCurrIndent < pLine->iIndent; ++ iCurrIndent )
+                    fprintf ( pFile, "    " );
+
+            fprintf ( pFile, "%s\n", pLine->pstrText );
+        }
+
+        fclose ( pFile );
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   FileExists ()
+    *
+    *   Returns TRUE if the specified file can be opened.
+    */
+
+    int FileExists ( char * pstrFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "rb" ) ) )
+            return FALSE;
+
+        fclose ( pFile );
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   Compile ()
+    *
+    *   Compiles and assembles the program, with or without optimization. The tools don't
+    *   report failure through their exit codes, so their output files are removed first and
+    *   checked for afterwards. The original compiler has no options for optimization, so
+    *   none are given when recording.
+    */
+
+    int Compile ( int iIsOptimized )
+    {
+        char * pstrAsmFilename = ( char * ) ( iIsOptimized ? OPT_ASM_FILENAME : REF_ASM_FILENAME );
+        char * pstrExecFilename = ( char * ) ( iIsOptimized ? OPT_EXEC_FILENAME : REF_EXEC_FILENAME );
+
+        remove ( pstrAsmFilename );
+        remove ( pstrExecFilename );
+
+        char * pstrOptions;
+        if ( iIsOptimized )
+            pstrOptions = OPT_COMPILE_OPTIONS;
+        else if ( g_iIsRecording )
+            pstrOptions = BASELINE_COMPILE_OPTIONS;
+        else
+            pstrOptions = REF_COMPILE_OPTIONS;
+
+        char pstrCommand [ MAX_COMMAND_SIZE ];
+
+        sprintf ( pstrCommand, "%s %s %s -N %s > %s", g_pstrXSC, SOURCE_FILENAME, pstrAsmFilename,
+                  pstrOptions, LOG_FILENAME );
+        system ( pstrCommand );
+
+        if ( ! FileExists ( pstrAsmFilename ) )
+            return FALSE;
+
+        sprintf ( pstrCommand, "%s %s %s > %s", g_pstrXASM, pstrAsmFilename, pstrExecFilename, LOG_FILENAME );
+        system ( pstrCommand );
+
+        return FileExists ( pstrExecFilename );
+    }
+
+    /******************************************************************************************
+    *
+    *   HAPI_Out ()
+    *
+    *   Host API function that appends its parameter to the output of the run in progress,
+    *   or to the output of the current lane in a batch run.
+    */
+
+    void HAPI_Out ( int iThreadIndex )
+    {
+        char * pstrValue = XS_GetParamAsString ( iThreadIndex, 0 );
+
+        int iLane = XS_GetCurrBatchLane ();
+        if ( iLane == -1 )
+            iLane = 0;
+
+        Result * pResult = & g_pCurrResults [ iLane ];
+        int iValueSize = strlen ( pstrValue );
+
+        if ( pResult->iOutputSize + iValueSize + 1 < MAX_OUTPUT_SIZE )
+        {
+            pResult->pstrOutput = ( char * ) realloc ( pResult->pstrOutput, pResult->iOutputSize + iValueSize + 2 );
+            memcpy ( & pResult->pstrOutput [ pResult->iOutputSize ], pstrValue, iValueSize );
+            pResult->iOutputSize += iValueSize;
+            pResult->pstrOutput [ pResult->iOutputSize ++ ] = '\n';
+            pResult->pstrOutput [ pResult->iOutputSize ] = '\0';
+        }
+
+        XS_Return ( iThreadIndex, 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   ResetResults ()
+    *
+    *   Clears the results of every run.
+    */
+
+    void ResetResults ()
+    {
+        for ( int iCurrMode = 0; iCurrMode < MODE_COUNT; ++ iCurrMode )
+        {
+            for ( int iCurrLane = 0; iCurrLane < BATCH_LANE_COUNT; ++ iCurrLane )
+            {
+                Result * pResult = & g_Results [ iCurrMode ][ iCurrLane ];
+
+                if ( pResult->pstrOutput )
+                    free ( pResult->pstrOutput );
+
+                pResult->pstrOutput = NULL;
+                pResult->iOutputSize = 0;
+                pResult->iRetInt = 0;
+                pResult->fRetFloat = 0;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   RunMode ()
+    *
+    *   Runs the program's compiled output in the specified mode and records its results.
+    *   Returns FALSE if the script couldn't be loaded or run.
+    */
+
+    int RunMode ( int iMode )
+    {
+        Mode * pMode = & g_Modes [ iMode ];
+        Result * pResults = g_Results [ iMode ];
+
+        XS_Init ();
+        XS_RegisterHostAPIFunc ( XS_GLOBAL_FUNC, "Out", HAPI_Out );
+
+        g_pCurrResults = pResults;
+
+        int iThread;
+        if ( XS_LoadScript ( ( char * ) ( pMode->iIsOptimized ? OPT_EXEC_FILENAME : REF_EXEC_FILENAME ), iThread, XS_THREAD_PRIORITY_USER ) != XS_LOAD_OK )
+        {
+            XS_ShutDown ();
+            return FALSE;
+        }
+
+        int iIsRun = TRUE;
+
+        switch ( pMode->iDispatch )
+        {
+            case DISPATCH_RUN:
+            {
+                XS_StartScript ( iThread );
+                XS_RunScripts ( XS_INFINITE_TIMESLICE );
+                break;
+            }
+
+            case DISPATCH_CALL:
+            {
+                XS_StartScript ( iThread );
+                XS_PassIntParam ( iThread, RUN_PARAM );
+                XS_CallScriptFunc ( iThread, "Run" );
+
+                pResults [ 0 ].iRetInt = XS_GetReturnValueAsInt ( iThread );
+                pResults [ 0 ].fRetFloat = XS_GetReturnValueAsFloat ( iThread );
+                break;
+            }
+
+            case DISPATCH_COROUTINE:
+            {
+                // Resume the coroutine until it returns, since the program can yield anywhere
+
+                XS_PassIntParam ( iThread, RUN_PARAM );
+                int iCoroutine = XS_CreateCoroutine ( iThread, "Run", 0 );
+                if ( iCoroutine == XS_INVALID_COROUTINE )
+                {
+                    iIsRun = FALSE;
+                    break;
+                }
+
+                while ( XS_GetCoroutineState ( iCoroutine ) == XS_COROUTINE_SUSPENDED )
+                    XS_ResumeCoroutine ( iCoroutine );
+
+                pResults [ 0 ].iRetInt = XS_GetCoroutineValueAsInt ( iCoroutine );
+                pResults [ 0 ].fRetFloat = XS_GetCoroutineValueAsFloat ( iCoroutine );
+
+                XS_DestroyCoroutine ( iCoroutine );
+                break;
+            }
+
+            case DISPATCH_BATCH:
+            {
+                // Every lane gets the same parameter, so every lane should match the reference
+
+                int iBatch = XS_CreateBatch ( iThread, BATCH_LANE_COUNT, 0 );
+                if ( iBatch == XS_INVALID_BATCH )
+                {
+                    iIsRun = FALSE;
+                    break;
+                }
+
+                int piParams [ BATCH_LANE_COUNT ];
+                int iCurrLane;
+                for ( iCurrLane = 0; iCurrLane < BATCH_LANE_COUNT; ++ iCurrLane )
+                    piParams [ iCurrLane ] = RUN_PARAM;
+
+                XS_PassBatchIntParams ( iBatch, piParams );
+                XS_CallBatchFunc ( iBatch, "Run" );
+
+                for ( iCurrLane = 0; iCurrLane < BATCH_LANE_COUNT; ++ iCurrLane )
+                {
+                    pResults [ iCurrLane ].iRetInt = XS_GetBatchReturnValueAsInt ( iBatch, iCurrLane );
+                    pResults [ iCurrLane ].fRetFloat = XS_GetBatchReturnValueAsFloat ( iBatch, iCurrLane );
+                }
+
+                XS_DestroyBatch ( iBatch );
+                break;
+            }
+        }
+
+        XS_ShutDown ();
+        return iIsRun;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareResults ()
+    *
+    *   Compares the results of the specified run with the reference runs, and returns FALSE
+    *   and describes the difference if they don't match. Runs made with XS_RunScripts () only
+    *   have their output compared, since _Main () doesn't return anything.
+    */
+
+    int CompareResults ( int iMode )
+    {
+        Result * pExpected = & g_Results [ MODE_REF_RUN ][ 0 ];
+        Result * pExpectedRetVal = & g_Results [ MODE_REF_CALL ][ 0 ];
+
+        int iLaneCount = g_Modes [ iMode ].iDispatch == DISPATCH_BATCH ? BATCH_LANE_COUNT : 1;
+
+        for ( int iCurrLane = 0; iCurrLane < iLaneCount; ++ iCurrLane )
+        {
+            Result * pResult = & g_Results [ iMode ][ iCurrLane ];
+
+            if ( pResult->iOutputSize != pExpected->iOutputSize ||
+                 ( pResult->iOutputSize && memcmp ( pResult->pstrOutput, pExpected->pstrOutput, pResult->iOutputSize ) != 0 ) )
+            {
+                sprintf ( g_pstrMismatch, "Output differs (lane %d)", iCurrLane );
+                return FALSE;
+            }
+
+            // Compare the float's bits, so a NaN matches itself
+
+            if ( g_Modes [ iMode ].iDispatch != DISPATCH_RUN && iMode != MODE_REF_CALL )
+            {
+                if ( pResult->iRetInt != pExpectedRetVal->iRetInt ||
+                     memcmp ( & pResult->fRetFloat, & pExpectedRetVal->fRetFloat, sizeof ( float ) ) != 0 )
+                {
+                    sprintf ( g_pstrMismatch, "_RetVal differs (lane %d): %d/%f, expected %d/%f", iCurrLane,
+                              pResult->iRetInt, pResult->fRetFloat, pExpectedRetVal->iRetInt, pExpectedRetVal->fRetFloat );
+                    return FALSE;
+                }
+            }
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   TestProgram ()
+    *
+    *   Compiles the program and runs it in every mode. Returns TEST_PASSED if every run
+    *   matches the reference, TEST_INVALID if the reference couldn't be compiled or run, or
+    *   the index of the first mode that failed. When recording, only the reference is run.
+    */
+
+    int TestProgram ()
+    {
+        ResetResults ();
+
+        if ( ! WriteProgram ( SOURCE_FILENAME ) )
+            return TEST_INVALID;
+
+        if ( ! Compile ( FALSE ) )
+            return TEST_INVALID;
+
+        int iModeCount = MODE_COUNT;
+        int iIsOptCompiled = FALSE;
+
+        if ( g_iIsRecording )
+            iModeCount = MODE_REF_CALL + 1;
+        else
+            iIsOptCompiled = Compile ( TRUE );
+
+        for ( int iCurrMode = 0; iCurrMode < iModeCount; ++ iCurrMode )
+        {
+            if ( g_Modes [ iCurrMode ].iIsOptimized && ! iIsOptCompiled )
+            {
+                strcpy ( g_pstrMismatch, "Optimized compile failed" );
+                return iCurrMode;
+            }
+
+            if ( ! RunMode ( iCurrMode ) )
+            {
+                if ( iCurrMode == MODE_REF_RUN )
+                    return TEST_INVALID;
+
+                strcpy ( g_pstrMismatch, "Couldn't be run" );
+                return iCurrMode;
+            }
+
+            if ( iCurrMode != MODE_REF_RUN && ! CompareResults ( iCurrMode ) )
+                return iCurrMode;
+        }
+
+        return TEST_PASSED;
+    }
+
+    /******************************************************************************************
+    *
+    *   Minimize ()
+    *
+    *   Shrinks a failing program for as long as the same mode keeps failing. Each pass tries
+    *   removing every statement that isn't fixed, and then unwrapping every if and while so
+    *   only its body is left. Removals that break the program are rejected because the
+    *   reference no longer compiles, so no effort is made to keep declarations and calls in
+    *   step.
+    */
+
+    void Minimize ( int iFailedMode )
+    {
+        static int piIsDeleted [ MAX_LINE_COUNT ];
+
+        char pstrMismatch [ MAX_LINE_SIZE ];
+        strcpy ( pstrMismatch, g_pstrMismatch );
+
+        int iIsReduced;
+        do
+        {
+            iIsReduced = FALSE;
+
+            for ( int iCurrStmt = 0; iCurrStmt < g_iStmtCount; ++ iCurrStmt )
+            {
+                Stmt * pStmt = & g_Stmts [ iCurrStmt ];
+
+                if ( pStmt->iLastLine < pStmt->iFirstLine || g_Lines [ pStmt->iFirstLine ].iIsDeleted )
+                    continue;
+
+                // Try removing the statement, then try unwrapping it
+
+                for ( int iIsUnwrap = FALSE; iIsUnwrap <= TRUE; ++ iIsUnwrap )
+                {
+                    if ( ! iIsUnwrap && pStmt->iIsFixed )
+                        continue;
+                    if ( iIsUnwrap && pStmt->iBodyFirstLine == -1 )
+                        continue;
+
+                    int iCurrLine;
+                    for ( iCurrLine = 0; iCurrLine < g_iLineCount; ++ iCurrLine )
+                        piIsDeleted [ iCurrLine ] = g_Lines [ iCurrLine ].iIsDeleted;
+
+                    for ( iCurrLine = pStmt->iFirstLine; iCurrLine <= pStmt->iLastLine; ++ iCurrLine )
+                        if ( ! iIsUnwrap || iCurrLine < pStmt->iBodyFirstLine || iCurrLine > pStmt->iBodyLastLine )
+                            g_Lines [ iCurrLine ].iIsDeleted = TRUE;
+
+                    if ( TestProgram () == iFailedMode )
+                    {
+                        strcpy ( pstrMismatch, g_pstrMismatch );
+                        iIsReduced = TRUE;
+                        break;
+                    }
+
+                    for ( iCurrLine = 0; iCurrLine < g_iLineCount; ++ iCurrLine )
+                        g_Lines [ iCurrLine ].iIsDeleted = piIsDeleted [ iCurrLine ];
+                }
+            }
+        }
+        while ( iIsReduced );
+
+        strcpy ( g_pstrMismatch, pstrMismatch );
+    }
+
+    /******************************************************************************************
+    *
+    *   HashOutput ()
+    *
+    *   Returns the 32-bit FNV-1a hash of a run's output.
+    */
+
+    unsigned int HashOutput ( Result * pResult )
+    {
+        unsigned int iHash = 2166136261u;
+
+        for ( int iCurrChar = 0; iCurrChar < pResult->iOutputSize; ++ iCurrChar )
+        {
+            iHash ^= ( unsigned char ) pResult->pstrOutput [ iCurrChar ];
+            iHash *= 16777619u;
+        }
+
+        return iHash;
+    }
+
+    /******************************************************************************************
+    *
+    *   ReadBaselines ()
+    *
+    *   Reads the original tools' results from BASELINE_FILENAME. Each line holds a seed, the
+    *   output's size and hash, and _RetVal as an integer and as the bits of a float, with the
+    *   hash and the float in hex.
+    */
+
+    int ReadBaselines ()
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( BASELINE_FILENAME, "rb" ) ) )
+            return FALSE;
+
+        Baseline CurrBaseline;
+        while ( fscanf ( pFile, "%u %d %x %d %x", & CurrBaseline.iSeed, & CurrBaseline.iOutputSize,
+                         & CurrBaseline.iOutputHash, & CurrBaseline.iRetInt, & CurrBaseline.iRetFloatBits ) == 5 )
+        {
+            g_pBaselines = ( Baseline * ) realloc ( g_pBaselines, ( g_iBaselineCount + 1 ) * sizeof ( Baseline ) );
+            g_pBaselines [ g_iBaselineCount ++ ] = CurrBaseline;
+        }
+
+        fclose ( pFile );
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteBaseline ()
+    *
+    *   Writes the reference results of the last program tested to the specified file, in the
+    *   format ReadBaselines () expects.
+    */
+
+    int WriteBaseline ( FILE * pFile, unsigned int iSeed )
+    {
+        Result * pExpected = & g_Results [ MODE_REF_RUN ][ 0 ];
+        Result * pExpectedRetVal = & g_Results [ MODE_REF_CALL ][ 0 ];
+
+        unsigned int iRetFloatBits;
+        memcpy ( & iRetFloatBits, & pExpectedRetVal->fRetFloat, sizeof ( float ) );
+
+        return fprintf ( pFile, "%u %d %08x %d %08x\n", iSeed, pExpected->iOutputSize, HashOutput ( pExpected ),
+                         pExpectedRetVal->iRetInt, iRetFloatBits ) > 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetBaseline ()
+    *
+    *   Returns the original tools' results for the specified seed, or NULL if there are none.
+    */
+
+    Baseline * GetBaseline ( unsigned int iSeed )
+    {
+        for ( int iCurrBaseline = 0; iCurrBaseline < g_iBaselineCount; ++ iCurrBaseline )
+            if ( g_pBaselines [ iCurrBaseline ].iSeed == iSeed )
+                return & g_pBaselines [ iCurrBaseline ];
+
+        return NULL;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareBaseline ()
+    *
+    *   Compares the reference results of the last program tested with the original tools'
+    *   results for its seed, and returns FALSE and describes the difference if they don't
+    *   match.
+    */
+
+    int CompareBaseline ( unsigned int iSeed )
+    {
+        Baseline * pBaseline = GetBaseline ( iSeed );
+
+        Result * pExpected = & g_Results [ MODE_REF_RUN ][ 0 ];
+        Result * pExpectedRetVal = & g_Results [ MODE_REF_CALL ][ 0 ];
+
+        if ( pExpected->iOutputSize != pBaseline->iOutputSize || HashOutput ( pExpected ) != pBaseline->iOutputHash )
+        {
+            strcpy ( g_pstrMismatch, "Output differs from the original tools'" );
+            return FALSE;
+        }
+
+        unsigned int iRetFloatBits;
+        memcpy ( & iRetFloatBits, & pExpectedRetVal->fRetFloat, sizeof ( float ) );
+
+        if ( pExpectedRetVal->iRetInt != pBaseline->iRetInt || iRetFloatBits != pBaseline->iRetFloatBits )
+        {
+            float fBaselineRetFloat;
+            memcpy ( & fBaselineRetFloat, & pBaseline->iRetFloatBits, sizeof ( float ) );
+
+            sprintf ( g_pstrMismatch, "_RetVal differs from the original tools': %d/%f, expected %d/%f",
+                      pExpectedRetVal->iRetInt, pExpectedRetVal->fRetFloat, pBaseline->iRetInt, fBaselineRetFloat );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the command line
+
+        int iIterationCount = DEFAULT_ITERATION_COUNT;
+        unsigned int iFirstSeed = DEFAULT_SEED;
+        int iPositionalCount = 0;
+
+        for ( int iCurrArg = 1; iCurrArg < argc; ++ iCurrArg )
+        {
+            char * pstrArg = argv [ iCurrArg ];
+
+            if ( strnicmp ( pstrArg, "-XSC:", 5 ) == 0 )
+                g_pstrXSC = & pstrArg [ 5 ];
+            else if ( strnicmp ( pstrArg, "-XASM:", 6 ) == 0 )
+                g_pstrXASM = & pstrArg [ 6 ];
+            else if ( stricmp ( pstrArg, "-Baseline" ) == 0 )
+                g_iIsBaselineLang = TRUE;
+            else if ( stricmp ( pstrArg, "-Record" ) == 0 )
+                g_iIsBaselineLang = g_iIsRecording = TRUE;
+            else if ( pstrArg [ 0 ] != '-' && iPositionalCount == 0 && ++ iPositionalCount )
+                iIterationCount = atoi ( pstrArg );
+            else if ( pstrArg [ 0 ] != '-' && iPositionalCount == 1 && ++ iPositionalCount )
+                iFirstSeed = atoi ( pstrArg );
+            else
+                iIterationCount = 0;
+        }
+
+        if ( iIterationCount <= 0 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        // Open the original tools' results, for writing if they're being recorded
+
+        FILE * pBaselineFile = NULL;
+
+        if ( g_iIsRecording )
+        {
+            if ( ! ( pBaselineFile = fopen ( BASELINE_FILENAME, "wb" ) ) )
+            {
+                printf ( "Could not open %s for writing.\n", BASELINE_FILENAME );
+                return 1;
+            }
+        }
+        else if ( g_iIsBaselineLang && ! ReadBaselines () )
+        {
+            printf ( "Could not read %s.\n", BASELINE_FILENAME );
+            return 1;
+        }
+
+        // Test each program
+
+        int iTestedCount = 0,
+            iFailedCount = 0,
+            iInvalidCount = 0;
+
+        for ( int iCurrIteration = 0; iCurrIteration < iIterationCount; ++ iCurrIteration )
+        {
+            unsigned int iSeed = iFirstSeed + iCurrIteration;
+
+            // Only the seeds that were recorded can be checked against the original tools
+
+            if ( g_iIsBaselineLang && ! g_iIsRecording && ! GetBaseline ( iSeed ) )
+            {
+                printf ( "Seed %u: There's no result for it in %s.\n", iSeed, BASELINE_FILENAME );
+                ++ iInvalidCount;
+                break;
+            }
+
+            GenProgram ( iSeed );
+
+            int iFailedMode = TestProgram ();
+            ++ iTestedCount;
+
+            // A reference that differs from the original tools is reported without being
+            // minimized, since their results only cover the whole program
+
+            if ( iFailedMode == TEST_PASSED && g_iIsBaselineLang && ! g_iIsRecording && ! CompareBaseline ( iSeed ) )
+            {
+                char pstrFilename [ MAX_COMMAND_SIZE ];
+
+                ++ iFailedCount;
+                printf ( "Seed %u: %s: %s\n", iSeed, g_Modes [ MODE_REF_RUN ].pstrName, g_pstrMismatch );
+
+                sprintf ( pstrFilename, "XSFUZZ_%u.XSS", iSeed );
+                WriteProgram ( pstrFilename );
+                continue;
+            }
+
+            if ( iFailedMode == TEST_PASSED )
+            {
+                if ( g_iIsRecording )
+                    WriteBaseline ( pBaselineFile, iSeed );
+
+                continue;
+            }
+
+            // The reference failing means the generator or the tools are at fault, so stop
+
+            if ( iFailedMode == TEST_INVALID )
+            {
+                printf ( "Seed %u: The reference couldn't be compiled or run; see %s.\n", iSeed, LOG_FILENAME );
+                ++ iInvalidCount;
+                break;
+            }
+
+            // Save the program, then minimize it and save it again
+
+            char pstrFilename [ MAX_COMMAND_SIZE ];
+
+            ++ iFailedCount;
+            printf ( "Seed %u: %s: %s\n", iSeed, g_Modes [ iFailedMode ].pstrName, g_pstrMismatch );
+
+            sprintf ( pstrFilename, "XSFUZZ_%u.XSS", iSeed );
+            WriteProgram ( pstrFilename );
+
+            int iOrigLineCount = 0,
+                iMinLineCount = 0;
+            int iCurrLine;
+            for ( iCurrLine = 0; iCurrLine < g_iLineCount; ++ iCurrLine )
+                if ( g_Lines [ iCurrLine ].pstrText [ 0 ] )
+                    ++ iOrigLineCount;
+
+            Minimize ( iFailedMode );
+
+            for ( iCurrLine = 0; iCurrLine < g_iLineCount; ++ iCurrLine )
+                if ( g_Lines [ iCurrLine ].pstrText [ 0 ] && ! g_Lines [ iCurrLine ].iIsDeleted )
+                    ++ iMinLineCount;
+
+            sprintf ( pstrFilename, "XSFUZZ_%u_MIN.XSS", iSeed );
+            WriteProgram ( pstrFilename );
+
+            printf ( "\tMinimized from %d to %d lines: %s\n", iOrigLineCount, iMinLineCount, g_pstrMismatch );
+        }
+
+        if ( pBaselineFile )
+            fclose ( pBaselineFile );
+
+        // Print the totals
+
+        printf ( "\n" );
+        printf ( "Programs Tested: %d\n", iTestedCount );
+        printf ( "         Failed: %d\n", iFailedCount );
+
+        if ( iFailedCount || iInvalidCount )
+            return 1;
+
+        return 0;
+    }
@@ -24,6 +24,14 @@
 
 	#include "xvm.h"
 
+    // SSE2 is used to run batch lanes four at a time wherever the compiler targets it, which
+    // includes every x64 build
+
+    #if defined ( _M_X64 ) || ( defined ( _M_IX86_FP ) && _M_IX86_FP >= 2 ) || defined ( __SSE2__ )
+        #define XVM_SSE2
+        #include <emmintrin.h>
+    #endif
+
 // ---- Constants -----------------------------------------------------------------------------
 
 	// ---- Script Loading --------------------------------------------------------------------
@@ -32,6 +40,18 @@
 
         #define XSE_ID_STRING               "XSE0"      // Used to validate an .XSE executable
 
+        #define XSE_VERSION_MAJOR           0           // Major version of supported .XSE
+                                                        // executables
+        #define XSE_VERSION_MINOR           9           // Minor version of the compact format
+        #define XSE_LEGACY_VERSION_MINOR    8           // Minor version of the older,
+                                                        // fixed-size format
+
+        #define MAX_VAR_INT_SIZE            5           // The most bytes a variable-length
+                                                        // integer can take up
+
+        #define LINE_TABLE_ID_STRING        "XLN0"      // Marks the start of the optional
+                                                        // line table
+
 		#define MAX_THREAD_COUNT		    1024        // The maximum number of scripts that
 														// can be loaded at once. Change this
 														// to support more or less.
@@ -48,8 +68,12 @@
         #define OP_TYPE_FUNC_INDEX          6           // Function index
         #define OP_TYPE_HOST_API_CALL_INDEX 7           // Host API call index
         #define OP_TYPE_REG                 8           // Register
+        #define OP_TYPE_JUMP_TABLE_INDEX    9           // Jump table index
+
+        #define OP_TYPE_STACK_BASE_MARKER   10          // Marks a stack base
 
-        #define OP_TYPE_STACK_BASE_MARKER   9           // Marks a stack base
+        #define OP_TYPE_OPERAND_COUNT       10          // The number of types an instruction
+                                                        // operand can have
 
     // ---- Instruction Opcodes ---------------------------------------------------------------
 
@@ -94,6 +118,88 @@
         #define INSTR_PAUSE                 31
         #define INSTR_EXIT                  32
 
+        // Typed instructions, which the compiler emits in place of the ones above when it
+        // can prove the types of both operands. They neither check nor coerce their
+        // operands' types.
+
+        #define INSTR_IADD                  33
+        #define INSTR_ISUB                  34
+        #define INSTR_IMUL                  35
+        #define INSTR_IDIV                  36
+        #define INSTR_IMOD                  37
+        #define INSTR_IINC                  38
+        #define INSTR_IDEC                  39
+
+        #define INSTR_FADD                  40
+        #define INSTR_FSUB                  41
+        #define INSTR_FMUL                  42
+        #define INSTR_FDIV                  43
+
+        #define INSTR_IJE                   44
+        #define INSTR_IJNE                  45
+        #define INSTR_IJG                   46
+        #define INSTR_IJL                   47
+        #define INSTR_IJGE                  48
+        #define INSTR_IJLE                  49
+
+        #define INSTR_JTAB                  50
+
+        // Math intrinsics, which the XVM implements itself rather than leaving to the host
+
+        #define INSTR_SQRT                  51
+        #define INSTR_SIN                   52
+        #define INSTR_COS                   53
+        #define INSTR_ATAN2                 54
+        #define INSTR_ABS                   55
+        #define INSTR_MIN                   56
+        #define INSTR_MAX                   57
+
+        // Vector intrinsics, which work on a run of consecutive stack elements such as part
+        // of an array. Their last operand is the number of elements.
+
+        #define INSTR_VADD                  58
+        #define INSTR_VSUB                  59
+        #define INSTR_VSCALE                60
+        #define INSTR_VDOT                  61
+
+        // Suspends the running coroutine and returns to the host that resumed it
+
+        #define INSTR_YIELD                 62
+
+        #define INSTR_COUNT                 63          // The number of opcodes
+
+    // ---- Script Verification ---------------------------------------------------------------
+
+        #define MAX_INSTR_OP_COUNT          4           // The most operands an instruction
+                                                        // can accept
+
+        #define MAX_VECTOR_SIZE             16          // The most elements a vector
+                                                        // intrinsic can work on
+
+        // Operand type bitfield flags, used to describe the types each operand of an
+        // instruction accepts
+
+        #define OP_FLAG_TYPE_INT            1           // Integer literal value
+        #define OP_FLAG_TYPE_FLOAT          2           // Floating-point literal value
+        #define OP_FLAG_TYPE_STRING         4           // String literal value
+        #define OP_FLAG_TYPE_MEM_REF        8           // Absolute or relative stack index
+        #define OP_FLAG_TYPE_INSTR_INDEX    16          // Instruction index (used for jumps)
+        #define OP_FLAG_TYPE_FUNC_INDEX     32          // Function index (used for Call)
+        #define OP_FLAG_TYPE_HOST_API_CALL  64          // Host API call index (used for
+                                                        // CallHost)
+        #define OP_FLAG_TYPE_REG            128         // Register
+        #define OP_FLAG_TYPE_JUMP_TABLE_INDEX   256     // Jump table index (used for JTab)
+
+        // The two most common combinations of the above
+
+        #define OP_FLAG_TYPE_DEST           ( OP_FLAG_TYPE_MEM_REF | OP_FLAG_TYPE_REG )
+        #define OP_FLAG_TYPE_SOURCE         ( OP_FLAG_TYPE_INT | OP_FLAG_TYPE_FLOAT | OP_FLAG_TYPE_STRING | OP_FLAG_TYPE_DEST )
+
+        // The sources accepted by the typed instructions
+
+        #define OP_FLAG_TYPE_INT_SOURCE     ( OP_FLAG_TYPE_INT | OP_FLAG_TYPE_DEST )
+        #define OP_FLAG_TYPE_FLOAT_SOURCE   ( OP_FLAG_TYPE_FLOAT | OP_FLAG_TYPE_DEST )
+
 	// ---- Stack -----------------------------------------------------------------------------
 
 		#define DEF_STACK_SIZE			    1024	    // The default stack size
@@ -121,6 +227,26 @@
 
         #define MAX_FUNC_NAME_SIZE          256         // Maximum size of a function's name
 
+    // ---- Coroutines ------------------------------------------------------------------------
+
+        #define MIN_COROUTINE_POOL_SIZE     64          // The initial size of the coroutine
+                                                        // pool, which doubles whenever it
+                                                        // fills up
+
+    // ---- Batches ---------------------------------------------------------------------------
+
+        #define MAX_BATCH_COUNT             64          // The maximum number of batches that
+                                                        // can exist at once
+
+        #define LANE_TYPE_MIXED             -2          // The lanes of a row don't all hold
+                                                        // the same type
+
+        #define BATCH_INSTR_OK              0           // Executed in lockstep
+        #define BATCH_INSTR_DONE            1           // The called function returned
+        #define BATCH_INSTR_SCALAR          2           // Can't be executed in lockstep
+        #define BATCH_INSTR_SPLIT           3           // A branch went different ways in
+                                                        // different lanes
+
 // ---- Data Structures -----------------------------------------------------------------------
 
 	// ---- Runtime Value ---------------------------------------------------------------------
@@ -170,23 +296,65 @@
 
     // ---- Instructions ----------------------------------------------------------------------
 
+        typedef struct _Op                              // An instruction operand
+        {
+            int iType;                                  // Type
+            union                                       // The value
+            {
+                int iIntLiteral;                        // Integer literal
+                float fFloatLiteral;                    // Float literal
+                int iStringIndex;                       // String table index
+                int iStackIndex;                        // Stack Index
+                int iInstrIndex;                        // Instruction index
+                int iFuncIndex;                         // Function index
+                int iHostAPICallIndex;                  // Host API Call index
+                int iReg;                               // Register code
+                int iJumpTableIndex;                    // Jump table index
+            };
+            int iOffsetIndex;                           // Index of the offset, or of the
+                                                        // literal's prebuilt value
+        }
+            Op;
+
         typedef struct _Instr                           // An instruction
         {
             int iOpcode;                                // The opcode
             int iOpCount;                               // The number of operands
-            Value * pOpList;                            // The operand list
+            Op * pOpList;                               // The operand list, which points into
+                                                        // the stream's operand array
         }
             Instr;
 
+        typedef struct _InstrSig                        // An instruction's signature
+        {
+            int iOpCount;                               // The number of operands
+            int OpList [ MAX_INSTR_OP_COUNT ];          // The types each operand accepts
+        }
+            InstrSig;
+
         typedef struct _InstrStream                     // An instruction stream
         {
             Instr * pInstrs;							// The instructions themselves
             int iSize;                                  // The number of instructions in the
                                                         // stream
+            Op * pOps;                                  // Every instruction's operands, stored
+                                                        // back to back in stream order
+            int iOpCount;                               // The number of operands in the stream
+            Value * pLiterals;                          // The values of the literal operands,
+                                                        // built when the script is loaded
             int iCurrInstr;                             // The instruction pointer
         }
             InstrStream;
 
+    // ---- String Table ----------------------------------------------------------------------
+
+        typedef struct _StringTable                     // A string table
+        {
+            char ** ppstrStrings;                       // Pointer to the string array
+            int iSize;                                  // The number of strings in the array
+        }
+            StringTable;
+
     // ---- Function Table --------------------------------------------------------------------
 
         typedef struct _FuncTable                       // A function table
@@ -205,6 +373,45 @@
 		}
 			HostAPICallTable;
 
+    // ---- Jump Table Table ------------------------------------------------------------------
+
+        typedef struct _JumpTable                       // A jump table
+        {
+            int iBase;                                  // The value of the first entry
+            int iSize;                                  // The number of entries
+            int * piTargets;                            // The target instruction of each entry
+        }
+            JumpTable;
+
+        typedef struct _JumpTableTable                  // A jump table table
+        {
+            JumpTable * pTables;                        // Pointer to the jump table array
+            int iSize;                                  // The number of jump tables
+        }
+            JumpTableTable;
+
+    // ---- Line Table ------------------------------------------------------------------------
+
+        typedef struct _LineRun                         // A run of instructions assembled from
+        {                                               // the same source line
+            int iInstrIndex;                            // The first instruction of the run
+            int iSourceLine;                            // The source line, or zero if unknown
+        }
+            LineRun;
+
+        typedef struct _LineTable                       // A line table
+        {
+            int iIsLoaded;                              // Has the table been read yet?
+            char * pstrExecFilename;                    // The executable to read it from, or
+                                                        // NULL if it doesn't have one
+            long lOffset;                               // Where the table starts in the file
+
+            char * pstrSourceFilename;                  // The source file the lines refer to
+            LineRun * pRuns;                            // Pointer to the run array
+            int iSize;                                  // The number of runs
+        }
+            LineTable;
+
 	// ---- Scripts ---------------------------------------------------------------------------
 
 		typedef struct _Script							// Encapsulates a full script
@@ -222,6 +429,8 @@
 			int iIsRunning;								// Is the script running?
 			int iIsPaused;								// Is the script currently paused?
 			int iPauseEndTime;			                // If so, when should it resume?
+            unsigned int iInstrCount;                   // Instructions executed since the
+                                                        // last reset
 
             // Threading
 
@@ -231,15 +440,91 @@
 
             Value _RetVal;								// The _RetVal register
 
-            // Script data
+            // Script data. Members that share their type's name are declared with the type's
+            // structure tag, since GCC won't let a member change what a name in the class means.
 
-            InstrStream InstrStream;                    // The instruction stream
+            _InstrStream InstrStream;                   // The instruction stream
+            _StringTable StringTable;                   // The string literal table
             RuntimeStack Stack;                         // The runtime stack
-            FuncTable FuncTable;                        // The function table
-			HostAPICallTable HostAPICallTable;			// The host API call table
+            _FuncTable FuncTable;                       // The function table
+			_HostAPICallTable HostAPICallTable;			// The host API call table
+            _JumpTableTable JumpTableTable;             // The jump table table
+            _LineTable LineTable;                       // The line table, which is only read
+                                                        // when it's first needed
 		}
 			Script;
 
+    // ---- Coroutines ------------------------------------------------------------------------
+
+        typedef struct _Coroutine                       // A coroutine
+        {
+            int iIsActive;                              // Is this coroutine structure in use?
+            int iNextFree;                              // If not, the next free structure
+
+            int iThreadIndex;                           // The script whose code it runs
+            int iState;                                 // Suspended, running or dead
+
+            // Execution state, which is swapped into the script while it runs
+
+            RuntimeStack Stack;                         // The coroutine's own runtime stack
+            int iCurrInstr;                             // The instruction pointer
+            Value _RetVal;                              // The _RetVal register, which holds
+                                                        // the last yielded or returned value
+        }
+            Coroutine;
+
+    // ---- Batches ---------------------------------------------------------------------------
+
+        typedef union _LaneData                         // A lane's value, without its type
+        {
+            int iIntLiteral;                            // Integer literal
+            float fFloatLiteral;                        // Float literal
+        }
+            LaneData;
+
+        typedef struct _Batch                           // Many instances of a script, run in
+        {                                               // lockstep
+            int iIsActive;                              // Is this batch structure in use?
+
+            int iThreadIndex;                           // The script whose code it runs
+            int iLaneCount;                             // The number of instances (lanes)
+            int iStackSize;                             // The number of rows in each stack
+
+            // Execution state, which every lane shares while control flow is uniform
+
+            int iCurrInstr;                             // The instruction pointer
+            int iTopIndex;                              // The top index
+            int iFrameIndex;                            // Index of the top of the current
+                                                        // stack frame
+
+            // The lanes' stacks, stored as rows of elements. Element ( row, lane ) is at
+            // row * iLaneCount + lane, and the row after the last stack row is _RetVal.
+
+            int * piTypes;                              // Each element's type
+            LaneData * pData;                           // Each element's integer or float
+            char ** ppstrStrings;                       // Each element's string, if it has one
+            int * piOffsetIndices;                      // Each element's offset index
+
+            LaneData * pTemp0;                          // Scratch rows for converted and
+            LaneData * pTemp1;                          // broadcast operands
+            int * piLaneInstrs;                         // Where each lane picks up when it
+                                                        // leaves lockstep
+
+            RuntimeStack ScalarStack;                   // An ordinary stack that one lane at
+                                                        // a time is moved into, to run it by
+                                                        // itself
+        }
+            Batch;
+
+        typedef struct _LaneOp                          // A batch instruction operand
+        {
+            int iRow;                                   // Its stack row, or -1 for a literal
+            int iType;                                  // The literal's type
+            LaneData Literal;                           // The literal's value
+            char * pstrString;                          // The literal's string
+        }
+            LaneOp;
+
     // ---- Host API --------------------------------------------------------------------------
 
         typedef struct _HostAPIFunc                     // Host API function
@@ -270,6 +555,126 @@
 
         HostAPIFunc g_HostAPI [ MAX_HOST_API_SIZE ];    // The host API
 
+    // ---- Coroutines ------------------------------------------------------------------------
+
+        Coroutine * g_pCoroutines;                      // The coroutine pool
+        int g_iCoroutinePoolSize;                       // The number of structures in the pool
+        int g_iFreeCoroutine;                           // The first free structure, or -1
+        int g_iCurrCoroutine;                           // The running coroutine, or -1
+
+    // ---- Batches ---------------------------------------------------------------------------
+
+        Batch g_Batches [ MAX_BATCH_COUNT ];            // The batch array
+        int g_iCurrBatchLane;                           // The batch lane running by itself,
+                                                        // or -1
+
+    // ---- Script Verification ---------------------------------------------------------------
+
+        // The operand type flag that accepts each operand type, indexed by operand type. The
+        // compact .XSE format stores each operand's type as its position among the types its
+        // instruction accepts, so the order here must match the assembler's.
+
+        int g_OpTypeFlagTable [ OP_TYPE_OPERAND_COUNT ] =
+        {
+            OP_FLAG_TYPE_INT,                           // Integer literal value
+            OP_FLAG_TYPE_FLOAT,                         // Floating-point literal value
+            OP_FLAG_TYPE_STRING,                        // String literal value
+            OP_FLAG_TYPE_MEM_REF,                       // Absolute array index
+            OP_FLAG_TYPE_MEM_REF,                       // Relative array index
+            OP_FLAG_TYPE_INSTR_INDEX,                   // Instruction index
+            OP_FLAG_TYPE_FUNC_INDEX,                    // Function index
+            OP_FLAG_TYPE_HOST_API_CALL,                 // Host API call index
+            OP_FLAG_TYPE_REG,                           // Register
+            OP_FLAG_TYPE_JUMP_TABLE_INDEX               // Jump table index
+        };
+
+        // The operand count and accepted operand types of each instruction, indexed by
+        // opcode. These mirror the instruction set the assembler accepts.
+
+        InstrSig g_InstrSigTable [ INSTR_COUNT ] =
+        {
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Mov
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Add
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Sub
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Mul
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Div
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Mod
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Exp
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // Neg
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // Inc
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // Dec
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // And
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Or
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // XOr
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // Not
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // ShL
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // ShR
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_DEST | OP_FLAG_TYPE_STRING } },      // Concat
+            { 3, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_DEST | OP_FLAG_TYPE_STRING,
+                   OP_FLAG_TYPE_DEST | OP_FLAG_TYPE_INT } },                            // GetChar
+            { 3, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_DEST | OP_FLAG_TYPE_INT,
+                   OP_FLAG_TYPE_DEST | OP_FLAG_TYPE_STRING } },                         // SetChar
+
+            { 1, { OP_FLAG_TYPE_INSTR_INDEX } },                                        // Jmp
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JE
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JNE
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JG
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JL
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JGE
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // JLE
+
+            { 1, { OP_FLAG_TYPE_SOURCE } },                                             // Push
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // Pop
+
+            { 1, { OP_FLAG_TYPE_FUNC_INDEX } },                                         // Call
+            { 0 },                                                                      // Ret
+            { 1, { OP_FLAG_TYPE_HOST_API_CALL } },                                      // CallHost
+
+            { 1, { OP_FLAG_TYPE_SOURCE } },                                             // Pause
+            { 1, { OP_FLAG_TYPE_SOURCE } },                                             // Exit
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_INT_SOURCE } },                      // IAdd
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_INT_SOURCE } },                      // ISub
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_INT_SOURCE } },                      // IMul
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_INT_SOURCE } },                      // IDiv
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_INT_SOURCE } },                      // IMod
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // IInc
+            { 1, { OP_FLAG_TYPE_DEST } },                                               // IDec
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_FLOAT_SOURCE } },                    // FAdd
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_FLOAT_SOURCE } },                    // FSub
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_FLOAT_SOURCE } },                    // FMul
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_FLOAT_SOURCE } },                    // FDiv
+
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJE
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJNE
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJG
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJL
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJGE
+            { 3, { OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INT_SOURCE, OP_FLAG_TYPE_INSTR_INDEX } },  // IJLE
+
+            { 3, { OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_JUMP_TABLE_INDEX, OP_FLAG_TYPE_INSTR_INDEX } }, // JTab
+
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Sqrt
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Sin
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Cos
+            { 3, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE } },     // ATan2
+            { 2, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE } },                          // Abs
+            { 3, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE } },     // Min
+            { 3, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_SOURCE } },     // Max
+
+            { 3, { OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_INT } },    // VAdd
+            { 3, { OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_INT } },    // VSub
+            { 3, { OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_SOURCE, OP_FLAG_TYPE_INT } },     // VScale
+            { 4, { OP_FLAG_TYPE_DEST, OP_FLAG_TYPE_MEM_REF, OP_FLAG_TYPE_MEM_REF,
+                   OP_FLAG_TYPE_INT } },                                                // VDot
+
+            { 0 }                                                                       // Yield
+        };
+
 // ---- Macros --------------------------------------------------------------------------------
 
 	/******************************************************************************************
@@ -307,8 +712,55 @@
                                         \
         ( IsValidThreadIndex ( iIndex ) && g_Scripts [ iIndex ].iIsActive ? TRUE : FALSE )
 
+    /******************************************************************************************
+    *
+    *   IsCoroutineActive ()
+    *
+    *   Returns TRUE if the specified coroutine handle is within the pool and in use, FALSE
+    *   otherwise.
+    */
+
+    #define IsCoroutineActive( iIndex )     \
+                                            \
+        ( iIndex >= 0 && iIndex < g_iCoroutinePoolSize && g_pCoroutines [ iIndex ].iIsActive ? TRUE : FALSE )
+
+    /******************************************************************************************
+    *
+    *   IsBatchActive ()
+    *
+    *   Returns TRUE if the specified batch handle is within the array and in use, FALSE
+    *   otherwise.
+    */
+
+    #define IsBatchActive( iIndex )         \
+                                            \
+        ( iIndex >= 0 && iIndex < MAX_BATCH_COUNT && g_Batches [ iIndex ].iIsActive ? TRUE : FALSE )
+
 // ---- Function Prototypes -------------------------------------------------------------------
 
+    // ---- Script Loading --------------------------------------------------------------------
+
+        void FreeScript ( int iThreadIndex );
+        int AbortScriptLoad ( int iThreadIndex, FILE * pScriptFile, int iErrorCode );
+        void LoadLineTable ( int iThreadIndex );
+
+    // ---- Executable Format -----------------------------------------------------------------
+
+        int ReadVarInt ( FILE * pScriptFile );
+        int ReadSignedVarInt ( FILE * pScriptFile );
+        int ReadXSEInt ( FILE * pScriptFile, int iIsCompact, int iLegacySize );
+        int ReadXSESignedInt ( FILE * pScriptFile, int iIsCompact );
+        int GetOpShapeBitCount ( int iOpTypes );
+        int GetShapeOpType ( int iOpTypes, int iShape );
+        int BuildLiterals ( int iThreadIndex );
+
+    // ---- Script Verification ---------------------------------------------------------------
+
+        int VerifyScript ( int iThreadIndex );
+        int VerifyStackIndex ( int iThreadIndex, Func * pFunc, int iStackIndex );
+        int VerifyOp ( int iThreadIndex, Func * pFunc, Op * pOp, int iOpTypes );
+        int VerifyVectorInstr ( int iThreadIndex, Func * pFunc, Instr * pInstr );
+
 	// ---- Operand Interface -----------------------------------------------------------------
 
         int CoerceValueToInt ( Value Val );
@@ -325,6 +777,7 @@
 		float ResolveOpAsFloat ( int iOpIndex );
 		char * ResolveOpAsString ( int iOpIndex );
 		int ResolveOpAsInstrIndex ( int iOpIndex );
+		JumpTable * ResolveOpAsJumpTable ( int iOpIndex );
 		int ResolveOpAsFuncIndex ( int iOpIndex );
 		char * ResolveOpAsHostAPICall ( int iOpIndex );
 		Value * ResolveOpPntr ( int iOpIndex );
@@ -333,6 +786,7 @@
 
 		Value GetStackValue ( int iThreadIndex, int iIndex );
 		void SetStackValue ( int iThreadIndex, int iIndex, Value Val );
+		int CheckStackSpace ( int iThreadIndex, int iSize );
 		void Push ( int iThreadIndex, Value Val );
 		Value Pop ( int iThreadIndex );
 		void PushFrame ( int iThreadIndex, int iSize );
@@ -345,6 +799,7 @@
 	// ---- Host API Call Table Interface -----------------------------------------------------
 
 		char * GetHostAPICall ( int iIndex );
+        HostAPIFuncPntr GetHostAPIFunc ( int iThreadIndex, char * pstrName );
 
 	// ---- Time Abstraction ------------------------------------------------------------------
 
@@ -352,7 +807,41 @@
 
     // ---- Functions -------------------------------------------------------------------------
 
-        void CallFunc ( int iThreadIndex, int iIndex );
+        int CallFunc ( int iThreadIndex, int iIndex );
+
+    // ---- Coroutines ------------------------------------------------------------------------
+
+        int GetFreeCoroutine ();
+        void FreeCoroutineStack ( Coroutine * pCoroutine );
+        void SwapCoroutine ( int iCoroutine );
+
+    // ---- Batches ---------------------------------------------------------------------------
+
+        void FreeBatch ( Batch * pBatch );
+
+        Value GetLaneValue ( Batch * pBatch, int iElmnt );
+        void SetLaneValue ( Batch * pBatch, int iElmnt, Value Val );
+        int GetLaneRowType ( Batch * pBatch, int iRow );
+        void FreeLaneRowStrings ( Batch * pBatch, int iRow );
+        void SetLaneRowType ( Batch * pBatch, int iRow, int iType );
+        void FillLaneRow ( Batch * pBatch, int iRow, int iType, int iValue, int iOffsetIndex );
+
+        int ResolveLaneOp ( Batch * pBatch, Op * pOp, LaneOp * pLaneOp );
+        int GetLaneOpType ( Batch * pBatch, LaneOp * pLaneOp );
+        int * GetLaneOpInts ( Batch * pBatch, LaneOp * pLaneOp, int iType, LaneData * pTemp );
+        float * GetLaneOpFloats ( Batch * pBatch, LaneOp * pLaneOp, int iType, LaneData * pTemp );
+        void MoveLanes ( Batch * pBatch, int iDestRow, LaneOp * pSource );
+
+        void RunIntLaneOp ( int iOpcode, int * piDest, int * piSource, int iCount );
+        void RunFloatLaneOp ( int iOpcode, float * pfDest, float * pfSource, int iCount );
+        int CompareIntLanes ( int iOpcode, int * piOp0, int * piOp1, int * piJumps, int iCount );
+        int CompareFloatLanes ( int iOpcode, float * pfOp0, float * pfOp1, int * piJumps, int iCount );
+
+        int RunBatchInstr ( Batch * pBatch );
+        void RunBatchHostCall ( Batch * pBatch, HostAPIFuncPntr fnFunc );
+        void RunBatchLanesAlone ( Batch * pBatch );
+        void UnpackLane ( Batch * pBatch, int iLane, int iRowCount );
+        void PackLane ( Batch * pBatch, int iLane, int iRowCount );
 
 // ---- Functions -----------------------------------------------------------------------------
 
@@ -376,9 +865,16 @@
 			g_Scripts [ iCurrScriptIndex ].iIsPaused = FALSE;
 
 			g_Scripts [ iCurrScriptIndex ].InstrStream.pInstrs = NULL;
+			g_Scripts [ iCurrScriptIndex ].InstrStream.pOps = NULL;
+			g_Scripts [ iCurrScriptIndex ].InstrStream.pLiterals = NULL;
+			g_Scripts [ iCurrScriptIndex ].StringTable.ppstrStrings = NULL;
 			g_Scripts [ iCurrScriptIndex ].Stack.pElmnts = NULL;
 			g_Scripts [ iCurrScriptIndex ].FuncTable.pFuncs = NULL;
 			g_Scripts [ iCurrScriptIndex ].HostAPICallTable.ppstrCalls = NULL;
+			g_Scripts [ iCurrScriptIndex ].JumpTableTable.pTables = NULL;
+			g_Scripts [ iCurrScriptIndex ].LineTable.pstrExecFilename = NULL;
+			g_Scripts [ iCurrScriptIndex ].LineTable.pstrSourceFilename = NULL;
+			g_Scripts [ iCurrScriptIndex ].LineTable.pRuns = NULL;
 		}
 
         // ---- Initialize the host API
@@ -389,6 +885,20 @@
             g_HostAPI [ iCurrHostAPIFunc ].pstrName = NULL;
         }
 
+        // ---- Initialize the coroutine pool, which is allocated on first use
+
+        g_pCoroutines = NULL;
+        g_iCoroutinePoolSize = 0;
+        g_iFreeCoroutine = -1;
+        g_iCurrCoroutine = -1;
+
+        // ---- Initialize the batch array
+
+        for ( int iCurrBatch = 0; iCurrBatch < MAX_BATCH_COUNT; ++ iCurrBatch )
+            g_Batches [ iCurrBatch ].iIsActive = FALSE;
+
+        g_iCurrBatchLane = -1;
+
 		// ---- Set up the threads
 
         g_iCurrThreadMode = THREAD_MODE_MULTI;
@@ -414,6 +924,17 @@
         for ( int iCurrHostAPIFunc = 0; iCurrHostAPIFunc < MAX_HOST_API_SIZE; ++ iCurrHostAPIFunc )
             if ( g_HostAPI [ iCurrHostAPIFunc ].pstrName )
                 free ( g_HostAPI [ iCurrHostAPIFunc ].pstrName );
+
+        // ---- Free the coroutine pool, whose coroutines were destroyed along with their
+        // scripts
+
+        if ( g_pCoroutines )
+        {
+            free ( g_pCoroutines );
+            g_pCoroutines = NULL;
+        }
+        g_iCoroutinePoolSize = 0;
+        g_iFreeCoroutine = -1;
 	}
 
 	/******************************************************************************************
@@ -451,6 +972,36 @@
         if ( ! ( pScriptFile = fopen ( pstrFilename, "rb" ) ) )
             return XS_LOAD_ERROR_FILE_IO;
 
+        // Get the file's size, which bounds the size of every table and string in it
+
+        fseek ( pScriptFile, 0, SEEK_END );
+        long lFileSize = ftell ( pScriptFile );
+        fseek ( pScriptFile, 0, SEEK_SET );
+
+        // Clear the script's tables, so a script that's rejected partway through loading can
+        // be freed safely
+
+        g_Scripts [ iThreadIndex ].InstrStream.pInstrs = NULL;
+        g_Scripts [ iThreadIndex ].InstrStream.iSize = 0;
+        g_Scripts [ iThreadIndex ].InstrStream.pOps = NULL;
+        g_Scripts [ iThreadIndex ].InstrStream.iOpCount = 0;
+        g_Scripts [ iThreadIndex ].InstrStream.pLiterals = NULL;
+        g_Scripts [ iThreadIndex ].StringTable.ppstrStrings = NULL;
+        g_Scripts [ iThreadIndex ].StringTable.iSize = 0;
+        g_Scripts [ iThreadIndex ].Stack.pElmnts = NULL;
+        g_Scripts [ iThreadIndex ].Stack.iSize = 0;
+        g_Scripts [ iThreadIndex ].FuncTable.pFuncs = NULL;
+        g_Scripts [ iThreadIndex ].FuncTable.iSize = 0;
+        g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls = NULL;
+        g_Scripts [ iThreadIndex ].HostAPICallTable.iSize = 0;
+        g_Scripts [ iThreadIndex ].JumpTableTable.pTables = NULL;
+        g_Scripts [ iThreadIndex ].JumpTableTable.iSize = 0;
+        g_Scripts [ iThreadIndex ].LineTable.iIsLoaded = FALSE;
+        g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename = NULL;
+        g_Scripts [ iThreadIndex ].LineTable.pstrSourceFilename = NULL;
+        g_Scripts [ iThreadIndex ].LineTable.pRuns = NULL;
+        g_Scripts [ iThreadIndex ].LineTable.iSize = 0;
+
         // ---- Read the header
 
         // Create a buffer to hold the file's ID string (4 bytes + 1 null terminator = 5)
@@ -468,7 +1019,11 @@
         // match
 
         if ( strcmp ( pstrIDString, XSE_ID_STRING ) != 0 )
+        {
+            free ( pstrIDString );
+            fclose ( pScriptFile );
             return XS_LOAD_ERROR_INVALID_XSE;
+        }
 
         // Free the buffer
 
@@ -482,37 +1037,53 @@
 		fread ( & iMajorVersion, 1, 1, pScriptFile );
 		fread ( & iMinorVersion, 1, 1, pScriptFile );
 
-		// Validate the version, since this prototype only supports version 0.8 scripts
+		// Validate the version. Version 0.8 scripts store everything in fixed-size fields,
+		// while version 0.9 scripts use the compact encoding, in which every field below
+		// that's more than a byte in 0.8 is a variable-length integer.
+
+		if ( iMajorVersion != XSE_VERSION_MAJOR ||
+		     ( iMinorVersion != XSE_VERSION_MINOR && iMinorVersion != XSE_LEGACY_VERSION_MINOR ) )
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_UNSUPPORTED_VERS );
 
-		if ( iMajorVersion != 0 || iMinorVersion != 8 )
-			return XS_LOAD_ERROR_UNSUPPORTED_VERS;
+		int iIsCompact = ( iMinorVersion == XSE_VERSION_MINOR );
 
 		// Read the stack size (4 bytes)
 
-		fread ( & g_Scripts [ iThreadIndex ].Stack.iSize, 4, 1, pScriptFile );
+		g_Scripts [ iThreadIndex ].Stack.iSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
 		// Check for a default stack size request
 
 		if ( g_Scripts [ iThreadIndex ].Stack.iSize == 0 )
 			g_Scripts [ iThreadIndex ].Stack.iSize = DEF_STACK_SIZE;
 
+        // Make sure the stack size is sane
+
+        if ( g_Scripts [ iThreadIndex ].Stack.iSize < 0 )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
+
 		// Allocate the runtime stack
 
         int iStackSize = g_Scripts [ iThreadIndex ].Stack.iSize;
 		if ( ! ( g_Scripts [ iThreadIndex ].Stack.pElmnts = ( Value * ) malloc ( iStackSize * sizeof ( Value ) ) ) )
-			return XS_LOAD_ERROR_OUT_OF_MEMORY;
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
+
+        // Set the entire stack to null so nothing on it is mistaken for a string
+
+        for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iStackSize; ++ iCurrElmntIndex )
+            g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmntIndex ].iType = OP_TYPE_NULL;
 
         // Read the global data size (4 bytes)
 
-        fread ( & g_Scripts [ iThreadIndex ].iGlobalDataSize, 4, 1, pScriptFile );
+        g_Scripts [ iThreadIndex ].iGlobalDataSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
 		// Check for presence of _Main () (1 byte)
 
+		g_Scripts [ iThreadIndex ].iIsMainFuncPresent = 0;
 		fread ( & g_Scripts [ iThreadIndex ].iIsMainFuncPresent, 1, 1, pScriptFile );
 
         // Read _Main ()'s function index (4 bytes)
 
-        fread ( & g_Scripts [ iThreadIndex ].iMainFuncIndex, 4, 1, pScriptFile );
+        g_Scripts [ iThreadIndex ].iMainFuncIndex = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
         // Read the priority type (1 byte)
 
@@ -521,7 +1092,7 @@
 
         // Read the user-defined priority (4 bytes)
 
-        fread ( & g_Scripts [ iThreadIndex ].iTimesliceDur, 4, 1, pScriptFile );
+        g_Scripts [ iThreadIndex ].iTimesliceDur = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
         // Override the script-specified priority if necessary
 
@@ -550,43 +1121,122 @@
 
 		// Read the instruction count (4 bytes)
 
-		fread ( & g_Scripts [ iThreadIndex ].InstrStream.iSize, 4, 1, pScriptFile );
+		int iInstrStreamSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
-		// Allocate the stream
+        if ( iInstrStreamSize < 0 || iInstrStreamSize > lFileSize )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		if ( ! ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs = ( Instr * ) malloc ( g_Scripts [ iThreadIndex ].InstrStream.iSize * sizeof ( Instr ) ) ) )
-			return XS_LOAD_ERROR_OUT_OF_MEMORY;
+		// Allocate the stream and clear it, so the operand lists of instructions that haven't
+		// been read yet are null
+
+		if ( ! ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs = ( Instr * ) malloc ( iInstrStreamSize * sizeof ( Instr ) ) ) )
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
+
+        memset ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs, 0, iInstrStreamSize * sizeof ( Instr ) );
+        g_Scripts [ iThreadIndex ].InstrStream.iSize = iInstrStreamSize;
+
+        // Allocate the operand array. Rather than giving each instruction its own block, the
+        // operands of the entire stream are stored back to back, so consecutive instructions
+        // share cache lines. Most instructions have two operands or fewer, so the array starts
+        // out with room for two per instruction and doubles whenever it fills.
+
+        int iOpCapacity = iInstrStreamSize * 2 + 1;
+        if ( ! ( g_Scripts [ iThreadIndex ].InstrStream.pOps = ( Op * ) malloc ( iOpCapacity * sizeof ( Op ) ) ) )
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
 		// Read the instruction data
 
-		for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_Scripts [ iThreadIndex ].InstrStream.iSize; ++ iCurrInstrIndex )
+        int iCurrInstrIndex;
+		for ( iCurrInstrIndex = 0; iCurrInstrIndex < g_Scripts [ iThreadIndex ].InstrStream.iSize; ++ iCurrInstrIndex )
 		{
-			// Read the opcode (2 bytes)
+            // Stop if the file ends before the stream does
+
+            if ( feof ( pScriptFile ) )
+                return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
+
+            int iOpcode = 0,
+                iOpCount = 0;
+            int iShapes = 0;
+
+            if ( iIsCompact )
+            {
+                // Read the opcode and the first two operand shape bits (1 byte). The opcode
+                // has to be known before anything else can be read, since it determines the
+                // operand count and the types each operand can have.
+
+                int iOpcodeByte = fgetc ( pScriptFile ) & 0xFF;
+                iOpcode = iOpcodeByte & 0x3F;
+                iShapes = iOpcodeByte >> 6;
+
+                if ( iOpcode >= INSTR_COUNT )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
+
+                InstrSig * pSig = & g_InstrSigTable [ iOpcode ];
+                iOpCount = pSig->iOpCount;
+
+                // Read the rest of the shape bits (1 byte) if there are more than two
+
+                int iShapeBitCount = 0;
+                for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
+                    iShapeBitCount += GetOpShapeBitCount ( pSig->OpList [ iCurrOpIndex ] );
+
+                if ( iShapeBitCount > 2 )
+                    iShapes |= ( fgetc ( pScriptFile ) & 0xFF ) << 2;
+            }
+            else
+            {
+                // Read the opcode (2 bytes)
+
+                fread ( & iOpcode, 2, 1, pScriptFile );
+
+                // Read the operand count (1 byte)
+
+                fread ( & iOpCount, 1, 1, pScriptFile );
+            }
+
+			g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpcode = iOpcode;
+			g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount = iOpCount;
 
-			g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpcode = 0;
-			fread ( & g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpcode, 2, 1, pScriptFile );
+            // Grow the operand array if this instruction's operands won't fit
 
-			// Read the operand count (1 byte)
+            int iOpIndex = g_Scripts [ iThreadIndex ].InstrStream.iOpCount;
 
-			g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount = 0;
-			fread ( & g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount, 1, 1, pScriptFile );
+            if ( iOpIndex + iOpCount > iOpCapacity )
+            {
+                while ( iOpIndex + iOpCount > iOpCapacity )
+                    iOpCapacity *= 2;
 
-			int iOpCount = g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount;
+                Op * pNewOps;
+                if ( ! ( pNewOps = ( Op * ) realloc ( g_Scripts [ iThreadIndex ].InstrStream.pOps, iOpCapacity * sizeof ( Op ) ) ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
-			// Allocate space for the operand list in a temporary pointer
+                g_Scripts [ iThreadIndex ].InstrStream.pOps = pNewOps;
+            }
 
-			Value * pOpList;
-			if ( ! ( pOpList = ( Value * ) malloc ( iOpCount * sizeof ( Value ) ) ) )
-				return XS_LOAD_ERROR_OUT_OF_MEMORY;
+            Op * pOpList = & g_Scripts [ iThreadIndex ].InstrStream.pOps [ iOpIndex ];
+            g_Scripts [ iThreadIndex ].InstrStream.iOpCount += iOpCount;
 
 			// Read in the operand list (N bytes)
 
 			for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
 			{
-				// Read in the operand type (1 byte)
+                // Read in the operand type, either from the instruction's packed shapes or
+                // as its own byte
 
-				pOpList [ iCurrOpIndex ].iType = 0;
-				fread ( & pOpList [ iCurrOpIndex ].iType, 1, 1, pScriptFile );
+                pOpList [ iCurrOpIndex ].iType = 0;
+
+                if ( iIsCompact )
+                {
+                    int iOpTypes = g_InstrSigTable [ iOpcode ].OpList [ iCurrOpIndex ];
+                    int iShapeBitCount = GetOpShapeBitCount ( iOpTypes );
+
+                    pOpList [ iCurrOpIndex ].iType = GetShapeOpType ( iOpTypes, iShapes & ( ( 1 << iShapeBitCount ) - 1 ) );
+                    iShapes >>= iShapeBitCount;
+                }
+                else
+                {
+				    fread ( & pOpList [ iCurrOpIndex ].iType, 1, 1, pScriptFile );
+                }
 
 				// Depending on the type, read in the operand data
 
@@ -595,10 +1245,10 @@
 					// Integer literal
 
 					case OP_TYPE_INT:
-						fread ( & pOpList [ iCurrOpIndex ].iIntLiteral, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iIntLiteral = ReadXSESignedInt ( pScriptFile, iIsCompact );
 						break;
 
-					// Floating-point literal
+					// Floating-point literal (4 bytes in either format)
 
 					case OP_TYPE_FLOAT:
 						fread ( & pOpList [ iCurrOpIndex ].fFloatLiteral, sizeof ( float ), 1, pScriptFile );
@@ -607,75 +1257,105 @@
 					// String index
 
 					case OP_TYPE_STRING:
-
-						// Since there's no field in the Value structure for string table
-						// indices, read the index into the integer literal field and set
-						// its type to string index
-
-						fread ( & pOpList [ iCurrOpIndex ].iIntLiteral, sizeof ( int ), 1, pScriptFile );
-						pOpList [ iCurrOpIndex ].iType = OP_TYPE_STRING;
+						pOpList [ iCurrOpIndex ].iStringIndex = ReadXSEInt ( pScriptFile, iIsCompact, sizeof ( int ) );
 						break;
 
-					// Instruction index
+					// Instruction index, which the compact format stores relative to the
+					// current instruction
 
 					case OP_TYPE_INSTR_INDEX:
-						fread ( & pOpList [ iCurrOpIndex ].iInstrIndex, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iInstrIndex = ReadXSESignedInt ( pScriptFile, iIsCompact );
+                        if ( iIsCompact )
+                            pOpList [ iCurrOpIndex ].iInstrIndex = ( int ) ( ( unsigned int ) pOpList [ iCurrOpIndex ].iInstrIndex + iCurrInstrIndex );
 						break;
 
 					// Absolute stack index
 
 					case OP_TYPE_ABS_STACK_INDEX:
-						fread ( & pOpList [ iCurrOpIndex ].iStackIndex, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iStackIndex = ReadXSESignedInt ( pScriptFile, iIsCompact );
 						break;
 
 					// Relative stack index
 
 					case OP_TYPE_REL_STACK_INDEX:
-						fread ( & pOpList [ iCurrOpIndex ].iStackIndex, sizeof ( int ), 1, pScriptFile );
-						fread ( & pOpList [ iCurrOpIndex ].iOffsetIndex, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iStackIndex = ReadXSESignedInt ( pScriptFile, iIsCompact );
+						pOpList [ iCurrOpIndex ].iOffsetIndex = ReadXSESignedInt ( pScriptFile, iIsCompact );
 						break;
 
 					// Function index
 
 					case OP_TYPE_FUNC_INDEX:
-						fread ( & pOpList [ iCurrOpIndex ].iFuncIndex, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iFuncIndex = ReadXSEInt ( pScriptFile, iIsCompact, sizeof ( int ) );
 						break;
 
 					// Host API call index
 
 					case OP_TYPE_HOST_API_CALL_INDEX:
-						fread ( & pOpList [ iCurrOpIndex ].iHostAPICallIndex, sizeof ( int ), 1, pScriptFile );
+						pOpList [ iCurrOpIndex ].iHostAPICallIndex = ReadXSEInt ( pScriptFile, iIsCompact, sizeof ( int ) );
+						break;
+
+					// Jump table index, which only the compact format has
+
+					case OP_TYPE_JUMP_TABLE_INDEX:
+                        if ( ! iIsCompact )
+                            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
+						pOpList [ iCurrOpIndex ].iJumpTableIndex = ReadXSEInt ( pScriptFile, iIsCompact, sizeof ( int ) );
 						break;
 
-					// Register
+					// Register, which the compact format doesn't store since _RetVal is the
+					// only one
 
 					case OP_TYPE_REG:
-						fread ( & pOpList [ iCurrOpIndex ].iReg, sizeof ( int ), 1, pScriptFile );
+                        pOpList [ iCurrOpIndex ].iReg = 0;
+                        if ( ! iIsCompact )
+						    fread ( & pOpList [ iCurrOpIndex ].iReg, sizeof ( int ), 1, pScriptFile );
 						break;
+
+                    // Anything else can't be parsed, so the script is rejected
+
+                    default:
+                        return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 				}
 			}
+		}
 
-			// Assign the operand list pointer to the instruction stream
+        // Give back whatever part of the operand array wasn't used. Since the array won't
+        // move again after this, each instruction can now be pointed at its own operands.
 
-			g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].pOpList = pOpList;
-		}
+        int iOpCount = g_Scripts [ iThreadIndex ].InstrStream.iOpCount;
+        Op * pOps = ( Op * ) realloc ( g_Scripts [ iThreadIndex ].InstrStream.pOps, ( iOpCount + 1 ) * sizeof ( Op ) );
+        if ( pOps )
+            g_Scripts [ iThreadIndex ].InstrStream.pOps = pOps;
+        else
+            pOps = g_Scripts [ iThreadIndex ].InstrStream.pOps;
+
+        for ( iCurrInstrIndex = 0; iCurrInstrIndex < g_Scripts [ iThreadIndex ].InstrStream.iSize; ++ iCurrInstrIndex )
+        {
+            g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].pOpList = pOps;
+            pOps += g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount;
+        }
 
 		// ---- Read the string table
 
 		// Read the table size (4 bytes)
 
-		int iStringTableSize;
-		fread ( & iStringTableSize, 4, 1, pScriptFile );
+		int iStringTableSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
+
+        if ( iStringTableSize < 0 || iStringTableSize > lFileSize )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		// If the string table exists, read it
+		// If the string table exists, read it. String operands reference the table by index,
+		// so the strings are kept in it for as long as the script is loaded.
 
 		if ( iStringTableSize )
 		{
-			// Allocate a string table of this size
+			// Allocate a string table of this size and clear it
 
-			char ** ppstrStringTable;
-			if ( ! ( ppstrStringTable = ( char ** ) malloc ( iStringTableSize * sizeof ( char * ) ) ) )
-				return XS_LOAD_ERROR_OUT_OF_MEMORY;
+			if ( ! ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings = ( char ** ) malloc ( iStringTableSize * sizeof ( char * ) ) ) )
+				return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
+
+            memset ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings, 0, iStringTableSize * sizeof ( char * ) );
+            g_Scripts [ iThreadIndex ].StringTable.iSize = iStringTableSize;
 
 			// Read in each string
 
@@ -683,14 +1363,18 @@
 			{
 				// Read in the string size (4 bytes)
 
-				int iStringSize;
-				fread ( & iStringSize, 4, 1, pScriptFile );
+				int iStringSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
+
+                // Make sure the string fits in what's left of the file
+
+                if ( iStringSize < 0 || feof ( pScriptFile ) || iStringSize > lFileSize - ftell ( pScriptFile ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
 				// Allocate space for the string plus a null terminator
 
 				char * pstrCurrString;
 				if ( ! ( pstrCurrString = ( char * ) malloc ( iStringSize + 1 ) ) )
-					return XS_LOAD_ERROR_OUT_OF_MEMORY;
+					return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
 				// Read in the string data (N bytes) and append the null terminator
 
@@ -699,72 +1383,25 @@
 
 				// Assign the string pointer to the string table
 
-				ppstrStringTable [ iCurrStringIndex ] = pstrCurrString;
-			}
-
-			// Run through each operand in the instruction stream and assign copies of string
-			// operand's corresponding string literals
-
-			for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_Scripts [ iThreadIndex ].InstrStream.iSize; ++ iCurrInstrIndex )
-			{
-				// Get the instruction's operand count and a copy of it's operand list
-
-				int iOpCount = g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount;
-				Value * pOpList = g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].pOpList;
-
-				// Loop through each operand
-
-				for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
-				{
-					// If the operand is a string index, make a local copy of it's corresponding
-					// string in the table
-
-					if ( pOpList [ iCurrOpIndex ].iType == OP_TYPE_STRING )
-					{
-						// Get the string index from the operand's integer literal field
-
-						int iStringIndex = pOpList [ iCurrOpIndex ].iIntLiteral;
-
-						// Allocate a new string to hold a copy of the one in the table
-
-						char * pstrStringCopy;
-						if ( ! ( pstrStringCopy = ( char * ) malloc ( strlen ( ppstrStringTable [ iStringIndex ] ) + 1 ) ) )
-							return XS_LOAD_ERROR_OUT_OF_MEMORY;
-
-						// Make a copy of the string
-
-						strcpy ( pstrStringCopy, ppstrStringTable [ iStringIndex ] );
-
-						// Save the string pointer in the operand list
-
-						pOpList [ iCurrOpIndex ].pstrStringLiteral = pstrStringCopy;
-					}
-				}
+				g_Scripts [ iThreadIndex ].StringTable.ppstrStrings [ iCurrStringIndex ] = pstrCurrString;
 			}
-
-			// ---- Free the original strings
-
-			for ( iCurrStringIndex = 0; iCurrStringIndex < iStringTableSize; ++ iCurrStringIndex )
-				free ( ppstrStringTable [ iCurrStringIndex ] );
-
-			// ---- Free the string table itself
-
-			free ( ppstrStringTable );
 		}
 
 		// ---- Read the function table
 
 		// Read the function count (4 bytes)
 
-		int iFuncTableSize;
-		fread ( & iFuncTableSize, 4, 1, pScriptFile );
+		int iFuncTableSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
-        g_Scripts [ iThreadIndex ].FuncTable.iSize = iFuncTableSize;
+        if ( iFuncTableSize < 0 || iFuncTableSize > lFileSize )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
 		// Allocate the table
 
 		if ( ! ( g_Scripts [ iThreadIndex ].FuncTable.pFuncs = ( Func * ) malloc ( iFuncTableSize * sizeof ( Func ) ) ) )
-			return XS_LOAD_ERROR_OUT_OF_MEMORY;
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
+
+        g_Scripts [ iThreadIndex ].FuncTable.iSize = iFuncTableSize;
 
 		// Read each function
 
@@ -772,27 +1409,27 @@
 		{
 			// Read the entry point (4 bytes)
 
-			int iEntryPoint;
-			fread ( & iEntryPoint, 4, 1, pScriptFile );
+			int iEntryPoint = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
 			// Read the parameter count (1 byte)
 
-			int iParamCount = 0;
-			fread ( & iParamCount, 1, 1, pScriptFile );
+			int iParamCount = ReadXSEInt ( pScriptFile, iIsCompact, 1 );
 
 			// Read the local data size (4 bytes)
 
-			int iLocalDataSize;
-			fread ( & iLocalDataSize, 4, 1, pScriptFile );
+			int iLocalDataSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
 			// Calculate the stack size
 
 			int iStackFrameSize = iParamCount + 1 + iLocalDataSize;
 
-            // Read the function name length (1 byte)
+            // Read the function name length (1 byte), which has to fit in the function
+            // structure
 
-            int iFuncNameLength = 0;
-            fread ( & iFuncNameLength, 1, 1, pScriptFile );
+            int iFuncNameLength = ReadXSEInt ( pScriptFile, iIsCompact, 1 );
+
+            if ( iFuncNameLength < 0 || iFuncNameLength > MAX_FUNC_NAME_SIZE )
+                return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
             // Read the function name (N bytes) and append a null-terminator
 
@@ -811,12 +1448,18 @@
 
 		// Read the host API call count
 
-		fread ( & g_Scripts [ iThreadIndex ].HostAPICallTable.iSize, 4, 1, pScriptFile );
+        int iHostAPICallTableSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
-		// Allocate the table
+        if ( iHostAPICallTableSize < 0 || iHostAPICallTableSize > lFileSize )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		if ( ! ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls = ( char ** ) malloc ( g_Scripts [ iThreadIndex ].HostAPICallTable.iSize * sizeof ( char * ) ) ) )
-			return XS_LOAD_ERROR_OUT_OF_MEMORY;
+		// Allocate the table and clear it
+
+		if ( ! ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls = ( char ** ) malloc ( iHostAPICallTableSize * sizeof ( char * ) ) ) )
+			return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
+
+        memset ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls, 0, iHostAPICallTableSize * sizeof ( char * ) );
+        g_Scripts [ iThreadIndex ].HostAPICallTable.iSize = iHostAPICallTableSize;
 
 		// Read each host API call
 
@@ -824,14 +1467,18 @@
 		{
 			// Read the host API call string size (1 byte)
 
-			int iCallLength = 0;
-			fread ( & iCallLength, 1, 1, pScriptFile );
+			int iCallLength = ReadXSEInt ( pScriptFile, iIsCompact, 1 );
+
+            // Make sure the string fits in what's left of the file
+
+            if ( iCallLength < 0 || feof ( pScriptFile ) || iCallLength > lFileSize - ftell ( pScriptFile ) )
+                return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
 			// Allocate space for the string plus the null terminator in a temporary pointer
 
 			char * pstrCurrCall;
 			if ( ! ( pstrCurrCall = ( char * ) malloc ( iCallLength + 1 ) ) )
-				return XS_LOAD_ERROR_OUT_OF_MEMORY;
+				return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
 			// Read the host API call string data and append the null terminator
 
@@ -843,91 +1490,138 @@
 			g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls [ iCurrCallIndex ] = pstrCurrCall;
 		}
 
-        // ---- Close the input file
+        // ---- Read the jump table table
 
-        fclose ( pScriptFile );
+        // Only compact executables have jump tables
 
-		// The script is fully loaded and ready to go, so set the active flag
+        if ( iIsCompact )
+        {
+            // Read the table count
 
-		g_Scripts [ iThreadIndex ].iIsActive = TRUE;
+            int iJumpTableTableSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
-		// Reset the script
+            if ( iJumpTableTableSize < 0 || iJumpTableTableSize > lFileSize )
+                return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		XS_ResetScript ( iThreadIndex );
+            // Allocate the table and clear it, so a partially read table can be freed
 
-		// Return a success code
+            if ( iJumpTableTableSize )
+            {
+                if ( ! ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables = ( JumpTable * ) malloc ( iJumpTableTableSize * sizeof ( JumpTable ) ) ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
-		return XS_LOAD_OK;
-	}
+                memset ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables, 0, iJumpTableTableSize * sizeof ( JumpTable ) );
+                g_Scripts [ iThreadIndex ].JumpTableTable.iSize = iJumpTableTableSize;
+            }
 
-	/******************************************************************************************
-	*
-	*	XS_UnloadScript ()
-	*
-	*	Unloads a script from memory.
-	*/
+            // Read each jump table
 
-    void XS_UnloadScript ( int iThreadIndex )
-    {
-		// Exit if the script isn't active
+            for ( int iCurrJumpTableIndex = 0; iCurrJumpTableIndex < iJumpTableTableSize; ++ iCurrJumpTableIndex )
+            {
+                JumpTable * pJumpTable = & g_Scripts [ iThreadIndex ].JumpTableTable.pTables [ iCurrJumpTableIndex ];
 
-		if ( ! g_Scripts [ iThreadIndex ].iIsActive )
-			return;
+                // Read the base and size. Every entry takes at least a byte, so the entries
+                // have to fit in what's left of the file.
 
-        // ---- Free The instruction stream
+                pJumpTable->iBase = ReadXSESignedInt ( pScriptFile, iIsCompact );
+                int iJumpTableSize = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
 
-		// First check to see if any instructions have string operands, and free them if they
-		// do
+                if ( iJumpTableSize <= 0 || feof ( pScriptFile ) || iJumpTableSize > lFileSize - ftell ( pScriptFile ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		for ( int iCurrInstrIndex = 0; iCurrInstrIndex < g_Scripts [ iThreadIndex ].InstrStream.iSize; ++ iCurrInstrIndex )
-		{
-			// Make a local copy of the operand count and operand list
+                // Allocate and read the entries
 
-			int iOpCount = g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].iOpCount;
-			Value * pOpList = g_Scripts [ iThreadIndex ].InstrStream.pInstrs [ iCurrInstrIndex ].pOpList;
+                if ( ! ( pJumpTable->piTargets = ( int * ) malloc ( iJumpTableSize * sizeof ( int ) ) ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
-			// Loop through each operand and free its string pointer
+                pJumpTable->iSize = iJumpTableSize;
 
-			for ( int iCurrOpIndex = 0; iCurrOpIndex < iOpCount; ++ iCurrOpIndex )
-				if ( pOpList [ iCurrOpIndex ].pstrStringLiteral )
-					pOpList [ iCurrOpIndex ].pstrStringLiteral;
-		}
+                for ( int iCurrEntryIndex = 0; iCurrEntryIndex < iJumpTableSize; ++ iCurrEntryIndex )
+                    pJumpTable->piTargets [ iCurrEntryIndex ] = ReadXSEInt ( pScriptFile, iIsCompact, 4 );
+            }
+        }
 
-		// Now free the stream itself
+        // ---- Find the line table
 
-		if ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs )
-			free ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs );
+        // The line table is only needed for error reports and profiling, so it isn't read
+        // now. Just remember where it is, so it can be read the first time it's asked for.
+
+        if ( iIsCompact && ! feof ( pScriptFile ) && lFileSize - ftell ( pScriptFile ) > 4 )
+        {
+            char pstrLineTableID [ 4 ];
+            fread ( pstrLineTableID, 4, 1, pScriptFile );
+
+            if ( memcmp ( pstrLineTableID, LINE_TABLE_ID_STRING, 4 ) == 0 )
+            {
+                if ( ! ( g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename = ( char * ) malloc ( strlen ( pstrFilename ) + 1 ) ) )
+                    return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
-		// ---- Free the runtime stack
+                strcpy ( g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename, pstrFilename );
+                g_Scripts [ iThreadIndex ].LineTable.lOffset = ftell ( pScriptFile );
+            }
+        }
 
-		// Free any strings that are still on the stack
+        // ---- Verify the script
 
-		for ( int iCurrElmtnIndex = 0; iCurrElmtnIndex < g_Scripts [ iThreadIndex ].Stack.iSize; ++ iCurrElmtnIndex )
-			if ( g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmtnIndex ].iType == OP_TYPE_STRING )
-				free ( g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmtnIndex ].pstrStringLiteral );
+        // Reject the script if the file ended before all of the tables were read, or if the
+        // verifier finds anything that would let the script run outside of its own data.
+        // Since every loaded script has been verified, the execution loop doesn't have to
+        // validate operands, indices or jump targets as it runs.
 
-		// Now free the stack itself
+        if ( feof ( pScriptFile ) || ! VerifyScript ( iThreadIndex ) )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_INVALID_XSE );
 
-		if ( g_Scripts [ iThreadIndex ].Stack.pElmnts )
-			free ( g_Scripts [ iThreadIndex ].Stack.pElmnts );
+        // ---- Build the literal values
 
-		// ---- Free the function table
+        if ( ! BuildLiterals ( iThreadIndex ) )
+            return AbortScriptLoad ( iThreadIndex, pScriptFile, XS_LOAD_ERROR_OUT_OF_MEMORY );
 
-		if ( g_Scripts [ iThreadIndex ].FuncTable.pFuncs )
-			free ( g_Scripts [ iThreadIndex ].FuncTable.pFuncs );
+        // ---- Close the input file
 
-		// --- Free the host API call table
+        fclose ( pScriptFile );
 
-		// First free each string in the table individually
+		// The script is fully loaded and ready to go, so set the active flag
+		g_Scripts [ iThreadIndex ].iIsActive = TRUE;
 
-		for ( int iCurrCallIndex = 0; iCurrCallIndex < g_Scripts [ iThreadIndex ].HostAPICallTable.iSize; ++ iCurrCallIndex )
-			if ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls [ iCurrCallIndex ] )
-				free ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls [ iCurrCallIndex ] );
+		// Reset the script
+
+		XS_ResetScript ( iThreadIndex );
+
+		// Return a success code
+
+		return XS_LOAD_OK;
+	}
+
+	/******************************************************************************************
+	*
+	*	XS_UnloadScript ()
+	*
+	*	Unloads a script from memory.
+	*/
+
+    void XS_UnloadScript ( int iThreadIndex )
+    {
+		// Exit if the script isn't active
+
+		if ( ! g_Scripts [ iThreadIndex ].iIsActive )
+			return;
+
+        // Destroy the script's coroutines
+
+        for ( int iCurrCoroutine = 0; iCurrCoroutine < g_iCoroutinePoolSize; ++ iCurrCoroutine )
+            if ( g_pCoroutines [ iCurrCoroutine ].iIsActive && g_pCoroutines [ iCurrCoroutine ].iThreadIndex == iThreadIndex )
+                XS_DestroyCoroutine ( iCurrCoroutine );
 
-		// Now free the table itself
+        // Destroy the script's batches
 
-		if ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls )
-			free ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls );
+        for ( int iCurrBatch = 0; iCurrBatch < MAX_BATCH_COUNT; ++ iCurrBatch )
+            if ( g_Batches [ iCurrBatch ].iIsActive && g_Batches [ iCurrBatch ].iThreadIndex == iThreadIndex )
+                XS_DestroyBatch ( iCurrBatch );
+
+        // Free everything the script allocated and mark its slot as free
+
+        FreeScript ( iThreadIndex );
+        g_Scripts [ iThreadIndex ].iIsActive = FALSE;
     }
 
 	/******************************************************************************************
@@ -967,9 +1661,10 @@
         for ( int iCurrElmntIndex = 0; iCurrElmntIndex < g_Scripts [ iThreadIndex ].Stack.iSize; ++ iCurrElmntIndex )
             g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmntIndex ].iType = OP_TYPE_NULL;
 
-		// Unpause the script
+		// Unpause the script and restart its instruction count
 
 		g_Scripts [ iThreadIndex ].iIsPaused = FALSE;
+        g_Scripts [ iThreadIndex ].iInstrCount = 0;
 
         // Allocate space for the globals
 
@@ -979,7 +1674,8 @@
         // compensate for the function index that usually sits on top of stack frames and
         // causes indices to start from -2)
 
-        PushFrame ( iThreadIndex, g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iMainFuncIndex ].iLocalDataSize + 1 );
+        if ( g_Scripts [ iThreadIndex ].iIsMainFuncPresent )
+            PushFrame ( iThreadIndex, g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iMainFuncIndex ].iLocalDataSize + 1 );
 	}
 
 	/******************************************************************************************
@@ -998,6 +1694,10 @@
 
         int iExitExecLoop = FALSE;
 
+        // Create a flag that lets a thread yield the rest of its timeslice
+
+        int iIsTimesliceYielded = FALSE;
+
         // Create a variable to hold the time at which the main timeslice started
 
         int iMainTimesliceStartTime = GetCurrTime ();
@@ -1009,13 +1709,17 @@
 		while ( TRUE )
 		{
 			// Check to see if all threads have terminated, and if so, break the execution
-            // cycle
+            // cycle. This runs before every instruction, so stop at the first running thread
+            // rather than touching every script in the array.
 			
 			int iIsStillActive = FALSE;
 			for ( int iCurrThreadIndex = 0; iCurrThreadIndex < MAX_THREAD_COUNT; ++ iCurrThreadIndex )
 			{
 				if ( g_Scripts [ iCurrThreadIndex ].iIsActive && g_Scripts [ iCurrThreadIndex ].iIsRunning )
+                {
 					iIsStillActive = TRUE;
+                    break;
+                }
 			}
 			if ( ! iIsStillActive )
 			    break;
@@ -1028,12 +1732,14 @@
 
             if ( g_iCurrThreadMode == THREAD_MODE_MULTI )
             {
-			    // If the current thread's timeslice has elapsed, or if it's terminated switch
-			    // to the next valid thread
+			    // If the current thread's timeslice has elapsed or been yielded, or if it's
+			    // terminated switch to the next valid thread
 
 			    if ( iCurrTime > g_iCurrThreadActiveTime + g_Scripts [ g_iCurrThread ].iTimesliceDur ||
-				     ! g_Scripts [ g_iCurrThread ].iIsRunning )
+				     ! g_Scripts [ g_iCurrThread ].iIsRunning || iIsTimesliceYielded )
 			    {
+                    iIsTimesliceYielded = FALSE;
+
 				    // Loop until the next thread is found
 
 				    while ( TRUE )
@@ -1087,8 +1793,13 @@
            
             int iOpcode = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].iOpcode;
 
+            // Count it, so the host can measure throughput
+
+            ++ g_Scripts [ g_iCurrThread ].iInstrCount;
+
   		    // Execute the current instruction based on its opcode, as long as we aren't
-            // currently paused
+            // currently paused. Scripts are verified when they're loaded, so the opcode, its
+            // operands and everything they reference can be used without further checks.
 
 			switch ( iOpcode )
 			{
@@ -1683,7 +2394,7 @@
 
                     // Check for the presence of a stack base marker
 
-                    if ( FuncIndex.iType = OP_TYPE_STACK_BASE_MARKER )
+                    if ( FuncIndex.iType == OP_TYPE_STACK_BASE_MARKER )
                         iExitExecLoop = TRUE;
 
                     // Get the previous function index
@@ -1716,42 +2427,15 @@
                     // Use operand zero to index into the host API call table and get the
                     // host API function name
 
-                    Value HostAPICall = ResolveOpValue ( 0 );
-                    int iHostAPICallIndex = HostAPICall.iHostAPICallIndex;
-
-                    // Get the name of the host API function
-
-                    char * pstrFuncName = GetHostAPICall ( iHostAPICallIndex );
-
-                    // Search through the host API until the matching function is found
-
-                    int iMatchFound = FALSE;
-                    for ( int iHostAPIFuncIndex = 0; iHostAPIFuncIndex < MAX_HOST_API_SIZE; ++ iHostAPIFuncIndex )
-                    {
-                        // Get a pointer to the name of the current host API function
-
-                        char * pstrCurrHostAPIFunc = g_HostAPI [ iHostAPIFuncIndex ].pstrName;
+                    char * pstrFuncName = ResolveOpAsHostAPICall ( 0 );
 
-                        // If it equals the requested name, it might be a match
-
-                        if ( stricmp ( pstrFuncName, pstrCurrHostAPIFunc ) == 0 )
-                        {
-                            // Make sure the function is visible to the current thread
-
-                            int iThreadIndex = g_HostAPI [ iHostAPIFuncIndex ].iThreadIndex;
-                            if ( iThreadIndex == g_iCurrThread || iThreadIndex == XS_GLOBAL_FUNC )
-                            {
-                                iMatchFound = TRUE;
-                                break;
-                            }
-                        }
-                    }
+                    // Look the function up in the host API, and if it was found, call it and
+                    // pass the current thread index
 
-                    // If a match was found, call the host API funcfion and pass the current
-                    // thread index
+                    HostAPIFuncPntr fnFunc = GetHostAPIFunc ( g_iCurrThread, pstrFuncName );
 
-                    if ( iMatchFound )
-                        g_HostAPI [ iHostAPIFuncIndex ].fnFunc ( g_iCurrThread );
+                    if ( fnFunc )
+                        fnFunc ( g_iCurrThread );
 
 					break;
                 }
@@ -1760,6 +2444,16 @@
 
 				case INSTR_PAUSE:
                 {
+                    // Coroutines only run when the host resumes them, so a pause inside one
+                    // just suspends it like a yield
+
+                    if ( g_iCurrCoroutine != -1 )
+                    {
+                        g_pCoroutines [ g_iCurrCoroutine ].iState = XS_COROUTINE_SUSPENDED;
+                        iExitExecLoop = TRUE;
+                        break;
+                    }
+
                     // Get the pause duration
 
                     int iPauseDuration = ResolveOpAsInt ( 0 );
@@ -1789,963 +2483,4497 @@
 
                     g_Scripts [ g_iCurrThread ].iIsRunning = FALSE;
 
+                    // If this is a host call, coroutine or batch lane, only it ends, and the
+                    // host gets control back right away
+
+                    if ( g_iCurrThreadMode == THREAD_MODE_SINGLE )
+                        iExitExecLoop = TRUE;
+
                     break;
 				}
-			}
 
-            // If the instruction pointer hasn't been changed by an instruction, increment it
+                case INSTR_YIELD:
+                {
+                    // Suspend the running coroutine and return to the host that resumed it
 
-            if ( iCurrInstr == g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr )
-                ++ g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+                    if ( g_iCurrCoroutine != -1 )
+                    {
+                        g_pCoroutines [ g_iCurrCoroutine ].iState = XS_COROUTINE_SUSPENDED;
+                        iExitExecLoop = TRUE;
+                    }
 
-            // If we aren't running indefinitely, check to see if the main timeslice has ended
+                    // Outside of a coroutine, give up the rest of the thread's timeslice
+
+                    else
+                    {
+                        iIsTimesliceYielded = TRUE;
+                    }
 
-            if ( iTimesliceDur != XS_INFINITE_TIMESLICE )
-                if ( iCurrTime > iMainTimesliceStartTime + iTimesliceDur )
                     break;
+                }
 
-            // Exit the execution loop if the script has terminated
+                // ---- Typed Operations
 
-            if ( iExitExecLoop )
-				break;
-		}
-	}
+                // The compiler only emits these when it has proven the types of the operands,
+                // so the source's value is used as-is and the destination is overwritten
+                // without looking at what it held. The destination's type is still set, which
+                // keeps a hand-written script that gets the types wrong from corrupting a
+                // string pointer.
 
-	/******************************************************************************************
-	*
-	*	XS_StartScript ()
-	*
-    *   Starts the execution of a script.
-	*/
+                // Integer Arithmetic
 
-	void XS_StartScript ( int iThreadIndex )
-	{
-        // Make sure the thread index is valid and active
+                case INSTR_IADD:
+                case INSTR_ISUB:
+                case INSTR_IMUL:
+                case INSTR_IDIV:
+                case INSTR_IMOD:
+                {
+                    // Get the source's integer field (operand index 1)
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
+                    int iSource = ResolveOpValue ( 1 ).iIntLiteral;
 
-        // Set the thread's execution flag
+                    // Get a pointer to the destination (operand index 0)
 
-        g_Scripts [ iThreadIndex ].iIsRunning = TRUE;
+                    Value * pDest = ResolveOpPntr ( 0 );
 
-        // Set the current thread to the script
+                    switch ( iOpcode )
+                    {
+                        case INSTR_IADD:
+                            pDest->iIntLiteral += iSource;
+                            break;
 
-        g_iCurrThread = iThreadIndex;
+                        case INSTR_ISUB:
+                            pDest->iIntLiteral -= iSource;
+                            break;
 
-		// Set the activation time for the current thread to get things rolling
+                        case INSTR_IMUL:
+                            pDest->iIntLiteral *= iSource;
+                            break;
 
-        g_iCurrThreadActiveTime = GetCurrTime ();
-    }
+                        case INSTR_IDIV:
+                            pDest->iIntLiteral /= iSource;
+                            break;
 
-	/******************************************************************************************
-	*
-	*	XS_StopScript ()
-	*
-    *   Stops the execution of a script.
-	*/
+                        case INSTR_IMOD:
+                            pDest->iIntLiteral %= iSource;
+                            break;
+                    }
 
-	void XS_StopScript ( int iThreadIndex )
-	{
-        // Make sure the thread index is valid and active
+                    pDest->iType = OP_TYPE_INT;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
+                    break;
+                }
 
-        // Clear the thread's execution flag
+                case INSTR_IINC:
+                case INSTR_IDEC:
+                {
+                    // Get a pointer to the destination (operand index 0)
 
-        g_Scripts [ iThreadIndex ].iIsRunning = FALSE;
-    }
+                    Value * pDest = ResolveOpPntr ( 0 );
 
-	/******************************************************************************************
-	*
-	*	XS_PauseScript ()
-	*
-    *   Pauses a script for a specified duration.
-	*/
+                    if ( iOpcode == INSTR_IINC )
+                        ++ pDest->iIntLiteral;
+                    else
+                        -- pDest->iIntLiteral;
 
-	void XS_PauseScript ( int iThreadIndex, int iDur )
-	{
-        // Make sure the thread index is valid and active
+                    pDest->iType = OP_TYPE_INT;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
+                    break;
+                }
 
-        // Set the pause flag
+                // Floating-Point Arithmetic
 
-        g_Scripts [ iThreadIndex ].iIsPaused = TRUE;
+                case INSTR_FADD:
+                case INSTR_FSUB:
+                case INSTR_FMUL:
+                case INSTR_FDIV:
+                {
+                    // Get the source's float field (operand index 1)
 
-        // Set the duration of the pause
+                    float fSource = ResolveOpValue ( 1 ).fFloatLiteral;
 
-        g_Scripts [ iThreadIndex ].iPauseEndTime = GetCurrTime () + iDur;
-    }
+                    // Get a pointer to the destination (operand index 0)
 
-	/******************************************************************************************
-	*
-	*	XS_UnpauseScript ()
-	*
-    *   Unpauses a script.
-	*/
+                    Value * pDest = ResolveOpPntr ( 0 );
 
-	void XS_UnpauseScript ( int iThreadIndex )
-	{
-        // Make sure the thread index is valid and active
+                    switch ( iOpcode )
+                    {
+                        case INSTR_FADD:
+                            pDest->fFloatLiteral += fSource;
+                            break;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
+                        case INSTR_FSUB:
+                            pDest->fFloatLiteral -= fSource;
+                            break;
 
-        // Clear the pause flag
+                        case INSTR_FMUL:
+                            pDest->fFloatLiteral *= fSource;
+                            break;
 
-        g_Scripts [ iThreadIndex ].iIsPaused = FALSE;
-    }
+                        case INSTR_FDIV:
+                            pDest->fFloatLiteral /= fSource;
+                            break;
+                    }
 
-	/******************************************************************************************
-	*
-	*	XS_GetReturnValueAsInt ()
-	*
-	*	Returns the last returned value as an integer.
-	*/
+                    pDest->iType = OP_TYPE_FLOAT;
 
-    int XS_GetReturnValueAsInt ( int iThreadIndex )
-    {
-        // Make sure the thread index is valid and active
+                    break;
+                }
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return 0;
+                // Integer Conditional Branching
 
-        // Return _RetVal's integer field
+                case INSTR_IJE:
+                case INSTR_IJNE:
+                case INSTR_IJG:
+                case INSTR_IJL:
+                case INSTR_IJGE:
+                case INSTR_IJLE:
+                {
+                    // Get the integer fields of the two operands
 
-        return g_Scripts [ iThreadIndex ]._RetVal.iIntLiteral;
-    }
+                    int iOp0 = ResolveOpValue ( 0 ).iIntLiteral;
+                    int iOp1 = ResolveOpValue ( 1 ).iIntLiteral;
 
-	/******************************************************************************************
-	*
-	*	XS_GetReturnValueAsFloat ()
-	*
-	*	Returns the last returned value as an float.
-	*/
+                    // Perform the specified comparison
 
-    float XS_GetReturnValueAsFloat ( int iThreadIndex )
-    {
-        // Make sure the thread index is valid and active
+                    int iJump;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return 0;
+                    switch ( iOpcode )
+                    {
+                        case INSTR_IJE:
+                            iJump = iOp0 == iOp1;
+                            break;
 
-        // Return _RetVal's floating-point field
+                        case INSTR_IJNE:
+                            iJump = iOp0 != iOp1;
+                            break;
 
-        return g_Scripts [ iThreadIndex ]._RetVal.fFloatLiteral;
-    }
+                        case INSTR_IJG:
+                            iJump = iOp0 > iOp1;
+                            break;
 
-	/******************************************************************************************
-	*
-	*	XS_GetReturnValueAsString ()
-	*
-	*	Returns the last returned value as a string.
-	*/
+                        case INSTR_IJL:
+                            iJump = iOp0 < iOp1;
+                            break;
 
-    char * XS_GetReturnValueAsString ( int iThreadIndex )
-    {
-        // Make sure the thread index is valid and active
+                        case INSTR_IJGE:
+                            iJump = iOp0 >= iOp1;
+                            break;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return NULL;
+                        default:
+                            iJump = iOp0 <= iOp1;
+                            break;
+                    }
 
-        // Return _RetVal's string field
+                    // If the comparison evaluated to TRUE, jump to the target instruction
+                    // (operand index 2)
 
-        return g_Scripts [ iThreadIndex ]._RetVal.pstrStringLiteral;
-    }
+                    if ( iJump )
+                        g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr = ResolveOpAsInstrIndex ( 2 );
 
-    /******************************************************************************************
-    *
-    *   CopyValue ()
-    *
-    *   Copies a value structure to another, taking strings into account.
-    */
+                    break;
+                }
 
-    void CopyValue ( Value * pDest, Value Source )
-    {
-        // If the destination already contains a string, make sure to free it first
+                // ---- Indexed Branching
 
-        if ( pDest->iType == OP_TYPE_STRING )
-            free ( pDest->pstrStringLiteral );
+                case INSTR_JTAB:
+                {
+                    // Get the value and the jump table (operand index 1)
 
-        // Copy the object
+                    Value Op0 = ResolveOpValue ( 0 );
+                    JumpTable * pJumpTable = ResolveOpAsJumpTable ( 1 );
 
-        * pDest = Source;
+                    // Jump to the value's entry if it's an integer in the table's range.
+                    // Subtracting the base and comparing unsigned handles both ends of the
+                    // range at once. Anything else goes to the default target (operand
+                    // index 2).
 
-        // Make a physical copy of the source string, if necessary
+                    unsigned int iEntryIndex = ( unsigned int ) ( Op0.iIntLiteral - pJumpTable->iBase );
 
-        if ( Source.iType == OP_TYPE_STRING )
-        {
-            pDest->pstrStringLiteral = ( char * ) malloc ( strlen ( Source.pstrStringLiteral ) + 1 );
-            strcpy ( pDest->pstrStringLiteral, Source.pstrStringLiteral );
-        }
-    }
+                    if ( Op0.iType == OP_TYPE_INT && iEntryIndex < ( unsigned int ) pJumpTable->iSize )
+                        g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr = pJumpTable->piTargets [ iEntryIndex ];
+                    else
+                        g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr = ResolveOpAsInstrIndex ( 2 );
 
-    /******************************************************************************************
-    *
-    *   CoereceValueToInt ()
-    *
-    *   Coerces a Value structure from it's current type to an integer value.
-    */
-
-    int CoerceValueToInt ( Value Val )
-    {
-        // Determine which type the Value currently is
+                    break;
+                }
 
-        switch ( Val.iType )
-        {
-            // It's an integer, so return it as-is
+                // ---- Math Intrinsics
 
-            case OP_TYPE_INT:
-                return Val.iIntLiteral;
+                // These replace host API calls for common math functions. Like the generic
+                // instructions, they coerce their sources and overwrite the destination
+                // entirely.
 
-            // It's a float, so cast it to an integer
+                case INSTR_SQRT:
+                case INSTR_SIN:
+                case INSTR_COS:
+                case INSTR_ATAN2:
+                {
+                    // The result is always a float
 
-            case OP_TYPE_FLOAT:
-                return ( int ) Val.fFloatLiteral;
+                    Value Result;
+                    Result.iType = OP_TYPE_FLOAT;
 
-            // It's a string, so convert it to an integer
+                    float fSource = ResolveOpAsFloat ( 1 );
 
-            case OP_TYPE_STRING:
-                return atoi ( Val.pstrStringLiteral );
+                    switch ( iOpcode )
+                    {
+                        case INSTR_SQRT:
+                            Result.fFloatLiteral = ( float ) sqrt ( fSource );
+                            break;
 
-            // Anything else is invalid
+                        case INSTR_SIN:
+                            Result.fFloatLiteral = ( float ) sin ( fSource );
+                            break;
 
-            default:
-                return 0;
-        }
-    }
+                        case INSTR_COS:
+                            Result.fFloatLiteral = ( float ) cos ( fSource );
+                            break;
 
-    /******************************************************************************************
-    *
-    *   CoereceValueToFloat ()
-    *
-    *   Coerces a Value structure from it's current type to an float value.
-    */
+                        // ATan2 takes Y (operand index 1) then X (operand index 2)
 
-    float CoerceValueToFloat ( Value Val )
-    {
-        // Determine which type the Value currently is
+                        case INSTR_ATAN2:
+                            Result.fFloatLiteral = ( float ) atan2 ( fSource, ResolveOpAsFloat ( 2 ) );
+                            break;
+                    }
 
-        switch ( Val.iType )
-        {
-            // It's an integer, so cast it to a float
+                    CopyValue ( ResolveOpPntr ( 0 ), Result );
 
-            case OP_TYPE_INT:
-                return ( float ) Val.iIntLiteral;
+                    break;
+                }
 
-            // It's a float, so return it as-is
+                // Abs, Min and Max keep integers as integers and coerce anything else to a
+                // float
 
-            case OP_TYPE_FLOAT:
-                return Val.fFloatLiteral;
+                case INSTR_ABS:
+                {
+                    Value Source = ResolveOpValue ( 1 );
+                    Value Result;
 
-            // It's a string, so convert it to an float
+                    if ( Source.iType == OP_TYPE_INT )
+                    {
+                        Result.iType = OP_TYPE_INT;
+                        Result.iIntLiteral = Source.iIntLiteral < 0 ? -Source.iIntLiteral : Source.iIntLiteral;
+                    }
+                    else
+                    {
+                        Result.iType = OP_TYPE_FLOAT;
+                        Result.fFloatLiteral = ( float ) fabs ( CoerceValueToFloat ( Source ) );
+                    }
 
-            case OP_TYPE_STRING:
-                return ( float ) atof ( Val.pstrStringLiteral );
+                    CopyValue ( ResolveOpPntr ( 0 ), Result );
 
-            // Anything else is invalid
+                    break;
+                }
 
-            default:
-                return 0;
-        }
-    }
+                case INSTR_MIN:
+                case INSTR_MAX:
+                {
+                    Value Op0 = ResolveOpValue ( 1 );
+                    Value Op1 = ResolveOpValue ( 2 );
+                    Value Result;
 
-    /******************************************************************************************
-    *
-    *   CoereceValueToString ()
-    *
-    *   Coerces a Value structure from it's current type to a string value.
-    */
+                    if ( Op0.iType == OP_TYPE_INT && Op1.iType == OP_TYPE_INT )
+                    {
+                        Result.iType = OP_TYPE_INT;
 
-    char * CoerceValueToString ( Value Val )
-    {
+                        if ( iOpcode == INSTR_MIN )
+                            Result.iIntLiteral = Op0.iIntLiteral < Op1.iIntLiteral ? Op0.iIntLiteral : Op1.iIntLiteral;
+                        else
+                            Result.iIntLiteral = Op0.iIntLiteral > Op1.iIntLiteral ? Op0.iIntLiteral : Op1.iIntLiteral;
+                    }
+                    else
+                    {
+                        float fOp0 = CoerceValueToFloat ( Op0 );
+                        float fOp1 = CoerceValueToFloat ( Op1 );
 
-        char * pstrCoercion;
-        if ( Val.iType != OP_TYPE_STRING )
-            pstrCoercion = ( char * ) malloc ( MAX_COERCION_STRING_SIZE + 1 );
-            
-        // Determine which type the Value currently is
+                        Result.iType = OP_TYPE_FLOAT;
 
-        switch ( Val.iType )
-        {
-            // It's an integer, so convert it to a string
+                        if ( iOpcode == INSTR_MIN )
+                            Result.fFloatLiteral = fOp0 < fOp1 ? fOp0 : fOp1;
+                        else
+                            Result.fFloatLiteral = fOp0 > fOp1 ? fOp0 : fOp1;
+                    }
 
-			case OP_TYPE_INT:
-				itoa ( Val.iIntLiteral, pstrCoercion, 10 );
-                return pstrCoercion;
+                    CopyValue ( ResolveOpPntr ( 0 ), Result );
 
-			// It's a float, so use sprintf () to convert it since there's no built-in function
-			// for converting floats to strings
+                    break;
+                }
 
-			case OP_TYPE_FLOAT:
-				 sprintf ( pstrCoercion, "%f", Val.fFloatLiteral );
-                 return pstrCoercion;
+                // ---- Vector Intrinsics
 
-            // It's a string, so return it as-is
+                // Each run of elements is addressed by its first element, and the rest
+                // follow it on the stack. The verifier has checked that the count is small
+                // and that runs at absolute indices fit. Every element is treated as a float.
 
-            case OP_TYPE_STRING:
-                return Val.pstrStringLiteral;
+                case INSTR_VADD:
+                case INSTR_VSUB:
+                case INSTR_VSCALE:
+                {
+                    // Get the element count (operand index 2) and the destination run
 
-            // Anything else is invalid
+                    int iCount = ResolveOpValue ( 2 ).iIntLiteral;
+                    Value * pDest = ResolveOpPntr ( 0 );
 
-            default:
-                return NULL;
-        }
-    }
+                    // VScale multiplies each element by a scalar, while VAdd and VSub work
+                    // with a second run
 
-    /******************************************************************************************
-	*
-	*	GetOpType ()
-	*
-	*	Returns the type of the specified operand in the current instruction.
-	*/
+                    float fScale = 0;
+                    Value * pSource = NULL;
 
-	inline int GetOpType ( int iOpIndex )
-	{
-		// Get the current instruction
+                    if ( iOpcode == INSTR_VSCALE )
+                        fScale = ResolveOpAsFloat ( 1 );
+                    else
+                        pSource = ResolveOpPntr ( 1 );
 
-		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+                    Value Result;
+                    Result.iType = OP_TYPE_FLOAT;
 
-		// Return the type
+                    for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iCount; ++ iCurrElmntIndex )
+                    {
+                        float fDest = CoerceValueToFloat ( pDest [ iCurrElmntIndex ] );
 
-		return g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iType;
-	}
+                        switch ( iOpcode )
+                        {
+                            case INSTR_VADD:
+                                Result.fFloatLiteral = fDest + CoerceValueToFloat ( pSource [ iCurrElmntIndex ] );
+                                break;
 
-    /******************************************************************************************
-    *
-    *   ResolveOpStackIndex ()
-    *
-    *   Resolves an operand's stack index, whether it's absolute or relative.
-    */
+                            case INSTR_VSUB:
+                                Result.fFloatLiteral = fDest - CoerceValueToFloat ( pSource [ iCurrElmntIndex ] );
+                                break;
 
-    inline int ResolveOpStackIndex ( int iOpIndex )
-    {
-		// Get the current instruction
+                            case INSTR_VSCALE:
+                                Result.fFloatLiteral = fDest * fScale;
+                                break;
+                        }
 
-		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+                        CopyValue ( & pDest [ iCurrElmntIndex ], Result );
+                    }
 
-		// Get the operand type type
+                    break;
+                }
 
-		Value OpValue = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ];
+                case INSTR_VDOT:
+                {
+                    // Get the element count (operand index 3) and both runs
 
-        // Resolve the stack index based on its type
+                    int iCount = ResolveOpValue ( 3 ).iIntLiteral;
+                    Value * pSource0 = ResolveOpPntr ( 1 );
+                    Value * pSource1 = ResolveOpPntr ( 2 );
 
-        switch ( OpValue.iType )
-        {
-            // It's an absolute index so return it as-is
+                    // Sum the products of each pair of elements
 
-            case OP_TYPE_ABS_STACK_INDEX:
-                return OpValue.iStackIndex;
+                    Value Result;
+                    Result.iType = OP_TYPE_FLOAT;
+                    Result.fFloatLiteral = 0;
 
-            // It's a relative index so resolve it
+                    for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iCount; ++ iCurrElmntIndex )
+                        Result.fFloatLiteral += CoerceValueToFloat ( pSource0 [ iCurrElmntIndex ] ) *
+                                                CoerceValueToFloat ( pSource1 [ iCurrElmntIndex ] );
 
-            case OP_TYPE_REL_STACK_INDEX:
-            {
-                // First get the base index
+                    CopyValue ( ResolveOpPntr ( 0 ), Result );
 
-		        int iBaseIndex = OpValue.iStackIndex;
+                    break;
+                }
+			}
 
-		        // Now get the index of the variable
+            // If the instruction pointer hasn't been changed by an instruction, increment it
 
-		        int iOffsetIndex = OpValue.iOffsetIndex;
+            if ( iCurrInstr == g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr )
+                ++ g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
 
-				// Get the variable's value
+            // A thread that overflowed its stack was stopped, so if it's being run by itself,
+            // the host gets control back right away
 
-				Value StackValue = GetStackValue ( g_iCurrThread, iOffsetIndex );
+            if ( g_iCurrThreadMode == THREAD_MODE_SINGLE && ! g_Scripts [ g_iCurrThread ].iIsRunning )
+                iExitExecLoop = TRUE;
 
-		        // Now add the variable's integer field to the base index to produce the
-		        // absolute index
+            // If we aren't running indefinitely, check to see if the main timeslice has ended
 
-		        return iBaseIndex + StackValue.iIntLiteral;
-            }
+            if ( iTimesliceDur != XS_INFINITE_TIMESLICE )
+                if ( iCurrTime > iMainTimesliceStartTime + iTimesliceDur )
+                    break;
 
-            // Return zero for everything else, but we shouldn't encounter this case
+            // Exit the execution loop if the script has terminated
 
-            default:
-                return 0;
-        }
-    }
+            if ( iExitExecLoop )
+				break;
+		}
+	}
 
 	/******************************************************************************************
 	*
-	*	ResolveOpValue ()
+	*	XS_StartScript ()
 	*
-	*	Resolves an operand and returns it's associated Value structure.
+    *   Starts the execution of a script.
 	*/
 
-	inline Value ResolveOpValue ( int iOpIndex )
+	void XS_StartScript ( int iThreadIndex )
 	{
-		// Get the current instruction
-
-		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
-
-		// Get the operand type
-
-		Value OpValue = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ];
-
-		// Determine what to return based on the value's type
+        // Make sure the thread index is valid and active
 
-		switch ( OpValue.iType )
-		{
-			// It's a stack index so resolve it
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
 
-			case OP_TYPE_ABS_STACK_INDEX:
-			case OP_TYPE_REL_STACK_INDEX:
-			{
-                // Resolve the index and use it to return the corresponding stack element
+        // Set the thread's execution flag
 
-                int iAbsIndex = ResolveOpStackIndex ( iOpIndex );
-                return GetStackValue ( g_iCurrThread, iAbsIndex );
-			}
+        g_Scripts [ iThreadIndex ].iIsRunning = TRUE;
 
-			// It's in _RetVal
+        // Set the current thread to the script
 
-			case OP_TYPE_REG:
-				return g_Scripts [ g_iCurrThread ]._RetVal;
+        g_iCurrThread = iThreadIndex;
 
-			// Anything else can be returned as-is
+		// Set the activation time for the current thread to get things rolling
 
-			default:
-				return OpValue;
-		}
-	}
+        g_iCurrThreadActiveTime = GetCurrTime ();
+    }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpType ()
+	*	XS_StopScript ()
 	*
-	*	Resolves the type of the specified operand in the current instruction and returns the
-	*	resolved type.
+    *   Stops the execution of a script.
 	*/
 
-	inline int ResolveOpType ( int iOpIndex )
+	void XS_StopScript ( int iThreadIndex )
 	{
-		// Resolve the operand's value
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
 
-		// Return the value type
+        // Clear the thread's execution flag
 
-		return OpValue.iType;
-	}
+        g_Scripts [ iThreadIndex ].iIsRunning = FALSE;
+    }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsInt ()
+	*	XS_PauseScript ()
 	*
-	*	Resolves and coerces an operand's value to an integer value.
+    *   Pauses a script for a specified duration.
 	*/
 
-	inline int ResolveOpAsInt ( int iOpIndex )
+	void XS_PauseScript ( int iThreadIndex, int iDur )
 	{
-		// Resolve the operand's value
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
 
-        // Coerce it to an int and return it
+        // Set the pause flag
 
-        int iInt = CoerceValueToInt ( OpValue );
-        return iInt;
-	}
+        g_Scripts [ iThreadIndex ].iIsPaused = TRUE;
+
+        // Set the duration of the pause
+
+        g_Scripts [ iThreadIndex ].iPauseEndTime = GetCurrTime () + iDur;
+    }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsFloat ()
+	*	XS_UnpauseScript ()
 	*
-	*	Resolves and coerces an operand's value to a floating-point value.
+    *   Unpauses a script.
 	*/
 
-	inline float ResolveOpAsFloat ( int iOpIndex )
+	void XS_UnpauseScript ( int iThreadIndex )
 	{
-		// Resolve the operand's value
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
 
-        // Coerce it to a float and return it
+        // Clear the pause flag
 
-        float fFloat = CoerceValueToFloat ( OpValue );
-        return fFloat;
-	}
+        g_Scripts [ iThreadIndex ].iIsPaused = FALSE;
+    }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsString ()
+	*	XS_GetReturnValueAsInt ()
 	*
-	*	Resolves and coerces an operand's value to a string value, allocating the space for a
-    *   new string if necessary.
+	*	Returns the last returned value as an integer.
 	*/
 
-	inline char * ResolveOpAsString ( int iOpIndex )
-	{
-		// Resolve the operand's value
+    int XS_GetReturnValueAsInt ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return 0;
 
-        // Coerce it to a string and return it
+        // Return _RetVal as an integer, coercing it if it's another type
 
-        char * pstrString = CoerceValueToString ( OpValue );
-        return pstrString;
-	}
+        return CoerceValueToInt ( g_Scripts [ iThreadIndex ]._RetVal );
+    }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsInstrIndex ()
+	*	XS_GetReturnValueAsFloat ()
 	*
-	*	Resolves an operand as an intruction index.
+	*	Returns the last returned value as an float.
 	*/
 
-	inline int ResolveOpAsInstrIndex ( int iOpIndex )
-	{
-		// Resolve the operand's value
+    float XS_GetReturnValueAsFloat ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return 0;
 
-        // Return it's instruction index
+        // Return _RetVal as a float, coercing it if it's another type
 
-        return OpValue.iInstrIndex;
+        return CoerceValueToFloat ( g_Scripts [ iThreadIndex ]._RetVal );
     }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsFuncIndex ()
+	*	XS_GetInstrCount ()
 	*
-	*	Resolves an operand as a function index.
+	*	Returns the number of instructions a thread has executed since it was loaded or last
+	*	reset. Only instructions run by XS_RunScripts () are counted, which includes function
+	*	calls from the host, coroutines and batch lanes that run by themselves, but not lanes
+	*	running together in a batch. The count wraps around after 2^32 instructions.
 	*/
 
-	inline int ResolveOpAsFuncIndex ( int iOpIndex )
-	{
-		// Resolve the operand's value
-
-		Value OpValue = ResolveOpValue ( iOpIndex );
+    unsigned int XS_GetInstrCount ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-        // Return the function index
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return 0;
 
-        return OpValue.iFuncIndex;
+        return g_Scripts [ iThreadIndex ].iInstrCount;
     }
 
 	/******************************************************************************************
 	*
-	*	ResolveOpAsHostAPICall ()
+	*	XS_GetCurrInstr ()
 	*
-	*	Resolves an operand as a host API call
+	*	Returns the index of the instruction a thread is executing, or will execute next. From
+	*	inside a host API function, this is the CallHost instruction that called it.
 	*/
 
-	inline char * ResolveOpAsHostAPICall ( int iOpIndex )
-	{
-		// Resolve the operand's value
+    int XS_GetCurrInstr ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-		Value OpValue = ResolveOpValue ( iOpIndex );
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return -1;
 
-        // Get the value's host API call index
+        return g_Scripts [ iThreadIndex ].InstrStream.iCurrInstr;
+    }
 
-        int iHostAPICallIndex = OpValue.iHostAPICallIndex;
+	/******************************************************************************************
+	*
+	*	XS_GetSourceLine ()
+	*
+	*	Returns the source line the specified instruction was compiled from, or zero if the
+	*	script doesn't have a line table or the instruction isn't in it. The line table is
+	*	read from the script's executable the first time this is called.
+	*/
 
-        // Return the host API call
+    int XS_GetSourceLine ( int iThreadIndex, int iInstrIndex )
+    {
+        // Make sure the thread index is valid and active
 
-        return GetHostAPICall ( iHostAPICallIndex );
-    }
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return 0;
 
-    /******************************************************************************************
-    *
-    *   ResolveOpPntr ()
-    *
-    *   Resolves an operand and returns a pointer to its Value structure.
-    */
+        LoadLineTable ( iThreadIndex );
 
-    inline Value * ResolveOpPntr ( int iOpIndex )
-    {
-        // Get the method of indirection
+        // Binary search for the last run that starts at or before the instruction
 
-        int iIndirMethod = GetOpType ( iOpIndex );
+        LineTable * pLineTable = & g_Scripts [ iThreadIndex ].LineTable;
 
-        // Return a pointer to wherever the operand lies
+        int iLow = 0,
+            iHigh = pLineTable->iSize - 1,
+            iSourceLine = 0;
 
-        switch ( iIndirMethod )
+        while ( iLow <= iHigh )
         {
-            // It's on the stack
+            int iMid = ( iLow + iHigh ) / 2;
 
-            case OP_TYPE_ABS_STACK_INDEX:
-            case OP_TYPE_REL_STACK_INDEX:
+            if ( pLineTable->pRuns [ iMid ].iInstrIndex <= iInstrIndex )
             {
-                int iStackIndex = ResolveOpStackIndex ( iOpIndex );
-                return & g_Scripts [ g_iCurrThread ].Stack.pElmnts [ ResolveStackIndex ( iStackIndex ) ];
+                iSourceLine = pLineTable->pRuns [ iMid ].iSourceLine;
+                iLow = iMid + 1;
+            }
+            else
+            {
+                iHigh = iMid - 1;
             }
-
-            // It's _RetVal
-
-            case OP_TYPE_REG:
-                return & g_Scripts [ g_iCurrThread ]._RetVal;
         }
 
-        // Return NULL for anything else
-
-        return NULL;
+        return iSourceLine;
     }
 
 	/******************************************************************************************
 	*
-	*	GetStackValue ()
+	*	XS_GetSourceFilename ()
 	*
-	*	Returns the specified stack value.
+	*	Returns the name of the source file the script's line table refers to, or NULL if it
+	*	doesn't have one. Like XS_GetSourceLine (), this reads the line table if necessary.
 	*/
 
-	inline Value GetStackValue ( int iThreadIndex, int iIndex )
-	{
-		// Use ResolveStackIndex () to return the element at the specified index
+    char * XS_GetSourceFilename ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-		return g_Scripts [ iThreadIndex ].Stack.pElmnts [ ResolveStackIndex ( iIndex ) ];
-	}
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return NULL;
 
-	/******************************************************************************************
-	*
-	*	SetStackValue ()
-	*
-	*	Sets the specified stack value.
-	*/
+        LoadLineTable ( iThreadIndex );
 
-	inline void SetStackValue ( int iThreadIndex, int iIndex, Value Val )
-	{
-		// Use ResolveStackIndex () to set the element at the specified index
+        LineTable * pLineTable = & g_Scripts [ iThreadIndex ].LineTable;
 
-		g_Scripts [ iThreadIndex ].Stack.pElmnts [ ResolveStackIndex ( iIndex ) ] = Val;
-	}
+        if ( ! pLineTable->iSize || ! pLineTable->pstrSourceFilename [ 0 ] )
+            return NULL;
+
+        return pLineTable->pstrSourceFilename;
+    }
 
 	/******************************************************************************************
 	*
-	*	Push ()
+	*	XS_GetReturnValueAsString ()
 	*
-	*	Pushes an element onto the stack.
+	*	Returns the last returned value as a string.
 	*/
 
-	inline void Push ( int iThreadIndex, Value Val )
-	{
-		// Get the current top element
+    char * XS_GetReturnValueAsString ( int iThreadIndex )
+    {
+        // Make sure the thread index is valid and active
 
-		int iTopIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return NULL;
 
-		// Put the value into the current top index
+        // Return _RetVal's string field
 
-		CopyValue ( & g_Scripts [ iThreadIndex ].Stack.pElmnts [ iTopIndex ], Val );
+        return g_Scripts [ iThreadIndex ]._RetVal.pstrStringLiteral;
+    }
 
-		// Increment the top index
+    /******************************************************************************************
+    *
+    *   FreeScript ()
+    *
+    *   Frees the instruction stream, string table, runtime stack, function table, host API
+    *   call table and jump table table of a script. This works on scripts that were only partially loaded as well.
+    */
+
+    void FreeScript ( int iThreadIndex )
+    {
+        // ---- Free the instruction stream
+
+        if ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs )
+        {
+            free ( g_Scripts [ iThreadIndex ].InstrStream.pInstrs );
+            g_Scripts [ iThreadIndex ].InstrStream.pInstrs = NULL;
+        }
+        g_Scripts [ iThreadIndex ].InstrStream.iSize = 0;
+
+        // The operands of every instruction share a single array
+
+        if ( g_Scripts [ iThreadIndex ].InstrStream.pOps )
+        {
+            free ( g_Scripts [ iThreadIndex ].InstrStream.pOps );
+            g_Scripts [ iThreadIndex ].InstrStream.pOps = NULL;
+        }
+        g_Scripts [ iThreadIndex ].InstrStream.iOpCount = 0;
+
+        if ( g_Scripts [ iThreadIndex ].InstrStream.pLiterals )
+        {
+            free ( g_Scripts [ iThreadIndex ].InstrStream.pLiterals );
+            g_Scripts [ iThreadIndex ].InstrStream.pLiterals = NULL;
+        }
+
+        // ---- Free the string table
+
+        if ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings )
+        {
+            // First free each string in the table individually
+
+            for ( int iCurrStringIndex = 0; iCurrStringIndex < g_Scripts [ iThreadIndex ].StringTable.iSize; ++ iCurrStringIndex )
+                if ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings [ iCurrStringIndex ] )
+                    free ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings [ iCurrStringIndex ] );
+
+            // Now free the table itself
+
+            free ( g_Scripts [ iThreadIndex ].StringTable.ppstrStrings );
+            g_Scripts [ iThreadIndex ].StringTable.ppstrStrings = NULL;
+        }
+        g_Scripts [ iThreadIndex ].StringTable.iSize = 0;
+
+        // ---- Free the runtime stack
+
+        if ( g_Scripts [ iThreadIndex ].Stack.pElmnts )
+        {
+            // Free any strings that are still on the stack
+
+            for ( int iCurrElmntIndex = 0; iCurrElmntIndex < g_Scripts [ iThreadIndex ].Stack.iSize; ++ iCurrElmntIndex )
+                if ( g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmntIndex ].iType == OP_TYPE_STRING )
+                    free ( g_Scripts [ iThreadIndex ].Stack.pElmnts [ iCurrElmntIndex ].pstrStringLiteral );
+
+            // Now free the stack itself
+
+            free ( g_Scripts [ iThreadIndex ].Stack.pElmnts );
+            g_Scripts [ iThreadIndex ].Stack.pElmnts = NULL;
+        }
+        g_Scripts [ iThreadIndex ].Stack.iSize = 0;
+
+        // ---- Free the function table
+
+        if ( g_Scripts [ iThreadIndex ].FuncTable.pFuncs )
+        {
+            free ( g_Scripts [ iThreadIndex ].FuncTable.pFuncs );
+            g_Scripts [ iThreadIndex ].FuncTable.pFuncs = NULL;
+        }
+        g_Scripts [ iThreadIndex ].FuncTable.iSize = 0;
+
+        // ---- Free the host API call table
+
+        if ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls )
+        {
+            // First free each string in the table individually
+
+            for ( int iCurrCallIndex = 0; iCurrCallIndex < g_Scripts [ iThreadIndex ].HostAPICallTable.iSize; ++ iCurrCallIndex )
+                if ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls [ iCurrCallIndex ] )
+                    free ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls [ iCurrCallIndex ] );
+
+            // Now free the table itself
+
+            free ( g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls );
+            g_Scripts [ iThreadIndex ].HostAPICallTable.ppstrCalls = NULL;
+        }
+        g_Scripts [ iThreadIndex ].HostAPICallTable.iSize = 0;
+
+        // ---- Free the jump table table
+
+        if ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables )
+        {
+            // First free each table's entries
+
+            for ( int iCurrJumpTableIndex = 0; iCurrJumpTableIndex < g_Scripts [ iThreadIndex ].JumpTableTable.iSize; ++ iCurrJumpTableIndex )
+                if ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables [ iCurrJumpTableIndex ].piTargets )
+                    free ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables [ iCurrJumpTableIndex ].piTargets );
+
+            // Now free the table itself
+
+            free ( g_Scripts [ iThreadIndex ].JumpTableTable.pTables );
+            g_Scripts [ iThreadIndex ].JumpTableTable.pTables = NULL;
+        }
+        g_Scripts [ iThreadIndex ].JumpTableTable.iSize = 0;
+
+        // ---- Free the line table
+
+        if ( g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename )
+        {
+            free ( g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename );
+            g_Scripts [ iThreadIndex ].LineTable.pstrExecFilename = NULL;
+        }
+
+        if ( g_Scripts [ iThreadIndex ].LineTable.pstrSourceFilename )
+        {
+            free ( g_Scripts [ iThreadIndex ].LineTable.pstrSourceFilename );
+            g_Scripts [ iThreadIndex ].LineTable.pstrSourceFilename = NULL;
+        }
+
+        if ( g_Scripts [ iThreadIndex ].LineTable.pRuns )
+        {
+            free ( g_Scripts [ iThreadIndex ].LineTable.pRuns );
+            g_Scripts [ iThreadIndex ].LineTable.pRuns = NULL;
+        }
+        g_Scripts [ iThreadIndex ].LineTable.iSize = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   AbortScriptLoad ()
+    *
+    *   Frees everything a failed call to XS_LoadScript () has allocated so far, closes the
+    *   script file and returns the specified error code.
+    */
+
+    int AbortScriptLoad ( int iThreadIndex, FILE * pScriptFile, int iErrorCode )
+    {
+        FreeScript ( iThreadIndex );
+        fclose ( pScriptFile );
+
+        return iErrorCode;
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadLineTable ()
+    *
+    *   Reads a script's line table from its executable the first time it's needed. The table
+    *   is only marked as loaded, and left empty, if the script doesn't have one or it can't
+    *   be read, so the file is never opened more than once.
+    */
+
+    void LoadLineTable ( int iThreadIndex )
+    {
+        LineTable * pLineTable = & g_Scripts [ iThreadIndex ].LineTable;
+
+        if ( pLineTable->iIsLoaded )
+            return;
+
+        pLineTable->iIsLoaded = TRUE;
+
+        if ( ! pLineTable->pstrExecFilename )
+            return;
+
+        // Reopen the executable and seek to the table
+
+        FILE * pScriptFile;
+        if ( ! ( pScriptFile = fopen ( pLineTable->pstrExecFilename, "rb" ) ) )
+            return;
+
+        fseek ( pScriptFile, 0, SEEK_END );
+        long lFileSize = ftell ( pScriptFile );
+        fseek ( pScriptFile, pLineTable->lOffset, SEEK_SET );
+
+        // Read the source filename, which has to fit in what's left of the file
+
+        int iSourceFilenameLength = ReadVarInt ( pScriptFile );
+
+        if ( iSourceFilenameLength < 0 || iSourceFilenameLength > lFileSize - ftell ( pScriptFile ) ||
+             ! ( pLineTable->pstrSourceFilename = ( char * ) malloc ( iSourceFilenameLength + 1 ) ) )
+        {
+            fclose ( pScriptFile );
+            return;
+        }
+
+        fread ( pLineTable->pstrSourceFilename, iSourceFilenameLength, 1, pScriptFile );
+        pLineTable->pstrSourceFilename [ iSourceFilenameLength ] = '\0';
+
+        // Read the run count. Every run takes at least two bytes.
+
+        int iRunCount = ReadVarInt ( pScriptFile );
+
+        if ( iRunCount <= 0 || iRunCount > ( lFileSize - ftell ( pScriptFile ) ) / 2 ||
+             ! ( pLineTable->pRuns = ( LineRun * ) malloc ( iRunCount * sizeof ( LineRun ) ) ) )
+        {
+            fclose ( pScriptFile );
+            return;
+        }
+
+        // Read each run, which is stored as the distance from the previous run's first
+        // instruction and the change in line
+
+        int iInstrIndex = 0,
+            iSourceLine = 0;
+
+        for ( int iCurrRun = 0; iCurrRun < iRunCount; ++ iCurrRun )
+        {
+            iInstrIndex += ReadVarInt ( pScriptFile );
+            iSourceLine += ReadSignedVarInt ( pScriptFile );
+
+            pLineTable->pRuns [ iCurrRun ].iInstrIndex = iInstrIndex;
+            pLineTable->pRuns [ iCurrRun ].iSourceLine = iSourceLine;
+        }
+
+        // Only keep the runs if the whole table was there
+
+        if ( ! feof ( pScriptFile ) )
+            pLineTable->iSize = iRunCount;
+
+        fclose ( pScriptFile );
+    }
+
+    /******************************************************************************************
+    *
+    *   ReadVarInt ()
+    *
+    *   Reads a variable-length integer: seven bits per byte, least significant bits first,
+    *   with the high bit of each byte set if another byte follows. Encodings longer than an
+    *   integer can hold are cut off; the verifier rejects whatever they decode to if it's out
+    *   of range.
+    */
+
+    int ReadVarInt ( FILE * pScriptFile )
+    {
+        unsigned int iValue = 0;
+
+        for ( int iCurrByteIndex = 0; iCurrByteIndex < MAX_VAR_INT_SIZE; ++ iCurrByteIndex )
+        {
+            int iByte = fgetc ( pScriptFile );
+            if ( iByte == EOF )
+                break;
+
+            iValue |= ( unsigned int ) ( iByte & 0x7F ) << ( iCurrByteIndex * 7 );
+
+            if ( ! ( iByte & 0x80 ) )
+                break;
+        }
+
+        return ( int ) iValue;
+    }
+
+    /******************************************************************************************
+    *
+    *   ReadSignedVarInt ()
+    *
+    *   Reads a signed variable-length integer, which stores its sign in the lowest bit
+    *   ( 0, 1, 2, 3, 4... decodes to 0, -1, 1, -2, 2... ).
+    */
+
+    int ReadSignedVarInt ( FILE * pScriptFile )
+    {
+        unsigned int iValue = ( unsigned int ) ReadVarInt ( pScriptFile );
+        return ( int ) ( iValue >> 1 ) ^ - ( int ) ( iValue & 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   ReadXSEInt ()
+    *
+    *   Reads a header, table or operand field, either as a variable-length integer or, in the
+    *   older format, as the specified number of bytes.
+    */
+
+    int ReadXSEInt ( FILE * pScriptFile, int iIsCompact, int iLegacySize )
+    {
+        if ( iIsCompact )
+            return ReadVarInt ( pScriptFile );
+
+        int iValue = 0;
+        fread ( & iValue, iLegacySize, 1, pScriptFile );
+        return iValue;
+    }
+
+    /******************************************************************************************
+    *
+    *   ReadXSESignedInt ()
+    *
+    *   Reads a signed operand field, either as a signed variable-length integer or, in the
+    *   older format, as four bytes.
+    */
+
+    int ReadXSESignedInt ( FILE * pScriptFile, int iIsCompact )
+    {
+        if ( iIsCompact )
+            return ReadSignedVarInt ( pScriptFile );
+
+        int iValue = 0;
+        fread ( & iValue, sizeof ( int ), 1, pScriptFile );
+        return iValue;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetOpShapeBitCount ()
+    *
+    *   Returns the number of bits the compact format uses to store the type of an operand
+    *   that accepts the specified types. Operands that only accept one type need none.
+    */
+
+    int GetOpShapeBitCount ( int iOpTypes )
+    {
+        // Count the types the operand accepts
+
+        int iTypeCount = 0;
+        for ( int iCurrOpType = 0; iCurrOpType < OP_TYPE_OPERAND_COUNT; ++ iCurrOpType )
+            if ( iOpTypes & g_OpTypeFlagTable [ iCurrOpType ] )
+                ++ iTypeCount;
+
+        // Find the smallest number of bits that can hold that many values
+
+        int iBitCount = 0;
+        while ( ( 1 << iBitCount ) < iTypeCount )
+            ++ iBitCount;
+
+        return iBitCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetShapeOpType ()
+    *
+    *   Returns the operand type at the specified position among the types an operand accepts,
+    *   or OP_TYPE_NULL if it accepts fewer types than that.
+    */
+
+    int GetShapeOpType ( int iOpTypes, int iShape )
+    {
+        for ( int iCurrOpType = 0; iCurrOpType < OP_TYPE_OPERAND_COUNT; ++ iCurrOpType )
+        {
+            if ( iOpTypes & g_OpTypeFlagTable [ iCurrOpType ] )
+            {
+                if ( iShape == 0 )
+                    return iCurrOpType;
+
+                -- iShape;
+            }
+        }
+
+        return OP_TYPE_NULL;
+    }
+
+    /******************************************************************************************
+    *
+    *   BuildLiterals ()
+    *
+    *   Builds the Value of every literal operand in a verified script, so the execution loop
+    *   can read literals as-is instead of rebuilding them from their operands each time.
+    *   Each operand's offset index is set to its value's index. Returns FALSE if the values
+    *   couldn't be allocated.
+    */
+
+    int BuildLiterals ( int iThreadIndex )
+    {
+        InstrStream * pInstrStream = & g_Scripts [ iThreadIndex ].InstrStream;
+
+        // Allocate enough values for every operand to be a literal, which is more than
+        // enough since stack indices and registers don't need one
+
+        if ( ! ( pInstrStream->pLiterals = ( Value * ) malloc ( ( pInstrStream->iOpCount + 1 ) * sizeof ( Value ) ) ) )
+            return FALSE;
+
+        int iLiteralCount = 0;
+
+        for ( int iCurrOpIndex = 0; iCurrOpIndex < pInstrStream->iOpCount; ++ iCurrOpIndex )
+        {
+            Op * pOp = & pInstrStream->pOps [ iCurrOpIndex ];
+            Value * pLiteral = & pInstrStream->pLiterals [ iLiteralCount ];
+
+            switch ( pOp->iType )
+            {
+                // Stack indices and registers aren't literals
+
+                case OP_TYPE_ABS_STACK_INDEX:
+                case OP_TYPE_REL_STACK_INDEX:
+                case OP_TYPE_REG:
+                    continue;
+
+                // String literals point into the string table
+
+                case OP_TYPE_STRING:
+                    pLiteral->pstrStringLiteral = g_Scripts [ iThreadIndex ].StringTable.ppstrStrings [ pOp->iStringIndex ];
+                    break;
+
+                // Everything else is copied over as-is
+
+                default:
+                    pLiteral->iIntLiteral = pOp->iIntLiteral;
+                    break;
+            }
+
+            pLiteral->iType = pOp->iType;
+            pLiteral->iOffsetIndex = 0;
+
+            pOp->iOffsetIndex = iLiteralCount ++;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   VerifyScript ()
+    *
+    *   Verifies a freshly loaded script, returning TRUE if it can be run without any runtime
+    *   checks and FALSE otherwise. Every instruction is checked against its signature in the
+    *   instruction signature table, and every jump target, function index, host API call
+    *   index, string index and stack index is checked against the table or stack frame it
+    *   references. Jumps must stay within their function, and each function must end with an
+    *   instruction that leaves it, since any other code would be run with the wrong stack
+    *   frame. Function stack frames are checked against the size of the stack. How deep
+    *   calls nest and how many values are pushed can't be known until runtime, so Push () and
+    *   CallFunc () check for room themselves.
+    *
+    *   Relative stack indices are checked by their base index and offset variable only, since
+    *   the offset itself isn't known until runtime.
+    */
+
+    int VerifyScript ( int iThreadIndex )
+    {
+        Script * pScript = & g_Scripts [ iThreadIndex ];
+
+        int iInstrStreamSize = pScript->InstrStream.iSize;
+        int iFuncTableSize = pScript->FuncTable.iSize;
+
+        // ---- Verify the header
+
+        // The globals must fit on the stack
+
+        if ( pScript->iGlobalDataSize < 0 || pScript->iGlobalDataSize > pScript->Stack.iSize )
+            return FALSE;
+
+        // If _Main () is present, its index must be in the function table
+
+        if ( pScript->iIsMainFuncPresent )
+            if ( pScript->iMainFuncIndex < 0 || pScript->iMainFuncIndex >= iFuncTableSize )
+                return FALSE;
+
+        // ---- Verify the jump table table
+
+        // Every entry of every table must be in the instruction stream
+
+        for ( int iCurrJumpTableIndex = 0; iCurrJumpTableIndex < pScript->JumpTableTable.iSize; ++ iCurrJumpTableIndex )
+        {
+            JumpTable * pJumpTable = & pScript->JumpTableTable.pTables [ iCurrJumpTableIndex ];
+
+            for ( int iCurrEntryIndex = 0; iCurrEntryIndex < pJumpTable->iSize; ++ iCurrEntryIndex )
+                if ( pJumpTable->piTargets [ iCurrEntryIndex ] < 0 || pJumpTable->piTargets [ iCurrEntryIndex ] >= iInstrStreamSize )
+                    return FALSE;
+        }
+
+        // ---- Verify the function table
+
+        // Allocate a list that maps each instruction to the index of the function that
+        // starts at it, or -1 if none does. This is used to find the stack frame that each
+        // instruction's stack indices are relative to.
+
+        int * piEntryFuncList;
+        if ( ! ( piEntryFuncList = ( int * ) malloc ( ( iInstrStreamSize + 1 ) * sizeof ( int ) ) ) )
+            return FALSE;
+
+        int iCurrInstrIndex;
+        for ( iCurrInstrIndex = 0; iCurrInstrIndex < iInstrStreamSize; ++ iCurrInstrIndex )
+            piEntryFuncList [ iCurrInstrIndex ] = -1;
+
+        // Verify each function
+
+        Func * pFunc;
+        int iCurrFuncIndex;
+        for ( iCurrFuncIndex = 0; iCurrFuncIndex < iFuncTableSize; ++ iCurrFuncIndex )
+        {
+            pFunc = & pScript->FuncTable.pFuncs [ iCurrFuncIndex ];
+
+            // The entry point must be in the instruction stream, and no two functions can
+            // share one
+
+            if ( pFunc->iEntryPoint < 0 || pFunc->iEntryPoint >= iInstrStreamSize ||
+                 piEntryFuncList [ pFunc->iEntryPoint ] != -1 )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            // The stack frame, along with the function index that sits on top of it, must
+            // fit on the stack above the globals
+
+            if ( pFunc->iLocalDataSize < 0 || pFunc->iLocalDataSize > pScript->Stack.iSize ||
+                 pFunc->iParamCount < 0 || pFunc->iParamCount > pScript->Stack.iSize ||
+                 pFunc->iStackFrameSize + 1 > pScript->Stack.iSize - pScript->iGlobalDataSize )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            piEntryFuncList [ pFunc->iEntryPoint ] = iCurrFuncIndex;
+        }
+
+        // Instructions belong to the function whose entry point most recently preceded them,
+        // so fill in the rest of the list to map every instruction to its function. The extra
+        // element at the end belongs to none, which marks the end of the last function.
+
+        iCurrFuncIndex = -1;
+
+        for ( iCurrInstrIndex = 0; iCurrInstrIndex < iInstrStreamSize; ++ iCurrInstrIndex )
+        {
+            if ( piEntryFuncList [ iCurrInstrIndex ] != -1 )
+                iCurrFuncIndex = piEntryFuncList [ iCurrInstrIndex ];
+            else
+                piEntryFuncList [ iCurrInstrIndex ] = iCurrFuncIndex;
+        }
+
+        piEntryFuncList [ iInstrStreamSize ] = -1;
+
+        // ---- Verify the instruction stream
+
+        for ( iCurrInstrIndex = 0; iCurrInstrIndex < iInstrStreamSize; ++ iCurrInstrIndex )
+        {
+            iCurrFuncIndex = piEntryFuncList [ iCurrInstrIndex ];
+            Instr * pInstr = & pScript->InstrStream.pInstrs [ iCurrInstrIndex ];
+
+            // Make sure the instruction belongs to a function and that its opcode exists
+
+            if ( iCurrFuncIndex == -1 || pInstr->iOpcode < 0 || pInstr->iOpcode >= INSTR_COUNT )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            pFunc = & pScript->FuncTable.pFuncs [ iCurrFuncIndex ];
+
+            // Make sure it has as many operands as its signature calls for
+
+            InstrSig * pSig = & g_InstrSigTable [ pInstr->iOpcode ];
+
+            if ( pInstr->iOpCount != pSig->iOpCount )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            // _Main () has no return address or function index on its stack frame, so it
+            // can't return
+
+            if ( pInstr->iOpcode == INSTR_RET && pScript->iIsMainFuncPresent &&
+                 pFunc == & pScript->FuncTable.pFuncs [ pScript->iMainFuncIndex ] )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            // Verify each operand
+
+            for ( int iCurrOpIndex = 0; iCurrOpIndex < pInstr->iOpCount; ++ iCurrOpIndex )
+            {
+                Op * pOp = & pInstr->pOpList [ iCurrOpIndex ];
+
+                if ( ! VerifyOp ( iThreadIndex, pFunc, pOp, pSig->OpList [ iCurrOpIndex ] ) )
+                {
+                    free ( piEntryFuncList );
+                    return FALSE;
+                }
+
+                // Jump targets, including every entry of a jump table, must be in the same
+                // function
+
+                int iIsJumpInFunc = TRUE;
+
+                if ( pOp->iType == OP_TYPE_INSTR_INDEX )
+                    iIsJumpInFunc = ( piEntryFuncList [ pOp->iInstrIndex ] == iCurrFuncIndex );
+
+                if ( pOp->iType == OP_TYPE_JUMP_TABLE_INDEX )
+                {
+                    JumpTable * pJumpTable = & pScript->JumpTableTable.pTables [ pOp->iJumpTableIndex ];
+
+                    for ( int iCurrEntryIndex = 0; iCurrEntryIndex < pJumpTable->iSize; ++ iCurrEntryIndex )
+                        if ( piEntryFuncList [ pJumpTable->piTargets [ iCurrEntryIndex ] ] != iCurrFuncIndex )
+                            iIsJumpInFunc = FALSE;
+                }
+
+                if ( ! iIsJumpInFunc )
+                {
+                    free ( piEntryFuncList );
+                    return FALSE;
+                }
+            }
+
+            // Vector intrinsics must stay within whatever their operands reference
+
+            if ( ! VerifyVectorInstr ( iThreadIndex, pFunc, pInstr ) )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+
+            // Execution can't be allowed to run off the end of a function, into the next one
+            // or off the end of the stream, so a function's last instruction must transfer
+            // control somewhere else
+
+            int iOpcode = pInstr->iOpcode;
+
+            if ( piEntryFuncList [ iCurrInstrIndex + 1 ] != iCurrFuncIndex &&
+                 iOpcode != INSTR_RET && iOpcode != INSTR_EXIT && iOpcode != INSTR_JMP && iOpcode != INSTR_JTAB )
+            {
+                free ( piEntryFuncList );
+                return FALSE;
+            }
+        }
+
+        free ( piEntryFuncList );
+
+        // The script checks out
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   VerifyStackIndex ()
+    *
+    *   Returns TRUE if the specified stack index references a global or a variable in the
+    *   specified function's stack frame, FALSE otherwise.
+    */
+
+    int VerifyStackIndex ( int iThreadIndex, Func * pFunc, int iStackIndex )
+    {
+        // Non-negative indices reference globals
+
+        if ( iStackIndex >= 0 )
+            return iStackIndex < g_Scripts [ iThreadIndex ].iGlobalDataSize;
+
+        // Negative indices are relative to the top of the stack frame. The function index sits
+        // at -1, the local data sits below it, then the return address, then the parameters.
+
+        int iLocalDataSize = pFunc->iLocalDataSize;
+
+        if ( iStackIndex <= -2 && iStackIndex >= -( iLocalDataSize + 1 ) )
+            return TRUE;
+
+        if ( iStackIndex <= -( iLocalDataSize + 3 ) && iStackIndex >= -( iLocalDataSize + 2 + pFunc->iParamCount ) )
+            return TRUE;
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   VerifyOp ()
+    *
+    *   Returns TRUE if the specified operand is one of the types in the iOpTypes bitfield and
+    *   whatever it references exists, FALSE otherwise.
+    */
+
+    int VerifyOp ( int iThreadIndex, Func * pFunc, Op * pOp, int iOpTypes )
+    {
+        Script * pScript = & g_Scripts [ iThreadIndex ];
+
+        switch ( pOp->iType )
+        {
+            // Literal values and registers only need the right type
+
+            case OP_TYPE_INT:
+                return ( iOpTypes & OP_FLAG_TYPE_INT ) != 0;
+
+            case OP_TYPE_FLOAT:
+                return ( iOpTypes & OP_FLAG_TYPE_FLOAT ) != 0;
+
+            case OP_TYPE_REG:
+                return ( iOpTypes & OP_FLAG_TYPE_REG ) != 0;
+
+            // String literals must reference the string table
+
+            case OP_TYPE_STRING:
+                return ( iOpTypes & OP_FLAG_TYPE_STRING ) &&
+                       pOp->iStringIndex >= 0 && pOp->iStringIndex < pScript->StringTable.iSize;
+
+            // Stack indices must reference a global or the current stack frame
+
+            case OP_TYPE_ABS_STACK_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_MEM_REF ) &&
+                       VerifyStackIndex ( iThreadIndex, pFunc, pOp->iStackIndex );
+
+            case OP_TYPE_REL_STACK_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_MEM_REF ) &&
+                       VerifyStackIndex ( iThreadIndex, pFunc, pOp->iStackIndex ) &&
+                       VerifyStackIndex ( iThreadIndex, pFunc, pOp->iOffsetIndex );
+
+            // Jump targets must be in the instruction stream
+
+            case OP_TYPE_INSTR_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_INSTR_INDEX ) &&
+                       pOp->iInstrIndex >= 0 && pOp->iInstrIndex < pScript->InstrStream.iSize;
+
+            // Function indices must be in the function table
+
+            case OP_TYPE_FUNC_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_FUNC_INDEX ) &&
+                       pOp->iFuncIndex >= 0 && pOp->iFuncIndex < pScript->FuncTable.iSize;
+
+            // Host API call indices must be in the host API call table
+
+            case OP_TYPE_HOST_API_CALL_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_HOST_API_CALL ) &&
+                       pOp->iHostAPICallIndex >= 0 && pOp->iHostAPICallIndex < pScript->HostAPICallTable.iSize;
+
+            // Jump table indices must be in the jump table table
+
+            case OP_TYPE_JUMP_TABLE_INDEX:
+                return ( iOpTypes & OP_FLAG_TYPE_JUMP_TABLE_INDEX ) &&
+                       pOp->iJumpTableIndex >= 0 && pOp->iJumpTableIndex < pScript->JumpTableTable.iSize;
+        }
+
+        // Anything else is invalid
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   VerifyVectorInstr ()
+    *
+    *   Returns TRUE if the specified instruction isn't a vector intrinsic, or if it is and
+    *   its element count is valid and each of its absolute stack indices starts a run of
+    *   that many elements within a global array or the function's stack frame. FALSE is
+    *   returned otherwise. Like single elements, runs at relative stack indices can only be
+    *   checked by their base index.
+    */
+
+    int VerifyVectorInstr ( int iThreadIndex, Func * pFunc, Instr * pInstr )
+    {
+        // Find the element count and the first operand that references a run of elements
+
+        int iCountOpIndex,
+            iFirstVectorOpIndex;
+
+        switch ( pInstr->iOpcode )
+        {
+            case INSTR_VADD:
+            case INSTR_VSUB:
+            case INSTR_VSCALE:
+                iCountOpIndex = 2;
+                iFirstVectorOpIndex = 0;
+                break;
+
+            case INSTR_VDOT:
+                iCountOpIndex = 3;
+                iFirstVectorOpIndex = 1;
+                break;
+
+            default:
+                return TRUE;
+        }
+
+        int iCount = pInstr->pOpList [ iCountOpIndex ].iIntLiteral;
+
+        if ( iCount < 1 || iCount > MAX_VECTOR_SIZE )
+            return FALSE;
+
+        // Check each element of each run. Only operands that accept nothing but memory
+        // references are runs, which leaves out VScale's scalar and VDot's destination.
+
+        for ( int iCurrOpIndex = iFirstVectorOpIndex; iCurrOpIndex < iCountOpIndex; ++ iCurrOpIndex )
+        {
+            Op * pOp = & pInstr->pOpList [ iCurrOpIndex ];
+
+            if ( g_InstrSigTable [ pInstr->iOpcode ].OpList [ iCurrOpIndex ] != OP_FLAG_TYPE_MEM_REF ||
+                 pOp->iType != OP_TYPE_ABS_STACK_INDEX )
+                continue;
+
+            // Global and local arrays alike occupy ascending stack indices, so a run can't
+            // cross the end of the globals or the gaps around the frame's return address
+            // and function index without one of its elements failing the check
+
+            for ( int iCurrElmntIndex = 1; iCurrElmntIndex < iCount; ++ iCurrElmntIndex )
+                if ( ! VerifyStackIndex ( iThreadIndex, pFunc, pOp->iStackIndex + iCurrElmntIndex ) )
+                    return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   CopyValue ()
+    *
+    *   Copies a value structure to another, taking strings into account.
+    */
+
+    void CopyValue ( Value * pDest, Value Source )
+    {
+        // If the destination already contains a string, make sure to free it first
+
+        if ( pDest->iType == OP_TYPE_STRING )
+            free ( pDest->pstrStringLiteral );
+
+        // Copy the object
+
+        * pDest = Source;
+
+        // Make a physical copy of the source string, if necessary
+
+        if ( Source.iType == OP_TYPE_STRING )
+        {
+            pDest->pstrStringLiteral = ( char * ) malloc ( strlen ( Source.pstrStringLiteral ) + 1 );
+            strcpy ( pDest->pstrStringLiteral, Source.pstrStringLiteral );
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   CoereceValueToInt ()
+    *
+    *   Coerces a Value structure from it's current type to an integer value.
+    */
+
+    int CoerceValueToInt ( Value Val )
+    {
+        // Determine which type the Value currently is
+
+        switch ( Val.iType )
+        {
+            // It's an integer, so return it as-is
+
+            case OP_TYPE_INT:
+                return Val.iIntLiteral;
+
+            // It's a float, so cast it to an integer
+
+            case OP_TYPE_FLOAT:
+                return ( int ) Val.fFloatLiteral;
+
+            // It's a string, so convert it to an integer
+
+            case OP_TYPE_STRING:
+                return atoi ( Val.pstrStringLiteral );
+
+            // Anything else is invalid
+
+            default:
+                return 0;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   CoereceValueToFloat ()
+    *
+    *   Coerces a Value structure from it's current type to an float value.
+    */
+
+    float CoerceValueToFloat ( Value Val )
+    {
+        // Determine which type the Value currently is
+
+        switch ( Val.iType )
+        {
+            // It's an integer, so cast it to a float
+
+            case OP_TYPE_INT:
+                return ( float ) Val.iIntLiteral;
+
+            // It's a float, so return it as-is
+
+            case OP_TYPE_FLOAT:
+                return Val.fFloatLiteral;
+
+            // It's a string, so convert it to an float
+
+            case OP_TYPE_STRING:
+                return ( float ) atof ( Val.pstrStringLiteral );
+
+            // Anything else is invalid
+
+            default:
+                return 0;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   CoereceValueToString ()
+    *
+    *   Coerces a Value structure from it's current type to a string value.
+    */
+
+    char * CoerceValueToString ( Value Val )
+    {
+
+        char * pstrCoercion;
+        if ( Val.iType != OP_TYPE_STRING )
+            pstrCoercion = ( char * ) malloc ( MAX_COERCION_STRING_SIZE + 1 );
+            
+        // Determine which type the Value currently is
+
+        switch ( Val.iType )
+        {
+            // It's an integer, so convert it to a string
+
+			case OP_TYPE_INT:
+				sprintf ( pstrCoercion, "%d", Val.iIntLiteral );
+                return pstrCoercion;
+
+			// It's a float, so use sprintf () to convert it since there's no built-in function
+			// for converting floats to strings
+
+			case OP_TYPE_FLOAT:
+				 sprintf ( pstrCoercion, "%f", Val.fFloatLiteral );
+                 return pstrCoercion;
+
+            // It's a string, so return it as-is
+
+            case OP_TYPE_STRING:
+                return Val.pstrStringLiteral;
+
+            // Anything else is invalid
+
+            default:
+                return NULL;
+        }
+    }
+
+    /******************************************************************************************
+	*
+	*	GetOpType ()
+	*
+	*	Returns the type of the specified operand in the current instruction.
+	*/
+
+	inline int GetOpType ( int iOpIndex )
+	{
+		// Get the current instruction
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+
+		// Return the type
+
+		return g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iType;
+	}
+
+    /******************************************************************************************
+    *
+    *   ResolveOpStackIndex ()
+    *
+    *   Resolves an operand's stack index, whether it's absolute or relative.
+    */
+
+    inline int ResolveOpStackIndex ( int iOpIndex )
+    {
+		// Get the current instruction
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+
+		// Get the operand type type
+
+		Op OpValue = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ];
+
+        // Resolve the stack index based on its type
+
+        switch ( OpValue.iType )
+        {
+            // It's an absolute index so return it as-is
+
+            case OP_TYPE_ABS_STACK_INDEX:
+                return OpValue.iStackIndex;
+
+            // It's a relative index so resolve it
+
+            case OP_TYPE_REL_STACK_INDEX:
+            {
+                // First get the base index
+
+		        int iBaseIndex = OpValue.iStackIndex;
+
+		        // Now get the index of the variable
+
+		        int iOffsetIndex = OpValue.iOffsetIndex;
+
+				// Get the variable's value
+
+				Value StackValue = GetStackValue ( g_iCurrThread, iOffsetIndex );
+
+		        // Now add the variable's integer field to the base index to produce the
+		        // absolute index
+
+		        return iBaseIndex + StackValue.iIntLiteral;
+            }
+
+            // Return zero for everything else, but we shouldn't encounter this case
+
+            default:
+                return 0;
+        }
+    }
+
+	/******************************************************************************************
+	*
+	*	ResolveOpValue ()
+	*
+	*	Resolves an operand and returns it's associated Value structure.
+	*/
+
+	inline Value ResolveOpValue ( int iOpIndex )
+	{
+		// Get the current instruction
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+
+		// Get the operand
+
+		Op * pOp = & g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ];
+
+		// Determine what to return based on the value's type
+
+		switch ( pOp->iType )
+		{
+			// It's a stack index so resolve it
+
+			case OP_TYPE_ABS_STACK_INDEX:
+			case OP_TYPE_REL_STACK_INDEX:
+			{
+                // Resolve the index and use it to return the corresponding stack element
+
+                int iAbsIndex = ResolveOpStackIndex ( iOpIndex );
+                return GetStackValue ( g_iCurrThread, iAbsIndex );
+			}
+
+			// It's in _RetVal
+
+			case OP_TYPE_REG:
+				return g_Scripts [ g_iCurrThread ]._RetVal;
+
+			// Anything else is a literal, so return the value built for it when the script
+			// was loaded
+
+			default:
+				return g_Scripts [ g_iCurrThread ].InstrStream.pLiterals [ pOp->iOffsetIndex ];
+		}
+	}
+
+	/******************************************************************************************
+	*
+	*	ResolveOpType ()
+	*
+	*	Resolves the type of the specified operand in the current instruction and returns the
+	*	resolved type.
+	*/
+
+	inline int ResolveOpType ( int iOpIndex )
+	{
+		// Resolve the operand's value
+
+		Value OpValue = ResolveOpValue ( iOpIndex );
+
+		// Return the value type
+
+		return OpValue.iType;
+	}
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsInt ()
+	*
+	*	Resolves and coerces an operand's value to an integer value.
+	*/
+
+	inline int ResolveOpAsInt ( int iOpIndex )
+	{
+		// Resolve the operand's value
+
+		Value OpValue = ResolveOpValue ( iOpIndex );
+
+        // Coerce it to an int and return it
+
+        int iInt = CoerceValueToInt ( OpValue );
+        return iInt;
+	}
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsFloat ()
+	*
+	*	Resolves and coerces an operand's value to a floating-point value.
+	*/
+
+	inline float ResolveOpAsFloat ( int iOpIndex )
+	{
+		// Resolve the operand's value
+
+		Value OpValue = ResolveOpValue ( iOpIndex );
+
+        // Coerce it to a float and return it
+
+        float fFloat = CoerceValueToFloat ( OpValue );
+        return fFloat;
+	}
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsString ()
+	*
+	*	Resolves and coerces an operand's value to a string value, allocating the space for a
+    *   new string if necessary.
+	*/
+
+	inline char * ResolveOpAsString ( int iOpIndex )
+	{
+		// Resolve the operand's value
+
+		Value OpValue = ResolveOpValue ( iOpIndex );
+
+        // Coerce it to a string and return it
+
+        char * pstrString = CoerceValueToString ( OpValue );
+        return pstrString;
+	}
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsInstrIndex ()
+	*
+	*	Resolves an operand as an intruction index.
+	*/
+
+	inline int ResolveOpAsInstrIndex ( int iOpIndex )
+	{
+		// The verifier only allows instruction indices to appear as literal operands, so the
+		// index can be read straight from the operand
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+		return g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iInstrIndex;
+    }
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsJumpTable ()
+	*
+	*	Resolves an operand as a jump table.
+	*/
+
+	inline JumpTable * ResolveOpAsJumpTable ( int iOpIndex )
+	{
+		// Like instruction indices, jump table indices only appear as literal operands
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+		int iJumpTableIndex = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iJumpTableIndex;
+		return & g_Scripts [ g_iCurrThread ].JumpTableTable.pTables [ iJumpTableIndex ];
+    }
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsFuncIndex ()
+	*
+	*	Resolves an operand as a function index.
+	*/
+
+	inline int ResolveOpAsFuncIndex ( int iOpIndex )
+	{
+		// The verifier only allows function indices to appear as literal operands, so the
+		// index can be read straight from the operand
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+		return g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iFuncIndex;
+    }
+
+	/******************************************************************************************
+	*
+	*	ResolveOpAsHostAPICall ()
+	*
+	*	Resolves an operand as a host API call
+	*/
+
+	inline char * ResolveOpAsHostAPICall ( int iOpIndex )
+	{
+		// The verifier only allows host API call indices to appear as literal operands, so
+		// the index can be read straight from the operand
+
+		int iCurrInstr = g_Scripts [ g_iCurrThread ].InstrStream.iCurrInstr;
+        int iHostAPICallIndex = g_Scripts [ g_iCurrThread ].InstrStream.pInstrs [ iCurrInstr ].pOpList [ iOpIndex ].iHostAPICallIndex;
+
+        // Return the host API call
+
+        return GetHostAPICall ( iHostAPICallIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   ResolveOpPntr ()
+    *
+    *   Resolves an operand and returns a pointer to its Value structure.
+    */
+
+    inline Value * ResolveOpPntr ( int iOpIndex )
+    {
+        // Get the method of indirection
+
+        int iIndirMethod = GetOpType ( iOpIndex );
+
+        // Return a pointer to wherever the operand lies
+
+        switch ( iIndirMethod )
+        {
+            // It's on the stack
+
+            case OP_TYPE_ABS_STACK_INDEX:
+            case OP_TYPE_REL_STACK_INDEX:
+            {
+                int iStackIndex = ResolveOpStackIndex ( iOpIndex );
+                return & g_Scripts [ g_iCurrThread ].Stack.pElmnts [ ResolveStackIndex ( iStackIndex ) ];
+            }
+
+            // It's _RetVal
+
+            case OP_TYPE_REG:
+                return & g_Scripts [ g_iCurrThread ]._RetVal;
+        }
+
+        // Return NULL for anything else
+
+        return NULL;
+    }
+
+	/******************************************************************************************
+	*
+	*	GetStackValue ()
+	*
+	*	Returns the specified stack value.
+	*/
+
+	inline Value GetStackValue ( int iThreadIndex, int iIndex )
+	{
+		// Use ResolveStackIndex () to return the element at the specified index
+
+		return g_Scripts [ iThreadIndex ].Stack.pElmnts [ ResolveStackIndex ( iIndex ) ];
+	}
+
+	/******************************************************************************************
+	*
+	*	SetStackValue ()
+	*
+	*	Sets the specified stack value.
+	*/
+
+	inline void SetStackValue ( int iThreadIndex, int iIndex, Value Val )
+	{
+		// Use ResolveStackIndex () to set the element at the specified index
+
+		g_Scripts [ iThreadIndex ].Stack.pElmnts [ ResolveStackIndex ( iIndex ) ] = Val;
+	}
+
+    /******************************************************************************************
+    *
+    *   CheckStackSpace ()
+    *
+    *   Returns TRUE if the specified number of elements can be pushed onto the thread's stack.
+    *   Otherwise the thread has overflowed its stack, so it's stopped and FALSE is returned.
+    */
+
+    inline int CheckStackSpace ( int iThreadIndex, int iSize )
+    {
+        if ( g_Scripts [ iThreadIndex ].Stack.iTopIndex + iSize <= g_Scripts [ iThreadIndex ].Stack.iSize )
+            return TRUE;
+
+        g_Scripts [ iThreadIndex ].iIsRunning = FALSE;
+        return FALSE;
+    }
+
+	/******************************************************************************************
+	*
+	*	Push ()
+	*
+	*	Pushes an element onto the stack, unless it's full.
+	*/
+
+	inline void Push ( int iThreadIndex, Value Val )
+	{
+        // Make sure there's room for the element
+
+        if ( ! CheckStackSpace ( iThreadIndex, 1 ) )
+            return;
+
+		// Get the current top element
+
+		int iTopIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+
+		// Put the value into the current top index
+
+		CopyValue ( & g_Scripts [ iThreadIndex ].Stack.pElmnts [ iTopIndex ], Val );
+
+		// Increment the top index
+
+		++ g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+	}
+
+	/******************************************************************************************
+	*
+	*	Pop ()
+	*
+	*	Pops the element off the top of the stack.
+	*/
+
+	inline Value Pop ( int iThreadIndex )
+	{
+		// Decrement the top index to clear the old element for overwriting
+
+		-- g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+
+		// Get the current top element
+
+		int iTopIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+
+		// Use this index to read the top element. Val is given a type first so CopyValue ()
+		// doesn't try to free whatever it held.
+
+        Value Val;
+        Val.iType = OP_TYPE_NULL;
+    	CopyValue ( & Val, g_Scripts [ iThreadIndex ].Stack.pElmnts [ iTopIndex ] );
+
+		// Return the value to the caller
+
+		return Val;
+	}
+
+	/******************************************************************************************
+	*
+	*	PushFrame ()
+	*
+	*	Pushes a stack frame.
+	*/
+
+	inline void PushFrame ( int iThreadIndex, int iSize )
+	{
+		// Increment the top index by the size of the frame
+
+		g_Scripts [ iThreadIndex ].Stack.iTopIndex += iSize;
+
+        // Move the frame index to the new top of the stack
+
+        g_Scripts [ iThreadIndex ].Stack.iFrameIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+	}
+
+	/******************************************************************************************
+	*
+	*	PopFrame ()
+	*
+	*	Pops a stack frame.
+	*/
+
+	inline void PopFrame ( int iSize )
+	{
+		// Decrement the top index by the size of the frame
+
+		g_Scripts [ g_iCurrThread ].Stack.iTopIndex -= iSize;
+
+        // Move the frame index to the new top of the stack
+	}
+
+	/******************************************************************************************
+	*
+	*	GetFunc ()
+	*
+	*	Returns the function corresponding to the specified index.
+	*/
+
+	inline Func GetFunc ( int iThreadIndex, int iIndex )
+	{
+		return g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iIndex ];
+	}
+
+	/******************************************************************************************
+	*
+	*	GetHostAPICall ()
+	*
+	*	Returns the host API call corresponding to the specified index.
+	*/
+
+	inline char * GetHostAPICall ( int iIndex )
+	{
+		return g_Scripts [ g_iCurrThread ].HostAPICallTable.ppstrCalls [ iIndex ];
+	}
+
+    /******************************************************************************************
+    *
+    *   GetHostAPIFunc ()
+    *
+    *   Searches the host API for a function visible to the specified thread and returns a
+    *   pointer to it, or NULL if there isn't one.
+    */
+
+    HostAPIFuncPntr GetHostAPIFunc ( int iThreadIndex, char * pstrName )
+    {
+        for ( int iHostAPIFuncIndex = 0; iHostAPIFuncIndex < MAX_HOST_API_SIZE; ++ iHostAPIFuncIndex )
+        {
+            // Skip unused slots
+
+            if ( ! g_HostAPI [ iHostAPIFuncIndex ].iIsActive )
+                continue;
+
+            // If the name matches and the function is visible to the thread, it's a match
+
+            if ( stricmp ( pstrName, g_HostAPI [ iHostAPIFuncIndex ].pstrName ) == 0 )
+            {
+                int iFuncThreadIndex = g_HostAPI [ iHostAPIFuncIndex ].iThreadIndex;
+                if ( iFuncThreadIndex == iThreadIndex || iFuncThreadIndex == XS_GLOBAL_FUNC )
+                    return g_HostAPI [ iHostAPIFuncIndex ].fnFunc;
+            }
+        }
+
+        return NULL;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetCurrTime ()
+    *
+    *   Wrapper for the system-dependant method of determining the current time in
+    *   milliseconds.
+    */
+
+    inline int GetCurrTime ()
+    {
+        // This function is implemented with the WinAPI function GetTickCount () on Windows,
+        // and with the POSIX monotonic clock elsewhere.
+
+        #ifdef _WIN32
+            return GetTickCount ();
+        #else
+            struct timespec Time;
+            clock_gettime ( CLOCK_MONOTONIC, & Time );
+            return ( int ) ( Time.tv_sec * 1000 + Time.tv_nsec / 1000000 );
+        #endif
+    }
+
+    /******************************************************************************************
+    *
+    *   CallFunc ()
+    *
+    *   Calls a function based on its index, returning FALSE if its stack frame wouldn't fit
+    *   on the stack.
+    */
+
+    int CallFunc ( int iThreadIndex, int iIndex )
+    {
+        Func DestFunc = GetFunc ( iThreadIndex, iIndex );
+
+        // Make sure there's room for the return address and the stack frame
+
+        if ( ! CheckStackSpace ( iThreadIndex, DestFunc.iLocalDataSize + 2 ) )
+            return FALSE;
+
+        // Save the current stack frame index
+
+        int iFrameIndex = g_Scripts [ iThreadIndex ].Stack.iFrameIndex;
+
+        // Push the return address, which is the current instruction
+
+        Value ReturnAddr;
+        ReturnAddr.iType = OP_TYPE_INSTR_INDEX;
+        ReturnAddr.iInstrIndex = g_Scripts [ iThreadIndex ].InstrStream.iCurrInstr;
+        Push ( iThreadIndex, ReturnAddr );
+
+        // Push the stack frame + 1 (the extra space is for the function index
+        // we'll put on the stack after it
+
+        PushFrame ( iThreadIndex, DestFunc.iLocalDataSize + 1 );
+
+        // Write the function index and old stack frame to the top of the stack
+
+        Value FuncIndex;
+        FuncIndex.iType = OP_TYPE_FUNC_INDEX;
+        FuncIndex.iFuncIndex = iIndex;
+        FuncIndex.iOffsetIndex = iFrameIndex;
+        SetStackValue ( iThreadIndex, g_Scripts [ iThreadIndex ].Stack.iTopIndex - 1, FuncIndex );
+
+        // Let the caller make the jump to the entry point
+
+        g_Scripts [ iThreadIndex ].InstrStream.iCurrInstr = DestFunc.iEntryPoint;
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_PassIntParam ()
+    *
+    *   Passes an integer parameter from the host to a script function.
+    */
+
+    void XS_PassIntParam ( int iThreadIndex, int iInt )
+    {
+        // Create a Value structure to encapsulate the parameter
+
+        Value Param;
+        Param.iType = OP_TYPE_INT;
+        Param.iIntLiteral = iInt;
+
+        // Push the parameter onto the stack
+
+        Push ( iThreadIndex, Param );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_PassFloatParam ()
+    *
+    *   Passes a floating-point parameter from the host to a script function.
+    */
+
+    void XS_PassFloatParam ( int iThreadIndex, float fFloat )
+    {
+        // Create a Value structure to encapsulate the parameter
+
+        Value Param;
+        Param.iType = OP_TYPE_FLOAT;
+        Param.fFloatLiteral = fFloat;
+
+        // Push the parameter onto the stack
+
+        Push ( iThreadIndex, Param );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_PassStringParam ()
+    *
+    *   Passes a string parameter from the host to a script function.
+    */
+
+    void XS_PassStringParam ( int iThreadIndex, char * pstrString )
+    {
+        // Create a Value structure to encapsulate the parameter
+
+        Value Param;
+        Param.iType = OP_TYPE_STRING;
+        Param.pstrStringLiteral = ( char * ) malloc ( strlen ( pstrString ) + 1 );
+        strcpy ( Param.pstrStringLiteral, pstrString );
+
+        // Push the parameter onto the stack
+
+        Push ( iThreadIndex, Param );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetFuncIndexByName ()
+    *
+    *   Returns the index into the function table corresponding to the specified name.
+    */
+
+    int GetFuncIndexByName ( int iThreadIndex, char * pstrName )
+    {
+        // Loop through each function and look for a matching name
+
+        for ( int iFuncIndex = 0; iFuncIndex < g_Scripts [ iThreadIndex ].FuncTable.iSize; ++ iFuncIndex )
+        {
+            // If the names match, return the index
+
+            if ( stricmp ( pstrName, g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iFuncIndex ].pstrName ) == 0 )
+                return iFuncIndex;
+        }
+
+        // A match wasn't found, so return -1
+
+        return -1;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_CallScriptFunc ()
+    *
+    *   Calls a script function from the host application. If the function executes Exit, the
+    *   thread is stopped and the call returns at that point, whether or not other threads are
+    *   still running.
+    */
+    
+    void XS_CallScriptFunc ( int iThreadIndex, char * pstrName )
+    {
+        // Make sure the thread index is valid and active
+
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
+        
+        // ---- Calling the function
+
+        // Preserve the current state of the VM
+
+        int iPrevThreadMode = g_iCurrThreadMode;
+        int iPrevThread = g_iCurrThread;
+        int iPrevCoroutine = g_iCurrCoroutine;
+
+        // Set the threading mode for single-threaded execution
+
+        g_iCurrThreadMode = THREAD_MODE_SINGLE;
+
+        // Set the active thread to the one specified
+
+        g_iCurrThread = iThreadIndex;
+
+        // Get the function's index based on its name
+
+        int iFuncIndex = GetFuncIndexByName ( iThreadIndex, pstrName );
+
+        // Make sure the function name was valid
+
+        if ( iFuncIndex == -1 )
+            return;
+
+        // Call the function, unless the stack is too full to hold it
+
+        if ( ! CallFunc ( iThreadIndex, iFuncIndex ) )
+        {
+            g_iCurrThreadMode = iPrevThreadMode;
+            g_iCurrThread = iPrevThread;
+            return;
+        }
+
+        // Set the stack base
+
+        Value StackBase = GetStackValue ( g_iCurrThread, g_Scripts [ g_iCurrThread ].Stack.iTopIndex - 1 );
+        StackBase.iType = OP_TYPE_STACK_BASE_MARKER;
+        SetStackValue ( g_iCurrThread, g_Scripts [ g_iCurrThread ].Stack.iTopIndex - 1, StackBase );
+
+        // Allow the script code to execute uninterrupted until the function returns. It runs
+        // as part of the thread even if the host was called from a coroutine, so a yield can't
+        // suspend the coroutine from inside the call.
+
+        g_iCurrCoroutine = -1;
+        XS_RunScripts ( XS_INFINITE_TIMESLICE );
+
+        // ---- Handling the function return
+
+        // Restore the VM state
+
+        g_iCurrThreadMode = iPrevThreadMode;
+        g_iCurrThread = iPrevThread;
+        g_iCurrCoroutine = iPrevCoroutine;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_InvokeScriptFunc ()
+    *
+    *   Invokes a script function from the host application, meaning the call executes in sync
+    *   with the script.
+    */
+    
+    void XS_InvokeScriptFunc ( int iThreadIndex, char * pstrName )
+    {
+        // Make sure the thread index is valid and active
+
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return;
+        
+        // Get the function's index based on its name
+
+        int iFuncIndex = GetFuncIndexByName ( iThreadIndex, pstrName );
+
+        // Make sure the function name was valid
+
+        if ( iFuncIndex == -1 )
+            return;
+
+        // Call the function
+
+        CallFunc ( iThreadIndex, iFuncIndex );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_CreateCoroutine ()
+    *
+    *   Creates a suspended coroutine that will run the specified script function on its own
+    *   stack, and returns its handle. The function's parameters are taken from the ones passed
+    *   to the thread with XS_Pass*Param (). A stack size of zero uses the script's own stack
+    *   size. Coroutines do nothing until the host resumes them, so dormant ones cost only
+    *   their memory.
+    */
+
+    int XS_CreateCoroutine ( int iThreadIndex, char * pstrName, int iStackSize )
+    {
+        // Make sure the thread index is valid and active
+
+        if ( ! IsThreadActive ( iThreadIndex ) )
+            return XS_INVALID_COROUTINE;
+
+        Script * pScript = & g_Scripts [ iThreadIndex ];
+
+        // Get the function's index based on its name
+
+        int iFuncIndex = GetFuncIndexByName ( iThreadIndex, pstrName );
+
+        // Make sure the function name was valid
+
+        if ( iFuncIndex == -1 )
+            return XS_INVALID_COROUTINE;
+
+        Func * pFunc = & pScript->FuncTable.pFuncs [ iFuncIndex ];
+
+        // Use the script's stack size if none was specified
+
+        if ( iStackSize == 0 )
+            iStackSize = pScript->Stack.iSize;
+
+        // The bottom of the stack mirrors the script's globals, so make sure there's room for
+        // them and the function's stack frame (plus its function index) on top
+
+        int iGlobalDataSize = pScript->iGlobalDataSize;
+        if ( iStackSize < iGlobalDataSize + pFunc->iStackFrameSize + 1 )
+            return XS_INVALID_COROUTINE;
+
+        // Make sure the parameters have been passed
+
+        int iParamCount = pFunc->iParamCount;
+        if ( pScript->Stack.iTopIndex - iParamCount < iGlobalDataSize )
+            return XS_INVALID_COROUTINE;
+
+        // Get a free coroutine structure
+
+        int iCoroutine = GetFreeCoroutine ();
+        if ( iCoroutine == XS_INVALID_COROUTINE )
+            return XS_INVALID_COROUTINE;
+
+        Coroutine * pCoroutine = & g_pCoroutines [ iCoroutine ];
+
+        // Allocate the stack and set it to null
+
+        if ( ! ( pCoroutine->Stack.pElmnts = ( Value * ) malloc ( iStackSize * sizeof ( Value ) ) ) )
+        {
+            pCoroutine->iNextFree = g_iFreeCoroutine;
+            g_iFreeCoroutine = iCoroutine;
+            return XS_INVALID_COROUTINE;
+        }
+
+        for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iStackSize; ++ iCurrElmntIndex )
+            pCoroutine->Stack.pElmnts [ iCurrElmntIndex ].iType = OP_TYPE_NULL;
+
+        pCoroutine->Stack.iSize = iStackSize;
+        pCoroutine->Stack.iTopIndex = iGlobalDataSize;
+        pCoroutine->Stack.iFrameIndex = iGlobalDataSize;
+
+        // Move the parameters from the thread's stack to the coroutine's, nulling the old
+        // elements so their strings only have one owner
+
+        Value * pParams = & pScript->Stack.pElmnts [ pScript->Stack.iTopIndex - iParamCount ];
+        for ( int iCurrParamIndex = 0; iCurrParamIndex < iParamCount; ++ iCurrParamIndex )
+        {
+            pCoroutine->Stack.pElmnts [ pCoroutine->Stack.iTopIndex ++ ] = pParams [ iCurrParamIndex ];
+            pParams [ iCurrParamIndex ].iType = OP_TYPE_NULL;
+        }
+        pScript->Stack.iTopIndex -= iParamCount;
+
+        // Swap the coroutine's stack into the script long enough to call the function, which
+        // pushes its stack frame and sets the instruction pointer to its entry point
+
+        RuntimeStack ThreadStack = pScript->Stack;
+        int iThreadCurrInstr = pScript->InstrStream.iCurrInstr;
+
+        pScript->Stack = pCoroutine->Stack;
+        CallFunc ( iThreadIndex, iFuncIndex );
+
+        // Set the stack base, so the execution loop stops when the function returns
+
+        pScript->Stack.pElmnts [ pScript->Stack.iTopIndex - 1 ].iType = OP_TYPE_STACK_BASE_MARKER;
+
+        // Save the coroutine's state and restore the thread's
+
+        pCoroutine->Stack = pScript->Stack;
+        pCoroutine->iCurrInstr = pScript->InstrStream.iCurrInstr;
+
+        pScript->Stack = ThreadStack;
+        pScript->InstrStream.iCurrInstr = iThreadCurrInstr;
+
+        // Initialize the rest of the coroutine
+
+        pCoroutine->_RetVal.iType = OP_TYPE_NULL;
+        pCoroutine->_RetVal.iIntLiteral = 0;
+
+        pCoroutine->iThreadIndex = iThreadIndex;
+        pCoroutine->iState = XS_COROUTINE_SUSPENDED;
+        pCoroutine->iIsActive = TRUE;
+
+        return iCoroutine;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_ResumeCoroutine ()
+    *
+    *   Runs a suspended coroutine until it yields, returns or exits, and returns its new
+    *   state. The coroutine runs uninterrupted, like a call made with XS_CallScriptFunc (), and
+    *   shares its script's globals.
+    */
+
+    int XS_ResumeCoroutine ( int iCoroutine )
+    {
+        // Make sure the handle is valid
+
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return XS_COROUTINE_DEAD;
+
+        // Only suspended coroutines can be resumed, which also stops a coroutine from resuming
+        // itself
+
+        if ( g_pCoroutines [ iCoroutine ].iState != XS_COROUTINE_SUSPENDED )
+            return g_pCoroutines [ iCoroutine ].iState;
+
+        int iThreadIndex = g_pCoroutines [ iCoroutine ].iThreadIndex;
+        Script * pScript = & g_Scripts [ iThreadIndex ];
+
+        // Preserve the current state of the VM and the thread
+
+        int iPrevThreadMode = g_iCurrThreadMode;
+        int iPrevThread = g_iCurrThread;
+        int iPrevCoroutine = g_iCurrCoroutine;
+        int iPrevIsRunning = pScript->iIsRunning;
+        int iPrevIsPaused = pScript->iIsPaused;
+
+        // Swap the coroutine into its thread
+
+        SwapCoroutine ( iCoroutine );
+
+        // Run it on its own in single-threaded mode, whether or not the thread itself has
+        // been started
+
+        g_iCurrThreadMode = THREAD_MODE_SINGLE;
+        g_iCurrThread = iThreadIndex;
+        g_iCurrCoroutine = iCoroutine;
+
+        pScript->iIsRunning = TRUE;
+        pScript->iIsPaused = FALSE;
+
+        g_pCoroutines [ iCoroutine ].iState = XS_COROUTINE_RUNNING;
+
+        XS_RunScripts ( XS_INFINITE_TIMESLICE );
+
+        // Yielding suspends the coroutine, so if it's still running it must have returned or
+        // exited
+
+        if ( g_pCoroutines [ iCoroutine ].iState == XS_COROUTINE_RUNNING )
+            g_pCoroutines [ iCoroutine ].iState = XS_COROUTINE_DEAD;
+
+        // Swap the thread back in and restore the VM state
+
+        SwapCoroutine ( iCoroutine );
+
+        pScript->iIsRunning = iPrevIsRunning;
+        pScript->iIsPaused = iPrevIsPaused;
+
+        g_iCurrThreadMode = iPrevThreadMode;
+        g_iCurrThread = iPrevThread;
+        g_iCurrCoroutine = iPrevCoroutine;
+
+        // A dead coroutine won't run again, so free its stack now rather than when it's
+        // destroyed
+
+        if ( g_pCoroutines [ iCoroutine ].iState == XS_COROUTINE_DEAD )
+            FreeCoroutineStack ( & g_pCoroutines [ iCoroutine ] );
+
+        return g_pCoroutines [ iCoroutine ].iState;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCoroutineState ()
+    *
+    *   Returns the state of a coroutine. Invalid handles are reported as dead.
+    */
+
+    int XS_GetCoroutineState ( int iCoroutine )
+    {
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return XS_COROUTINE_DEAD;
+
+        return g_pCoroutines [ iCoroutine ].iState;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCurrCoroutine ()
+    *
+    *   Returns the handle of the running coroutine, or XS_INVALID_COROUTINE if none is
+    *   running. Host API functions can use this to tell which coroutine called them.
+    */
+
+    int XS_GetCurrCoroutine ()
+    {
+        return g_iCurrCoroutine;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCoroutineValueAsInt ()
+    *
+    *   Returns the value a coroutine last yielded or returned as an integer.
+    */
+
+    int XS_GetCoroutineValueAsInt ( int iCoroutine )
+    {
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return 0;
+
+        return CoerceValueToInt ( g_pCoroutines [ iCoroutine ]._RetVal );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCoroutineValueAsFloat ()
+    *
+    *   Returns the value a coroutine last yielded or returned as a float.
+    */
+
+    float XS_GetCoroutineValueAsFloat ( int iCoroutine )
+    {
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return 0;
+
+        return CoerceValueToFloat ( g_pCoroutines [ iCoroutine ]._RetVal );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCoroutineValueAsString ()
+    *
+    *   Returns the value a coroutine last yielded or returned, if it's a string, or NULL
+    *   otherwise. The string belongs to the coroutine, and is valid until it's resumed or
+    *   destroyed.
+    */
+
+    char * XS_GetCoroutineValueAsString ( int iCoroutine )
+    {
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return NULL;
+
+        if ( g_pCoroutines [ iCoroutine ]._RetVal.iType != OP_TYPE_STRING )
+            return NULL;
+
+        return g_pCoroutines [ iCoroutine ]._RetVal.pstrStringLiteral;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_DestroyCoroutine ()
+    *
+    *   Destroys a coroutine, whether or not it has finished, and frees its handle for reuse.
+    *   A running coroutine can't be destroyed.
+    */
+
+    void XS_DestroyCoroutine ( int iCoroutine )
+    {
+        // Make sure the handle is valid and the coroutine isn't running
+
+        if ( ! IsCoroutineActive ( iCoroutine ) )
+            return;
+
+        Coroutine * pCoroutine = & g_pCoroutines [ iCoroutine ];
+
+        if ( pCoroutine->iState == XS_COROUTINE_RUNNING )
+            return;
+
+        // Free the stack and the last yielded or returned string
+
+        FreeCoroutineStack ( pCoroutine );
+
+        if ( pCoroutine->_RetVal.iType == OP_TYPE_STRING )
+            free ( pCoroutine->_RetVal.pstrStringLiteral );
+
+        // Put the structure back on the free list
+
+        pCoroutine->iIsActive = FALSE;
+        pCoroutine->iNextFree = g_iFreeCoroutine;
+        g_iFreeCoroutine = iCoroutine;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetFreeCoroutine ()
+    *
+    *   Takes a structure off the coroutine pool's free list and returns its index, growing the
+    *   pool first if it's full. Returns XS_INVALID_COROUTINE if memory runs out.
+    */
+
+    int GetFreeCoroutine ()
+    {
+        // If the free list is empty, double the size of the pool
+
+        if ( g_iFreeCoroutine == -1 )
+        {
+            int iNewPoolSize = g_iCoroutinePoolSize ? g_iCoroutinePoolSize * 2 : MIN_COROUTINE_POOL_SIZE;
+
+            Coroutine * pNewPool = ( Coroutine * ) realloc ( g_pCoroutines, iNewPoolSize * sizeof ( Coroutine ) );
+            if ( ! pNewPool )
+                return XS_INVALID_COROUTINE;
+
+            // Chain the new structures together in order, so lower handles are used first
+
+            for ( int iCurrCoroutine = g_iCoroutinePoolSize; iCurrCoroutine < iNewPoolSize; ++ iCurrCoroutine )
+            {
+                pNewPool [ iCurrCoroutine ].iIsActive = FALSE;
+                pNewPool [ iCurrCoroutine ].iNextFree = iCurrCoroutine + 1 < iNewPoolSize ? iCurrCoroutine + 1 : -1;
+            }
+
+            g_iFreeCoroutine = g_iCoroutinePoolSize;
+            g_pCoroutines = pNewPool;
+            g_iCoroutinePoolSize = iNewPoolSize;
+        }
+
+        // Take the first free structure
+
+        int iCoroutine = g_iFreeCoroutine;
+        g_iFreeCoroutine = g_pCoroutines [ iCoroutine ].iNextFree;
+
+        return iCoroutine;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeCoroutineStack ()
+    *
+    *   Frees a coroutine's runtime stack, along with any strings still on it.
+    */
+
+    void FreeCoroutineStack ( Coroutine * pCoroutine )
+    {
+        if ( ! pCoroutine->Stack.pElmnts )
+            return;
+
+        for ( int iCurrElmntIndex = 0; iCurrElmntIndex < pCoroutine->Stack.iSize; ++ iCurrElmntIndex )
+            if ( pCoroutine->Stack.pElmnts [ iCurrElmntIndex ].iType == OP_TYPE_STRING )
+                free ( pCoroutine->Stack.pElmnts [ iCurrElmntIndex ].pstrStringLiteral );
+
+        free ( pCoroutine->Stack.pElmnts );
+        pCoroutine->Stack.pElmnts = NULL;
+        pCoroutine->Stack.iSize = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   SwapCoroutine ()
+    *
+    *   Exchanges a coroutine's stack, instruction pointer and _RetVal with the ones its
+    *   script is currently using, then moves the script's globals from the bottom of the
+    *   stack being swapped out to the bottom of the one being swapped in. The moved elements
+    *   are nulled, so each string only ever has one owner. Calling this a second time undoes
+    *   the first call.
+    */
+
+    void SwapCoroutine ( int iCoroutine )
+    {
+        Coroutine * pCoroutine = & g_pCoroutines [ iCoroutine ];
+        Script * pScript = & g_Scripts [ pCoroutine->iThreadIndex ];
+
+        // Exchange the execution state
+
+        RuntimeStack TempStack = pScript->Stack;
+        pScript->Stack = pCoroutine->Stack;
+        pCoroutine->Stack = TempStack;
+
+        int iTempCurrInstr = pScript->InstrStream.iCurrInstr;
+        pScript->InstrStream.iCurrInstr = pCoroutine->iCurrInstr;
+        pCoroutine->iCurrInstr = iTempCurrInstr;
+
+        Value TempRetVal = pScript->_RetVal;
+        pScript->_RetVal = pCoroutine->_RetVal;
+        pCoroutine->_RetVal = TempRetVal;
+
+        // Move the globals into the stack that's now in use
+
+        for ( int iCurrGlobalIndex = 0; iCurrGlobalIndex < pScript->iGlobalDataSize; ++ iCurrGlobalIndex )
+        {
+            pScript->Stack.pElmnts [ iCurrGlobalIndex ] = pCoroutine->Stack.pElmnts [ iCurrGlobalIndex ];
+            pCoroutine->Stack.pElmnts [ iCurrGlobalIndex ].iType = OP_TYPE_NULL;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_CreateBatch ()
+    *
+    *   Creates a batch of instances (lanes) of a script and returns its handle. Each lane has
+    *   its own globals and stack, which start out null, and every lane runs the same code.
+    *   A stack size of zero uses the script's own stack size.
+    */
+
+    int XS_CreateBatch ( int iThreadIndex, int iLaneCount, int iStackSize )
+    {
+        // Make sure the thread index is valid and active
+
+        if ( ! IsThreadActive ( iThreadIndex ) || iLaneCount < 1 )
+            return XS_INVALID_BATCH;
+
+        Script * pScript = & g_Scripts [ iThreadIndex ];
+
+        // Use the script's stack size if none was specified, and make sure the globals fit
+
+        if ( iStackSize == 0 )
+            iStackSize = pScript->Stack.iSize;
+
+        if ( iStackSize <= pScript->iGlobalDataSize )
+            return XS_INVALID_BATCH;
+
+        // Find a free batch structure
+
+        int iBatch = XS_INVALID_BATCH;
+        for ( int iCurrBatch = 0; iCurrBatch < MAX_BATCH_COUNT; ++ iCurrBatch )
+        {
+            if ( ! g_Batches [ iCurrBatch ].iIsActive )
+            {
+                iBatch = iCurrBatch;
+                break;
+            }
+        }
+
+        if ( iBatch == XS_INVALID_BATCH )
+            return XS_INVALID_BATCH;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+
+        // Allocate the rows, with an extra one for _RetVal, and the scratch space
+
+        int iElmntCount = ( iStackSize + 1 ) * iLaneCount;
+
+        pBatch->piTypes = ( int * ) malloc ( iElmntCount * sizeof ( int ) );
+        pBatch->pData = ( LaneData * ) malloc ( iElmntCount * sizeof ( LaneData ) );
+        pBatch->ppstrStrings = ( char ** ) malloc ( iElmntCount * sizeof ( char * ) );
+        pBatch->piOffsetIndices = ( int * ) malloc ( iElmntCount * sizeof ( int ) );
+        pBatch->pTemp0 = ( LaneData * ) malloc ( iLaneCount * sizeof ( LaneData ) );
+        pBatch->pTemp1 = ( LaneData * ) malloc ( iLaneCount * sizeof ( LaneData ) );
+        pBatch->piLaneInstrs = ( int * ) malloc ( iLaneCount * sizeof ( int ) );
+        pBatch->ScalarStack.pElmnts = ( Value * ) malloc ( iStackSize * sizeof ( Value ) );
+
+        pBatch->iLaneCount = iLaneCount;
+        pBatch->iStackSize = iStackSize;
+
+        if ( ! pBatch->piTypes || ! pBatch->pData || ! pBatch->ppstrStrings || ! pBatch->piOffsetIndices ||
+             ! pBatch->pTemp0 || ! pBatch->pTemp1 || ! pBatch->piLaneInstrs || ! pBatch->ScalarStack.pElmnts )
+        {
+            FreeBatch ( pBatch );
+            return XS_INVALID_BATCH;
+        }
+
+        // Set everything to null
+
+        for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iElmntCount; ++ iCurrElmntIndex )
+        {
+            pBatch->piTypes [ iCurrElmntIndex ] = OP_TYPE_NULL;
+            pBatch->pData [ iCurrElmntIndex ].iIntLiteral = 0;
+            pBatch->piOffsetIndices [ iCurrElmntIndex ] = 0;
+        }
+
+        for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iStackSize; ++ iCurrElmntIndex )
+            pBatch->ScalarStack.pElmnts [ iCurrElmntIndex ].iType = OP_TYPE_NULL;
+
+        pBatch->ScalarStack.iSize = iStackSize;
+
+        // Leave room for the globals, just like a freshly reset script
+
+        pBatch->iThreadIndex = iThreadIndex;
+        pBatch->iCurrInstr = 0;
+        pBatch->iTopIndex = pScript->iGlobalDataSize;
+        pBatch->iFrameIndex = pScript->iGlobalDataSize;
+        pBatch->iIsActive = TRUE;
+
+        return iBatch;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_DestroyBatch ()
+    *
+    *   Destroys a batch and frees its handle for reuse.
+    */
+
+    void XS_DestroyBatch ( int iBatch )
+    {
+        if ( ! IsBatchActive ( iBatch ) )
+            return;
+
+        FreeBatch ( & g_Batches [ iBatch ] );
+        g_Batches [ iBatch ].iIsActive = FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_PassBatchIntParams ()
+    *
+    *   Passes an integer parameter to a batch function, taking one value per lane from the
+    *   specified array.
+    */
+
+    void XS_PassBatchIntParams ( int iBatch, int * piInts )
+    {
+        if ( ! IsBatchActive ( iBatch ) )
+            return;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+
+        // Push a row of integers onto the lanes' stacks, if there's room
+
+        if ( pBatch->iTopIndex >= pBatch->iStackSize )
+            return;
+
+        int iRow = pBatch->iTopIndex ++;
+        SetLaneRowType ( pBatch, iRow, OP_TYPE_INT );
+
+        LaneData * pRow = & pBatch->pData [ iRow * pBatch->iLaneCount ];
+        for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+            pRow [ iCurrLane ].iIntLiteral = piInts [ iCurrLane ];
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_PassBatchFloatParams ()
+    *
+    *   Passes a floating-point parameter to a batch function, taking one value per lane from
+    *   the specified array.
+    */
+
+    void XS_PassBatchFloatParams ( int iBatch, float * pfFloats )
+    {
+        if ( ! IsBatchActive ( iBatch ) )
+            return;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+
+        // Push a row of floats onto the lanes' stacks, if there's room
+
+        if ( pBatch->iTopIndex >= pBatch->iStackSize )
+            return;
+
+        int iRow = pBatch->iTopIndex ++;
+        SetLaneRowType ( pBatch, iRow, OP_TYPE_FLOAT );
+
+        LaneData * pRow = & pBatch->pData [ iRow * pBatch->iLaneCount ];
+        for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+            pRow [ iCurrLane ].fFloatLiteral = pfFloats [ iCurrLane ];
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_CallBatchFunc ()
+    *
+    *   Calls a script function in every lane of a batch. The lanes share one instruction
+    *   pointer and run each instruction together, four at a time where SSE2 is available,
+    *   for as long as they all take the same path through the code. When a branch splits
+    *   them, or they reach an instruction that only runs one value at a time, each lane
+    *   finishes the call by itself like a call made with XS_CallScriptFunc ().
+    */
+
+    void XS_CallBatchFunc ( int iBatch, char * pstrName )
+    {
+        // Make sure the handle is valid
+
+        if ( ! IsBatchActive ( iBatch ) )
+            return;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+        Script * pScript = & g_Scripts [ pBatch->iThreadIndex ];
+
+        // Get the function's index based on its name
+
+        int iFuncIndex = GetFuncIndexByName ( pBatch->iThreadIndex, pstrName );
+
+        // Make sure the function name was valid
+
+        if ( iFuncIndex == -1 )
+            return;
+
+        Func * pFunc = & pScript->FuncTable.pFuncs [ iFuncIndex ];
+
+        // Make sure the parameters have been passed and the function's stack frame fits
+
+        int iBaseTopIndex = pBatch->iTopIndex - pFunc->iParamCount;
+        int iBaseFrameIndex = pBatch->iFrameIndex;
+
+        if ( iBaseTopIndex < pScript->iGlobalDataSize ||
+             pBatch->iTopIndex + pFunc->iLocalDataSize + 2 > pBatch->iStackSize )
+            return;
+
+        // Preserve the current state of the VM and set it up for single-threaded execution,
+        // which the lanes need if they end up running by themselves
+
+        int iPrevThreadMode = g_iCurrThreadMode;
+        int iPrevThread = g_iCurrThread;
+        int iPrevCoroutine = g_iCurrCoroutine;
+        int iPrevBatchLane = g_iCurrBatchLane;
+
+        g_iCurrThreadMode = THREAD_MODE_SINGLE;
+        g_iCurrThread = pBatch->iThreadIndex;
+        g_iCurrCoroutine = -1;
+        g_iCurrBatchLane = -1;
+
+        // Call the function in every lane, the same way CallFunc () does. The return address
+        // is never used, since the stack base marker ends the call first.
+
+        FillLaneRow ( pBatch, pBatch->iTopIndex ++, OP_TYPE_INSTR_INDEX, 0, 0 );
+
+        pBatch->iTopIndex += pFunc->iLocalDataSize + 1;
+        pBatch->iFrameIndex = pBatch->iTopIndex;
+
+        FillLaneRow ( pBatch, pBatch->iTopIndex - 1, OP_TYPE_STACK_BASE_MARKER, iFuncIndex, iBaseFrameIndex );
+
+        pBatch->iCurrInstr = pFunc->iEntryPoint;
+
+        // Run the lanes in lockstep until the function returns or they have to go their
+        // separate ways
+
+        while ( TRUE )
+        {
+            int iStatus = RunBatchInstr ( pBatch );
+
+            if ( iStatus == BATCH_INSTR_OK )
+                continue;
+
+            // Lanes that couldn't run the instruction together pick up at it by themselves
+
+            if ( iStatus == BATCH_INSTR_SCALAR )
+                for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+                    pBatch->piLaneInstrs [ iCurrLane ] = pBatch->iCurrInstr;
+
+            if ( iStatus != BATCH_INSTR_DONE )
+                RunBatchLanesAlone ( pBatch );
+
+            break;
+        }
+
+        // Every lane has returned or exited, so the stack is back to where it was before the
+        // parameters were passed
+
+        pBatch->iTopIndex = iBaseTopIndex;
+        pBatch->iFrameIndex = iBaseFrameIndex;
+
+        // Restore the VM state
+
+        g_iCurrThreadMode = iPrevThreadMode;
+        g_iCurrThread = iPrevThread;
+        g_iCurrCoroutine = iPrevCoroutine;
+        g_iCurrBatchLane = iPrevBatchLane;
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetBatchReturnValueAsInt ()
+    *
+    *   Returns the last returned value of a batch lane as an integer.
+    */
+
+    int XS_GetBatchReturnValueAsInt ( int iBatch, int iLane )
+    {
+        if ( ! IsBatchActive ( iBatch ) || iLane < 0 || iLane >= g_Batches [ iBatch ].iLaneCount )
+            return 0;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+        return CoerceValueToInt ( GetLaneValue ( pBatch, pBatch->iStackSize * pBatch->iLaneCount + iLane ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetBatchReturnValueAsFloat ()
+    *
+    *   Returns the last returned value of a batch lane as a float.
+    */
+
+    float XS_GetBatchReturnValueAsFloat ( int iBatch, int iLane )
+    {
+        if ( ! IsBatchActive ( iBatch ) || iLane < 0 || iLane >= g_Batches [ iBatch ].iLaneCount )
+            return 0;
+
+        Batch * pBatch = & g_Batches [ iBatch ];
+        return CoerceValueToFloat ( GetLaneValue ( pBatch, pBatch->iStackSize * pBatch->iLaneCount + iLane ) );
+    }
+
+    /******************************************************************************************
+    *
+    *   XS_GetCurrBatchLane ()
+    *
+    *   Returns the batch lane that's running by itself, or calling the host, or -1 if there
+    *   isn't one. Host API functions can use this to tell the instances of a batch apart.
+    */
+
+    int XS_GetCurrBatchLane ()
+    {
+        return g_iCurrBatchLane;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeBatch ()
+    *
+    *   Frees a batch's rows and scratch space, along with any strings they still hold.
+    */
+
+    void FreeBatch ( Batch * pBatch )
+    {
+        int iElmntCount = ( pBatch->iStackSize + 1 ) * pBatch->iLaneCount;
+
+        if ( pBatch->piTypes && pBatch->ppstrStrings )
+            for ( int iCurrElmntIndex = 0; iCurrElmntIndex < iElmntCount; ++ iCurrElmntIndex )
+                if ( pBatch->piTypes [ iCurrElmntIndex ] == OP_TYPE_STRING )
+                    free ( pBatch->ppstrStrings [ iCurrElmntIndex ] );
+
+        if ( pBatch->ScalarStack.pElmnts )
+            for ( int iCurrElmntIndex = 0; iCurrElmntIndex < pBatch->ScalarStack.iSize; ++ iCurrElmntIndex )
+                if ( pBatch->ScalarStack.pElmnts [ iCurrElmntIndex ].iType == OP_TYPE_STRING )
+                    free ( pBatch->ScalarStack.pElmnts [ iCurrElmntIndex ].pstrStringLiteral );
+
+        free ( pBatch->piTypes );
+        free ( pBatch->pData );
+        free ( pBatch->ppstrStrings );
+        free ( pBatch->piOffsetIndices );
+        free ( pBatch->pTemp0 );
+        free ( pBatch->pTemp1 );
+        free ( pBatch->piLaneInstrs );
+        free ( pBatch->ScalarStack.pElmnts );
+
+        pBatch->piTypes = NULL;
+        pBatch->pData = NULL;
+        pBatch->ppstrStrings = NULL;
+        pBatch->piOffsetIndices = NULL;
+        pBatch->pTemp0 = NULL;
+        pBatch->pTemp1 = NULL;
+        pBatch->piLaneInstrs = NULL;
+        pBatch->ScalarStack.pElmnts = NULL;
+        pBatch->ScalarStack.iSize = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaneValue ()
+    *
+    *   Gathers a batch element into a Value structure.
+    */
+
+    inline Value GetLaneValue ( Batch * pBatch, int iElmnt )
+    {
+        Value Val;
+        Val.iType = pBatch->piTypes [ iElmnt ];
+
+        if ( Val.iType == OP_TYPE_STRING )
+            Val.pstrStringLiteral = pBatch->ppstrStrings [ iElmnt ];
+        else
+            Val.iIntLiteral = pBatch->pData [ iElmnt ].iIntLiteral;
+
+        Val.iOffsetIndex = pBatch->piOffsetIndices [ iElmnt ];
+
+        return Val;
+    }
+
+    /******************************************************************************************
+    *
+    *   SetLaneValue ()
+    *
+    *   Scatters a Value structure into a batch element, without freeing what it held.
+    */
+
+    inline void SetLaneValue ( Batch * pBatch, int iElmnt, Value Val )
+    {
+        pBatch->piTypes [ iElmnt ] = Val.iType;
+
+        if ( Val.iType == OP_TYPE_STRING )
+            pBatch->ppstrStrings [ iElmnt ] = Val.pstrStringLiteral;
+        else
+            pBatch->pData [ iElmnt ].iIntLiteral = Val.iIntLiteral;
+
+        pBatch->piOffsetIndices [ iElmnt ] = Val.iOffsetIndex;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaneRowType ()
+    *
+    *   Returns the type every lane of a row holds, or LANE_TYPE_MIXED if they differ.
+    */
+
+    int GetLaneRowType ( Batch * pBatch, int iRow )
+    {
+        int * piTypes = & pBatch->piTypes [ iRow * pBatch->iLaneCount ];
+        int iType = piTypes [ 0 ];
+
+        for ( int iCurrLane = 1; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+            if ( piTypes [ iCurrLane ] != iType )
+                return LANE_TYPE_MIXED;
+
+        return iType;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeLaneRowStrings ()
+    *
+    *   Frees any strings held by the lanes of a row, leaving those lanes null.
+    */
+
+    void FreeLaneRowStrings ( Batch * pBatch, int iRow )
+    {
+        int iFirstElmnt = iRow * pBatch->iLaneCount;
+
+        for ( int iCurrElmnt = iFirstElmnt; iCurrElmnt < iFirstElmnt + pBatch->iLaneCount; ++ iCurrElmnt )
+        {
+            if ( pBatch->piTypes [ iCurrElmnt ] == OP_TYPE_STRING )
+            {
+                free ( pBatch->ppstrStrings [ iCurrElmnt ] );
+                pBatch->piTypes [ iCurrElmnt ] = OP_TYPE_NULL;
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   SetLaneRowType ()
+    *
+    *   Sets the type of every lane of a row, first freeing any strings they hold. Does nothing
+    *   to a row that already has the type.
+    */
+
+    void SetLaneRowType ( Batch * pBatch, int iRow, int iType )
+    {
+        if ( GetLaneRowType ( pBatch, iRow ) == iType )
+            return;
+
+        FreeLaneRowStrings ( pBatch, iRow );
+
+        int * piTypes = & pBatch->piTypes [ iRow * pBatch->iLaneCount ];
+        for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+            piTypes [ iCurrLane ] = iType;
+    }
+
+    /******************************************************************************************
+    *
+    *   FillLaneRow ()
+    *
+    *   Sets every lane of a row to the same non-string value.
+    */
+
+    void FillLaneRow ( Batch * pBatch, int iRow, int iType, int iValue, int iOffsetIndex )
+    {
+        SetLaneRowType ( pBatch, iRow, iType );
+
+        int iFirstElmnt = iRow * pBatch->iLaneCount;
+        for ( int iCurrElmnt = iFirstElmnt; iCurrElmnt < iFirstElmnt + pBatch->iLaneCount; ++ iCurrElmnt )
+        {
+            pBatch->pData [ iCurrElmnt ].iIntLiteral = iValue;
+            pBatch->piOffsetIndices [ iCurrElmnt ] = iOffsetIndex;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   ResolveLaneOp ()
+    *
+    *   Resolves an operand of the batch's current instruction to a row or a literal. Returns
+    *   FALSE if the operand is an array element whose index differs between lanes, since the
+    *   lanes can't share a row then.
+    */
+
+    int ResolveLaneOp ( Batch * pBatch, Op * pOp, LaneOp * pLaneOp )
+    {
+        switch ( pOp->iType )
+        {
+            // It's an absolute index, which is relative to the frame if it's negative
+
+            case OP_TYPE_ABS_STACK_INDEX:
+            {
+                int iStackIndex = pOp->iStackIndex;
+                if ( iStackIndex < 0 )
+                    iStackIndex += pBatch->iFrameIndex;
+
+                pLaneOp->iRow = iStackIndex;
+                return TRUE;
+            }
+
+            // It's a relative index, so every lane's index variable has to agree
+
+            case OP_TYPE_REL_STACK_INDEX:
+            {
+                int iOffsetIndex = pOp->iOffsetIndex;
+                if ( iOffsetIndex < 0 )
+                    iOffsetIndex += pBatch->iFrameIndex;
+
+                LaneData * pOffsets = & pBatch->pData [ iOffsetIndex * pBatch->iLaneCount ];
+                int iOffset = pOffsets [ 0 ].iIntLiteral;
+
+                for ( int iCurrLane = 1; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+                    if ( pOffsets [ iCurrLane ].iIntLiteral != iOffset )
+                        return FALSE;
+
+                int iStackIndex = pOp->iStackIndex + iOffset;
+                if ( iStackIndex < 0 )
+                    iStackIndex += pBatch->iFrameIndex;
+
+                pLaneOp->iRow = iStackIndex;
+                return TRUE;
+            }
+
+            // It's _RetVal, which follows the stack rows
+
+            case OP_TYPE_REG:
+                pLaneOp->iRow = pBatch->iStackSize;
+                return TRUE;
+
+            // It's a string literal
+
+            case OP_TYPE_STRING:
+                pLaneOp->iRow = -1;
+                pLaneOp->iType = OP_TYPE_STRING;
+                pLaneOp->pstrString = g_Scripts [ pBatch->iThreadIndex ].StringTable.ppstrStrings [ pOp->iStringIndex ];
+                return TRUE;
+
+            // Anything else is a literal that can be copied over as-is
+
+            default:
+                pLaneOp->iRow = -1;
+                pLaneOp->iType = pOp->iType;
+                pLaneOp->Literal.iIntLiteral = pOp->iIntLiteral;
+                return TRUE;
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaneOpType ()
+    *
+    *   Returns the type an operand has in every lane, or LANE_TYPE_MIXED if it differs.
+    */
+
+    inline int GetLaneOpType ( Batch * pBatch, LaneOp * pLaneOp )
+    {
+        if ( pLaneOp->iRow == -1 )
+            return pLaneOp->iType;
+
+        return GetLaneRowType ( pBatch, pLaneOp->iRow );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaneOpInts ()
+    *
+    *   Returns an operand's value in every lane as an integer, reading it as the specified
+    *   type. A row of integers is returned in place, while floats are converted and literals
+    *   broadcast into the scratch row.
+    */
+
+    int * GetLaneOpInts ( Batch * pBatch, LaneOp * pLaneOp, int iType, LaneData * pTemp )
+    {
+        int iLaneCount = pBatch->iLaneCount;
+        int * piTemp = ( int * ) pTemp;
+
+        if ( pLaneOp->iRow == -1 )
+        {
+            int iInt = iType == OP_TYPE_FLOAT ? ( int ) pLaneOp->Literal.fFloatLiteral : pLaneOp->Literal.iIntLiteral;
+
+            for ( int iCurrLane = 0; iCurrLane < iLaneCount; ++ iCurrLane )
+                piTemp [ iCurrLane ] = iInt;
+
+            return piTemp;
+        }
+
+        int * piRow = ( int * ) & pBatch->pData [ pLaneOp->iRow * iLaneCount ];
+
+        if ( iType != OP_TYPE_FLOAT )
+            return piRow;
+
+        float * pfRow = ( float * ) piRow;
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        for ( ; iCurrLane + 4 <= iLaneCount; iCurrLane += 4 )
+            _mm_storeu_si128 ( ( __m128i * ) & piTemp [ iCurrLane ], _mm_cvttps_epi32 ( _mm_loadu_ps ( & pfRow [ iCurrLane ] ) ) );
+
+        #endif
+
+        for ( ; iCurrLane < iLaneCount; ++ iCurrLane )
+            piTemp [ iCurrLane ] = ( int ) pfRow [ iCurrLane ];
+
+        return piTemp;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaneOpFloats ()
+    *
+    *   Returns an operand's value in every lane as a float, reading it as the specified type.
+    *   A row of floats is returned in place, while integers are converted and literals
+    *   broadcast into the scratch row.
+    */
+
+    float * GetLaneOpFloats ( Batch * pBatch, LaneOp * pLaneOp, int iType, LaneData * pTemp )
+    {
+        int iLaneCount = pBatch->iLaneCount;
+        float * pfTemp = ( float * ) pTemp;
+
+        if ( pLaneOp->iRow == -1 )
+        {
+            float fFloat = iType == OP_TYPE_INT ? ( float ) pLaneOp->Literal.iIntLiteral : pLaneOp->Literal.fFloatLiteral;
+
+            for ( int iCurrLane = 0; iCurrLane < iLaneCount; ++ iCurrLane )
+                pfTemp [ iCurrLane ] = fFloat;
+
+            return pfTemp;
+        }
+
+        float * pfRow = ( float * ) & pBatch->pData [ pLaneOp->iRow * iLaneCount ];
+
+        if ( iType != OP_TYPE_INT )
+            return pfRow;
+
+        int * piRow = ( int * ) pfRow;
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        for ( ; iCurrLane + 4 <= iLaneCount; iCurrLane += 4 )
+            _mm_storeu_ps ( & pfTemp [ iCurrLane ], _mm_cvtepi32_ps ( _mm_loadu_si128 ( ( __m128i * ) & piRow [ iCurrLane ] ) ) );
+
+        #endif
+
+        for ( ; iCurrLane < iLaneCount; ++ iCurrLane )
+            pfTemp [ iCurrLane ] = ( float ) piRow [ iCurrLane ];
+
+        return pfTemp;
+    }
+
+    /******************************************************************************************
+    *
+    *   MoveLanes ()
+    *
+    *   Copies an operand into a row in every lane, the way CopyValue () would.
+    */
+
+    void MoveLanes ( Batch * pBatch, int iDestRow, LaneOp * pSource )
+    {
+        // Skip cases where the two operands are the same
+
+        if ( pSource->iRow == iDestRow )
+            return;
+
+        int iLaneCount = pBatch->iLaneCount;
+        int iDest = iDestRow * iLaneCount;
+
+        // Free any strings the destination already holds
+
+        FreeLaneRowStrings ( pBatch, iDestRow );
+
+        // Broadcast a literal to every lane, giving each its own copy of a string
+
+        if ( pSource->iRow == -1 )
+        {
+            for ( int iCurrElmnt = iDest; iCurrElmnt < iDest + iLaneCount; ++ iCurrElmnt )
+            {
+                pBatch->piTypes [ iCurrElmnt ] = pSource->iType;
+                pBatch->pData [ iCurrElmnt ] = pSource->Literal;
+                pBatch->piOffsetIndices [ iCurrElmnt ] = 0;
+
+                if ( pSource->iType == OP_TYPE_STRING )
+                {
+                    pBatch->ppstrStrings [ iCurrElmnt ] = ( char * ) malloc ( strlen ( pSource->pstrString ) + 1 );
+                    strcpy ( pBatch->ppstrStrings [ iCurrElmnt ], pSource->pstrString );
+                }
+            }
+
+            return;
+        }
+
+        // Copy the source row, then make physical copies of any strings in it
+
+        int iSource = pSource->iRow * iLaneCount;
+
+        memcpy ( & pBatch->piTypes [ iDest ], & pBatch->piTypes [ iSource ], iLaneCount * sizeof ( int ) );
+        memcpy ( & pBatch->pData [ iDest ], & pBatch->pData [ iSource ], iLaneCount * sizeof ( LaneData ) );
+        memcpy ( & pBatch->piOffsetIndices [ iDest ], & pBatch->piOffsetIndices [ iSource ], iLaneCount * sizeof ( int ) );
+
+        for ( int iCurrLane = 0; iCurrLane < iLaneCount; ++ iCurrLane )
+        {
+            if ( pBatch->piTypes [ iSource + iCurrLane ] == OP_TYPE_STRING )
+            {
+                char * pstrString = pBatch->ppstrStrings [ iSource + iCurrLane ];
+                pBatch->ppstrStrings [ iDest + iCurrLane ] = ( char * ) malloc ( strlen ( pstrString ) + 1 );
+                strcpy ( pBatch->ppstrStrings [ iDest + iCurrLane ], pstrString );
+            }
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GetIntLaneResult ()
+    *
+    *   Performs an integer operation for a single lane. Neg and Abs only use the source.
+    */
+
+    inline int GetIntLaneResult ( int iOpcode, int iDest, int iSource )
+    {
+        switch ( iOpcode )
+        {
+            case INSTR_ADD:
+                return iDest + iSource;
+
+            case INSTR_SUB:
+                return iDest - iSource;
+
+            case INSTR_MUL:
+                return iDest * iSource;
+
+            case INSTR_DIV:
+                return iDest / iSource;
+
+            case INSTR_MOD:
+                return iDest % iSource;
+
+            case INSTR_AND:
+                return iDest & iSource;
+
+            case INSTR_OR:
+                return iDest | iSource;
+
+            case INSTR_XOR:
+                return iDest ^ iSource;
+
+            case INSTR_SHL:
+                return iDest << iSource;
+
+            case INSTR_SHR:
+                return iDest >> iSource;
+
+            case INSTR_MIN:
+                return iDest < iSource ? iDest : iSource;
+
+            case INSTR_MAX:
+                return iDest > iSource ? iDest : iSource;
+
+            case INSTR_NEG:
+                return -iSource;
+
+            case INSTR_NOT:
+                return ~ iSource;
+
+            case INSTR_ABS:
+                return iSource < 0 ? -iSource : iSource;
+        }
+
+        return iDest;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunIntLaneOp ()
+    *
+    *   Performs an integer operation across a row of lanes, combining each destination with
+    *   its source. Division, modulus and shifts have no SSE2 equivalent and run one lane at
+    *   a time.
+    */
+
+    void RunIntLaneOp ( int iOpcode, int * piDest, int * piSource, int iCount )
+    {
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        if ( iOpcode != INSTR_DIV && iOpcode != INSTR_MOD && iOpcode != INSTR_SHL && iOpcode != INSTR_SHR )
+        {
+            __m128i AllBits = _mm_set1_epi32 ( -1 );
+
+            for ( ; iCurrLane + 4 <= iCount; iCurrLane += 4 )
+            {
+                __m128i Dest = _mm_loadu_si128 ( ( __m128i * ) & piDest [ iCurrLane ] );
+                __m128i Source = _mm_loadu_si128 ( ( __m128i * ) & piSource [ iCurrLane ] );
+
+                switch ( iOpcode )
+                {
+                    case INSTR_ADD:
+                        Dest = _mm_add_epi32 ( Dest, Source );
+                        break;
+
+                    case INSTR_SUB:
+                        Dest = _mm_sub_epi32 ( Dest, Source );
+                        break;
+
+                    // SSE2 can only multiply the even elements, so the odd ones are shifted
+                    // down, multiplied separately and the low halves of the products are
+                    // interleaved back together
+
+                    case INSTR_MUL:
+                    {
+                        __m128i Even = _mm_mul_epu32 ( Dest, Source );
+                        __m128i Odd = _mm_mul_epu32 ( _mm_srli_epi64 ( Dest, 32 ), _mm_srli_epi64 ( Source, 32 ) );
+                        Dest = _mm_unpacklo_epi32 ( _mm_shuffle_epi32 ( Even, _MM_SHUFFLE ( 0, 0, 2, 0 ) ),
+                                                    _mm_shuffle_epi32 ( Odd, _MM_SHUFFLE ( 0, 0, 2, 0 ) ) );
+                        break;
+                    }
+
+                    case INSTR_AND:
+                        Dest = _mm_and_si128 ( Dest, Source );
+                        break;
+
+                    case INSTR_OR:
+                        Dest = _mm_or_si128 ( Dest, Source );
+                        break;
+
+                    case INSTR_XOR:
+                        Dest = _mm_xor_si128 ( Dest, Source );
+                        break;
+
+                    // Min and max pick between the two with a comparison mask
+
+                    case INSTR_MIN:
+                    {
+                        __m128i IsLess = _mm_cmplt_epi32 ( Dest, Source );
+                        Dest = _mm_or_si128 ( _mm_and_si128 ( IsLess, Dest ), _mm_andnot_si128 ( IsLess, Source ) );
+                        break;
+                    }
+
+                    case INSTR_MAX:
+                    {
+                        __m128i IsGreater = _mm_cmpgt_epi32 ( Dest, Source );
+                        Dest = _mm_or_si128 ( _mm_and_si128 ( IsGreater, Dest ), _mm_andnot_si128 ( IsGreater, Source ) );
+                        break;
+                    }
+
+                    case INSTR_NEG:
+                        Dest = _mm_sub_epi32 ( _mm_setzero_si128 (), Source );
+                        break;
+
+                    case INSTR_NOT:
+                        Dest = _mm_xor_si128 ( Source, AllBits );
+                        break;
+
+                    // The sign mask flips negative values and adds one back
+
+                    case INSTR_ABS:
+                    {
+                        __m128i Sign = _mm_srai_epi32 ( Source, 31 );
+                        Dest = _mm_sub_epi32 ( _mm_xor_si128 ( Source, Sign ), Sign );
+                        break;
+                    }
+                }
+
+                _mm_storeu_si128 ( ( __m128i * ) & piDest [ iCurrLane ], Dest );
+            }
+        }
+
+        #endif
+
+        // Finish the remaining lanes one at a time
+
+        for ( ; iCurrLane < iCount; ++ iCurrLane )
+            piDest [ iCurrLane ] = GetIntLaneResult ( iOpcode, piDest [ iCurrLane ], piSource [ iCurrLane ] );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetFloatLaneResult ()
+    *
+    *   Performs a floating-point operation for a single lane. Neg, Abs and Sqrt only use the
+    *   source.
+    */
+
+    inline float GetFloatLaneResult ( int iOpcode, float fDest, float fSource )
+    {
+        switch ( iOpcode )
+        {
+            case INSTR_ADD:
+                return fDest + fSource;
+
+            case INSTR_SUB:
+                return fDest - fSource;
+
+            case INSTR_MUL:
+                return fDest * fSource;
+
+            case INSTR_DIV:
+                return fDest / fSource;
+
+            case INSTR_MIN:
+                return fDest < fSource ? fDest : fSource;
+
+            case INSTR_MAX:
+                return fDest > fSource ? fDest : fSource;
+
+            case INSTR_NEG:
+                return -fSource;
+
+            case INSTR_ABS:
+                return ( float ) fabs ( fSource );
+
+            case INSTR_SQRT:
+                return ( float ) sqrt ( fSource );
+        }
+
+        return fDest;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunFloatLaneOp ()
+    *
+    *   Performs a floating-point operation across a row of lanes, combining each destination
+    *   with its source.
+    */
+
+    void RunFloatLaneOp ( int iOpcode, float * pfDest, float * pfSource, int iCount )
+    {
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        __m128 SignBit = _mm_castsi128_ps ( _mm_set1_epi32 ( ( int ) 0x80000000 ) );
+
+        for ( ; iCurrLane + 4 <= iCount; iCurrLane += 4 )
+        {
+            __m128 Dest = _mm_loadu_ps ( & pfDest [ iCurrLane ] );
+            __m128 Source = _mm_loadu_ps ( & pfSource [ iCurrLane ] );
+
+            switch ( iOpcode )
+            {
+                case INSTR_ADD:
+                    Dest = _mm_add_ps ( Dest, Source );
+                    break;
+
+                case INSTR_SUB:
+                    Dest = _mm_sub_ps ( Dest, Source );
+                    break;
+
+                case INSTR_MUL:
+                    Dest = _mm_mul_ps ( Dest, Source );
+                    break;
+
+                case INSTR_DIV:
+                    Dest = _mm_div_ps ( Dest, Source );
+                    break;
+
+                // These pick the destination only when the comparison holds, just like the
+                // scalar versions
+
+                case INSTR_MIN:
+                    Dest = _mm_min_ps ( Dest, Source );
+                    break;
+
+                case INSTR_MAX:
+                    Dest = _mm_max_ps ( Dest, Source );
+                    break;
+
+                case INSTR_NEG:
+                    Dest = _mm_xor_ps ( Source, SignBit );
+                    break;
+
+                case INSTR_ABS:
+                    Dest = _mm_andnot_ps ( SignBit, Source );
+                    break;
+
+                case INSTR_SQRT:
+                    Dest = _mm_sqrt_ps ( Source );
+                    break;
+            }
+
+            _mm_storeu_ps ( & pfDest [ iCurrLane ], Dest );
+        }
+
+        #endif
+
+        // Finish the remaining lanes one at a time
+
+        for ( ; iCurrLane < iCount; ++ iCurrLane )
+            pfDest [ iCurrLane ] = GetFloatLaneResult ( iOpcode, pfDest [ iCurrLane ], pfSource [ iCurrLane ] );
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareIntLanes ()
+    *
+    *   Performs an integer conditional jump's comparison across a row of lanes, setting each
+    *   lane's flag to whether it jumps. Returns the number of lanes that jump.
+    */
+
+    int CompareIntLanes ( int iOpcode, int * piOp0, int * piOp1, int * piJumps, int iCount )
+    {
+        int iJumpCount = 0;
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        // SSE2 only compares for equal, greater and less, so the others are inverted
+
+        static const int BitCounts [ 16 ] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+        __m128i AllBits = _mm_set1_epi32 ( -1 );
+
+        for ( ; iCurrLane + 4 <= iCount; iCurrLane += 4 )
+        {
+            __m128i Op0 = _mm_loadu_si128 ( ( __m128i * ) & piOp0 [ iCurrLane ] );
+            __m128i Op1 = _mm_loadu_si128 ( ( __m128i * ) & piOp1 [ iCurrLane ] );
+            __m128i Jumps;
+
+            switch ( iOpcode )
+            {
+                case INSTR_JE:
+                    Jumps = _mm_cmpeq_epi32 ( Op0, Op1 );
+                    break;
+
+                case INSTR_JNE:
+                    Jumps = _mm_xor_si128 ( _mm_cmpeq_epi32 ( Op0, Op1 ), AllBits );
+                    break;
+
+                case INSTR_JG:
+                    Jumps = _mm_cmpgt_epi32 ( Op0, Op1 );
+                    break;
+
+                case INSTR_JL:
+                    Jumps = _mm_cmplt_epi32 ( Op0, Op1 );
+                    break;
+
+                case INSTR_JGE:
+                    Jumps = _mm_xor_si128 ( _mm_cmplt_epi32 ( Op0, Op1 ), AllBits );
+                    break;
+
+                default:
+                    Jumps = _mm_xor_si128 ( _mm_cmpgt_epi32 ( Op0, Op1 ), AllBits );
+                    break;
+            }
+
+            _mm_storeu_si128 ( ( __m128i * ) & piJumps [ iCurrLane ], Jumps );
+            iJumpCount += BitCounts [ _mm_movemask_ps ( _mm_castsi128_ps ( Jumps ) ) ];
+        }
+
+        #endif
+
+        for ( ; iCurrLane < iCount; ++ iCurrLane )
+        {
+            int iOp0 = piOp0 [ iCurrLane ];
+            int iOp1 = piOp1 [ iCurrLane ];
+            int iJump;
+
+            switch ( iOpcode )
+            {
+                case INSTR_JE:
+                    iJump = iOp0 == iOp1;
+                    break;
+
+                case INSTR_JNE:
+                    iJump = iOp0 != iOp1;
+                    break;
+
+                case INSTR_JG:
+                    iJump = iOp0 > iOp1;
+                    break;
+
+                case INSTR_JL:
+                    iJump = iOp0 < iOp1;
+                    break;
+
+                case INSTR_JGE:
+                    iJump = iOp0 >= iOp1;
+                    break;
+
+                default:
+                    iJump = iOp0 <= iOp1;
+                    break;
+            }
+
+            piJumps [ iCurrLane ] = iJump;
+            iJumpCount += iJump;
+        }
+
+        return iJumpCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareFloatLanes ()
+    *
+    *   Performs a floating-point conditional jump's comparison across a row of lanes, setting
+    *   each lane's flag to whether it jumps. Returns the number of lanes that jump.
+    */
+
+    int CompareFloatLanes ( int iOpcode, float * pfOp0, float * pfOp1, int * piJumps, int iCount )
+    {
+        int iJumpCount = 0;
+        int iCurrLane = 0;
+
+        #ifdef XVM_SSE2
+
+        static const int BitCounts [ 16 ] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+        for ( ; iCurrLane + 4 <= iCount; iCurrLane += 4 )
+        {
+            __m128 Op0 = _mm_loadu_ps ( & pfOp0 [ iCurrLane ] );
+            __m128 Op1 = _mm_loadu_ps ( & pfOp1 [ iCurrLane ] );
+            __m128 Jumps;
+
+            switch ( iOpcode )
+            {
+                case INSTR_JE:
+                    Jumps = _mm_cmpeq_ps ( Op0, Op1 );
+                    break;
+
+                case INSTR_JNE:
+                    Jumps = _mm_cmpneq_ps ( Op0, Op1 );
+                    break;
+
+                case INSTR_JG:
+                    Jumps = _mm_cmpgt_ps ( Op0, Op1 );
+                    break;
+
+                case INSTR_JL:
+                    Jumps = _mm_cmplt_ps ( Op0, Op1 );
+                    break;
+
+                case INSTR_JGE:
+                    Jumps = _mm_cmpge_ps ( Op0, Op1 );
+                    break;
+
+                default:
+                    Jumps = _mm_cmple_ps ( Op0, Op1 );
+                    break;
+            }
+
+            _mm_storeu_si128 ( ( __m128i * ) & piJumps [ iCurrLane ], _mm_castps_si128 ( Jumps ) );
+            iJumpCount += BitCounts [ _mm_movemask_ps ( Jumps ) ];
+        }
+
+        #endif
+
+        for ( ; iCurrLane < iCount; ++ iCurrLane )
+        {
+            float fOp0 = pfOp0 [ iCurrLane ];
+            float fOp1 = pfOp1 [ iCurrLane ];
+            int iJump;
+
+            switch ( iOpcode )
+            {
+                case INSTR_JE:
+                    iJump = fOp0 == fOp1;
+                    break;
+
+                case INSTR_JNE:
+                    iJump = fOp0 != fOp1;
+                    break;
+
+                case INSTR_JG:
+                    iJump = fOp0 > fOp1;
+                    break;
+
+                case INSTR_JL:
+                    iJump = fOp0 < fOp1;
+                    break;
+
+                case INSTR_JGE:
+                    iJump = fOp0 >= fOp1;
+                    break;
+
+                default:
+                    iJump = fOp0 <= fOp1;
+                    break;
+            }
+
+            piJumps [ iCurrLane ] = iJump;
+            iJumpCount += iJump;
+        }
+
+        return iJumpCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBatchInstr ()
+    *
+    *   Executes the batch's current instruction in every lane at once. Returns
+    *   BATCH_INSTR_SCALAR without doing anything if the instruction can't be run in lockstep
+    *   (the operand types differ between lanes, or it's an instruction only the execution
+    *   loop implements), and BATCH_INSTR_SPLIT with each lane's next instruction in
+    *   piLaneInstrs if a branch went different ways.
+    */
+
+    int RunBatchInstr ( Batch * pBatch )
+    {
+        Script * pScript = & g_Scripts [ pBatch->iThreadIndex ];
+        Instr * pInstr = & pScript->InstrStream.pInstrs [ pBatch->iCurrInstr ];
+        int iOpcode = pInstr->iOpcode;
+        int iLaneCount = pBatch->iLaneCount;
+
+        // Resolve the first three operands, which is as many as any instruction run in
+        // lockstep has
+
+        LaneOp Ops [ 3 ];
+
+        for ( int iCurrOpIndex = 0; iCurrOpIndex < pInstr->iOpCount && iCurrOpIndex < 3; ++ iCurrOpIndex )
+            if ( ! ResolveLaneOp ( pBatch, & pInstr->pOpList [ iCurrOpIndex ], & Ops [ iCurrOpIndex ] ) )
+                return BATCH_INSTR_SCALAR;
+
+        // Move on to the next instruction unless this one jumps
+
+        int iNextInstr = pBatch->iCurrInstr + 1;
+
+        switch ( iOpcode )
+        {
+            // ---- Moves
+
+            case INSTR_MOV:
+                MoveLanes ( pBatch, Ops [ 0 ].iRow, & Ops [ 1 ] );
+                break;
+
+            case INSTR_PUSH:
+                MoveLanes ( pBatch, pBatch->iTopIndex ++, & Ops [ 0 ] );
+                break;
+
+            case INSTR_POP:
+            {
+                LaneOp Top;
+                Top.iRow = -- pBatch->iTopIndex;
+                MoveLanes ( pBatch, Ops [ 0 ].iRow, & Top );
+                break;
+            }
+
+            // ---- Arithmetic
+
+            // Like the execution loop, these work with integer destinations and treat
+            // floats as floats, but lanes only run together if the destination is one or the
+            // other in all of them and the source can be coerced without strings
+
+            case INSTR_ADD:
+            case INSTR_SUB:
+            case INSTR_MUL:
+            case INSTR_DIV:
+            case INSTR_MOD:
+            case INSTR_AND:
+            case INSTR_OR:
+            case INSTR_XOR:
+            case INSTR_SHL:
+            case INSTR_SHR:
+            {
+                int iDestType = GetLaneOpType ( pBatch, & Ops [ 0 ] );
+                int iSourceType = GetLaneOpType ( pBatch, & Ops [ 1 ] );
+
+                if ( iSourceType != OP_TYPE_INT && iSourceType != OP_TYPE_FLOAT )
+                    return BATCH_INSTR_SCALAR;
+
+                if ( iDestType == OP_TYPE_INT )
+                {
+                    RunIntLaneOp ( iOpcode, ( int * ) & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ],
+                                   GetLaneOpInts ( pBatch, & Ops [ 1 ], iSourceType, pBatch->pTemp0 ), iLaneCount );
+                }
+                else if ( iDestType == OP_TYPE_FLOAT )
+                {
+                    // Mod and the bitwise instructions do nothing to floats
+
+                    if ( iOpcode <= INSTR_DIV )
+                        RunFloatLaneOp ( iOpcode, ( float * ) & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ],
+                                         GetLaneOpFloats ( pBatch, & Ops [ 1 ], iSourceType, pBatch->pTemp0 ), iLaneCount );
+                }
+                else
+                {
+                    return BATCH_INSTR_SCALAR;
+                }
+
+                break;
+            }
+
+            case INSTR_NEG:
+            case INSTR_NOT:
+            case INSTR_INC:
+            case INSTR_DEC:
+            {
+                int iDestType = GetLaneOpType ( pBatch, & Ops [ 0 ] );
+                LaneData * pDest = & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ];
+
+                // Increment and decrement add or subtract a row of ones
+
+                int iLaneOpcode = iOpcode;
+                LaneOp One;
+                One.iRow = -1;
+                One.iType = OP_TYPE_INT;
+                One.Literal.iIntLiteral = 1;
+
+                if ( iOpcode == INSTR_INC )
+                    iLaneOpcode = INSTR_ADD;
+                else if ( iOpcode == INSTR_DEC )
+                    iLaneOpcode = INSTR_SUB;
+
+                if ( iDestType == OP_TYPE_INT )
+                {
+                    int * piSource = iLaneOpcode == iOpcode ? ( int * ) pDest : GetLaneOpInts ( pBatch, & One, OP_TYPE_INT, pBatch->pTemp0 );
+                    RunIntLaneOp ( iLaneOpcode, ( int * ) pDest, piSource, iLaneCount );
+                }
+                else if ( iDestType == OP_TYPE_FLOAT )
+                {
+                    if ( iOpcode != INSTR_NOT )
+                    {
+                        float * pfSource = iLaneOpcode == iOpcode ? ( float * ) pDest : GetLaneOpFloats ( pBatch, & One, OP_TYPE_INT, pBatch->pTemp0 );
+                        RunFloatLaneOp ( iLaneOpcode, ( float * ) pDest, pfSource, iLaneCount );
+                    }
+                }
+                else
+                {
+                    return BATCH_INSTR_SCALAR;
+                }
+
+                break;
+            }
+
+            // ---- Typed Arithmetic
+
+            // The compiler has proven the types, so the fields are used as-is
+
+            case INSTR_IADD:
+            case INSTR_ISUB:
+            case INSTR_IMUL:
+            case INSTR_IDIV:
+            case INSTR_IMOD:
+            {
+                SetLaneRowType ( pBatch, Ops [ 0 ].iRow, OP_TYPE_INT );
+                RunIntLaneOp ( iOpcode - INSTR_IADD + INSTR_ADD, ( int * ) & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ],
+                               GetLaneOpInts ( pBatch, & Ops [ 1 ], OP_TYPE_INT, pBatch->pTemp0 ), iLaneCount );
+                break;
+            }
+
+            case INSTR_IINC:
+            case INSTR_IDEC:
+            {
+                LaneOp One;
+                One.iRow = -1;
+                One.iType = OP_TYPE_INT;
+                One.Literal.iIntLiteral = 1;
+
+                SetLaneRowType ( pBatch, Ops [ 0 ].iRow, OP_TYPE_INT );
+                RunIntLaneOp ( iOpcode == INSTR_IINC ? INSTR_ADD : INSTR_SUB, ( int * ) & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ],
+                               GetLaneOpInts ( pBatch, & One, OP_TYPE_INT, pBatch->pTemp0 ), iLaneCount );
+                break;
+            }
+
+            case INSTR_FADD:
+            case INSTR_FSUB:
+            case INSTR_FMUL:
+            case INSTR_FDIV:
+            {
+                SetLaneRowType ( pBatch, Ops [ 0 ].iRow, OP_TYPE_FLOAT );
+                RunFloatLaneOp ( iOpcode - INSTR_FADD + INSTR_ADD, ( float * ) & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ],
+                                 GetLaneOpFloats ( pBatch, & Ops [ 1 ], OP_TYPE_FLOAT, pBatch->pTemp0 ), iLaneCount );
+                break;
+            }
+
+            // ---- Math Intrinsics
 
-		++ g_Scripts [ iThreadIndex ].Stack.iTopIndex;
-	}
+            case INSTR_SQRT:
+            case INSTR_ABS:
+            {
+                int iSourceType = GetLaneOpType ( pBatch, & Ops [ 1 ] );
 
-	/******************************************************************************************
-	*
-	*	Pop ()
-	*
-	*	Pops the element off the top of the stack.
-	*/
+                if ( iSourceType != OP_TYPE_INT && iSourceType != OP_TYPE_FLOAT )
+                    return BATCH_INSTR_SCALAR;
 
-	inline Value Pop ( int iThreadIndex )
-	{
-		// Decrement the top index to clear the old element for overwriting
+                // Abs keeps integers as integers, while everything else produces a float.
+                // The result goes through a scratch row in case the source is the
+                // destination.
 
-		-- g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+                int iResultType = iOpcode == INSTR_ABS && iSourceType == OP_TYPE_INT ? OP_TYPE_INT : OP_TYPE_FLOAT;
 
-		// Get the current top element
+                if ( iResultType == OP_TYPE_INT )
+                    RunIntLaneOp ( iOpcode, ( int * ) pBatch->pTemp1, GetLaneOpInts ( pBatch, & Ops [ 1 ], iSourceType, pBatch->pTemp0 ), iLaneCount );
+                else
+                    RunFloatLaneOp ( iOpcode, ( float * ) pBatch->pTemp1, GetLaneOpFloats ( pBatch, & Ops [ 1 ], iSourceType, pBatch->pTemp0 ), iLaneCount );
 
-		int iTopIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
+                SetLaneRowType ( pBatch, Ops [ 0 ].iRow, iResultType );
+                memcpy ( & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ], pBatch->pTemp1, iLaneCount * sizeof ( LaneData ) );
+                break;
+            }
 
-		// Use this index to read the top element
+            case INSTR_MIN:
+            case INSTR_MAX:
+            {
+                int iOp0Type = GetLaneOpType ( pBatch, & Ops [ 1 ] );
+                int iOp1Type = GetLaneOpType ( pBatch, & Ops [ 2 ] );
 
-        Value Val;
-    	CopyValue ( & Val, g_Scripts [ iThreadIndex ].Stack.pElmnts [ iTopIndex ] );
+                if ( ( iOp0Type != OP_TYPE_INT && iOp0Type != OP_TYPE_FLOAT ) ||
+                     ( iOp1Type != OP_TYPE_INT && iOp1Type != OP_TYPE_FLOAT ) )
+                    return BATCH_INSTR_SCALAR;
 
-		// Return the value to the caller
+                // Integers stay integers only if both operands are, and the result is
+                // built in a scratch row like above
 
-		return Val;
-	}
+                int iResultType = iOp0Type == OP_TYPE_INT && iOp1Type == OP_TYPE_INT ? OP_TYPE_INT : OP_TYPE_FLOAT;
 
-	/******************************************************************************************
-	*
-	*	PushFrame ()
-	*
-	*	Pushes a stack frame.
-	*/
+                if ( iResultType == OP_TYPE_INT )
+                {
+                    int * piOp0 = GetLaneOpInts ( pBatch, & Ops [ 1 ], iOp0Type, pBatch->pTemp1 );
+                    if ( piOp0 != ( int * ) pBatch->pTemp1 )
+                        memcpy ( pBatch->pTemp1, piOp0, iLaneCount * sizeof ( int ) );
 
-	inline void PushFrame ( int iThreadIndex, int iSize )
-	{
-		// Increment the top index by the size of the frame
+                    RunIntLaneOp ( iOpcode, ( int * ) pBatch->pTemp1, GetLaneOpInts ( pBatch, & Ops [ 2 ], iOp1Type, pBatch->pTemp0 ), iLaneCount );
+                }
+                else
+                {
+                    float * pfOp0 = GetLaneOpFloats ( pBatch, & Ops [ 1 ], iOp0Type, pBatch->pTemp1 );
+                    if ( pfOp0 != ( float * ) pBatch->pTemp1 )
+                        memcpy ( pBatch->pTemp1, pfOp0, iLaneCount * sizeof ( float ) );
 
-		g_Scripts [ iThreadIndex ].Stack.iTopIndex += iSize;
+                    RunFloatLaneOp ( iOpcode, ( float * ) pBatch->pTemp1, GetLaneOpFloats ( pBatch, & Ops [ 2 ], iOp1Type, pBatch->pTemp0 ), iLaneCount );
+                }
 
-        // Move the frame index to the new top of the stack
+                SetLaneRowType ( pBatch, Ops [ 0 ].iRow, iResultType );
+                memcpy ( & pBatch->pData [ Ops [ 0 ].iRow * iLaneCount ], pBatch->pTemp1, iLaneCount * sizeof ( LaneData ) );
+                break;
+            }
 
-        g_Scripts [ iThreadIndex ].Stack.iFrameIndex = g_Scripts [ iThreadIndex ].Stack.iTopIndex;
-	}
+            // ---- Branching
 
-	/******************************************************************************************
-	*
-	*	PopFrame ()
-	*
-	*	Pops a stack frame.
-	*/
+            case INSTR_JMP:
+                iNextInstr = Ops [ 0 ].Literal.iIntLiteral;
+                break;
 
-	inline void PopFrame ( int iSize )
-	{
-		// Decrement the top index by the size of the frame
+            // Lanes compare the same way the execution loop does, as long as the first
+            // operand is an integer or float in all of them and the second is never a string
+
+            case INSTR_JE:
+            case INSTR_JNE:
+            case INSTR_JG:
+            case INSTR_JL:
+            case INSTR_JGE:
+            case INSTR_JLE:
+            case INSTR_IJE:
+            case INSTR_IJNE:
+            case INSTR_IJG:
+            case INSTR_IJL:
+            case INSTR_IJGE:
+            case INSTR_IJLE:
+            {
+                int iOp0Type = OP_TYPE_INT;
+                int iCompareOpcode = iOpcode;
 
-		g_Scripts [ g_iCurrThread ].Stack.iTopIndex -= iSize;
+                if ( iOpcode >= INSTR_IJE )
+                {
+                    iCompareOpcode = iOpcode - INSTR_IJE + INSTR_JE;
+                }
+                else
+                {
+                    iOp0Type = GetLaneOpType ( pBatch, & Ops [ 0 ] );
+                    int iOp1Type = GetLaneOpType ( pBatch, & Ops [ 1 ] );
 
-        // Move the frame index to the new top of the stack
-	}
+                    if ( ( iOp0Type != OP_TYPE_INT && iOp0Type != OP_TYPE_FLOAT ) ||
+                         iOp1Type == OP_TYPE_STRING || iOp1Type == LANE_TYPE_MIXED )
+                        return BATCH_INSTR_SCALAR;
+                }
 
-	/******************************************************************************************
-	*
-	*	GetFunc ()
-	*
-	*	Returns the function corresponding to the specified index.
-	*/
+                // Both operands are compared as the first one's type, without coercion
 
-	inline Func GetFunc ( int iThreadIndex, int iIndex )
-	{
-		return g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iIndex ];
-	}
+                int iJumpCount;
 
-	/******************************************************************************************
-	*
-	*	GetHostAPICall ()
-	*
-	*	Returns the host API call corresponding to the specified index.
-	*/
+                if ( iOp0Type == OP_TYPE_INT )
+                    iJumpCount = CompareIntLanes ( iCompareOpcode,
+                                                   GetLaneOpInts ( pBatch, & Ops [ 0 ], OP_TYPE_INT, pBatch->pTemp0 ),
+                                                   GetLaneOpInts ( pBatch, & Ops [ 1 ], OP_TYPE_INT, pBatch->pTemp1 ),
+                                                   pBatch->piLaneInstrs, iLaneCount );
+                else
+                    iJumpCount = CompareFloatLanes ( iCompareOpcode,
+                                                     GetLaneOpFloats ( pBatch, & Ops [ 0 ], OP_TYPE_FLOAT, pBatch->pTemp0 ),
+                                                     GetLaneOpFloats ( pBatch, & Ops [ 1 ], OP_TYPE_FLOAT, pBatch->pTemp1 ),
+                                                     pBatch->piLaneInstrs, iLaneCount );
 
-	inline char * GetHostAPICall ( int iIndex )
-	{
-		return g_Scripts [ g_iCurrThread ].HostAPICallTable.ppstrCalls [ iIndex ];
-	}
+                int iTargetIndex = Ops [ 2 ].Literal.iIntLiteral;
 
-    /******************************************************************************************
-    *
-    *   GetCurrTime ()
-    *
-    *   Wrapper for the system-dependant method of determining the current time in
-    *   milliseconds.
-    */
+                // If every lane agrees, they stay together
 
-    inline int GetCurrTime ()
-    {
-        // This function is currently implemented with the WinAPI function GetTickCount ().
-        // Change this line to make it compatible with other systems.
+                if ( iJumpCount == iLaneCount )
+                {
+                    iNextInstr = iTargetIndex;
+                    break;
+                }
 
-        return GetTickCount ();
-    }
+                if ( iJumpCount == 0 )
+                    break;
 
-    /******************************************************************************************
-    *
-    *   CallFunc ()
-    *
-    *   Calls a function based on its index.
-    */
+                // Otherwise turn the flags into each lane's next instruction
 
-    void CallFunc ( int iThreadIndex, int iIndex )
-    {
-        Func DestFunc = GetFunc ( iThreadIndex, iIndex );
+                for ( int iCurrLane = 0; iCurrLane < iLaneCount; ++ iCurrLane )
+                    pBatch->piLaneInstrs [ iCurrLane ] = pBatch->piLaneInstrs [ iCurrLane ] ? iTargetIndex : iNextInstr;
 
-        // Save the current stack frame index
+                return BATCH_INSTR_SPLIT;
+            }
 
-        int iFrameIndex = g_Scripts [ iThreadIndex ].Stack.iFrameIndex;
+            // ---- The Function Call Interface
 
-        // Push the return address, which is the current instruction
+            // Calls are made the same way CallFunc () makes them, in every lane at once
 
-        Value ReturnAddr;
-        ReturnAddr.iInstrIndex = g_Scripts [ iThreadIndex ].InstrStream.iCurrInstr;
-        Push ( iThreadIndex, ReturnAddr );
+            case INSTR_CALL:
+            {
+                int iFuncIndex = Ops [ 0 ].Literal.iIntLiteral;
+                Func * pFunc = & pScript->FuncTable.pFuncs [ iFuncIndex ];
+                int iFrameIndex = pBatch->iFrameIndex;
 
-        // Push the stack frame + 1 (the extra space is for the function index
-        // we'll put on the stack after it
+                // A call that overflows the stack is left to the lanes, which stop there
 
-        PushFrame ( iThreadIndex, DestFunc.iLocalDataSize + 1 );
+                if ( pBatch->iTopIndex + pFunc->iLocalDataSize + 2 > pBatch->iStackSize )
+                    return BATCH_INSTR_SCALAR;
 
-        // Write the function index and old stack frame to the top of the stack
+                FillLaneRow ( pBatch, pBatch->iTopIndex ++, OP_TYPE_INSTR_INDEX, iNextInstr, 0 );
 
-        Value FuncIndex;
-        FuncIndex.iFuncIndex = iIndex;
-        FuncIndex.iOffsetIndex = iFrameIndex;
-        SetStackValue ( iThreadIndex, g_Scripts [ iThreadIndex ].Stack.iTopIndex - 1, FuncIndex );
+                pBatch->iTopIndex += pFunc->iLocalDataSize + 1;
+                pBatch->iFrameIndex = pBatch->iTopIndex;
 
-        // Let the caller make the jump to the entry point
+                FillLaneRow ( pBatch, pBatch->iTopIndex - 1, OP_TYPE_FUNC_INDEX, iFuncIndex, iFrameIndex );
 
-        g_Scripts [ iThreadIndex ].InstrStream.iCurrInstr = DestFunc.iEntryPoint;
-    }
+                iNextInstr = pFunc->iEntryPoint;
+                break;
+            }
 
-    /******************************************************************************************
-    *
-    *   XS_PassIntParam ()
-    *
-    *   Passes an integer parameter from the host to a script function.
-    */
+            // The function index, old frame and return address are the same in every lane,
+            // so they're read from the first
 
-    void XS_PassIntParam ( int iThreadIndex, int iInt )
-    {
-        // Create a Value structure to encapsulate the parameter
+            case INSTR_RET:
+            {
+                int iFuncIndexElmnt = ( -- pBatch->iTopIndex ) * iLaneCount;
 
-        Value Param;
-        Param.iType = OP_TYPE_INT;
-        Param.iIntLiteral = iInt;
+                // The stack base marker means the function the host called has returned
 
-        // Push the parameter onto the stack
+                if ( pBatch->piTypes [ iFuncIndexElmnt ] == OP_TYPE_STACK_BASE_MARKER )
+                    return BATCH_INSTR_DONE;
 
-        Push ( iThreadIndex, Param );
-    }
+                Func * pFunc = & pScript->FuncTable.pFuncs [ pBatch->pData [ iFuncIndexElmnt ].iIntLiteral ];
+                int iFrameIndex = pBatch->piOffsetIndices [ iFuncIndexElmnt ];
 
-    /******************************************************************************************
-    *
-    *   XS_PassFloatParam ()
-    *
-    *   Passes a floating-point parameter from the host to a script function.
-    */
+                iNextInstr = pBatch->pData [ ( pBatch->iTopIndex - ( pFunc->iLocalDataSize + 1 ) ) * iLaneCount ].iIntLiteral;
 
-    void XS_PassFloatParam ( int iThreadIndex, float fFloat )
-    {
-        // Create a Value structure to encapsulate the parameter
+                pBatch->iTopIndex -= pFunc->iStackFrameSize;
+                pBatch->iFrameIndex = iFrameIndex;
+                break;
+            }
 
-        Value Param;
-        Param.iType = OP_TYPE_FLOAT;
-        Param.fFloatLiteral = fFloat;
+            case INSTR_CALLHOST:
+            {
+                // Look the function up once, then call it for each lane
 
-        // Push the parameter onto the stack
+                char * pstrFuncName = pScript->HostAPICallTable.ppstrCalls [ Ops [ 0 ].Literal.iIntLiteral ];
+                HostAPIFuncPntr fnFunc = GetHostAPIFunc ( pBatch->iThreadIndex, pstrFuncName );
 
-        Push ( iThreadIndex, Param );
-    }
+                if ( fnFunc )
+                    RunBatchHostCall ( pBatch, fnFunc );
 
-    /******************************************************************************************
-    *
-    *   XS_PassStringParam ()
-    *
-    *   Passes a string parameter from the host to a script function.
-    */
+                break;
+            }
 
-    void XS_PassStringParam ( int iThreadIndex, char * pstrString )
-    {
-        // Create a Value structure to encapsulate the parameter
+            // Everything else is left to the execution loop
 
-        Value Param;
-        Param.iType = OP_TYPE_STRING;
-        Param.pstrStringLiteral = ( char * ) malloc ( strlen ( pstrString ) + 1 );
-        strcpy ( Param.pstrStringLiteral, pstrString );
+            default:
+                return BATCH_INSTR_SCALAR;
+        }
 
-        // Push the parameter onto the stack
+        pBatch->iCurrInstr = iNextInstr;
 
-        Push ( iThreadIndex, Param );
+        return BATCH_INSTR_OK;
     }
 
     /******************************************************************************************
     *
-    *   GetFuncIndexByName ()
+    *   UnpackLane ()
     *
-    *   Returns the index into the function table corresponding to the specified name.
+    *   Moves the bottom rows of a lane's stack into the batch's scalar stack, and its _RetVal
+    *   into the script's. The lane's elements are nulled, so each string only ever has one
+    *   owner.
     */
 
-    int GetFuncIndexByName ( int iThreadIndex, char * pstrName )
+    void UnpackLane ( Batch * pBatch, int iLane, int iRowCount )
     {
-        // Loop through each function and look for a matching name
+        int iLaneCount = pBatch->iLaneCount;
 
-        for ( int iFuncIndex = 0; iFuncIndex < g_Scripts [ iThreadIndex ].FuncTable.iSize; ++ iFuncIndex )
+        for ( int iCurrRow = 0; iCurrRow < iRowCount; ++ iCurrRow )
         {
-            // If the names match, return the index
+            int iElmnt = iCurrRow * iLaneCount + iLane;
 
-            if ( stricmp ( pstrName, g_Scripts [ iThreadIndex ].FuncTable.pFuncs [ iFuncIndex ].pstrName ) == 0 )
-                return iFuncIndex;
+            // Free any string an earlier lane left behind
+
+            if ( pBatch->ScalarStack.pElmnts [ iCurrRow ].iType == OP_TYPE_STRING )
+                free ( pBatch->ScalarStack.pElmnts [ iCurrRow ].pstrStringLiteral );
+
+            pBatch->ScalarStack.pElmnts [ iCurrRow ] = GetLaneValue ( pBatch, iElmnt );
+            pBatch->piTypes [ iElmnt ] = OP_TYPE_NULL;
         }
 
-        // A match wasn't found, so return -1
+        int iRetValElmnt = pBatch->iStackSize * iLaneCount + iLane;
 
-        return -1;
+        g_Scripts [ pBatch->iThreadIndex ]._RetVal = GetLaneValue ( pBatch, iRetValElmnt );
+        pBatch->piTypes [ iRetValElmnt ] = OP_TYPE_NULL;
     }
 
     /******************************************************************************************
     *
-    *   XS_CallScriptFunc ()
+    *   PackLane ()
     *
-    *   Calls a script function from the host application.
+    *   Moves the bottom rows of the scalar stack and the script's _RetVal back into a lane,
+    *   undoing UnpackLane ().
     */
-    
-    void XS_CallScriptFunc ( int iThreadIndex, char * pstrName )
+
+    void PackLane ( Batch * pBatch, int iLane, int iRowCount )
     {
-        // Make sure the thread index is valid and active
+        int iLaneCount = pBatch->iLaneCount;
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
-        
-        // ---- Calling the function
+        for ( int iCurrRow = 0; iCurrRow < iRowCount; ++ iCurrRow )
+        {
+            int iElmnt = iCurrRow * iLaneCount + iLane;
 
-        // Preserve the current state of the VM
+            // Rows above the ones UnpackLane () moved out may still hold a string
 
-        int iPrevThreadMode = g_iCurrThreadMode;
-        int iPrevThread = g_iCurrThread;
+            if ( pBatch->piTypes [ iElmnt ] == OP_TYPE_STRING )
+                free ( pBatch->ppstrStrings [ iElmnt ] );
 
-        // Set the threading mode for single-threaded execution
+            SetLaneValue ( pBatch, iElmnt, pBatch->ScalarStack.pElmnts [ iCurrRow ] );
+            pBatch->ScalarStack.pElmnts [ iCurrRow ].iType = OP_TYPE_NULL;
+        }
 
-        g_iCurrThreadMode = THREAD_MODE_SINGLE;
+        Script * pScript = & g_Scripts [ pBatch->iThreadIndex ];
 
-        // Set the active thread to the one specified
+        SetLaneValue ( pBatch, pBatch->iStackSize * iLaneCount + iLane, pScript->_RetVal );
+        pScript->_RetVal.iType = OP_TYPE_NULL;
+    }
 
-        g_iCurrThread = iThreadIndex;
+    /******************************************************************************************
+    *
+    *   RunBatchHostCall ()
+    *
+    *   Calls a host API function once for each lane, with the lane's stack swapped into the
+    *   script so the function can read its parameters and return a value as usual.
+    */
 
-        // Get the function's index based on its name
+    void RunBatchHostCall ( Batch * pBatch, HostAPIFuncPntr fnFunc )
+    {
+        Script * pScript = & g_Scripts [ pBatch->iThreadIndex ];
 
-        int iFuncIndex = GetFuncIndexByName ( iThreadIndex, pstrName );
+        // Preserve the script's own stack and _RetVal
 
-        // Make sure the function name was valid
+        RuntimeStack ThreadStack = pScript->Stack;
+        Value ThreadRetVal = pScript->_RetVal;
 
-        if ( iFuncIndex == -1 )
-            return;
+        int iRowCount = pBatch->iTopIndex;
+        int iNewTopIndex = iRowCount;
 
-        // Call the function
+        for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+        {
+            UnpackLane ( pBatch, iCurrLane, iRowCount );
 
-        CallFunc ( iThreadIndex, iFuncIndex );
+            pBatch->ScalarStack.iTopIndex = pBatch->iTopIndex;
+            pBatch->ScalarStack.iFrameIndex = pBatch->iFrameIndex;
+            pScript->Stack = pBatch->ScalarStack;
 
-        // Set the stack base
+            g_iCurrBatchLane = iCurrLane;
+            fnFunc ( pBatch->iThreadIndex );
 
-        Value StackBase = GetStackValue ( g_iCurrThread, g_Scripts [ g_iCurrThread ].Stack.iTopIndex - 1 );
-        StackBase.iType = OP_TYPE_STACK_BASE_MARKER;
-        SetStackValue ( g_iCurrThread, g_Scripts [ g_iCurrThread ].Stack.iTopIndex - 1, StackBase );
+            // The function pops its parameters the same way in every lane
 
-        // Allow the script code to execute uninterrupted until the function returns
+            iNewTopIndex = pScript->Stack.iTopIndex;
 
-        XS_RunScripts ( XS_INFINITE_TIMESLICE );
+            PackLane ( pBatch, iCurrLane, iRowCount );
+        }
 
-        // ---- Handling the function return
+        g_iCurrBatchLane = -1;
 
-        // Restore the VM state
+        pScript->Stack = ThreadStack;
+        pScript->_RetVal = ThreadRetVal;
 
-        g_iCurrThreadMode = iPrevThreadMode;
-        g_iCurrThread = iPrevThread;
+        pBatch->iTopIndex = iNewTopIndex;
     }
 
     /******************************************************************************************
     *
-    *   XS_InvokeScriptFunc ()
+    *   RunBatchLanesAlone ()
     *
-    *   Invokes a script function from the host application, meaning the call executes in sync
-    *   with the script.
+    *   Finishes the current call in each lane by itself. Each lane is swapped into the script
+    *   in turn and run by the execution loop from its own next instruction, until the stack
+    *   base marker stops it.
     */
-    
-    void XS_InvokeScriptFunc ( int iThreadIndex, char * pstrName )
+
+    void RunBatchLanesAlone ( Batch * pBatch )
     {
-        // Make sure the thread index is valid and active
+        Script * pScript = & g_Scripts [ pBatch->iThreadIndex ];
 
-        if ( ! IsThreadActive ( iThreadIndex ) )
-            return;
-        
-        // Get the function's index based on its name
+        // Preserve the script's own execution state
 
-        int iFuncIndex = GetFuncIndexByName ( iThreadIndex, pstrName );
+        RuntimeStack ThreadStack = pScript->Stack;
+        Value ThreadRetVal = pScript->_RetVal;
+        int iThreadCurrInstr = pScript->InstrStream.iCurrInstr;
+        int iThreadIsRunning = pScript->iIsRunning;
+        int iThreadIsPaused = pScript->iIsPaused;
 
-        // Make sure the function name was valid
+        int iRowCount = pBatch->iTopIndex;
 
-        if ( iFuncIndex == -1 )
-            return;
+        for ( int iCurrLane = 0; iCurrLane < pBatch->iLaneCount; ++ iCurrLane )
+        {
+            UnpackLane ( pBatch, iCurrLane, iRowCount );
 
-        // Call the function
+            pBatch->ScalarStack.iTopIndex = pBatch->iTopIndex;
+            pBatch->ScalarStack.iFrameIndex = pBatch->iFrameIndex;
+            pScript->Stack = pBatch->ScalarStack;
+            pScript->InstrStream.iCurrInstr = pBatch->piLaneInstrs [ iCurrLane ];
+            pScript->iIsRunning = TRUE;
+            pScript->iIsPaused = FALSE;
 
-        CallFunc ( iThreadIndex, iFuncIndex );
+            g_iCurrBatchLane = iCurrLane;
+            XS_RunScripts ( XS_INFINITE_TIMESLICE );
+
+            // Move back everything the lane could have touched, which is more than it
+            // started with if it exited partway through a call
+
+            int iEndTopIndex = pScript->Stack.iTopIndex;
+            PackLane ( pBatch, iCurrLane, iEndTopIndex > iRowCount ? iEndTopIndex : iRowCount );
+        }
+
+        g_iCurrBatchLane = -1;
+
+        pScript->Stack = ThreadStack;
+        pScript->_RetVal = ThreadRetVal;
+        pScript->InstrStream.iCurrInstr = iThreadCurrInstr;
+        pScript->iIsRunning = iThreadIsRunning;
+        pScript->iIsPaused = iThreadIsPaused;
     }
 
     /******************************************************************************************
@@ -2770,7 +6998,8 @@
                 g_HostAPI [ iCurrHostAPIFunc ].iThreadIndex = iThreadIndex;
                 g_HostAPI [ iCurrHostAPIFunc ].pstrName = ( char * ) malloc ( strlen ( pstrName ) + 1 );
                 strcpy ( g_HostAPI [ iCurrHostAPIFunc ].pstrName, pstrName );
-                strupr ( g_HostAPI [ iCurrHostAPIFunc ].pstrName );
+                for ( char * pstrCurrChar = g_HostAPI [ iCurrHostAPIFunc ].pstrName; * pstrCurrChar; ++ pstrCurrChar )
+                    * pstrCurrChar = toupper ( * pstrCurrChar );
                 g_HostAPI [ iCurrHostAPIFunc ].fnFunc = fnFunc;
 
                 // Set the function to active
@@ -23,14 +23,24 @@
 	#include <stdlib.h>
     #include <stdio.h>
     #include <string.h>
+    #include <ctype.h>
     #include <math.h>
     #include <stdarg.h>
 
     // The following Windows-specific includes are only here to implement GetCurrTime (); these
-    // can be replaced when implementing the XVM on non-Windows platforms.
+    // can be replaced when implementing the XVM on non-Windows platforms. Elsewhere, the POSIX
+    // equivalents are used instead.
 
-	#define WIN32_LEAN_AND_MEAN
-	#include <windows.h>
+    #ifdef _WIN32
+	    #define WIN32_LEAN_AND_MEAN
+	    #include <windows.h>
+    #else
+        #include <time.h>
+        #include <strings.h>
+
+        #define stricmp strcasecmp
+        #define strnicmp strncasecmp
+    #endif
 
 // ---- Constants -----------------------------------------------------------------------------
 
@@ -63,6 +73,21 @@
 
         #define XS_INFINITE_TIMESLICE       -1          // Allows a thread to run indefinitely
 
+    // ---- Coroutines ------------------------------------------------------------------------
+
+        #define XS_INVALID_COROUTINE        -1          // Returned when a coroutine can't be
+                                                        // created
+
+        #define XS_COROUTINE_SUSPENDED      0           // Created or yielded, and waiting to
+                                                        // be resumed
+        #define XS_COROUTINE_RUNNING        1           // Currently running
+        #define XS_COROUTINE_DEAD           2           // Returned or exited
+
+    // ---- Batches ---------------------------------------------------------------------------
+
+        #define XS_INVALID_BATCH            -1          // Returned when a batch can't be
+                                                        // created
+
     // ---- The Host API ----------------------------------------------------------------------
 
         #define XS_GLOBAL_FUNC              -1          // Flags a host API function as being
@@ -125,11 +150,45 @@
         void XS_PassIntParam ( int iThreadIndex, int iInt );
         void XS_PassFloatParam ( int iThreadIndex, float fFloat );
         void XS_PassStringParam ( int iThreadIndex, char * pstrString );
+
+        // An Exit in a function called with XS_CallScriptFunc () stops the thread and returns
+        // to the host right away. Before batches were added, the call only returned there if
+        // no other thread was running, and otherwise ran on to the end of the function.
+
         void XS_CallScriptFunc ( int iThreadIndex, char * pstrName );
         void XS_InvokeScriptFunc ( int iThreadIndex, char * pstrName );
         int XS_GetReturnValueAsInt ( int iThreadIndex );
         float XS_GetReturnValueAsFloat ( int iThreadIndex );
         char * XS_GetReturnValueAsString ( int iThreadIndex );
+        unsigned int XS_GetInstrCount ( int iThreadIndex );
+
+    // ---- Coroutine Interface ---------------------------------------------------------------
+
+        int XS_CreateCoroutine ( int iThreadIndex, char * pstrName, int iStackSize );
+        int XS_ResumeCoroutine ( int iCoroutine );
+        int XS_GetCoroutineState ( int iCoroutine );
+        int XS_GetCurrCoroutine ();
+        int XS_GetCoroutineValueAsInt ( int iCoroutine );
+        float XS_GetCoroutineValueAsFloat ( int iCoroutine );
+        char * XS_GetCoroutineValueAsString ( int iCoroutine );
+        void XS_DestroyCoroutine ( int iCoroutine );
+
+    // ---- Batch Interface -------------------------------------------------------------------
+
+        int XS_CreateBatch ( int iThreadIndex, int iLaneCount, int iStackSize );
+        void XS_DestroyBatch ( int iBatch );
+        void XS_PassBatchIntParams ( int iBatch, int * piInts );
+        void XS_PassBatchFloatParams ( int iBatch, float * pfFloats );
+        void XS_CallBatchFunc ( int iBatch, char * pstrName );
+        int XS_GetBatchReturnValueAsInt ( int iBatch, int iLane );
+        float XS_GetBatchReturnValueAsFloat ( int iBatch, int iLane );
+        int XS_GetCurrBatchLane ();
+
+    // ---- Debug Info Interface --------------------------------------------------------------
+
+        int XS_GetCurrInstr ( int iThreadIndex );
+        int XS_GetSourceLine ( int iThreadIndex, int iInstrIndex );
+        char * XS_GetSourceFilename ( int iThreadIndex );
 
     // ---- Host API Interface ----------------------------------------------------------------
 
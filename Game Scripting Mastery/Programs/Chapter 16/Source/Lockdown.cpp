@@ -53,6 +53,23 @@
         #define FPS_LOCK_FRAME_DUR              1000 / FPS_LOCK // Maximum duration of a frame
                                                                 // in milliseconds
 
+    // ---- Profiling -------------------------------------------------------------------------
+
+        #define PROFILE_ROOM                    0       // Drawing the room and doors
+        #define PROFILE_DROIDS                  1       // Drawing the droids
+        #define PROFILE_DRAW_LASERS             2       // Drawing the lasers
+        #define PROFILE_UPDATE_LASERS           3       // Moving and colliding the lasers
+        #define PROFILE_KEY                     4       // Drawing and updating the key
+        #define PROFILE_DRAW_EXPLOSIONS         5       // Drawing the explosions
+        #define PROFILE_UPDATE_EXPLOSIONS       6       // Updating the explosions
+        #define PROFILE_INTERFACE               7       // Drawing the interface
+        #define PROFILE_SPRITE_BATCH            8       // Blitting the batched sprites
+        #define PROFILE_SCRIPTS                 9       // Running the scripts
+        #define PROFILE_FRAME                   10      // The whole frame, minus the FPS lock
+        #define PROFILE_SECTION_COUNT           11
+
+        #define PROFILE_REPORT_FILENAME         "Timing.txt"    // Where the breakdown goes
+
     // ---- Game States -----------------------------------------------------------------------
 
         #define GAME_STATE_TITLE                0       // Title screen
@@ -72,6 +89,20 @@
 
         #define LIGHTS_OFF                      0       // Lights off flag
         #define LIGHTS_ON                       1       // Lights on flag
+
+        #define SPRITE_ATLAS_FILENAME           "Gfx/Sprites.atl"   // Every gameplay sprite,
+                                                                    // packed by ATLASPACK
+        #define IMAGE_PACK_FILENAME             "Gfx/Images.pak"    // Every full-size image,
+                                                                    // cooked by IMAGECOOK
+
+        // Sprite batch layers, drawn lowest first
+
+        #define LAYER_ROOM                      0       // Key panels and doors
+        #define LAYER_DROIDS                    1       // Droids
+        #define LAYER_LASERS                    2       // Lasers
+        #define LAYER_KEY                       3       // The floating key
+        #define LAYER_EXPLOSIONS                4       // Explosions
+        #define LAYER_INTERFACE                 5       // The energy and key meters
     
     // ---- Gameplay --------------------------------------------------------------------------
 
@@ -147,6 +178,12 @@
 
         #define PLAYER_ENERGY_RECHARGE          0.01F   // The player's energy recharge rate
 
+    // ---- Droid Grid ------------------------------------------------------------------------
+
+        #define DROID_GRID_CELL_SIZE            64      // Width and height of a grid cell
+        #define DROID_GRID_WIDTH                10      // Grid width (in cells)
+        #define DROID_GRID_HEIGHT               8       // Grid height (in cells)
+
     // ---- Fortress --------------------------------------------------------------------------
 
         #define FORTRESS_WIDTH                  5       // Fortress width (in rooms)
@@ -203,6 +240,23 @@
 
         #define SCRIPT_TIMESLICE_DUR            20      // Timeslice duration of the scripts
 
+    // ---- Simulation ------------------------------------------------------------------------
+
+        #define SIM_DEFAULT_ROOM_COUNT          1000    // Rooms to simulate by default
+        #define SIM_DEFAULT_TICKS_PER_ROOM      1800    // Longest a room can last by default
+                                                        // (30 seconds at the FPS lock)
+        #define SIM_DEFAULT_SEED                1       // Default random seed
+
+        #define SIM_MAX_INPUT_STEP_COUNT        1024    // Maximum steps in an input script
+        #define SIM_MIN_RAND_STEP_DUR           5       // Shortest random input step (in ticks)
+        #define SIM_MAX_RAND_STEP_DUR           60      // Longest random input step
+
+        #define SIM_KEY_UP                      1       // Input step key flags
+        #define SIM_KEY_DOWN                    2
+        #define SIM_KEY_LEFT                    4
+        #define SIM_KEY_RIGHT                   8
+        #define SIM_KEY_FIRE                    16
+
 // ---- Data Structures -----------------------------------------------------------------------
 
     typedef struct _Droid                               // A droid
@@ -228,7 +282,9 @@
         int iKeys [ 4 ];                                // Collected keys
         int iActiveKeyPanels [ 4 ];                     // Activated key panels
 
-        Droid Droid;                                    // The player droid
+        _Droid Droid;                                   // The player droid, declared with the
+                                                        // structure tag since GCC won't let a
+                                                        // member change what Droid means
     }
         Player;
 
@@ -255,28 +311,35 @@
     }
         Room;
 
-    typedef struct _Laser                               // A Laser
+    // Lasers and explosions are stored as parallel arrays, one per field, with the active
+    // ones packed at the front in the order they were added. Updates only have to walk the
+    // fields they use, and there are no inactive slots to skip.
+
+    typedef struct _LaserList                           // The onscreen lasers
     {
-        int iIsActive;                                  // Is the laser active?
-        int iX,                                         // X, Y location
-            iY;
-        int iDir;                                       // Direction
-        int iType;                                      // Laser type
-        int iSpeed;                                     // Speed
-        int iCurrFrame;                                 // Current animation frame
-        unsigned int iLastFrameUpdateTime;              // Time of the last frame update
+        int iCount;                                     // Number of active lasers
+        int iX [ MAX_LASER_COUNT ],                     // X, Y location
+            iY [ MAX_LASER_COUNT ];
+        int iXVel [ MAX_LASER_COUNT ],                  // X, Y velocity
+            iYVel [ MAX_LASER_COUNT ];
+        int iDir [ MAX_LASER_COUNT ];                   // Direction
+        int iType [ MAX_LASER_COUNT ];                  // Laser type
+        int iCurrFrame [ MAX_LASER_COUNT ];             // Current animation frame
+        unsigned int iLastFrameUpdateTime [ MAX_LASER_COUNT ];  // Time of the last frame
+                                                                // update
     }
-        Laser;
+        LaserList;
 
-    typedef struct _Explosion                           // An Explosion
+    typedef struct _ExplosionList                       // The onscreen explosions
     {
-        int iIsActive;                                  // Is the explosion exploding?
-        int iX,                                         // X, Y location
-            iY;
-        int iCurrFrame;                                 // Current animation frame
-        unsigned int iLastFrameUpdateTime;              // Time of the last frame update
+        int iCount;                                     // Number of active explosions
+        int iX [ MAX_EXPLOSION_COUNT ],                 // X, Y location
+            iY [ MAX_EXPLOSION_COUNT ];
+        int iCurrFrame [ MAX_EXPLOSION_COUNT ];         // Current animation frame
+        unsigned int iLastFrameUpdateTime [ MAX_EXPLOSION_COUNT ];  // Time of the last frame
+                                                                    // update
     }
-        Explosion;
+        ExplosionList;
 
     typedef struct _Key                                 // Key
     {
@@ -291,12 +354,45 @@
     }
         Key;
 
+    typedef struct _SimInputStep                        // A step of simulated input
+    {
+        int iTickCount;                                 // Ticks to hold the keys down for
+        int iKeys;                                      // SIM_KEY_* flags of the keys held
+    }
+        SimInputStep;
+
+    typedef struct _SimStats                            // Simulation results for a droid type
+    {
+        int iRoomCount;                                 // Rooms simulated
+        int iTickCount;                                 // Ticks simulated
+        int iDroidsDestroyed;                           // Enemy droids destroyed
+        int iPlayerDeaths;                              // Rooms the player died in
+        int iExitCount;                                 // Rooms the player walked out of
+        int iClearCount;                                // Rooms the player cleared
+    }
+        SimStats;
+
 // ---- Global Variables ----------------------------------------------------------------------
 
     // ---- Game Engine -----------------------------------------------------------------------
 
         int g_iCurrGameState;                           // The current game state
 
+        int g_iIsFPSLockEnabled = TRUE;                 // Does HandleState () wait out the
+                                                        // rest of each frame?
+
+    // ---- Profiling -------------------------------------------------------------------------
+
+        W_Int64 g_iProfileTimes [ PROFILE_SECTION_COUNT ];  // Time spent in each section (in
+                                                            // microseconds)
+        int g_iProfileFrameCount;                       // Gameplay frames profiled
+
+        char * g_ppstrProfileSectionNames [ PROFILE_SECTION_COUNT ] =
+        {
+            "Room", "Droids", "Draw lasers", "Update lasers", "Key", "Draw explosions",
+            "Update explosions", "Interface", "Sprite batch", "Scripts", "Frame"
+        };
+
     // ---- Graphics --------------------------------------------------------------------------
 
         // ---- Title screen ------------------------------------------------------------------
@@ -322,6 +418,11 @@
             W_Image g_PedestalRoomOn;                   // The pedestal room, lights on
             W_Image g_KeyRoom;                          // The key room
 
+            // ---- Sprites
+
+            W_Atlas g_SpriteAtlas;                      // Holds every sprite below, unless
+                                                        // it couldn't be loaded
+
             // ---- Doors
 
             W_Image g_DoorAnims [ STRAIGHT_DIR_COUNT ][ 2 ][ DOOR_ANIM_FRAME_COUNT ];   // Door animations
@@ -406,8 +507,20 @@
         Key g_Key;                                      // The key
 
         Droid g_EnemyDroids [ ENEMY_DROID_COUNT ];      // The droid population
-        Explosion g_Explosions [ MAX_EXPLOSION_COUNT ]; // Explosions
-        Laser g_Lasers [ MAX_LASER_COUNT ];             // Lasers
+        ExplosionList g_Explosions;                     // Explosions
+        LaserList g_Lasers;                             // Lasers
+
+        // The droid grid, which buckets the enemy droids by the cell their upper-left corner
+        // is in so lasers only have to be tested against droids near them. Each cell holds
+        // the index of the first droid in it, and the droids in a cell are linked together.
+
+        int g_iDroidGrid [ DROID_GRID_HEIGHT * DROID_GRID_WIDTH ];
+        int g_iDroidGridCell [ ENEMY_DROID_COUNT ];     // The cell each droid is in
+        int g_iDroidGridNext [ ENEMY_DROID_COUNT ];     // The next droid in its cell
+        int g_iDroidGridPrev [ ENEMY_DROID_COUNT ];     // The previous droid in its cell
+
+        int g_iDroidGridReachX;                         // How far a droid's corner can be from
+        int g_iDroidGridReachY;                         // a laser's and still collide with it
 
         // The fortress map (Y x X rooms)
 
@@ -434,6 +547,25 @@
         int g_iGreyDroidThreadIndex;                    // Grey droid script index
         int g_iRedDroidThreadIndex;                     // Red droid script index
 
+    // ---- Simulation ------------------------------------------------------------------------
+
+        int g_iIsSimActive;                             // Was a simulation requested?
+        int g_iSimRoomCount;                            // Rooms to simulate
+        int g_iSimTicksPerRoom;                         // Longest a room can last
+        unsigned int g_iSimSeed;                        // Seed for the game's random numbers
+
+        char * g_pstrSimInputFilename;                  // Input script, or NULL for random
+        SimInputStep g_SimInputSteps [ SIM_MAX_INPUT_STEP_COUNT ];  // The input script
+        int g_iSimInputStepCount;
+        int g_iCurrSimInputStep;                        // The next input step to play
+
+        unsigned int g_iSimInputRandState;              // Random input generator state
+
+        char * g_pstrSimRecordFilename;                 // WAV file to record the sound to, or
+                                                        // NULL
+
+        SimStats g_SimStats [ DROID_TYPE_COUNT ];       // Results, by enemy droid type
+
 // ---- Function Prototypes -------------------------------------------------------------------
 
     void Init ();
@@ -446,6 +578,11 @@
     void DrawGameScreen ();
     void DrawInterface ();
 
+    bool LoadSprite ( char * pstrFilename, W_Image * Sprite );
+
+    void ProfileSection ( int iSection, W_Int64 & iLastTime );
+    void WriteProfileReport ( char * pstrFilename );
+
     void InitRoom ( int iType );
     int IsRoomValid ( int iX, int iY );
 
@@ -465,11 +602,17 @@
     void GetDroidCenter ( Droid & CenterDroid, W_Point & Point );
     void SetDroidCenter ( Droid & CenterDroid, int iX, int iY );
 
+    void ResetDroidGrid ();
+    int GetDroidGridCoord ( int iPos, int iCellCount );
+    void UpdateDroidGridCell ( Droid & GridDroid );
+
     void ResetLasers ();
     void AddLaser ( int iX, int iY, int iDir, int iType, int iSpeed );
+    W_Image * GetLaserSprite ( int iLaser );
     void DrawLasers ();
     void UpdateLasers ();
-    void HandleLaserDroidCollision ( int iLaser, Droid & CollideDroid, int iDroidType );
+    int HandleLaserDroidCollision ( int iLaser, Droid & CollideDroid, int iDroidType );
+    int HandleLaserEnemyDroidCollisions ( int iLaser );
 
     void ResetExplosions ();
     void AddExplosion ( int iX, int iY );
@@ -486,8 +629,96 @@
     void HAPI_GetPlayerDroidX ( int iThreadIndex );
     void HAPI_GetPlayerDroidY ( int iThreadIndex );
 
+    #ifdef WRAPPUH_HEADLESS
+
+    int ReadSimSettings ( char * pstrCmdLine );
+    int LoadSimInput ( char * pstrFilename );
+    int GetSimInputRand ();
+    void GetNextSimInputStep ( int iStep, SimInputStep & Step );
+    void SetSimKeys ( int iKeys );
+    int RunSimRoom ( int iRoomX, int iRoomY );
+    void RunSimulation ();
+    void PrintSimReport ( W_Int64 iWallTime );
+
+    #endif
+
 // ---- Functions -----------------------------------------------------------------------------
 
+    /******************************************************************************************
+    *
+    *   ProfileSection ()
+    *
+    *   Adds the time since the last section ended to the specified section, and marks the
+    *   start of the next one.
+    */
+
+    void ProfileSection ( int iSection, W_Int64 & iLastTime )
+    {
+        W_Int64 iCurrTime = W_GetMicroTickCount ();
+
+        g_iProfileTimes [ iSection ] += iCurrTime - iLastTime;
+        iLastTime = iCurrTime;
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteProfileReport ()
+    *
+    *   Writes the average time each section took per gameplay frame to the specified file.
+    */
+
+    void WriteProfileReport ( char * pstrFilename )
+    {
+        if ( ! g_iProfileFrameCount )
+            return;
+
+        FILE * pReportFile = fopen ( pstrFilename, "w" );
+        if ( ! pReportFile )
+            return;
+
+        fprintf ( pReportFile, "Lockdown frame timing, averaged over %d gameplay frames\n\n", g_iProfileFrameCount );
+        fprintf ( pReportFile, "%-20s%12s%10s\n", "Section", "us/frame", "% frame" );
+
+        for ( int iCurrSection = 0; iCurrSection < PROFILE_SECTION_COUNT; ++ iCurrSection )
+        {
+            double dTime = ( double ) g_iProfileTimes [ iCurrSection ] / g_iProfileFrameCount;
+            double dShare = 0;
+
+            if ( g_iProfileTimes [ PROFILE_FRAME ] )
+                dShare = 100.0 * g_iProfileTimes [ iCurrSection ] / g_iProfileTimes [ PROFILE_FRAME ];
+
+            fprintf ( pReportFile, "%-20s%12.1f%9.1f%%\n", g_ppstrProfileSectionNames [ iCurrSection ], dTime, dShare );
+        }
+
+        // Add the frame pacing statistics, which include the time spent waiting on the FPS
+        // lock
+
+        W_FrameStats FrameStats;
+        W_GetFrameStats ( & FrameStats );
+
+        if ( FrameStats.iFrameCount )
+        {
+            fprintf ( pReportFile, "\nFrame pacing over the last %d frames (ms)\n\n", FrameStats.iFrameCount );
+            fprintf ( pReportFile, "%-20s%12.2f\n", "Mean", FrameStats.fMeanTime );
+            fprintf ( pReportFile, "%-20s%12.2f\n", "99th percentile", FrameStats.fP99Time );
+            fprintf ( pReportFile, "%-20s%12.2f\n", "Jitter", FrameStats.fJitter );
+        }
+
+        // Add how much of the screen the sprite batch redrew each frame
+
+        W_DirtyRectStats DirtyRectStats;
+        W_GetDirtyRectStats ( & DirtyRectStats );
+
+        if ( DirtyRectStats.iFrameCount )
+        {
+            fprintf ( pReportFile, "\nDirty rectangles over %d frames\n\n", DirtyRectStats.iFrameCount );
+            fprintf ( pReportFile, "%-20s%11.1f%%\n", "Pixels redrawn", DirtyRectStats.fMeanCoverage * 100 );
+            fprintf ( pReportFile, "%-20s%12d\n", "Full redraws", DirtyRectStats.iFullRedrawCount );
+        }
+
+        fclose ( pReportFile );
+    }
+
     /******************************************************************************************
     *
     *   ResetExplosions ()
@@ -495,12 +726,9 @@
     *   Clears all explosions.
     */
 
-    void ResetsExplosions ()
+    void ResetExplosions ()
     {
-        // Find the next free explosion
-
-        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
-            g_Explosions [ iCurrExplosion ].iIsActive = FALSE;
+        g_Explosions.iCount = 0;
     }
 
     /******************************************************************************************
@@ -512,35 +740,28 @@
 
     void AddExplosion ( int iX, int iY )
     {
-        // Find the next free explosion
+        // Make sure there's room for another explosion
 
-        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
-        {
-            // Is this explosion free?
-
-            if ( ! g_Explosions [ iCurrExplosion ].iIsActive )
-            {
-                // Set the explosion's location
+        if ( g_Explosions.iCount >= MAX_EXPLOSION_COUNT )
+            return;
 
-                g_Explosions [ iCurrExplosion ].iX = iX;
-                g_Explosions [ iCurrExplosion ].iY = iY;
+        // Add it to the end of the list
 
-                // Reset the explosion animation
+        int iNewExplosion = g_Explosions.iCount ++;
 
-                g_Explosions [ iCurrExplosion ].iCurrFrame = 0;
-                g_Explosions [ iCurrExplosion ].iLastFrameUpdateTime = W_GetTickCount ();
+        // Set the explosion's location
 
-                // Activate the explosion
+        g_Explosions.iX [ iNewExplosion ] = iX;
+        g_Explosions.iY [ iNewExplosion ] = iY;
 
-                g_Explosions [ iCurrExplosion ].iIsActive = TRUE;
+        // Reset the explosion animation
 
-                // Play the explosion sound
+        g_Explosions.iCurrFrame [ iNewExplosion ] = 0;
+        g_Explosions.iLastFrameUpdateTime [ iNewExplosion ] = W_GetTickCount ();
 
-                W_PlaySound ( g_ExplosionSound );
+        // Play the explosion sound
 
-                break;
-            }
-        }
+        W_PlaySound ( g_ExplosionSound );
     }
 
     /******************************************************************************************
@@ -552,19 +773,14 @@
 
     void DrawExplosions ()
     {
-        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
+        for ( int iCurrExplosion = 0; iCurrExplosion < g_Explosions.iCount; ++ iCurrExplosion )
         {
-            // Is this explosion active?
-
-            if ( g_Explosions [ iCurrExplosion ].iIsActive )
-            {
-                W_Image * CurrFrame = & g_ExplosionAnim [ g_Explosions [ iCurrExplosion ].iCurrFrame ];
+            W_Image * CurrFrame = & g_ExplosionAnim [ g_Explosions.iCurrFrame [ iCurrExplosion ] ];
 
-                int iX = g_Explosions [ iCurrExplosion ].iX - EXPLOSION_ANIM_WIDTH / 2;
-                int iY = g_Explosions [ iCurrExplosion ].iY - EXPLOSION_ANIM_HEIGHT / 2;
+            int iX = g_Explosions.iX [ iCurrExplosion ] - EXPLOSION_ANIM_WIDTH / 2;
+            int iY = g_Explosions.iY [ iCurrExplosion ] - EXPLOSION_ANIM_HEIGHT / 2;
 
-                W_BlitImage ( * CurrFrame, iX, iY );
-            }
+            W_BatchImage ( * CurrFrame, iX, iY, LAYER_EXPLOSIONS );
         }
     }
 
@@ -577,28 +793,46 @@
 
     void UpdateExplosions ()
     {
-        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
+        unsigned int iTickCount = W_GetTickCount ();
+
+        // Move each explosion whose animation timer has elapsed to its next frame, and count
+        // the ones that have finished
+
+        int iFinishedCount = 0;
+
+        int iCurrExplosion;
+        for ( iCurrExplosion = 0; iCurrExplosion < g_Explosions.iCount; ++ iCurrExplosion )
         {
-            // Is this explosion active?
+            int iIsFrameDone = iTickCount > g_Explosions.iLastFrameUpdateTime [ iCurrExplosion ] + EXPLOSION_ANIM_SPEED;
 
-            if ( g_Explosions [ iCurrExplosion ].iIsActive )
-            {
-                // If the animation timer has elapsed, update the frame
+            g_Explosions.iCurrFrame [ iCurrExplosion ] += iIsFrameDone;
+            g_Explosions.iLastFrameUpdateTime [ iCurrExplosion ] = iIsFrameDone ? iTickCount : g_Explosions.iLastFrameUpdateTime [ iCurrExplosion ];
 
-                if ( W_GetTickCount () > g_Explosions [ iCurrExplosion ].iLastFrameUpdateTime + EXPLOSION_ANIM_SPEED )
-                {
-                    // Move to the next frame and reset the animation timer
+            iFinishedCount += g_Explosions.iCurrFrame [ iCurrExplosion ] >= EXPLOSION_ANIM_FRAME_COUNT;
+        }
+
+        if ( ! iFinishedCount )
+            return;
 
-                    ++ g_Explosions [ iCurrExplosion ].iCurrFrame;
-                    g_Explosions [ iCurrExplosion ].iLastFrameUpdateTime = W_GetTickCount ();
+        // Remove the finished explosions, packing the rest down so they're still drawn in the
+        // order they started
 
-                    // If the animation is complete, kill the explosion
+        int iLiveCount = 0;
 
-                    if ( g_Explosions [ iCurrExplosion ].iCurrFrame >= EXPLOSION_ANIM_FRAME_COUNT )
-                        g_Explosions [ iCurrExplosion ].iIsActive = FALSE;
-                }
-            }
+        for ( iCurrExplosion = 0; iCurrExplosion < g_Explosions.iCount; ++ iCurrExplosion )
+        {
+            if ( g_Explosions.iCurrFrame [ iCurrExplosion ] >= EXPLOSION_ANIM_FRAME_COUNT )
+                continue;
+
+            g_Explosions.iX [ iLiveCount ] = g_Explosions.iX [ iCurrExplosion ];
+            g_Explosions.iY [ iLiveCount ] = g_Explosions.iY [ iCurrExplosion ];
+            g_Explosions.iCurrFrame [ iLiveCount ] = g_Explosions.iCurrFrame [ iCurrExplosion ];
+            g_Explosions.iLastFrameUpdateTime [ iLiveCount ] = g_Explosions.iLastFrameUpdateTime [ iCurrExplosion ];
+
+            ++ iLiveCount;
         }
+
+        g_Explosions.iCount = iLiveCount;
     }
 
     /******************************************************************************************
@@ -610,72 +844,93 @@
 
     void AddLaser ( int iX, int iY, int iDir, int iType, int iSpeed )
     {
-        for ( int iCurrLaser = 0; iCurrLaser < MAX_LASER_COUNT; ++ iCurrLaser )
-        {
-            if ( ! g_Lasers [ iCurrLaser ].iIsActive )
-            {
-                switch ( iDir )
-                {
-                    case NORTH:
-                        iDir = STRAIGHT_NORTH;
-                        break;
+        // Make sure there's room for another laser
+
+        if ( g_Lasers.iCount >= MAX_LASER_COUNT )
+            return;
 
-                    case SOUTH:
-                        iDir = STRAIGHT_SOUTH;
-                        break;
+        // Convert the direction to a straight direction and work out the velocity
 
-                    case EAST:
-                        iDir = STRAIGHT_EAST;
-                        break;
+        int iXVel = 0,
+            iYVel = 0;
 
-                    case WEST:
-                        iDir = STRAIGHT_WEST;
-                        break;
-                }
+        switch ( iDir )
+        {
+            case NORTH:
+                iDir = STRAIGHT_NORTH;
+                iYVel = -iSpeed;
+                break;
 
-                // Set the X, Y location
+            case SOUTH:
+                iDir = STRAIGHT_SOUTH;
+                iYVel = iSpeed;
+                break;
 
-                g_Lasers [ iCurrLaser ].iX = iX;
-                g_Lasers [ iCurrLaser ].iY = iY;
+            case EAST:
+                iDir = STRAIGHT_EAST;
+                iXVel = iSpeed;
+                break;
 
-                // Set the direction, speed and type
+            case WEST:
+                iDir = STRAIGHT_WEST;
+                iXVel = -iSpeed;
+                break;
+        }
 
-                g_Lasers [ iCurrLaser ].iDir = iDir;
-                g_Lasers [ iCurrLaser ].iType = iType;
-                g_Lasers [ iCurrLaser ].iSpeed = iSpeed;
+        // Add it to the end of the list
 
-                // Initialize the animation
+        int iNewLaser = g_Lasers.iCount ++;
 
-                g_Lasers [ iCurrLaser ].iCurrFrame = 0;
-                g_Lasers [ iCurrLaser ].iLastFrameUpdateTime = W_GetTickCount ();
+        // Set the X, Y location and velocity
 
-                // Activate the laser
+        g_Lasers.iX [ iNewLaser ] = iX;
+        g_Lasers.iY [ iNewLaser ] = iY;
+        g_Lasers.iXVel [ iNewLaser ] = iXVel;
+        g_Lasers.iYVel [ iNewLaser ] = iYVel;
 
-                g_Lasers [ iCurrLaser ].iIsActive = TRUE;
+        // Set the direction and type
 
-                // Play sound
+        g_Lasers.iDir [ iNewLaser ] = iDir;
+        g_Lasers.iType [ iNewLaser ] = iType;
 
-                if ( iType == LASER_TYPE_PLAYER )
-                    W_PlaySound ( g_PlayerLaserSound );
-                else
-                    W_PlaySound ( g_EnemyLaserSound );
+        // Initialize the animation
 
-                break;
-            }
-        }
+        g_Lasers.iCurrFrame [ iNewLaser ] = 0;
+        g_Lasers.iLastFrameUpdateTime [ iNewLaser ] = W_GetTickCount ();
+
+        // Play sound
+
+        if ( iType == LASER_TYPE_PLAYER )
+            W_PlaySound ( g_PlayerLaserSound );
+        else
+            W_PlaySound ( g_EnemyLaserSound );
     }
 
     /******************************************************************************************
     *
     *   ResetLasers ()
     *
-    *   Clears the laser array.
+    *   Clears the laser list.
     */
 
     void ResetLasers ()
     {
-        for ( int iCurrLaser = 0; iCurrLaser < MAX_LASER_COUNT; ++ iCurrLaser )
-            g_Lasers [ iCurrLaser ].iIsActive = FALSE;
+        g_Lasers.iCount = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetLaserSprite ()
+    *
+    *   Returns the current animation frame of a laser.
+    */
+
+    W_Image * GetLaserSprite ( int iLaser )
+    {
+        if ( g_Lasers.iType [ iLaser ] == LASER_TYPE_PLAYER )
+            return & g_PlayerLaserAnims [ g_Lasers.iDir [ iLaser ] ][ g_Lasers.iCurrFrame [ iLaser ] ];
+        else
+            return & g_EnemyLaserAnims [ g_Lasers.iDir [ iLaser ] ][ g_Lasers.iCurrFrame [ iLaser ] ];
     }
 
     /******************************************************************************************
@@ -687,61 +942,29 @@
 
     void DrawLasers ()
     {
-        for ( int iCurrLaser = 0; iCurrLaser < MAX_LASER_COUNT; ++ iCurrLaser )
-        {
-            if ( g_Lasers [ iCurrLaser ].iIsActive )
-            {
-                // Determine which laser sprite to use
+        int iCurrLaser;
 
-                W_Image * LaserSprite = NULL;
-                switch ( g_Lasers [ iCurrLaser ].iDir )
-                {
-                    case STRAIGHT_NORTH:
-                        if ( g_Lasers [ iCurrLaser ].iType == LASER_TYPE_PLAYER )
-                            LaserSprite = & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        else
-                            LaserSprite = & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        break;
-
-                    case STRAIGHT_SOUTH:
-                        if ( g_Lasers [ iCurrLaser ].iType == LASER_TYPE_PLAYER )
-                            LaserSprite = & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        else
-                            LaserSprite = & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        break;
-
-                    case STRAIGHT_EAST:
-                        if ( g_Lasers [ iCurrLaser ].iType == LASER_TYPE_PLAYER )
-                            LaserSprite = & g_PlayerLaserAnims [ STRAIGHT_EAST ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        else
-                            LaserSprite = & g_EnemyLaserAnims [ STRAIGHT_EAST ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        break;
+        // Draw the lasers
 
-                    case STRAIGHT_WEST:
-                        if ( g_Lasers [ iCurrLaser ].iType == LASER_TYPE_PLAYER )
-                            LaserSprite = & g_PlayerLaserAnims [ STRAIGHT_WEST ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        else
-                            LaserSprite = & g_EnemyLaserAnims [ STRAIGHT_WEST ][ g_Lasers [ iCurrLaser ].iCurrFrame ];
-                        break;
-                }
+        for ( iCurrLaser = 0; iCurrLaser < g_Lasers.iCount; ++ iCurrLaser )
+        {
+            W_Image * LaserSprite = GetLaserSprite ( iCurrLaser );
 
-                // Update the laser animation
+            W_BatchImage ( * LaserSprite, g_Lasers.iX [ iCurrLaser ] - LaserSprite->ClipRect.iX0, g_Lasers.iY [ iCurrLaser ] - LaserSprite->ClipRect.iY0, LAYER_LASERS );
+        }
 
-                if ( W_GetTickCount () - g_Lasers [ iCurrLaser ].iLastFrameUpdateTime > LASER_ANIM_SPEED )
-                {
-                    // Move to the next frame if the animation isn't finished
+        // Move each laser animation whose timer has elapsed to its next frame, unless it's
+        // already finished
 
-                    if ( g_Lasers [ iCurrLaser ].iCurrFrame < LASER_ANIM_FRAME_COUNT - 1 )
-                    {
-                        ++ g_Lasers [ iCurrLaser ].iCurrFrame;
-                        g_Lasers [ iCurrLaser ].iLastFrameUpdateTime = W_GetTickCount ();
-                    }
-                }
+        unsigned int iTickCount = W_GetTickCount ();
 
-                // Draw the laser
+        for ( iCurrLaser = 0; iCurrLaser < g_Lasers.iCount; ++ iCurrLaser )
+        {
+            int iIsFrameDone = iTickCount - g_Lasers.iLastFrameUpdateTime [ iCurrLaser ] > LASER_ANIM_SPEED &&
+                               g_Lasers.iCurrFrame [ iCurrLaser ] < LASER_ANIM_FRAME_COUNT - 1;
 
-                W_BlitImage ( * LaserSprite, g_Lasers [ iCurrLaser ].iX - LaserSprite->ClipRect.iX0, g_Lasers [ iCurrLaser ].iY - LaserSprite->ClipRect.iY0 );
-            }
+            g_Lasers.iCurrFrame [ iCurrLaser ] += iIsFrameDone;
+            g_Lasers.iLastFrameUpdateTime [ iCurrLaser ] = iIsFrameDone ? iTickCount : g_Lasers.iLastFrameUpdateTime [ iCurrLaser ];
         }
     }
 
@@ -754,66 +977,72 @@
 
     void UpdateLasers ()
     {
-        for ( int iCurrLaser = 0; iCurrLaser < MAX_LASER_COUNT; ++ iCurrLaser )
+        int iCurrLaser;
+
+        // Move the lasers along their paths
+
+        for ( iCurrLaser = 0; iCurrLaser < g_Lasers.iCount; ++ iCurrLaser )
         {
-            if ( g_Lasers [ iCurrLaser ].iIsActive )
-            {
-                // Move the laser along its path
+            g_Lasers.iX [ iCurrLaser ] += g_Lasers.iXVel [ iCurrLaser ];
+            g_Lasers.iY [ iCurrLaser ] += g_Lasers.iYVel [ iCurrLaser ];
+        }
 
-                switch ( g_Lasers [ iCurrLaser ].iDir )
-                {
-                    case STRAIGHT_NORTH:
-                        g_Lasers [ iCurrLaser ].iY -= g_Lasers [ iCurrLaser ].iSpeed;
-                        break;
+        // Check for collisions between lasers and droids, and remove the lasers that hit
+        // something or moved beyond the bounds of the screen. The rest are packed down so
+        // they stay in the order they were fired.
 
-                    case STRAIGHT_SOUTH:
-                        g_Lasers [ iCurrLaser ].iY += g_Lasers [ iCurrLaser ].iSpeed;
-                        break;
+        int iXMax = W_GetScreenXMax (),
+            iYMax = W_GetScreenYMax ();
 
-                    case STRAIGHT_EAST:
-                        g_Lasers [ iCurrLaser ].iX += g_Lasers [ iCurrLaser ].iSpeed;
-                        break;
+        int iLiveCount = 0;
 
-                    case STRAIGHT_WEST:
-                        g_Lasers [ iCurrLaser ].iX -= g_Lasers [ iCurrLaser ].iSpeed;
-                        break;
-                }
+        for ( iCurrLaser = 0; iCurrLaser < g_Lasers.iCount; ++ iCurrLaser )
+        {
+            int iIsDead = g_Lasers.iX [ iCurrLaser ] < 0 || g_Lasers.iX [ iCurrLaser ] > iXMax ||
+                          g_Lasers.iY [ iCurrLaser ] < 0 || g_Lasers.iY [ iCurrLaser ] > iYMax;
 
-                // Deactivate the laser if it moves beyond the bounds of the screen
+            // A laser that just left the screen can still hit a droid on its way out
 
-                if ( g_Lasers [ iCurrLaser ].iX < 0 || g_Lasers [ iCurrLaser ].iX > W_GetScreenXMax () ||
-                     g_Lasers [ iCurrLaser ].iY < 0 || g_Lasers [ iCurrLaser ].iY > W_GetScreenYMax () )
-                    g_Lasers [ iCurrLaser ].iIsActive = FALSE;
+            if ( HandleLaserEnemyDroidCollisions ( iCurrLaser ) )
+                iIsDead = TRUE;
 
-                // Check for collisions between lasers and droids
+            if ( HandleLaserDroidCollision ( iCurrLaser, g_Player.Droid, DROID_TYPE_PLAYER ) )
+                iIsDead = TRUE;
 
-                for ( int iCurrDroid = 0; iCurrDroid < ENEMY_DROID_COUNT; ++ iCurrDroid )
-                    HandleLaserDroidCollision ( iCurrLaser, g_EnemyDroids [ iCurrDroid ], DROID_TYPE_ENEMY );
+            if ( iIsDead )
+                continue;
 
-                HandleLaserDroidCollision ( iCurrLaser, g_Player.Droid, DROID_TYPE_PLAYER );
-            }
+            g_Lasers.iX [ iLiveCount ] = g_Lasers.iX [ iCurrLaser ];
+            g_Lasers.iY [ iLiveCount ] = g_Lasers.iY [ iCurrLaser ];
+            g_Lasers.iXVel [ iLiveCount ] = g_Lasers.iXVel [ iCurrLaser ];
+            g_Lasers.iYVel [ iLiveCount ] = g_Lasers.iYVel [ iCurrLaser ];
+            g_Lasers.iDir [ iLiveCount ] = g_Lasers.iDir [ iCurrLaser ];
+            g_Lasers.iType [ iLiveCount ] = g_Lasers.iType [ iCurrLaser ];
+            g_Lasers.iCurrFrame [ iLiveCount ] = g_Lasers.iCurrFrame [ iCurrLaser ];
+            g_Lasers.iLastFrameUpdateTime [ iLiveCount ] = g_Lasers.iLastFrameUpdateTime [ iCurrLaser ];
+
+            ++ iLiveCount;
         }
+
+        g_Lasers.iCount = iLiveCount;
     }
 
     /******************************************************************************************
     *
     *   HandleLaserDroidCollision ()
     *
-    *   Handles a laser/droid collision.
+    *   Handles a laser/droid collision. Returns TRUE if the laser hit the droid.
     */
 
-    void HandleLaserDroidCollision ( int iLaser, Droid & CollideDroid, int iDroidType )
+    int HandleLaserDroidCollision ( int iLaser, Droid & CollideDroid, int iDroidType )
     {
         W_Rect LaserSpriteRect;
         W_Rect LaserRect;
 
-        if ( g_Lasers [ iLaser ].iType == LASER_TYPE_PLAYER )
-            LaserSpriteRect = g_PlayerLaserAnims [ g_Lasers [ iLaser ].iDir ][ g_Lasers [ iLaser ].iCurrFrame ].ClipRect;
-        else
-            LaserSpriteRect = g_EnemyLaserAnims [ g_Lasers [ iLaser ].iDir ][ g_Lasers [ iLaser ].iCurrFrame ].ClipRect;
+        LaserSpriteRect = GetLaserSprite ( iLaser )->ClipRect;
 
-        LaserRect.iX0 = g_Lasers [ iLaser ].iX;
-        LaserRect.iY0 = g_Lasers [ iLaser ].iY;
+        LaserRect.iX0 = g_Lasers.iX [ iLaser ];
+        LaserRect.iY0 = g_Lasers.iY [ iLaser ];
         LaserRect.iX1 = LaserRect.iX0 + LaserSpriteRect.iX1;
         LaserRect.iY1 = LaserRect.iY0 + LaserSpriteRect.iY1;
 
@@ -829,12 +1058,89 @@
             DroidRect.iX1 = DroidRect.iX0 + DroidSpriteRect.iX1;
             DroidRect.iY1 = DroidRect.iY0 + DroidSpriteRect.iY1;
 
-            if ( W_DoRectsIntersect ( & LaserRect, & DroidRect ) && g_Lasers [ iLaser ].iType != iDroidType )
+            if ( W_DoRectsIntersect ( & LaserRect, & DroidRect ) && g_Lasers.iType [ iLaser ] != iDroidType )
             {
                 DamageDroid ( CollideDroid, LASER_DAMAGE );
-                g_Lasers [ iLaser ].iIsActive = FALSE;
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    /******************************************************************************************
+    *
+    *   HandleLaserEnemyDroidCollisions ()
+    *
+    *   Handles collisions between a laser and the enemy droids, using the droid grid to skip
+    *   the droids that are too far away to be hit. The droids that might be hit are tested in
+    *   index order, just as if every droid had been tested, so the results are the same.
+    *   Returns TRUE if the laser hit any of them.
+    */
+
+    int HandleLaserEnemyDroidCollisions ( int iLaser )
+    {
+        // Only lasers that aren't the enemy's own can hit an enemy droid
+
+        if ( g_Lasers.iType [ iLaser ] == DROID_TYPE_ENEMY )
+            return FALSE;
+
+        W_Rect LaserSpriteRect = GetLaserSprite ( iLaser )->ClipRect;
+
+        // Add the laser's share of the reach to the droids'
+
+        int iHalfWidth = LaserSpriteRect.iX1 > 0 ? LaserSpriteRect.iX1 >> 1 : 0,
+            iHalfHeight = LaserSpriteRect.iY1 > 0 ? LaserSpriteRect.iY1 >> 1 : 0;
+
+        int iReachX = g_iDroidGridReachX + iHalfWidth + ( iHalfWidth >> 1 ),
+            iReachY = g_iDroidGridReachY + iHalfHeight + ( iHalfHeight >> 1 );
+
+        // Collect the droids in the cells within reach
+
+        int iX0 = GetDroidGridCoord ( g_Lasers.iX [ iLaser ] - iReachX, DROID_GRID_WIDTH ),
+            iY0 = GetDroidGridCoord ( g_Lasers.iY [ iLaser ] - iReachY, DROID_GRID_HEIGHT ),
+            iX1 = GetDroidGridCoord ( g_Lasers.iX [ iLaser ] + iReachX, DROID_GRID_WIDTH ),
+            iY1 = GetDroidGridCoord ( g_Lasers.iY [ iLaser ] + iReachY, DROID_GRID_HEIGHT );
+
+        int iCandidates [ ENEMY_DROID_COUNT ];
+        int iCandidateCount = 0;
+
+        for ( int iCurrY = iY0; iCurrY <= iY1; ++ iCurrY )
+        {
+            for ( int iCurrX = iX0; iCurrX <= iX1; ++ iCurrX )
+            {
+                int iCurrDroid = g_iDroidGrid [ iCurrY * DROID_GRID_WIDTH + iCurrX ];
+
+                while ( iCurrDroid != -1 )
+                {
+                    // Insert it in index order
+
+                    int iCurrCandidate = iCandidateCount;
+
+                    while ( iCurrCandidate > 0 && iCandidates [ iCurrCandidate - 1 ] > iCurrDroid )
+                    {
+                        iCandidates [ iCurrCandidate ] = iCandidates [ iCurrCandidate - 1 ];
+                        -- iCurrCandidate;
+                    }
+
+                    iCandidates [ iCurrCandidate ] = iCurrDroid;
+                    ++ iCandidateCount;
+
+                    iCurrDroid = g_iDroidGridNext [ iCurrDroid ];
+                }
             }
         }
+
+        // Test the laser against each of them. A laser that hits one droid can still hit
+        // others it overlaps in the same frame.
+
+        int iIsHit = FALSE;
+
+        for ( int iCurrCandidate = 0; iCurrCandidate < iCandidateCount; ++ iCurrCandidate )
+            if ( HandleLaserDroidCollision ( iLaser, g_EnemyDroids [ iCandidates [ iCurrCandidate ] ], DROID_TYPE_ENEMY ) )
+                iIsHit = TRUE;
+
+        return iIsHit;
     }
 
     /******************************************************************************************
@@ -859,6 +1165,10 @@
         // Activate the droid
 
         NewDroid.iIsActive = TRUE;
+
+        // Put it in the droid grid
+
+        UpdateDroidGridCell ( NewDroid );
     }
 
     /******************************************************************************************
@@ -916,8 +1226,8 @@
         // Draw the droid
 
         W_Image * DroidSprite = & g_Droids [ DrawDroid.iType ][ DrawDroid.iDir ];
-        W_BlitImage ( * DroidSprite,
-                      DrawDroid.iX + iRattleX - DroidSprite->ClipRect.iX0, DrawDroid.iY + iRattleY - DroidSprite->ClipRect.iY0 );
+        W_BatchImage ( * DroidSprite,
+                       DrawDroid.iX + iRattleX - DroidSprite->ClipRect.iX0, DrawDroid.iY + iRattleY - DroidSprite->ClipRect.iY0, LAYER_DROIDS );
     }
 
     /******************************************************************************************
@@ -1212,6 +1522,10 @@
                 MoveDroid.iY = iPrevY;
             }
         }
+
+        // Move it to its new cell in the droid grid
+
+        UpdateDroidGridCell ( MoveDroid );
     }
 
     /******************************************************************************************
@@ -1326,15 +1640,133 @@
     *   Moves a droid to the specified location by its center.
     */
 
-    void SetDroidCenter ( Droid & CenterDroid, int iX, int iY )
-    {
-        W_Image * DroidSprite = & g_Droids [ CenterDroid.iType ][ CenterDroid.iDir ];
+    void SetDroidCenter ( Droid & CenterDroid, int iX, int iY )
+    {
+        W_Image * DroidSprite = & g_Droids [ CenterDroid.iType ][ CenterDroid.iDir ];
+
+        if ( iX != -1 )
+            CenterDroid.iX = iX - DroidSprite->ClipRect.iX1 / 2;
+
+        if ( iY != -1 )
+            CenterDroid.iY = iY - DroidSprite->ClipRect.iY1 / 2;
+
+        UpdateDroidGridCell ( CenterDroid );
+    }
+
+    /******************************************************************************************
+    *
+    *   ResetDroidGrid ()
+    *
+    *   Empties the droid grid and works out how far the droids can reach from their cells.
+    *
+    *   W_DoRectsIntersect () puts each rectangle's center a quarter of the way across it, and
+    *   reports a hit when the centers are closer than the sum of the half-widths. A droid
+    *   with half-width H can therefore only hit something whose corner is within H + H / 2 of
+    *   its own, so the widest droid sprite bounds how far from a laser a droid can be.
+    */
+
+    void ResetDroidGrid ()
+    {
+        int iCurrCell;
+        for ( iCurrCell = 0; iCurrCell < DROID_GRID_HEIGHT * DROID_GRID_WIDTH; ++ iCurrCell )
+            g_iDroidGrid [ iCurrCell ] = -1;
+
+        int iCurrDroid;
+        for ( iCurrDroid = 0; iCurrDroid < ENEMY_DROID_COUNT; ++ iCurrDroid )
+        {
+            g_iDroidGridCell [ iCurrDroid ] = -1;
+            g_iDroidGridNext [ iCurrDroid ] = -1;
+            g_iDroidGridPrev [ iCurrDroid ] = -1;
+        }
+
+        int iMaxHalfWidth = 0,
+            iMaxHalfHeight = 0;
+
+        for ( int iCurrType = 0; iCurrType < DROID_TYPE_COUNT; ++ iCurrType )
+        {
+            for ( int iCurrDir = 0; iCurrDir < DIR_COUNT; ++ iCurrDir )
+            {
+                W_Image * DroidSprite = & g_Droids [ iCurrType ][ iCurrDir ];
+
+                if ( ( DroidSprite->ClipRect.iX1 >> 1 ) > iMaxHalfWidth )
+                    iMaxHalfWidth = DroidSprite->ClipRect.iX1 >> 1;
+
+                if ( ( DroidSprite->ClipRect.iY1 >> 1 ) > iMaxHalfHeight )
+                    iMaxHalfHeight = DroidSprite->ClipRect.iY1 >> 1;
+            }
+        }
+
+        g_iDroidGridReachX = iMaxHalfWidth + ( iMaxHalfWidth >> 1 );
+        g_iDroidGridReachY = iMaxHalfHeight + ( iMaxHalfHeight >> 1 );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetDroidGridCoord ()
+    *
+    *   Returns the grid column or row a position falls in. Positions off the edge of the grid
+    *   are put in the edge cells.
+    */
+
+    int GetDroidGridCoord ( int iPos, int iCellCount )
+    {
+        if ( iPos < 0 )
+            return 0;
+
+        int iCoord = iPos / DROID_GRID_CELL_SIZE;
+
+        if ( iCoord >= iCellCount )
+            return iCellCount - 1;
+
+        return iCoord;
+    }
+
+    /******************************************************************************************
+    *
+    *   UpdateDroidGridCell ()
+    *
+    *   Moves an enemy droid to the cell its position is in, if it's not already there. The
+    *   player's droid isn't kept in the grid.
+    */
+
+    void UpdateDroidGridCell ( Droid & GridDroid )
+    {
+        // Make sure it's an enemy droid
+
+        if ( & GridDroid < g_EnemyDroids || & GridDroid >= g_EnemyDroids + ENEMY_DROID_COUNT )
+            return;
+
+        int iDroid = & GridDroid - g_EnemyDroids;
+
+        int iCell = GetDroidGridCoord ( GridDroid.iY, DROID_GRID_HEIGHT ) * DROID_GRID_WIDTH +
+                    GetDroidGridCoord ( GridDroid.iX, DROID_GRID_WIDTH );
+
+        if ( iCell == g_iDroidGridCell [ iDroid ] )
+            return;
+
+        // Unlink it from its old cell
+
+        if ( g_iDroidGridCell [ iDroid ] != -1 )
+        {
+            if ( g_iDroidGridPrev [ iDroid ] != -1 )
+                g_iDroidGridNext [ g_iDroidGridPrev [ iDroid ] ] = g_iDroidGridNext [ iDroid ];
+            else
+                g_iDroidGrid [ g_iDroidGridCell [ iDroid ] ] = g_iDroidGridNext [ iDroid ];
+
+            if ( g_iDroidGridNext [ iDroid ] != -1 )
+                g_iDroidGridPrev [ g_iDroidGridNext [ iDroid ] ] = g_iDroidGridPrev [ iDroid ];
+        }
 
-        if ( iX != -1 )
-            CenterDroid.iX = iX - DroidSprite->ClipRect.iX1 / 2;
+        // Link it to the head of the new one
 
-        if ( iY != -1 )
-            CenterDroid.iY = iY - DroidSprite->ClipRect.iY1 / 2;
+        g_iDroidGridCell [ iDroid ] = iCell;
+        g_iDroidGridPrev [ iDroid ] = -1;
+        g_iDroidGridNext [ iDroid ] = g_iDroidGrid [ iCell ];
+
+        if ( g_iDroidGrid [ iCell ] != -1 )
+            g_iDroidGridPrev [ g_iDroidGrid [ iCell ] ] = iDroid;
+
+        g_iDroidGrid [ iCell ] = iDroid;
     }
 
     /******************************************************************************************
@@ -1387,7 +1819,7 @@
         // Clear any remaining lasers and explosions from the last room
 
         ResetLasers ();
-        ResetsExplosions ();
+        ResetExplosions ();
 
         // ---- Initialize the droid population
 
@@ -1628,16 +2060,16 @@
             iLightFlag = LIGHTS_OFF;
 
         if ( g_CurrRoom.Doors [ STRAIGHT_NORTH ].iState != DOOR_STATE_CLOSED )
-            W_BlitImage ( g_DoorAnims [ STRAIGHT_NORTH ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_NORTH ].iCurrFrame ], 270, 0 );
+            W_BatchImage ( g_DoorAnims [ STRAIGHT_NORTH ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_NORTH ].iCurrFrame ], 270, 0, LAYER_ROOM );
 
         if ( g_CurrRoom.Doors [ STRAIGHT_SOUTH ].iState != DOOR_STATE_CLOSED )
-            W_BlitImage ( g_DoorAnims [ STRAIGHT_SOUTH ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_SOUTH ].iCurrFrame ], 270, 431 );
+            W_BatchImage ( g_DoorAnims [ STRAIGHT_SOUTH ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_SOUTH ].iCurrFrame ], 270, 431, LAYER_ROOM );
 
         if ( g_CurrRoom.Doors [ STRAIGHT_EAST ].iState != DOOR_STATE_CLOSED )
-            W_BlitImage ( g_DoorAnims [ STRAIGHT_EAST ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_EAST ].iCurrFrame ], 591, 191 );
+            W_BatchImage ( g_DoorAnims [ STRAIGHT_EAST ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_EAST ].iCurrFrame ], 591, 191, LAYER_ROOM );
 
         if ( g_CurrRoom.Doors [ STRAIGHT_WEST ].iState != DOOR_STATE_CLOSED )
-            W_BlitImage ( g_DoorAnims [ STRAIGHT_WEST ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_WEST ].iCurrFrame ], 0, 191 );
+            W_BatchImage ( g_DoorAnims [ STRAIGHT_WEST ][ iLightFlag ][ g_CurrRoom.Doors [ STRAIGHT_WEST ].iCurrFrame ], 0, 191, LAYER_ROOM );
     }
 
     /******************************************************************************************
@@ -1722,7 +2154,7 @@
 
         // Draw the key
 
-        W_BlitImage ( g_KeyAnims [ g_Key.iColor ][ g_Key.iCurrFrame ], g_Key.iX, g_Key.iY - iFloatOffsetY );
+        W_BatchImage ( g_KeyAnims [ g_Key.iColor ][ g_Key.iCurrFrame ], g_Key.iX, g_Key.iY - iFloatOffsetY, LAYER_KEY );
 
         // Update the animation
 
@@ -1751,7 +2183,7 @@
     {
         // Draw the energy frame
 
-        W_BlitImage ( g_EnergyFrame, 21, 43 );
+        W_BatchImage ( g_EnergyFrame, 21, 43, LAYER_INTERFACE );
 
         // Draw the energy bars
 
@@ -1778,16 +2210,16 @@
         for ( int iCurrBar = 0; iCurrBar < MAX_ENERGY; ++ iCurrBar )
         {
             if ( iCurrBar + 1 > g_Player.Droid.fEnergy )
-                W_BlitImage ( * pEnergyBarClear, iCurrBarX, 19 );
+                W_BatchImage ( * pEnergyBarClear, iCurrBarX, 19, LAYER_INTERFACE );
             else
-                W_BlitImage ( * pEnergyBarFull, iCurrBarX, 19 );
+                W_BatchImage ( * pEnergyBarFull, iCurrBarX, 19, LAYER_INTERFACE );
 
             iCurrBarX += ENERGY_BAR_WIDTH + 2;
         }
 
         // Draw the key frame
 
-        W_BlitImage ( g_KeysFrame, 470, 43 );
+        W_BatchImage ( g_KeysFrame, 470, 43, LAYER_INTERFACE );
 
         // Draw the key icons
 
@@ -1795,9 +2227,9 @@
         for ( int iCurrKey = 0; iCurrKey < KEY_COUNT; ++ iCurrKey )
         {
             if ( g_Player.iKeys [ iCurrKey ] )
-                W_BlitImage ( g_KeyIcons [ iCurrKey ], iCurrKeyIconX, 19 );
+                W_BatchImage ( g_KeyIcons [ iCurrKey ], iCurrKeyIconX, 19, LAYER_INTERFACE );
             else
-                W_BlitImage ( g_KeyIconsEmpty [ iCurrKey ], iCurrKeyIconX, 19 );
+                W_BatchImage ( g_KeyIconsEmpty [ iCurrKey ], iCurrKeyIconX, 19, LAYER_INTERFACE );
             iCurrKeyIconX += KEY_ICON_WIDTH + 2;
         }
     }
@@ -1811,7 +2243,19 @@
 
     void DrawGameScreen ()
     {
-        // ---- Draw the current room background
+        W_Int64 iProfileTime = W_GetMicroTickCount ();
+
+        ++ g_iProfileFrameCount;
+
+        // ---- Start the sprite batch
+
+        // Everything drawn over the background goes into the batch, and is blitted once the
+        // whole frame has been added to it. The background is drawn with the batch, so only
+        // the parts of the room that the sprites have changed need redrawing.
+
+        W_BeginSpriteBatch ();
+
+        // ---- Set the current room background
 
         switch ( g_iRooms [ g_Player.iRoomX ][ g_Player.iRoomY ] )
         {
@@ -1824,9 +2268,9 @@
                 // bitmap colors line up)
 
                 if ( g_CurrRoom.iLights == LIGHTS_ON )
-                    W_BlitImage ( g_NormalRoomOn, 0, 0 );
+                    W_SetBatchBackground ( g_NormalRoomOn );
                 else
-                    W_BlitImage ( g_NormalRoomOff, 0, 0 );
+                    W_SetBatchBackground ( g_NormalRoomOff );
 
                 break;
             
@@ -1835,9 +2279,9 @@
             case ROOM_TYPE_PEDESTAL:
 
                 if ( g_CurrRoom.iLights == LIGHTS_ON )
-                    W_BlitImage ( g_PedestalRoomOn, 0, 0 );
+                    W_SetBatchBackground ( g_PedestalRoomOn );
                 else
-                    W_BlitImage ( g_PedestalRoomOff, 0, 0 );
+                    W_SetBatchBackground ( g_PedestalRoomOff );
 
                break;
 
@@ -1845,21 +2289,21 @@
 
             case ROOM_TYPE_KEY:
 
-               W_BlitImage ( g_KeyRoom, 0, 0 );
+               W_SetBatchBackground ( g_KeyRoom );
 
                // Draw the key panels
 
                if ( g_Player.iActiveKeyPanels [ RED ] )
-                   W_BlitImage ( g_KeyPanels [ RED ], KEY_PANEL_RED_X, KEY_PANEL_RED_Y );
+                   W_BatchImage ( g_KeyPanels [ RED ], KEY_PANEL_RED_X, KEY_PANEL_RED_Y, LAYER_ROOM );
 
                if ( g_Player.iActiveKeyPanels [ BLUE ] )
-                   W_BlitImage ( g_KeyPanels [ BLUE ], KEY_PANEL_BLUE_X, KEY_PANEL_BLUE_Y );
+                   W_BatchImage ( g_KeyPanels [ BLUE ], KEY_PANEL_BLUE_X, KEY_PANEL_BLUE_Y, LAYER_ROOM );
 
                if ( g_Player.iActiveKeyPanels [ GREEN ] )
-                   W_BlitImage ( g_KeyPanels [ GREEN ], KEY_PANEL_GREEN_X, KEY_PANEL_GREEN_Y );
+                   W_BatchImage ( g_KeyPanels [ GREEN ], KEY_PANEL_GREEN_X, KEY_PANEL_GREEN_Y, LAYER_ROOM );
 
                if ( g_Player.iActiveKeyPanels [ YELLOW ] )
-                   W_BlitImage ( g_KeyPanels [ YELLOW ], KEY_PANEL_YELLOW_X, KEY_PANEL_YELLOW_Y );
+                   W_BatchImage ( g_KeyPanels [ YELLOW ], KEY_PANEL_YELLOW_X, KEY_PANEL_YELLOW_Y, LAYER_ROOM );
 
                break;
         }
@@ -1869,6 +2313,8 @@
         DrawDoors ();
         UpdateDoors ();
 
+        ProfileSection ( PROFILE_ROOM, iProfileTime );
+
         // ---- Draw the droids
 
         // Draw the enemies
@@ -1880,23 +2326,54 @@
 
         DrawDroid ( g_Player.Droid );
 
+        ProfileSection ( PROFILE_DROIDS, iProfileTime );
+
         // ---- Draw and update the lasers
 
         DrawLasers ();
+        ProfileSection ( PROFILE_DRAW_LASERS, iProfileTime );
+
         UpdateLasers ();
+        ProfileSection ( PROFILE_UPDATE_LASERS, iProfileTime );
 
         // ---- Draw and update the key
 
         HandleKey ();
+        ProfileSection ( PROFILE_KEY, iProfileTime );
 
         // ---- Draw and update the explosions
 
         DrawExplosions ();
+        ProfileSection ( PROFILE_DRAW_EXPLOSIONS, iProfileTime );
+
         UpdateExplosions ();
+        ProfileSection ( PROFILE_UPDATE_EXPLOSIONS, iProfileTime );
 
         // ---- Draw the interface
 
         DrawInterface ();
+        ProfileSection ( PROFILE_INTERFACE, iProfileTime );
+
+        // ---- Draw the background and sprites
+
+        W_EndSpriteBatch ();
+        ProfileSection ( PROFILE_SPRITE_BATCH, iProfileTime );
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadSprite ()
+    *
+    *   Takes a sprite from the sprite atlas, or loads it from its own file if it isn't in
+    *   the atlas.
+    */
+
+    bool LoadSprite ( char * pstrFilename, W_Image * Sprite )
+    {
+        if ( W_GetAtlasImage ( & g_SpriteAtlas, pstrFilename, Sprite ) )
+            return TRUE;
+
+        return W_LoadImage ( pstrFilename, Sprite );
     }
 
     /******************************************************************************************
@@ -2021,6 +2498,10 @@
                 for ( int iCurrExplosionFrame = 0; iCurrExplosionFrame < EXPLOSION_ANIM_FRAME_COUNT; ++ iCurrExplosionFrame )
                     W_FreeImage ( & g_ExplosionAnim [ iCurrExplosionFrame ] );
 
+                // Free the sprite atlas, now that nothing's using it
+
+                W_FreeAtlas ( & g_SpriteAtlas );
+
                 // Restore the key delay
 
                 W_EnableKeyDelay ();
@@ -2120,10 +2601,10 @@
 
     void HandleState ()
     {
-        W_Int64 iStartTime;
-        W_Int64 iCurrTime;
+        // Note when the frame started, so gameplay frames can be profiled
 
-        iStartTime = W_GetHighPerformanceTickCount ();
+        W_Int64 iProfileTime = W_GetMicroTickCount ();
+        int iProfileFrameCount = g_iProfileFrameCount;
 
         switch ( g_iCurrGameState )
         {
@@ -2211,188 +2692,193 @@
                 W_LoadImage ( "Gfx/Rooms/Pedestal_BG_Lit.bmp", & g_PedestalRoomOn );
                 W_LoadImage ( "Gfx/Rooms/Key_BG.bmp", & g_KeyRoom );
 
+                // Load the sprite atlas. If it's missing, each sprite is loaded from its own
+                // file instead.
+
+                W_LoadAtlas ( SPRITE_ATLAS_FILENAME, & g_SpriteAtlas );
+
                 // Load the door animations
 
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_0.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_1.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_2.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 2 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/North/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 2 ] );
-
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_0.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_1.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_2.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 2 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/South/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 2 ] );
-
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_0.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_1.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_2.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 2 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/East/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 2 ] );
-
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_0.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_1.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_2.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 2 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 0 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 1 ] );
-                W_LoadImage ( "Gfx/Rooms/Doors/West/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 2 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_0.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_1.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_2.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_OFF ][ 2 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/North/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_NORTH ][ LIGHTS_ON ][ 2 ] );
+
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_0.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_1.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_2.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_OFF ][ 2 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/South/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_SOUTH ][ LIGHTS_ON ][ 2 ] );
+
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_0.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_1.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_2.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_OFF ][ 2 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/East/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_EAST ][ LIGHTS_ON ][ 2 ] );
+
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_0.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_1.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_2.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_OFF ][ 2 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_0_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 0 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_1_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 1 ] );
+                LoadSprite ( "Gfx/Rooms/Doors/West/Open_2_Lit.bmp", & g_DoorAnims [ STRAIGHT_WEST ][ LIGHTS_ON ][ 2 ] );
 
                 // Load the interface graphics
 
-                W_LoadImage ( "Gfx/Interface/Frame_Energy.bmp", & g_EnergyFrame );
-                W_LoadImage ( "Gfx/Interface/Frame_Keys.bmp", & g_KeysFrame );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Blue_Full.bmp", & g_EnergyBars [ 0 ][ 0 ] );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Blue_Clear.bmp", & g_EnergyBars [ 0 ][ 1 ] );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Yellow_Full.bmp", & g_EnergyBars [ 1 ][ 0 ] );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Yellow_Clear.bmp", & g_EnergyBars [ 1 ][ 1 ] );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Red_Full.bmp", & g_EnergyBars [ 2 ][ 0 ] );
-                W_LoadImage ( "Gfx/Interface/Energy_Bars/Red_Clear.bmp", & g_EnergyBars [ 2 ][ 1 ] );
+                LoadSprite ( "Gfx/Interface/Frame_Energy.bmp", & g_EnergyFrame );
+                LoadSprite ( "Gfx/Interface/Frame_Keys.bmp", & g_KeysFrame );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Blue_Full.bmp", & g_EnergyBars [ 0 ][ 0 ] );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Blue_Clear.bmp", & g_EnergyBars [ 0 ][ 1 ] );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Yellow_Full.bmp", & g_EnergyBars [ 1 ][ 0 ] );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Yellow_Clear.bmp", & g_EnergyBars [ 1 ][ 1 ] );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Red_Full.bmp", & g_EnergyBars [ 2 ][ 0 ] );
+                LoadSprite ( "Gfx/Interface/Energy_Bars/Red_Clear.bmp", & g_EnergyBars [ 2 ][ 1 ] );
 
                 // Load the map graphics
 
                 W_LoadImage ( "Gfx/Zone_Map/BG.bmp", & g_MapScreen );
-                W_LoadImage ( "Gfx/Zone_Map/Cursor.bmp", & g_MapCursor );
+                LoadSprite ( "Gfx/Zone_Map/Cursor.bmp", & g_MapCursor );
 
                 // Load the key graphics
 
-                W_LoadImage ( "Gfx/Keys/Red/0.bmp", & g_KeyAnims [ RED ][ 0 ] );
-                W_LoadImage ( "Gfx/Keys/Red/1.bmp", & g_KeyAnims [ RED ][ 1 ] );
-                W_LoadImage ( "Gfx/Keys/Red/2.bmp", & g_KeyAnims [ RED ][ 2 ] );
-                W_LoadImage ( "Gfx/Keys/Red/3.bmp", & g_KeyAnims [ RED ][ 3 ] );
-                W_LoadImage ( "Gfx/Keys/Red/4.bmp", & g_KeyAnims [ RED ][ 4 ] );
-                W_LoadImage ( "Gfx/Keys/Red/5.bmp", & g_KeyAnims [ RED ][ 5 ] );
-                W_LoadImage ( "Gfx/Keys/Red/6.bmp", & g_KeyAnims [ RED ][ 6 ] );
-                W_LoadImage ( "Gfx/Keys/Red/7.bmp", & g_KeyAnims [ RED ][ 7 ] );
-
-                W_LoadImage ( "Gfx/Keys/Blue/0.bmp", & g_KeyAnims [ BLUE ][ 0 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/1.bmp", & g_KeyAnims [ BLUE ][ 1 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/2.bmp", & g_KeyAnims [ BLUE ][ 2 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/3.bmp", & g_KeyAnims [ BLUE ][ 3 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/4.bmp", & g_KeyAnims [ BLUE ][ 4 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/5.bmp", & g_KeyAnims [ BLUE ][ 5 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/6.bmp", & g_KeyAnims [ BLUE ][ 6 ] );
-                W_LoadImage ( "Gfx/Keys/Blue/7.bmp", & g_KeyAnims [ BLUE ][ 7 ] );
-
-                W_LoadImage ( "Gfx/Keys/Green/0.bmp", & g_KeyAnims [ GREEN ][ 0 ] );
-                W_LoadImage ( "Gfx/Keys/Green/1.bmp", & g_KeyAnims [ GREEN ][ 1 ] );
-                W_LoadImage ( "Gfx/Keys/Green/2.bmp", & g_KeyAnims [ GREEN ][ 2 ] );
-                W_LoadImage ( "Gfx/Keys/Green/3.bmp", & g_KeyAnims [ GREEN ][ 3 ] );
-                W_LoadImage ( "Gfx/Keys/Green/4.bmp", & g_KeyAnims [ GREEN ][ 4 ] );
-                W_LoadImage ( "Gfx/Keys/Green/5.bmp", & g_KeyAnims [ GREEN ][ 5 ] );
-                W_LoadImage ( "Gfx/Keys/Green/6.bmp", & g_KeyAnims [ GREEN ][ 6 ] );
-                W_LoadImage ( "Gfx/Keys/Green/7.bmp", & g_KeyAnims [ GREEN ][ 7 ] );
-
-                W_LoadImage ( "Gfx/Keys/Yellow/0.bmp", & g_KeyAnims [ YELLOW ][ 0 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/1.bmp", & g_KeyAnims [ YELLOW ][ 1 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/2.bmp", & g_KeyAnims [ YELLOW ][ 2 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/3.bmp", & g_KeyAnims [ YELLOW ][ 3 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/4.bmp", & g_KeyAnims [ YELLOW ][ 4 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/5.bmp", & g_KeyAnims [ YELLOW ][ 5 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/6.bmp", & g_KeyAnims [ YELLOW ][ 6 ] );
-                W_LoadImage ( "Gfx/Keys/Yellow/7.bmp", & g_KeyAnims [ YELLOW ][ 7 ] );
-
-                W_LoadImage ( "Gfx/Keys/Icons/Red.bmp", & g_KeyIcons [ RED ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Blue.bmp", & g_KeyIcons [ BLUE ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Green.bmp", & g_KeyIcons [ GREEN ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Yellow.bmp", & g_KeyIcons [ YELLOW ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Red_Empty.bmp", & g_KeyIconsEmpty [ RED ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Blue_Empty.bmp", & g_KeyIconsEmpty [ BLUE ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Green_Empty.bmp", & g_KeyIconsEmpty [ GREEN ] );
-                W_LoadImage ( "Gfx/Keys/Icons/Yellow_Empty.bmp", & g_KeyIconsEmpty [ YELLOW ] );
-
-                W_LoadImage ( "Gfx/Rooms/Key_Panels/Red_Lit.bmp", & g_KeyPanels [ RED ] );
-                W_LoadImage ( "Gfx/Rooms/Key_Panels/Blue_Lit.bmp", & g_KeyPanels [ BLUE ] );
-                W_LoadImage ( "Gfx/Rooms/Key_Panels/Green_Lit.bmp", & g_KeyPanels [ GREEN ] );
-                W_LoadImage ( "Gfx/Rooms/Key_Panels/Yellow_Lit.bmp", & g_KeyPanels [ YELLOW ] );
+                LoadSprite ( "Gfx/Keys/Red/0.bmp", & g_KeyAnims [ RED ][ 0 ] );
+                LoadSprite ( "Gfx/Keys/Red/1.bmp", & g_KeyAnims [ RED ][ 1 ] );
+                LoadSprite ( "Gfx/Keys/Red/2.bmp", & g_KeyAnims [ RED ][ 2 ] );
+                LoadSprite ( "Gfx/Keys/Red/3.bmp", & g_KeyAnims [ RED ][ 3 ] );
+                LoadSprite ( "Gfx/Keys/Red/4.bmp", & g_KeyAnims [ RED ][ 4 ] );
+                LoadSprite ( "Gfx/Keys/Red/5.bmp", & g_KeyAnims [ RED ][ 5 ] );
+                LoadSprite ( "Gfx/Keys/Red/6.bmp", & g_KeyAnims [ RED ][ 6 ] );
+                LoadSprite ( "Gfx/Keys/Red/7.bmp", & g_KeyAnims [ RED ][ 7 ] );
+
+                LoadSprite ( "Gfx/Keys/Blue/0.bmp", & g_KeyAnims [ BLUE ][ 0 ] );
+                LoadSprite ( "Gfx/Keys/Blue/1.bmp", & g_KeyAnims [ BLUE ][ 1 ] );
+                LoadSprite ( "Gfx/Keys/Blue/2.bmp", & g_KeyAnims [ BLUE ][ 2 ] );
+                LoadSprite ( "Gfx/Keys/Blue/3.bmp", & g_KeyAnims [ BLUE ][ 3 ] );
+                LoadSprite ( "Gfx/Keys/Blue/4.bmp", & g_KeyAnims [ BLUE ][ 4 ] );
+                LoadSprite ( "Gfx/Keys/Blue/5.bmp", & g_KeyAnims [ BLUE ][ 5 ] );
+                LoadSprite ( "Gfx/Keys/Blue/6.bmp", & g_KeyAnims [ BLUE ][ 6 ] );
+                LoadSprite ( "Gfx/Keys/Blue/7.bmp", & g_KeyAnims [ BLUE ][ 7 ] );
+
+                LoadSprite ( "Gfx/Keys/Green/0.bmp", & g_KeyAnims [ GREEN ][ 0 ] );
+                LoadSprite ( "Gfx/Keys/Green/1.bmp", & g_KeyAnims [ GREEN ][ 1 ] );
+                LoadSprite ( "Gfx/Keys/Green/2.bmp", & g_KeyAnims [ GREEN ][ 2 ] );
+                LoadSprite ( "Gfx/Keys/Green/3.bmp", & g_KeyAnims [ GREEN ][ 3 ] );
+                LoadSprite ( "Gfx/Keys/Green/4.bmp", & g_KeyAnims [ GREEN ][ 4 ] );
+                LoadSprite ( "Gfx/Keys/Green/5.bmp", & g_KeyAnims [ GREEN ][ 5 ] );
+                LoadSprite ( "Gfx/Keys/Green/6.bmp", & g_KeyAnims [ GREEN ][ 6 ] );
+                LoadSprite ( "Gfx/Keys/Green/7.bmp", & g_KeyAnims [ GREEN ][ 7 ] );
+
+                LoadSprite ( "Gfx/Keys/Yellow/0.bmp", & g_KeyAnims [ YELLOW ][ 0 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/1.bmp", & g_KeyAnims [ YELLOW ][ 1 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/2.bmp", & g_KeyAnims [ YELLOW ][ 2 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/3.bmp", & g_KeyAnims [ YELLOW ][ 3 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/4.bmp", & g_KeyAnims [ YELLOW ][ 4 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/5.bmp", & g_KeyAnims [ YELLOW ][ 5 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/6.bmp", & g_KeyAnims [ YELLOW ][ 6 ] );
+                LoadSprite ( "Gfx/Keys/Yellow/7.bmp", & g_KeyAnims [ YELLOW ][ 7 ] );
+
+                LoadSprite ( "Gfx/Keys/Icons/Red.bmp", & g_KeyIcons [ RED ] );
+                LoadSprite ( "Gfx/Keys/Icons/Blue.bmp", & g_KeyIcons [ BLUE ] );
+                LoadSprite ( "Gfx/Keys/Icons/Green.bmp", & g_KeyIcons [ GREEN ] );
+                LoadSprite ( "Gfx/Keys/Icons/Yellow.bmp", & g_KeyIcons [ YELLOW ] );
+                LoadSprite ( "Gfx/Keys/Icons/Red_Empty.bmp", & g_KeyIconsEmpty [ RED ] );
+                LoadSprite ( "Gfx/Keys/Icons/Blue_Empty.bmp", & g_KeyIconsEmpty [ BLUE ] );
+                LoadSprite ( "Gfx/Keys/Icons/Green_Empty.bmp", & g_KeyIconsEmpty [ GREEN ] );
+                LoadSprite ( "Gfx/Keys/Icons/Yellow_Empty.bmp", & g_KeyIconsEmpty [ YELLOW ] );
+
+                LoadSprite ( "Gfx/Rooms/Key_Panels/Red_Lit.bmp", & g_KeyPanels [ RED ] );
+                LoadSprite ( "Gfx/Rooms/Key_Panels/Blue_Lit.bmp", & g_KeyPanels [ BLUE ] );
+                LoadSprite ( "Gfx/Rooms/Key_Panels/Green_Lit.bmp", & g_KeyPanels [ GREEN ] );
+                LoadSprite ( "Gfx/Rooms/Key_Panels/Yellow_Lit.bmp", & g_KeyPanels [ YELLOW ] );
 
                 // Load the droid graphics
 
-                W_LoadImage ( "Gfx/Droids/White/North.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH ] );
-                W_LoadImage ( "Gfx/Droids/White/North_East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/White/East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ EAST ] );
-                W_LoadImage ( "Gfx/Droids/White/South_East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/White/South.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH ] );
-                W_LoadImage ( "Gfx/Droids/White/South_West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH_WEST ] );
-                W_LoadImage ( "Gfx/Droids/White/West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ WEST ] );
-                W_LoadImage ( "Gfx/Droids/White/North_West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/White/North.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH ] );
+                LoadSprite ( "Gfx/Droids/White/North_East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/White/East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ EAST ] );
+                LoadSprite ( "Gfx/Droids/White/South_East.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/White/South.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH ] );
+                LoadSprite ( "Gfx/Droids/White/South_West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ SOUTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/White/West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ WEST ] );
+                LoadSprite ( "Gfx/Droids/White/North_West.bmp", & g_Droids [ DROID_TYPE_WHITE ][ NORTH_WEST ] );
                 
 
-                W_LoadImage ( "Gfx/Droids/Blue/North.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH ] );
-                W_LoadImage ( "Gfx/Droids/Blue/North_East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Blue/East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ EAST ] );
-                W_LoadImage ( "Gfx/Droids/Blue/South_East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Blue/South.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH ] );
-                W_LoadImage ( "Gfx/Droids/Blue/South_West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH_WEST ] );
-                W_LoadImage ( "Gfx/Droids/Blue/West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ WEST ] );
-                W_LoadImage ( "Gfx/Droids/Blue/North_West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH_WEST ] );
-
-                W_LoadImage ( "Gfx/Droids/Grey/North.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH ] );
-                W_LoadImage ( "Gfx/Droids/Grey/North_East.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Grey/East.bmp", & g_Droids [ DROID_TYPE_GREY ][ EAST ] );
-                W_LoadImage ( "Gfx/Droids/Grey/South_East.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Grey/South.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH ] );
-                W_LoadImage ( "Gfx/Droids/Grey/South_West.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH_WEST ] );
-                W_LoadImage ( "Gfx/Droids/Grey/West.bmp", & g_Droids [ DROID_TYPE_GREY ][ WEST ] );
-                W_LoadImage ( "Gfx/Droids/Grey/North_West.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH_WEST ] );
-
-                W_LoadImage ( "Gfx/Droids/Red/North.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH ] );
-                W_LoadImage ( "Gfx/Droids/Red/North_East.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Red/East.bmp", & g_Droids [ DROID_TYPE_RED ][ EAST ] );
-                W_LoadImage ( "Gfx/Droids/Red/South_East.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH_EAST ] );
-                W_LoadImage ( "Gfx/Droids/Red/South.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH ] );
-                W_LoadImage ( "Gfx/Droids/Red/South_West.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH_WEST ] );
-                W_LoadImage ( "Gfx/Droids/Red/West.bmp", & g_Droids [ DROID_TYPE_RED ][ WEST ] );
-                W_LoadImage ( "Gfx/Droids/Red/North_West.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/Blue/North.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH ] );
+                LoadSprite ( "Gfx/Droids/Blue/North_East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Blue/East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ EAST ] );
+                LoadSprite ( "Gfx/Droids/Blue/South_East.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Blue/South.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH ] );
+                LoadSprite ( "Gfx/Droids/Blue/South_West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ SOUTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/Blue/West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ WEST ] );
+                LoadSprite ( "Gfx/Droids/Blue/North_West.bmp", & g_Droids [ DROID_TYPE_BLUE ][ NORTH_WEST ] );
+
+                LoadSprite ( "Gfx/Droids/Grey/North.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH ] );
+                LoadSprite ( "Gfx/Droids/Grey/North_East.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Grey/East.bmp", & g_Droids [ DROID_TYPE_GREY ][ EAST ] );
+                LoadSprite ( "Gfx/Droids/Grey/South_East.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Grey/South.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH ] );
+                LoadSprite ( "Gfx/Droids/Grey/South_West.bmp", & g_Droids [ DROID_TYPE_GREY ][ SOUTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/Grey/West.bmp", & g_Droids [ DROID_TYPE_GREY ][ WEST ] );
+                LoadSprite ( "Gfx/Droids/Grey/North_West.bmp", & g_Droids [ DROID_TYPE_GREY ][ NORTH_WEST ] );
+
+                LoadSprite ( "Gfx/Droids/Red/North.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH ] );
+                LoadSprite ( "Gfx/Droids/Red/North_East.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Red/East.bmp", & g_Droids [ DROID_TYPE_RED ][ EAST ] );
+                LoadSprite ( "Gfx/Droids/Red/South_East.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH_EAST ] );
+                LoadSprite ( "Gfx/Droids/Red/South.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH ] );
+                LoadSprite ( "Gfx/Droids/Red/South_West.bmp", & g_Droids [ DROID_TYPE_RED ][ SOUTH_WEST ] );
+                LoadSprite ( "Gfx/Droids/Red/West.bmp", & g_Droids [ DROID_TYPE_RED ][ WEST ] );
+                LoadSprite ( "Gfx/Droids/Red/North_West.bmp", & g_Droids [ DROID_TYPE_RED ][ NORTH_WEST ] );
 
                 // Load the laser animations
 
-                W_LoadImage ( "Gfx/Weapons/Player/North/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/North/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/North/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/North/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/South/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/South/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/South/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/South/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/East/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/East/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/East/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/East/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/West/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/West/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/West/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Player/West/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 3 ] );
-
-                W_LoadImage ( "Gfx/Weapons/Enemy/North/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/North/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/North/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/North/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/South/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/South/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/South/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/South/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/East/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/East/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/East/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/East/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 3 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/West/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 0 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/West/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 1 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/West/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 2 ] );
-                W_LoadImage ( "Gfx/Weapons/Enemy/West/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Player/North/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Player/North/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Player/North/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Player/North/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_NORTH ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Player/South/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Player/South/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Player/South/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Player/South/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_SOUTH ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Player/East/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Player/East/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Player/East/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Player/East/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_EAST ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Player/West/0.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Player/West/1.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Player/West/2.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Player/West/3.bmp", & g_PlayerLaserAnims [ STRAIGHT_WEST ][ 3 ] );
+
+                LoadSprite ( "Gfx/Weapons/Enemy/North/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/North/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/North/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/North/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_NORTH ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/South/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/South/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/South/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/South/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_SOUTH ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/East/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/East/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/East/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/East/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_EAST ][ 3 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/West/0.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 0 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/West/1.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 1 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/West/2.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 2 ] );
+                LoadSprite ( "Gfx/Weapons/Enemy/West/3.bmp", & g_EnemyLaserAnims [ STRAIGHT_WEST ][ 3 ] );
 
                 // Load the explosion animation
 
-                W_LoadImage ( "Gfx/Explosion/0.bmp", & g_ExplosionAnim [ 0 ] );
-                W_LoadImage ( "Gfx/Explosion/1.bmp", & g_ExplosionAnim [ 1 ] );
-                W_LoadImage ( "Gfx/Explosion/2.bmp", & g_ExplosionAnim [ 2 ] );
-                W_LoadImage ( "Gfx/Explosion/3.bmp", & g_ExplosionAnim [ 3 ] );
-                W_LoadImage ( "Gfx/Explosion/4.bmp", & g_ExplosionAnim [ 4 ] );
-                W_LoadImage ( "Gfx/Explosion/5.bmp", & g_ExplosionAnim [ 5 ] );
-                W_LoadImage ( "Gfx/Explosion/6.bmp", & g_ExplosionAnim [ 6 ] );
+                LoadSprite ( "Gfx/Explosion/0.bmp", & g_ExplosionAnim [ 0 ] );
+                LoadSprite ( "Gfx/Explosion/1.bmp", & g_ExplosionAnim [ 1 ] );
+                LoadSprite ( "Gfx/Explosion/2.bmp", & g_ExplosionAnim [ 2 ] );
+                LoadSprite ( "Gfx/Explosion/3.bmp", & g_ExplosionAnim [ 3 ] );
+                LoadSprite ( "Gfx/Explosion/4.bmp", & g_ExplosionAnim [ 4 ] );
+                LoadSprite ( "Gfx/Explosion/5.bmp", & g_ExplosionAnim [ 5 ] );
+                LoadSprite ( "Gfx/Explosion/6.bmp", & g_ExplosionAnim [ 6 ] );
 
                 SetGameState ( GAME_STATE_PLAY );
 
@@ -2441,8 +2927,7 @@
                         W_DisableKeyDelay ();
                         iIsMapActive = FALSE;
 
-                        unsigned int iTickCount = W_GetTickCount ();
-                        while ( W_GetTickCount () < iTickCount + 600 );
+                        W_Delay ( 600 );
                     }
                 }
                 else
@@ -2458,7 +2943,9 @@
 
                     // Run the scripts
 
+                    W_Int64 iScriptTime = W_GetMicroTickCount ();
                     XS_RunScripts ( SCRIPT_TIMESLICE_DUR );
+                    ProfileSection ( PROFILE_SCRIPTS, iScriptTime );
 
                     // Determine if the player has activated all four key panels
 
@@ -2574,16 +3061,7 @@
                         // If the player has no energy, exit the game after the explosions die
                         // down
 
-                        int iExplosionsActive = FALSE;
-                        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
-                        {
-                            if ( g_Explosions [ iCurrExplosion ].iIsActive )
-                            {
-                                iExplosionsActive = TRUE;
-                                break;
-                            }
-                        }
-                        if ( ! iExplosionsActive )
+                        if ( ! g_Explosions.iCount )
                             SetGameState ( GAME_STATE_GAME_OVER );
                     }
                 }
@@ -2623,13 +3101,13 @@
             }
         }
 
-        while ( TRUE )
-        {   
-            iCurrTime = W_GetHighPerformanceTickCount ();
+        if ( g_iProfileFrameCount != iProfileFrameCount )
+            ProfileSection ( PROFILE_FRAME, iProfileTime );
 
-            if ( ( iCurrTime - iStartTime ) > FPS_LOCK_FRAME_DUR )
-                break;
-        }
+        // Sleep off the rest of the frame
+
+        if ( g_iIsFPSLockEnabled )
+            W_WaitForNextFrame ();
     }
 
     /******************************************************************************************
@@ -2687,6 +3165,21 @@
 
         W_LoadSound ( "Sound/Game_Over/Theme.wav", & g_GameOverSound, FALSE );
 
+        // ---- Open the image pack
+
+        // Images in the pack are loaded already converted to the screen's format. If it's
+        // missing, or was cooked for another color depth, they're loaded from their BMPs.
+
+        W_OpenImagePack ( IMAGE_PACK_FILENAME );
+
+        // Lock the frame rate
+
+        W_SetFrameRate ( FPS_LOCK );
+
+        // Only redraw the parts of the game screen that change from frame to frame
+
+        W_EnableDirtyRects ();
+
         // Set the game state to the title screen
 
         SetGameState ( GAME_STATE_TITLE );
@@ -2722,9 +3215,19 @@
 
         W_FreeSound ( & g_GameOverSound );
 
+        // ---- Close the image pack
+
+        W_CloseImagePack ();
+
         // ---- Shut down the scripting system
 
         XS_ShutDown ();
+
+        // ---- Write the frame timing breakdown, if this is a profiling build
+
+        #ifdef LOCKDOWN_PROFILE
+            WriteProfileReport ( PROFILE_REPORT_FILENAME );
+        #endif
     }
 
     /******************************************************************************************
@@ -2773,15 +3276,15 @@
         for ( int iCurrDroid = 0; iCurrDroid < ENEMY_DROID_COUNT; ++ iCurrDroid )
             g_EnemyDroids [ iCurrDroid ].iIsActive = FALSE;
 
+        ResetDroidGrid ();
+
         // Explosions
 
-        for ( int iCurrExplosion = 0; iCurrExplosion < MAX_EXPLOSION_COUNT; ++ iCurrExplosion )
-            g_Explosions [ iCurrExplosion ].iIsActive = FALSE;
+        ResetExplosions ();
 
         // Lasers
 
-        for ( int iCurrLaser = 0; iCurrLaser < MAX_LASER_COUNT; ++ iCurrLaser )
-            g_Lasers [ iCurrLaser ].iIsActive = FALSE;
+        ResetLasers ();
 
         // ---- Initialize the interface
 
@@ -3022,6 +3525,424 @@
         XS_ReturnInt ( iThreadIndex, 0, DroidCenter.iY );
     }
 
+// ---- Simulation ----------------------------------------------------------------------------
+
+    #ifdef WRAPPUH_HEADLESS
+
+    /******************************************************************************************
+    *
+    *   ReadSimSettings ()
+    *
+    *   Reads the simulation switches from the command line:
+    *
+    *       -Sim            Run the simulation instead of the game
+    *       -Rooms:N        Number of rooms to simulate
+    *       -Ticks:N        Longest a room can last, in frames
+    *       -Seed:N         Seed for the game's random numbers
+    *       -Input:File     Input script to play instead of random input
+    *       -Record:File    WAV file to record the game's sound to
+    *
+    *   Returns FALSE if a switch is invalid or the input script couldn't be loaded.
+    */
+
+    int ReadSimSettings ( char * pstrCmdLine )
+    {
+        g_iIsSimActive = FALSE;
+        g_iSimRoomCount = SIM_DEFAULT_ROOM_COUNT;
+        g_iSimTicksPerRoom = SIM_DEFAULT_TICKS_PER_ROOM;
+        g_iSimSeed = SIM_DEFAULT_SEED;
+        g_pstrSimInputFilename = NULL;
+        g_iSimInputStepCount = 0;
+        g_pstrSimRecordFilename = NULL;
+
+        if ( ! pstrCmdLine )
+            return TRUE;
+
+        // Switches are separated by spaces and matched regardless of case; xvm.h maps stricmp ()
+        // and strnicmp () to their POSIX names outside of Windows
+
+        for ( char * pstrArg = strtok ( pstrCmdLine, " " ); pstrArg; pstrArg = strtok ( NULL, " " ) )
+        {
+            if ( stricmp ( pstrArg, "-Sim" ) == 0 )
+                g_iIsSimActive = TRUE;
+            else if ( strnicmp ( pstrArg, "-Rooms:", 7 ) == 0 )
+                g_iSimRoomCount = atoi ( pstrArg + 7 );
+            else if ( strnicmp ( pstrArg, "-Ticks:", 7 ) == 0 )
+                g_iSimTicksPerRoom = atoi ( pstrArg + 7 );
+            else if ( strnicmp ( pstrArg, "-Seed:", 6 ) == 0 )
+                g_iSimSeed = ( unsigned int ) atoi ( pstrArg + 6 );
+            else if ( strnicmp ( pstrArg, "-Input:", 7 ) == 0 )
+                g_pstrSimInputFilename = pstrArg + 7;
+            else if ( strnicmp ( pstrArg, "-Record:", 8 ) == 0 )
+                g_pstrSimRecordFilename = pstrArg + 8;
+            else
+            {
+                printf ( "Unrecognized switch: %s\n", pstrArg );
+                return FALSE;
+            }
+        }
+
+        if ( g_iSimRoomCount <= 0 || g_iSimTicksPerRoom <= 0 )
+        {
+            printf ( "Room and tick counts must be greater than zero.\n" );
+            return FALSE;
+        }
+
+        if ( g_pstrSimInputFilename && ! LoadSimInput ( g_pstrSimInputFilename ) )
+        {
+            printf ( "Could not load input script %s.\n", g_pstrSimInputFilename );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadSimInput ()
+    *
+    *   Loads an input script. Each line holds a tick count followed by the keys to hold down
+    *   for that long: any of U, D, L and R to move and F to fire, or - for no keys. Blank lines
+    *   and lines starting with a semicolon are skipped. The script loops when it runs out.
+    */
+
+    int LoadSimInput ( char * pstrFilename )
+    {
+        FILE * pInputFile;
+        if ( ! ( pInputFile = fopen ( pstrFilename, "r" ) ) )
+            return FALSE;
+
+        char pstrLine [ 256 ];
+        g_iSimInputStepCount = 0;
+
+        while ( fgets ( pstrLine, sizeof ( pstrLine ), pInputFile ) )
+        {
+            int iTickCount;
+            char pstrKeys [ 16 ];
+
+            if ( pstrLine [ 0 ] == ';' || sscanf ( pstrLine, "%d %15s", & iTickCount, pstrKeys ) != 2 )
+                continue;
+
+            if ( iTickCount <= 0 || g_iSimInputStepCount == SIM_MAX_INPUT_STEP_COUNT )
+                continue;
+
+            SimInputStep & Step = g_SimInputSteps [ g_iSimInputStepCount ++ ];
+            Step.iTickCount = iTickCount;
+            Step.iKeys = 0;
+
+            for ( char * pstrCurrKey = pstrKeys; * pstrCurrKey; ++ pstrCurrKey )
+            {
+                switch ( * pstrCurrKey )
+                {
+                    case 'U': case 'u': Step.iKeys |= SIM_KEY_UP; break;
+                    case 'D': case 'd': Step.iKeys |= SIM_KEY_DOWN; break;
+                    case 'L': case 'l': Step.iKeys |= SIM_KEY_LEFT; break;
+                    case 'R': case 'r': Step.iKeys |= SIM_KEY_RIGHT; break;
+                    case 'F': case 'f': Step.iKeys |= SIM_KEY_FIRE; break;
+                }
+            }
+        }
+
+        fclose ( pInputFile );
+
+        return g_iSimInputStepCount > 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetSimInputRand ()
+    *
+    *   Returns a random number for the simulated input. The input has its own generator so
+    *   it doesn't use up the game's random numbers.
+    */
+
+    int GetSimInputRand ()
+    {
+        g_iSimInputRandState = g_iSimInputRandState * 1103515245 + 12345;
+        return ( g_iSimInputRandState >> 16 ) & 0x7FFF;
+    }
+
+    /******************************************************************************************
+    *
+    *   GetNextSimInputStep ()
+    *
+    *   Returns the specified step of the input script, or a random step if there is no
+    *   script. Random steps hold a direction (or no direction) for a while, and fire about
+    *   half the time.
+    */
+
+    void GetNextSimInputStep ( int iStep, SimInputStep & Step )
+    {
+        if ( g_iSimInputStepCount )
+        {
+            Step = g_SimInputSteps [ iStep % g_iSimInputStepCount ];
+            return;
+        }
+
+        static int piDirKeys [ DIR_COUNT + 1 ] =
+        {
+            0,
+            SIM_KEY_UP, SIM_KEY_UP | SIM_KEY_RIGHT, SIM_KEY_RIGHT, SIM_KEY_DOWN | SIM_KEY_RIGHT,
+            SIM_KEY_DOWN, SIM_KEY_DOWN | SIM_KEY_LEFT, SIM_KEY_LEFT, SIM_KEY_UP | SIM_KEY_LEFT
+        };
+
+        Step.iTickCount = SIM_MIN_RAND_STEP_DUR + GetSimInputRand () % ( SIM_MAX_RAND_STEP_DUR - SIM_MIN_RAND_STEP_DUR + 1 );
+        Step.iKeys = piDirKeys [ GetSimInputRand () % ( DIR_COUNT + 1 ) ];
+
+        if ( GetSimInputRand () & 1 )
+            Step.iKeys |= SIM_KEY_FIRE;
+    }
+
+    /******************************************************************************************
+    *
+    *   SetSimKeys ()
+    *
+    *   Presses the keys in a set of SIM_KEY_* flags and releases the rest.
+    */
+
+    void SetSimKeys ( int iKeys )
+    {
+        W_SetKeyState ( W_KEY_UP, iKeys & SIM_KEY_UP );
+        W_SetKeyState ( W_KEY_DOWN, iKeys & SIM_KEY_DOWN );
+        W_SetKeyState ( W_KEY_LEFT, iKeys & SIM_KEY_LEFT );
+        W_SetKeyState ( W_KEY_RIGHT, iKeys & SIM_KEY_RIGHT );
+        W_SetKeyState ( W_KEY_SPACE, iKeys & SIM_KEY_FIRE );
+    }
+
+    /******************************************************************************************
+    *
+    *   RunSimRoom ()
+    *
+    *   Drops a fresh player into the specified room and steps the game until the player
+    *   dies, leaves, destroys every droid or runs out of ticks, adding the results to the
+    *   stats. Each tick advances the virtual clock by one frame, so the droids' timers and
+    *   scripts see the same time steps they would at the FPS lock. Returns FALSE if the game
+    *   left the gameplay state.
+    */
+
+    int RunSimRoom ( int iRoomX, int iRoomY )
+    {
+        int iType = g_iRooms [ iRoomX ][ iRoomY ];
+
+        // Reset the player and enter the room
+
+        InitDroid ( g_Player.Droid, 319, 239, NORTH, DROID_TYPE_WHITE, MAX_ENERGY );
+
+        g_Player.iRoomX = iRoomX;
+        g_Player.iRoomY = iRoomY;
+
+        for ( int iCurrKey = 0; iCurrKey < KEY_COUNT; ++ iCurrKey )
+            g_Player.iKeys [ iCurrKey ] = FALSE;
+
+        InitRoom ( iType );
+
+        SimStats & Stats = g_SimStats [ g_EnemyDroids [ 0 ].iType ];
+        ++ Stats.iRoomCount;
+
+        // Step the game
+
+        SimInputStep Step;
+        int iStepTicksLeft = 0;
+
+        int iCurrTick;
+        int iDroidsLeft = ENEMY_DROID_COUNT;
+
+        for ( iCurrTick = 0; iCurrTick < g_iSimTicksPerRoom; ++ iCurrTick )
+        {
+            // Move on to the next input step when this one runs out
+
+            if ( ! iStepTicksLeft )
+            {
+                GetNextSimInputStep ( g_iCurrSimInputStep ++, Step );
+                iStepTicksLeft = Step.iTickCount;
+                SetSimKeys ( Step.iKeys );
+            }
+
+            -- iStepTicksLeft;
+
+            // Run a frame
+
+            W_AdvanceVirtualClock ( FPS_LOCK_FRAME_DUR );
+
+            W_GetKbrdState ();
+            W_HandleTimers ();
+            W_UpdateSound ();
+            HandleState ();
+
+            if ( g_iCurrGameState != GAME_STATE_PLAY )
+                return FALSE;
+
+            // Count the droids that are left
+
+            iDroidsLeft = 0;
+            for ( int iCurrDroid = 0; iCurrDroid < ENEMY_DROID_COUNT; ++ iCurrDroid )
+                if ( g_EnemyDroids [ iCurrDroid ].iIsActive )
+                    ++ iDroidsLeft;
+
+            // End the room if the player died, left or won
+
+            if ( ! g_Player.Droid.iIsActive )
+            {
+                ++ Stats.iPlayerDeaths;
+                break;
+            }
+
+            if ( g_Player.iRoomX != iRoomX || g_Player.iRoomY != iRoomY )
+            {
+                ++ Stats.iExitCount;
+                break;
+            }
+
+            if ( ! iDroidsLeft )
+            {
+                ++ Stats.iClearCount;
+                break;
+            }
+        }
+
+        if ( iCurrTick < g_iSimTicksPerRoom )
+            ++ iCurrTick;
+
+        Stats.iTickCount += iCurrTick;
+        Stats.iDroidsDestroyed += ENEMY_DROID_COUNT - iDroidsLeft;
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunSimulation ()
+    *
+    *   Runs the game without drawing or waiting on the FPS lock, cycling through every room
+    *   that has droids in it until the requested number of rooms has been simulated, then
+    *   prints the results. The game's random numbers are seeded with the simulation seed, so
+    *   a run can be repeated exactly.
+    */
+
+    void RunSimulation ()
+    {
+        // Switch to the virtual clock and stop drawing. The clock starts on the next whole
+        // second, so the results don't depend on how long the game took to start up.
+
+        W_EnableVirtualClock ();
+        W_AdvanceVirtualClock ( 1000 - W_GetTickCount () % 1000 );
+        W_DisableDrawing ();
+        g_iIsFPSLockEnabled = FALSE;
+
+        // Load the game graphics and start the game
+
+        SetGameState ( GAME_STATE_LOADING );
+        HandleState ();
+
+        srand ( g_iSimSeed );
+        g_iSimInputRandState = g_iSimSeed;
+        g_iCurrSimInputStep = 0;
+
+        // Make a list of the rooms with droids in them
+
+        int piRoomX [ FORTRESS_WIDTH * FORTRESS_HEIGHT ],
+            piRoomY [ FORTRESS_WIDTH * FORTRESS_HEIGHT ];
+        int iRoomCount = 0;
+
+        for ( int iY = 0; iY < FORTRESS_HEIGHT; ++ iY )
+        {
+            for ( int iX = 0; iX < FORTRESS_WIDTH; ++ iX )
+            {
+                int iType = g_iRooms [ iX ][ iY ];
+                if ( iType == ROOM_TYPE_NORMAL || iType == ROOM_TYPE_GUARD || iType == ROOM_TYPE_PEDESTAL )
+                {
+                    piRoomX [ iRoomCount ] = iX;
+                    piRoomY [ iRoomCount ] = iY;
+                    ++ iRoomCount;
+                }
+            }
+        }
+
+        // Record the sound if it was requested. It's mixed as the virtual clock moves, so
+        // the recording plays back at the game's real speed.
+
+        if ( g_pstrSimRecordFilename && ! W_StartSoundRecording ( g_pstrSimRecordFilename ) )
+            printf ( "Could not record the sound to %s.\n", g_pstrSimRecordFilename );
+
+        // Simulate the rooms
+
+        memset ( g_SimStats, 0, sizeof ( g_SimStats ) );
+
+        W_Int64 iStartTime = W_GetMicroTickCount ();
+
+        for ( int iCurrRoom = 0; iCurrRoom < g_iSimRoomCount; ++ iCurrRoom )
+        {
+            if ( ! RunSimRoom ( piRoomX [ iCurrRoom % iRoomCount ], piRoomY [ iCurrRoom % iRoomCount ] ) )
+            {
+                printf ( "The game left the gameplay state in room %d.\n", iCurrRoom );
+                break;
+            }
+        }
+
+        W_StopSoundRecording ();
+
+        PrintSimReport ( W_GetMicroTickCount () - iStartTime );
+
+        // Put everything back
+
+        SetSimKeys ( 0 );
+        g_iIsFPSLockEnabled = TRUE;
+        W_EnableDrawing ();
+        W_DisableVirtualClock ();
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintSimReport ()
+    *
+    *   Prints the simulation results for each droid type, and how fast the simulation ran.
+    */
+
+    void PrintSimReport ( W_Int64 iWallTime )
+    {
+        static char * ppstrTypeNames [ DROID_TYPE_COUNT ] = { "White", "Blue", "Grey", "Red" };
+
+        printf ( "Lockdown AI Soak Test\n" );
+        printf ( "%d rooms, up to %d ticks each, seed %u, %s input\n\n",
+                 g_iSimRoomCount, g_iSimTicksPerRoom, g_iSimSeed,
+                 g_pstrSimInputFilename ? g_pstrSimInputFilename : "random" );
+
+        printf ( "%-8s%8s%10s%11s%8s%8s%9s\n", "Droids", "Rooms", "Ticks", "Destroyed", "Deaths", "Exits", "Cleared" );
+
+        SimStats Total;
+        memset ( & Total, 0, sizeof ( Total ) );
+
+        for ( int iCurrType = DROID_TYPE_BLUE; iCurrType < DROID_TYPE_COUNT; ++ iCurrType )
+        {
+            SimStats & Stats = g_SimStats [ iCurrType ];
+
+            printf ( "%-8s%8d%10d%11d%8d%8d%9d\n", ppstrTypeNames [ iCurrType ],
+                     Stats.iRoomCount, Stats.iTickCount, Stats.iDroidsDestroyed,
+                     Stats.iPlayerDeaths, Stats.iExitCount, Stats.iClearCount );
+
+            Total.iRoomCount += Stats.iRoomCount;
+            Total.iTickCount += Stats.iTickCount;
+            Total.iDroidsDestroyed += Stats.iDroidsDestroyed;
+            Total.iPlayerDeaths += Stats.iPlayerDeaths;
+            Total.iExitCount += Stats.iExitCount;
+            Total.iClearCount += Stats.iClearCount;
+        }
+
+        printf ( "%-8s%8d%10d%11d%8d%8d%9d\n\n", "Total",
+                 Total.iRoomCount, Total.iTickCount, Total.iDroidsDestroyed,
+                 Total.iPlayerDeaths, Total.iExitCount, Total.iClearCount );
+
+        // Compare the tick rate to the FPS lock
+
+        double dSeconds = iWallTime / 1000000.0;
+        double dTicksPerSec = dSeconds > 0 ? Total.iTickCount / dSeconds : 0;
+
+        printf ( "Wall time:   %.3f seconds\n", dSeconds );
+        printf ( "Ticks/sec:   %.0f (%.1fx real time at %d FPS)\n", dTicksPerSec, dTicksPerSec / FPS_LOCK, FPS_LOCK );
+    }
+
+    #endif
+
 // ---- Main ----------------------------------------------------------------------------------
 
 	Main
@@ -3041,6 +3962,27 @@
 
         Init ();
 
+        // Run the AI simulation instead of the game, if it was requested
+
+        #ifdef WRAPPUH_HEADLESS
+
+        if ( ! ReadSimSettings ( lpCmdLine ) )
+        {
+            ShutDown ();
+            W_ShutDownWrappuh ();
+            return 1;
+        }
+
+        if ( g_iIsSimActive )
+        {
+            RunSimulation ();
+            ShutDown ();
+            W_ShutDownWrappuh ();
+            return 0;
+        }
+
+        #endif
+
 		// Start the main loop
 
 		MainLoop
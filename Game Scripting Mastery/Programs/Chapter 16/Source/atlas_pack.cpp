@@ -0,0 +1,553 @@
+/*
+
+    Project.
+
+        Wrappuh Atlas Packer
+
+    Abstract.
+
+        Packs a list of 24-bit BMPs into a single atlas BMP, along with an index that
+        W_LoadAtlas () reads to find each image in it. Images are sorted by height and laid
+        out in rows, tallest first, and the space left over is filled with the mask color so
+        it never gets drawn.
+
+        The list is a text file with one BMP filename per line. The same filenames are used
+        as the images' names in the index, so a game can look an image up by the filename
+        it used to load it from. Filenames can't contain spaces.
+
+        The index is a text file. Its first line is the atlas BMP's filename, relative to the
+        index, and its second is the number of images. Each line after that has an image's
+        name, followed by the X, Y, width and height of its rectangle in the atlas.
+
+        Doesn't use Wrappuh, so it builds as a plain console program and runs from the
+        directory the listed filenames are relative to.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #ifndef TRUE
+    #define TRUE                                1
+    #endif
+    #ifndef FALSE
+    #define FALSE                               0
+    #endif
+
+    // ---- Packer ----------------------------------------------------------------------------
+
+        #define MAX_FILENAME_SIZE               256
+        #define MAX_IMAGE_COUNT                 1024
+
+        #define DEFAULT_ATLAS_WIDTH             1024
+        #define MAX_ATLAS_WIDTH                 8192
+
+        #define MASK_COLOR_R                    255         // Magenta is never drawn
+        #define MASK_COLOR_G                    0
+        #define MASK_COLOR_B                    255
+
+        #define ATLAS_BMP_EXT                   ".bmp"
+        #define ATLAS_INDEX_EXT                 ".atl"
+
+// ---- Macros --------------------------------------------------------------------------------
+
+    // BMP headers are little-endian, whatever the host is
+
+    #define ReadBMPWord( pBuffer, iOffset )     \
+                                                \
+        ( ( pBuffer ) [ iOffset ] | ( ( pBuffer ) [ ( iOffset ) + 1 ] << 8 ) )
+
+    #define ReadBMPDWord( pBuffer, iOffset )    \
+                                                \
+        ( ReadBMPWord ( pBuffer, iOffset ) | ( ReadBMPWord ( pBuffer, ( iOffset ) + 2 ) << 16 ) )
+
+    #define WriteBMPWord( pBuffer, iOffset, iValue )                \
+    {                                                               \
+        ( pBuffer ) [ iOffset ] = ( unsigned char ) ( iValue );     \
+        ( pBuffer ) [ ( iOffset ) + 1 ] = ( unsigned char ) ( ( iValue ) >> 8 );  \
+    }
+
+    #define WriteBMPDWord( pBuffer, iOffset, iValue )               \
+    {                                                               \
+        WriteBMPWord ( pBuffer, iOffset, ( iValue ) );              \
+        WriteBMPWord ( pBuffer, ( iOffset ) + 2, ( iValue ) >> 16 );\
+    }
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct                                      // An image being packed
+    {
+        char pstrFilename [ MAX_FILENAME_SIZE ];
+        unsigned char * pPixels;                        // Top-down RGB triples
+        int iXRes,
+            iYRes;
+        int iX,                                         // Where it goes in the atlas
+            iY;
+    }
+        AtlasImage;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    AtlasImage g_Images [ MAX_IMAGE_COUNT ];
+    int g_iImageCount;
+
+    int g_iAtlasXRes;
+    int g_iAtlasYRes;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    int LoadBMP ( AtlasImage * Image );
+    int LoadImageList ( char * pstrListFilename );
+    void FreeImages ();
+
+    int CompareImageHeights ( const void * pA, const void * pB );
+    int PackImages ();
+
+    int WriteAtlasBMP ( char * pstrFilename );
+    int WriteAtlasIndex ( char * pstrFilename, char * pstrBMPFilename );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "Wrappuh Atlas Packer\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tATLASPACK List Atlas [Width]\n" );
+        printf ( "\n" );
+        printf ( "\t- List is a text file naming one 24-bit BMP per line.\n" );
+        printf ( "\t- Atlas is the name to give the atlas, without an extension. Writes\n" );
+        printf ( "\t  Atlas%s and its index, Atlas%s.\n", ATLAS_BMP_EXT, ATLAS_INDEX_EXT );
+        printf ( "\t- Width is the width of the atlas in pixels (%d by default).\n", DEFAULT_ATLAS_WIDTH );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadBMP ()
+    *
+    *   Loads the image's BMP file, which must be 24-bit, into its pixel buffer.
+    */
+
+    int LoadBMP ( AtlasImage * Image )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( Image->pstrFilename, "rb" ) ) )
+            return FALSE;
+
+        // Read the file and image headers, which are 14 and 40 bytes respectively
+
+        unsigned char pHeader [ 54 ];
+        if ( fread ( pHeader, 1, sizeof ( pHeader ), pFile ) != sizeof ( pHeader ) ||
+             ReadBMPWord ( pHeader, 0 ) != 0x4D42 ||
+             ReadBMPWord ( pHeader, 28 ) != 24 )
+        {
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        int iOffBits = ReadBMPDWord ( pHeader, 10 );
+        int iXRes = ReadBMPDWord ( pHeader, 18 );
+        int iYRes = ReadBMPDWord ( pHeader, 22 );
+
+        if ( iXRes <= 0 || iYRes <= 0 )
+        {
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        int iScanlineByteSize = ( iXRes * 3 + 3 ) & ~ 3;
+
+        unsigned char * pScanline = ( unsigned char * ) malloc ( iScanlineByteSize );
+        Image->pPixels = ( unsigned char * ) malloc ( iXRes * iYRes * 3 );
+
+        if ( ! pScanline || ! Image->pPixels )
+        {
+            free ( pScanline );
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        // BMPs are stored bottom-up
+
+        fseek ( pFile, iOffBits, SEEK_SET );
+
+        for ( int iY = iYRes - 1; iY >= 0; -- iY )
+        {
+            if ( fread ( pScanline, 1, iScanlineByteSize, pFile ) != ( size_t ) iScanlineByteSize )
+            {
+                free ( pScanline );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            memcpy ( Image->pPixels + iY * iXRes * 3, pScanline, iXRes * 3 );
+        }
+
+        free ( pScanline );
+        fclose ( pFile );
+
+        Image->iXRes = iXRes;
+        Image->iYRes = iYRes;
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadImageList ()
+    *
+    *   Reads the list of BMPs and loads each one.
+    */
+
+    int LoadImageList ( char * pstrListFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrListFilename, "r" ) ) )
+        {
+            printf ( "Could not open %s.\n", pstrListFilename );
+            return FALSE;
+        }
+
+        char pstrFilename [ MAX_FILENAME_SIZE ];
+
+        while ( fscanf ( pFile, "%255s", pstrFilename ) == 1 )
+        {
+            if ( g_iImageCount == MAX_IMAGE_COUNT )
+            {
+                printf ( "Too many images; the most an atlas can hold is %d.\n", MAX_IMAGE_COUNT );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            AtlasImage * Image = & g_Images [ g_iImageCount ];
+            strcpy ( Image->pstrFilename, pstrFilename );
+            Image->pPixels = NULL;
+            ++ g_iImageCount;
+
+            if ( ! LoadBMP ( Image ) )
+            {
+                printf ( "Could not load %s. Only 24-bit BMPs can be packed.\n", pstrFilename );
+                fclose ( pFile );
+                return FALSE;
+            }
+        }
+
+        fclose ( pFile );
+
+        if ( ! g_iImageCount )
+        {
+            printf ( "%s doesn't list any images.\n", pstrListFilename );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeImages ()
+    *
+    *   Frees every loaded image.
+    */
+
+    void FreeImages ()
+    {
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+            free ( g_Images [ iCurrImage ].pPixels );
+
+        g_iImageCount = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   CompareImageHeights ()
+    *
+    *   qsort () comparison function for ordering images tallest first. Images of the same
+    *   height are ordered widest first, then by their place in the list, so the layout
+    *   doesn't depend on the qsort () implementation.
+    */
+
+    int CompareImageHeights ( const void * pA, const void * pB )
+    {
+        AtlasImage * ImageA = & g_Images [ * ( int * ) pA ];
+        AtlasImage * ImageB = & g_Images [ * ( int * ) pB ];
+
+        if ( ImageA->iYRes != ImageB->iYRes )
+            return ImageB->iYRes - ImageA->iYRes;
+
+        if ( ImageA->iXRes != ImageB->iXRes )
+            return ImageB->iXRes - ImageA->iXRes;
+
+        return * ( int * ) pA - * ( int * ) pB;
+    }
+
+    /******************************************************************************************
+    *
+    *   PackImages ()
+    *
+    *   Lays the images out in rows across the atlas, tallest first, starting a new row
+    *   whenever the next image won't fit on the current one. Each row is as tall as its
+    *   first image. Sets the atlas's height to fit the last row.
+    */
+
+    int PackImages ()
+    {
+        int piOrder [ MAX_IMAGE_COUNT ];
+
+        int iCurrImage;
+        for ( iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            if ( g_Images [ iCurrImage ].iXRes > g_iAtlasXRes )
+            {
+                printf ( "%s is wider than the atlas.\n", g_Images [ iCurrImage ].pstrFilename );
+                return FALSE;
+            }
+
+            piOrder [ iCurrImage ] = iCurrImage;
+        }
+
+        qsort ( piOrder, g_iImageCount, sizeof ( int ), CompareImageHeights );
+
+        int iRowX = 0,
+            iRowY = 0,
+            iRowYRes = 0;
+
+        for ( iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            AtlasImage * Image = & g_Images [ piOrder [ iCurrImage ] ];
+
+            if ( iRowX + Image->iXRes > g_iAtlasXRes )
+            {
+                iRowX = 0;
+                iRowY += iRowYRes;
+                iRowYRes = 0;
+            }
+
+            if ( ! iRowYRes )
+                iRowYRes = Image->iYRes;
+
+            Image->iX = iRowX;
+            Image->iY = iRowY;
+
+            iRowX += Image->iXRes;
+        }
+
+        g_iAtlasYRes = iRowY + iRowYRes;
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteAtlasBMP ()
+    *
+    *   Writes the packed images out as a 24-bit BMP.
+    */
+
+    int WriteAtlasBMP ( char * pstrFilename )
+    {
+        int iScanlineByteSize = ( g_iAtlasXRes * 3 + 3 ) & ~ 3;
+
+        // Start with the mask color everywhere, then copy each image into place
+
+        unsigned char * pPixels = ( unsigned char * ) malloc ( iScanlineByteSize * g_iAtlasYRes );
+        if ( ! pPixels )
+            return FALSE;
+
+        memset ( pPixels, 0, iScanlineByteSize * g_iAtlasYRes );
+
+        int iX,
+            iY;
+
+        for ( iY = 0; iY < g_iAtlasYRes; ++ iY )
+        {
+            unsigned char * pRow = pPixels + iY * iScanlineByteSize;
+
+            for ( iX = 0; iX < g_iAtlasXRes; ++ iX )
+            {
+                pRow [ iX * 3 ] = MASK_COLOR_B;
+                pRow [ iX * 3 + 1 ] = MASK_COLOR_G;
+                pRow [ iX * 3 + 2 ] = MASK_COLOR_R;
+            }
+        }
+
+        // BMPs are stored bottom-up
+
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            AtlasImage * Image = & g_Images [ iCurrImage ];
+
+            for ( iY = 0; iY < Image->iYRes; ++ iY )
+                memcpy ( pPixels + ( g_iAtlasYRes - 1 - ( Image->iY + iY ) ) * iScanlineByteSize + Image->iX * 3,
+                         Image->pPixels + iY * Image->iXRes * 3,
+                         Image->iXRes * 3 );
+        }
+
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "wb" ) ) )
+        {
+            free ( pPixels );
+            return FALSE;
+        }
+
+        // Write the file and image headers, which are 14 and 40 bytes respectively
+
+        unsigned char pHeader [ 54 ];
+        memset ( pHeader, 0, sizeof ( pHeader ) );
+
+        WriteBMPWord ( pHeader, 0, 0x4D42 );
+        WriteBMPDWord ( pHeader, 2, sizeof ( pHeader ) + iScanlineByteSize * g_iAtlasYRes );
+        WriteBMPDWord ( pHeader, 10, sizeof ( pHeader ) );
+        WriteBMPDWord ( pHeader, 14, 40 );
+        WriteBMPDWord ( pHeader, 18, g_iAtlasXRes );
+        WriteBMPDWord ( pHeader, 22, g_iAtlasYRes );
+        WriteBMPWord ( pHeader, 26, 1 );
+        WriteBMPWord ( pHeader, 28, 24 );
+        WriteBMPDWord ( pHeader, 34, iScanlineByteSize * g_iAtlasYRes );
+
+        int iResult = fwrite ( pHeader, 1, sizeof ( pHeader ), pFile ) == sizeof ( pHeader ) &&
+                      fwrite ( pPixels, 1, iScanlineByteSize * g_iAtlasYRes, pFile ) == ( size_t ) ( iScanlineByteSize * g_iAtlasYRes );
+
+        fclose ( pFile );
+        free ( pPixels );
+
+        return iResult;
+    }
+
+    /******************************************************************************************
+    *
+    *   WriteAtlasIndex ()
+    *
+    *   Writes the atlas's index, listing the images in the order they were given.
+    */
+
+    int WriteAtlasIndex ( char * pstrFilename, char * pstrBMPFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "w" ) ) )
+            return FALSE;
+
+        // The BMP sits next to the index, so only its name is written
+
+        char * pstrBMPName = pstrBMPFilename;
+        for ( char * pstrCurrChar = pstrBMPFilename; * pstrCurrChar; ++ pstrCurrChar )
+            if ( * pstrCurrChar == '/' || * pstrCurrChar == '\\' )
+                pstrBMPName = pstrCurrChar + 1;
+
+        fprintf ( pFile, "%s\n", pstrBMPName );
+        fprintf ( pFile, "%d\n", g_iImageCount );
+
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            AtlasImage * Image = & g_Images [ iCurrImage ];
+            fprintf ( pFile, "%s %d %d %d %d\n", Image->pstrFilename, Image->iX, Image->iY, Image->iXRes, Image->iYRes );
+        }
+
+        int iResult = ! ferror ( pFile );
+        fclose ( pFile );
+
+        return iResult;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    int main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the list, the atlas name and the width, if it was specified
+
+        if ( argc < 3 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        g_iAtlasXRes = DEFAULT_ATLAS_WIDTH;
+
+        if ( argc > 3 )
+            g_iAtlasXRes = atoi ( argv [ 3 ] );
+
+        if ( g_iAtlasXRes <= 0 || g_iAtlasXRes > MAX_ATLAS_WIDTH ||
+             strlen ( argv [ 2 ] ) + strlen ( ATLAS_INDEX_EXT ) >= MAX_FILENAME_SIZE )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        char pstrBMPFilename [ MAX_FILENAME_SIZE ];
+        char pstrIndexFilename [ MAX_FILENAME_SIZE ];
+
+        strcpy ( pstrBMPFilename, argv [ 2 ] );
+        strcat ( pstrBMPFilename, ATLAS_BMP_EXT );
+        strcpy ( pstrIndexFilename, argv [ 2 ] );
+        strcat ( pstrIndexFilename, ATLAS_INDEX_EXT );
+
+        // Load and pack the images, then write the atlas and its index
+
+        if ( ! LoadImageList ( argv [ 1 ] ) || ! PackImages () )
+        {
+            FreeImages ();
+            return 1;
+        }
+
+        if ( ! WriteAtlasBMP ( pstrBMPFilename ) )
+        {
+            printf ( "Could not write %s.\n", pstrBMPFilename );
+            FreeImages ();
+            return 1;
+        }
+
+        if ( ! WriteAtlasIndex ( pstrIndexFilename, pstrBMPFilename ) )
+        {
+            printf ( "Could not write %s.\n", pstrIndexFilename );
+            FreeImages ();
+            return 1;
+        }
+
+        // Report how well the images filled the atlas
+
+        double dImageArea = 0;
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+            dImageArea += g_Images [ iCurrImage ].iXRes * g_Images [ iCurrImage ].iYRes;
+
+        printf ( "Packed %d images into a %dx%d atlas (%.1f%% used).\n",
+                 g_iImageCount, g_iAtlasXRes, g_iAtlasYRes,
+                 100.0 * dImageArea / ( ( double ) g_iAtlasXRes * g_iAtlasYRes ) );
+
+        FreeImages ();
+
+        return 0;
+    }
@@ -0,0 +1,318 @@
+/*
+
+    Project.
+
+        Wrappuh Blit Benchmark
+
+    Abstract.
+
+        Times the headless backend's fills and color-keyed blits with each kernel the CPU can
+        run, at each color depth, and reports how many megapixels per second each one draws.
+        The framebuffer is checksummed after every test, and every kernel has to produce the
+        same checksum as the scalar one.
+
+        Built with wrappuh_soft.cpp and WRAPPUH_HEADLESS defined, and run from Lockdown's
+        Executable directory so it can find the images it blits.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "wrappuh.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Benchmark -------------------------------------------------------------------------
+
+        #define SCREEN_WIDTH                640         // The framebuffer's resolution
+        #define SCREEN_HEIGHT               480
+
+        #define DEFAULT_FRAME_COUNT         1000        // Frames to run each test by default
+
+        #define BG_FILENAME                 "Gfx/Rooms/BG_Lit.bmp"
+        #define SPRITE_FILENAME             "Gfx/Droids/Blue/South.bmp"
+        #define LASER_FILENAME              "Gfx/Weapons/Player/East/0.bmp"
+
+        #define SPRITES_PER_FRAME           64          // Droid-sized blits per frame
+        #define LASERS_PER_FRAME            512         // Laser-sized blits per frame
+
+    // ---- Tests -----------------------------------------------------------------------------
+
+        #define TEST_CLEAR                  0           // Clear the whole framebuffer
+        #define TEST_BG                     1           // Blit a full-screen background
+        #define TEST_SPRITES                2           // Blit droids, some partly off-screen
+        #define TEST_LASERS                 3           // Blit lots of small sprites
+        #define TEST_COUNT                  4
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    int g_iFrameCount;                                  // The number of frames to run
+
+    W_Image g_BG;                                       // The images being blitted
+    W_Image g_Sprite;
+    W_Image g_Laser;
+
+    char * g_ppstrTestNames [ TEST_COUNT ] = { "Clear", "Background", "Sprites", "Lasers" };
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    int GetClippedArea ( W_Image * Image, int iX, int iY );
+    void RunTest ( int iTest, DWORD * piTime, double * pdPixels, unsigned int * piChecksum );
+    int RunBenchmark ( int iColorDepth );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "Wrappuh Blit Benchmark\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tBLITBENCH [Frames]\n" );
+        printf ( "\n" );
+        printf ( "\t- Frames is the number of frames to run each test (%d by default).\n", DEFAULT_FRAME_COUNT );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   GetClippedArea ()
+    *
+    *   Returns the number of pixels of an image that land on the screen when it's blitted to
+    *   the specified position.
+    */
+
+    int GetClippedArea ( W_Image * Image, int iX, int iY )
+    {
+        int iX0 = iX < 0 ? 0 : iX,
+            iY0 = iY < 0 ? 0 : iY,
+            iX1 = iX + Image->iXRes > SCREEN_WIDTH ? SCREEN_WIDTH : iX + Image->iXRes,
+            iY1 = iY + Image->iYRes > SCREEN_HEIGHT ? SCREEN_HEIGHT : iY + Image->iYRes;
+
+        if ( iX1 <= iX0 || iY1 <= iY0 )
+            return 0;
+
+        return ( iX1 - iX0 ) * ( iY1 - iY0 );
+    }
+
+    /******************************************************************************************
+    *
+    *   RunTest ()
+    *
+    *   Runs one of the tests with the current kernel, returning how long it took, how many
+    *   pixels it drew and the checksum of the final frame. Sprite positions come from a
+    *   fixed seed, so every kernel draws the same thing.
+    */
+
+    void RunTest ( int iTest, DWORD * piTime, double * pdPixels, unsigned int * piChecksum )
+    {
+        W_Image * Image = NULL;
+        int iBlitsPerFrame = 1;
+        int iMinX = 0,
+            iMinY = 0;
+
+        switch ( iTest )
+        {
+            case TEST_BG:
+                Image = & g_BG;
+                break;
+
+            case TEST_SPRITES:
+                Image = & g_Sprite;
+                iBlitsPerFrame = SPRITES_PER_FRAME;
+                break;
+
+            case TEST_LASERS:
+                Image = & g_Laser;
+                iBlitsPerFrame = LASERS_PER_FRAME;
+                break;
+        }
+
+        // Let sprites hang halfway off any edge of the screen, so clipping gets tested too
+
+        if ( Image && iTest != TEST_BG )
+        {
+            iMinX = - Image->iXRes / 2;
+            iMinY = - Image->iYRes / 2;
+        }
+
+        W_ClearFrame ();
+        srand ( 1 );
+
+        double dPixels = 0;
+        W_Int64 iStartTime = W_GetHighPerformanceTickCount ();
+
+        for ( int iCurrFrame = 0; iCurrFrame < g_iFrameCount; ++ iCurrFrame )
+        {
+            if ( ! Image )
+            {
+                W_ClearFrame ();
+                dPixels += SCREEN_WIDTH * SCREEN_HEIGHT;
+                continue;
+            }
+
+            for ( int iCurrBlit = 0; iCurrBlit < iBlitsPerFrame; ++ iCurrBlit )
+            {
+                int iX = 0,
+                    iY = 0;
+
+                if ( iTest != TEST_BG )
+                {
+                    iX = W_GetRandInRange ( iMinX, SCREEN_WIDTH - Image->iXRes / 2 );
+                    iY = W_GetRandInRange ( iMinY, SCREEN_HEIGHT - Image->iYRes / 2 );
+                }
+
+                W_BlitImage ( * Image, iX, iY );
+                dPixels += GetClippedArea ( Image, iX, iY );
+            }
+        }
+
+        * piTime = ( DWORD ) ( W_GetHighPerformanceTickCount () - iStartTime );
+        * pdPixels = dPixels;
+        * piChecksum = W_GetFrameChecksum ();
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBenchmark ()
+    *
+    *   Runs every test with every kernel at the specified color depth and prints the
+    *   results. Returns FALSE if the benchmark couldn't be run or a kernel's checksum doesn't
+    *   match the scalar kernel's.
+    */
+
+    int RunBenchmark ( int iColorDepth )
+    {
+        // Images are converted to the color depth when they're loaded, so they're reloaded
+        // after every mode change
+
+        if ( ! W_SetVideoMode ( SCREEN_WIDTH, SCREEN_HEIGHT, iColorDepth ) )
+        {
+            printf ( "Could not set a %d-bit video mode.\n", iColorDepth );
+            return FALSE;
+        }
+
+        if ( ! W_LoadImage ( BG_FILENAME, & g_BG ) ||
+             ! W_LoadImage ( SPRITE_FILENAME, & g_Sprite ) ||
+             ! W_LoadImage ( LASER_FILENAME, & g_Laser ) )
+        {
+            printf ( "Could not load the images. Run from Lockdown's Executable directory.\n" );
+            return FALSE;
+        }
+
+        printf ( "%d-bit, %dx%d, %d frames per test (MPix/s)\n", iColorDepth, SCREEN_WIDTH, SCREEN_HEIGHT, g_iFrameCount );
+
+        printf ( "\t%-8s", "Kernel" );
+        int iCurrTest;
+        for ( iCurrTest = 0; iCurrTest < TEST_COUNT; ++ iCurrTest )
+            printf ( "%12s", g_ppstrTestNames [ iCurrTest ] );
+        printf ( "\n" );
+
+        unsigned int piScalarChecksums [ TEST_COUNT ];
+        int iIsMatch = TRUE;
+
+        for ( int iCurrKernel = 0; iCurrKernel < W_BLIT_KERNEL_COUNT; ++ iCurrKernel )
+        {
+            if ( ! W_SetBlitKernel ( iCurrKernel ) )
+                continue;
+
+            printf ( "\t%-8s", W_GetBlitKernelName ( iCurrKernel ) );
+
+            for ( iCurrTest = 0; iCurrTest < TEST_COUNT; ++ iCurrTest )
+            {
+                DWORD iTime;
+                double dPixels;
+                unsigned int iChecksum;
+
+                RunTest ( iCurrTest, & iTime, & dPixels, & iChecksum );
+
+                if ( iCurrKernel == W_BLIT_KERNEL_SCALAR )
+                    piScalarChecksums [ iCurrTest ] = iChecksum;
+                else if ( iChecksum != piScalarChecksums [ iCurrTest ] )
+                    iIsMatch = FALSE;
+
+                if ( iTime )
+                    printf ( "%12.1f", dPixels / ( iTime * 1000.0 ) );
+                else
+                    printf ( "%12s", "-" );
+            }
+
+            printf ( "\n" );
+        }
+
+        printf ( "\n" );
+
+        W_FreeImage ( & g_BG );
+        W_FreeImage ( & g_Sprite );
+        W_FreeImage ( & g_Laser );
+
+        if ( ! iIsMatch )
+        {
+            printf ( "Checksums don't match.\n" );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    int main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the frame count, if it was specified
+
+        g_iFrameCount = DEFAULT_FRAME_COUNT;
+
+        if ( argc > 1 )
+            g_iFrameCount = atoi ( argv [ 1 ] );
+
+        if ( g_iFrameCount <= 0 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        if ( ! W_InitWrappuh ( "Wrappuh Blit Benchmark", NULL, 0 ) )
+        {
+            printf ( "Could not initialize Wrappuh.\n" );
+            return 1;
+        }
+
+        int iKernel = W_GetBlitKernel ();
+        int iResult = 0;
+
+        if ( ! RunBenchmark ( 32 ) || ! RunBenchmark ( 16 ) || ! RunBenchmark ( 15 ) )
+            iResult = 1;
+
+        W_SetBlitKernel ( iKernel );
+        W_ShutDownWrappuh ();
+
+        return iResult;
+    }
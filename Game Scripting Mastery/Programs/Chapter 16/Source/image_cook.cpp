@@ -0,0 +1,593 @@
+/*
+
+    Project.
+
+        Wrappuh Image Cooker
+
+    Abstract.
+
+        Cooks a list of 24-bit BMPs into an image pack, which W_OpenImagePack () maps into
+        memory so W_LoadImage () can skip reading and converting the BMPs. Each image is
+        converted to the color depth it'll be drawn at, exactly as W_LoadImage () would
+        convert it, and the bounding box of its opaque pixels is worked out ahead of time.
+
+        The list is a text file with one BMP filename per line, the same format the atlas
+        packer reads. The filenames are used as the images' names in the pack, so a game
+        finds an image by loading it from the filename it always has. Filenames can't
+        contain spaces.
+
+        A pack is little-endian, and starts with a 16-byte header:
+
+            0   "WPAK"
+            4   Version
+            8   Color depth (15, 16 or 32)
+            12  Image count
+
+        It's followed by a 160-byte directory entry for each image:
+
+            0   Name, null-terminated
+            128 Width and height
+            136 Pitch, in bytes
+            140 Bounding box of the opaque pixels, as W_Image's ClipRect holds it
+            156 Offset of the pixels from the start of the pack
+
+        Each image's pixels are stored top-down, a row per pitch, starting on a 32-byte
+        boundary. The pitch is rounded up to 32 bytes as well, so rows can be copied
+        straight into the headless backend's images.
+
+        Doesn't use Wrappuh, so it builds as a plain console program and runs from the
+        directory the listed filenames are relative to.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    #ifndef TRUE
+    #define TRUE                                1
+    #endif
+    #ifndef FALSE
+    #define FALSE                               0
+    #endif
+
+    // ---- Cooker ----------------------------------------------------------------------------
+
+        #define MAX_FILENAME_SIZE               256
+        #define MAX_IMAGE_COUNT                 1024
+
+        #define DEFAULT_COLOR_DEPTH             32
+
+        #define MASK_COLOR_R                    255         // Magenta is never drawn
+        #define MASK_COLOR_G                    0
+        #define MASK_COLOR_B                    255
+
+    // ---- Pack ------------------------------------------------------------------------------
+
+        #define PACK_ID_STRING                  "WPAK"
+        #define PACK_VERSION                    1
+
+        #define PACK_HEADER_SIZE                16
+        #define PACK_ENTRY_SIZE                 160
+        #define PACK_NAME_SIZE                  128         // Including the null terminator
+
+        #define PACK_ALIGN                      32          // Pixels and pitches are
+                                                            // multiples of this
+
+// ---- Macros --------------------------------------------------------------------------------
+
+    // BMP headers and packs are little-endian, whatever the host is
+
+    #define ReadBMPWord( pBuffer, iOffset )     \
+                                                \
+        ( ( pBuffer ) [ iOffset ] | ( ( pBuffer ) [ ( iOffset ) + 1 ] << 8 ) )
+
+    #define ReadBMPDWord( pBuffer, iOffset )    \
+                                                \
+        ( ReadBMPWord ( pBuffer, iOffset ) | ( ReadBMPWord ( pBuffer, ( iOffset ) + 2 ) << 16 ) )
+
+    #define WritePackWord( pBuffer, iOffset, iValue )               \
+    {                                                               \
+        ( pBuffer ) [ iOffset ] = ( unsigned char ) ( iValue );     \
+        ( pBuffer ) [ ( iOffset ) + 1 ] = ( unsigned char ) ( ( iValue ) >> 8 );  \
+    }
+
+    #define WritePackDWord( pBuffer, iOffset, iValue )              \
+    {                                                               \
+        WritePackWord ( pBuffer, iOffset, ( iValue ) );             \
+        WritePackWord ( pBuffer, ( iOffset ) + 2, ( iValue ) >> 16 );\
+    }
+
+    // The same pixel formats Wrappuh uses
+
+    #define EncodePixel15( iR, iG, iB )         \
+                                                \
+        ( ( iB & 31 ) | ( ( iG & 31 ) << 5 ) | ( ( iR & 31 ) << 10 ) )
+
+    #define EncodePixel16( iR, iG, iB )         \
+                                                \
+        ( ( iB & 31 ) | ( ( iG & 63 ) << 6 ) | ( ( iR & 31 ) << 11 ) )
+
+    #define EncodePixel32( iR, iG, iB )         \
+                                                \
+        ( iB | ( iG << 8 ) | ( iR << 16 ) )
+
+    #define GetAlignedSize( iSize )             \
+                                                \
+        ( ( ( iSize ) + PACK_ALIGN - 1 ) & ~ ( PACK_ALIGN - 1 ) )
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+    typedef struct                                      // A clip rectangle, laid out like
+    {                                                   // Wrappuh's W_Rect
+        int iX0,
+            iX1,
+            iY0,
+            iY1;
+    }
+        ClipRect;
+
+    typedef struct                                      // An image being cooked
+    {
+        char pstrFilename [ MAX_FILENAME_SIZE ];
+        unsigned char * pPixels;                        // Converted pixels, top-down
+        int iXRes,
+            iYRes;
+        int iPitch;
+        ClipRect OpaqueRect;
+        int iOffset;                                    // Where its pixels go in the pack
+    }
+        CookedImage;
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    CookedImage g_Images [ MAX_IMAGE_COUNT ];
+    int g_iImageCount;
+
+    int g_iColorDepth;
+    int g_iPixelSize;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    int LoadBMP ( CookedImage * Image );
+    int LoadImageList ( char * pstrListFilename );
+    void FreeImages ();
+
+    int IsPixelOpaque ( CookedImage * Image, int iX, int iY );
+    ClipRect GetOpaqueRect ( CookedImage * Image );
+
+    int WritePack ( char * pstrFilename );
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "Wrappuh Image Cooker\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tIMAGECOOK List Pack [ColorDepth]\n" );
+        printf ( "\n" );
+        printf ( "\t- List is a text file naming one 24-bit BMP per line.\n" );
+        printf ( "\t- Pack is the filename to write the image pack to.\n" );
+        printf ( "\t- ColorDepth is the depth the game will run at: 15, 16 or 32 (%d by\n", DEFAULT_COLOR_DEPTH );
+        printf ( "\t  default). The pack is only used in a video mode of the same depth.\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadBMP ()
+    *
+    *   Loads the image's BMP file, which must be 24-bit, and converts it to the pack's color
+    *   depth. Magenta converts to the mask color at every depth.
+    */
+
+    int LoadBMP ( CookedImage * Image )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( Image->pstrFilename, "rb" ) ) )
+            return FALSE;
+
+        // Read the file and image headers, which are 14 and 40 bytes respectively
+
+        unsigned char pHeader [ 54 ];
+        if ( fread ( pHeader, 1, sizeof ( pHeader ), pFile ) != sizeof ( pHeader ) ||
+             ReadBMPWord ( pHeader, 0 ) != 0x4D42 ||
+             ReadBMPWord ( pHeader, 28 ) != 24 )
+        {
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        int iOffBits = ReadBMPDWord ( pHeader, 10 );
+        int iXRes = ReadBMPDWord ( pHeader, 18 );
+        int iYRes = ReadBMPDWord ( pHeader, 22 );
+
+        if ( iXRes <= 0 || iYRes <= 0 )
+        {
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        int iScanlineByteSize = ( iXRes * 3 + 3 ) & ~ 3;
+        int iPitch = GetAlignedSize ( iXRes * g_iPixelSize );
+
+        unsigned char * pScanline = ( unsigned char * ) malloc ( iScanlineByteSize );
+        Image->pPixels = ( unsigned char * ) calloc ( iPitch, iYRes );
+
+        if ( ! pScanline || ! Image->pPixels )
+        {
+            free ( pScanline );
+            fclose ( pFile );
+            return FALSE;
+        }
+
+        // BMPs are stored bottom-up
+
+        fseek ( pFile, iOffBits, SEEK_SET );
+
+        for ( int iY = iYRes - 1; iY >= 0; -- iY )
+        {
+            if ( fread ( pScanline, 1, iScanlineByteSize, pFile ) != ( size_t ) iScanlineByteSize )
+            {
+                free ( pScanline );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            unsigned char * pRow = Image->pPixels + iY * iPitch;
+
+            for ( int iX = 0; iX < iXRes; ++ iX )
+            {
+                int iR = pScanline [ iX * 3 + 2 ],
+                    iG = pScanline [ iX * 3 + 1 ],
+                    iB = pScanline [ iX * 3 ];
+
+                // Pixels are stored the way a little-endian host holds them in memory
+
+                switch ( g_iColorDepth )
+                {
+                    case 15:
+                        WritePackWord ( pRow, iX * 2, EncodePixel15 ( iR >> 3, iG >> 3, iB >> 3 ) );
+                        break;
+
+                    case 16:
+                        WritePackWord ( pRow, iX * 2, EncodePixel16 ( iR >> 3, iG >> 3, iB >> 3 ) );
+                        break;
+
+                    case 32:
+                        WritePackDWord ( pRow, iX * 4, EncodePixel32 ( iR, iG, iB ) );
+                        break;
+                }
+            }
+        }
+
+        free ( pScanline );
+        fclose ( pFile );
+
+        Image->iXRes = iXRes;
+        Image->iYRes = iYRes;
+        Image->iPitch = iPitch;
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   LoadImageList ()
+    *
+    *   Reads the list of BMPs and loads each one.
+    */
+
+    int LoadImageList ( char * pstrListFilename )
+    {
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrListFilename, "r" ) ) )
+        {
+            printf ( "Could not open %s.\n", pstrListFilename );
+            return FALSE;
+        }
+
+        char pstrFilename [ MAX_FILENAME_SIZE ];
+
+        while ( fscanf ( pFile, "%255s", pstrFilename ) == 1 )
+        {
+            if ( g_iImageCount == MAX_IMAGE_COUNT )
+            {
+                printf ( "Too many images; the most a pack can hold is %d.\n", MAX_IMAGE_COUNT );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            if ( strlen ( pstrFilename ) >= PACK_NAME_SIZE )
+            {
+                printf ( "%s is too long a name; the longest a pack can hold is %d characters.\n", pstrFilename, PACK_NAME_SIZE - 1 );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            CookedImage * Image = & g_Images [ g_iImageCount ];
+            strcpy ( Image->pstrFilename, pstrFilename );
+            Image->pPixels = NULL;
+            ++ g_iImageCount;
+
+            if ( ! LoadBMP ( Image ) )
+            {
+                printf ( "Could not load %s. Only 24-bit BMPs can be cooked.\n", pstrFilename );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            Image->OpaqueRect = GetOpaqueRect ( Image );
+        }
+
+        fclose ( pFile );
+
+        if ( ! g_iImageCount )
+        {
+            printf ( "%s doesn't list any images.\n", pstrListFilename );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    /******************************************************************************************
+    *
+    *   FreeImages ()
+    *
+    *   Frees every loaded image.
+    */
+
+    void FreeImages ()
+    {
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+            free ( g_Images [ iCurrImage ].pPixels );
+
+        g_iImageCount = 0;
+    }
+
+    /******************************************************************************************
+    *
+    *   IsPixelOpaque ()
+    *
+    *   Returns TRUE if the specified pixel of a converted image isn't the mask color.
+    */
+
+    int IsPixelOpaque ( CookedImage * Image, int iX, int iY )
+    {
+        unsigned char * pRow = Image->pPixels + iY * Image->iPitch;
+
+        switch ( g_iColorDepth )
+        {
+            case 15:
+                return ReadBMPWord ( pRow, iX * 2 ) != EncodePixel15 ( MASK_COLOR_R >> 3, MASK_COLOR_G, MASK_COLOR_B >> 3 );
+
+            case 16:
+                return ReadBMPWord ( pRow, iX * 2 ) != EncodePixel16 ( MASK_COLOR_R >> 3, MASK_COLOR_G, MASK_COLOR_B >> 3 );
+
+            default:
+                return ( unsigned int ) ReadBMPDWord ( pRow, iX * 4 ) != EncodePixel32 ( MASK_COLOR_R, MASK_COLOR_G, MASK_COLOR_B );
+        }
+    }
+
+    /******************************************************************************************
+    *
+    *   GetOpaqueRect ()
+    *
+    *   Finds the bounding box of the image's opaque pixels, scanning in from each edge the
+    *   same way W_LoadImage () does, so the box matches the one it would have found. Its
+    *   second corner is stored as a width and height.
+    */
+
+    ClipRect GetOpaqueRect ( CookedImage * Image )
+    {
+        ClipRect OpaqueRect;
+
+        int iX,
+            iY;
+
+        for ( iX = 0; iX < Image->iXRes; ++ iX )
+        {
+            for ( iY = 0; iY < Image->iYRes; ++ iY )
+                if ( IsPixelOpaque ( Image, iX, iY ) )
+                    break;
+            if ( iY < Image->iYRes )
+                break;
+        }
+        OpaqueRect.iX0 = iX;
+
+        for ( iX = Image->iXRes - 1; iX >= 0; -- iX )
+        {
+            for ( iY = 0; iY < Image->iYRes; ++ iY )
+                if ( IsPixelOpaque ( Image, iX, iY ) )
+                    break;
+            if ( iY < Image->iYRes )
+                break;
+        }
+        OpaqueRect.iX1 = iX;
+
+        for ( iY = 0; iY < Image->iYRes; ++ iY )
+        {
+            for ( iX = 0; iX < Image->iXRes; ++ iX )
+                if ( IsPixelOpaque ( Image, iX, iY ) )
+                    break;
+            if ( iX < Image->iXRes )
+                break;
+        }
+        OpaqueRect.iY0 = iY;
+
+        for ( iY = Image->iYRes - 1; iY >= 0; -- iY )
+        {
+            for ( iX = 0; iX < Image->iXRes; ++ iX )
+                if ( IsPixelOpaque ( Image, iX, iY ) )
+                    break;
+            if ( iX < Image->iXRes )
+                break;
+        }
+        OpaqueRect.iY1 = iY;
+
+        OpaqueRect.iX1 -= OpaqueRect.iX0;
+        OpaqueRect.iY1 -= OpaqueRect.iY0;
+
+        return OpaqueRect;
+    }
+
+    /******************************************************************************************
+    *
+    *   WritePack ()
+    *
+    *   Writes the header and directory, then each image's pixels in the order they were
+    *   listed, padded out to the next 32-byte boundary.
+    */
+
+    int WritePack ( char * pstrFilename )
+    {
+        // Lay the pixels out after the directory
+
+        int iDirSize = PACK_HEADER_SIZE + g_iImageCount * PACK_ENTRY_SIZE;
+        int iOffset = GetAlignedSize ( iDirSize );
+
+        int iCurrImage;
+        for ( iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            g_Images [ iCurrImage ].iOffset = iOffset;
+            iOffset += GetAlignedSize ( g_Images [ iCurrImage ].iPitch * g_Images [ iCurrImage ].iYRes );
+        }
+
+        unsigned char * pDir = ( unsigned char * ) calloc ( GetAlignedSize ( iDirSize ), 1 );
+        if ( ! pDir )
+            return FALSE;
+
+        memcpy ( pDir, PACK_ID_STRING, 4 );
+        WritePackDWord ( pDir, 4, PACK_VERSION );
+        WritePackDWord ( pDir, 8, g_iColorDepth );
+        WritePackDWord ( pDir, 12, g_iImageCount );
+
+        for ( iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+        {
+            CookedImage * Image = & g_Images [ iCurrImage ];
+            unsigned char * pEntry = pDir + PACK_HEADER_SIZE + iCurrImage * PACK_ENTRY_SIZE;
+
+            strcpy ( ( char * ) pEntry, Image->pstrFilename );
+            WritePackDWord ( pEntry, 128, Image->iXRes );
+            WritePackDWord ( pEntry, 132, Image->iYRes );
+            WritePackDWord ( pEntry, 136, Image->iPitch );
+            WritePackDWord ( pEntry, 140, Image->OpaqueRect.iX0 );
+            WritePackDWord ( pEntry, 144, Image->OpaqueRect.iY0 );
+            WritePackDWord ( pEntry, 148, Image->OpaqueRect.iX1 );
+            WritePackDWord ( pEntry, 152, Image->OpaqueRect.iY1 );
+            WritePackDWord ( pEntry, 156, Image->iOffset );
+        }
+
+        FILE * pFile;
+        if ( ! ( pFile = fopen ( pstrFilename, "wb" ) ) )
+        {
+            free ( pDir );
+            return FALSE;
+        }
+
+        int iResult = fwrite ( pDir, 1, GetAlignedSize ( iDirSize ), pFile ) == ( size_t ) GetAlignedSize ( iDirSize );
+
+        // Image sizes are multiples of the pitch, which is already aligned, so the images
+        // need no padding between them
+
+        for ( iCurrImage = 0; iCurrImage < g_iImageCount && iResult; ++ iCurrImage )
+        {
+            CookedImage * Image = & g_Images [ iCurrImage ];
+            size_t iSize = Image->iPitch * Image->iYRes;
+
+            iResult = fwrite ( Image->pPixels, 1, iSize, pFile ) == iSize;
+        }
+
+        fclose ( pFile );
+        free ( pDir );
+
+        return iResult;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    int main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the list, the pack's filename and the color depth, if it was specified
+
+        if ( argc < 3 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        g_iColorDepth = DEFAULT_COLOR_DEPTH;
+
+        if ( argc > 3 )
+            g_iColorDepth = atoi ( argv [ 3 ] );
+
+        if ( g_iColorDepth != 15 && g_iColorDepth != 16 && g_iColorDepth != 32 )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        g_iPixelSize = g_iColorDepth == 32 ? 4 : 2;
+
+        // Load and convert the images, then write the pack
+
+        if ( ! LoadImageList ( argv [ 1 ] ) )
+        {
+            FreeImages ();
+            return 1;
+        }
+
+        if ( ! WritePack ( argv [ 2 ] ) )
+        {
+            printf ( "Could not write %s.\n", argv [ 2 ] );
+            FreeImages ();
+            return 1;
+        }
+
+        // Report the pack's size
+
+        double dPackSize = GetAlignedSize ( PACK_HEADER_SIZE + g_iImageCount * PACK_ENTRY_SIZE );
+        for ( int iCurrImage = 0; iCurrImage < g_iImageCount; ++ iCurrImage )
+            dPackSize += g_Images [ iCurrImage ].iPitch * g_Images [ iCurrImage ].iYRes;
+
+        printf ( "Cooked %d images into a %d-bit pack (%.1f MB).\n",
+                 g_iImageCount, g_iColorDepth, dPackSize / ( 1024 * 1024 ) );
+
+        FreeImages ();
+
+        return 0;
+    }
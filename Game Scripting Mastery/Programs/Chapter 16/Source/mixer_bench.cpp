@@ -0,0 +1,301 @@
+/*
+
+    Project.
+
+        Wrappuh Mixer Benchmark
+
+    Abstract.
+
+        Times the headless backend's software mixer with each kernel the CPU can run, at a
+        range of voice counts, and reports how much of one core it takes to keep up with
+        real-time playback. From that it works out how many voices each kernel can mix
+        within a given CPU budget. Every kernel has to produce the same mix, checksum for
+        checksum, as the scalar one.
+
+        Built with wrappuh_soft.cpp and WRAPPUH_HEADLESS defined, and run from Lockdown's
+        Executable directory so it can find the sound it mixes.
+
+    Date Created.
+
+        10.19.2026
+
+*/
+
+// ---- Include Files -------------------------------------------------------------------------
+
+    #include "wrappuh.h"
+
+// ---- Constants -----------------------------------------------------------------------------
+
+    // ---- Benchmark -------------------------------------------------------------------------
+
+        #define SOUND_FILENAME              "Sound/Intro/Intro.wav"     // The longest sound
+
+        #define DEFAULT_BUDGET              5           // Percent of a core by default
+        #define DEFAULT_SECONDS             10          // Seconds of sound to mix by default
+        #define MAX_SECONDS                 15          // Most that fits in the sound once
+                                                        // the voices are staggered
+
+        #define UPDATE_DUR                  10          // Milliseconds mixed per update
+        #define READ_SIZE                   1024        // Frames read from the mixer at a time
+
+        #define CHECKSUM_SEED               2166136261  // FNV-1a
+        #define CHECKSUM_PRIME              16777619
+
+    // ---- Tests -----------------------------------------------------------------------------
+
+        #define TEST_COUNT                  6
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+    int g_iBudget;                                      // CPU budget, in percent of a core
+    int g_iSeconds;                                     // Seconds of sound to mix per test
+
+    W_Sound g_Sound;                                    // The sound every voice plays
+
+    int g_piVoiceCounts [ TEST_COUNT ] = { 1, 4, 16, 64, 256, W_MAX_VOICE_COUNT };
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    void PrintLogo ();
+    void PrintUsage ();
+
+    bool RunTest ( int iVoiceCount, double * pdLoad, unsigned int * piChecksum );
+    int RunBenchmark ();
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    /******************************************************************************************
+    *
+    *   PrintLogo ()
+    *
+    *   Prints out logo/credits information.
+    */
+
+    void PrintLogo ()
+    {
+        printf ( "Wrappuh Mixer Benchmark\n" );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   PrintUsage ()
+    *
+    *   Prints out usage information.
+    */
+
+    void PrintUsage ()
+    {
+        printf ( "Usage:\tMIXERBENCH [Budget [Seconds]]\n" );
+        printf ( "\n" );
+        printf ( "\t- Budget is the share of one core the mixer may use, in percent (%d by default).\n", DEFAULT_BUDGET );
+        printf ( "\t- Seconds is how much sound to mix for each test, from 1 to %d (%d by default).\n", MAX_SECONDS, DEFAULT_SECONDS );
+        printf ( "\n" );
+    }
+
+    /******************************************************************************************
+    *
+    *   RunTest ()
+    *
+    *   Mixes the test's length of sound with the specified number of voices and the current
+    *   kernel, returning the share of a core it took to mix in real time and the checksum of
+    *   the mix. The voices are started a millisecond apart, so they read from different
+    *   parts of the sound, and spread across the volume and pan ranges. Returns FALSE if a
+    *   voice ended or was lost before the test finished.
+    */
+
+    bool RunTest ( int iVoiceCount, double * pdLoad, unsigned int * piChecksum )
+    {
+        short psFrames [ READ_SIZE * 2 ];
+
+        // Start the voices with output off, so staggering them doesn't mix anything. A
+        // millisecond isn't a whole number of frames, so the clock is moved on to the next
+        // second first; otherwise the voices would line up differently in each test.
+
+        W_StopAllSounds ();
+        W_DisableSoundOutput ();
+
+        W_AdvanceVirtualClock ( 1000 - W_GetTickCount () % 1000 );
+
+        for ( int iCurrVoice = 0; iCurrVoice < iVoiceCount; ++ iCurrVoice )
+        {
+            W_PlaySoundEx ( g_Sound, 100 - iCurrVoice % 4 * 10, iCurrVoice * 37 % 201 - 100 );
+            W_AdvanceVirtualClock ( 1 );
+        }
+
+        W_EnableSoundOutput ();
+
+        // Mix the sound a little at a time, the way a game would, and only time the mixing
+
+        unsigned int iChecksum = CHECKSUM_SEED;
+        W_Int64 iMixTime = 0;
+
+        for ( int iCurrUpdate = 0; iCurrUpdate < g_iSeconds * 1000 / UPDATE_DUR; ++ iCurrUpdate )
+        {
+            W_AdvanceVirtualClock ( UPDATE_DUR );
+
+            W_Int64 iStartTime = W_GetMicroTickCount ();
+            W_UpdateSound ();
+            iMixTime += W_GetMicroTickCount () - iStartTime;
+
+            int iFrameCount;
+            while ( ( iFrameCount = W_ReadSoundFrames ( psFrames, READ_SIZE ) ) > 0 )
+            {
+                for ( int iCurrSample = 0; iCurrSample < iFrameCount * 2; ++ iCurrSample )
+                {
+                    iChecksum ^= ( unsigned short ) psFrames [ iCurrSample ];
+                    iChecksum *= CHECKSUM_PRIME;
+                }
+            }
+        }
+
+        * pdLoad = iMixTime / ( g_iSeconds * 10000.0 );
+        * piChecksum = iChecksum;
+
+        return W_GetVoiceCount () == iVoiceCount;
+    }
+
+    /******************************************************************************************
+    *
+    *   RunBenchmark ()
+    *
+    *   Runs every test with every kernel and prints the results, followed by the number of
+    *   voices each kernel could mix within the budget. Returns FALSE if the benchmark
+    *   couldn't be run or a kernel's checksum doesn't match the scalar kernel's.
+    */
+
+    int RunBenchmark ()
+    {
+        if ( ! W_LoadSound ( SOUND_FILENAME, & g_Sound, FALSE ) )
+        {
+            printf ( "Could not load the sound. Run from Lockdown's Executable directory.\n" );
+            return FALSE;
+        }
+
+        printf ( "%d seconds of sound at %d Hz, %% of one core to mix in real time\n", g_iSeconds, W_MIXER_RATE );
+
+        printf ( "\t%-8s", "Voices" );
+        int iCurrKernel;
+        for ( iCurrKernel = 0; iCurrKernel < W_BLIT_KERNEL_COUNT; ++ iCurrKernel )
+            if ( W_IsBlitKernelSupported ( iCurrKernel ) )
+                printf ( "%10s", W_GetBlitKernelName ( iCurrKernel ) );
+        printf ( "\n" );
+
+        // Run each voice count with every kernel in turn, so the rows line up
+
+        double pdLoads [ W_BLIT_KERNEL_COUNT ][ TEST_COUNT ];
+        int iIsMatch = TRUE,
+            iIsComplete = TRUE;
+
+        for ( int iCurrTest = 0; iCurrTest < TEST_COUNT; ++ iCurrTest )
+        {
+            printf ( "\t%-8d", g_piVoiceCounts [ iCurrTest ] );
+
+            unsigned int iScalarChecksum;
+
+            for ( iCurrKernel = 0; iCurrKernel < W_BLIT_KERNEL_COUNT; ++ iCurrKernel )
+            {
+                if ( ! W_SetMixKernel ( iCurrKernel ) )
+                    continue;
+
+                unsigned int iChecksum;
+
+                if ( ! RunTest ( g_piVoiceCounts [ iCurrTest ], & pdLoads [ iCurrKernel ][ iCurrTest ], & iChecksum ) )
+                    iIsComplete = FALSE;
+
+                if ( iCurrKernel == W_BLIT_KERNEL_SCALAR )
+                    iScalarChecksum = iChecksum;
+                else if ( iChecksum != iScalarChecksum )
+                    iIsMatch = FALSE;
+
+                printf ( "%9.2f%%", pdLoads [ iCurrKernel ][ iCurrTest ] );
+            }
+
+            printf ( "\n" );
+        }
+
+        printf ( "\n" );
+
+        // Work out the cost of a voice from the biggest test, where the fixed cost of each
+        // update matters least
+
+        printf ( "Voices within %d%% of one core\n", g_iBudget );
+
+        for ( iCurrKernel = 0; iCurrKernel < W_BLIT_KERNEL_COUNT; ++ iCurrKernel )
+        {
+            if ( ! W_IsBlitKernelSupported ( iCurrKernel ) )
+                continue;
+
+            double dVoiceLoad = pdLoads [ iCurrKernel ][ TEST_COUNT - 1 ] / g_piVoiceCounts [ TEST_COUNT - 1 ];
+            int iVoiceCount = dVoiceLoad > 0 ? ( int ) ( g_iBudget / dVoiceLoad ) : INT_MAX;
+
+            printf ( "\t%-8s%10d", W_GetBlitKernelName ( iCurrKernel ), iVoiceCount );
+            if ( iVoiceCount > W_MAX_VOICE_COUNT )
+                printf ( " (the mixer plays at most %d)", W_MAX_VOICE_COUNT );
+            printf ( "\n" );
+        }
+
+        printf ( "\n" );
+
+        W_StopAllSounds ();
+        W_FreeSound ( & g_Sound );
+
+        if ( ! iIsComplete )
+        {
+            printf ( "Voices ended before the tests did.\n" );
+            return FALSE;
+        }
+
+        if ( ! iIsMatch )
+        {
+            printf ( "Checksums don't match.\n" );
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+// ---- Main ----------------------------------------------------------------------------------
+
+    int main ( int argc, char * argv [] )
+    {
+        // Print the logo
+
+        PrintLogo ();
+
+        // Read the budget and length, if they were specified
+
+        g_iBudget = DEFAULT_BUDGET;
+        g_iSeconds = DEFAULT_SECONDS;
+
+        if ( argc > 1 )
+            g_iBudget = atoi ( argv [ 1 ] );
+        if ( argc > 2 )
+            g_iSeconds = atoi ( argv [ 2 ] );
+
+        if ( g_iBudget <= 0 || g_iSeconds <= 0 || g_iSeconds > MAX_SECONDS )
+        {
+            PrintUsage ();
+            return 0;
+        }
+
+        if ( ! W_InitWrappuh ( "Wrappuh Mixer Benchmark", NULL, 0 ) )
+        {
+            printf ( "Could not initialize Wrappuh.\n" );
+            return 1;
+        }
+
+        // The virtual clock decides how much sound there is to mix, so the tests don't
+        // depend on how fast they run
+
+        W_EnableVirtualClock ();
+
+        int iKernel = W_GetMixKernel ();
+        int iResult = RunBenchmark () ? 0 : 1;
+
+        W_SetMixKernel ( iKernel );
+        W_ShutDownWrappuh ();
+
+        return iResult;
+    }
@@ -35,13 +35,49 @@
 		#define DEF_SPACE_PRCNT				.5
 		#define DEF_KERN					1
 
+        #define MAX_ATLAS_FILENAME_SIZE     256
+        #define MAX_BATCH_SOURCE_COUNT      64          // Atlases a batch tells apart when
+                                                        // sorting; the rest sort together
+
+        #define MAX_DIRTY_RECT_COUNT        32          // Rectangles a frame's changes are
+                                                        // merged down to
+        #define DIRTY_RECT_MERGE_SLACK      1024        // Extra pixels worth redrawing to
+                                                        // save a rectangle
+        #define DIRTY_RECT_MAX_COVERAGE     50          // Percent of the screen past which
+                                                        // the whole frame is redrawn
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        #define PACK_ID_STRING              "WPAK"      // The format image_cook.cpp writes
+        #define PACK_VERSION                1
+
+        #define PACK_HEADER_SIZE            16
+        #define PACK_ENTRY_SIZE             160
+        #define PACK_NAME_SIZE              128
+
+        #define MAX_PACK_WORKER_COUNT       16          // Threads a pack is copied out on
+        #define MIN_PACK_WORKER_SIZE        262144      // Bytes worth starting a thread for
+
 	// ---- Input -----------------------------------------------------------------------------
 
 		#define KEY_DELAY					135
 
 	// ---- Timers ----------------------------------------------------------------------------
 
-		#define MAX_TIMER_COUNT				256
+		#define MAX_TIMER_COUNT				1024
+
+        #define TIMER_WHEEL_LEVEL_COUNT     4           // Levels in the timer wheel
+        #define TIMER_WHEEL_SLOT_BITS       6           // Each level has 2 ^ this many slots
+        #define TIMER_WHEEL_SLOT_COUNT      ( 1 << TIMER_WHEEL_SLOT_BITS )
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        #define FRAME_STATS_HISTORY_SIZE    1024        // Frame times kept for the statistics
+
+        // Sleep () can run a millisecond past what was asked for even with the timer
+        // resolution raised, so the last two milliseconds before a deadline are spun out
+
+        #define FRAME_PACER_SPIN_TIME       2000
 
 // ---- Data Structures -----------------------------------------------------------------------
 
@@ -98,6 +134,43 @@
 		}
 			FontCharDesc;
 
+        typedef struct
+        {
+            W_Image Image;
+            int iX,
+                iY;
+            int iLayer;
+            int iSource;                            // Which of the batch's atlases it's from
+            int iIndex;                             // Where it was added to the batch
+        }
+            BatchSprite;
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        typedef struct                              // An image in the open pack
+        {
+            char * pstrName;                        // In the pack's directory
+            W_Image Image;                          // Copied out of the pack
+            bool bIsTaken;                          // Has W_LoadImage () handed it out?
+
+            UCHAR * pCookedPixels;                  // Where its pixels are in the pack
+            int iCookedPitch;
+            int iRowSize;                           // Bytes of pixels in a row
+            int iFirstByte;                         // Where its pixels start, counting those
+                                                    // of every image before it
+
+            UCHAR * pSrfcPixels;                    // Its surface's pixels while it's locked
+        }
+            PackImage;
+
+        typedef struct                              // A worker's share of copying out a pack
+        {
+            int iFirstByte,                         // The bytes it copies, counted the same
+                iLastByte;                          // way as PackImage's iFirstByte
+            HANDLE hThread;
+        }
+            PackWorker;
+
 	// ---- Timers ----------------------------------------------------------------------------
 
 		typedef struct
@@ -105,8 +178,13 @@
 			bool bIsNull;
 
 			int iLength;
-			int iActiveTime;
-			bool bIsActive;
+			W_Int64 iActiveTime;                    // When the timer next goes off
+            int iActiveFrame;                       // The W_HandleTimers () call it last went
+                                                    // off in
+
+            int iSlot;                              // The timer wheel slot it's in
+            int iPrev;                              // The timers before and after it in its
+            int iNext;                              // slot, or the next free timer
 		}
 			Timer;
 	
@@ -142,6 +220,50 @@
 			FontDesc g_FontDesc;
 			FontCharDesc g_FontCharDesc [ DEF_FONT_CHAR_COUNT ];
 
+            BatchSprite g_BatchSprites [ W_MAX_BATCH_SPRITE_COUNT ];
+            int g_iBatchSpriteCount         = 0;
+
+            void * g_pBatchSources [ MAX_BATCH_SOURCE_COUNT ];  // Surfaces of each atlas in
+            int g_iBatchSourceCount         = 0;                // the batch, in order of
+                                                                // first use
+
+            W_Image g_BatchBackground;                  // Drawn under the batch, if it's set
+            bool g_bIsBatchBackgroundSet    = FALSE;
+            bool g_bIsBatchFlushed          = FALSE;    // Was the batch drawn early this
+                                                        // frame?
+
+            bool g_bIsDirtyRectEnabled      = FALSE;    // Are batches only redrawn where
+                                                        // they've changed?
+            bool g_bIsFrameValid            = FALSE;    // Does the back buffer hold the last
+                                                        // batch, and nothing else?
+            bool g_bIsFramePartial          = FALSE;    // Was only the dirty rectangle list
+                                                        // drawn since the last frame?
+
+            W_Image g_LastBatchBackground;              // The last batch, as it was drawn
+            BatchSprite g_LastBatchSprites [ W_MAX_BATCH_SPRITE_COUNT ];
+            int g_iLastBatchSpriteCount     = 0;
+            bool g_pbIsLastSpriteMatched [ W_MAX_BATCH_SPRITE_COUNT ];
+
+            W_Rect g_DirtyRects [ MAX_DIRTY_RECT_COUNT ];   // The parts of the screen being
+            int g_iDirtyRectCount;                          // redrawn, which never overlap
+
+            int g_iDirtyStatsFrameCount;                // Dirty rectangle statistics since
+            int g_iDirtyStatsFullCount;                 // the last reset
+            double g_dDirtyStatsCoverage;
+            float g_fLastDirtyCoverage;
+
+        // ---- Image Packs -------------------------------------------------------------------
+
+            UCHAR * g_pImagePack            = NULL;     // The mapped pack, if one is open
+            DWORD g_iImagePackSize;
+            int g_iImagePackColorDepth;
+
+            HANDLE g_hImagePackFile;
+            HANDLE g_hImagePackMapping;
+
+            PackImage * g_pPackImages       = NULL;
+            int g_iPackImageCount;
+
 		// ---- Input -------------------------------------------------------------------------
 
 			IDirectInput8 * g_pDIIntrfc		= NULL;
@@ -178,6 +300,27 @@
 
             INT64 g_iTimerFreqPerMs;
             Timer g_Timers [ MAX_TIMER_COUNT ];
+            int g_iFreeTimer;                           // The first free timer
+            int g_iTimerCount;                          // Timers in use
+            int g_iTimerFrame;                          // W_HandleTimers () calls so far
+
+            // The timer wheel. Each slot holds the first of the timers in it; the first level
+            // has a slot per millisecond, and each level after that has a slot per turn of the
+            // one before.
+
+            int g_TimerWheel [ TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_COUNT ];
+            W_Int64 g_iTimerWheelTime;                  // The next millisecond to handle
+
+		// ---- Frame Pacing ------------------------------------------------------------------
+
+            W_Int64 g_iFrameDur;                        // Frame duration to pace to (in
+                                                        // microseconds), or zero for none
+            W_Int64 g_iNextFrameTime;                   // When the next frame should start
+            W_Int64 g_iLastFrameTime;                   // When the last frame started, or -1
+
+            int g_piFrameTimes [ FRAME_STATS_HISTORY_SIZE ];    // Recent frame times (in
+                                                                // microseconds)
+            int g_iFrameTimeCount;                      // Frames measured since the last reset
 
         // ---- Misc --------------------------------------------------------------------------
 
@@ -220,6 +363,845 @@
 												\
 			( iB | ( iG << 8 ) | ( iR << 16 ) )
 
+        #define GetRectArea( Rect )                 \
+                                                    \
+            ( ( ( Rect ).iX1 - ( Rect ).iX0 ) * ( ( Rect ).iY1 - ( Rect ).iY0 ) )
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        // Packs are little-endian, like every CPU DirectX runs on
+
+        #define ReadPackDWord( pBuffer, iOffset )   \
+                                                    \
+            ( * ( int * ) ( ( pBuffer ) + ( iOffset ) ) )
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    // ---- Video -----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   IsSrfcPixelOpaque ()
+        *
+        *   Returns TRUE if the specified pixel of a locked surface isn't the mask color.
+        */
+
+        int IsSrfcPixelOpaque ( DDSURFACEDESC2 * pSrfcDesc, int iX, int iY )
+        {
+            UCHAR * pRow = ( UCHAR * ) pSrfcDesc->lpSurface + iY * pSrfcDesc->lPitch;
+
+            switch ( g_VideoContext.iColorDepth )
+            {
+                case 15:
+                    return ( ( Pixel15 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_15;
+
+                case 16:
+                    return ( ( Pixel16 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_16;
+
+                case 32:
+                    return ( ( Pixel32 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_32;
+            }
+
+            return FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   GetOpaqueRect ()
+        *
+        *   Finds the bounding box of the opaque pixels in a rectangle of a locked surface,
+        *   scanning in from each edge the same way W_LoadImage () does. The box is relative
+        *   to the rectangle, and its second corner is stored as a width and height.
+        */
+
+        W_Rect GetOpaqueRect ( DDSURFACEDESC2 * pSrfcDesc, int iSourceX, int iSourceY, int iXRes, int iYRes )
+        {
+            W_Rect OpaqueRect;
+
+            int iX,
+                iY;
+
+            for ( iX = 0; iX < iXRes; ++ iX )
+            {
+                for ( iY = 0; iY < iYRes; ++ iY )
+                    if ( IsSrfcPixelOpaque ( pSrfcDesc, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iY < iYRes )
+                    break;
+            }
+            OpaqueRect.iX0 = iX;
+
+            for ( iX = iXRes - 1; iX >= 0; -- iX )
+            {
+                for ( iY = 0; iY < iYRes; ++ iY )
+                    if ( IsSrfcPixelOpaque ( pSrfcDesc, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iY < iYRes )
+                    break;
+            }
+            OpaqueRect.iX1 = iX;
+
+            for ( iY = 0; iY < iYRes; ++ iY )
+            {
+                for ( iX = 0; iX < iXRes; ++ iX )
+                    if ( IsSrfcPixelOpaque ( pSrfcDesc, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iX < iXRes )
+                    break;
+            }
+            OpaqueRect.iY0 = iY;
+
+            for ( iY = iYRes - 1; iY >= 0; -- iY )
+            {
+                for ( iX = 0; iX < iXRes; ++ iX )
+                    if ( IsSrfcPixelOpaque ( pSrfcDesc, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iX < iXRes )
+                    break;
+            }
+            OpaqueRect.iY1 = iY;
+
+            OpaqueRect.iX1 -= OpaqueRect.iX0;
+            OpaqueRect.iY1 -= OpaqueRect.iY0;
+
+            return OpaqueRect;
+        }
+
+        /**************************************************************************************
+        *
+        *   CompareBatchSprites ()
+        *
+        *   qsort () comparison function for ordering a sprite batch by layer, then atlas,
+        *   then the order the sprites were added in.
+        */
+
+        int CompareBatchSprites ( const void * pA, const void * pB )
+        {
+            BatchSprite * SpriteA = ( BatchSprite * ) pA;
+            BatchSprite * SpriteB = ( BatchSprite * ) pB;
+
+            if ( SpriteA->iLayer != SpriteB->iLayer )
+                return SpriteA->iLayer - SpriteB->iLayer;
+
+            if ( SpriteA->iSource != SpriteB->iSource )
+                return SpriteA->iSource - SpriteB->iSource;
+
+            return SpriteA->iIndex - SpriteB->iIndex;
+        }
+
+        /**************************************************************************************
+        *
+        *   ClipBlitImage ()
+        *
+        *   Blits the part of an image that lands inside a rectangle of the back buffer. The
+        *   rectangle's second corner is just outside it.
+        */
+
+        void ClipBlitImage ( W_Image * Image, int iX, int iY, W_Rect * ClipRect )
+        {
+            RECT DestRect;
+            DestRect.left = iX > ClipRect->iX0 ? iX : ClipRect->iX0;
+            DestRect.top = iY > ClipRect->iY0 ? iY : ClipRect->iY0;
+            DestRect.right = iX + Image->iXRes < ClipRect->iX1 ? iX + Image->iXRes : ClipRect->iX1;
+            DestRect.bottom = iY + Image->iYRes < ClipRect->iY1 ? iY + Image->iYRes : ClipRect->iY1;
+
+            if ( DestRect.left >= DestRect.right || DestRect.top >= DestRect.bottom )
+                return;
+
+            RECT SourceRect;
+            SourceRect.left = Image->iSourceX + DestRect.left - iX;
+            SourceRect.top = Image->iSourceY + DestRect.top - iY;
+            SourceRect.right = SourceRect.left + DestRect.right - DestRect.left;
+            SourceRect.bottom = SourceRect.top + DestRect.bottom - DestRect.top;
+
+            g_pBackDDSrfc->Blt ( & DestRect, Image->pDDSrfc, & SourceRect, DDBLT_WAIT | DDBLT_KEYSRC, NULL );
+        }
+
+        /**************************************************************************************
+        *
+        *   IsSameImage ()
+        *
+        *   Returns TRUE if two images are the same pixels of the same surface.
+        */
+
+        int IsSameImage ( W_Image * ImageA, W_Image * ImageB )
+        {
+            return ImageA->pDDSrfc == ImageB->pDDSrfc &&
+                   ImageA->iSourceX == ImageB->iSourceX && ImageA->iSourceY == ImageB->iSourceY &&
+                   ImageA->iXRes == ImageB->iXRes && ImageA->iYRes == ImageB->iYRes;
+        }
+
+        /**************************************************************************************
+        *
+        *   IsSameBatchSprite ()
+        *
+        *   Returns TRUE if two batched sprites draw the same image in the same place.
+        */
+
+        int IsSameBatchSprite ( BatchSprite * SpriteA, BatchSprite * SpriteB )
+        {
+            return SpriteA->iX == SpriteB->iX && SpriteA->iY == SpriteB->iY &&
+                   SpriteA->iLayer == SpriteB->iLayer &&
+                   IsSameImage ( & SpriteA->Image, & SpriteB->Image );
+        }
+
+        /**************************************************************************************
+        *
+        *   GetSpriteRect ()
+        *
+        *   Returns the part of the screen a batched sprite draws on, which is its image's
+        *   bounding box clipped to the screen. The second corner is just outside it.
+        */
+
+        W_Rect GetSpriteRect ( BatchSprite * Sprite )
+        {
+            W_Rect Rect;
+            Rect.iX0 = Sprite->iX + Sprite->Image.ClipRect.iX0;
+            Rect.iY0 = Sprite->iY + Sprite->Image.ClipRect.iY0;
+            Rect.iX1 = Rect.iX0 + Sprite->Image.ClipRect.iX1 + 1;
+            Rect.iY1 = Rect.iY0 + Sprite->Image.ClipRect.iY1 + 1;
+
+            if ( Rect.iX0 < 0 )
+                Rect.iX0 = 0;
+            if ( Rect.iY0 < 0 )
+                Rect.iY0 = 0;
+            if ( Rect.iX1 > g_VideoContext.iXRes )
+                Rect.iX1 = g_VideoContext.iXRes;
+            if ( Rect.iY1 > g_VideoContext.iYRes )
+                Rect.iY1 = g_VideoContext.iYRes;
+
+            return Rect;
+        }
+
+        /**************************************************************************************
+        *
+        *   GetRectUnion ()
+        *
+        *   Returns the smallest rectangle that holds both of the specified ones.
+        */
+
+        W_Rect GetRectUnion ( W_Rect * RectA, W_Rect * RectB )
+        {
+            W_Rect Union;
+            Union.iX0 = RectA->iX0 < RectB->iX0 ? RectA->iX0 : RectB->iX0;
+            Union.iY0 = RectA->iY0 < RectB->iY0 ? RectA->iY0 : RectB->iY0;
+            Union.iX1 = RectA->iX1 > RectB->iX1 ? RectA->iX1 : RectB->iX1;
+            Union.iY1 = RectA->iY1 > RectB->iY1 ? RectA->iY1 : RectB->iY1;
+
+            return Union;
+        }
+
+        /**************************************************************************************
+        *
+        *   AddDirtyRect ()
+        *
+        *   Adds a rectangle to the parts of the screen being redrawn. It's merged with any
+        *   rectangle it overlaps, or that it would cost little more to redraw as one with,
+        *   so the list never covers a pixel twice. If the list is full, it's merged with
+        *   whichever rectangle grows the least.
+        */
+
+        void AddDirtyRect ( W_Rect Rect )
+        {
+            if ( Rect.iX0 >= Rect.iX1 || Rect.iY0 >= Rect.iY1 )
+                return;
+
+            int iCurrRect = 0;
+            while ( iCurrRect < g_iDirtyRectCount )
+            {
+                W_Rect * CurrRect = & g_DirtyRects [ iCurrRect ];
+                W_Rect Union = GetRectUnion ( & Rect, CurrRect );
+
+                int iIsOverlapping = Rect.iX0 < CurrRect->iX1 && CurrRect->iX0 < Rect.iX1 &&
+                                     Rect.iY0 < CurrRect->iY1 && CurrRect->iY0 < Rect.iY1;
+
+                if ( iIsOverlapping ||
+                     GetRectArea ( Union ) <= GetRectArea ( Rect ) + GetRectArea ( * CurrRect ) + DIRTY_RECT_MERGE_SLACK )
+                {
+                    // The bigger rectangle may now reach ones that have already been passed,
+                    // so start over
+
+                    Rect = Union;
+                    g_DirtyRects [ iCurrRect ] = g_DirtyRects [ -- g_iDirtyRectCount ];
+                    iCurrRect = 0;
+                }
+                else
+                    ++ iCurrRect;
+            }
+
+            if ( g_iDirtyRectCount < MAX_DIRTY_RECT_COUNT )
+            {
+                g_DirtyRects [ g_iDirtyRectCount ++ ] = Rect;
+                return;
+            }
+
+            int iBestRect = 0,
+                iBestGrowth = INT_MAX;
+
+            for ( iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+            {
+                W_Rect Union = GetRectUnion ( & Rect, & g_DirtyRects [ iCurrRect ] );
+                int iGrowth = GetRectArea ( Union ) - GetRectArea ( g_DirtyRects [ iCurrRect ] );
+
+                if ( iGrowth < iBestGrowth )
+                {
+                    iBestRect = iCurrRect;
+                    iBestGrowth = iGrowth;
+                }
+            }
+
+            W_Rect Union = GetRectUnion ( & Rect, & g_DirtyRects [ iBestRect ] );
+            g_DirtyRects [ iBestRect ] = g_DirtyRects [ -- g_iDirtyRectCount ];
+            AddDirtyRect ( Union );
+        }
+
+        /**************************************************************************************
+        *
+        *   FindDirtyRects ()
+        *
+        *   Compares the sorted batch with the last one, and fills the dirty rectangle list
+        *   with the parts of the screen that have changed. Sprites are matched up in drawing
+        *   order, so a sprite is only left alone if the last batch drew the same image in
+        *   the same place, in the same order relative to the other sprites left alone. Every
+        *   other sprite marks where it is now, and every sprite in the last batch that wasn't
+        *   matched marks where it was.
+        */
+
+        void FindDirtyRects ()
+        {
+            g_iDirtyRectCount = 0;
+
+            memset ( g_pbIsLastSpriteMatched, 0, g_iLastBatchSpriteCount * sizeof ( bool ) );
+
+            int iNextLastSprite = 0;
+            int iCurrSprite;
+
+            for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+            {
+                BatchSprite * Sprite = & g_BatchSprites [ iCurrSprite ];
+
+                int iLastSprite;
+                for ( iLastSprite = iNextLastSprite; iLastSprite < g_iLastBatchSpriteCount; ++ iLastSprite )
+                    if ( IsSameBatchSprite ( Sprite, & g_LastBatchSprites [ iLastSprite ] ) )
+                        break;
+
+                if ( iLastSprite < g_iLastBatchSpriteCount )
+                {
+                    g_pbIsLastSpriteMatched [ iLastSprite ] = TRUE;
+                    iNextLastSprite = iLastSprite + 1;
+                }
+                else
+                    AddDirtyRect ( GetSpriteRect ( Sprite ) );
+            }
+
+            for ( iCurrSprite = 0; iCurrSprite < g_iLastBatchSpriteCount; ++ iCurrSprite )
+                if ( ! g_pbIsLastSpriteMatched [ iCurrSprite ] )
+                    AddDirtyRect ( GetSpriteRect ( & g_LastBatchSprites [ iCurrSprite ] ) );
+        }
+
+        /**************************************************************************************
+        *
+        *   DrawSpriteBatch ()
+        *
+        *   Sorts the sprite batch and blits it over the batch's background, then empties it.
+        *   At the end of a frame, with dirty rectangles on, only the parts of the screen that
+        *   have changed since the last batch are redrawn, unless they cover too much of it.
+        *   A batch drawn early because it filled up is always drawn in full, and so is the
+        *   rest of its frame.
+        */
+
+        void DrawSpriteBatch ( int iIsFrameEnd )
+        {
+            qsort ( g_BatchSprites, g_iBatchSpriteCount, sizeof ( BatchSprite ), CompareBatchSprites );
+
+            // Dirty rectangles only work if the back buffer still holds the last batch, drawn
+            // over the same background
+
+            int iScreenArea = g_VideoContext.iXRes * g_VideoContext.iYRes;
+            int iDirtyArea = iScreenArea;
+            int iIsFullRedraw = TRUE;
+
+            if ( g_bIsDirtyRectEnabled && iIsFrameEnd && g_bIsFrameValid && ! g_bIsBatchFlushed &&
+                 g_bIsBatchBackgroundSet && IsSameImage ( & g_BatchBackground, & g_LastBatchBackground ) )
+            {
+                FindDirtyRects ();
+
+                iDirtyArea = 0;
+                for ( int iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+                    iDirtyArea += GetRectArea ( g_DirtyRects [ iCurrRect ] );
+
+                if ( iDirtyArea * 100 <= iScreenArea * DIRTY_RECT_MAX_COVERAGE )
+                    iIsFullRedraw = FALSE;
+                else
+                    iDirtyArea = iScreenArea;
+            }
+
+            W_Rect ScreenRect;
+            ScreenRect.iX0 = 0;
+            ScreenRect.iY0 = 0;
+            ScreenRect.iX1 = g_VideoContext.iXRes;
+            ScreenRect.iY1 = g_VideoContext.iYRes;
+
+            int iCurrSprite;
+            BatchSprite * Sprite;
+
+            if ( iIsFullRedraw )
+            {
+                // Draw the background, unless the batch has already been drawn early this
+                // frame, then every sprite over it
+
+                if ( g_bIsBatchBackgroundSet && ! g_bIsBatchFlushed )
+                    ClipBlitImage ( & g_BatchBackground, 0, 0, & ScreenRect );
+
+                for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+                {
+                    Sprite = & g_BatchSprites [ iCurrSprite ];
+                    ClipBlitImage ( & Sprite->Image, Sprite->iX, Sprite->iY, & ScreenRect );
+                }
+            }
+            else
+            {
+                // Rebuild each dirty rectangle from the background up, clipping everything
+                // to it
+
+                for ( int iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+                {
+                    W_Rect * DirtyRect = & g_DirtyRects [ iCurrRect ];
+
+                    ClipBlitImage ( & g_BatchBackground, 0, 0, DirtyRect );
+
+                    for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+                    {
+                        Sprite = & g_BatchSprites [ iCurrSprite ];
+                        ClipBlitImage ( & Sprite->Image, Sprite->iX, Sprite->iY, DirtyRect );
+                    }
+                }
+            }
+
+            if ( iIsFrameEnd )
+            {
+                ++ g_iDirtyStatsFrameCount;
+                if ( iIsFullRedraw )
+                    ++ g_iDirtyStatsFullCount;
+
+                g_fLastDirtyCoverage = ( float ) iDirtyArea / iScreenArea;
+                g_dDirtyStatsCoverage += g_fLastDirtyCoverage;
+
+                // Keep the batch, so the next one can be compared with it, and let
+                // W_BlitFrame () know how much of the frame to show
+
+                g_bIsFrameValid = g_bIsDirtyRectEnabled && g_bIsBatchBackgroundSet && ! g_bIsBatchFlushed;
+                g_bIsFramePartial = ! iIsFullRedraw;
+
+                if ( g_bIsFrameValid )
+                {
+                    memcpy ( g_LastBatchSprites, g_BatchSprites, g_iBatchSpriteCount * sizeof ( BatchSprite ) );
+                    g_iLastBatchSpriteCount = g_iBatchSpriteCount;
+                    g_LastBatchBackground = g_BatchBackground;
+                }
+            }
+            else
+                g_bIsBatchFlushed = TRUE;
+
+            g_iBatchSpriteCount = 0;
+            g_iBatchSourceCount = 0;
+        }
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   MapImagePack ()
+        *
+        *   Maps a pack into memory, read-only. Returns FALSE if it can't be opened.
+        */
+
+        bool MapImagePack ( char * pstrFilename )
+        {
+            g_hImagePackFile = CreateFile ( pstrFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+            if ( g_hImagePackFile == INVALID_HANDLE_VALUE )
+                return FALSE;
+
+            g_iImagePackSize = GetFileSize ( g_hImagePackFile, NULL );
+
+            g_hImagePackMapping = NULL;
+            if ( g_iImagePackSize && g_iImagePackSize != INVALID_FILE_SIZE )
+                g_hImagePackMapping = CreateFileMapping ( g_hImagePackFile, NULL, PAGE_READONLY, 0, 0, NULL );
+
+            if ( g_hImagePackMapping )
+                g_pImagePack = ( UCHAR * ) MapViewOfFile ( g_hImagePackMapping, FILE_MAP_READ, 0, 0, 0 );
+
+            if ( ! g_pImagePack )
+            {
+                if ( g_hImagePackMapping )
+                    CloseHandle ( g_hImagePackMapping );
+                CloseHandle ( g_hImagePackFile );
+                return FALSE;
+            }
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   UnmapImagePack ()
+        *
+        *   Unmaps the pack mapped by MapImagePack ().
+        */
+
+        void UnmapImagePack ()
+        {
+            if ( ! g_pImagePack )
+                return;
+
+            UnmapViewOfFile ( g_pImagePack );
+            CloseHandle ( g_hImagePackMapping );
+            CloseHandle ( g_hImagePackFile );
+
+            g_pImagePack = NULL;
+        }
+
+        /**************************************************************************************
+        *
+        *   CreatePackSrfc ()
+        *
+        *   Creates a surface for an image from a pack, the same way W_LoadImage () creates
+        *   one, and locks it so its pixels can be copied in.
+        */
+
+        bool CreatePackSrfc ( W_Image * Image, DDSURFACEDESC2 & SrfcDesc )
+        {
+            InitWin32Struct ( SrfcDesc );
+
+            SrfcDesc.dwFlags = DDSD_CAPS | DDSD_WIDTH | DDSD_HEIGHT | DDSD_CKSRCBLT;
+
+            int iXRes = Image->iXRes;
+            GetNextMul4 ( iXRes );
+
+            SrfcDesc.dwWidth = iXRes;
+            SrfcDesc.dwHeight = Image->iYRes;
+
+            DWORD iMaskColor = DEF_IMAGE_MASK_COLOR_32;
+
+            switch ( g_VideoContext.iColorDepth )
+            {
+                case 15:
+                    iMaskColor = DEF_IMAGE_MASK_COLOR_15;
+                    break;
+
+                case 16:
+                    iMaskColor = DEF_IMAGE_MASK_COLOR_16;
+                    break;
+            }
+
+            SrfcDesc.ddckCKSrcBlt.dwColorSpaceLowValue = iMaskColor;
+            SrfcDesc.ddckCKSrcBlt.dwColorSpaceHighValue = iMaskColor;
+
+            SrfcDesc.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_SYSTEMMEMORY;
+
+            if ( FAILED ( g_pDDIntrfc4->CreateSurface ( & SrfcDesc, & Image->pDDSrfc, NULL ) ) )
+            {
+                Image->pDDSrfc = NULL;
+                return FALSE;
+            }
+
+            InitWin32Struct ( SrfcDesc );
+            if ( FAILED ( Image->pDDSrfc->Lock ( NULL, & SrfcDesc, DDLOCK_SURFACEMEMORYPTR | DDLOCK_WAIT, NULL ) ) )
+            {
+                Image->pDDSrfc->Release ();
+                Image->pDDSrfc = NULL;
+                return FALSE;
+            }
+
+            Image->iPitch = SrfcDesc.lPitch;
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   CopyPackRows ()
+        *
+        *   Copies a range of an image's rows out of the pack into a locked surface.
+        */
+
+        void CopyPackRows ( PackImage * pImage, UCHAR * pDest, int iDestPitch, int iFirstRow, int iLastRow )
+        {
+            for ( int iY = iFirstRow; iY < iLastRow; ++ iY )
+                memcpy ( pDest + iY * iDestPitch,
+                         pImage->pCookedPixels + iY * pImage->iCookedPitch,
+                         pImage->iRowSize );
+        }
+
+        /**************************************************************************************
+        *
+        *   CopyPackBytes ()
+        *
+        *   Copies out every row that starts within a range of the pack's pixels, counting
+        *   the pixels of every image end to end. Workers are given ranges that don't overlap,
+        *   so each row is copied by exactly one of them.
+        */
+
+        void CopyPackBytes ( int iFirstByte, int iLastByte )
+        {
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                PackImage * pImage = & g_pPackImages [ iCurrImage ];
+
+                if ( pImage->iFirstByte >= iLastByte )
+                    break;
+                if ( pImage->iFirstByte + pImage->iRowSize * pImage->Image.iYRes <= iFirstByte )
+                    continue;
+
+                int iFirstRow = 0;
+                if ( iFirstByte > pImage->iFirstByte )
+                    iFirstRow = ( iFirstByte - pImage->iFirstByte + pImage->iRowSize - 1 ) / pImage->iRowSize;
+
+                int iLastRow = ( iLastByte - pImage->iFirstByte + pImage->iRowSize - 1 ) / pImage->iRowSize;
+                if ( iLastRow > pImage->Image.iYRes )
+                    iLastRow = pImage->Image.iYRes;
+
+                CopyPackRows ( pImage, pImage->pSrfcPixels, pImage->Image.iPitch, iFirstRow, iLastRow );
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   PackWorkerMain ()
+        *
+        *   The entry point of a thread copying out its share of a pack.
+        */
+
+        DWORD WINAPI PackWorkerMain ( LPVOID pParam )
+        {
+            PackWorker * pWorker = ( PackWorker * ) pParam;
+
+            CopyPackBytes ( pWorker->iFirstByte, pWorker->iLastByte );
+
+            return 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   GetCPUCount ()
+        *
+        *   Returns the number of CPUs Windows can run threads on.
+        */
+
+        int GetCPUCount ()
+        {
+            SYSTEM_INFO SystemInfo;
+            GetSystemInfo ( & SystemInfo );
+
+            return SystemInfo.dwNumberOfProcessors;
+        }
+
+        /**************************************************************************************
+        *
+        *   LoadPackImage ()
+        *
+        *   Loads an image from the open pack, if it's in there. The first load of each image
+        *   takes the surface made when the pack was opened; any after that get a new one.
+        */
+
+        bool LoadPackImage ( char * pstrName, W_Image * Image )
+        {
+            if ( ! g_pImagePack || g_iImagePackColorDepth != g_VideoContext.iColorDepth )
+                return FALSE;
+
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                PackImage * pImage = & g_pPackImages [ iCurrImage ];
+
+                if ( strcmp ( pImage->pstrName, pstrName ) != 0 )
+                    continue;
+
+                * Image = pImage->Image;
+
+                if ( ! pImage->bIsTaken )
+                {
+                    pImage->bIsTaken = TRUE;
+                    return TRUE;
+                }
+
+                DDSURFACEDESC2 SrfcDesc;
+                if ( ! CreatePackSrfc ( Image, SrfcDesc ) )
+                    return FALSE;
+
+                CopyPackRows ( pImage, ( UCHAR * ) SrfcDesc.lpSurface, SrfcDesc.lPitch, 0, Image->iYRes );
+
+                Image->pDDSrfc->Unlock ( NULL );
+
+                return TRUE;
+            }
+
+            return FALSE;
+        }
+
+    // ---- Timers ----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   InitTimers ()
+        *
+        *   Empties the timer wheel and puts every timer on the free list.
+        */
+
+        void InitTimers ()
+        {
+            for ( int iCurrSlot = 0; iCurrSlot < TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_COUNT; ++ iCurrSlot )
+                g_TimerWheel [ iCurrSlot ] = -1;
+
+            for ( int iCurrTimerIndex = 0; iCurrTimerIndex < MAX_TIMER_COUNT; ++ iCurrTimerIndex )
+            {
+                g_Timers [ iCurrTimerIndex ].bIsNull = TRUE;
+                g_Timers [ iCurrTimerIndex ].iNext = iCurrTimerIndex + 1 < MAX_TIMER_COUNT ? iCurrTimerIndex + 1 : -1;
+            }
+
+            g_iFreeTimer = 0;
+            g_iTimerCount = 0;
+            g_iTimerFrame = 0;
+            g_iTimerWheelTime = W_GetHighPerformanceTickCount ();
+        }
+
+        /**************************************************************************************
+        *
+        *   AddTimerToWheel ()
+        *
+        *   Puts a timer in the wheel. Timers due within a turn of the first level go in the
+        *   slot for their millisecond; later ones go in the first level whose turn covers
+        *   them, and are moved down a level each time their slot comes around. Timers that are
+        *   already due go in the slot handled next.
+        */
+
+        void AddTimerToWheel ( int iTimerIndex )
+        {
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+
+            W_Int64 iActiveTime = pTimer->iActiveTime;
+            if ( iActiveTime < g_iTimerWheelTime )
+                iActiveTime = g_iTimerWheelTime;
+
+            W_Int64 iDelta = iActiveTime - g_iTimerWheelTime;
+
+            // Timers past the last level's turn wait in its farthest slot and are put back in
+            // when it comes around
+
+            if ( iDelta >> ( TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_BITS ) )
+            {
+                iDelta = ( ( W_Int64 ) 1 << ( TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_BITS ) ) - 1;
+                iActiveTime = g_iTimerWheelTime + iDelta;
+            }
+
+            int iLevel = 0;
+            while ( iLevel < TIMER_WHEEL_LEVEL_COUNT - 1 && ( iDelta >> ( ( iLevel + 1 ) * TIMER_WHEEL_SLOT_BITS ) ) )
+                ++ iLevel;
+
+            int iSlot = iLevel * TIMER_WHEEL_SLOT_COUNT +
+                        ( int ) ( ( iActiveTime >> ( iLevel * TIMER_WHEEL_SLOT_BITS ) ) & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+
+            pTimer->iSlot = iSlot;
+            pTimer->iPrev = -1;
+            pTimer->iNext = g_TimerWheel [ iSlot ];
+
+            if ( pTimer->iNext != -1 )
+                g_Timers [ pTimer->iNext ].iPrev = iTimerIndex;
+
+            g_TimerWheel [ iSlot ] = iTimerIndex;
+        }
+
+        /**************************************************************************************
+        *
+        *   RemoveTimerFromWheel ()
+        *
+        *   Takes a timer out of its wheel slot.
+        */
+
+        void RemoveTimerFromWheel ( int iTimerIndex )
+        {
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+
+            if ( pTimer->iPrev != -1 )
+                g_Timers [ pTimer->iPrev ].iNext = pTimer->iNext;
+            else
+                g_TimerWheel [ pTimer->iSlot ] = pTimer->iNext;
+
+            if ( pTimer->iNext != -1 )
+                g_Timers [ pTimer->iNext ].iPrev = pTimer->iPrev;
+        }
+
+        /**************************************************************************************
+        *
+        *   HandleTimerWheelSlot ()
+        *
+        *   Empties a wheel slot. Timers in a higher level are put back in, which moves them
+        *   down a level; timers in the first level are due, so they go off and are put back in
+        *   for their next activation.
+        */
+
+        void HandleTimerWheelSlot ( int iSlot, W_Int64 iCurrTime )
+        {
+            int iCurrTimerIndex = g_TimerWheel [ iSlot ];
+            g_TimerWheel [ iSlot ] = -1;
+
+            while ( iCurrTimerIndex != -1 )
+            {
+                Timer * pTimer = & g_Timers [ iCurrTimerIndex ];
+                int iNextTimerIndex = pTimer->iNext;
+
+                if ( iSlot < TIMER_WHEEL_SLOT_COUNT )
+                {
+                    pTimer->iActiveFrame = g_iTimerFrame;
+                    pTimer->iActiveTime = iCurrTime + pTimer->iLength;
+
+                    // A timer can't go off twice in the same millisecond
+
+                    if ( pTimer->iActiveTime <= g_iTimerWheelTime )
+                        pTimer->iActiveTime = g_iTimerWheelTime + 1;
+                }
+
+                AddTimerToWheel ( iCurrTimerIndex );
+                iCurrTimerIndex = iNextTimerIndex;
+            }
+        }
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   SleepUntil ()
+        *
+        *   Waits until the microsecond tick count reaches the specified time. The thread
+        *   sleeps for as much of the wait as it safely can and only spins for the last
+        *   FRAME_PACER_SPIN_TIME microseconds, so waiting doesn't tie up a core.
+        */
+
+        void SleepUntil ( W_Int64 iTime )
+        {
+            W_Int64 iRemaining;
+
+            while ( ( iRemaining = iTime - W_GetMicroTickCount () ) > FRAME_PACER_SPIN_TIME )
+            {
+                // Sleep () wakes up to a millisecond late, so leave a millisecond spare
+
+                Sleep ( ( DWORD ) ( iRemaining / 1000 ) - 1 );
+            }
+
+            while ( W_GetMicroTickCount () < iTime );
+        }
+
+        /**************************************************************************************
+        *
+        *   CompareFrameTimes ()
+        *
+        *   qsort () comparison function for sorting frame times.
+        */
+
+        int CompareFrameTimes ( const void * pA, const void * pB )
+        {
+            return * ( int * ) pA - * ( int * ) pB;
+        }
+
 // ---- Public Interface ----------------------------------------------------------------------
 
 	// ---- Misc ------------------------------------------------------------------------------
@@ -380,8 +1362,16 @@
                 QueryPerformanceFrequency ( ( LARGE_INTEGER * ) & g_iTimerFreqPerMs );
                 g_iTimerFreqPerMs /= 1000;
 
-				for ( int iCurrTimerIndex = 0; iCurrTimerIndex < MAX_TIMER_COUNT; ++ iCurrTimerIndex )
-					g_Timers [ iCurrTimerIndex ].bIsNull = TRUE;
+                InitTimers ();
+
+                // ---- Frame pacing
+
+                sfprintf ( " - Raising the timer resolution...\n" );
+
+                timeBeginPeriod ( 1 );
+
+                W_SetFrameRate ( 0 );
+                W_ResetFrameStats ();
 
 			return TRUE;
 		}
@@ -403,6 +1393,8 @@
 
                 sfprintf ( " - Shutting down DirectDraw...\n" );
 
+                W_CloseImagePack ();
+
                 sfprintf ( "    - Freeing the back buffer...\n" );
 				
 				if ( g_pBackDDSrfc )
@@ -456,6 +1448,12 @@
 
                 DSound_Shutdown ();
 
+				// ---- Frame pacing
+
+                sfprintf ( " - Restoring the timer resolution...\n" );
+
+                timeEndPeriod ( 1 );
+
 				// ---- COM
 
                 sfprintf ( " - Uninitializing COM...\n" );
@@ -598,6 +1596,8 @@
 			g_VideoContext.iYMax = iYRes - 1;
 			g_VideoContext.iColorDepth = iColorDepth;
 
+            W_InvalidateFrame ();
+
 			ShowCursor ( FALSE );
 
 			return TRUE;
@@ -660,6 +1660,8 @@
 
 		bool W_LockFrame ()
 		{
+            W_InvalidateFrame ();
+
 			InitWin32Struct ( g_DDSrfcDesc );
 
 			if ( FAILED ( g_pBackDDSrfc->Lock ( NULL, & g_DDSrfcDesc, DDLOCK_SURFACEMEMORYPTR | DDLOCK_WAIT, NULL ) ) )
@@ -679,11 +1681,47 @@
 		*
 		*	W_BlitFrame ()
 		*
-		*	Unlocks and blits the framebuffer to the screen.
+		*	Unlocks and blits the framebuffer to the screen. With dirty rectangles on, the
+        *   back buffer has to keep each frame for the next one to be drawn over, so instead
+        *   of flipping, only the parts of the frame that changed are copied to the screen.
 		*/
 	
 		bool W_BlitFrame ()
 		{
+            if ( g_bIsDirtyRectEnabled )
+            {
+                int iIsPartial = g_bIsFramePartial;
+                g_bIsFramePartial = FALSE;
+
+                if ( ! iIsPartial )
+                {
+                    if ( FAILED ( g_pPrimDDSrfc->Blt ( NULL, g_pBackDDSrfc, NULL, DDBLT_WAIT, NULL ) ) )
+                    {
+                        W_InvalidateFrame ();
+                        return FALSE;
+                    }
+
+                    return TRUE;
+                }
+
+                for ( int iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+                {
+                    RECT DirtyRect;
+                    DirtyRect.left = g_DirtyRects [ iCurrRect ].iX0;
+                    DirtyRect.top = g_DirtyRects [ iCurrRect ].iY0;
+                    DirtyRect.right = g_DirtyRects [ iCurrRect ].iX1;
+                    DirtyRect.bottom = g_DirtyRects [ iCurrRect ].iY1;
+
+                    if ( FAILED ( g_pPrimDDSrfc->Blt ( & DirtyRect, g_pBackDDSrfc, & DirtyRect, DDBLT_WAIT, NULL ) ) )
+                    {
+                        W_InvalidateFrame ();
+                        return FALSE;
+                    }
+                }
+
+                return TRUE;
+            }
+
 			if ( FAILED ( g_pPrimDDSrfc->Flip ( NULL, DDFLIP_WAIT ) ) )
 				return FALSE;
 	
@@ -699,6 +1737,8 @@
 
 		bool W_ClearFrame ()
 		{
+            W_InvalidateFrame ();
+
 			InitWin32Struct ( g_DDBlitFX );
 			g_DDBlitFX.dwFillColor = 0;
 
@@ -723,6 +1763,15 @@
 			BITMAPFILEHEADER BMPFileHeader;
 			BITMAPINFOHEADER BMPImageHeader;
 
+            // Images in the open pack are already converted
+
+            if ( LoadPackImage ( pstrBMPFilename, Image ) )
+                return TRUE;
+
+            Image->iSourceX = 0;
+            Image->iSourceY = 0;
+            Image->bIsAtlasImage = FALSE;
+
 			if ( ( hFile = OpenFile ( pstrBMPFilename, & FileData, OF_READ ) ) == -1 )
 				return FALSE;
 
@@ -951,111 +2000,602 @@
                                 iClipFound = TRUE;
                             break;
 
-                        case 16:
-                            if ( pSrfcBuffer16 != NULL && pSrfcBuffer16 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_16 )
-                                iClipFound = TRUE;
-                            break;
+                        case 16:
+                            if ( pSrfcBuffer16 != NULL && pSrfcBuffer16 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_16 )
+                                iClipFound = TRUE;
+                            break;
+
+                        case 32:
+                            if ( pSrfcBuffer32 != NULL && pSrfcBuffer32 [ iY * ( g_DDSrfcDesc.lPitch >> 2 ) + iX ] != DEF_IMAGE_MASK_COLOR_32 )
+                                iClipFound = TRUE;
+                            break;
+                    }
+                    if ( iClipFound )
+                        break;
+                }
+                if ( iClipFound )
+                    break;
+            }
+            ClipRect.iY0 = iY;
+
+            iClipFound = FALSE;
+	        for ( iY = Image->iYMax; iY >= 0; -- iY )            
+			{	
+                for ( iX = 0; iX < Image->iXRes; ++ iX )
+				{
+                    switch ( g_VideoContext.iColorDepth )
+                    {
+                        case 15:
+                            if ( pSrfcBuffer15 != NULL && pSrfcBuffer15 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_15 )
+                                iClipFound = TRUE;
+                            break;
+
+                        case 16:
+                            if ( pSrfcBuffer16 != NULL && pSrfcBuffer16 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_16 )
+                                iClipFound = TRUE;
+                            break;
+
+                        case 32:
+                            if ( pSrfcBuffer32 != NULL && pSrfcBuffer32 [ iY * ( g_DDSrfcDesc.lPitch >> 2 ) + iX ] != DEF_IMAGE_MASK_COLOR_32 )
+                                iClipFound = TRUE;
+                            break;
+                    }
+                    if ( iClipFound )
+                        break;
+                }
+                if ( iClipFound )
+                    break;
+            }
+            ClipRect.iY1 = iY;
+
+            ClipRect.iX1 -= ClipRect.iX0;
+            ClipRect.iY1 -= ClipRect.iY0;
+
+            Image->ClipRect = ClipRect;
+
+			if ( FAILED ( Image->pDDSrfc->Unlock ( NULL ) ) )
+				return FALSE;
+			
+			free ( pImageBuffer );
+			_lclose ( hFile );
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_FreeImage ()
+		*
+		*	Frees an image.
+		*/
+
+		void W_FreeImage ( W_Image * Image )
+		{
+            if ( Image->bIsAtlasImage )
+                return;
+
+            // The last batch could have drawn from this surface, and a new one may be created
+            // in its place
+
+            W_InvalidateFrame ();
+
+			if ( Image->pDDSrfc != NULL )
+			{
+				Image->pDDSrfc->Release ();
+				Image->pDDSrfc = NULL;
+			}
+		}
+
+		/**************************************************************************************
+		*
+		*	W_BlitImage ()
+		*
+		*	Blits an image.
+		*/
+
+		bool W_BlitImage ( W_Image Image, int iX, int iY )
+		{
+            W_InvalidateFrame ();
+
+			RECT SourceRect;
+			SourceRect.left = Image.iSourceX;
+			SourceRect.top = Image.iSourceY;
+			SourceRect.right = Image.iSourceX + Image.iXRes;
+			SourceRect.bottom = Image.iSourceY + Image.iYRes;
+
+			RECT DestRect;
+			DestRect.left = iX;
+			DestRect.top = iY;
+			DestRect.right = iX + Image.iXRes;
+			DestRect.bottom = iY + Image.iYRes;
+
+
+			if ( FAILED ( g_pBackDDSrfc->Blt ( & DestRect, Image.pDDSrfc, & SourceRect, DDBLT_WAIT | DDBLT_KEYSRC, NULL ) ) )
+				return FALSE;
+
+			return TRUE;
+		}
+
+        /**************************************************************************************
+        *
+        *   W_LoadAtlas ()
+        *
+        *   Loads an atlas from the index written by the atlas packer, along with the BMP it
+        *   names. Each image in the atlas gets its own bounding box, found the same way
+        *   W_LoadImage () finds one.
+        */
+
+        bool W_LoadAtlas ( char * pstrAtlasFilename, W_Atlas * Atlas )
+        {
+            Atlas->Image.pDDSrfc = NULL;
+            Atlas->Image.bIsAtlasImage = FALSE;
+            Atlas->pImages = NULL;
+            Atlas->iImageCount = 0;
+
+            FILE * pFile;
+            if ( ! ( pFile = fopen ( pstrAtlasFilename, "r" ) ) )
+                return FALSE;
+
+            // The BMP's filename is relative to the index, so it goes after the index's
+            // directory
+
+            char pstrBMPFilename [ MAX_ATLAS_FILENAME_SIZE ];
+            char pstrBMPName [ MAX_ATLAS_FILENAME_SIZE ];
+            int iImageCount;
+
+            int iDirLength = 0;
+            for ( int iCurrChar = 0; pstrAtlasFilename [ iCurrChar ]; ++ iCurrChar )
+                if ( pstrAtlasFilename [ iCurrChar ] == '/' || pstrAtlasFilename [ iCurrChar ] == '\\' )
+                    iDirLength = iCurrChar + 1;
+
+            if ( fscanf ( pFile, "%255s %d", pstrBMPName, & iImageCount ) != 2 || iImageCount <= 0 ||
+                 iDirLength + strlen ( pstrBMPName ) >= MAX_ATLAS_FILENAME_SIZE )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            memcpy ( pstrBMPFilename, pstrAtlasFilename, iDirLength );
+            strcpy ( pstrBMPFilename + iDirLength, pstrBMPName );
+
+            if ( ! W_LoadImage ( pstrBMPFilename, & Atlas->Image ) ||
+                 ! ( Atlas->pImages = ( W_AtlasImage * ) malloc ( iImageCount * sizeof ( W_AtlasImage ) ) ) )
+            {
+                fclose ( pFile );
+                W_FreeAtlas ( Atlas );
+                return FALSE;
+            }
+
+            // Lock the atlas so each image's bounding box can be found
+
+            InitWin32Struct ( g_DDSrfcDesc );
+            if ( FAILED ( Atlas->Image.pDDSrfc->Lock ( NULL, & g_DDSrfcDesc, DDLOCK_SURFACEMEMORYPTR | DDLOCK_WAIT, NULL ) ) )
+            {
+                fclose ( pFile );
+                W_FreeAtlas ( Atlas );
+                return FALSE;
+            }
+
+            // Read each image's rectangle and point it at that part of the atlas
+
+            for ( Atlas->iImageCount = 0; Atlas->iImageCount < iImageCount; ++ Atlas->iImageCount )
+            {
+                W_AtlasImage * CurrImage = & Atlas->pImages [ Atlas->iImageCount ];
+                W_Image * Image = & CurrImage->Image;
+
+                int iX,
+                    iY;
+                int iXRes,
+                    iYRes;
+
+                if ( fscanf ( pFile, "%127s %d %d %d %d", CurrImage->pstrName, & iX, & iY, & iXRes, & iYRes ) != 5 ||
+                     iX < 0 || iY < 0 || iXRes <= 0 || iYRes <= 0 ||
+                     iX + iXRes > Atlas->Image.iXRes || iY + iYRes > Atlas->Image.iYRes )
+                {
+                    Atlas->Image.pDDSrfc->Unlock ( NULL );
+                    fclose ( pFile );
+                    W_FreeAtlas ( Atlas );
+                    return FALSE;
+                }
+
+                * Image = Atlas->Image;
+                Image->iXRes = iXRes;
+                Image->iYRes = iYRes;
+                Image->iXMax = iXRes - 1;
+                Image->iYMax = iYRes - 1;
+                Image->iSourceX = iX;
+                Image->iSourceY = iY;
+                Image->bIsAtlasImage = TRUE;
+                Image->ClipRect = GetOpaqueRect ( & g_DDSrfcDesc, iX, iY, iXRes, iYRes );
+            }
+
+            Atlas->Image.pDDSrfc->Unlock ( NULL );
+            fclose ( pFile );
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_FreeAtlas ()
+        *
+        *   Frees an atlas. Any images taken from it can't be used afterwards.
+        */
+
+        void W_FreeAtlas ( W_Atlas * Atlas )
+        {
+            W_FreeImage ( & Atlas->Image );
+
+            free ( Atlas->pImages );
+            Atlas->pImages = NULL;
+            Atlas->iImageCount = 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetAtlasImage ()
+        *
+        *   Finds an image in an atlas by name. The image shares the atlas's surface, so it's
+        *   only valid until the atlas is freed, and freeing the image itself does nothing.
+        */
+
+        bool W_GetAtlasImage ( W_Atlas * Atlas, char * pstrName, W_Image * Image )
+        {
+            for ( int iCurrImage = 0; iCurrImage < Atlas->iImageCount; ++ iCurrImage )
+            {
+                if ( strcmp ( Atlas->pImages [ iCurrImage ].pstrName, pstrName ) == 0 )
+                {
+                    * Image = Atlas->pImages [ iCurrImage ].Image;
+                    return TRUE;
+                }
+            }
+
+            return FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_OpenImagePack ()
+        *
+        *   Opens a pack written by the image cooker and copies every image in it out on worker
+        *   threads, so W_LoadImage () can hand them out as they're loaded. The pack has to
+        *   have been cooked for the current color depth. Any pack that's already open is
+        *   closed first.
+        */
+
+        bool W_OpenImagePack ( char * pstrPackFilename )
+        {
+            W_CloseImagePack ();
+
+            if ( ! g_pDDIntrfc4 || ! MapImagePack ( pstrPackFilename ) )
+                return FALSE;
+
+            // Check the header against the video mode
+
+            UCHAR * pPack = g_pImagePack;
+            int iImageCount = 0;
+
+            if ( g_iImagePackSize >= PACK_HEADER_SIZE && g_iImagePackSize <= INT_MAX )
+                iImageCount = ReadPackDWord ( pPack, 12 );
+
+            if ( iImageCount <= 0 ||
+                 memcmp ( pPack, PACK_ID_STRING, 4 ) != 0 ||
+                 ReadPackDWord ( pPack, 4 ) != PACK_VERSION ||
+                 ReadPackDWord ( pPack, 8 ) != g_VideoContext.iColorDepth ||
+                 PACK_HEADER_SIZE + ( W_Int64 ) iImageCount * PACK_ENTRY_SIZE > ( W_Int64 ) g_iImagePackSize ||
+                 ! ( g_pPackImages = ( PackImage * ) calloc ( iImageCount, sizeof ( PackImage ) ) ) )
+            {
+                W_CloseImagePack ();
+                return FALSE;
+            }
+
+            g_iImagePackColorDepth = g_VideoContext.iColorDepth;
+
+            // Read the directory and create and lock each image's surface, making sure its
+            // pixels are all inside the pack. DirectDraw is only called from this thread; the
+            // workers just copy into the locked surfaces.
+
+            int iPixelSize = g_VideoContext.iColorDepth == 32 ? 4 : 2;
+            int iPackPixelSize = 0;
+
+            for ( g_iPackImageCount = 0; g_iPackImageCount < iImageCount; ++ g_iPackImageCount )
+            {
+                UCHAR * pEntry = pPack + PACK_HEADER_SIZE + g_iPackImageCount * PACK_ENTRY_SIZE;
+                PackImage * pImage = & g_pPackImages [ g_iPackImageCount ];
+                W_Image * Image = & pImage->Image;
+
+                int iXRes = ReadPackDWord ( pEntry, 128 ),
+                    iYRes = ReadPackDWord ( pEntry, 132 ),
+                    iPitch = ReadPackDWord ( pEntry, 136 ),
+                    iOffset = ReadPackDWord ( pEntry, 156 );
+
+                if ( ! memchr ( pEntry, 0, PACK_NAME_SIZE ) ||
+                     iXRes <= 0 || iYRes <= 0 || iPitch < iXRes * iPixelSize || iOffset < 0 ||
+                     iOffset + ( W_Int64 ) iPitch * ( iYRes - 1 ) + iXRes * iPixelSize > ( W_Int64 ) g_iImagePackSize )
+                {
+                    W_CloseImagePack ();
+                    return FALSE;
+                }
+
+                pImage->pstrName = ( char * ) pEntry;
+                pImage->pCookedPixels = pPack + iOffset;
+                pImage->iCookedPitch = iPitch;
+                pImage->iRowSize = iXRes * iPixelSize;
+                pImage->iFirstByte = iPackPixelSize;
+
+                Image->iXRes = iXRes;
+                Image->iYRes = iYRes;
+                Image->iXMax = iXRes - 1;
+                Image->iYMax = iYRes - 1;
+                Image->iSourceX = 0;
+                Image->iSourceY = 0;
+                Image->bIsAtlasImage = FALSE;
+
+                Image->ClipRect.iX0 = ReadPackDWord ( pEntry, 140 );
+                Image->ClipRect.iY0 = ReadPackDWord ( pEntry, 144 );
+                Image->ClipRect.iX1 = ReadPackDWord ( pEntry, 148 );
+                Image->ClipRect.iY1 = ReadPackDWord ( pEntry, 152 );
+
+                DDSURFACEDESC2 SrfcDesc;
+                if ( ! CreatePackSrfc ( Image, SrfcDesc ) )
+                {
+                    W_CloseImagePack ();
+                    return FALSE;
+                }
+
+                pImage->pSrfcPixels = ( UCHAR * ) SrfcDesc.lpSurface;
+
+                iPackPixelSize += pImage->iRowSize * iYRes;
+            }
+
+            // Split the pixels evenly between the workers. The last share is copied on this
+            // thread, as is any share whose thread couldn't be started.
+
+            int iWorkerCount = GetCPUCount ();
+
+            if ( iWorkerCount > MAX_PACK_WORKER_COUNT )
+                iWorkerCount = MAX_PACK_WORKER_COUNT;
+            if ( iWorkerCount > iPackPixelSize / MIN_PACK_WORKER_SIZE )
+                iWorkerCount = iPackPixelSize / MIN_PACK_WORKER_SIZE;
+            if ( iWorkerCount < 1 )
+                iWorkerCount = 1;
+
+            PackWorker Workers [ MAX_PACK_WORKER_COUNT ];
+
+            int iCurrWorker;
+            for ( iCurrWorker = 0; iCurrWorker < iWorkerCount; ++ iCurrWorker )
+            {
+                Workers [ iCurrWorker ].iFirstByte = ( int ) ( ( W_Int64 ) iPackPixelSize * iCurrWorker / iWorkerCount );
+                Workers [ iCurrWorker ].iLastByte = ( int ) ( ( W_Int64 ) iPackPixelSize * ( iCurrWorker + 1 ) / iWorkerCount );
+
+                Workers [ iCurrWorker ].hThread = NULL;
+                if ( iCurrWorker < iWorkerCount - 1 )
+                    Workers [ iCurrWorker ].hThread = CreateThread ( NULL, 0, PackWorkerMain, & Workers [ iCurrWorker ], 0, NULL );
+
+                if ( ! Workers [ iCurrWorker ].hThread )
+                    CopyPackBytes ( Workers [ iCurrWorker ].iFirstByte, Workers [ iCurrWorker ].iLastByte );
+            }
+
+            for ( iCurrWorker = 0; iCurrWorker < iWorkerCount; ++ iCurrWorker )
+            {
+                if ( Workers [ iCurrWorker ].hThread )
+                {
+                    WaitForSingleObject ( Workers [ iCurrWorker ].hThread, INFINITE );
+                    CloseHandle ( Workers [ iCurrWorker ].hThread );
+                }
+            }
+
+            // Unlock the surfaces now that they're filled
+
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                g_pPackImages [ iCurrImage ].Image.pDDSrfc->Unlock ( NULL );
+                g_pPackImages [ iCurrImage ].pSrfcPixels = NULL;
+            }
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_CloseImagePack ()
+        *
+        *   Closes the open pack, if there is one, and frees any of its images W_LoadImage ()
+        *   hasn't handed out. Images it has handed out are unaffected.
+        */
+
+        void W_CloseImagePack ()
+        {
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                PackImage * pImage = & g_pPackImages [ iCurrImage ];
+
+                if ( pImage->pSrfcPixels )
+                    pImage->Image.pDDSrfc->Unlock ( NULL );
+
+                if ( ! pImage->bIsTaken )
+                    pImage->Image.pDDSrfc->Release ();
+            }
+
+            free ( g_pPackImages );
+            g_pPackImages = NULL;
+            g_iPackImageCount = 0;
+
+            UnmapImagePack ();
+        }
+
+        /**************************************************************************************
+        *
+        *   W_BeginSpriteBatch ()
+        *
+        *   Starts a new sprite batch, throwing away anything left in the last one. The batch
+        *   has no background until one is set.
+        */
+
+        void W_BeginSpriteBatch ()
+        {
+            g_iBatchSpriteCount = 0;
+            g_iBatchSourceCount = 0;
+
+            g_bIsBatchBackgroundSet = FALSE;
+            g_bIsBatchFlushed = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_BatchImage ()
+        *
+        *   Adds an image to the sprite batch, to be drawn when the batch ends. Lower layers are
+        *   drawn first; within a layer, images from the same atlas are drawn together, and
+        *   images from the same atlas are drawn in the order they were added. Images that
+        *   would land entirely off the screen are dropped. If the batch is full, what's in it
+        *   is drawn early.
+        */
+
+        bool W_BatchImage ( W_Image & Image, int iX, int iY, int iLayer )
+        {
+            if ( ! Image.pDDSrfc )
+                return FALSE;
 
-                        case 32:
-                            if ( pSrfcBuffer32 != NULL && pSrfcBuffer32 [ iY * ( g_DDSrfcDesc.lPitch >> 2 ) + iX ] != DEF_IMAGE_MASK_COLOR_32 )
-                                iClipFound = TRUE;
-                            break;
-                    }
-                    if ( iClipFound )
-                        break;
-                }
-                if ( iClipFound )
-                    break;
-            }
-            ClipRect.iY0 = iY;
+            if ( iX >= g_VideoContext.iXRes || iY >= g_VideoContext.iYRes ||
+                 iX + Image.iXRes <= 0 || iY + Image.iYRes <= 0 )
+                return TRUE;
 
-            iClipFound = FALSE;
-	        for ( iY = Image->iYMax; iY >= 0; -- iY )            
-			{	
-                for ( iX = 0; iX < Image->iXRes; ++ iX )
-				{
-                    switch ( g_VideoContext.iColorDepth )
-                    {
-                        case 15:
-                            if ( pSrfcBuffer15 != NULL && pSrfcBuffer15 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_15 )
-                                iClipFound = TRUE;
-                            break;
+            if ( g_iBatchSpriteCount == W_MAX_BATCH_SPRITE_COUNT )
+                DrawSpriteBatch ( FALSE );
 
-                        case 16:
-                            if ( pSrfcBuffer16 != NULL && pSrfcBuffer16 [ iY * ( g_DDSrfcDesc.lPitch >> 1 ) + iX ] != DEF_IMAGE_MASK_COLOR_16 )
-                                iClipFound = TRUE;
-                            break;
+            // Find which of the batch's atlases the image is from, checking the most recent
+            // first since sprites tend to come from the same one
 
-                        case 32:
-                            if ( pSrfcBuffer32 != NULL && pSrfcBuffer32 [ iY * ( g_DDSrfcDesc.lPitch >> 2 ) + iX ] != DEF_IMAGE_MASK_COLOR_32 )
-                                iClipFound = TRUE;
-                            break;
-                    }
-                    if ( iClipFound )
-                        break;
-                }
-                if ( iClipFound )
+            int iSource;
+            for ( iSource = g_iBatchSourceCount - 1; iSource >= 0; -- iSource )
+                if ( g_pBatchSources [ iSource ] == Image.pDDSrfc )
                     break;
+
+            if ( iSource < 0 )
+            {
+                iSource = g_iBatchSourceCount;
+
+                if ( g_iBatchSourceCount < MAX_BATCH_SOURCE_COUNT )
+                    g_pBatchSources [ g_iBatchSourceCount ++ ] = Image.pDDSrfc;
             }
-            ClipRect.iY1 = iY;
 
-            ClipRect.iX1 -= ClipRect.iX0;
-            ClipRect.iY1 -= ClipRect.iY0;
+            BatchSprite * Sprite = & g_BatchSprites [ g_iBatchSpriteCount ];
+            Sprite->Image = Image;
+            Sprite->iX = iX;
+            Sprite->iY = iY;
+            Sprite->iLayer = iLayer;
+            Sprite->iSource = iSource;
+            Sprite->iIndex = g_iBatchSpriteCount;
+            ++ g_iBatchSpriteCount;
 
-            Image->ClipRect = ClipRect;
+            return TRUE;
+        }
 
-			if ( FAILED ( Image->pDDSrfc->Unlock ( NULL ) ) )
-				return FALSE;
-			
-			free ( pImageBuffer );
-			_lclose ( hFile );
+        /**************************************************************************************
+        *
+        *   W_EndSpriteBatch ()
+        *
+        *   Sorts the sprite batch and draws it in one pass, over its background if it has
+        *   one.
+        */
 
-			return TRUE;
-		}
+        void W_EndSpriteBatch ()
+        {
+            DrawSpriteBatch ( TRUE );
+        }
 
-		/**************************************************************************************
-		*
-		*	W_FreeImage ()
-		*
-		*	Frees an image.
-		*/
+        /**************************************************************************************
+        *
+        *   W_SetBatchBackground ()
+        *
+        *   Sets the image the sprite batch is drawn over. It's drawn at the top-left corner
+        *   of the screen when the batch ends, and should be opaque and cover the whole
+        *   screen; the batch can only be redrawn with dirty rectangles if it has one.
+        */
 
-		void W_FreeImage ( W_Image * Image )
-		{
-			if ( Image->pDDSrfc != NULL )
-			{
-				Image->pDDSrfc->Release ();
-				Image->pDDSrfc = NULL;
-			}
-		}
+        void W_SetBatchBackground ( W_Image & Image )
+        {
+            g_BatchBackground = Image;
+            g_bIsBatchBackgroundSet = TRUE;
+        }
 
-		/**************************************************************************************
-		*
-		*	W_BlitImage ()
-		*
-		*	Blits an image.
-		*/
+        /**************************************************************************************
+        *
+        *   W_EnableDirtyRects ()
+        *
+        *   Makes sprite batches redraw only the parts of the screen that have changed since
+        *   the last batch, and W_BlitFrame () copy only those parts to the screen instead of
+        *   flipping. The first batch afterwards is still drawn in full.
+        */
 
-		bool W_BlitImage ( W_Image Image, int iX, int iY )
-		{
-			RECT SourceRect;
-			SourceRect.left = 0;
-			SourceRect.top = 0;
-			SourceRect.right = Image.iXRes;
-			SourceRect.bottom = Image.iYRes;
+        void W_EnableDirtyRects ()
+        {
+            g_bIsDirtyRectEnabled = TRUE;
+        }
 
-			RECT DestRect;
-			DestRect.left = iX;
-			DestRect.top = iY;
-			DestRect.right = iX + Image.iXRes;
-			DestRect.bottom = iY + Image.iYRes;
+        /**************************************************************************************
+        *
+        *   W_DisableDirtyRects ()
+        *
+        *   Makes sprite batches redraw the whole screen again, and W_BlitFrame () flip.
+        */
+
+        void W_DisableDirtyRects ()
+        {
+            g_bIsDirtyRectEnabled = FALSE;
+            W_InvalidateFrame ();
+        }
 
+        /**************************************************************************************
+        *
+        *   W_InvalidateFrame ()
+        *
+        *   Makes the next sprite batch redraw the whole screen, and the next W_BlitFrame ()
+        *   show all of it. Wrappuh calls this itself whenever anything is drawn outside of a
+        *   batch, so it's only needed after writing to the back buffer some other way.
+        */
 
-			if ( FAILED ( g_pBackDDSrfc->Blt ( & DestRect, Image.pDDSrfc, & SourceRect, DDBLT_WAIT | DDBLT_KEYSRC, NULL ) ) )
-				return FALSE;
+        void W_InvalidateFrame ()
+        {
+            g_bIsFrameValid = FALSE;
+            g_bIsFramePartial = FALSE;
+        }
 
-			return TRUE;
-		}
+        /**************************************************************************************
+        *
+        *   W_GetDirtyRectStats ()
+        *
+        *   Fills in how many batches have ended since the statistics were last reset, how many
+        *   of them were redrawn in full, and the share of the screen they redrew, from 0 to
+        *   1. Full redraws count as the whole screen.
+        */
+
+        void W_GetDirtyRectStats ( W_DirtyRectStats * pStats )
+        {
+            pStats->iFrameCount = g_iDirtyStatsFrameCount;
+            pStats->iFullRedrawCount = g_iDirtyStatsFullCount;
+            pStats->fMeanCoverage = 0;
+            pStats->fLastCoverage = g_fLastDirtyCoverage;
+
+            if ( g_iDirtyStatsFrameCount )
+                pStats->fMeanCoverage = ( float ) ( g_dDirtyStatsCoverage / g_iDirtyStatsFrameCount );
+        }
+
+        /**************************************************************************************
+        *
+        *   W_ResetDirtyRectStats ()
+        *
+        *   Resets the dirty rectangle statistics.
+        */
+
+        void W_ResetDirtyRectStats ()
+        {
+            g_iDirtyStatsFrameCount = 0;
+            g_iDirtyStatsFullCount = 0;
+            g_dDirtyStatsCoverage = 0;
+            g_fLastDirtyCoverage = 0;
+        }
 
 		/**************************************************************************************
 		*
@@ -1069,6 +2609,8 @@
 			if ( iX < 0 || iY < 0 || iX > g_VideoContext.iXMax || iY > g_VideoContext.iYMax )
 				return;
 
+            W_InvalidateFrame ();
+
 			switch ( g_VideoContext.iColorDepth )
 			{
 				case 15:
@@ -1237,6 +2779,8 @@
 
 		bool W_DrawTextString ( char * pstrTextString, int iX, int iY )
 		{
+            W_InvalidateFrame ();
+
 			int iCurrChar;
 
 			for ( unsigned int iCharIndex = 0; iCharIndex < strlen ( pstrTextString ); ++ iCharIndex )
@@ -1493,7 +3037,37 @@
 
 		bool W_PlaySound ( W_Sound & Sound )
 		{
-            if ( ! DSound_Play ( Sound.iChannels [ ( Sound.iChannelIndex ++ ) % SOUND_CHANNEL_COUNT ] ) )
+            return W_PlaySoundEx ( Sound, 100, 0 );
+		}
+
+		/**************************************************************************************
+		*
+		*	W_PlaySoundEx ()
+		*
+		*	Plays a sound at the specified volume (0-100) and pan (-100 for the left speaker
+		*	only, 100 for the right). Each step of volume below 100 is 0.3 dB quieter, and each
+		*	step of pan takes 1 dB off the other speaker.
+		*/
+
+		bool W_PlaySoundEx ( W_Sound & Sound, int iVolume, int iPan )
+		{
+            int iChannel = Sound.iChannels [ ( Sound.iChannelIndex ++ ) % SOUND_CHANNEL_COUNT ];
+            if ( iChannel == -1 )
+                return FALSE;
+
+            if ( iVolume < 0 )
+                iVolume = 0;
+            if ( iVolume > 100 )
+                iVolume = 100;
+            if ( iPan < -100 )
+                iPan = -100;
+            if ( iPan > 100 )
+                iPan = 100;
+
+            DSound_Set_Volume ( iChannel, iVolume );
+            DSound_Set_Pan ( iChannel, iPan * 100 );
+
+            if ( ! DSound_Play ( iChannel ) )
                 return FALSE;
 
 			return TRUE;
@@ -2366,23 +3940,22 @@
 
 		W_TimerHandle W_InitTimer ( int iLength )
 		{
-			bool bWasFreeTimerFound = FALSE;
-			for ( int iCurrTimerIndex = 0; iCurrTimerIndex < MAX_TIMER_COUNT; ++ iCurrTimerIndex )
-			{
-				if ( g_Timers [ iCurrTimerIndex ].bIsNull )
-				{
-					bWasFreeTimerFound = TRUE;
-					g_Timers [ iCurrTimerIndex ].bIsNull = FALSE;
-					g_Timers [ iCurrTimerIndex ].iLength = iLength;
-					g_Timers [ iCurrTimerIndex ].iActiveTime = GetTickCount () + iLength;
-					break;
-				}
-			}
+            if ( g_iFreeTimer == -1 )
+                return -1;
+
+            int iTimerIndex = g_iFreeTimer;
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+            g_iFreeTimer = pTimer->iNext;
+
+            pTimer->bIsNull = FALSE;
+            pTimer->iLength = iLength;
+            pTimer->iActiveTime = W_GetHighPerformanceTickCount () + iLength;
+            pTimer->iActiveFrame = -1;
 
-			if ( bWasFreeTimerFound )
-				return iCurrTimerIndex;
-			else
-				return -1;
+            AddTimerToWheel ( iTimerIndex );
+            ++ g_iTimerCount;
+
+            return iTimerIndex;
 		}
 
 		/**************************************************************************************
@@ -2394,33 +3967,67 @@
 
 		void W_ClearTimer ( W_TimerHandle hTimer )
 		{
-			if ( hTimer >= 0 && hTimer < MAX_TIMER_COUNT )
-				g_Timers [ hTimer ].bIsNull = TRUE;
+			if ( hTimer < 0 || hTimer >= MAX_TIMER_COUNT || g_Timers [ hTimer ].bIsNull )
+                return;
+
+            RemoveTimerFromWheel ( hTimer );
+
+            g_Timers [ hTimer ].bIsNull = TRUE;
+            g_Timers [ hTimer ].iNext = g_iFreeTimer;
+            g_iFreeTimer = hTimer;
+
+            -- g_iTimerCount;
 		}
 
 		/**************************************************************************************
 		*
 		*	W_HandleTimers ()
 		*
-		*	Called once per frame to keep timers running.
+		*	Called once per frame to keep timers running. Steps the timer wheel through every
+		*	millisecond since the last call, so the work done depends on the time that's passed
+		*	and the timers that go off, not on how many timers there are.
 		*/
 
 		void W_HandleTimers ()
 		{
-			int iCurrTickCount = GetTickCount ();
+            W_Int64 iCurrTime = W_GetHighPerformanceTickCount ();
 
-			for ( int iCurrTimerIndex = 0; iCurrTimerIndex < MAX_TIMER_COUNT; ++ iCurrTimerIndex )
-				if ( ! g_Timers [ iCurrTimerIndex ].bIsNull )
-				{
-					g_Timers [ iCurrTimerIndex ].bIsActive = FALSE;
-					if ( iCurrTickCount >= g_Timers [ iCurrTimerIndex ].iActiveTime )
-					{
-						g_Timers [ iCurrTimerIndex ].bIsActive = TRUE;
-						g_Timers [ iCurrTimerIndex ].iActiveTime = iCurrTickCount + g_Timers [ iCurrTimerIndex ].iLength;
-					}
-				}
+            ++ g_iTimerFrame;
+
+            // With no timers running there's nothing to step through
+
+            if ( ! g_iTimerCount )
+            {
+                if ( g_iTimerWheelTime <= iCurrTime )
+                    g_iTimerWheelTime = iCurrTime + 1;
+
+                return;
+            }
+
+            while ( g_iTimerWheelTime <= iCurrTime )
+            {
+                int iIndex = ( int ) ( g_iTimerWheelTime & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+
+                // Each time a level finishes a turn, move the next slot of the level above it
+                // down
+
+                if ( ! iIndex )
+                {
+                    for ( int iCurrLevel = 1; iCurrLevel < TIMER_WHEEL_LEVEL_COUNT; ++ iCurrLevel )
+                    {
+                        int iLevelIndex = ( int ) ( ( g_iTimerWheelTime >> ( iCurrLevel * TIMER_WHEEL_SLOT_BITS ) ) & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+                        HandleTimerWheelSlot ( iCurrLevel * TIMER_WHEEL_SLOT_COUNT + iLevelIndex, iCurrTime );
+
+                        if ( iLevelIndex )
+                            break;
+                    }
+                }
+
+                HandleTimerWheelSlot ( iIndex, iCurrTime );
+                ++ g_iTimerWheelTime;
+            }
 		}
-		
+
 		/**************************************************************************************
 		*
 		*	W_GetTimerState ()
@@ -2430,21 +4037,20 @@
 
 		bool W_GetTimerState ( W_TimerHandle hTimer )
 		{
-			return g_Timers [ hTimer ].bIsActive;
+			return g_Timers [ hTimer ].iActiveFrame == g_iTimerFrame;
 		}
 
 		/**************************************************************************************
 		*
 		*	W_Delay ()
 		*
-		*	Suspends execution of the program for the specified duration.
+		*	Suspends execution of the program for the specified duration, sleeping rather than
+		*	spinning for most of it.
 		*/
 
 		void W_Delay ( unsigned int iLength )
 		{
-			unsigned int iStartTime = GetTickCount ();
-
-            while ( GetTickCount () < iStartTime + iLength );
+            SleepUntil ( W_GetMicroTickCount () + ( W_Int64 ) iLength * 1000 );
 		}
 
         /**************************************************************************************
@@ -2463,6 +4069,138 @@
             return iTickCount / g_iTimerFreqPerMs;
         }
 
+        /**************************************************************************************
+        *
+        *   W_GetMicroTickCount ()
+        *
+        *   Returns the tick count from the high-performance timer, in microseconds.
+        */
+
+        W_Int64 W_GetMicroTickCount ()
+        {
+            W_Int64 iTickCount;
+
+            QueryPerformanceCounter ( ( LARGE_INTEGER * ) & iTickCount );
+
+            return iTickCount * 1000 / g_iTimerFreqPerMs;
+        }
+
+	// ---- Frame Pacing ----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   W_SetFrameRate ()
+        *
+        *   Sets the frame rate W_WaitForNextFrame () paces to. Zero turns pacing off, leaving
+        *   W_WaitForNextFrame () to just measure frame times.
+        */
+
+        void W_SetFrameRate ( int iFramesPerSec )
+        {
+            g_iFrameDur = iFramesPerSec > 0 ? 1000000 / iFramesPerSec : 0;
+            g_iLastFrameTime = -1;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_WaitForNextFrame ()
+        *
+        *   Called once per frame to hold the frame rate down. Sleeps until the next frame is
+        *   due, and records how long the frame took for W_GetFrameStats (). Deadlines follow
+        *   on from each other, so a frame that runs a little long is made up by the next one;
+        *   a frame that runs more than a whole frame over starts the schedule again instead of
+        *   rushing to catch up.
+        */
+
+        void W_WaitForNextFrame ()
+        {
+            W_Int64 iCurrTime = W_GetMicroTickCount ();
+
+            if ( g_iLastFrameTime == -1 )
+            {
+                g_iLastFrameTime = iCurrTime;
+                g_iNextFrameTime = iCurrTime;
+            }
+
+            if ( g_iFrameDur )
+            {
+                g_iNextFrameTime += g_iFrameDur;
+
+                if ( iCurrTime - g_iNextFrameTime > g_iFrameDur )
+                    g_iNextFrameTime = iCurrTime;
+                else if ( g_iNextFrameTime > iCurrTime )
+                    SleepUntil ( g_iNextFrameTime );
+
+                iCurrTime = W_GetMicroTickCount ();
+            }
+
+            // Record the frame time
+
+            g_piFrameTimes [ g_iFrameTimeCount % FRAME_STATS_HISTORY_SIZE ] = ( int ) ( iCurrTime - g_iLastFrameTime );
+            ++ g_iFrameTimeCount;
+
+            g_iLastFrameTime = iCurrTime;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetFrameStats ()
+        *
+        *   Returns the mean, 99th percentile and standard deviation of the most recent frame
+        *   times (up to FRAME_STATS_HISTORY_SIZE of them), in milliseconds.
+        */
+
+        void W_GetFrameStats ( W_FrameStats * pStats )
+        {
+            int iCount = g_iFrameTimeCount < FRAME_STATS_HISTORY_SIZE ? g_iFrameTimeCount : FRAME_STATS_HISTORY_SIZE;
+
+            pStats->iFrameCount = iCount;
+            pStats->fMeanTime = 0;
+            pStats->fP99Time = 0;
+            pStats->fJitter = 0;
+
+            if ( ! iCount )
+                return;
+
+            // Find the mean and standard deviation
+
+            double dSum = 0,
+                   dSquareSum = 0;
+
+            for ( int iCurrFrame = 0; iCurrFrame < iCount; ++ iCurrFrame )
+            {
+                dSum += g_piFrameTimes [ iCurrFrame ];
+                dSquareSum += ( double ) g_piFrameTimes [ iCurrFrame ] * g_piFrameTimes [ iCurrFrame ];
+            }
+
+            double dMean = dSum / iCount;
+            double dVariance = dSquareSum / iCount - dMean * dMean;
+
+            pStats->fMeanTime = ( float ) ( dMean / 1000 );
+            pStats->fJitter = ( float ) ( dVariance > 0 ? sqrt ( dVariance ) / 1000 : 0 );
+
+            // Sort a copy of the frame times to find the 99th percentile
+
+            int piSortedTimes [ FRAME_STATS_HISTORY_SIZE ];
+            memcpy ( piSortedTimes, g_piFrameTimes, iCount * sizeof ( int ) );
+            qsort ( piSortedTimes, iCount, sizeof ( int ), CompareFrameTimes );
+
+            pStats->fP99Time = piSortedTimes [ ( iCount * 99 + 99 ) / 100 - 1 ] / 1000.0f;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_ResetFrameStats ()
+        *
+        *   Forgets the frame times measured so far.
+        */
+
+        void W_ResetFrameStats ()
+        {
+            g_iFrameTimeCount = 0;
+            g_iLastFrameTime = -1;
+        }
+
     // ---- Misc ------------------------------------------------------------------------------
 
         /**************************************************************************************
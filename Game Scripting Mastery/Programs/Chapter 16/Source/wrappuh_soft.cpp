@@ -0,0 +1,4655 @@
+/*
+
+	Project.
+
+		Wrappuh
+
+	Abstract.
+
+		Headless software backend. Implements the same interface as wrappuh.cpp, but draws
+        into a framebuffer in system memory instead of a DirectDraw surface, and doesn't use
+        Win32 or DirectX at all. It's compiled in place of wrappuh.cpp, with WRAPPUH_HEADLESS
+        defined for every file that includes wrappuh.h, so games can run on machines with no
+        display, such as build servers running soak tests.
+
+        Input comes from W_SetKeyState () instead of the keyboard, and W_BlitFrame () only
+        counts the frame. Color-keyed blits and fills run through one of several kernels,
+        picked by W_InitWrappuh () to suit the CPU.
+
+        Sprites can be packed into atlases, so many images share one block of pixels, and
+        drawn through a sprite batch, which culls them against the screen, sorts them by
+        layer and atlas, and blits them all in one pass when the batch ends. A batch drawn
+        over a background image can be redrawn with dirty rectangles instead: it's compared
+        with the last batch, and only the parts of the screen where sprites have moved,
+        changed, appeared or gone are redrawn, unless so much has changed that the whole
+        frame is redrawn instead.
+
+        Sounds are played by a software mixer. Each WAV file is decoded once, and every voice
+        playing it reads from the same sample with its own volume and pan. The voices are
+        mixed with the same kinds of kernels as the blits, but only when something is
+        listening: the host can switch on output and read the mix from a ring buffer with
+        W_ReadSoundFrames (), or record it to a WAV file.
+
+        Images can be loaded from a pack cooked by the image cooker, which holds them already
+        converted to the framebuffer's format. The pack is mapped into memory when it's
+        opened and copied out into images on worker threads, one per CPU, and W_LoadImage ()
+        hands those images out instead of reading their BMPs.
+
+        Drawing can be switched off entirely, and the clock can be switched to a virtual one
+        that only moves when W_AdvanceVirtualClock () is called, so a game can be stepped
+        through logical frames as fast as it will run.
+
+	Date Created.
+
+		10.19.2026
+
+	Author.
+
+		Based on wrappuh.cpp, by Alex Varanese
+
+*/
+
+// ---- Includes ------------------------------------------------------------------------------
+
+	#include "wrappuh.h"
+
+    // ---- Blit Kernels ----------------------------------------------------------------------
+
+    #if defined ( _M_IX86 ) || defined ( _M_X64 ) || defined ( __i386__ ) || defined ( __x86_64__ )
+
+        #if defined ( __GNUC__ ) || ( defined ( _MSC_VER ) && _MSC_VER >= 1300 )
+            #define BLIT_SSE2
+            #include <emmintrin.h>
+        #endif
+
+        #if defined ( __GNUC__ ) || ( defined ( _MSC_VER ) && _MSC_VER >= 1700 )
+            #define BLIT_AVX2
+            #include <immintrin.h>
+        #endif
+
+        #if defined ( _MSC_VER )
+            #include <intrin.h>
+        #endif
+
+    #endif
+
+    // GCC only emits SIMD instructions in functions that ask for them, so the rest of the
+    // backend doesn't need to be built for a specific CPU
+
+    #if defined ( __GNUC__ )
+        #define SSE2_KERNEL                 __attribute__ ( ( target ( "sse2" ) ) )
+        #define AVX2_KERNEL                 __attribute__ ( ( target ( "avx2" ) ) )
+    #else
+        #define SSE2_KERNEL
+        #define AVX2_KERNEL
+    #endif
+
+    #if ! defined ( _WIN32 )
+        #include <time.h>
+    #endif
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+    // Win32 builds map packs and start threads with windows.h, and everything else uses
+    // POSIX, which needs -pthread when linking on Linux
+
+    #if ! defined ( _WIN32 )
+        #include <pthread.h>
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <unistd.h>
+    #endif
+
+// ---- Constants -----------------------------------------------------------------------------
+
+	// ---- Video -----------------------------------------------------------------------------
+
+		#define DEF_IMAGE_MASK_COLOR_15		EncodePixel15 ( 31, 0, 31 )
+		#define DEF_IMAGE_MASK_COLOR_16		EncodePixel16 ( 31, 0, 31 )
+		#define DEF_IMAGE_MASK_COLOR_32		EncodePixel32 ( 255, 0, 255 )
+
+		#define DEF_FONT_CHAR_COUNT			93
+
+		#define DEF_SPACE_PRCNT				.5
+		#define DEF_KERN					1
+
+        #define PIXEL_ALIGN                 32          // Scanlines start on 32-byte
+                                                        // boundaries, which suits every kernel
+
+        #define CHECKSUM_SEED               2166136261  // FNV-1a
+        #define CHECKSUM_PRIME              16777619
+
+        #define MAX_ATLAS_FILENAME_SIZE     256
+        #define MAX_BATCH_SOURCE_COUNT      64          // Atlases a batch tells apart when
+                                                        // sorting; the rest sort together
+
+        #define MAX_DIRTY_RECT_COUNT        32          // Rectangles a frame's changes are
+                                                        // merged down to
+        #define DIRTY_RECT_MERGE_SLACK      1024        // Extra pixels worth redrawing to
+                                                        // save a rectangle
+        #define DIRTY_RECT_MAX_COVERAGE     50          // Percent of the screen past which
+                                                        // the whole frame is redrawn
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        #define PACK_ID_STRING              "WPAK"      // The format image_cook.cpp writes
+        #define PACK_VERSION                1
+
+        #define PACK_HEADER_SIZE            16
+        #define PACK_ENTRY_SIZE             160
+        #define PACK_NAME_SIZE              128
+
+        #define MAX_PACK_WORKER_COUNT       16          // Threads a pack is copied out on
+        #define MIN_PACK_WORKER_SIZE        262144      // Bytes worth starting a thread for
+
+	// ---- Input -----------------------------------------------------------------------------
+
+		#define KEY_DELAY					135
+
+    // ---- Audio -----------------------------------------------------------------------------
+
+        #define MIXER_BLOCK_SIZE            256         // Frames mixed at a time
+        #define MIXER_RING_SIZE             8192        // Frames the output ring buffer holds
+                                                        // (must be a power of two)
+
+	// ---- Timers ----------------------------------------------------------------------------
+
+		#define MAX_TIMER_COUNT				1024
+
+        #define TIMER_WHEEL_LEVEL_COUNT     4           // Levels in the timer wheel
+        #define TIMER_WHEEL_SLOT_BITS       6           // Each level has 2 ^ this many slots
+        #define TIMER_WHEEL_SLOT_COUNT      ( 1 << TIMER_WHEEL_SLOT_BITS )
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        #define FRAME_STATS_HISTORY_SIZE    1024        // Frame times kept for the statistics
+
+        // How long before a deadline to stop sleeping and spin, in microseconds. nanosleep ()
+        // usually wakes well within this; Sleep () can run a millisecond over.
+
+    #if ! defined ( _WIN32 )
+        #define FRAME_PACER_SPIN_TIME       200
+    #else
+        #define FRAME_PACER_SPIN_TIME       2000
+    #endif
+
+    // ---- Misc ------------------------------------------------------------------------------
+
+        #define MAX_CMD_LINE_SIZE           4096
+
+// ---- Data Structures -----------------------------------------------------------------------
+
+	// ---- Video -----------------------------------------------------------------------------
+
+		typedef WORD Pixel15;
+		typedef WORD Pixel16;
+		typedef DWORD Pixel32;
+
+		typedef struct
+		{
+			int iXRes,
+				iYRes;
+			int iXMax,
+				iYMax;
+			int iColorDepth;
+			int iPitch;
+		}
+			VideoContext;
+
+		typedef struct
+		{
+			int iCellXRes,
+				iCellYRes;
+			int iCellFullXRes,
+				iCellFullYRes;
+			int iCellPitch;
+
+			int iSpaceXRes;
+
+			int iCharRowSize;
+			int iCharRowRes;
+			int iCharRowMaxX;
+		}
+			FontDesc;
+
+		typedef struct
+		{
+			int iLeftKern,
+				iRightKern;
+			int iXRes;
+
+			int iX,
+				iY;
+		}
+			FontCharDesc;
+
+        // A set of kernels. 15- and 16-bit pixels are the same size, so they share theirs.
+        // Pitches are in bytes.
+
+        typedef struct
+        {
+            char * pstrName;
+
+            void ( * Fill16 ) ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color );
+            void ( * Fill32 ) ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color );
+
+            void ( * BlitKeyed16 ) ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key );
+            void ( * BlitKeyed32 ) ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key );
+        }
+            BlitKernel;
+
+        typedef struct
+        {
+            W_Image Image;
+            int iX,
+                iY;
+            int iLayer;
+            int iSource;                            // Which of the batch's atlases it's from
+            int iIndex;                             // Where it was added to the batch
+        }
+            BatchSprite;
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        typedef struct                              // An image in the open pack
+        {
+            char * pstrName;                        // In the pack's directory
+            W_Image Image;                          // Copied out of the pack
+            bool bIsTaken;                          // Has W_LoadImage () handed it out?
+
+            UCHAR * pCookedPixels;                  // Where its pixels are in the pack
+            int iCookedPitch;
+            int iRowSize;                           // Bytes of pixels in a row
+            int iFirstByte;                         // Where its pixels start, counting those
+                                                    // of every image before it
+        }
+            PackImage;
+
+        typedef struct                              // A worker's share of copying out a pack
+        {
+            int iFirstByte,                         // The bytes it copies, counted the same
+                iLastByte;                          // way as PackImage's iFirstByte
+        #if defined ( _WIN32 )
+            HANDLE hThread;
+        #else
+            pthread_t Thread;
+        #endif
+        }
+            PackWorker;
+
+    // ---- Audio -----------------------------------------------------------------------------
+
+        typedef struct
+        {
+            float * pfSamples;                      // Mono samples scaled to 16-bit range, or
+                                                    // NULL if the sample is free
+            int iLength;                            // Length in frames
+        }
+            SoundSample;
+
+        typedef struct
+        {
+            int iSample;                            // The sample being played
+            int iPos;                               // The next frame to mix
+            float fLeftGain,                        // Volume in each speaker
+                  fRightGain;
+            unsigned int iSerial;                   // When it started, in voices started
+        }
+            Voice;
+
+        // A set of mixing kernels. The mix is interleaved stereo; MixVoice () adds a run of
+        // mono samples to it, and ConvertMix () clamps it to 16-bit samples.
+
+        typedef struct
+        {
+            void ( * MixVoice ) ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain );
+            void ( * ConvertMix ) ( short * psDest, float * pfMix, int iSampleCount );
+        }
+            MixKernel;
+
+	// ---- Timers ----------------------------------------------------------------------------
+
+		typedef struct
+		{
+			bool bIsNull;
+
+			int iLength;
+			W_Int64 iActiveTime;                    // When the timer next goes off
+            int iActiveFrame;                       // The W_HandleTimers () call it last went
+                                                    // off in
+
+            int iSlot;                              // The timer wheel slot it's in
+            int iPrev;                              // The timers before and after it in its
+            int iNext;                              // slot, or the next free timer
+		}
+			Timer;
+
+// ---- Function Prototypes -------------------------------------------------------------------
+
+    // ---- Blit Kernels ----------------------------------------------------------------------
+
+        void Fill16_Scalar ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color );
+        void Fill32_Scalar ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color );
+        void BlitKeyed16_Scalar ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key );
+        void BlitKeyed32_Scalar ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key );
+
+    #ifdef BLIT_SSE2
+        void Fill16_SSE2 ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color );
+        void Fill32_SSE2 ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color );
+        void BlitKeyed16_SSE2 ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key );
+        void BlitKeyed32_SSE2 ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key );
+    #else
+        #define Fill16_SSE2                 Fill16_Scalar
+        #define Fill32_SSE2                 Fill32_Scalar
+        #define BlitKeyed16_SSE2            BlitKeyed16_Scalar
+        #define BlitKeyed32_SSE2            BlitKeyed32_Scalar
+    #endif
+
+    #ifdef BLIT_AVX2
+        void Fill16_AVX2 ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color );
+        void Fill32_AVX2 ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color );
+        void BlitKeyed16_AVX2 ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key );
+        void BlitKeyed32_AVX2 ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key );
+    #else
+        #define Fill16_AVX2                 Fill16_Scalar
+        #define Fill32_AVX2                 Fill32_Scalar
+        #define BlitKeyed16_AVX2            BlitKeyed16_Scalar
+        #define BlitKeyed32_AVX2            BlitKeyed32_Scalar
+    #endif
+
+    // ---- Mix Kernels -----------------------------------------------------------------------
+
+        void MixVoice_Scalar ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain );
+        void ConvertMix_Scalar ( short * psDest, float * pfMix, int iSampleCount );
+
+    #ifdef BLIT_SSE2
+        void MixVoice_SSE2 ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain );
+        void ConvertMix_SSE2 ( short * psDest, float * pfMix, int iSampleCount );
+    #else
+        #define MixVoice_SSE2               MixVoice_Scalar
+        #define ConvertMix_SSE2             ConvertMix_Scalar
+    #endif
+
+    #ifdef BLIT_AVX2
+        void MixVoice_AVX2 ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain );
+        void ConvertMix_AVX2 ( short * psDest, float * pfMix, int iSampleCount );
+    #else
+        #define MixVoice_AVX2               MixVoice_Scalar
+        #define ConvertMix_AVX2             ConvertMix_Scalar
+    #endif
+
+// ---- Global Variables ----------------------------------------------------------------------
+
+	// ---- Win32 -----------------------------------------------------------------------------
+
+		bool g_bAppExit						= FALSE;
+
+        char g_pstrCmdLine [ MAX_CMD_LINE_SIZE ];
+
+	// ---- Video -----------------------------------------------------------------------------
+
+        void * g_pFrameBuffer               = NULL;
+
+        Pixel15 * g_pFrameBuffer15          = NULL;
+        Pixel16 * g_pFrameBuffer16          = NULL;
+        Pixel32 * g_pFrameBuffer32          = NULL;
+        int g_iFrameBufferSize;
+
+        VideoContext g_VideoContext;
+
+        W_Image g_FontImage;
+        FontDesc g_FontDesc;
+        FontCharDesc g_FontCharDesc [ DEF_FONT_CHAR_COUNT ];
+
+        BlitKernel g_BlitKernels [ W_BLIT_KERNEL_COUNT ] =
+        {
+            { "Scalar", Fill16_Scalar, Fill32_Scalar, BlitKeyed16_Scalar, BlitKeyed32_Scalar },
+            { "SSE2", Fill16_SSE2, Fill32_SSE2, BlitKeyed16_SSE2, BlitKeyed32_SSE2 },
+            { "AVX2", Fill16_AVX2, Fill32_AVX2, BlitKeyed16_AVX2, BlitKeyed32_AVX2 }
+        };
+
+        int g_iCurrBlitKernel               = W_BLIT_KERNEL_SCALAR;
+
+        bool g_bIsDrawingEnabled            = TRUE;     // Do blits and fills draw anything?
+
+        BatchSprite g_BatchSprites [ W_MAX_BATCH_SPRITE_COUNT ];
+        int g_iBatchSpriteCount             = 0;
+
+        void * g_pBatchSources [ MAX_BATCH_SOURCE_COUNT ];  // Pixels of each atlas in the
+        int g_iBatchSourceCount             = 0;            // batch, in order of first use
+
+        W_Image g_BatchBackground;                      // Drawn under the batch, if it's set
+        bool g_bIsBatchBackgroundSet        = FALSE;
+        bool g_bIsBatchFlushed              = FALSE;    // Was the batch drawn early this frame?
+
+        bool g_bIsDirtyRectEnabled          = FALSE;    // Are batches only redrawn where
+                                                        // they've changed?
+        bool g_bIsFrameValid                = FALSE;    // Does the framebuffer hold the last
+                                                        // batch, and nothing else?
+
+        W_Image g_LastBatchBackground;                  // The last batch, as it was drawn
+        BatchSprite g_LastBatchSprites [ W_MAX_BATCH_SPRITE_COUNT ];
+        int g_iLastBatchSpriteCount         = 0;
+        bool g_pbIsLastSpriteMatched [ W_MAX_BATCH_SPRITE_COUNT ];
+
+        W_Rect g_DirtyRects [ MAX_DIRTY_RECT_COUNT ];   // The parts of the screen being
+        int g_iDirtyRectCount;                          // redrawn, which never overlap
+
+        int g_iDirtyStatsFrameCount;                    // Dirty rectangle statistics since
+        int g_iDirtyStatsFullCount;                     // the last reset
+        double g_dDirtyStatsCoverage;
+        float g_fLastDirtyCoverage;
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        UCHAR * g_pImagePack                = NULL;     // The mapped pack, if one is open
+        size_t g_iImagePackSize;
+        int g_iImagePackColorDepth;
+
+    #if defined ( _WIN32 )
+        HANDLE g_hImagePackFile;
+        HANDLE g_hImagePackMapping;
+    #endif
+
+        PackImage * g_pPackImages           = NULL;
+        int g_iPackImageCount;
+
+	// ---- Input -----------------------------------------------------------------------------
+
+        BYTE g_KbrdInputState [ 256 ];                  // Set by the host with W_SetKeyState ()
+
+        BYTE g_KbrdState [ 256 ];
+        unsigned int g_KbrdDelay [ 256 ];
+        bool g_KbrdFrameState [ 256 ];
+
+        int g_iKeyDelayActive               = TRUE;
+
+    // ---- Audio -----------------------------------------------------------------------------
+
+        SoundSample g_SoundSamples [ MAX_SOUNDS ];      // Decoded sounds
+
+        Voice g_Voices [ W_MAX_VOICE_COUNT ];           // The voices playing, packed at the
+        int g_iVoiceCount;                              // front
+        unsigned int g_iNextVoiceSerial;
+
+        MixKernel g_MixKernels [ W_BLIT_KERNEL_COUNT ] =
+        {
+            { MixVoice_Scalar, ConvertMix_Scalar },
+            { MixVoice_SSE2, ConvertMix_SSE2 },
+            { MixVoice_AVX2, ConvertMix_AVX2 }
+        };
+
+        int g_iCurrMixKernel                = W_BLIT_KERNEL_SCALAR;
+
+        W_Int64 g_iMixerFrame;                          // Frames of time the mixer has handled
+
+        float g_pfMixBuffer [ MIXER_BLOCK_SIZE * 2 ];   // The block being mixed
+        short g_psMixBlock [ MIXER_BLOCK_SIZE * 2 ];    // The block clamped to 16 bits
+
+        bool g_bIsSoundOutputEnabled        = FALSE;    // Is the mix kept for the host?
+        short g_psSoundRing [ MIXER_RING_SIZE * 2 ];    // Mixed frames waiting to be read
+        W_Int64 g_iRingReadPos;                         // Frames read and written so far
+        W_Int64 g_iRingWritePos;
+
+        FILE * g_pRecordingFile             = NULL;     // The WAV file being recorded, if any
+        int g_iRecordedFrameCount;
+
+    // ---- Timers ----------------------------------------------------------------------------
+
+        W_Int64 g_iStartTime;                           // Microseconds when Wrappuh started
+
+        bool g_bIsVirtualClockEnabled       = FALSE;    // Is the virtual clock in use?
+        DWORD g_iVirtualTime;                           // The virtual clock's time (in
+                                                        // milliseconds)
+        Timer g_Timers [ MAX_TIMER_COUNT ];
+        int g_iFreeTimer;                               // The first free timer
+        int g_iTimerCount;                              // Timers in use
+        int g_iTimerFrame;                              // W_HandleTimers () calls so far
+
+        // The timer wheel. Each slot holds the first of the timers in it; the first level
+        // has a slot per millisecond, and each level after that has a slot per turn of the
+        // one before.
+
+        int g_TimerWheel [ TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_COUNT ];
+        W_Int64 g_iTimerWheelTime;                      // The next millisecond to handle
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        W_Int64 g_iFrameDur;                            // Frame duration to pace to (in
+                                                        // microseconds), or zero for none
+        W_Int64 g_iNextFrameTime;                       // When the next frame should start
+        W_Int64 g_iLastFrameTime;                       // When the last frame started, or -1
+
+        int g_piFrameTimes [ FRAME_STATS_HISTORY_SIZE ];    // Recent frame times (in
+                                                            // microseconds)
+        int g_iFrameTimeCount;                          // Frames measured since the last reset
+
+    // ---- Misc ------------------------------------------------------------------------------
+
+        FILE * g_pErrorFile = NULL;
+
+// ---- Macros --------------------------------------------------------------------------------
+
+	// ---- Misc ------------------------------------------------------------------------------
+
+        #define sfprintf( String )                      \
+        {                                               \
+            if ( g_pErrorFile )                         \
+                fprintf ( g_pErrorFile, String );       \
+        }
+
+	// ---- Video -----------------------------------------------------------------------------
+
+		#define EncodePixel15( iR, iG, iB )									\
+																			\
+			( ( iB & 31 ) | ( ( iG & 31 ) << 5 ) | ( ( iR & 31 ) << 10 ) )
+
+		#define EncodePixel16( iR, iG, iB )									\
+																			\
+			( ( iB & 31 ) | ( ( iG & 63 ) << 6 ) | ( ( iR & 31 ) << 11 ) )
+
+		#define EncodePixel32( iR, iG, iB )		\
+												\
+			( iB | ( iG << 8 ) | ( iR << 16 ) )
+
+        #define GetPixelSize( iColorDepth )     \
+                                                \
+            ( iColorDepth == 32 ? 4 : 2 )
+
+        #define GetPixelRow( pPixels, iPitch, iY )  \
+                                                    \
+            ( ( UCHAR * ) ( pPixels ) + ( iY ) * ( iPitch ) )
+
+        #define GetRectArea( Rect )                 \
+                                                    \
+            ( ( ( Rect ).iX1 - ( Rect ).iX0 ) * ( ( Rect ).iY1 - ( Rect ).iY0 ) )
+
+        #define ReadBMPWord( pBuffer, iOffset )     \
+                                                    \
+            ( ( pBuffer ) [ iOffset ] | ( ( pBuffer ) [ ( iOffset ) + 1 ] << 8 ) )
+
+        #define ReadBMPDWord( pBuffer, iOffset )    \
+                                                    \
+            ( ReadBMPWord ( pBuffer, iOffset ) | ( ReadBMPWord ( pBuffer, ( iOffset ) + 2 ) << 16 ) )
+
+        #define WriteBMPWord( pBuffer, iOffset, iValue )                \
+        {                                                               \
+            ( pBuffer ) [ iOffset ] = ( UCHAR ) ( iValue );             \
+            ( pBuffer ) [ ( iOffset ) + 1 ] = ( UCHAR ) ( ( iValue ) >> 8 );  \
+        }
+
+        #define WriteBMPDWord( pBuffer, iOffset, iValue )               \
+        {                                                               \
+            WriteBMPWord ( pBuffer, iOffset, ( iValue ) );              \
+            WriteBMPWord ( pBuffer, ( iOffset ) + 2, ( iValue ) >> 16 );\
+        }
+
+// ---- Functions -----------------------------------------------------------------------------
+
+    // ---- Memory ----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   AllocPixels ()
+        *
+        *   Allocates a block of pixels aligned to PIXEL_ALIGN bytes. The pointer malloc ()
+        *   returned is stashed just before the aligned block so FreePixels () can find it.
+        */
+
+        void * AllocPixels ( int iSize )
+        {
+            UCHAR * pBlock = ( UCHAR * ) malloc ( iSize + PIXEL_ALIGN + sizeof ( void * ) );
+            if ( ! pBlock )
+                return NULL;
+
+            size_t iAddress = ( size_t ) ( pBlock + sizeof ( void * ) );
+            iAddress = ( iAddress + PIXEL_ALIGN - 1 ) & ~ ( ( size_t ) PIXEL_ALIGN - 1 );
+
+            ( ( void ** ) iAddress ) [ -1 ] = pBlock;
+            memset ( ( void * ) iAddress, 0, iSize );
+
+            return ( void * ) iAddress;
+        }
+
+        /**************************************************************************************
+        *
+        *   FreePixels ()
+        *
+        *   Frees a block allocated with AllocPixels ().
+        */
+
+        void FreePixels ( void * pPixels )
+        {
+            if ( pPixels )
+                free ( ( ( void ** ) pPixels ) [ -1 ] );
+        }
+
+        /**************************************************************************************
+        *
+        *   GetAlignedPitch ()
+        *
+        *   Returns the pitch of a scanline at the current color depth, in bytes.
+        */
+
+        int GetAlignedPitch ( int iXRes )
+        {
+            int iPitch = iXRes * GetPixelSize ( g_VideoContext.iColorDepth );
+
+            return ( iPitch + PIXEL_ALIGN - 1 ) & ~ ( PIXEL_ALIGN - 1 );
+        }
+
+    // ---- Video -----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   IsImagePixelOpaque ()
+        *
+        *   Returns TRUE if the specified pixel of an image isn't the mask color.
+        */
+
+        int IsImagePixelOpaque ( W_Image * Image, int iX, int iY )
+        {
+            UCHAR * pRow = GetPixelRow ( Image->pPixels, Image->iPitch, iY );
+
+            switch ( g_VideoContext.iColorDepth )
+            {
+                case 15:
+                    return ( ( Pixel15 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_15;
+
+                case 16:
+                    return ( ( Pixel16 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_16;
+
+                case 32:
+                    return ( ( Pixel32 * ) pRow ) [ iX ] != DEF_IMAGE_MASK_COLOR_32;
+            }
+
+            return FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   GetOpaqueRect ()
+        *
+        *   Finds the bounding box of the opaque pixels in a rectangle of an image, scanning
+        *   in from each edge the same way the DirectDraw backend does. The box is relative to
+        *   the rectangle, and its second corner is stored as a width and height.
+        */
+
+        W_Rect GetOpaqueRect ( W_Image * Image, int iSourceX, int iSourceY, int iXRes, int iYRes )
+        {
+            W_Rect OpaqueRect;
+
+            int iX,
+                iY;
+
+            for ( iX = 0; iX < iXRes; ++ iX )
+            {
+                for ( iY = 0; iY < iYRes; ++ iY )
+                    if ( IsImagePixelOpaque ( Image, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iY < iYRes )
+                    break;
+            }
+            OpaqueRect.iX0 = iX;
+
+            for ( iX = iXRes - 1; iX >= 0; -- iX )
+            {
+                for ( iY = 0; iY < iYRes; ++ iY )
+                    if ( IsImagePixelOpaque ( Image, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iY < iYRes )
+                    break;
+            }
+            OpaqueRect.iX1 = iX;
+
+            for ( iY = 0; iY < iYRes; ++ iY )
+            {
+                for ( iX = 0; iX < iXRes; ++ iX )
+                    if ( IsImagePixelOpaque ( Image, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iX < iXRes )
+                    break;
+            }
+            OpaqueRect.iY0 = iY;
+
+            for ( iY = iYRes - 1; iY >= 0; -- iY )
+            {
+                for ( iX = 0; iX < iXRes; ++ iX )
+                    if ( IsImagePixelOpaque ( Image, iSourceX + iX, iSourceY + iY ) )
+                        break;
+                if ( iX < iXRes )
+                    break;
+            }
+            OpaqueRect.iY1 = iY;
+
+            OpaqueRect.iX1 -= OpaqueRect.iX0;
+            OpaqueRect.iY1 -= OpaqueRect.iY0;
+
+            return OpaqueRect;
+        }
+
+        /**************************************************************************************
+        *
+        *   ClipBlitSubImage ()
+        *
+        *   Blits a rectangle of an image to the framebuffer with the mask color left out,
+        *   clipping it to a rectangle of the screen first. The clipping rectangle's second
+        *   corner is just outside it.
+        */
+
+        void ClipBlitSubImage ( W_Image * Image, int iSourceX, int iSourceY, int iXRes, int iYRes, int iX, int iY, W_Rect * ClipRect )
+        {
+            if ( ! g_pFrameBuffer || ! Image->pPixels || ! g_bIsDrawingEnabled )
+                return;
+
+            // Clip the destination, moving the source rectangle to match
+
+            if ( iX < ClipRect->iX0 )
+            {
+                iSourceX += ClipRect->iX0 - iX;
+                iXRes -= ClipRect->iX0 - iX;
+                iX = ClipRect->iX0;
+            }
+            if ( iY < ClipRect->iY0 )
+            {
+                iSourceY += ClipRect->iY0 - iY;
+                iYRes -= ClipRect->iY0 - iY;
+                iY = ClipRect->iY0;
+            }
+            if ( iX + iXRes > ClipRect->iX1 )
+                iXRes = ClipRect->iX1 - iX;
+            if ( iY + iYRes > ClipRect->iY1 )
+                iYRes = ClipRect->iY1 - iY;
+
+            if ( iXRes <= 0 || iYRes <= 0 )
+                return;
+
+            UCHAR * pDest = GetPixelRow ( g_pFrameBuffer, g_VideoContext.iPitch, iY );
+            UCHAR * pSource = GetPixelRow ( Image->pPixels, Image->iPitch, iSourceY );
+
+            BlitKernel * pKernel = & g_BlitKernels [ g_iCurrBlitKernel ];
+
+            switch ( g_VideoContext.iColorDepth )
+            {
+                case 15:
+                    pKernel->BlitKeyed16 ( ( Pixel16 * ) pDest + iX, g_VideoContext.iPitch,
+                                           ( Pixel16 * ) pSource + iSourceX, Image->iPitch,
+                                           iXRes, iYRes, ( Pixel16 ) DEF_IMAGE_MASK_COLOR_15 );
+                    break;
+
+                case 16:
+                    pKernel->BlitKeyed16 ( ( Pixel16 * ) pDest + iX, g_VideoContext.iPitch,
+                                           ( Pixel16 * ) pSource + iSourceX, Image->iPitch,
+                                           iXRes, iYRes, ( Pixel16 ) DEF_IMAGE_MASK_COLOR_16 );
+                    break;
+
+                case 32:
+                    pKernel->BlitKeyed32 ( ( Pixel32 * ) pDest + iX, g_VideoContext.iPitch,
+                                           ( Pixel32 * ) pSource + iSourceX, Image->iPitch,
+                                           iXRes, iYRes, ( Pixel32 ) DEF_IMAGE_MASK_COLOR_32 );
+                    break;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitSubImage ()
+        *
+        *   Blits a rectangle of an image to the framebuffer with the mask color left out,
+        *   clipping it to the screen first.
+        */
+
+        void BlitSubImage ( W_Image * Image, int iSourceX, int iSourceY, int iXRes, int iYRes, int iX, int iY )
+        {
+            W_Rect ScreenRect;
+            ScreenRect.iX0 = 0;
+            ScreenRect.iY0 = 0;
+            ScreenRect.iX1 = g_VideoContext.iXRes;
+            ScreenRect.iY1 = g_VideoContext.iYRes;
+
+            ClipBlitSubImage ( Image, iSourceX, iSourceY, iXRes, iYRes, iX, iY, & ScreenRect );
+        }
+
+        /**************************************************************************************
+        *
+        *   CompareBatchSprites ()
+        *
+        *   qsort () comparison function for ordering a sprite batch by layer, then atlas,
+        *   then the order the sprites were added in.
+        */
+
+        int CompareBatchSprites ( const void * pA, const void * pB )
+        {
+            BatchSprite * SpriteA = ( BatchSprite * ) pA;
+            BatchSprite * SpriteB = ( BatchSprite * ) pB;
+
+            if ( SpriteA->iLayer != SpriteB->iLayer )
+                return SpriteA->iLayer - SpriteB->iLayer;
+
+            if ( SpriteA->iSource != SpriteB->iSource )
+                return SpriteA->iSource - SpriteB->iSource;
+
+            return SpriteA->iIndex - SpriteB->iIndex;
+        }
+
+        /**************************************************************************************
+        *
+        *   IsSameImage ()
+        *
+        *   Returns TRUE if two images are the same pixels of the same surface.
+        */
+
+        int IsSameImage ( W_Image * ImageA, W_Image * ImageB )
+        {
+            return ImageA->pPixels == ImageB->pPixels &&
+                   ImageA->iSourceX == ImageB->iSourceX && ImageA->iSourceY == ImageB->iSourceY &&
+                   ImageA->iXRes == ImageB->iXRes && ImageA->iYRes == ImageB->iYRes;
+        }
+
+        /**************************************************************************************
+        *
+        *   IsSameBatchSprite ()
+        *
+        *   Returns TRUE if two batched sprites draw the same image in the same place.
+        */
+
+        int IsSameBatchSprite ( BatchSprite * SpriteA, BatchSprite * SpriteB )
+        {
+            return SpriteA->iX == SpriteB->iX && SpriteA->iY == SpriteB->iY &&
+                   SpriteA->iLayer == SpriteB->iLayer &&
+                   IsSameImage ( & SpriteA->Image, & SpriteB->Image );
+        }
+
+        /**************************************************************************************
+        *
+        *   GetSpriteRect ()
+        *
+        *   Returns the part of the screen a batched sprite draws on, which is its image's
+        *   bounding box clipped to the screen. The second corner is just outside it.
+        */
+
+        W_Rect GetSpriteRect ( BatchSprite * Sprite )
+        {
+            W_Rect Rect;
+            Rect.iX0 = Sprite->iX + Sprite->Image.ClipRect.iX0;
+            Rect.iY0 = Sprite->iY + Sprite->Image.ClipRect.iY0;
+            Rect.iX1 = Rect.iX0 + Sprite->Image.ClipRect.iX1 + 1;
+            Rect.iY1 = Rect.iY0 + Sprite->Image.ClipRect.iY1 + 1;
+
+            if ( Rect.iX0 < 0 )
+                Rect.iX0 = 0;
+            if ( Rect.iY0 < 0 )
+                Rect.iY0 = 0;
+            if ( Rect.iX1 > g_VideoContext.iXRes )
+                Rect.iX1 = g_VideoContext.iXRes;
+            if ( Rect.iY1 > g_VideoContext.iYRes )
+                Rect.iY1 = g_VideoContext.iYRes;
+
+            return Rect;
+        }
+
+        /**************************************************************************************
+        *
+        *   GetRectUnion ()
+        *
+        *   Returns the smallest rectangle that holds both of the specified ones.
+        */
+
+        W_Rect GetRectUnion ( W_Rect * RectA, W_Rect * RectB )
+        {
+            W_Rect Union;
+            Union.iX0 = RectA->iX0 < RectB->iX0 ? RectA->iX0 : RectB->iX0;
+            Union.iY0 = RectA->iY0 < RectB->iY0 ? RectA->iY0 : RectB->iY0;
+            Union.iX1 = RectA->iX1 > RectB->iX1 ? RectA->iX1 : RectB->iX1;
+            Union.iY1 = RectA->iY1 > RectB->iY1 ? RectA->iY1 : RectB->iY1;
+
+            return Union;
+        }
+
+        /**************************************************************************************
+        *
+        *   AddDirtyRect ()
+        *
+        *   Adds a rectangle to the parts of the screen being redrawn. It's merged with any
+        *   rectangle it overlaps, or that it would cost little more to redraw as one with,
+        *   so the list never covers a pixel twice. If the list is full, it's merged with
+        *   whichever rectangle grows the least.
+        */
+
+        void AddDirtyRect ( W_Rect Rect )
+        {
+            if ( Rect.iX0 >= Rect.iX1 || Rect.iY0 >= Rect.iY1 )
+                return;
+
+            int iCurrRect = 0;
+            while ( iCurrRect < g_iDirtyRectCount )
+            {
+                W_Rect * CurrRect = & g_DirtyRects [ iCurrRect ];
+                W_Rect Union = GetRectUnion ( & Rect, CurrRect );
+
+                int iIsOverlapping = Rect.iX0 < CurrRect->iX1 && CurrRect->iX0 < Rect.iX1 &&
+                                     Rect.iY0 < CurrRect->iY1 && CurrRect->iY0 < Rect.iY1;
+
+                if ( iIsOverlapping ||
+                     GetRectArea ( Union ) <= GetRectArea ( Rect ) + GetRectArea ( * CurrRect ) + DIRTY_RECT_MERGE_SLACK )
+                {
+                    // The bigger rectangle may now reach ones that have already been passed,
+                    // so start over
+
+                    Rect = Union;
+                    g_DirtyRects [ iCurrRect ] = g_DirtyRects [ -- g_iDirtyRectCount ];
+                    iCurrRect = 0;
+                }
+                else
+                    ++ iCurrRect;
+            }
+
+            if ( g_iDirtyRectCount < MAX_DIRTY_RECT_COUNT )
+            {
+                g_DirtyRects [ g_iDirtyRectCount ++ ] = Rect;
+                return;
+            }
+
+            int iBestRect = 0,
+                iBestGrowth = INT_MAX;
+
+            for ( iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+            {
+                W_Rect Union = GetRectUnion ( & Rect, & g_DirtyRects [ iCurrRect ] );
+                int iGrowth = GetRectArea ( Union ) - GetRectArea ( g_DirtyRects [ iCurrRect ] );
+
+                if ( iGrowth < iBestGrowth )
+                {
+                    iBestRect = iCurrRect;
+                    iBestGrowth = iGrowth;
+                }
+            }
+
+            W_Rect Union = GetRectUnion ( & Rect, & g_DirtyRects [ iBestRect ] );
+            g_DirtyRects [ iBestRect ] = g_DirtyRects [ -- g_iDirtyRectCount ];
+            AddDirtyRect ( Union );
+        }
+
+        /**************************************************************************************
+        *
+        *   FindDirtyRects ()
+        *
+        *   Compares the sorted batch with the last one, and fills the dirty rectangle list
+        *   with the parts of the screen that have changed. Sprites are matched up in drawing
+        *   order, so a sprite is only left alone if the last batch drew the same image in
+        *   the same place, in the same order relative to the other sprites left alone. Every
+        *   other sprite marks where it is now, and every sprite in the last batch that wasn't
+        *   matched marks where it was.
+        */
+
+        void FindDirtyRects ()
+        {
+            g_iDirtyRectCount = 0;
+
+            memset ( g_pbIsLastSpriteMatched, 0, g_iLastBatchSpriteCount * sizeof ( bool ) );
+
+            int iNextLastSprite = 0;
+            int iCurrSprite;
+
+            for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+            {
+                BatchSprite * Sprite = & g_BatchSprites [ iCurrSprite ];
+
+                int iLastSprite;
+                for ( iLastSprite = iNextLastSprite; iLastSprite < g_iLastBatchSpriteCount; ++ iLastSprite )
+                    if ( IsSameBatchSprite ( Sprite, & g_LastBatchSprites [ iLastSprite ] ) )
+                        break;
+
+                if ( iLastSprite < g_iLastBatchSpriteCount )
+                {
+                    g_pbIsLastSpriteMatched [ iLastSprite ] = TRUE;
+                    iNextLastSprite = iLastSprite + 1;
+                }
+                else
+                    AddDirtyRect ( GetSpriteRect ( Sprite ) );
+            }
+
+            for ( iCurrSprite = 0; iCurrSprite < g_iLastBatchSpriteCount; ++ iCurrSprite )
+                if ( ! g_pbIsLastSpriteMatched [ iCurrSprite ] )
+                    AddDirtyRect ( GetSpriteRect ( & g_LastBatchSprites [ iCurrSprite ] ) );
+        }
+
+        /**************************************************************************************
+        *
+        *   DrawSpriteBatch ()
+        *
+        *   Sorts the sprite batch and blits it over the batch's background, then empties it.
+        *   At the end of a frame, with dirty rectangles on, only the parts of the screen that
+        *   have changed since the last batch are redrawn, unless they cover too much of it.
+        *   A batch drawn early because it filled up is always drawn in full, and so is the
+        *   rest of its frame.
+        */
+
+        void DrawSpriteBatch ( int iIsFrameEnd )
+        {
+            qsort ( g_BatchSprites, g_iBatchSpriteCount, sizeof ( BatchSprite ), CompareBatchSprites );
+
+            // Dirty rectangles only work if the framebuffer still holds the last batch, drawn
+            // over the same background
+
+            int iScreenArea = g_VideoContext.iXRes * g_VideoContext.iYRes;
+            int iDirtyArea = iScreenArea;
+            int iIsFullRedraw = TRUE;
+
+            if ( g_bIsDirtyRectEnabled && iIsFrameEnd && g_bIsFrameValid && ! g_bIsBatchFlushed &&
+                 g_bIsBatchBackgroundSet && IsSameImage ( & g_BatchBackground, & g_LastBatchBackground ) )
+            {
+                FindDirtyRects ();
+
+                iDirtyArea = 0;
+                for ( int iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+                    iDirtyArea += GetRectArea ( g_DirtyRects [ iCurrRect ] );
+
+                if ( iDirtyArea * 100 <= iScreenArea * DIRTY_RECT_MAX_COVERAGE )
+                    iIsFullRedraw = FALSE;
+                else
+                    iDirtyArea = iScreenArea;
+            }
+
+            int iCurrSprite;
+            BatchSprite * Sprite;
+
+            if ( iIsFullRedraw )
+            {
+                // Draw the background, unless the batch has already been drawn early this
+                // frame, then every sprite over it
+
+                if ( g_bIsBatchBackgroundSet && ! g_bIsBatchFlushed )
+                    BlitSubImage ( & g_BatchBackground, g_BatchBackground.iSourceX, g_BatchBackground.iSourceY,
+                                   g_BatchBackground.iXRes, g_BatchBackground.iYRes, 0, 0 );
+
+                for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+                {
+                    Sprite = & g_BatchSprites [ iCurrSprite ];
+
+                    BlitSubImage ( & Sprite->Image, Sprite->Image.iSourceX, Sprite->Image.iSourceY,
+                                   Sprite->Image.iXRes, Sprite->Image.iYRes, Sprite->iX, Sprite->iY );
+                }
+            }
+            else
+            {
+                // Rebuild each dirty rectangle from the background up, clipping everything
+                // to it
+
+                for ( int iCurrRect = 0; iCurrRect < g_iDirtyRectCount; ++ iCurrRect )
+                {
+                    W_Rect * DirtyRect = & g_DirtyRects [ iCurrRect ];
+
+                    ClipBlitSubImage ( & g_BatchBackground, g_BatchBackground.iSourceX, g_BatchBackground.iSourceY,
+                                       g_BatchBackground.iXRes, g_BatchBackground.iYRes, 0, 0, DirtyRect );
+
+                    for ( iCurrSprite = 0; iCurrSprite < g_iBatchSpriteCount; ++ iCurrSprite )
+                    {
+                        Sprite = & g_BatchSprites [ iCurrSprite ];
+
+                        ClipBlitSubImage ( & Sprite->Image, Sprite->Image.iSourceX, Sprite->Image.iSourceY,
+                                           Sprite->Image.iXRes, Sprite->Image.iYRes, Sprite->iX, Sprite->iY, DirtyRect );
+                    }
+                }
+            }
+
+            if ( iIsFrameEnd )
+            {
+                ++ g_iDirtyStatsFrameCount;
+                if ( iIsFullRedraw )
+                    ++ g_iDirtyStatsFullCount;
+
+                g_fLastDirtyCoverage = ( float ) iDirtyArea / iScreenArea;
+                g_dDirtyStatsCoverage += g_fLastDirtyCoverage;
+
+                // Keep the batch, so the next one can be compared with it
+
+                g_bIsFrameValid = g_bIsDirtyRectEnabled && g_bIsBatchBackgroundSet && ! g_bIsBatchFlushed;
+
+                if ( g_bIsFrameValid )
+                {
+                    memcpy ( g_LastBatchSprites, g_BatchSprites, g_iBatchSpriteCount * sizeof ( BatchSprite ) );
+                    g_iLastBatchSpriteCount = g_iBatchSpriteCount;
+                    g_LastBatchBackground = g_BatchBackground;
+                }
+            }
+            else
+                g_bIsBatchFlushed = TRUE;
+
+            g_iBatchSpriteCount = 0;
+            g_iBatchSourceCount = 0;
+        }
+
+    // ---- Image Packs -----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   MapImagePack ()
+        *
+        *   Maps a pack into memory, read-only. Returns FALSE if it can't be opened.
+        */
+
+        bool MapImagePack ( char * pstrFilename )
+        {
+        #if defined ( _WIN32 )
+            g_hImagePackFile = CreateFile ( pstrFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+            if ( g_hImagePackFile == INVALID_HANDLE_VALUE )
+                return FALSE;
+
+            DWORD iSize = GetFileSize ( g_hImagePackFile, NULL );
+
+            g_hImagePackMapping = NULL;
+            if ( iSize && iSize != INVALID_FILE_SIZE )
+                g_hImagePackMapping = CreateFileMapping ( g_hImagePackFile, NULL, PAGE_READONLY, 0, 0, NULL );
+
+            if ( g_hImagePackMapping )
+                g_pImagePack = ( UCHAR * ) MapViewOfFile ( g_hImagePackMapping, FILE_MAP_READ, 0, 0, 0 );
+
+            if ( ! g_pImagePack )
+            {
+                if ( g_hImagePackMapping )
+                    CloseHandle ( g_hImagePackMapping );
+                CloseHandle ( g_hImagePackFile );
+                return FALSE;
+            }
+
+            g_iImagePackSize = iSize;
+        #else
+            int iFile = open ( pstrFilename, O_RDONLY );
+            if ( iFile == -1 )
+                return FALSE;
+
+            struct stat FileStatus;
+            void * pPack = MAP_FAILED;
+
+            if ( fstat ( iFile, & FileStatus ) == 0 && FileStatus.st_size > 0 )
+                pPack = mmap ( NULL, FileStatus.st_size, PROT_READ, MAP_PRIVATE, iFile, 0 );
+
+            // The mapping outlives the file descriptor
+
+            close ( iFile );
+
+            if ( pPack == MAP_FAILED )
+                return FALSE;
+
+            g_pImagePack = ( UCHAR * ) pPack;
+            g_iImagePackSize = FileStatus.st_size;
+        #endif
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   UnmapImagePack ()
+        *
+        *   Unmaps the pack mapped by MapImagePack ().
+        */
+
+        void UnmapImagePack ()
+        {
+            if ( ! g_pImagePack )
+                return;
+
+        #if defined ( _WIN32 )
+            UnmapViewOfFile ( g_pImagePack );
+            CloseHandle ( g_hImagePackMapping );
+            CloseHandle ( g_hImagePackFile );
+        #else
+            munmap ( g_pImagePack, g_iImagePackSize );
+        #endif
+
+            g_pImagePack = NULL;
+        }
+
+        /**************************************************************************************
+        *
+        *   CopyPackRows ()
+        *
+        *   Copies a range of an image's rows out of the pack into a Wrappuh image.
+        */
+
+        void CopyPackRows ( PackImage * pImage, W_Image * Image, int iFirstRow, int iLastRow )
+        {
+            for ( int iY = iFirstRow; iY < iLastRow; ++ iY )
+                memcpy ( GetPixelRow ( Image->pPixels, Image->iPitch, iY ),
+                         pImage->pCookedPixels + iY * pImage->iCookedPitch,
+                         pImage->iRowSize );
+        }
+
+        /**************************************************************************************
+        *
+        *   CopyPackBytes ()
+        *
+        *   Copies out every row that starts within a range of the pack's pixels, counting
+        *   the pixels of every image end to end. Workers are given ranges that don't overlap,
+        *   so each row is copied by exactly one of them.
+        */
+
+        void CopyPackBytes ( int iFirstByte, int iLastByte )
+        {
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                PackImage * pImage = & g_pPackImages [ iCurrImage ];
+
+                if ( pImage->iFirstByte >= iLastByte )
+                    break;
+                if ( pImage->iFirstByte + pImage->iRowSize * pImage->Image.iYRes <= iFirstByte )
+                    continue;
+
+                int iFirstRow = 0;
+                if ( iFirstByte > pImage->iFirstByte )
+                    iFirstRow = ( iFirstByte - pImage->iFirstByte + pImage->iRowSize - 1 ) / pImage->iRowSize;
+
+                int iLastRow = ( iLastByte - pImage->iFirstByte + pImage->iRowSize - 1 ) / pImage->iRowSize;
+                if ( iLastRow > pImage->Image.iYRes )
+                    iLastRow = pImage->Image.iYRes;
+
+                CopyPackRows ( pImage, & pImage->Image, iFirstRow, iLastRow );
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   PackWorkerMain ()
+        *
+        *   The entry point of a thread copying out its share of a pack.
+        */
+
+    #if defined ( _WIN32 )
+        DWORD WINAPI PackWorkerMain ( LPVOID pParam )
+    #else
+        void * PackWorkerMain ( void * pParam )
+    #endif
+        {
+            PackWorker * pWorker = ( PackWorker * ) pParam;
+
+            CopyPackBytes ( pWorker->iFirstByte, pWorker->iLastByte );
+
+            return 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   StartPackWorker ()
+        *
+        *   Starts a worker's thread, returning FALSE if it couldn't be started.
+        */
+
+        bool StartPackWorker ( PackWorker * pWorker )
+        {
+        #if defined ( _WIN32 )
+            pWorker->hThread = CreateThread ( NULL, 0, PackWorkerMain, pWorker, 0, NULL );
+
+            return pWorker->hThread != NULL;
+        #else
+            return pthread_create ( & pWorker->Thread, NULL, PackWorkerMain, pWorker ) == 0;
+        #endif
+        }
+
+        /**************************************************************************************
+        *
+        *   JoinPackWorker ()
+        *
+        *   Waits for a worker started by StartPackWorker () to finish.
+        */
+
+        void JoinPackWorker ( PackWorker * pWorker )
+        {
+        #if defined ( _WIN32 )
+            WaitForSingleObject ( pWorker->hThread, INFINITE );
+            CloseHandle ( pWorker->hThread );
+        #else
+            pthread_join ( pWorker->Thread, NULL );
+        #endif
+        }
+
+        /**************************************************************************************
+        *
+        *   LoadPackImage ()
+        *
+        *   Loads an image from the open pack, if it's in there. The first load of each image
+        *   takes the copy made when the pack was opened; any after that copy it out again.
+        */
+
+        bool LoadPackImage ( char * pstrName, W_Image * Image )
+        {
+            if ( ! g_pImagePack || g_iImagePackColorDepth != g_VideoContext.iColorDepth )
+                return FALSE;
+
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+            {
+                PackImage * pImage = & g_pPackImages [ iCurrImage ];
+
+                if ( strcmp ( pImage->pstrName, pstrName ) != 0 )
+                    continue;
+
+                * Image = pImage->Image;
+
+                if ( ! pImage->bIsTaken )
+                {
+                    pImage->bIsTaken = TRUE;
+                    return TRUE;
+                }
+
+                if ( ! ( Image->pPixels = AllocPixels ( Image->iPitch * Image->iYRes ) ) )
+                    return FALSE;
+
+                CopyPackRows ( pImage, Image, 0, Image->iYRes );
+
+                return TRUE;
+            }
+
+            return FALSE;
+        }
+
+    // ---- Audio -----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   LoadWAV ()
+        *
+        *   Decodes an 8- or 16-bit PCM WAV file into a sample. Files with more than one
+        *   channel are mixed down to mono. Like the DirectSound backend, the mixer plays every
+        *   sample at its own rate, so the file's rate is ignored.
+        */
+
+        bool LoadWAV ( char * pstrWAVFilename, SoundSample * pSample )
+        {
+            FILE * pFile;
+            if ( ! ( pFile = fopen ( pstrWAVFilename, "rb" ) ) )
+                return FALSE;
+
+            fseek ( pFile, 0, SEEK_END );
+            int iFileSize = ( int ) ftell ( pFile );
+            fseek ( pFile, 0, SEEK_SET );
+
+            UCHAR * pBuffer = ( UCHAR * ) malloc ( iFileSize > 0 ? iFileSize : 1 );
+            if ( ! pBuffer )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            iFileSize = ( int ) fread ( pBuffer, 1, iFileSize, pFile );
+            fclose ( pFile );
+
+            // Find the format and data chunks
+
+            int iChannelCount = 0,
+                iBitsPerSample = 0;
+            UCHAR * pData = NULL;
+            int iDataSize = 0;
+
+            if ( iFileSize >= 12 && memcmp ( pBuffer, "RIFF", 4 ) == 0 && memcmp ( pBuffer + 8, "WAVE", 4 ) == 0 )
+            {
+                int iOffset = 12;
+
+                while ( iOffset + 8 <= iFileSize )
+                {
+                    UCHAR * pChunk = pBuffer + iOffset;
+                    unsigned int iChunkSize = ( unsigned int ) ReadBMPDWord ( pChunk, 4 );
+
+                    if ( iChunkSize > ( unsigned int ) ( iFileSize - iOffset - 8 ) )
+                        iChunkSize = iFileSize - iOffset - 8;
+
+                    if ( memcmp ( pChunk, "fmt ", 4 ) == 0 && iChunkSize >= 16 && ReadBMPWord ( pChunk, 8 ) == 1 )
+                    {
+                        iChannelCount = ReadBMPWord ( pChunk, 10 );
+                        iBitsPerSample = ReadBMPWord ( pChunk, 22 );
+                    }
+                    else if ( memcmp ( pChunk, "data", 4 ) == 0 )
+                    {
+                        pData = pChunk + 8;
+                        iDataSize = ( int ) iChunkSize;
+                    }
+
+                    iOffset += 8 + iChunkSize + ( iChunkSize & 1 );
+                }
+            }
+
+            if ( ! pData || iChannelCount < 1 || ( iBitsPerSample != 8 && iBitsPerSample != 16 ) )
+            {
+                free ( pBuffer );
+                return FALSE;
+            }
+
+            // Convert each frame to a float in 16-bit range
+
+            int iFrameSize = iChannelCount * iBitsPerSample / 8;
+            int iLength = iDataSize / iFrameSize;
+
+            float * pfSamples = ( float * ) malloc ( ( iLength > 0 ? iLength : 1 ) * sizeof ( float ) );
+            if ( ! pfSamples )
+            {
+                free ( pBuffer );
+                return FALSE;
+            }
+
+            for ( int iCurrFrame = 0; iCurrFrame < iLength; ++ iCurrFrame )
+            {
+                UCHAR * pFrame = pData + iCurrFrame * iFrameSize;
+                int iSum = 0;
+
+                for ( int iCurrChannel = 0; iCurrChannel < iChannelCount; ++ iCurrChannel )
+                {
+                    if ( iBitsPerSample == 8 )
+                        iSum += ( pFrame [ iCurrChannel ] - 128 ) * 256;
+                    else
+                        iSum += ( short ) ReadBMPWord ( pFrame, iCurrChannel * 2 );
+                }
+
+                pfSamples [ iCurrFrame ] = ( float ) iSum / iChannelCount;
+            }
+
+            free ( pBuffer );
+
+            pSample->pfSamples = pfSamples;
+            pSample->iLength = iLength;
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   StartVoice ()
+        *
+        *   Starts a voice playing a sample from the beginning. If every voice is in use, the
+        *   one that's been playing longest is taken over.
+        */
+
+        void StartVoice ( int iSample, float fLeftGain, float fRightGain )
+        {
+            int iVoice = g_iVoiceCount;
+
+            if ( g_iVoiceCount < W_MAX_VOICE_COUNT )
+            {
+                ++ g_iVoiceCount;
+            }
+            else
+            {
+                iVoice = 0;
+
+                for ( int iCurrVoice = 1; iCurrVoice < g_iVoiceCount; ++ iCurrVoice )
+                    if ( g_iNextVoiceSerial - g_Voices [ iCurrVoice ].iSerial > g_iNextVoiceSerial - g_Voices [ iVoice ].iSerial )
+                        iVoice = iCurrVoice;
+            }
+
+            Voice * pVoice = & g_Voices [ iVoice ];
+
+            pVoice->iSample = iSample;
+            pVoice->iPos = 0;
+            pVoice->fLeftGain = fLeftGain;
+            pVoice->fRightGain = fRightGain;
+            pVoice->iSerial = g_iNextVoiceSerial ++;
+        }
+
+        /**************************************************************************************
+        *
+        *   StopVoice ()
+        *
+        *   Stops a voice, moving the last voice into its place.
+        */
+
+        void StopVoice ( int iVoice )
+        {
+            -- g_iVoiceCount;
+            g_Voices [ iVoice ] = g_Voices [ g_iVoiceCount ];
+        }
+
+        /**************************************************************************************
+        *
+        *   MixVoices ()
+        *
+        *   Adds the next frames of every voice to an interleaved stereo mix, and stops the
+        *   voices that reach the end of their samples. With no mix the voices are just moved
+        *   along.
+        */
+
+        void MixVoices ( float * pfMix, int iFrameCount )
+        {
+            int iCurrVoice = 0;
+
+            while ( iCurrVoice < g_iVoiceCount )
+            {
+                Voice * pVoice = & g_Voices [ iCurrVoice ];
+                SoundSample * pSample = & g_SoundSamples [ pVoice->iSample ];
+
+                int iMixCount = pSample->iLength - pVoice->iPos;
+                if ( iMixCount > iFrameCount )
+                    iMixCount = iFrameCount;
+
+                if ( pfMix && iMixCount > 0 )
+                    g_MixKernels [ g_iCurrMixKernel ].MixVoice ( pfMix, pSample->pfSamples + pVoice->iPos, iMixCount,
+                                                                 pVoice->fLeftGain, pVoice->fRightGain );
+
+                pVoice->iPos += iMixCount;
+
+                if ( pVoice->iPos >= pSample->iLength )
+                    StopVoice ( iCurrVoice );
+                else
+                    ++ iCurrVoice;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   MixSoundBlock ()
+        *
+        *   Mixes a block of up to MIXER_BLOCK_SIZE frames, then writes it to the recording
+        *   and adds it to the ring buffer as needed.
+        */
+
+        void MixSoundBlock ( int iFrameCount )
+        {
+            memset ( g_pfMixBuffer, 0, iFrameCount * 2 * sizeof ( float ) );
+            MixVoices ( g_pfMixBuffer, iFrameCount );
+            g_MixKernels [ g_iCurrMixKernel ].ConvertMix ( g_psMixBlock, g_pfMixBuffer, iFrameCount * 2 );
+
+            // WAV files are little-endian, like every CPU this backend runs on
+
+            if ( g_pRecordingFile )
+            {
+                fwrite ( g_psMixBlock, sizeof ( short ) * 2, iFrameCount, g_pRecordingFile );
+                g_iRecordedFrameCount += iFrameCount;
+            }
+
+            // If the host hasn't kept up, the oldest frames in the ring are overwritten
+
+            if ( g_bIsSoundOutputEnabled )
+            {
+                for ( int iCurrFrame = 0; iCurrFrame < iFrameCount; ++ iCurrFrame )
+                {
+                    int iRingIndex = ( int ) ( g_iRingWritePos & ( MIXER_RING_SIZE - 1 ) ) * 2;
+
+                    g_psSoundRing [ iRingIndex ] = g_psMixBlock [ iCurrFrame * 2 ];
+                    g_psSoundRing [ iRingIndex + 1 ] = g_psMixBlock [ iCurrFrame * 2 + 1 ];
+
+                    ++ g_iRingWritePos;
+                }
+
+                if ( g_iRingWritePos - g_iRingReadPos > MIXER_RING_SIZE )
+                    g_iRingReadPos = g_iRingWritePos - MIXER_RING_SIZE;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   WriteWAVHeader ()
+        *
+        *   Writes the header of a 16-bit stereo WAV file at the mixer's rate.
+        */
+
+        void WriteWAVHeader ( FILE * pFile, int iFrameCount )
+        {
+            UCHAR pHeader [ 44 ];
+
+            memcpy ( pHeader, "RIFF", 4 );
+            WriteBMPDWord ( pHeader, 4, 36 + iFrameCount * 4 );
+            memcpy ( pHeader + 8, "WAVEfmt ", 8 );
+            WriteBMPDWord ( pHeader, 16, 16 );
+            WriteBMPWord ( pHeader, 20, 1 );
+            WriteBMPWord ( pHeader, 22, 2 );
+            WriteBMPDWord ( pHeader, 24, W_MIXER_RATE );
+            WriteBMPDWord ( pHeader, 28, W_MIXER_RATE * 4 );
+            WriteBMPWord ( pHeader, 32, 4 );
+            WriteBMPWord ( pHeader, 34, 16 );
+            memcpy ( pHeader + 36, "data", 4 );
+            WriteBMPDWord ( pHeader, 40, iFrameCount * 4 );
+
+            fwrite ( pHeader, 1, sizeof ( pHeader ), pFile );
+        }
+
+    // ---- Timers ----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   GetMicroTime ()
+        *
+        *   Returns the time in microseconds from an arbitrary starting point.
+        */
+
+        W_Int64 GetMicroTime ()
+        {
+        #if ! defined ( _WIN32 )
+            timespec CurrTime;
+            clock_gettime ( CLOCK_MONOTONIC, & CurrTime );
+
+            return ( W_Int64 ) CurrTime.tv_sec * 1000000 + CurrTime.tv_nsec / 1000;
+        #else
+            W_Int64 iTickCount,
+                    iTimerFreq;
+
+            QueryPerformanceCounter ( ( LARGE_INTEGER * ) & iTickCount );
+            QueryPerformanceFrequency ( ( LARGE_INTEGER * ) & iTimerFreq );
+
+            return iTickCount / iTimerFreq * 1000000 + iTickCount % iTimerFreq * 1000000 / iTimerFreq;
+        #endif
+        }
+
+        /**************************************************************************************
+        *
+        *   InitTimers ()
+        *
+        *   Empties the timer wheel and puts every timer on the free list.
+        */
+
+        void InitTimers ()
+        {
+            for ( int iCurrSlot = 0; iCurrSlot < TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_COUNT; ++ iCurrSlot )
+                g_TimerWheel [ iCurrSlot ] = -1;
+
+            for ( int iCurrTimerIndex = 0; iCurrTimerIndex < MAX_TIMER_COUNT; ++ iCurrTimerIndex )
+            {
+                g_Timers [ iCurrTimerIndex ].bIsNull = TRUE;
+                g_Timers [ iCurrTimerIndex ].iNext = iCurrTimerIndex + 1 < MAX_TIMER_COUNT ? iCurrTimerIndex + 1 : -1;
+            }
+
+            g_iFreeTimer = 0;
+            g_iTimerCount = 0;
+            g_iTimerFrame = 0;
+            g_iTimerWheelTime = W_GetHighPerformanceTickCount ();
+        }
+
+        /**************************************************************************************
+        *
+        *   AddTimerToWheel ()
+        *
+        *   Puts a timer in the wheel. Timers due within a turn of the first level go in the
+        *   slot for their millisecond; later ones go in the first level whose turn covers
+        *   them, and are moved down a level each time their slot comes around. Timers that are
+        *   already due go in the slot handled next.
+        */
+
+        void AddTimerToWheel ( int iTimerIndex )
+        {
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+
+            W_Int64 iActiveTime = pTimer->iActiveTime;
+            if ( iActiveTime < g_iTimerWheelTime )
+                iActiveTime = g_iTimerWheelTime;
+
+            W_Int64 iDelta = iActiveTime - g_iTimerWheelTime;
+
+            // Timers past the last level's turn wait in its farthest slot and are put back in
+            // when it comes around
+
+            if ( iDelta >> ( TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_BITS ) )
+            {
+                iDelta = ( ( W_Int64 ) 1 << ( TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_BITS ) ) - 1;
+                iActiveTime = g_iTimerWheelTime + iDelta;
+            }
+
+            int iLevel = 0;
+            while ( iLevel < TIMER_WHEEL_LEVEL_COUNT - 1 && ( iDelta >> ( ( iLevel + 1 ) * TIMER_WHEEL_SLOT_BITS ) ) )
+                ++ iLevel;
+
+            int iSlot = iLevel * TIMER_WHEEL_SLOT_COUNT +
+                        ( int ) ( ( iActiveTime >> ( iLevel * TIMER_WHEEL_SLOT_BITS ) ) & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+
+            pTimer->iSlot = iSlot;
+            pTimer->iPrev = -1;
+            pTimer->iNext = g_TimerWheel [ iSlot ];
+
+            if ( pTimer->iNext != -1 )
+                g_Timers [ pTimer->iNext ].iPrev = iTimerIndex;
+
+            g_TimerWheel [ iSlot ] = iTimerIndex;
+        }
+
+        /**************************************************************************************
+        *
+        *   RemoveTimerFromWheel ()
+        *
+        *   Takes a timer out of its wheel slot.
+        */
+
+        void RemoveTimerFromWheel ( int iTimerIndex )
+        {
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+
+            if ( pTimer->iPrev != -1 )
+                g_Timers [ pTimer->iPrev ].iNext = pTimer->iNext;
+            else
+                g_TimerWheel [ pTimer->iSlot ] = pTimer->iNext;
+
+            if ( pTimer->iNext != -1 )
+                g_Timers [ pTimer->iNext ].iPrev = pTimer->iPrev;
+        }
+
+        /**************************************************************************************
+        *
+        *   HandleTimerWheelSlot ()
+        *
+        *   Empties a wheel slot. Timers in a higher level are put back in, which moves them
+        *   down a level; timers in the first level are due, so they go off and are put back in
+        *   for their next activation.
+        */
+
+        void HandleTimerWheelSlot ( int iSlot, W_Int64 iCurrTime )
+        {
+            int iCurrTimerIndex = g_TimerWheel [ iSlot ];
+            g_TimerWheel [ iSlot ] = -1;
+
+            while ( iCurrTimerIndex != -1 )
+            {
+                Timer * pTimer = & g_Timers [ iCurrTimerIndex ];
+                int iNextTimerIndex = pTimer->iNext;
+
+                if ( iSlot < TIMER_WHEEL_SLOT_COUNT )
+                {
+                    pTimer->iActiveFrame = g_iTimerFrame;
+                    pTimer->iActiveTime = iCurrTime + pTimer->iLength;
+
+                    // A timer can't go off twice in the same millisecond
+
+                    if ( pTimer->iActiveTime <= g_iTimerWheelTime )
+                        pTimer->iActiveTime = g_iTimerWheelTime + 1;
+                }
+
+                AddTimerToWheel ( iCurrTimerIndex );
+                iCurrTimerIndex = iNextTimerIndex;
+            }
+        }
+
+    // ---- Frame Pacing ----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   SleepUntil ()
+        *
+        *   Waits until the microsecond tick count reaches the specified time. The thread
+        *   sleeps for as much of the wait as it safely can and only spins for the last
+        *   FRAME_PACER_SPIN_TIME microseconds, so waiting doesn't tie up a core.
+        */
+
+        void SleepUntil ( W_Int64 iTime )
+        {
+            W_Int64 iRemaining;
+
+            while ( ( iRemaining = iTime - W_GetMicroTickCount () ) > FRAME_PACER_SPIN_TIME )
+            {
+            #if ! defined ( _WIN32 )
+                W_Int64 iSleepTime = iRemaining - FRAME_PACER_SPIN_TIME;
+
+                timespec SleepTime;
+                SleepTime.tv_sec = ( time_t ) ( iSleepTime / 1000000 );
+                SleepTime.tv_nsec = ( long ) ( iSleepTime % 1000000 ) * 1000;
+
+                nanosleep ( & SleepTime, NULL );
+            #else
+                Sleep ( ( DWORD ) ( iRemaining / 1000 ) - 1 );
+            #endif
+            }
+
+            while ( W_GetMicroTickCount () < iTime );
+        }
+
+        /**************************************************************************************
+        *
+        *   CompareFrameTimes ()
+        *
+        *   qsort () comparison function for sorting frame times.
+        */
+
+        int CompareFrameTimes ( const void * pA, const void * pB )
+        {
+            return * ( int * ) pA - * ( int * ) pB;
+        }
+
+    // ---- CPU -------------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   GetCPUCount ()
+        *
+        *   Returns the number of CPUs the OS can run threads on.
+        */
+
+        int GetCPUCount ()
+        {
+        #if defined ( _WIN32 )
+            SYSTEM_INFO SystemInfo;
+            GetSystemInfo ( & SystemInfo );
+
+            return SystemInfo.dwNumberOfProcessors;
+        #else
+            long iCPUCount = sysconf ( _SC_NPROCESSORS_ONLN );
+
+            return iCPUCount > 0 ? ( int ) iCPUCount : 1;
+        #endif
+        }
+
+        /**************************************************************************************
+        *
+        *   IsKernelSupportedByCPU ()
+        *
+        *   Returns TRUE if the CPU (and the compiler) can run the specified kernel.
+        */
+
+        int IsKernelSupportedByCPU ( int iKernel )
+        {
+            switch ( iKernel )
+            {
+                case W_BLIT_KERNEL_SCALAR:
+                    return TRUE;
+
+                case W_BLIT_KERNEL_SSE2:
+                {
+                #if ! defined ( BLIT_SSE2 )
+                    return FALSE;
+                #elif defined ( _M_X64 ) || defined ( __x86_64__ )
+                    return TRUE;
+                #elif defined ( __GNUC__ )
+                    return __builtin_cpu_supports ( "sse2" );
+                #else
+                    int piCPUInfo [ 4 ];
+                    __cpuid ( piCPUInfo, 1 );
+                    return ( piCPUInfo [ 3 ] >> 26 ) & 1;
+                #endif
+                }
+
+                case W_BLIT_KERNEL_AVX2:
+                {
+                #if ! defined ( BLIT_AVX2 )
+                    return FALSE;
+                #elif defined ( __GNUC__ )
+                    return __builtin_cpu_supports ( "avx2" );
+                #else
+                    // AVX2 needs the CPU to support it, and the OS to save the YMM registers
+
+                    int piCPUInfo [ 4 ];
+                    __cpuid ( piCPUInfo, 1 );
+                    if ( ! ( ( piCPUInfo [ 2 ] >> 27 ) & 1 ) )
+                        return FALSE;
+                    if ( ( _xgetbv ( 0 ) & 6 ) != 6 )
+                        return FALSE;
+
+                    __cpuidex ( piCPUInfo, 7, 0 );
+                    return ( piCPUInfo [ 1 ] >> 5 ) & 1;
+                #endif
+                }
+            }
+
+            return FALSE;
+        }
+
+// ---- Public Interface ----------------------------------------------------------------------
+
+	// ---- Misc ------------------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_ExitOnError ()
+		*
+		*	Terminates the program and prints an error message.
+		*/
+
+		void W_ExitOnError ( char * pstrErrorMssg )
+		{
+            fprintf ( stderr, "Fatal Error: %s\n", pstrErrorMssg );
+			W_Exit ();
+		}
+
+		/*************************************************************************************
+		*
+		*	W_Exit ()
+		*
+		*	Terminates the program.
+		*/
+
+		void W_Exit ()
+		{
+			g_bAppExit = TRUE;
+		}
+
+	// ---- Initialization --------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_InitWrappuh ()
+		*
+		*	Initializes Wrappuh. There's no window to create, so the app name and instance
+        *   are ignored.
+		*/
+
+		bool W_InitWrappuh ( char * pstrAppName, HINSTANCE hInstance, int iCmdShow )
+		{
+            g_pErrorFile = fopen ( "log.txt", "w" );
+
+            sfprintf ( "Wrappuh Logfile\n\n" );
+
+            sfprintf ( "---- Initializing ----------------------------------------------------------------\n\n" );
+
+            // ---- Video
+
+            sfprintf ( " - Initializing the software framebuffer...\n" );
+
+            g_pFrameBuffer = NULL;
+            memset ( & g_VideoContext, 0, sizeof ( g_VideoContext ) );
+
+            // Use the widest kernel the CPU can run
+
+            g_iCurrBlitKernel = W_BLIT_KERNEL_SCALAR;
+            for ( int iCurrKernel = W_BLIT_KERNEL_COUNT - 1; iCurrKernel >= 0; -- iCurrKernel )
+            {
+                if ( IsKernelSupportedByCPU ( iCurrKernel ) )
+                {
+                    g_iCurrBlitKernel = iCurrKernel;
+                    break;
+                }
+            }
+
+            if ( g_pErrorFile )
+                fprintf ( g_pErrorFile, "    - Using the %s blit kernels...\n", g_BlitKernels [ g_iCurrBlitKernel ].pstrName );
+
+            // ---- Input
+
+            sfprintf ( " - Initializing input...\n" );
+
+            memset ( g_KbrdInputState, 0, sizeof ( g_KbrdInputState ) );
+            memset ( g_KbrdState, 0, sizeof ( g_KbrdState ) );
+            memset ( g_KbrdDelay, 0, sizeof ( g_KbrdDelay ) );
+            memset ( g_KbrdFrameState, 0, sizeof ( g_KbrdFrameState ) );
+
+            // ---- Timers
+
+            sfprintf ( " - Initializing timers...\n" );
+
+            g_iStartTime = GetMicroTime ();
+
+            InitTimers ();
+
+            W_SetFrameRate ( 0 );
+            W_ResetFrameStats ();
+
+            // ---- Audio
+
+            sfprintf ( " - Initializing the software mixer...\n" );
+
+            for ( int iCurrSample = 0; iCurrSample < MAX_SOUNDS; ++ iCurrSample )
+                g_SoundSamples [ iCurrSample ].pfSamples = NULL;
+
+            g_iVoiceCount = 0;
+            g_iNextVoiceSerial = 0;
+
+            g_bIsSoundOutputEnabled = FALSE;
+            g_iRingReadPos = 0;
+            g_iRingWritePos = 0;
+
+            g_iMixerFrame = W_GetHighPerformanceTickCount () * W_MIXER_RATE / 1000;
+
+            g_iCurrMixKernel = g_iCurrBlitKernel;
+
+            if ( g_pErrorFile )
+                fprintf ( g_pErrorFile, "    - Using the %s mix kernels...\n", g_BlitKernels [ g_iCurrMixKernel ].pstrName );
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_ShutDownWrappuh ()
+		*
+		*	Shuts down Wrappuh.
+		*/
+
+		void W_ShutDownWrappuh ()
+		{
+            sfprintf ( "\n---- Shutting Down ---------------------------------------------------------------\n\n" );
+
+            sfprintf ( " - Shutting down the software mixer...\n" );
+
+            W_StopSoundRecording ();
+
+            g_iVoiceCount = 0;
+
+            for ( int iCurrSample = 0; iCurrSample < MAX_SOUNDS; ++ iCurrSample )
+            {
+                free ( g_SoundSamples [ iCurrSample ].pfSamples );
+                g_SoundSamples [ iCurrSample ].pfSamples = NULL;
+            }
+
+            W_CloseImagePack ();
+
+            sfprintf ( " - Freeing the software framebuffer...\n" );
+
+            FreePixels ( g_pFrameBuffer );
+            g_pFrameBuffer = NULL;
+            g_pFrameBuffer15 = NULL;
+            g_pFrameBuffer16 = NULL;
+            g_pFrameBuffer32 = NULL;
+
+            if ( g_pErrorFile )
+            {
+                fclose ( g_pErrorFile );
+                g_pErrorFile = NULL;
+            }
+		}
+
+		/**************************************************************************************
+		*
+		*	W_HandleWin32MssgLoop ()
+		*
+		*	Stands in for the Win32 message loop, returning WM_QUIT once W_Exit () has been
+        *   called. Sound is mixed up to the current time here, as DirectSound would mix it in
+        *   the background.
+		*/
+
+		MSG W_HandleWin32MssgLoop ()
+		{
+            W_UpdateSound ();
+
+			MSG CurrMssg;
+
+            CurrMssg.message = g_bAppExit ? WM_QUIT : 0;
+            CurrMssg.wParam = 0;
+
+			return CurrMssg;
+		}
+
+	// ---- Video -----------------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_SetVideoMode ()
+		*
+		*	Sets the video mode, which here just means allocating the framebuffer.
+		*/
+
+		bool W_SetVideoMode ( int iXRes, int iYRes, int iColorDepth )
+		{
+            if ( iXRes <= 0 || iYRes <= 0 )
+                return FALSE;
+
+            if ( iColorDepth != 15 && iColorDepth != 16 && iColorDepth != 32 )
+                return FALSE;
+
+            FreePixels ( g_pFrameBuffer );
+            W_InvalidateFrame ();
+
+			g_VideoContext.iXRes = iXRes;
+			g_VideoContext.iYRes = iYRes;
+			g_VideoContext.iXMax = iXRes - 1;
+			g_VideoContext.iYMax = iYRes - 1;
+			g_VideoContext.iColorDepth = iColorDepth;
+            g_VideoContext.iPitch = GetAlignedPitch ( iXRes );
+
+            g_iFrameBufferSize = g_VideoContext.iPitch * iYRes;
+            if ( ! ( g_pFrameBuffer = AllocPixels ( g_iFrameBufferSize ) ) )
+                return FALSE;
+
+            g_pFrameBuffer15 = ( Pixel15 * ) g_pFrameBuffer;
+            g_pFrameBuffer16 = ( Pixel16 * ) g_pFrameBuffer;
+            g_pFrameBuffer32 = ( Pixel32 * ) g_pFrameBuffer;
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetScreenXRes ()
+		*
+		*	Returns the screen's horizontal resolution.
+		*/
+
+		int W_GetScreenXRes ()
+		{
+			return g_VideoContext.iXRes;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetScreenYRes ()
+		*
+		*	Returns the screen's vertical resolution.
+		*/
+
+		int W_GetScreenYRes ()
+		{
+			return g_VideoContext.iYRes;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetScreenXMax ()
+		*
+		*	Returns the screen's maximum horizontal pixel.
+		*/
+
+		int W_GetScreenXMax ()
+		{
+			return g_VideoContext.iXMax;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetScreenYMax ()
+		*
+		*	Returns the screen's maximum vertical pixel.
+		*/
+
+		int W_GetScreenYMax ()
+		{
+			return g_VideoContext.iYMax;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_LockFrame ()
+		*
+		*	Locks the framebuffer. The framebuffer is always in memory, so this only fails if
+        *   no video mode has been set.
+		*/
+
+		bool W_LockFrame ()
+		{
+            W_InvalidateFrame ();
+
+            return g_pFrameBuffer != NULL;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_BlitFrame ()
+		*
+		*	Finishes the frame. There's no screen to show it on.
+		*/
+
+		bool W_BlitFrame ()
+		{
+            return g_pFrameBuffer != NULL;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_ClearFrame ()
+		*
+		*	Clears the framebuffer.
+		*/
+
+		bool W_ClearFrame ()
+		{
+            if ( ! g_pFrameBuffer )
+                return FALSE;
+
+            if ( ! g_bIsDrawingEnabled )
+                return TRUE;
+
+            W_InvalidateFrame ();
+
+            BlitKernel * pKernel = & g_BlitKernels [ g_iCurrBlitKernel ];
+
+            if ( g_VideoContext.iColorDepth == 32 )
+                pKernel->Fill32 ( g_pFrameBuffer32, g_VideoContext.iPitch, g_VideoContext.iXRes, g_VideoContext.iYRes, 0 );
+            else
+                pKernel->Fill16 ( g_pFrameBuffer16, g_VideoContext.iPitch, g_VideoContext.iXRes, g_VideoContext.iYRes, 0 );
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_LoadImage ()
+		*
+		*	Loads a BMP file to a Wrappuh image.
+		*/
+
+		bool W_LoadImage ( char * pstrBMPFilename, W_Image * Image )
+		{
+            // Images in the open pack are already converted
+
+            if ( LoadPackImage ( pstrBMPFilename, Image ) )
+                return TRUE;
+
+            Image->pPixels = NULL;
+            Image->iSourceX = 0;
+            Image->iSourceY = 0;
+            Image->bIsAtlasImage = FALSE;
+
+            FILE * pFile;
+            if ( ! ( pFile = fopen ( pstrBMPFilename, "rb" ) ) )
+                return FALSE;
+
+            // Read the file and image headers, which are 14 and 40 bytes respectively
+
+            UCHAR pHeader [ 54 ];
+            if ( fread ( pHeader, 1, sizeof ( pHeader ), pFile ) != sizeof ( pHeader ) ||
+                 ReadBMPWord ( pHeader, 0 ) != 0x4D42 ||
+                 ReadBMPWord ( pHeader, 28 ) != 24 )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            int iOffBits = ReadBMPDWord ( pHeader, 10 );
+            int iWidth = ReadBMPDWord ( pHeader, 18 );
+            int iHeight = ReadBMPDWord ( pHeader, 22 );
+
+            if ( iWidth <= 0 || iHeight <= 0 )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            int iScanlineByteSize = ( iWidth * 3 + 3 ) & ~ 3;
+            int iBMPFileImageByteSize = iScanlineByteSize * iHeight;
+
+            UCHAR * pImageBuffer = NULL;
+            if ( ! ( pImageBuffer = ( UCHAR * ) malloc ( iBMPFileImageByteSize ) ) )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            fseek ( pFile, iOffBits, SEEK_SET );
+            if ( fread ( pImageBuffer, 1, iBMPFileImageByteSize, pFile ) != ( size_t ) iBMPFileImageByteSize )
+            {
+                free ( pImageBuffer );
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            fclose ( pFile );
+
+            Image->iXRes = iWidth;
+            Image->iYRes = iHeight;
+            Image->iXMax = Image->iXRes - 1;
+            Image->iYMax = Image->iYRes - 1;
+            Image->iPitch = GetAlignedPitch ( iWidth );
+
+            if ( ! ( Image->pPixels = AllocPixels ( Image->iPitch * iHeight ) ) )
+            {
+                free ( pImageBuffer );
+                return FALSE;
+            }
+
+            // Convert the pixels to the current color depth. BMPs are stored bottom-up.
+
+            int iX,
+                iY;
+
+            for ( iY = 0; iY < iHeight; ++ iY )
+            {
+                UCHAR * pSourceRow = pImageBuffer + ( iHeight - 1 - iY ) * iScanlineByteSize;
+                UCHAR * pDestRow = GetPixelRow ( Image->pPixels, Image->iPitch, iY );
+
+                for ( iX = 0; iX < iWidth; ++ iX )
+                {
+                    UCHAR iR = pSourceRow [ iX * 3 + 2 ],
+                          iG = pSourceRow [ iX * 3 + 1 ],
+                          iB = pSourceRow [ iX * 3 ];
+
+                    int iIsMask = ( EncodePixel32 ( iR, iG, iB ) == DEF_IMAGE_MASK_COLOR_32 );
+
+                    switch ( g_VideoContext.iColorDepth )
+                    {
+                        case 15:
+                            ( ( Pixel15 * ) pDestRow ) [ iX ] = iIsMask ? ( Pixel15 ) DEF_IMAGE_MASK_COLOR_15 :
+                                                                          ( Pixel15 ) EncodePixel15 ( iR >> 3, iG >> 3, iB >> 3 );
+                            break;
+
+                        case 16:
+                            ( ( Pixel16 * ) pDestRow ) [ iX ] = iIsMask ? ( Pixel16 ) DEF_IMAGE_MASK_COLOR_16 :
+                                                                          ( Pixel16 ) EncodePixel16 ( iR >> 3, iG >> 3, iB >> 3 );
+                            break;
+
+                        case 32:
+                            ( ( Pixel32 * ) pDestRow ) [ iX ] = ( Pixel32 ) EncodePixel32 ( iR, iG, iB );
+                            break;
+                    }
+                }
+            }
+
+            free ( pImageBuffer );
+
+            Image->ClipRect = GetOpaqueRect ( Image, 0, 0, Image->iXRes, Image->iYRes );
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_FreeImage ()
+		*
+		*	Frees an image.
+		*/
+
+		void W_FreeImage ( W_Image * Image )
+		{
+            if ( Image->bIsAtlasImage )
+                return;
+
+            // The last batch could have drawn from these pixels, and new ones may be loaded
+            // in their place
+
+            W_InvalidateFrame ();
+
+            FreePixels ( Image->pPixels );
+            Image->pPixels = NULL;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_BlitImage ()
+		*
+		*	Blits an image.
+		*/
+
+		bool W_BlitImage ( W_Image Image, int iX, int iY )
+		{
+            if ( ! g_pFrameBuffer || ! Image.pPixels )
+                return FALSE;
+
+            W_InvalidateFrame ();
+
+            BlitSubImage ( & Image, Image.iSourceX, Image.iSourceY, Image.iXRes, Image.iYRes, iX, iY );
+
+			return TRUE;
+		}
+
+        /**************************************************************************************
+        *
+        *   W_LoadAtlas ()
+        *
+        *   Loads an atlas from the index written by the atlas packer, along with the BMP it
+        *   names. Each image in the atlas gets its own bounding box, found the same way
+        *   W_LoadImage () finds one.
+        */
+
+        bool W_LoadAtlas ( char * pstrAtlasFilename, W_Atlas * Atlas )
+        {
+            Atlas->Image.pPixels = NULL;
+            Atlas->Image.bIsAtlasImage = FALSE;
+            Atlas->pImages = NULL;
+            Atlas->iImageCount = 0;
+
+            FILE * pFile;
+            if ( ! ( pFile = fopen ( pstrAtlasFilename, "r" ) ) )
+                return FALSE;
+
+            // The BMP's filename is relative to the index, so it goes after the index's
+            // directory
+
+            char pstrBMPFilename [ MAX_ATLAS_FILENAME_SIZE ];
+            char pstrBMPName [ MAX_ATLAS_FILENAME_SIZE ];
+            int iImageCount;
+
+            int iDirLength = 0;
+            for ( int iCurrChar = 0; pstrAtlasFilename [ iCurrChar ]; ++ iCurrChar )
+                if ( pstrAtlasFilename [ iCurrChar ] == '/' || pstrAtlasFilename [ iCurrChar ] == '\\' )
+                    iDirLength = iCurrChar + 1;
+
+            if ( fscanf ( pFile, "%255s %d", pstrBMPName, & iImageCount ) != 2 || iImageCount <= 0 ||
+                 iDirLength + strlen ( pstrBMPName ) >= MAX_ATLAS_FILENAME_SIZE )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            memcpy ( pstrBMPFilename, pstrAtlasFilename, iDirLength );
+            strcpy ( pstrBMPFilename + iDirLength, pstrBMPName );
+
+            if ( ! W_LoadImage ( pstrBMPFilename, & Atlas->Image ) ||
+                 ! ( Atlas->pImages = ( W_AtlasImage * ) malloc ( iImageCount * sizeof ( W_AtlasImage ) ) ) )
+            {
+                fclose ( pFile );
+                W_FreeAtlas ( Atlas );
+                return FALSE;
+            }
+
+            // Read each image's rectangle and point it at that part of the atlas
+
+            for ( Atlas->iImageCount = 0; Atlas->iImageCount < iImageCount; ++ Atlas->iImageCount )
+            {
+                W_AtlasImage * CurrImage = & Atlas->pImages [ Atlas->iImageCount ];
+                W_Image * Image = & CurrImage->Image;
+
+                int iX,
+                    iY;
+                int iXRes,
+                    iYRes;
+
+                if ( fscanf ( pFile, "%127s %d %d %d %d", CurrImage->pstrName, & iX, & iY, & iXRes, & iYRes ) != 5 ||
+                     iX < 0 || iY < 0 || iXRes <= 0 || iYRes <= 0 ||
+                     iX + iXRes > Atlas->Image.iXRes || iY + iYRes > Atlas->Image.iYRes )
+                {
+                    fclose ( pFile );
+                    W_FreeAtlas ( Atlas );
+                    return FALSE;
+                }
+
+                * Image = Atlas->Image;
+                Image->iXRes = iXRes;
+                Image->iYRes = iYRes;
+                Image->iXMax = iXRes - 1;
+                Image->iYMax = iYRes - 1;
+                Image->iSourceX = iX;
+                Image->iSourceY = iY;
+                Image->bIsAtlasImage = TRUE;
+                Image->ClipRect = GetOpaqueRect ( & Atlas->Image, iX, iY, iXRes, iYRes );
+            }
+
+            fclose ( pFile );
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_FreeAtlas ()
+        *
+        *   Frees an atlas. Any images taken from it can't be used afterwards.
+        */
+
+        void W_FreeAtlas ( W_Atlas * Atlas )
+        {
+            W_FreeImage ( & Atlas->Image );
+
+            free ( Atlas->pImages );
+            Atlas->pImages = NULL;
+            Atlas->iImageCount = 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetAtlasImage ()
+        *
+        *   Finds an image in an atlas by name. The image shares the atlas's pixels, so it's
+        *   only valid until the atlas is freed, and freeing the image itself does nothing.
+        */
+
+        bool W_GetAtlasImage ( W_Atlas * Atlas, char * pstrName, W_Image * Image )
+        {
+            for ( int iCurrImage = 0; iCurrImage < Atlas->iImageCount; ++ iCurrImage )
+            {
+                if ( strcmp ( Atlas->pImages [ iCurrImage ].pstrName, pstrName ) == 0 )
+                {
+                    * Image = Atlas->pImages [ iCurrImage ].Image;
+                    return TRUE;
+                }
+            }
+
+            return FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_OpenImagePack ()
+        *
+        *   Opens a pack written by the image cooker and copies every image in it out on worker
+        *   threads, so W_LoadImage () can hand them out as they're loaded. The pack has to
+        *   have been cooked for the current color depth. Any pack that's already open is
+        *   closed first.
+        */
+
+        bool W_OpenImagePack ( char * pstrPackFilename )
+        {
+            W_CloseImagePack ();
+
+            if ( ! g_pFrameBuffer || ! MapImagePack ( pstrPackFilename ) )
+                return FALSE;
+
+            // Check the header against the video mode
+
+            UCHAR * pPack = g_pImagePack;
+            int iImageCount = 0;
+
+            if ( g_iImagePackSize >= PACK_HEADER_SIZE && g_iImagePackSize <= INT_MAX )
+                iImageCount = ReadBMPDWord ( pPack, 12 );
+
+            if ( iImageCount <= 0 ||
+                 memcmp ( pPack, PACK_ID_STRING, 4 ) != 0 ||
+                 ReadBMPDWord ( pPack, 4 ) != PACK_VERSION ||
+                 ReadBMPDWord ( pPack, 8 ) != g_VideoContext.iColorDepth ||
+                 PACK_HEADER_SIZE + ( W_Int64 ) iImageCount * PACK_ENTRY_SIZE > ( W_Int64 ) g_iImagePackSize ||
+                 ! ( g_pPackImages = ( PackImage * ) calloc ( iImageCount, sizeof ( PackImage ) ) ) )
+            {
+                W_CloseImagePack ();
+                return FALSE;
+            }
+
+            g_iImagePackColorDepth = g_VideoContext.iColorDepth;
+
+            // Read the directory and allocate each image, making sure its pixels are all
+            // inside the pack
+
+            int iPixelSize = GetPixelSize ( g_VideoContext.iColorDepth );
+            int iPackPixelSize = 0;
+
+            for ( g_iPackImageCount = 0; g_iPackImageCount < iImageCount; ++ g_iPackImageCount )
+            {
+                UCHAR * pEntry = pPack + PACK_HEADER_SIZE + g_iPackImageCount * PACK_ENTRY_SIZE;
+                PackImage * pImage = & g_pPackImages [ g_iPackImageCount ];
+                W_Image * Image = & pImage->Image;
+
+                int iXRes = ReadBMPDWord ( pEntry, 128 ),
+                    iYRes = ReadBMPDWord ( pEntry, 132 ),
+                    iPitch = ReadBMPDWord ( pEntry, 136 ),
+                    iOffset = ReadBMPDWord ( pEntry, 156 );
+
+                if ( ! memchr ( pEntry, 0, PACK_NAME_SIZE ) ||
+                     iXRes <= 0 || iYRes <= 0 || iPitch < iXRes * iPixelSize || iOffset < 0 ||
+                     iOffset + ( W_Int64 ) iPitch * ( iYRes - 1 ) + iXRes * iPixelSize > ( W_Int64 ) g_iImagePackSize )
+                {
+                    W_CloseImagePack ();
+                    return FALSE;
+                }
+
+                pImage->pstrName = ( char * ) pEntry;
+                pImage->pCookedPixels = pPack + iOffset;
+                pImage->iCookedPitch = iPitch;
+                pImage->iRowSize = iXRes * iPixelSize;
+                pImage->iFirstByte = iPackPixelSize;
+
+                Image->iXRes = iXRes;
+                Image->iYRes = iYRes;
+                Image->iXMax = iXRes - 1;
+                Image->iYMax = iYRes - 1;
+                Image->iPitch = GetAlignedPitch ( iXRes );
+                Image->iSourceX = 0;
+                Image->iSourceY = 0;
+                Image->bIsAtlasImage = FALSE;
+
+                Image->ClipRect.iX0 = ReadBMPDWord ( pEntry, 140 );
+                Image->ClipRect.iY0 = ReadBMPDWord ( pEntry, 144 );
+                Image->ClipRect.iX1 = ReadBMPDWord ( pEntry, 148 );
+                Image->ClipRect.iY1 = ReadBMPDWord ( pEntry, 152 );
+
+                if ( ! ( Image->pPixels = AllocPixels ( Image->iPitch * iYRes ) ) )
+                {
+                    W_CloseImagePack ();
+                    return FALSE;
+                }
+
+                iPackPixelSize += pImage->iRowSize * iYRes;
+            }
+
+            // Split the pixels evenly between the workers. The last share is copied on this
+            // thread, as is any share whose thread couldn't be started.
+
+            int iWorkerCount = GetCPUCount ();
+
+            if ( iWorkerCount > MAX_PACK_WORKER_COUNT )
+                iWorkerCount = MAX_PACK_WORKER_COUNT;
+            if ( iWorkerCount > iPackPixelSize / MIN_PACK_WORKER_SIZE )
+                iWorkerCount = iPackPixelSize / MIN_PACK_WORKER_SIZE;
+            if ( iWorkerCount < 1 )
+                iWorkerCount = 1;
+
+            PackWorker Workers [ MAX_PACK_WORKER_COUNT ];
+            bool pbIsWorkerRunning [ MAX_PACK_WORKER_COUNT ];
+
+            int iCurrWorker;
+            for ( iCurrWorker = 0; iCurrWorker < iWorkerCount; ++ iCurrWorker )
+            {
+                Workers [ iCurrWorker ].iFirstByte = ( int ) ( ( W_Int64 ) iPackPixelSize * iCurrWorker / iWorkerCount );
+                Workers [ iCurrWorker ].iLastByte = ( int ) ( ( W_Int64 ) iPackPixelSize * ( iCurrWorker + 1 ) / iWorkerCount );
+
+                pbIsWorkerRunning [ iCurrWorker ] = FALSE;
+                if ( iCurrWorker < iWorkerCount - 1 )
+                    pbIsWorkerRunning [ iCurrWorker ] = StartPackWorker ( & Workers [ iCurrWorker ] );
+
+                if ( ! pbIsWorkerRunning [ iCurrWorker ] )
+                    CopyPackBytes ( Workers [ iCurrWorker ].iFirstByte, Workers [ iCurrWorker ].iLastByte );
+            }
+
+            for ( iCurrWorker = 0; iCurrWorker < iWorkerCount; ++ iCurrWorker )
+                if ( pbIsWorkerRunning [ iCurrWorker ] )
+                    JoinPackWorker ( & Workers [ iCurrWorker ] );
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_CloseImagePack ()
+        *
+        *   Closes the open pack, if there is one, and frees any of its images W_LoadImage ()
+        *   hasn't handed out. Images it has handed out are unaffected.
+        */
+
+        void W_CloseImagePack ()
+        {
+            for ( int iCurrImage = 0; iCurrImage < g_iPackImageCount; ++ iCurrImage )
+                if ( ! g_pPackImages [ iCurrImage ].bIsTaken )
+                    FreePixels ( g_pPackImages [ iCurrImage ].Image.pPixels );
+
+            free ( g_pPackImages );
+            g_pPackImages = NULL;
+            g_iPackImageCount = 0;
+
+            UnmapImagePack ();
+        }
+
+        /**************************************************************************************
+        *
+        *   W_BeginSpriteBatch ()
+        *
+        *   Starts a new sprite batch, throwing away anything left in the last one. The batch
+        *   has no background until one is set.
+        */
+
+        void W_BeginSpriteBatch ()
+        {
+            g_iBatchSpriteCount = 0;
+            g_iBatchSourceCount = 0;
+
+            g_bIsBatchBackgroundSet = FALSE;
+            g_bIsBatchFlushed = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_BatchImage ()
+        *
+        *   Adds an image to the sprite batch, to be drawn when the batch ends. Lower layers are
+        *   drawn first; within a layer, images from the same atlas are drawn together, and
+        *   images from the same atlas are drawn in the order they were added. Images that
+        *   would land entirely off the screen are dropped. If the batch is full, what's in it
+        *   is drawn early.
+        */
+
+        bool W_BatchImage ( W_Image & Image, int iX, int iY, int iLayer )
+        {
+            if ( ! g_pFrameBuffer || ! Image.pPixels )
+                return FALSE;
+
+            if ( ! g_bIsDrawingEnabled )
+                return TRUE;
+
+            if ( iX >= g_VideoContext.iXRes || iY >= g_VideoContext.iYRes ||
+                 iX + Image.iXRes <= 0 || iY + Image.iYRes <= 0 )
+                return TRUE;
+
+            if ( g_iBatchSpriteCount == W_MAX_BATCH_SPRITE_COUNT )
+                DrawSpriteBatch ( FALSE );
+
+            // Find which of the batch's atlases the image is from, checking the most recent
+            // first since sprites tend to come from the same one
+
+            int iSource;
+            for ( iSource = g_iBatchSourceCount - 1; iSource >= 0; -- iSource )
+                if ( g_pBatchSources [ iSource ] == Image.pPixels )
+                    break;
+
+            if ( iSource < 0 )
+            {
+                iSource = g_iBatchSourceCount;
+
+                if ( g_iBatchSourceCount < MAX_BATCH_SOURCE_COUNT )
+                    g_pBatchSources [ g_iBatchSourceCount ++ ] = Image.pPixels;
+            }
+
+            BatchSprite * Sprite = & g_BatchSprites [ g_iBatchSpriteCount ];
+            Sprite->Image = Image;
+            Sprite->iX = iX;
+            Sprite->iY = iY;
+            Sprite->iLayer = iLayer;
+            Sprite->iSource = iSource;
+            Sprite->iIndex = g_iBatchSpriteCount;
+            ++ g_iBatchSpriteCount;
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_EndSpriteBatch ()
+        *
+        *   Sorts the sprite batch and draws it in one pass, over its background if it has
+        *   one.
+        */
+
+        void W_EndSpriteBatch ()
+        {
+            if ( ! g_pFrameBuffer || ! g_bIsDrawingEnabled )
+            {
+                W_BeginSpriteBatch ();
+                g_bIsFrameValid = FALSE;
+                return;
+            }
+
+            DrawSpriteBatch ( TRUE );
+        }
+
+        /**************************************************************************************
+        *
+        *   W_SetBatchBackground ()
+        *
+        *   Sets the image the sprite batch is drawn over. It's drawn at the top-left corner
+        *   of the screen when the batch ends, and should be opaque and cover the whole
+        *   screen; the batch can only be redrawn with dirty rectangles if it has one.
+        */
+
+        void W_SetBatchBackground ( W_Image & Image )
+        {
+            g_BatchBackground = Image;
+            g_bIsBatchBackgroundSet = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_EnableDirtyRects ()
+        *
+        *   Makes sprite batches redraw only the parts of the screen that have changed since
+        *   the last batch. The first batch afterwards is still drawn in full.
+        */
+
+        void W_EnableDirtyRects ()
+        {
+            g_bIsDirtyRectEnabled = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DisableDirtyRects ()
+        *
+        *   Makes sprite batches redraw the whole screen again.
+        */
+
+        void W_DisableDirtyRects ()
+        {
+            g_bIsDirtyRectEnabled = FALSE;
+            W_InvalidateFrame ();
+        }
+
+        /**************************************************************************************
+        *
+        *   W_InvalidateFrame ()
+        *
+        *   Makes the next sprite batch redraw the whole screen. Wrappuh calls this itself
+        *   whenever anything is drawn outside of a batch, so it's only needed after writing
+        *   to the framebuffer some other way.
+        */
+
+        void W_InvalidateFrame ()
+        {
+            g_bIsFrameValid = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetDirtyRectStats ()
+        *
+        *   Fills in how many batches have ended since the statistics were last reset, how many
+        *   of them were redrawn in full, and the share of the screen they redrew, from 0 to
+        *   1. Full redraws count as the whole screen.
+        */
+
+        void W_GetDirtyRectStats ( W_DirtyRectStats * pStats )
+        {
+            pStats->iFrameCount = g_iDirtyStatsFrameCount;
+            pStats->iFullRedrawCount = g_iDirtyStatsFullCount;
+            pStats->fMeanCoverage = 0;
+            pStats->fLastCoverage = g_fLastDirtyCoverage;
+
+            if ( g_iDirtyStatsFrameCount )
+                pStats->fMeanCoverage = ( float ) ( g_dDirtyStatsCoverage / g_iDirtyStatsFrameCount );
+        }
+
+        /**************************************************************************************
+        *
+        *   W_ResetDirtyRectStats ()
+        *
+        *   Resets the dirty rectangle statistics.
+        */
+
+        void W_ResetDirtyRectStats ()
+        {
+            g_iDirtyStatsFrameCount = 0;
+            g_iDirtyStatsFullCount = 0;
+            g_dDirtyStatsCoverage = 0;
+            g_fLastDirtyCoverage = 0;
+        }
+
+		/**************************************************************************************
+		*
+		*	W_DrawPoint ()
+		*
+		*	Draws a point.
+		*/
+
+		void W_DrawPoint ( UCHAR iR, UCHAR iG, UCHAR iB, int iX, int iY )
+		{
+			if ( iX < 0 || iY < 0 || iX > g_VideoContext.iXMax || iY > g_VideoContext.iYMax )
+				return;
+
+            W_InvalidateFrame ();
+
+			switch ( g_VideoContext.iColorDepth )
+			{
+				case 15:
+				{
+					g_pFrameBuffer15 [ iY * ( g_VideoContext.iPitch >> 1 ) + iX ] = ( Pixel15 ) EncodePixel15 ( iR, iG, iB );
+					break;
+				}
+
+				case 16:
+				{
+					g_pFrameBuffer16 [ iY * ( g_VideoContext.iPitch >> 1 ) + iX ] = ( Pixel16 ) EncodePixel16 ( iR, iG, iB );
+					break;
+				}
+
+				case 32:
+				{
+					g_pFrameBuffer32 [ iY * ( g_VideoContext.iPitch >> 2 ) + iX ] = ( Pixel32 ) EncodePixel32 ( iR, iG, iB );
+					break;
+				}
+			}
+		}
+
+		/***************************************************************************************
+		*
+		*	W_LoadFont ()
+		*
+		*	Loads a font.
+		*/
+
+		bool W_LoadFont ( char * pstrFontBMPFilename, int iCellXRes, int iCellYRes )
+		{
+			if ( ! W_LoadImage ( pstrFontBMPFilename, & g_FontImage ) )
+				return FALSE;
+
+			g_FontDesc.iCellXRes = iCellXRes;
+			g_FontDesc.iCellYRes = iCellYRes;
+			g_FontDesc.iCellFullXRes = g_FontDesc.iCellXRes + 1;
+			g_FontDesc.iCellFullYRes = g_FontDesc.iCellYRes + 1;
+			g_FontDesc.iCharRowSize = ( g_FontImage.iXRes - ( g_FontImage.iXRes % ( g_FontDesc.iCellXRes + 1 ) ) ) / ( g_FontDesc.iCellXRes + 1 );
+			g_FontDesc.iCharRowRes = g_FontDesc.iCharRowSize * ( g_FontDesc.iCellXRes + 1 );
+			g_FontDesc.iCharRowMaxX = g_FontImage.iXRes - 1;
+
+			g_FontDesc.iSpaceXRes = ( int ) ( g_FontDesc.iCellXRes * DEF_SPACE_PRCNT );
+
+			int iCharX = 0, iCharY = 0;
+			int iX, iY;
+			int iKern, iCurrKern;
+
+			for ( int iCurrFontCharIndex = 0; iCurrFontCharIndex < DEF_FONT_CHAR_COUNT; ++ iCurrFontCharIndex )
+			{
+				g_FontCharDesc [ iCurrFontCharIndex ].iX = iCharX;
+				g_FontCharDesc [ iCurrFontCharIndex ].iY = iCharY;
+
+				iKern = 15;
+				iCurrKern = 15;
+
+				for ( iY = iCharY; iY < iCharY + g_FontDesc.iCellYRes && iY < g_FontImage.iYRes; ++ iY )
+				{
+					for ( iX = iCharX; iX < iCharX + g_FontDesc.iCellXRes && iX < g_FontImage.iXRes; ++ iX )
+					{
+						if ( IsImagePixelOpaque ( & g_FontImage, iX, iY ) )
+						{
+							iCurrKern = iX - iCharX;
+							break;
+						}
+					}
+
+					if ( iCurrKern < iKern )
+						iKern = iCurrKern;
+				}
+				g_FontCharDesc [ iCurrFontCharIndex ].iLeftKern = iKern;
+
+				iKern = 15;
+				iCurrKern = 15;
+				for ( iY = iCharY; iY < iCharY + g_FontDesc.iCellYRes && iY < g_FontImage.iYRes; ++ iY )
+				{
+					for ( iX = iCharX + g_FontDesc.iCellXRes - 1; iX >= iCharX ; -- iX )
+					{
+						if ( iX < g_FontImage.iXRes && IsImagePixelOpaque ( & g_FontImage, iX, iY ) )
+						{
+							iCurrKern = ( g_FontCharDesc [ iCurrFontCharIndex ].iX + g_FontDesc.iCellXRes - 1 ) - iX;
+							break;
+						}
+					}
+
+					if ( iCurrKern < iKern )
+						iKern = iCurrKern;
+				}
+				g_FontCharDesc [ iCurrFontCharIndex ].iRightKern = iKern;
+
+				iCharX += g_FontDesc.iCellFullXRes;
+				if ( iCharX > g_FontDesc.iCharRowMaxX )
+				{
+					iCharX = 0;
+					iCharY += g_FontDesc.iCellFullYRes;
+				}
+
+				g_FontCharDesc [ iCurrFontCharIndex ].iXRes = g_FontDesc.iCellXRes - ( g_FontCharDesc [ iCurrFontCharIndex ].iLeftKern + g_FontCharDesc [ iCurrFontCharIndex ].iRightKern );
+			}
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_FreeFont ()
+		*
+		*	Frees the font.
+		*/
+
+		void W_FreeFont ()
+		{
+            W_FreeImage ( & g_FontImage );
+		}
+
+		/**************************************************************************************
+		*
+		*	W_DrawTextString ()
+		*
+		*	Draws a string of text. Each character is a clipped blit from its cell in the font
+        *   image.
+		*/
+
+		bool W_DrawTextString ( char * pstrTextString, int iX, int iY )
+		{
+            if ( ! g_pFrameBuffer || ! g_FontImage.pPixels )
+                return FALSE;
+
+            W_InvalidateFrame ();
+
+			int iCurrChar;
+
+			for ( unsigned int iCharIndex = 0; iCharIndex < strlen ( pstrTextString ); ++ iCharIndex )
+			{
+				iCurrChar = pstrTextString [ iCharIndex ] - 32;
+
+                if ( iCurrChar < 0 || iCurrChar >= DEF_FONT_CHAR_COUNT )
+                    continue;
+
+				if ( iCurrChar == 0 )
+					iX += g_FontDesc.iSpaceXRes;
+				else
+				{
+					iX -= g_FontCharDesc [ iCurrChar ].iLeftKern;
+
+                    // The DirectDraw backend's rectangles leave out the last row and column
+                    // of each cell, so these do too
+
+                    BlitSubImage ( & g_FontImage,
+                                   g_FontCharDesc [ iCurrChar ].iX, g_FontCharDesc [ iCurrChar ].iY,
+                                   g_FontDesc.iCellXRes - 1, g_FontDesc.iCellYRes - 1,
+                                   iX, iY );
+
+					iX += g_FontCharDesc [ iCurrChar ].iLeftKern + g_FontCharDesc [ iCurrChar ].iXRes + DEF_KERN;
+				}
+			}
+
+			return TRUE;
+		}
+
+		/***************************************************************************************
+		*
+		*	W_GetStringPixelLength ()
+		*
+		*	Returns the length of a string in pixels.
+		*/
+
+		int W_GetStringPixelLength ( char * pstrTextString )
+		{
+			int iCurrChar;
+			int iStringPixelLength = 0;
+
+			for ( unsigned int iCharIndex = 0; iCharIndex < strlen ( pstrTextString ); ++ iCharIndex )
+			{
+				iCurrChar = pstrTextString [ iCharIndex ] - 32;
+
+                if ( iCurrChar < 0 || iCurrChar >= DEF_FONT_CHAR_COUNT )
+                    continue;
+
+				if ( iCurrChar == 0 )
+					iStringPixelLength += g_FontDesc.iSpaceXRes;
+				else
+				{
+					iStringPixelLength += g_FontCharDesc [ iCurrChar ].iXRes;
+					if ( iCharIndex < strlen ( pstrTextString ) - 1 )
+						iStringPixelLength += DEF_KERN;
+				}
+			}
+
+			return iStringPixelLength;
+		}
+
+        /**************************************************************************************
+        *
+        *   W_OffsetRect ()
+        *
+        *   Offsets a rectangle into another coordiante space.
+        */
+
+        W_Rect W_OffsetRect ( W_Rect Rect, int iX, int iY )
+        {
+            Rect.iX0 += iX;
+            Rect.iY0 += iY;
+            Rect.iX1 += iX;
+            Rect.iY1 += iY;
+
+            return Rect;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DoRectsIntersect ()
+        *
+        *   Determines whether or not two rectangles intersect.
+        */
+
+        bool W_DoRectsIntersect ( W_Rect * Rect0, W_Rect * Rect1 )
+        {
+            int iCenterX0,
+                iCenterY0;
+            int iCenterX1,
+                iCenterY1;
+
+            int iWidth0,
+                iHeight0;
+            int iWidth1,
+                iHeight1;
+
+            iWidth0 = ( Rect0->iX1 - Rect0->iX0 ) >> 1;
+            iHeight0 = ( Rect0->iY1 - Rect0->iY0 ) >> 1;
+            iWidth1 = ( Rect1->iX1 - Rect1->iX0 ) >> 1;
+            iHeight1 = ( Rect1->iY1 - Rect1->iY0 ) >> 1;
+
+            iCenterX0 = ( iWidth0 >> 1 ) + Rect0->iX0;
+            iCenterY0 = ( iHeight0 >> 1 ) + Rect0->iY0;
+            iCenterX1 = ( iWidth1 >> 1 ) + Rect1->iX0;
+            iCenterY1 = ( iHeight1 >> 1 ) + Rect1->iY0;
+
+            int iDeltaX,
+                iDeltaY;
+
+            iDeltaX = abs ( iCenterX1 - iCenterX0 );
+            iDeltaY = abs ( iCenterY1 - iCenterY0 );
+
+            if ( ( iDeltaX < ( iWidth0 + iWidth1 ) ) &&
+                 ( iDeltaY < ( iHeight0 + iHeight1 ) ) )
+            {
+                return TRUE;
+            }
+
+            return FALSE;
+        }
+
+	// ---- Input -----------------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_GetKbrdState ()
+		*
+		*	Gets the keyboard state, as last set with W_SetKeyState ().
+		*/
+
+		void W_GetKbrdState ()
+		{
+            memcpy ( g_KbrdState, g_KbrdInputState, sizeof ( g_KbrdState ) );
+
+			unsigned int iCurrTickCount = W_GetTickCount ();
+
+			for ( int iCurrKeyIndex = 0; iCurrKeyIndex < 256; ++ iCurrKeyIndex )
+			{
+				g_KbrdFrameState [ iCurrKeyIndex ] = FALSE;
+				if ( g_KbrdState [ iCurrKeyIndex ] )
+				{
+					if ( g_KbrdDelay [ iCurrKeyIndex ] == 0 || ! g_iKeyDelayActive )
+					{
+						g_KbrdFrameState [ iCurrKeyIndex ] = TRUE;
+						g_KbrdDelay [ iCurrKeyIndex ] = iCurrTickCount + KEY_DELAY;
+					}
+					else
+						if ( iCurrTickCount >= g_KbrdDelay [ iCurrKeyIndex ] )
+							g_KbrdDelay [ iCurrKeyIndex ] = 0;
+				}
+			}
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetKeyState ()
+		*
+		*	Returns the state of a given key.
+		*/
+
+		int W_GetKeyState ( int iScanCode )
+		{
+			if ( g_KbrdState [ iScanCode ] && g_KbrdFrameState [ iScanCode ] )
+				return TRUE;
+
+			return FALSE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetAnyKeyState ()
+		*
+		*	Returns whether or not any key has been pressed.
+		*/
+
+		int W_GetAnyKeyState ()
+		{
+			for ( int iCurrKeyIndex = 0; iCurrKeyIndex < 256; ++ iCurrKeyIndex )
+				if ( g_KbrdState [ iCurrKeyIndex ] && g_KbrdFrameState [ iCurrKeyIndex ] )
+					return TRUE;
+
+			return FALSE;
+		}
+
+        /**************************************************************************************
+        *
+        *   W_EnableKeyDelay ()
+        *
+        *   Enables the key delay.
+        */
+
+        void W_EnableKeyDelay ()
+        {
+            g_iKeyDelayActive = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DisableKeyDelay ()
+        *
+        *   Disables the key delay.
+        */
+
+        void W_DisableKeyDelay ()
+        {
+            g_iKeyDelayActive = FALSE;
+        }
+
+	// ---- Audio -----------------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_LoadSound ()
+		*
+		*	Loads a WAV file to a Wrappuh sound. The file is decoded into a single sample that
+        *   every voice playing the sound reads from, so unlike the DirectSound backend nothing
+        *   is replicated and only the first channel is used. Looping isn't supported by either
+        *   backend.
+		*/
+
+		bool W_LoadSound ( char * pstrWAVFilename, W_Sound * Sound, bool bLoop )
+		{
+            for ( int iCurrChannel = 0; iCurrChannel < SOUND_CHANNEL_COUNT; ++ iCurrChannel )
+                Sound->iChannels [ iCurrChannel ] = -1;
+
+            Sound->iChannelIndex = 0;
+
+            // Find a free sample
+
+            int iSample;
+            for ( iSample = 0; iSample < MAX_SOUNDS; ++ iSample )
+                if ( ! g_SoundSamples [ iSample ].pfSamples )
+                    break;
+
+            if ( iSample == MAX_SOUNDS )
+                return FALSE;
+
+            if ( ! LoadWAV ( pstrWAVFilename, & g_SoundSamples [ iSample ] ) )
+                return FALSE;
+
+            Sound->iChannels [ 0 ] = iSample;
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_FreeSound ()
+		*
+		*	Frees a sound, stopping any voices that are playing it.
+		*/
+
+		void W_FreeSound ( W_Sound * Sound )
+		{
+            if ( ! W_StopSound ( * Sound ) )
+                return;
+
+            free ( g_SoundSamples [ Sound->iChannels [ 0 ] ].pfSamples );
+            g_SoundSamples [ Sound->iChannels [ 0 ] ].pfSamples = NULL;
+
+            Sound->iChannels [ 0 ] = -1;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_PlaySound ()
+		*
+		*	Plays a sound.
+		*/
+
+		bool W_PlaySound ( W_Sound & Sound )
+		{
+            return W_PlaySoundEx ( Sound, 100, 0 );
+		}
+
+		/**************************************************************************************
+		*
+		*	W_PlaySoundEx ()
+		*
+		*	Plays a sound at the specified volume (0-100) and pan (-100 for the left speaker
+		*	only, 100 for the right), on a voice of its own. The gains match the DirectSound
+		*	backend's: each step of volume below 100 is 0.3 dB quieter, and each step of pan
+		*	takes 1 dB off the other speaker.
+		*/
+
+		bool W_PlaySoundEx ( W_Sound & Sound, int iVolume, int iPan )
+		{
+            int iSample = Sound.iChannels [ 0 ];
+            if ( iSample < 0 || iSample >= MAX_SOUNDS || ! g_SoundSamples [ iSample ].pfSamples )
+                return FALSE;
+
+            if ( iVolume < 0 )
+                iVolume = 0;
+            if ( iVolume > 100 )
+                iVolume = 100;
+            if ( iPan < -100 )
+                iPan = -100;
+            if ( iPan > 100 )
+                iPan = 100;
+
+            float fLeftGain = ( float ) pow ( 10.0, -0.3 * ( 100 - iVolume ) / 20.0 ),
+                  fRightGain = fLeftGain;
+
+            if ( iPan > 0 )
+                fLeftGain *= ( float ) pow ( 10.0, -iPan / 20.0 );
+            else if ( iPan < 0 )
+                fRightGain *= ( float ) pow ( 10.0, iPan / 20.0 );
+
+            // Bring the mixer up to date first, so the sound starts now rather than at the
+            // last update
+
+            W_UpdateSound ();
+
+            StartVoice ( iSample, fLeftGain, fRightGain );
+
+			return TRUE;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_StopSound ()
+		*
+		*	Stops every voice playing a sound.
+		*/
+
+		bool W_StopSound ( W_Sound Sound )
+		{
+            int iSample = Sound.iChannels [ 0 ];
+            if ( iSample < 0 || iSample >= MAX_SOUNDS || ! g_SoundSamples [ iSample ].pfSamples )
+                return FALSE;
+
+            W_UpdateSound ();
+
+            int iCurrVoice = 0;
+
+            while ( iCurrVoice < g_iVoiceCount )
+            {
+                if ( g_Voices [ iCurrVoice ].iSample == iSample )
+                    StopVoice ( iCurrVoice );
+                else
+                    ++ iCurrVoice;
+            }
+
+			return TRUE;
+		}
+
+        /**************************************************************************************
+        *
+        *   W_StopAllSounds ()
+        *
+        *   Stops all currently playing sounds.
+        */
+
+        void W_StopAllSounds ()
+        {
+            W_UpdateSound ();
+
+            g_iVoiceCount = 0;
+        }
+
+	// ---- Timer -----------------------------------------------------------------------------
+
+		/**************************************************************************************
+		*
+		*	W_GetTickCount ()
+		*
+		*	Returns the number of milliseconds since Wrappuh was initialized, or the virtual
+		*	clock's time if it's in use.
+		*/
+
+		DWORD W_GetTickCount ()
+		{
+            if ( g_bIsVirtualClockEnabled )
+                return g_iVirtualTime;
+
+            return ( DWORD ) ( ( GetMicroTime () - g_iStartTime ) / 1000 );
+		}
+
+		/**************************************************************************************
+		*
+		*	W_InitTimer ()
+		*
+		*	Initializes a timer.
+		*/
+
+		W_TimerHandle W_InitTimer ( int iLength )
+		{
+            if ( g_iFreeTimer == -1 )
+                return -1;
+
+            int iTimerIndex = g_iFreeTimer;
+            Timer * pTimer = & g_Timers [ iTimerIndex ];
+            g_iFreeTimer = pTimer->iNext;
+
+            pTimer->bIsNull = FALSE;
+            pTimer->iLength = iLength;
+            pTimer->iActiveTime = W_GetHighPerformanceTickCount () + iLength;
+            pTimer->iActiveFrame = -1;
+
+            AddTimerToWheel ( iTimerIndex );
+            ++ g_iTimerCount;
+
+            return iTimerIndex;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_ClearTimer ()
+		*
+		*	Clears a timer.
+		*/
+
+		void W_ClearTimer ( W_TimerHandle hTimer )
+		{
+			if ( hTimer < 0 || hTimer >= MAX_TIMER_COUNT || g_Timers [ hTimer ].bIsNull )
+                return;
+
+            RemoveTimerFromWheel ( hTimer );
+
+            g_Timers [ hTimer ].bIsNull = TRUE;
+            g_Timers [ hTimer ].iNext = g_iFreeTimer;
+            g_iFreeTimer = hTimer;
+
+            -- g_iTimerCount;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_HandleTimers ()
+		*
+		*	Called once per frame to keep timers running. Steps the timer wheel through every
+		*	millisecond since the last call, so the work done depends on the time that's passed
+		*	and the timers that go off, not on how many timers there are.
+		*/
+
+		void W_HandleTimers ()
+		{
+            W_Int64 iCurrTime = W_GetHighPerformanceTickCount ();
+
+            ++ g_iTimerFrame;
+
+            // With no timers running there's nothing to step through
+
+            if ( ! g_iTimerCount )
+            {
+                if ( g_iTimerWheelTime <= iCurrTime )
+                    g_iTimerWheelTime = iCurrTime + 1;
+
+                return;
+            }
+
+            while ( g_iTimerWheelTime <= iCurrTime )
+            {
+                int iIndex = ( int ) ( g_iTimerWheelTime & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+
+                // Each time a level finishes a turn, move the next slot of the level above it
+                // down
+
+                if ( ! iIndex )
+                {
+                    for ( int iCurrLevel = 1; iCurrLevel < TIMER_WHEEL_LEVEL_COUNT; ++ iCurrLevel )
+                    {
+                        int iLevelIndex = ( int ) ( ( g_iTimerWheelTime >> ( iCurrLevel * TIMER_WHEEL_SLOT_BITS ) ) & ( TIMER_WHEEL_SLOT_COUNT - 1 ) );
+                        HandleTimerWheelSlot ( iCurrLevel * TIMER_WHEEL_SLOT_COUNT + iLevelIndex, iCurrTime );
+
+                        if ( iLevelIndex )
+                            break;
+                    }
+                }
+
+                HandleTimerWheelSlot ( iIndex, iCurrTime );
+                ++ g_iTimerWheelTime;
+            }
+		}
+
+		/**************************************************************************************
+		*
+		*	W_GetTimerState ()
+		*
+		*	Returns the state of the timer
+		*/
+
+		bool W_GetTimerState ( W_TimerHandle hTimer )
+		{
+			return g_Timers [ hTimer ].iActiveFrame == g_iTimerFrame;
+		}
+
+		/**************************************************************************************
+		*
+		*	W_Delay ()
+		*
+		*	Suspends execution of the program for the specified duration. The virtual clock
+		*	is just moved forward.
+		*/
+
+		void W_Delay ( unsigned int iLength )
+		{
+            if ( g_bIsVirtualClockEnabled )
+            {
+                W_AdvanceVirtualClock ( iLength );
+                return;
+            }
+
+            SleepUntil ( W_GetMicroTickCount () + ( W_Int64 ) iLength * 1000 );
+		}
+
+        /**************************************************************************************
+        *
+        *   W_GetHighPerformanceTickCount ()
+        *
+        *   Returns the tick count from the high-performance timer, in milliseconds, or the
+        *   virtual clock's time if it's in use.
+        */
+
+        W_Int64 W_GetHighPerformanceTickCount ()
+        {
+            if ( g_bIsVirtualClockEnabled )
+                return g_iVirtualTime;
+
+            return ( GetMicroTime () - g_iStartTime ) / 1000;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetMicroTickCount ()
+        *
+        *   Returns the tick count from the high-performance timer, in microseconds. This
+        *   always reads the real clock, so it can still be used to time things while the
+        *   virtual clock is in use.
+        */
+
+        W_Int64 W_GetMicroTickCount ()
+        {
+            return GetMicroTime ();
+        }
+
+	// ---- Frame Pacing ----------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   W_SetFrameRate ()
+        *
+        *   Sets the frame rate W_WaitForNextFrame () paces to. Zero turns pacing off, leaving
+        *   W_WaitForNextFrame () to just measure frame times.
+        */
+
+        void W_SetFrameRate ( int iFramesPerSec )
+        {
+            g_iFrameDur = iFramesPerSec > 0 ? 1000000 / iFramesPerSec : 0;
+            g_iLastFrameTime = -1;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_WaitForNextFrame ()
+        *
+        *   Called once per frame to hold the frame rate down. Sleeps until the next frame is
+        *   due, and records how long the frame took for W_GetFrameStats (). Deadlines follow
+        *   on from each other, so a frame that runs a little long is made up by the next one;
+        *   a frame that runs more than a whole frame over starts the schedule again instead of
+        *   rushing to catch up. The virtual clock is never waited on.
+        */
+
+        void W_WaitForNextFrame ()
+        {
+            W_Int64 iCurrTime = W_GetMicroTickCount ();
+
+            if ( g_iLastFrameTime == -1 )
+            {
+                g_iLastFrameTime = iCurrTime;
+                g_iNextFrameTime = iCurrTime;
+            }
+
+            if ( g_iFrameDur && ! g_bIsVirtualClockEnabled )
+            {
+                g_iNextFrameTime += g_iFrameDur;
+
+                if ( iCurrTime - g_iNextFrameTime > g_iFrameDur )
+                    g_iNextFrameTime = iCurrTime;
+                else if ( g_iNextFrameTime > iCurrTime )
+                    SleepUntil ( g_iNextFrameTime );
+
+                iCurrTime = W_GetMicroTickCount ();
+            }
+
+            // Record the frame time
+
+            g_piFrameTimes [ g_iFrameTimeCount % FRAME_STATS_HISTORY_SIZE ] = ( int ) ( iCurrTime - g_iLastFrameTime );
+            ++ g_iFrameTimeCount;
+
+            g_iLastFrameTime = iCurrTime;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetFrameStats ()
+        *
+        *   Returns the mean, 99th percentile and standard deviation of the most recent frame
+        *   times (up to FRAME_STATS_HISTORY_SIZE of them), in milliseconds.
+        */
+
+        void W_GetFrameStats ( W_FrameStats * pStats )
+        {
+            int iCount = g_iFrameTimeCount < FRAME_STATS_HISTORY_SIZE ? g_iFrameTimeCount : FRAME_STATS_HISTORY_SIZE;
+
+            pStats->iFrameCount = iCount;
+            pStats->fMeanTime = 0;
+            pStats->fP99Time = 0;
+            pStats->fJitter = 0;
+
+            if ( ! iCount )
+                return;
+
+            // Find the mean and standard deviation
+
+            double dSum = 0,
+                   dSquareSum = 0;
+
+            for ( int iCurrFrame = 0; iCurrFrame < iCount; ++ iCurrFrame )
+            {
+                dSum += g_piFrameTimes [ iCurrFrame ];
+                dSquareSum += ( double ) g_piFrameTimes [ iCurrFrame ] * g_piFrameTimes [ iCurrFrame ];
+            }
+
+            double dMean = dSum / iCount;
+            double dVariance = dSquareSum / iCount - dMean * dMean;
+
+            pStats->fMeanTime = ( float ) ( dMean / 1000 );
+            pStats->fJitter = ( float ) ( dVariance > 0 ? sqrt ( dVariance ) / 1000 : 0 );
+
+            // Sort a copy of the frame times to find the 99th percentile
+
+            int piSortedTimes [ FRAME_STATS_HISTORY_SIZE ];
+            memcpy ( piSortedTimes, g_piFrameTimes, iCount * sizeof ( int ) );
+            qsort ( piSortedTimes, iCount, sizeof ( int ), CompareFrameTimes );
+
+            pStats->fP99Time = piSortedTimes [ ( iCount * 99 + 99 ) / 100 - 1 ] / 1000.0f;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_ResetFrameStats ()
+        *
+        *   Forgets the frame times measured so far.
+        */
+
+        void W_ResetFrameStats ()
+        {
+            g_iFrameTimeCount = 0;
+            g_iLastFrameTime = -1;
+        }
+
+    // ---- Misc ------------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   W_GetRandInRange ()
+        *
+        *   Returns a random number within the specified range.
+        */
+
+        int W_GetRandInRange ( int iMin, int iMax )
+        {
+            return ( rand () % ( iMax - iMin + 1 ) ) + iMin;
+        }
+
+    // ---- Headless --------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   W_GetCmdLine ()
+        *
+        *   Joins main ()'s arguments into a WinMain ()-style command line, which leaves out
+        *   the program name.
+        */
+
+        LPSTR W_GetCmdLine ( int argc, char * argv [] )
+        {
+            g_pstrCmdLine [ 0 ] = '\0';
+
+            for ( int iCurrArg = 1; iCurrArg < argc; ++ iCurrArg )
+            {
+                if ( strlen ( g_pstrCmdLine ) + strlen ( argv [ iCurrArg ] ) + 2 > MAX_CMD_LINE_SIZE )
+                    break;
+
+                if ( iCurrArg > 1 )
+                    strcat ( g_pstrCmdLine, " " );
+                strcat ( g_pstrCmdLine, argv [ iCurrArg ] );
+            }
+
+            return g_pstrCmdLine;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_SetKeyState ()
+        *
+        *   Presses or releases a key. The change shows up at the next W_GetKbrdState ().
+        */
+
+        void W_SetKeyState ( int iScanCode, int iIsDown )
+        {
+            if ( iScanCode >= 0 && iScanCode < 256 )
+                g_KbrdInputState [ iScanCode ] = iIsDown ? 0x80 : 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_EnableDrawing ()
+        *
+        *   Lets blits and fills draw into the framebuffer again.
+        */
+
+        void W_EnableDrawing ()
+        {
+            g_bIsDrawingEnabled = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DisableDrawing ()
+        *
+        *   Makes blits and fills return without drawing anything, for running game logic
+        *   when nobody will see the frames.
+        */
+
+        void W_DisableDrawing ()
+        {
+            g_bIsDrawingEnabled = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_EnableVirtualClock ()
+        *
+        *   Switches W_GetTickCount (), W_GetHighPerformanceTickCount () and the timers over to
+        *   the virtual clock, which starts at the current time and only moves forward when
+        *   W_AdvanceVirtualClock () is called.
+        */
+
+        void W_EnableVirtualClock ()
+        {
+            if ( g_bIsVirtualClockEnabled )
+                return;
+
+            g_iVirtualTime = W_GetTickCount ();
+            g_bIsVirtualClockEnabled = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DisableVirtualClock ()
+        *
+        *   Switches back to the real clock.
+        */
+
+        void W_DisableVirtualClock ()
+        {
+            g_bIsVirtualClockEnabled = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_AdvanceVirtualClock ()
+        *
+        *   Moves the virtual clock forward by the specified number of milliseconds.
+        */
+
+        void W_AdvanceVirtualClock ( unsigned int iLength )
+        {
+            g_iVirtualTime += iLength;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetFrameChecksum ()
+        *
+        *   Returns a checksum of the visible part of the framebuffer, so runs can be compared
+        *   without saving every frame.
+        */
+
+        unsigned int W_GetFrameChecksum ()
+        {
+            if ( ! g_pFrameBuffer )
+                return 0;
+
+            unsigned int iChecksum = CHECKSUM_SEED;
+            int iRowSize = g_VideoContext.iXRes * GetPixelSize ( g_VideoContext.iColorDepth );
+
+            for ( int iY = 0; iY < g_VideoContext.iYRes; ++ iY )
+            {
+                UCHAR * pRow = GetPixelRow ( g_pFrameBuffer, g_VideoContext.iPitch, iY );
+
+                for ( int iX = 0; iX < iRowSize; ++ iX )
+                {
+                    iChecksum ^= pRow [ iX ];
+                    iChecksum *= CHECKSUM_PRIME;
+                }
+            }
+
+            return iChecksum;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_SaveFrame ()
+        *
+        *   Saves the framebuffer to a 24-bit BMP file.
+        */
+
+        bool W_SaveFrame ( char * pstrBMPFilename )
+        {
+            if ( ! g_pFrameBuffer )
+                return FALSE;
+
+            FILE * pFile;
+            if ( ! ( pFile = fopen ( pstrBMPFilename, "wb" ) ) )
+                return FALSE;
+
+            int iXRes = g_VideoContext.iXRes,
+                iYRes = g_VideoContext.iYRes;
+            int iScanlineByteSize = ( iXRes * 3 + 3 ) & ~ 3;
+
+            UCHAR pHeader [ 54 ];
+            memset ( pHeader, 0, sizeof ( pHeader ) );
+
+            WriteBMPWord ( pHeader, 0, 0x4D42 );
+            WriteBMPDWord ( pHeader, 2, sizeof ( pHeader ) + iScanlineByteSize * iYRes );
+            WriteBMPDWord ( pHeader, 10, sizeof ( pHeader ) );
+            WriteBMPDWord ( pHeader, 14, 40 );
+            WriteBMPDWord ( pHeader, 18, iXRes );
+            WriteBMPDWord ( pHeader, 22, iYRes );
+            WriteBMPWord ( pHeader, 26, 1 );
+            WriteBMPWord ( pHeader, 28, 24 );
+
+            fwrite ( pHeader, 1, sizeof ( pHeader ), pFile );
+
+            UCHAR * pScanline = ( UCHAR * ) calloc ( iScanlineByteSize, 1 );
+            if ( ! pScanline )
+            {
+                fclose ( pFile );
+                return FALSE;
+            }
+
+            for ( int iY = iYRes - 1; iY >= 0; -- iY )
+            {
+                UCHAR * pRow = GetPixelRow ( g_pFrameBuffer, g_VideoContext.iPitch, iY );
+
+                for ( int iX = 0; iX < iXRes; ++ iX )
+                {
+                    unsigned int iPixel;
+                    UCHAR iR, iG, iB;
+
+                    switch ( g_VideoContext.iColorDepth )
+                    {
+                        case 15:
+                            iPixel = ( ( Pixel15 * ) pRow ) [ iX ];
+                            iR = ( UCHAR ) ( ( ( iPixel >> 10 ) & 31 ) << 3 );
+                            iG = ( UCHAR ) ( ( ( iPixel >> 5 ) & 31 ) << 3 );
+                            iB = ( UCHAR ) ( ( iPixel & 31 ) << 3 );
+                            break;
+
+                        case 16:
+                            iPixel = ( ( Pixel16 * ) pRow ) [ iX ];
+                            iR = ( UCHAR ) ( ( ( iPixel >> 11 ) & 31 ) << 3 );
+                            iG = ( UCHAR ) ( ( ( iPixel >> 5 ) & 63 ) << 2 );
+                            iB = ( UCHAR ) ( ( iPixel & 31 ) << 3 );
+                            break;
+
+                        default:
+                            iPixel = ( ( Pixel32 * ) pRow ) [ iX ];
+                            iR = ( UCHAR ) ( iPixel >> 16 );
+                            iG = ( UCHAR ) ( iPixel >> 8 );
+                            iB = ( UCHAR ) iPixel;
+                            break;
+                    }
+
+                    pScanline [ iX * 3 ] = iB;
+                    pScanline [ iX * 3 + 1 ] = iG;
+                    pScanline [ iX * 3 + 2 ] = iR;
+                }
+
+                fwrite ( pScanline, 1, iScanlineByteSize, pFile );
+            }
+
+            free ( pScanline );
+            fclose ( pFile );
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetBlitKernel ()
+        *
+        *   Returns the kernel currently used for blits and fills.
+        */
+
+        int W_GetBlitKernel ()
+        {
+            return g_iCurrBlitKernel;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_SetBlitKernel ()
+        *
+        *   Switches to another kernel. Returns FALSE if the CPU can't run it.
+        */
+
+        bool W_SetBlitKernel ( int iKernel )
+        {
+            if ( ! W_IsBlitKernelSupported ( iKernel ) )
+                return FALSE;
+
+            g_iCurrBlitKernel = iKernel;
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_IsBlitKernelSupported ()
+        *
+        *   Returns TRUE if the specified kernel can be used on this machine.
+        */
+
+        bool W_IsBlitKernelSupported ( int iKernel )
+        {
+            if ( iKernel < 0 || iKernel >= W_BLIT_KERNEL_COUNT )
+                return FALSE;
+
+            return IsKernelSupportedByCPU ( iKernel ) != 0;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetBlitKernelName ()
+        *
+        *   Returns the name of a kernel.
+        */
+
+        char * W_GetBlitKernelName ( int iKernel )
+        {
+            if ( iKernel < 0 || iKernel >= W_BLIT_KERNEL_COUNT )
+                return "Invalid";
+
+            return g_BlitKernels [ iKernel ].pstrName;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetMixKernel ()
+        *
+        *   Returns the kernel currently used for mixing. Mix kernels are numbered like the
+        *   blit kernels and share their names.
+        */
+
+        int W_GetMixKernel ()
+        {
+            return g_iCurrMixKernel;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_SetMixKernel ()
+        *
+        *   Switches to another mix kernel. Returns FALSE if the CPU can't run it.
+        */
+
+        bool W_SetMixKernel ( int iKernel )
+        {
+            if ( ! W_IsBlitKernelSupported ( iKernel ) )
+                return FALSE;
+
+            g_iCurrMixKernel = iKernel;
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_UpdateSound ()
+        *
+        *   Brings the mixer up to the current time, real or virtual. The voices are only mixed
+        *   if sound output or recording is on; otherwise they're just moved along, which costs
+        *   next to nothing. Called by W_HandleWin32MssgLoop (), so hosts that use HandleLoop
+        *   don't need to call it themselves.
+        */
+
+        void W_UpdateSound ()
+        {
+            W_Int64 iTargetFrame = W_GetHighPerformanceTickCount () * W_MIXER_RATE / 1000;
+
+            // Catch up with a clock that's been switched, rather than waiting for it
+
+            if ( iTargetFrame < g_iMixerFrame )
+            {
+                g_iMixerFrame = iTargetFrame;
+                return;
+            }
+
+            W_Int64 iSkipCount = 0;
+
+            if ( ! g_bIsSoundOutputEnabled && ! g_pRecordingFile )
+                iSkipCount = iTargetFrame - g_iMixerFrame;
+            else if ( ! g_pRecordingFile && iTargetFrame - g_iMixerFrame > MIXER_RING_SIZE )
+                iSkipCount = iTargetFrame - g_iMixerFrame - MIXER_RING_SIZE;
+
+            // Skip whatever nobody would hear: everything when nothing is listening, or
+            // anything that would overflow the ring buffer before the host could read it
+
+            if ( iSkipCount )
+            {
+                MixVoices ( NULL, iSkipCount < INT_MAX ? ( int ) iSkipCount : INT_MAX );
+                g_iMixerFrame += iSkipCount;
+            }
+
+            while ( g_iMixerFrame < iTargetFrame )
+            {
+                int iFrameCount = MIXER_BLOCK_SIZE;
+                if ( iTargetFrame - g_iMixerFrame < iFrameCount )
+                    iFrameCount = ( int ) ( iTargetFrame - g_iMixerFrame );
+
+                MixSoundBlock ( iFrameCount );
+                g_iMixerFrame += iFrameCount;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   W_GetVoiceCount ()
+        *
+        *   Returns the number of voices playing.
+        */
+
+        int W_GetVoiceCount ()
+        {
+            return g_iVoiceCount;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_EnableSoundOutput ()
+        *
+        *   Has the mixer keep what it mixes in a ring buffer of 16-bit stereo frames at
+        *   W_MIXER_RATE, for the host to read with W_ReadSoundFrames () and send to a sound
+        *   device. The ring holds about three quarters of a second; if the host falls further
+        *   behind than that, the oldest frames are lost.
+        */
+
+        void W_EnableSoundOutput ()
+        {
+            if ( g_bIsSoundOutputEnabled )
+                return;
+
+            W_UpdateSound ();
+
+            g_iRingReadPos = g_iRingWritePos;
+            g_bIsSoundOutputEnabled = TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_DisableSoundOutput ()
+        *
+        *   Stops keeping the mix for the host.
+        */
+
+        void W_DisableSoundOutput ()
+        {
+            W_UpdateSound ();
+
+            g_bIsSoundOutputEnabled = FALSE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_ReadSoundFrames ()
+        *
+        *   Reads up to the specified number of frames from the ring buffer, and returns how
+        *   many there were.
+        */
+
+        int W_ReadSoundFrames ( short * psFrames, int iFrameCount )
+        {
+            if ( iFrameCount > g_iRingWritePos - g_iRingReadPos )
+                iFrameCount = ( int ) ( g_iRingWritePos - g_iRingReadPos );
+
+            for ( int iCurrFrame = 0; iCurrFrame < iFrameCount; ++ iCurrFrame )
+            {
+                int iRingIndex = ( int ) ( g_iRingReadPos & ( MIXER_RING_SIZE - 1 ) ) * 2;
+
+                psFrames [ iCurrFrame * 2 ] = g_psSoundRing [ iRingIndex ];
+                psFrames [ iCurrFrame * 2 + 1 ] = g_psSoundRing [ iRingIndex + 1 ];
+
+                ++ g_iRingReadPos;
+            }
+
+            return iFrameCount;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_StartSoundRecording ()
+        *
+        *   Starts recording everything the mixer plays to a 16-bit stereo WAV file. The
+        *   recording follows the clock, so with the virtual clock a game can be rendered to
+        *   a file faster than real time.
+        */
+
+        bool W_StartSoundRecording ( char * pstrWAVFilename )
+        {
+            W_StopSoundRecording ();
+
+            W_UpdateSound ();
+
+            if ( ! ( g_pRecordingFile = fopen ( pstrWAVFilename, "wb" ) ) )
+                return FALSE;
+
+            // The header is written again with the real length when recording stops
+
+            WriteWAVHeader ( g_pRecordingFile, 0 );
+            g_iRecordedFrameCount = 0;
+
+            return TRUE;
+        }
+
+        /**************************************************************************************
+        *
+        *   W_StopSoundRecording ()
+        *
+        *   Mixes up to the current time, then finishes off the recording's WAV file.
+        */
+
+        void W_StopSoundRecording ()
+        {
+            if ( ! g_pRecordingFile )
+                return;
+
+            W_UpdateSound ();
+
+            fseek ( g_pRecordingFile, 0, SEEK_SET );
+            WriteWAVHeader ( g_pRecordingFile, g_iRecordedFrameCount );
+
+            fclose ( g_pRecordingFile );
+            g_pRecordingFile = NULL;
+        }
+
+// ---- Blit Kernels --------------------------------------------------------------------------
+
+    // Each kernel works on a rectangle that's already been clipped. Fills write every pixel;
+    // keyed blits copy every source pixel that isn't the key color.
+
+    // ---- Scalar ----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   Fill16_Scalar ()
+        *
+        *   Fills a rectangle of 15- or 16-bit pixels.
+        */
+
+        void Fill16_Scalar ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color )
+        {
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                for ( int iX = 0; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   Fill32_Scalar ()
+        *
+        *   Fills a rectangle of 32-bit pixels.
+        */
+
+        void Fill32_Scalar ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color )
+        {
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                for ( int iX = 0; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed16_Scalar ()
+        *
+        *   Blits a rectangle of 15- or 16-bit pixels, leaving out the key color.
+        */
+
+        void BlitKeyed16_Scalar ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key )
+        {
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel16 * pSourceRow = ( Pixel16 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                for ( int iX = 0; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed32_Scalar ()
+        *
+        *   Blits a rectangle of 32-bit pixels, leaving out the key color.
+        */
+
+        void BlitKeyed32_Scalar ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key )
+        {
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel32 * pSourceRow = ( Pixel32 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                for ( int iX = 0; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+    // ---- SSE2 ------------------------------------------------------------------------------
+
+    #ifdef BLIT_SSE2
+
+        // The SSE2 kernels handle 16 bytes at a time and finish each scanline with the scalar
+        // loop. Keyed blits compare a block of source pixels against the key, skip the block
+        // if it's entirely transparent, copy it if it's entirely opaque, and otherwise merge
+        // it into the destination with the comparison mask.
+
+        /**************************************************************************************
+        *
+        *   Fill16_SSE2 ()
+        *
+        *   Fills a rectangle of 15- or 16-bit pixels, eight at a time.
+        */
+
+        SSE2_KERNEL void Fill16_SSE2 ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color )
+        {
+            __m128i Fill = _mm_set1_epi16 ( ( short ) Color );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 8 <= iXRes; iX += 8 )
+                    _mm_storeu_si128 ( ( __m128i * ) ( pDestRow + iX ), Fill );
+                for ( ; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   Fill32_SSE2 ()
+        *
+        *   Fills a rectangle of 32-bit pixels, four at a time.
+        */
+
+        SSE2_KERNEL void Fill32_SSE2 ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color )
+        {
+            __m128i Fill = _mm_set1_epi32 ( ( int ) Color );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 4 <= iXRes; iX += 4 )
+                    _mm_storeu_si128 ( ( __m128i * ) ( pDestRow + iX ), Fill );
+                for ( ; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed16_SSE2 ()
+        *
+        *   Blits a rectangle of 15- or 16-bit pixels, eight at a time.
+        */
+
+        SSE2_KERNEL void BlitKeyed16_SSE2 ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key )
+        {
+            __m128i KeyBlock = _mm_set1_epi16 ( ( short ) Key );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel16 * pSourceRow = ( Pixel16 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 8 <= iXRes; iX += 8 )
+                {
+                    __m128i Source = _mm_loadu_si128 ( ( __m128i * ) ( pSourceRow + iX ) );
+                    __m128i Mask = _mm_cmpeq_epi16 ( Source, KeyBlock );
+                    int iMask = _mm_movemask_epi8 ( Mask );
+
+                    if ( iMask == 0xFFFF )
+                        continue;
+
+                    if ( iMask != 0 )
+                    {
+                        __m128i Dest = _mm_loadu_si128 ( ( __m128i * ) ( pDestRow + iX ) );
+                        Source = _mm_or_si128 ( _mm_and_si128 ( Mask, Dest ), _mm_andnot_si128 ( Mask, Source ) );
+                    }
+
+                    _mm_storeu_si128 ( ( __m128i * ) ( pDestRow + iX ), Source );
+                }
+
+                for ( ; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed32_SSE2 ()
+        *
+        *   Blits a rectangle of 32-bit pixels, four at a time.
+        */
+
+        SSE2_KERNEL void BlitKeyed32_SSE2 ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key )
+        {
+            __m128i KeyBlock = _mm_set1_epi32 ( ( int ) Key );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel32 * pSourceRow = ( Pixel32 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 4 <= iXRes; iX += 4 )
+                {
+                    __m128i Source = _mm_loadu_si128 ( ( __m128i * ) ( pSourceRow + iX ) );
+                    __m128i Mask = _mm_cmpeq_epi32 ( Source, KeyBlock );
+                    int iMask = _mm_movemask_epi8 ( Mask );
+
+                    if ( iMask == 0xFFFF )
+                        continue;
+
+                    if ( iMask != 0 )
+                    {
+                        __m128i Dest = _mm_loadu_si128 ( ( __m128i * ) ( pDestRow + iX ) );
+                        Source = _mm_or_si128 ( _mm_and_si128 ( Mask, Dest ), _mm_andnot_si128 ( Mask, Source ) );
+                    }
+
+                    _mm_storeu_si128 ( ( __m128i * ) ( pDestRow + iX ), Source );
+                }
+
+                for ( ; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+    #endif
+
+    // ---- AVX2 ------------------------------------------------------------------------------
+
+    #ifdef BLIT_AVX2
+
+        // The AVX2 kernels work the same way as the SSE2 ones, 32 bytes at a time
+
+        /**************************************************************************************
+        *
+        *   Fill16_AVX2 ()
+        *
+        *   Fills a rectangle of 15- or 16-bit pixels, sixteen at a time.
+        */
+
+        AVX2_KERNEL void Fill16_AVX2 ( Pixel16 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel16 Color )
+        {
+            __m256i Fill = _mm256_set1_epi16 ( ( short ) Color );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 16 <= iXRes; iX += 16 )
+                    _mm256_storeu_si256 ( ( __m256i * ) ( pDestRow + iX ), Fill );
+                for ( ; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   Fill32_AVX2 ()
+        *
+        *   Fills a rectangle of 32-bit pixels, eight at a time.
+        */
+
+        AVX2_KERNEL void Fill32_AVX2 ( Pixel32 * pDest, int iDestPitch, int iXRes, int iYRes, Pixel32 Color )
+        {
+            __m256i Fill = _mm256_set1_epi32 ( ( int ) Color );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 8 <= iXRes; iX += 8 )
+                    _mm256_storeu_si256 ( ( __m256i * ) ( pDestRow + iX ), Fill );
+                for ( ; iX < iXRes; ++ iX )
+                    pDestRow [ iX ] = Color;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed16_AVX2 ()
+        *
+        *   Blits a rectangle of 15- or 16-bit pixels, sixteen at a time.
+        */
+
+        AVX2_KERNEL void BlitKeyed16_AVX2 ( Pixel16 * pDest, int iDestPitch, Pixel16 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel16 Key )
+        {
+            __m256i KeyBlock = _mm256_set1_epi16 ( ( short ) Key );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel16 * pDestRow = ( Pixel16 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel16 * pSourceRow = ( Pixel16 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 16 <= iXRes; iX += 16 )
+                {
+                    __m256i Source = _mm256_loadu_si256 ( ( __m256i * ) ( pSourceRow + iX ) );
+                    __m256i Mask = _mm256_cmpeq_epi16 ( Source, KeyBlock );
+                    int iMask = _mm256_movemask_epi8 ( Mask );
+
+                    if ( iMask == -1 )
+                        continue;
+
+                    if ( iMask != 0 )
+                    {
+                        __m256i Dest = _mm256_loadu_si256 ( ( __m256i * ) ( pDestRow + iX ) );
+                        Source = _mm256_blendv_epi8 ( Source, Dest, Mask );
+                    }
+
+                    _mm256_storeu_si256 ( ( __m256i * ) ( pDestRow + iX ), Source );
+                }
+
+                for ( ; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   BlitKeyed32_AVX2 ()
+        *
+        *   Blits a rectangle of 32-bit pixels, eight at a time.
+        */
+
+        AVX2_KERNEL void BlitKeyed32_AVX2 ( Pixel32 * pDest, int iDestPitch, Pixel32 * pSource, int iSourcePitch, int iXRes, int iYRes, Pixel32 Key )
+        {
+            __m256i KeyBlock = _mm256_set1_epi32 ( ( int ) Key );
+
+            for ( int iY = 0; iY < iYRes; ++ iY )
+            {
+                Pixel32 * pDestRow = ( Pixel32 * ) GetPixelRow ( pDest, iDestPitch, iY );
+                Pixel32 * pSourceRow = ( Pixel32 * ) GetPixelRow ( pSource, iSourcePitch, iY );
+
+                int iX = 0;
+                for ( ; iX + 8 <= iXRes; iX += 8 )
+                {
+                    __m256i Source = _mm256_loadu_si256 ( ( __m256i * ) ( pSourceRow + iX ) );
+                    __m256i Mask = _mm256_cmpeq_epi32 ( Source, KeyBlock );
+                    int iMask = _mm256_movemask_epi8 ( Mask );
+
+                    if ( iMask == -1 )
+                        continue;
+
+                    if ( iMask != 0 )
+                    {
+                        __m256i Dest = _mm256_loadu_si256 ( ( __m256i * ) ( pDestRow + iX ) );
+                        Source = _mm256_blendv_epi8 ( Source, Dest, Mask );
+                    }
+
+                    _mm256_storeu_si256 ( ( __m256i * ) ( pDestRow + iX ), Source );
+                }
+
+                for ( ; iX < iXRes; ++ iX )
+                    if ( pSourceRow [ iX ] != Key )
+                        pDestRow [ iX ] = pSourceRow [ iX ];
+            }
+        }
+
+    #endif
+
+// ---- Mix Kernels ---------------------------------------------------------------------------
+
+    // Each kernel does the same float operations in the same order, so they all produce
+    // exactly the same mix. Conversion truncates towards zero after clamping. The SIMD
+    // kernels finish each run with the scalar loop.
+
+    // ---- Scalar ----------------------------------------------------------------------------
+
+        /**************************************************************************************
+        *
+        *   MixVoice_Scalar ()
+        *
+        *   Adds a run of mono samples to a stereo mix, one frame at a time.
+        */
+
+        void MixVoice_Scalar ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain )
+        {
+            for ( int iCurrFrame = 0; iCurrFrame < iFrameCount; ++ iCurrFrame )
+            {
+                pfMix [ iCurrFrame * 2 ] += pfSamples [ iCurrFrame ] * fLeftGain;
+                pfMix [ iCurrFrame * 2 + 1 ] += pfSamples [ iCurrFrame ] * fRightGain;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   ConvertMix_Scalar ()
+        *
+        *   Clamps a mix to 16-bit samples, one at a time.
+        */
+
+        void ConvertMix_Scalar ( short * psDest, float * pfMix, int iSampleCount )
+        {
+            for ( int iCurrSample = 0; iCurrSample < iSampleCount; ++ iCurrSample )
+            {
+                float fSample = pfMix [ iCurrSample ];
+
+                if ( fSample > 32767.0f )
+                    fSample = 32767.0f;
+                else if ( fSample < -32768.0f )
+                    fSample = -32768.0f;
+
+                psDest [ iCurrSample ] = ( short ) fSample;
+            }
+        }
+
+    // ---- SSE2 ------------------------------------------------------------------------------
+
+    #ifdef BLIT_SSE2
+
+        /**************************************************************************************
+        *
+        *   MixVoice_SSE2 ()
+        *
+        *   Adds a run of mono samples to a stereo mix, four frames at a time. Each sample is
+        *   duplicated into a left/right pair and multiplied by both gains at once.
+        */
+
+        SSE2_KERNEL void MixVoice_SSE2 ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain )
+        {
+            __m128 Gains = _mm_setr_ps ( fLeftGain, fRightGain, fLeftGain, fRightGain );
+
+            int iCurrFrame = 0;
+            for ( ; iCurrFrame + 4 <= iFrameCount; iCurrFrame += 4 )
+            {
+                __m128 Samples = _mm_loadu_ps ( pfSamples + iCurrFrame );
+                float * pfDest = pfMix + iCurrFrame * 2;
+
+                __m128 Lo = _mm_mul_ps ( _mm_unpacklo_ps ( Samples, Samples ), Gains );
+                __m128 Hi = _mm_mul_ps ( _mm_unpackhi_ps ( Samples, Samples ), Gains );
+
+                _mm_storeu_ps ( pfDest, _mm_add_ps ( _mm_loadu_ps ( pfDest ), Lo ) );
+                _mm_storeu_ps ( pfDest + 4, _mm_add_ps ( _mm_loadu_ps ( pfDest + 4 ), Hi ) );
+            }
+
+            for ( ; iCurrFrame < iFrameCount; ++ iCurrFrame )
+            {
+                pfMix [ iCurrFrame * 2 ] += pfSamples [ iCurrFrame ] * fLeftGain;
+                pfMix [ iCurrFrame * 2 + 1 ] += pfSamples [ iCurrFrame ] * fRightGain;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   ConvertMix_SSE2 ()
+        *
+        *   Clamps a mix to 16-bit samples, eight at a time.
+        */
+
+        SSE2_KERNEL void ConvertMix_SSE2 ( short * psDest, float * pfMix, int iSampleCount )
+        {
+            __m128 Max = _mm_set1_ps ( 32767.0f ),
+                   Min = _mm_set1_ps ( -32768.0f );
+
+            int iCurrSample = 0;
+            for ( ; iCurrSample + 8 <= iSampleCount; iCurrSample += 8 )
+            {
+                __m128 Lo = _mm_max_ps ( _mm_min_ps ( _mm_loadu_ps ( pfMix + iCurrSample ), Max ), Min );
+                __m128 Hi = _mm_max_ps ( _mm_min_ps ( _mm_loadu_ps ( pfMix + iCurrSample + 4 ), Max ), Min );
+
+                _mm_storeu_si128 ( ( __m128i * ) ( psDest + iCurrSample ),
+                                   _mm_packs_epi32 ( _mm_cvttps_epi32 ( Lo ), _mm_cvttps_epi32 ( Hi ) ) );
+            }
+
+            for ( ; iCurrSample < iSampleCount; ++ iCurrSample )
+            {
+                float fSample = pfMix [ iCurrSample ];
+
+                if ( fSample > 32767.0f )
+                    fSample = 32767.0f;
+                else if ( fSample < -32768.0f )
+                    fSample = -32768.0f;
+
+                psDest [ iCurrSample ] = ( short ) fSample;
+            }
+        }
+
+    #endif
+
+    // ---- AVX2 ------------------------------------------------------------------------------
+
+    #ifdef BLIT_AVX2
+
+        /**************************************************************************************
+        *
+        *   MixVoice_AVX2 ()
+        *
+        *   Adds a run of mono samples to a stereo mix, eight frames at a time. Duplicating the
+        *   samples works within each 128-bit half, so the halves are swapped back into order
+        *   afterwards.
+        */
+
+        AVX2_KERNEL void MixVoice_AVX2 ( float * pfMix, float * pfSamples, int iFrameCount, float fLeftGain, float fRightGain )
+        {
+            __m256 Gains = _mm256_setr_ps ( fLeftGain, fRightGain, fLeftGain, fRightGain,
+                                            fLeftGain, fRightGain, fLeftGain, fRightGain );
+
+            int iCurrFrame = 0;
+            for ( ; iCurrFrame + 8 <= iFrameCount; iCurrFrame += 8 )
+            {
+                __m256 Samples = _mm256_loadu_ps ( pfSamples + iCurrFrame );
+                float * pfDest = pfMix + iCurrFrame * 2;
+
+                __m256 PairsLo = _mm256_unpacklo_ps ( Samples, Samples );
+                __m256 PairsHi = _mm256_unpackhi_ps ( Samples, Samples );
+
+                __m256 Lo = _mm256_mul_ps ( _mm256_permute2f128_ps ( PairsLo, PairsHi, 0x20 ), Gains );
+                __m256 Hi = _mm256_mul_ps ( _mm256_permute2f128_ps ( PairsLo, PairsHi, 0x31 ), Gains );
+
+                _mm256_storeu_ps ( pfDest, _mm256_add_ps ( _mm256_loadu_ps ( pfDest ), Lo ) );
+                _mm256_storeu_ps ( pfDest + 8, _mm256_add_ps ( _mm256_loadu_ps ( pfDest + 8 ), Hi ) );
+            }
+
+            for ( ; iCurrFrame < iFrameCount; ++ iCurrFrame )
+            {
+                pfMix [ iCurrFrame * 2 ] += pfSamples [ iCurrFrame ] * fLeftGain;
+                pfMix [ iCurrFrame * 2 + 1 ] += pfSamples [ iCurrFrame ] * fRightGain;
+            }
+        }
+
+        /**************************************************************************************
+        *
+        *   ConvertMix_AVX2 ()
+        *
+        *   Clamps a mix to 16-bit samples, sixteen at a time. Packing also works within each
+        *   128-bit half, so the results are put back in order the same way.
+        */
+
+        AVX2_KERNEL void ConvertMix_AVX2 ( short * psDest, float * pfMix, int iSampleCount )
+        {
+            __m256 Max = _mm256_set1_ps ( 32767.0f ),
+                   Min = _mm256_set1_ps ( -32768.0f );
+
+            int iCurrSample = 0;
+            for ( ; iCurrSample + 16 <= iSampleCount; iCurrSample += 16 )
+            {
+                __m256 Lo = _mm256_max_ps ( _mm256_min_ps ( _mm256_loadu_ps ( pfMix + iCurrSample ), Max ), Min );
+                __m256 Hi = _mm256_max_ps ( _mm256_min_ps ( _mm256_loadu_ps ( pfMix + iCurrSample + 8 ), Max ), Min );
+
+                __m256i Packed = _mm256_packs_epi32 ( _mm256_cvttps_epi32 ( Lo ), _mm256_cvttps_epi32 ( Hi ) );
+
+                _mm256_storeu_si256 ( ( __m256i * ) ( psDest + iCurrSample ), _mm256_permute4x64_epi64 ( Packed, 0xD8 ) );
+            }
+
+            for ( ; iCurrSample < iSampleCount; ++ iCurrSample )
+            {
+                float fSample = pfMix [ iCurrSample ];
+
+                if ( fSample > 32767.0f )
+                    fSample = 32767.0f;
+                else if ( fSample < -32768.0f )
+                    fSample = -32768.0f;
+
+                psDest [ iCurrSample ] = ( short ) fSample;
+            }
+        }
+
+    #endif
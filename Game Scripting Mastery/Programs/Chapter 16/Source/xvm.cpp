@@ -231,12 +231,13 @@
 
             Value _RetVal;								// The _RetVal register
 
-            // Script data
+            // Script data. Members that share their type's name are declared with the type's
+            // structure tag, since GCC won't let a member change what a name in the class means.
 
-            InstrStream InstrStream;                    // The instruction stream
+            _InstrStream InstrStream;                   // The instruction stream
             RuntimeStack Stack;                         // The runtime stack
-            FuncTable FuncTable;                        // The function table
-			HostAPICallTable HostAPICallTable;			// The host API call table
+            _FuncTable FuncTable;                       // The function table
+			_HostAPICallTable HostAPICallTable;			// The host API call table
 		}
 			Script;
 
@@ -679,7 +680,8 @@
 
 			// Read in each string
 
-			for ( int iCurrStringIndex = 0; iCurrStringIndex < iStringTableSize; ++ iCurrStringIndex )
+			int iCurrStringIndex;
+			for ( iCurrStringIndex = 0; iCurrStringIndex < iStringTableSize; ++ iCurrStringIndex )
 			{
 				// Read in the string size (4 bytes)
 
@@ -1721,7 +1723,8 @@ extern FILE * ErrorFile;
                     // Search through the host API until the matching function is found
 
                     int iMatchFound = FALSE;
-                    for ( int iHostAPIFuncIndex = 0; iHostAPIFuncIndex < MAX_HOST_API_SIZE; ++ iHostAPIFuncIndex )
+                    int iHostAPIFuncIndex;
+                    for ( iHostAPIFuncIndex = 0; iHostAPIFuncIndex < MAX_HOST_API_SIZE; ++ iHostAPIFuncIndex )
                     {
                         // Get a pointer to the name of the current host API function
 
@@ -2075,7 +2078,7 @@ extern FILE * ErrorFile;
             // It's an integer, so convert it to a string
 
 			case OP_TYPE_INT:
-				itoa ( Val.iIntLiteral, pstrCoercion, 10 );
+				sprintf ( pstrCoercion, "%d", Val.iIntLiteral );
                 return pstrCoercion;
 
 			// It's a float, so use sprintf () to convert it since there's no built-in function
@@ -2771,7 +2774,8 @@ extern FILE * ErrorFile;
                 g_HostAPI [ iCurrHostAPIFunc ].iThreadIndex = iThreadIndex;
                 g_HostAPI [ iCurrHostAPIFunc ].pstrName = ( char * ) malloc ( strlen ( pstrName ) + 1 );
                 strcpy ( g_HostAPI [ iCurrHostAPIFunc ].pstrName, pstrName );
-                strupr ( g_HostAPI [ iCurrHostAPIFunc ].pstrName );
+                for ( char * pstrCurrChar = g_HostAPI [ iCurrHostAPIFunc ].pstrName; * pstrCurrChar; ++ pstrCurrChar )
+                    * pstrCurrChar = toupper ( * pstrCurrChar );
                 g_HostAPI [ iCurrHostAPIFunc ].fnFunc = fnFunc;
 
                 // Set the function to active
@@ -23,14 +23,24 @@
 	#include <stdlib.h>
     #include <stdio.h>
     #include <string.h>
+    #include <ctype.h>
     #include <math.h>
     #include <stdarg.h>
 
     // The following Windows-specific includes are only here to implement GetCurrTime (); these
-    // can be replaced when implementing the XVM on non-Windows platforms.
-
-	#define WIN32_LEAN_AND_MEAN
-	#include <windows.h>
+    // can be replaced when implementing the XVM on non-Windows platforms. Elsewhere, the POSIX
+    // equivalents are used instead.
+
+    #ifdef _WIN32
+	    #define WIN32_LEAN_AND_MEAN
+	    #include <windows.h>
+    #else
+        #include <time.h>
+        #include <strings.h>
+
+        #define stricmp strcasecmp
+        #define strnicmp strncasecmp
+    #endif
 
 // ---- Constants -----------------------------------------------------------------------------
 